@@ -0,0 +1,61 @@
+/**************************************************************************//**
+ * @file     scapdu_sc.h
+ * @version  V1.00
+ * @brief    Smartcard APDU engine port on the SC interfaces header file
+ *
+ * @details  Runs the APDU engine of scapdu.h on a card SCLIB activated. SCn_IRQHandler() chains
+ *           the port in front of the SCLIB event checks:
+ *
+ *               if(SCLIB_CheckCDEvent(n))
+ *               {
+ *                   SCAPDU_SC_Detach(n);
+ *                   return;
+ *               }
+ *               if(SCAPDU_SC_IRQHandler(n))
+ *                   return;
+ *               SCLIB_CheckTimeOutEvent(n);
+ *               SCLIB_CheckTxRxEvent(n);
+ *               SCLIB_CheckErrorEvent(n);
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __SCAPDU_SC_H__
+#define __SCAPDU_SC_H__
+
+#include "scapdu.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup LIBRARY Library
+  @{
+*/
+
+/** @addtogroup SCAPDU_SC SC APDU Port
+  @{
+*/
+
+/** @addtogroup SCAPDU_SC_EXPORTED_FUNCTIONS SC APDU Port Exported Functions
+  @{
+*/
+
+void SCAPDU_SC_Init(void);
+int32_t SCAPDU_SC_Attach(uint32_t u32Slot, uint32_t u32Ifsd);
+void SCAPDU_SC_Detach(uint32_t u32Slot);
+uint32_t SCAPDU_SC_IRQHandler(uint32_t u32Slot);
+
+/*@}*/ /* end of group SCAPDU_SC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SCAPDU_SC */
+
+/*@}*/ /* end of group LIBRARY */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCAPDU_SC_H__ */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,256 @@
+/**************************************************************************//**
+ * @file     scapdu_sc.c
+ * @version  V1.00
+ * @brief    M480 series smartcard APDU engine port on the SC interfaces
+ *
+ * @details  Takes an interface over from SCLIB once the card is activated, so it lives beside the
+ *           Smartcard Library rather than in the Standard Driver. Build it with scapdu.c and the
+ *           SmartCardLib library.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "sclib.h"
+#include "scapdu_sc.h"
+
+/** @addtogroup LIBRARY Library
+  @{
+*/
+
+/** @addtogroup SCAPDU_SC SC APDU Port
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define SCAPDU_SC_MARGIN        12UL            /* ETU added to each wait: the timer starts as the last character leaves */
+#define SCAPDU_SC_TMR_MAX       0xFFFFFFUL      /* Timer 0 is 24 bits */
+#define SCAPDU_SC_ERR_Msk       (SC_STATUS_PEF_Msk | SC_STATUS_FEF_Msk | SC_STATUS_BEF_Msk | SC_STATUS_RXOV_Msk | \
+                                 SC_STATUS_TXOV_Msk | SC_STATUS_RXOVERR_Msk | SC_STATUS_TXOVERR_Msk)
+
+static SC_T *const s_apsSc[SC_INTERFACE_NUM] = { SC0, SC1, SC2 };
+static const IRQn_Type s_aeIrq[SC_INTERFACE_NUM] = { SC0_IRQn, SC1_IRQn, SC2_IRQn };
+
+/* Bytes of the pfnSend in progress */
+static const uint8_t *s_apu8Tx[SC_INTERFACE_NUM];
+static uint32_t s_au32TxLeft[SC_INTERFACE_NUM];
+static uint32_t s_au32Attached[SC_INTERFACE_NUM];
+
+static void SCAPDU_SC_Fill(uint32_t u32Slot)
+{
+    SC_T *sc = s_apsSc[u32Slot];
+
+    while (s_au32TxLeft[u32Slot] && ((sc->STATUS & SC_STATUS_TXFULL_Msk) == 0UL))
+    {
+        SC_WRITE(sc, *s_apu8Tx[u32Slot]++);
+        s_au32TxLeft[u32Slot]--;
+    }
+}
+
+static void SCAPDU_SC_Send(uint32_t u32Slot, const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    s_apu8Tx[u32Slot] = pu8Buf;
+    s_au32TxLeft[u32Slot] = u32Len;
+    SCAPDU_SC_Fill(u32Slot);
+    SC_ENABLE_INT(s_apsSc[u32Slot], SC_INTEN_TBEIEN_Msk);
+}
+
+static void SCAPDU_SC_Timer(uint32_t u32Slot, uint32_t u32Etu)
+{
+    SC_T *sc = s_apsSc[u32Slot];
+
+    SC_StopTimer(sc, 0UL);
+    sc->INTSTS = SC_INTSTS_TMR0IF_Msk;
+    if (u32Etu != 0UL)
+    {
+        u32Etu += SCAPDU_SC_MARGIN;
+        SC_StartTimer(sc, 0UL, SC_TMR_MODE_0, (u32Etu < SCAPDU_SC_TMR_MAX) ? u32Etu : SCAPDU_SC_TMR_MAX);
+    }
+}
+
+/* Mask the SC interrupt in the NVIC, return whether it was enabled */
+static uint32_t SCAPDU_SC_Lock(uint32_t u32Slot)
+{
+    uint32_t u32IRQn = (uint32_t)s_aeIrq[u32Slot];
+    uint32_t u32En = NVIC->ISER[u32IRQn >> 5] & (1UL << (u32IRQn & 0x1FUL));
+
+    NVIC_DisableIRQ((IRQn_Type)u32IRQn);
+    __DSB();
+    __ISB();
+    return u32En;
+}
+
+static void SCAPDU_SC_Unlock(uint32_t u32Slot, uint32_t u32En)
+{
+    if (u32En)
+        NVIC_EnableIRQ(s_aeIrq[u32Slot]);
+}
+
+static const SCAPDU_PORT_T s_sPort =
+{
+    SCAPDU_SC_Send,
+    SCAPDU_SC_Timer,
+    SCAPDU_SC_Lock,
+    SCAPDU_SC_Unlock
+};
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup SCAPDU_SC_EXPORTED_FUNCTIONS SC APDU Port Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Initialize the engine on the SC interfaces
+  * @return     None
+  */
+void SCAPDU_SC_Init(void)
+{
+    memset(s_au32Attached, 0, sizeof(s_au32Attached));
+    SCAPDU_Init(&s_sPort);
+}
+
+/**
+  * @brief      Take over an interface with an activated card
+  * @param[in]  u32Slot     Interface, 0 ~ SC_INTERFACE_NUM - 1
+  * @param[in]  u32Ifsd     T=1 IFSD to negotiate, 1 ~ 254; SCAPDU_T1_IFS_DEFAULT keeps 32
+  * @retval     SCAPDU_OK           Success
+  * @retval     SCAPDU_ERR_PARAM    Invalid argument or ATR
+  * @retval     SCAPDU_ERR_STATE    No activated card, or already attached
+  * @details    Call after SCLIB_Activate() returns SCLIB_SUCCESS. The protocol and rate are those
+  *             SCLIB settled on with PPS; from here SCAPDU_SC_IRQHandler() runs the interface and
+  *             SCLIB_StartTransmission() must not be used on it until SCAPDU_SC_Detach().
+  */
+int32_t SCAPDU_SC_Attach(uint32_t u32Slot, uint32_t u32Ifsd)
+{
+    SCLIB_CARD_INFO_T sInfo;
+    SCAPDU_PARAM_T sParam;
+    SC_T *sc;
+    int32_t i32Ret;
+
+    if ((u32Slot >= SC_INTERFACE_NUM) || (u32Ifsd == 0UL) || (u32Ifsd > SCAPDU_T1_IFSD))
+        return SCAPDU_ERR_PARAM;
+    if (SCLIB_GetCardInfo(u32Slot, &sInfo) != SCLIB_SUCCESS)
+        return SCAPDU_ERR_STATE;
+    if (SCAPDU_ParseAtr(sInfo.ATR_Buf, sInfo.ATR_Len, &sParam) != SCAPDU_OK)
+        return SCAPDU_ERR_PARAM;
+    sParam.u8Protocol = (sInfo.T == SCLIB_PROTOCOL_T1) ? SCAPDU_T1 : SCAPDU_T0;
+    sParam.u8Ifsd = (uint8_t)u32Ifsd;
+
+    sc = s_apsSc[u32Slot];
+    SC_StopAllTimer(sc);
+    SC_ClearFIFO(sc);
+    sc->STATUS = SCAPDU_SC_ERR_Msk;
+    SC_DISABLE_INT(sc, SC_INTEN_TBEIEN_Msk);
+    s_au32TxLeft[u32Slot] = 0UL;
+
+    /* Attached before the interrupts are on: the handler serves them from the first one */
+    s_au32Attached[u32Slot] = 1UL;
+    i32Ret = SCAPDU_Attach(u32Slot, &sParam);
+    if (i32Ret != SCAPDU_OK)
+    {
+        s_au32Attached[u32Slot] = 0UL;
+        return i32Ret;
+    }
+    SC_ENABLE_INT(sc, SC_INTEN_RDAIEN_Msk | SC_INTEN_TERRIEN_Msk | SC_INTEN_TMR0IEN_Msk);
+    return SCAPDU_OK;
+}
+
+/**
+  * @brief      Give an interface back to SCLIB
+  * @param[in]  u32Slot     Interface
+  * @return     None
+  * @details    On card removal (SCLIB_CheckCDEvent()) or before SCLIB_Deactivate(). Queued APDUs
+  *             complete with SCAPDU_STS_REMOVED.
+  */
+void SCAPDU_SC_Detach(uint32_t u32Slot)
+{
+    SC_T *sc;
+
+    if ((u32Slot >= SC_INTERFACE_NUM) || !s_au32Attached[u32Slot])
+        return;
+
+    sc = s_apsSc[u32Slot];
+    SC_DISABLE_INT(sc, SC_INTEN_TBEIEN_Msk);
+    s_au32TxLeft[u32Slot] = 0UL;
+    SCAPDU_Detach(u32Slot);
+    s_au32Attached[u32Slot] = 0UL;
+    SC_StopAllTimer(sc);
+}
+
+/**
+  * @brief      Serve the interface interrupt for the engine
+  * @param[in]  u32Slot     Interface
+  * @retval     0   Not attached: the interrupt is SCLIB's
+  * @retval     1   Served
+  * @details    SCn_IRQHandler() checks SCLIB_CheckCDEvent() first, calling SCAPDU_SC_Detach() on card
+  *             removal, then this, and SCLIB_CheckTimeOutEvent(), SCLIB_CheckTxRxEvent() and
+  *             SCLIB_CheckErrorEvent() only when this returns 0.
+  */
+uint32_t SCAPDU_SC_IRQHandler(uint32_t u32Slot)
+{
+    SC_T *sc;
+    uint32_t u32Sts, u32Len = 0UL;
+    uint8_t au8Rx[4];
+
+    if ((u32Slot >= SC_INTERFACE_NUM) || !s_au32Attached[u32Slot])
+        return 0UL;
+
+    sc = s_apsSc[u32Slot];
+    u32Sts = sc->INTSTS & sc->INTEN;
+
+    if (u32Sts & SC_INTSTS_TERRIF_Msk)
+    {
+        uint32_t u32Err = sc->STATUS & SCAPDU_SC_ERR_Msk;
+
+        sc->STATUS = u32Err;
+        sc->INTSTS = SC_INTSTS_TERRIF_Msk;
+        if (u32Err)
+            SCAPDU_OnError(u32Slot);
+    }
+
+    /* Drain the FIFO, up to 4 bytes: the parser takes them in one call */
+    while ((sc->STATUS & SC_STATUS_RXEMPTY_Msk) == 0UL)
+    {
+        au8Rx[u32Len++] = (uint8_t)SC_READ(sc);
+        if (u32Len == sizeof(au8Rx))
+        {
+            SCAPDU_OnRx(u32Slot, au8Rx, u32Len);
+            u32Len = 0UL;
+        }
+    }
+    if (u32Len)
+        SCAPDU_OnRx(u32Slot, au8Rx, u32Len);
+
+    if (u32Sts & SC_INTSTS_TBEIF_Msk)
+    {
+        if (s_au32TxLeft[u32Slot] != 0UL)
+        {
+            SCAPDU_SC_Fill(u32Slot);
+        }
+        else
+        {
+            /* FIFO empty with nothing left: the last character is shifting out, the wait margin covers it */
+            SC_DISABLE_INT(sc, SC_INTEN_TBEIEN_Msk);
+            SCAPDU_OnTxDone(u32Slot);
+        }
+    }
+
+    /* Read again: a byte or block handled above restarts the timer and clears a stale flag */
+    if (sc->INTSTS & sc->INTEN & SC_INTSTS_TMR0IF_Msk)
+    {
+        sc->INTSTS = SC_INTSTS_TMR0IF_Msk;
+        SCAPDU_OnTimeout(u32Slot);
+    }
+    return 1UL;
+}
+
+/*@}*/ /* end of group SCAPDU_SC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SCAPDU_SC */
+
+/*@}*/ /* end of group LIBRARY */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
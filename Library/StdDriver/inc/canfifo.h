@@ -0,0 +1,122 @@
+/**************************************************************************//**
+ * @file     canfifo.h
+ * @version  V1.00
+ * @brief    M480 series interrupt driven CAN FIFO engine header file
+ *
+ * @details  Programs the message objects as laid out by CANFILT_Compile(): chained receive objects
+ *           act as hardware FIFOs, one per filter, and the lowest objects transmit. The interrupt
+ *           handler drains every receive object with new data, found from the IPND registers in one
+ *           pass, into a software ring with a DWT timestamp, and refills free transmit objects from
+ *           a queue ordered by bus arbitration priority. No call waits for a message interface:
+ *           the engine uses IF2 only, from the handler or with the CAN interrupt masked.
+ *
+ *           The per message object calls of can.c must not be used on a CAN while the engine owns
+ *           it. Open the CAN with CAN_Open() in CAN_NORMAL_MODE first.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __CANFIFO_H__
+#define __CANFIFO_H__
+
+#include "canfilt.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup CANFIFO_Driver CANFIFO Driver
+  @{
+*/
+
+/** @addtogroup CANFIFO_EXPORTED_CONSTANTS CANFIFO Exported Constants
+  @{
+*/
+#define CANFIFO_OK                      0L      /*!< Success \hideinitializer */
+#define CANFIFO_ERR_PARAM               (-1L)   /*!< Invalid configuration or frame \hideinitializer */
+#define CANFIFO_ERR_EMPTY               (-2L)   /*!< No frame received \hideinitializer */
+#define CANFIFO_ERR_FULL                (-3L)   /*!< Transmit queue full \hideinitializer */
+#define CANFIFO_ERR_STATE               (-4L)   /*!< The engine is not open on this CAN \hideinitializer */
+
+/*@}*/ /* end of group CANFIFO_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup CANFIFO_EXPORTED_STRUCTS CANFIFO Exported Structs
+  @{
+*/
+
+/**
+  * @details    Received or queued frame.
+  */
+typedef struct
+{
+    uint32_t u32Id;                 /*!< Identifier */
+    uint32_t u32Stamp;              /*!< Receive: DWT->CYCCNT when drained from the message object */
+    uint8_t  u8IdType;              /*!< CAN_STD_ID or CAN_EXT_ID */
+    uint8_t  u8FrameType;           /*!< CAN_DATA_FRAME or CAN_REMOTE_FRAME */
+    uint8_t  u8Dlc;                 /*!< Data length, 0 ~ 8 */
+    uint8_t  u8Rule;                /*!< Receive: index of the matching CANFILT_RULE_T */
+    uint8_t  au8Data[8];            /*!< Data */
+} CANFIFO_FRAME_T;
+
+/**
+  * @details    Engine configuration, passed to CANFIFO_Open(). The plan and both arrays are used
+  *             until CANFIFO_Close().
+  */
+typedef struct
+{
+    const CANFILT_PLAN_T *psPlan;   /*!< Message object layout from CANFILT_Compile() */
+    CANFIFO_FRAME_T *psRxRing;      /*!< Receive ring */
+    uint32_t u32RxSize;             /*!< Frames in psRxRing, a power of 2 */
+    CANFIFO_FRAME_T *psTxQueue;     /*!< Transmit queue storage */
+    uint32_t u32TxSize;             /*!< Frames in psTxQueue */
+} CANFIFO_CFG_T;
+
+/**
+  * @details    Counters since CANFIFO_Open().
+  */
+typedef struct
+{
+    uint32_t u32RxFrames;           /*!< Frames put in the receive ring */
+    uint32_t u32RxRejected;         /*!< Frames of lossy filters no rule wanted */
+    uint32_t u32RxRingFull;         /*!< Frames dropped because the receive ring was full */
+    uint32_t u32RxHwLost;           /*!< Frames overwritten in a full hardware FIFO (MsgLst) */
+    uint32_t u32RxPeak;             /*!< Most frames waiting in the receive ring */
+    uint32_t u32TxFrames;           /*!< Frames transmitted */
+    uint32_t u32BusOff;             /*!< Bus off events, each recovered automatically */
+    uint32_t u32IsrMaxCycles;       /*!< Longest CANFIFO_IRQHandler() run */
+} CANFIFO_STATS_T;
+
+/*@}*/ /* end of group CANFIFO_EXPORTED_STRUCTS */
+
+
+/** @addtogroup CANFIFO_EXPORTED_FUNCTIONS CANFIFO Exported Functions
+  @{
+*/
+
+int32_t CANFIFO_Open(CAN_T *tCAN, const CANFIFO_CFG_T *psCfg);
+void CANFIFO_Close(CAN_T *tCAN);
+void CANFIFO_IRQHandler(CAN_T *tCAN);
+int32_t CANFIFO_Read(CAN_T *tCAN, CANFIFO_FRAME_T *psFrame);
+uint32_t CANFIFO_GetRxCount(CAN_T *tCAN);
+int32_t CANFIFO_Send(CAN_T *tCAN, const CANFIFO_FRAME_T *psFrame);
+void CANFIFO_GetStats(CAN_T *tCAN, CANFIFO_STATS_T *psStats);
+
+/*@}*/ /* end of group CANFIFO_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group CANFIFO_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
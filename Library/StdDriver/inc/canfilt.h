@@ -0,0 +1,126 @@
+/**************************************************************************//**
+ * @file     canfilt.h
+ * @version  V1.00
+ * @brief    M480 series CAN acceptance filter compiler header file
+ *
+ * @details  Turns a list of wanted identifier and mask rules into a layout of the 32 CAN message
+ *           objects: a number of transmit objects first, then one receive FIFO (a chain of message
+ *           objects with the same filter, the last with EoB set) per hardware filter.
+ *
+ *           Rules covered by another rule share its filter. While there are more filters than
+ *           objects allow, the two filters of the same identifier type whose merge (common mask
+ *           bits that agree) accepts the fewest identifiers no rule asked for are merged. Such
+ *           filters are marked lossy and their frames are checked against the rules in software.
+ *           The receive objects left over after every FIFO got its minimum depth are shared out
+ *           by rule weight, the expected share of the traffic.
+ *
+ *           The compiler has no hardware dependency, so Tool/CanFilter checks it on the host.
+ *           canfifo.c programs the result.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __CANFILT_H__
+#define __CANFILT_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup CANFILT_Driver CANFILT Driver
+  @{
+*/
+
+/** @addtogroup CANFILT_EXPORTED_CONSTANTS CANFILT Exported Constants
+  @{
+*/
+#define CANFILT_MSG_OBJS                32UL            /*!< Message objects of a CAN controller \hideinitializer */
+#define CANFILT_MAX_RULES               32UL            /*!< Maximum rules per plan \hideinitializer */
+#define CANFILT_STD_ID                  0UL             /*!< 11-bit identifier, same value as CAN_STD_ID \hideinitializer */
+#define CANFILT_EXT_ID                  1UL             /*!< 29-bit identifier, same value as CAN_EXT_ID \hideinitializer */
+#define CANFILT_STD_MASK                0x7FFUL         /*!< Identifier bits of a standard frame \hideinitializer */
+#define CANFILT_EXT_MASK                0x1FFFFFFFUL    /*!< Identifier bits of an extended frame \hideinitializer */
+#define CANFILT_OBJ_TX                  0xFFU           /*!< CANFILT_PLAN_T::au8ObjFilter value of a transmit object \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define CANFILT_OK                      0L      /*!< Success \hideinitializer */
+#define CANFILT_ERR_PARAM               (-1L)   /*!< Invalid rule or argument \hideinitializer */
+#define CANFILT_ERR_BUDGET              (-2L)   /*!< The rules cannot be fitted into the receive objects \hideinitializer */
+
+/*@}*/ /* end of group CANFILT_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup CANFILT_EXPORTED_STRUCTS CANFILT Exported Structs
+  @{
+*/
+
+/**
+  * @details    Wanted frames. An identifier is accepted if it equals u32Id in every bit set in u32Mask.
+  */
+typedef struct
+{
+    uint32_t u32Id;                 /*!< Identifier */
+    uint32_t u32Mask;               /*!< Bits that must match, CANFILT_STD_MASK or CANFILT_EXT_MASK for one identifier */
+    uint8_t  u8IdType;              /*!< CANFILT_STD_ID or CANFILT_EXT_ID */
+    uint8_t  u8Weight;              /*!< Relative traffic of the rule, sizes the FIFOs; 0 counts as 1 */
+} CANFILT_RULE_T;
+
+/**
+  * @details    One hardware filter and its receive FIFO.
+  */
+typedef struct
+{
+    uint32_t u32Id;                 /*!< Filter identifier */
+    uint32_t u32Mask;               /*!< Filter mask, 1 = compared */
+    uint32_t u32Rules;              /*!< Bit n set: rule n is served by this filter */
+    uint8_t  u8IdType;              /*!< CANFILT_STD_ID or CANFILT_EXT_ID */
+    uint8_t  u8First;               /*!< First message object, 0 based */
+    uint8_t  u8Depth;               /*!< Message objects in the FIFO */
+    uint8_t  u8Lossy;               /*!< 1 if the filter also accepts identifiers no rule wants */
+} CANFILT_FILTER_T;
+
+/**
+  * @details    Message object layout made by CANFILT_Compile().
+  */
+typedef struct
+{
+    uint32_t u32TxObjs;                                 /*!< Transmit objects, message objects 0 ~ u32TxObjs - 1 */
+    uint32_t u32Filters;                                /*!< Entries used in asFilter[] */
+    uint32_t u32Rules;                                  /*!< Entries used in asRule[] */
+    CANFILT_FILTER_T asFilter[CANFILT_MSG_OBJS];        /*!< Filters, the more specific first */
+    CANFILT_RULE_T asRule[CANFILT_MAX_RULES];           /*!< The rules, identifiers masked */
+    uint8_t au8ObjFilter[CANFILT_MSG_OBJS];             /*!< Filter of each message object, or CANFILT_OBJ_TX */
+} CANFILT_PLAN_T;
+
+/*@}*/ /* end of group CANFILT_EXPORTED_STRUCTS */
+
+
+/** @addtogroup CANFILT_EXPORTED_FUNCTIONS CANFILT Exported Functions
+  @{
+*/
+
+int32_t CANFILT_Compile(const CANFILT_RULE_T *psRules, uint32_t u32Count, uint32_t u32TxObjs,
+                        uint32_t u32MinDepth, CANFILT_PLAN_T *psPlan);
+int32_t CANFILT_Accept(const CANFILT_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32Id);
+int32_t CANFILT_Match(const CANFILT_PLAN_T *psPlan, uint32_t u32Filter, uint32_t u32IdType, uint32_t u32Id);
+
+/*@}*/ /* end of group CANFILT_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group CANFILT_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,155 @@
+/**************************************************************************//**
+ * @file     eadc_acq.h
+ * @version  V1.00
+ * @brief    M480 series continuous EADC acquisition engine header file
+ *
+ * @details  Samples EADC modules 0 ~ N-1 on one shared EPWM or TIMER trigger without gaps. The
+ *           modules of a trigger convert in module order and PDMA moves every result from
+ *           EADC->CURDAT into a ring of blocks, so a block holds whole interleaved frames. The
+ *           scatter-gather descriptors of the ring link in a loop and are never reloaded: the
+ *           transfer runs until EADCACQ_Stop() and raises a PDMA interrupt at the end of each block.
+ *
+ *           EADCACQ_Process() hands the completed blocks to the callback in order, as Q15 samples
+ *           de-interleaved per channel, optionally low pass filtered and decimated per block by
+ *           arm_fir_decimate_q15() (EADCACQ_USE_DSP). A block the PDMA lapped before it was
+ *           processed is dropped and counted, never delivered half overwritten.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __EADC_ACQ_H__
+#define __EADC_ACQ_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup EADCACQ_Driver EADC Acquisition Driver
+  @{
+*/
+
+/** @addtogroup EADCACQ_EXPORTED_CONSTANTS EADC Acquisition Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration. Define before including eadc_acq.h (or on the compiler command line) to override.       */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef EADCACQ_USE_DSP
+#define EADCACQ_USE_DSP         0       /*!< 1: FIR decimation stage, needs ARM_MATH_CM4 and the CMSIS-DSP library \hideinitializer */
+#endif
+
+#ifndef EADCACQ_MAX_BLOCKS
+#define EADCACQ_MAX_BLOCKS      8       /*!< Most blocks in the PDMA ring \hideinitializer */
+#endif
+
+#define EADCACQ_MAX_CH          16UL    /*!< Channels, one per sample module 0 ~ 15 \hideinitializer */
+#define EADCACQ_MAX_BLOCK_LEN   0x10000UL   /*!< Most samples (frames x channels) per block, the PDMA transfer count limit \hideinitializer */
+
+/**
+  * @details    Q15 samples of pi16Work needed for u32Ch channels, u32Frames frames per block and
+  *             decimation factor u32M (0 or 1: none).
+  * \hideinitializer
+  */
+#define EADCACQ_WORK_LEN(u32Ch, u32Frames, u32M) \
+    ((u32Ch) * (u32Frames) + (((u32M) > 1UL) ? ((u32Ch) * (u32Frames) / (u32M)) : 0UL))
+
+/**
+  * @details    Q15 samples of pi16FirState needed for u32Ch channels, u32Taps coefficients and
+  *             u32Frames frames per block.
+  * \hideinitializer
+  */
+#define EADCACQ_FIR_STATE_LEN(u32Ch, u32Taps, u32Frames)   ((u32Ch) * ((u32Taps) + (u32Frames) - 1UL))
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define EADCACQ_OK              0L      /*!< Success \hideinitializer */
+#define EADCACQ_ERR_PARAM       (-1L)   /*!< Invalid configuration \hideinitializer */
+#define EADCACQ_ERR_STATE       (-2L)   /*!< Not open, or already running \hideinitializer */
+#define EADCACQ_ERR_DESC        (-3L)   /*!< Descriptors out of reach of PDMA->SCATBA \hideinitializer */
+
+/*@}*/ /* end of group EADCACQ_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup EADCACQ_EXPORTED_STRUCTS EADC Acquisition Exported Structs
+  @{
+*/
+
+/**
+  * @brief      Block callback
+  * @param[in]  pvArg       EADCACQ_CFG_T::pvArg
+  * @param[in]  pi16Data    Q15 samples, channel-major: channel c starts at pi16Data[c * u32Frames]
+  * @param[in]  u32Frames   Samples per channel, after decimation
+  * @param[in]  u32Seq      Block sequence number since EADCACQ_Start(). A gap means blocks were dropped.
+  */
+typedef void (*EADCACQ_BLOCK_FUNC)(void *pvArg, const int16_t *pi16Data, uint32_t u32Frames, uint32_t u32Seq);
+
+/**
+  * @details    Engine configuration, passed to EADCACQ_Open(). All buffers are used until
+  *             EADCACQ_Close().
+  */
+typedef struct
+{
+    uint32_t u32Channels;           /*!< Sample modules 0 ~ u32Channels - 1 are used, 1 ~ EADCACQ_MAX_CH */
+    const uint8_t *pu8Channel;      /*!< EADC input channel of each sample module */
+    uint32_t u32Trigger;            /*!< Shared trigger, e.g. EADC_TIMER0_TRIGGER or EADC_PWM0TG0_TRIGGER */
+    uint32_t u32PdmaCh;             /*!< PDMA channel, used in scatter-gather mode */
+    uint16_t *pu16Ring;             /*!< Raw result ring, u32Blocks x u32Frames x u32Channels samples */
+    uint32_t u32Blocks;             /*!< Blocks in the ring, 2 ~ EADCACQ_MAX_BLOCKS */
+    uint32_t u32Frames;             /*!< Frames (one sample of every channel) per block */
+    int16_t  *pi16Work;             /*!< EADCACQ_WORK_LEN() samples for de-interleave and decimation */
+    uint32_t u32Decimate;           /*!< Decimation factor, 0 or 1: none. u32Frames must be a multiple. */
+    const int16_t *pi16Coeffs;      /*!< Decimation FIR coefficients, time reversed, Q15 */
+    uint32_t u32Taps;               /*!< Coefficients in pi16Coeffs */
+    int16_t  *pi16FirState;         /*!< EADCACQ_FIR_STATE_LEN() samples of FIR state */
+    EADCACQ_BLOCK_FUNC pfnBlock;    /*!< Called by EADCACQ_Process() for each completed block */
+    void     *pvArg;                /*!< Passed to pfnBlock */
+} EADCACQ_CFG_T;
+
+/**
+  * @details    Counters since EADCACQ_Start().
+  */
+typedef struct
+{
+    uint32_t u32Blocks;             /*!< Blocks filled by PDMA */
+    uint32_t u32Processed;          /*!< Blocks passed to the callback */
+    uint32_t u32Overruns;           /*!< Blocks dropped because the PDMA wrapped around onto them */
+    uint32_t u32SampleOverruns;     /*!< Triggers that found their sample module still busy (EADC->OVSTS) */
+    uint32_t u32BlockUs;            /*!< Time between the last two block interrupts */
+    uint32_t u32ProcUs;             /*!< Processing time of the last block, callback included */
+    uint32_t u32ProcMaxUs;          /*!< Longest processing time of a block */
+} EADCACQ_STATS_T;
+
+/*@}*/ /* end of group EADCACQ_EXPORTED_STRUCTS */
+
+
+/** @addtogroup EADCACQ_EXPORTED_FUNCTIONS EADC Acquisition Exported Functions
+  @{
+*/
+
+int32_t EADCACQ_Open(const EADCACQ_CFG_T *psCfg);
+void EADCACQ_Close(void);
+int32_t EADCACQ_Start(void);
+void EADCACQ_Stop(void);
+void EADCACQ_PdmaHandler(void);
+uint32_t EADCACQ_Process(void);
+void EADCACQ_GetStats(EADCACQ_STATS_T *psStats);
+
+/*@}*/ /* end of group EADCACQ_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group EADCACQ_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -29,6 +29,7 @@ extern "C"
 #define EMAC_PHY_ADDR     1UL    /*!<  PHY address, this address is board dependent \hideinitializer */
 #define EMAC_RX_DESC_SIZE 4UL    /*!<  Number of Rx Descriptors, should be 2 at least \hideinitializer */
 #define EMAC_TX_DESC_SIZE 4UL    /*!<  Number of Tx Descriptors, should be 2 at least \hideinitializer */
+#define EMAC_FRAME_SIZE   1520UL /*!<  Size of a Tx/Rx frame buffer, also for buffers given to \ref EMAC_RecvPktSwap and \ref EMAC_SendPktSwap \hideinitializer */
 
 #define EMAC_LINK_DOWN    0UL    /*!<  Ethernet link is down \hideinitializer */
 #define EMAC_LINK_100F    1UL    /*!<  Ethernet link is 100Mbps full duplex \hideinitializer */
@@ -154,8 +155,10 @@ void EMAC_DisableCamEntry(uint32_t u32Entry);
 uint32_t EMAC_RecvPkt(uint8_t *pu8Data, uint32_t *pu32Size);
 uint32_t EMAC_RecvPktTS(uint8_t *pu8Data, uint32_t *pu32Size, uint32_t *pu32Sec, uint32_t *pu32Nsec);
 void EMAC_RecvPktDone(void);
+uint8_t *EMAC_RecvPktSwap(uint8_t *pu8Buf, uint32_t *pu32Size);
 
 uint32_t EMAC_SendPkt(uint8_t *pu8Data, uint32_t u32Size);
+uint8_t *EMAC_SendPktSwap(uint8_t *pu8Data, uint32_t u32Size);
 uint32_t EMAC_SendPktDone(void);
 uint32_t EMAC_SendPktDoneTS(uint32_t *pu32Sec, uint32_t *pu32Nsec);
 
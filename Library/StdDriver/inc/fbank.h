@@ -0,0 +1,229 @@
+/**************************************************************************//**
+ * @file     fbank.h
+ * @version  V1.00
+ * @brief    M480 series interleaved multi-channel filter bank header file
+ *
+ * @details  Filters interleaved multi-channel audio, e.g. the 4 ~ 8 channel TDM frames set up by
+ *           I2S_ConfigureTDM(), in place in the frame buffers: no de-interleave copies and one call
+ *           for all channels. The biquad kernels filter two channels per pass through the frames, so
+ *           each coefficient is loaded once for both; the FIR kernels gather each channel's samples
+ *           into its history and compute four outputs per pass. Per channel they compute what
+ *           arm_biquad_cascade_df1_q31/q15() and arm_fir_q31/q15() compute, with the same coefficient
+ *           layouts, except that the Q31 results saturate where the CMSIS kernels wrap.
+ *
+ *           FBANK_T builds parametric equalizers and Linkwitz-Riley crossovers on the biquad kernels.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __FBANK_H__
+#define __FBANK_H__
+
+#include "arm_math.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup FBANK_Driver Filter Bank Driver
+  @{
+*/
+
+/** @addtogroup FBANK_EXPORTED_CONSTANTS Filter Bank Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration. Define before including fbank.h (or on the compiler command line) to override.          */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef FBANK_MAX_CH
+#define FBANK_MAX_CH            8UL     /*!< Most channels of a filter bank \hideinitializer */
+#endif
+
+#ifndef FBANK_MAX_STAGES
+#define FBANK_MAX_STAGES        8UL     /*!< Most biquad sections per band of a filter bank \hideinitializer */
+#endif
+
+#ifndef FBANK_MAX_BANDS
+#define FBANK_MAX_BANDS         4UL     /*!< Most crossover bands, at most FBANK_MAX_STAGES / 2 + 1 \hideinitializer */
+#endif
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Sample formats, FBANK_Open()                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define FBANK_Q31               0UL     /*!< q31_t samples \hideinitializer */
+#define FBANK_Q15               1UL     /*!< q15_t samples \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Biquad section types, FBANK_SECTION_T::u32Type                                                         */
+/*---------------------------------------------------------------------------------------------------------*/
+#define FBANK_LOWPASS           0UL     /*!< Low pass, f32Q sets the resonance \hideinitializer */
+#define FBANK_HIGHPASS          1UL     /*!< High pass \hideinitializer */
+#define FBANK_BANDPASS          2UL     /*!< Band pass, 0 dB peak \hideinitializer */
+#define FBANK_NOTCH             3UL     /*!< Notch \hideinitializer */
+#define FBANK_PEAK              4UL     /*!< Peaking equalizer, f32GainDb at f32Freq \hideinitializer */
+#define FBANK_LOWSHELF          5UL     /*!< Low shelf, f32GainDb below f32Freq \hideinitializer */
+#define FBANK_HIGHSHELF         6UL     /*!< High shelf, f32GainDb above f32Freq \hideinitializer */
+#define FBANK_ALLPASS           7UL     /*!< All pass, phase only \hideinitializer */
+
+/**
+  * @details    q31_t (q15_t) state of FBANK_BiquadInitQ31() (FBANK_BiquadInitQ15()).
+  * \hideinitializer
+  */
+#define FBANK_BIQUAD_STATE_LEN(u32Channels, u32Stages)      (4UL * (u32Channels) * (u32Stages))
+
+/**
+  * @details    q31_t (q15_t) state of FBANK_FirInitQ31() (FBANK_FirInitQ15()): per channel, the last
+  *             u32Taps - 1 samples and room for u32MaxFrames new ones.
+  * \hideinitializer
+  */
+#define FBANK_FIR_STATE_LEN(u32Channels, u32Taps, u32MaxFrames)    ((u32Channels) * ((u32Taps) - 1UL + (u32MaxFrames)))
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define FBANK_OK                0L      /*!< Success \hideinitializer */
+#define FBANK_ERR_PARAM         (-1L)   /*!< Invalid parameter \hideinitializer */
+
+/*@}*/ /* end of group FBANK_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup FBANK_EXPORTED_STRUCTS Filter Bank Exported Structs
+  @{
+*/
+
+/**
+  * @details    Interleaved Q31 biquad cascade, the multi-channel arm_biquad_casd_df1_inst_q31.
+  */
+typedef struct
+{
+    uint8_t u8Channels;             /*!< Channels filtered, the first u8Channels samples of each frame */
+    uint8_t u8Stages;               /*!< Biquad sections */
+    uint8_t u8PostShift;            /*!< Coefficients are scaled down by 2^u8PostShift */
+    const q31_t *pq31Coeffs;        /*!< u8Stages x {b0, b1, b2, a1, a2}, shared by all channels */
+    q31_t *pq31State;               /*!< FBANK_BIQUAD_STATE_LEN(), stage by stage, channel by channel */
+} FBANK_BIQUAD_Q31_T;
+
+/**
+  * @details    Interleaved Q15 biquad cascade.
+  */
+typedef struct
+{
+    uint8_t u8Channels;             /*!< Channels filtered, the first u8Channels samples of each frame */
+    uint8_t u8Stages;               /*!< Biquad sections */
+    uint8_t u8PostShift;            /*!< Coefficients are scaled down by 2^u8PostShift */
+    const q15_t *pq15Coeffs;        /*!< u8Stages x {b0, 0, b1, b2, a1, a2}, shared by all channels */
+    q15_t *pq15State;               /*!< FBANK_BIQUAD_STATE_LEN(), stage by stage, channel by channel */
+} FBANK_BIQUAD_Q15_T;
+
+/**
+  * @details    Interleaved Q31 FIR filter.
+  */
+typedef struct
+{
+    uint8_t u8Channels;             /*!< Channels filtered, the first u8Channels samples of each frame */
+    uint16_t u16Taps;               /*!< Coefficients */
+    uint32_t u32MaxFrames;          /*!< Most frames per FBANK_FirQ31() call */
+    const q31_t *pq31Coeffs;        /*!< u16Taps, time reversed as for arm_fir_q31(), shared by all channels */
+    q31_t *pq31State;               /*!< FBANK_FIR_STATE_LEN(), channel by channel */
+} FBANK_FIR_Q31_T;
+
+/**
+  * @details    Interleaved Q15 FIR filter.
+  */
+typedef struct
+{
+    uint8_t u8Channels;             /*!< Channels filtered, the first u8Channels samples of each frame */
+    uint16_t u16Taps;               /*!< Coefficients */
+    uint32_t u32MaxFrames;          /*!< Most frames per FBANK_FirQ15() call */
+    const q15_t *pq15Coeffs;        /*!< u16Taps, time reversed as for arm_fir_q15(), shared by all channels */
+    q15_t *pq15State;               /*!< FBANK_FIR_STATE_LEN(), channel by channel */
+} FBANK_FIR_Q15_T;
+
+/**
+  * @details    A parametric biquad section (RBJ audio EQ cookbook designs).
+  */
+typedef struct
+{
+    uint32_t  u32Type;              /*!< FBANK_LOWPASS ~ FBANK_ALLPASS */
+    float32_t f32Freq;              /*!< Corner or centre frequency, Hz, below half the sample rate */
+    float32_t f32Q;                 /*!< Quality factor, 0.7071 for Butterworth pass filters */
+    float32_t f32GainDb;            /*!< Peak and shelf gain, dB */
+} FBANK_SECTION_T;
+
+/**
+  * @details    Filter bank: an equalizer (one band) or a crossover (2 ~ FBANK_MAX_BANDS bands) on
+  *             interleaved frames. The members are private.
+  */
+typedef struct
+{
+    uint32_t  u32Fmt;
+    uint32_t  u32Channels;
+    uint32_t  u32Bands;
+    float32_t f32SampleRate;
+    union
+    {
+        FBANK_BIQUAD_Q31_T asQ31[FBANK_MAX_BANDS];
+        FBANK_BIQUAD_Q15_T asQ15[FBANK_MAX_BANDS];
+    } uBiquad;
+    union
+    {
+        q31_t aq31[FBANK_MAX_BANDS][5UL * FBANK_MAX_STAGES];
+        q15_t aq15[FBANK_MAX_BANDS][6UL * FBANK_MAX_STAGES];
+    } uCoeffs;
+    union
+    {
+        q31_t aq31[FBANK_MAX_BANDS][FBANK_BIQUAD_STATE_LEN(FBANK_MAX_CH, FBANK_MAX_STAGES)];
+        q15_t aq15[FBANK_MAX_BANDS][FBANK_BIQUAD_STATE_LEN(FBANK_MAX_CH, FBANK_MAX_STAGES)];
+    } uState;
+} FBANK_T;
+
+/*@}*/ /* end of group FBANK_EXPORTED_STRUCTS */
+
+
+/** @addtogroup FBANK_EXPORTED_FUNCTIONS Filter Bank Exported Functions
+  @{
+*/
+
+void FBANK_BiquadInitQ31(FBANK_BIQUAD_Q31_T *psS, uint8_t u8Channels, uint8_t u8Stages, const q31_t *pq31Coeffs,
+                         q31_t *pq31State, uint8_t u8PostShift);
+void FBANK_BiquadQ31(const FBANK_BIQUAD_Q31_T *psS, const q31_t *pq31Src, uint32_t u32SrcStride,
+                     q31_t *pq31Dst, uint32_t u32DstStride, uint32_t u32Frames);
+void FBANK_BiquadInitQ15(FBANK_BIQUAD_Q15_T *psS, uint8_t u8Channels, uint8_t u8Stages, const q15_t *pq15Coeffs,
+                         q15_t *pq15State, uint8_t u8PostShift);
+void FBANK_BiquadQ15(const FBANK_BIQUAD_Q15_T *psS, const q15_t *pq15Src, uint32_t u32SrcStride,
+                     q15_t *pq15Dst, uint32_t u32DstStride, uint32_t u32Frames);
+void FBANK_FirInitQ31(FBANK_FIR_Q31_T *psS, uint8_t u8Channels, uint16_t u16Taps, const q31_t *pq31Coeffs,
+                      q31_t *pq31State, uint32_t u32MaxFrames);
+void FBANK_FirQ31(const FBANK_FIR_Q31_T *psS, const q31_t *pq31Src, uint32_t u32SrcStride,
+                  q31_t *pq31Dst, uint32_t u32DstStride, uint32_t u32Frames);
+void FBANK_FirInitQ15(FBANK_FIR_Q15_T *psS, uint8_t u8Channels, uint16_t u16Taps, const q15_t *pq15Coeffs,
+                      q15_t *pq15State, uint32_t u32MaxFrames);
+void FBANK_FirQ15(const FBANK_FIR_Q15_T *psS, const q15_t *pq15Src, uint32_t u32SrcStride,
+                  q15_t *pq15Dst, uint32_t u32DstStride, uint32_t u32Frames);
+
+int32_t FBANK_Design(const FBANK_SECTION_T *psSection, float32_t f32SampleRate, float32_t *pf32Coeffs);
+int32_t FBANK_Open(FBANK_T *psBank, uint32_t u32Fmt, uint32_t u32Channels, float32_t f32SampleRate);
+int32_t FBANK_SetEQ(FBANK_T *psBank, const FBANK_SECTION_T *psSections, uint32_t u32Sections);
+int32_t FBANK_SetCrossover(FBANK_T *psBank, const float32_t *pf32Freq, uint32_t u32Bands);
+void FBANK_Reset(FBANK_T *psBank);
+void FBANK_Process(FBANK_T *psBank, const void *pvSrc, uint32_t u32SrcStride, void *pvDst, uint32_t u32DstStride,
+                   uint32_t u32Frames);
+
+/*@}*/ /* end of group FBANK_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group FBANK_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,177 @@
+/**************************************************************************//**
+ * @file     fwdelta.h
+ * @version  V1.00
+ * @brief    M480 series delta firmware update header file
+ *
+ * @details  A delta patch turns the image in one APROM slot into a new image in another slot, so
+ *           only the changed bytes travel over the link. Tool/FwDelta creates patches on the host.
+ *
+ *           A patch is a 32-byte header (FWDELTA_HDR_T, little endian) followed by commands:
+ *             - FWDELTA_OP_DIFF, varint len, zigzag varint seek: the old position moves by seek, then
+ *               len output bytes are old bytes plus a difference. The differences follow as pairs of
+ *               a varint count of zero differences and a varint count of literal differences with
+ *               the literal bytes, until len bytes are covered.
+ *             - FWDELTA_OP_INSERT, varint len, len bytes copied to the output.
+ *             - FWDELTA_OP_END.
+ *           Varints are LEB128, 7 bits per byte, least significant group first.
+ *
+ *           The decoder (fwdelta.c) has no hardware dependency and is shared with the host tool.
+ *           It needs one output window of RAM. The flash applier (fwdelta_fmc.c) programs every
+ *           full window as a flash page and records the decoder position in data flash, so an
+ *           update interrupted by a power failure resumes at the last page instead of restarting.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __FWDELTA_H__
+#define __FWDELTA_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup FWDELTA_Driver FWDELTA Driver
+  @{
+*/
+
+/** @addtogroup FWDELTA_EXPORTED_CONSTANTS FWDELTA Exported Constants
+  @{
+*/
+#define FWDELTA_MAGIC                   0x31445746UL    /*!< Header magic, "FWD1" \hideinitializer */
+#define FWDELTA_HDR_SIZE                32UL            /*!< Header size in bytes \hideinitializer */
+#define FWDELTA_CRC_ALIGN               512UL           /*!< Image CRCs cover the image padded with 0xFF to this size, as FMC_GetChkSum() needs \hideinitializer */
+
+#define FWDELTA_OP_END                  0x00    /*!< End of patch \hideinitializer */
+#define FWDELTA_OP_DIFF                 0x01    /*!< Old bytes plus differences \hideinitializer */
+#define FWDELTA_OP_INSERT               0x02    /*!< Literal bytes \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define FWDELTA_OK                      0L      /*!< Success, more patch data expected \hideinitializer */
+#define FWDELTA_DONE                    1L      /*!< FWDELTA_OP_END decoded, output complete \hideinitializer */
+#define FWDELTA_ERR_PARAM               (-1L)   /*!< Invalid configuration \hideinitializer */
+#define FWDELTA_ERR_FORMAT              (-2L)   /*!< Corrupt header or command \hideinitializer */
+#define FWDELTA_ERR_OLD                 (-3L)   /*!< The old image is not the one the patch was made for \hideinitializer */
+#define FWDELTA_ERR_FLASH               (-4L)   /*!< Erase or program failed \hideinitializer */
+#define FWDELTA_ERR_VERIFY              (-5L)   /*!< The new image CRC does not match \hideinitializer */
+#define FWDELTA_ERR_STATE               (-6L)   /*!< No update in progress, or nothing to resume \hideinitializer */
+
+/*@}*/ /* end of group FWDELTA_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup FWDELTA_EXPORTED_STRUCTS FWDELTA Exported Structs
+  @{
+*/
+
+/**
+  * @details    Patch header. CRCs are the standard CRC-32 (FWDELTA_Crc32(), FMC_GetChkSum()).
+  */
+typedef struct
+{
+    uint32_t u32Magic;              /*!< FWDELTA_MAGIC */
+    uint32_t u32Flags;              /*!< Reserved, 0 */
+    uint32_t u32OldSize;            /*!< Old image size in bytes */
+    uint32_t u32OldCrc;             /*!< CRC-32 of the old image padded to FWDELTA_CRC_ALIGN */
+    uint32_t u32NewSize;            /*!< New image size in bytes */
+    uint32_t u32NewCrc;             /*!< CRC-32 of the new image padded to FWDELTA_CRC_ALIGN */
+    uint32_t u32BodySize;           /*!< Command bytes after the header */
+    uint32_t u32HdrCrc;             /*!< CRC-32 of the 28 bytes before */
+} FWDELTA_HDR_T;
+
+/**
+  * @details    Decoder position. Only plain counters, so it can be stored and restored to resume.
+  */
+typedef struct
+{
+    uint32_t u32InPos;              /*!< Command bytes consumed */
+    uint32_t u32OutPos;             /*!< Output bytes produced */
+    uint32_t u32OldPos;             /*!< Old image read position */
+    uint32_t u32State;              /*!< Parser state */
+    uint32_t u32OpLeft;             /*!< Output bytes left in the current DIFF command */
+    uint32_t u32RunLeft;            /*!< Bytes left in the current run */
+    uint32_t u32Var;                /*!< Varint being parsed */
+    uint32_t u32VarShift;           /*!< Bits of u32Var parsed */
+} FWDELTA_POS_T;
+
+/**
+  * @details    Decoder. pfnOld() copies old image bytes, which the decoder has range checked, into
+  *             the window. pfnFlush() gets the window each time it is full and once more with the
+  *             rest of the output at FWDELTA_OP_END. Callbacks return FWDELTA_OK or an error, which
+  *             FWDELTA_Decode() passes on.
+  */
+typedef struct FWDELTA_DEC
+{
+    FWDELTA_POS_T sPos;             /*!< Position, cleared by FWDELTA_DecInit() */
+    uint32_t u32OldSize;            /*!< Old image size, set by FWDELTA_DecInit() */
+    uint32_t u32NewSize;            /*!< New image size, set by FWDELTA_DecInit() */
+    uint8_t  *pu8Win;               /*!< Output window */
+    uint32_t u32WinSize;            /*!< Output window size in bytes */
+    void     *pvArg;                /*!< Passed to the callbacks */
+    int32_t  (*pfnOld)(void *pvArg, uint32_t u32Off, uint8_t *pu8Dst, uint32_t u32Len);              /*!< Copy old image bytes */
+    int32_t  (*pfnFlush)(void *pvArg, uint32_t u32Off, const uint8_t *pu8Win, uint32_t u32Len);      /*!< Take output bytes at output offset u32Off */
+} FWDELTA_DEC_T;
+
+/**
+  * @details    Flash applier configuration, passed to FWDELTA_Begin() and FWDELTA_Resume(). The two
+  *             slots must not overlap. The work area is two data flash pages for the progress
+  *             records; it is erased when an update begins and when it completes.
+  */
+typedef struct
+{
+    uint32_t u32OldBase;            /*!< APROM address of the old image, page aligned */
+    uint32_t u32NewBase;            /*!< APROM address the new image is written to, page aligned */
+    uint32_t u32SlotSize;           /*!< Size limit of either image, a multiple of FMC_FLASH_PAGE_SIZE */
+    uint32_t u32LogBase;            /*!< Address of two free data flash pages, page aligned */
+    uint8_t  *pu8PageBuf;           /*!< Output window, FMC_FLASH_PAGE_SIZE bytes, word aligned */
+} FWDELTA_CFG_T;
+
+/**
+  * @details    Counters of the update begun or resumed last. Times are measured with the DWT cycle counter.
+  */
+typedef struct
+{
+    uint32_t u32PatchBytes;         /*!< Patch bytes received, header included */
+    uint32_t u32OutBytes;           /*!< New image bytes produced */
+    uint32_t u32Pages;              /*!< Pages programmed */
+    uint32_t u32Checkpoints;        /*!< Progress records written */
+    uint32_t u32FlashUs;            /*!< Time spent erasing and programming */
+} FWDELTA_STATS_T;
+
+/*@}*/ /* end of group FWDELTA_EXPORTED_STRUCTS */
+
+
+/** @addtogroup FWDELTA_EXPORTED_FUNCTIONS FWDELTA Exported Functions
+  @{
+*/
+
+uint32_t FWDELTA_Crc32(uint32_t u32Crc, const uint8_t *pu8Data, uint32_t u32Len);
+void FWDELTA_PackHeader(FWDELTA_HDR_T *psHdr, uint8_t *pu8Buf);
+int32_t FWDELTA_ParseHeader(const uint8_t *pu8Buf, FWDELTA_HDR_T *psHdr);
+void FWDELTA_DecInit(FWDELTA_DEC_T *psDec, const FWDELTA_HDR_T *psHdr);
+int32_t FWDELTA_Decode(FWDELTA_DEC_T *psDec, const uint8_t *pu8In, uint32_t u32Len);
+
+int32_t FWDELTA_Begin(const FWDELTA_CFG_T *psCfg);
+int32_t FWDELTA_Resume(const FWDELTA_CFG_T *psCfg, FWDELTA_HDR_T *psHdr, uint32_t *pu32PatchOff);
+int32_t FWDELTA_Write(const uint8_t *pu8Data, uint32_t u32Len);
+int32_t FWDELTA_Finish(void);
+void FWDELTA_GetStats(FWDELTA_STATS_T *psStats);
+
+/*@}*/ /* end of group FWDELTA_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group FWDELTA_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,121 @@
+/**************************************************************************//**
+ * @file     fwupd.h
+ * @version  V1.00
+ * @brief    M480 series streaming firmware update engine header file
+ *
+ * @details  Programs a firmware image into an APROM slot while it is still being received. Image
+ *           data of any chunk size is staged in two block buffers; a full block is programmed with
+ *           FMC_ISPCMD_PROGRAM_MUL bursts and hashed by the CRPT SHA-256 engine in DMA cascade mode
+ *           while the other block fills. The pages of the slot are erased ahead of the data without
+ *           waiting for the ISP, which only overlaps with execution when the code runs from the
+ *           other APROM bank or from LDROM, as in the FMC_Dual_Bank sample.
+ *
+ *           A slot becomes bootable by a single 64-bit program of a commit trailer at its end, done
+ *           only after the digest matched. The trailer page is erased first, so a slot that lost
+ *           power during an update is never taken for a committed one. The loader boots the slot
+ *           with the highest FWUPD_GetSeq() through FMC_SetVectorPageAddr().
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __FWUPD_H__
+#define __FWUPD_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup FWUPD_Driver FWUPD Driver
+  @{
+*/
+
+/** @addtogroup FWUPD_EXPORTED_CONSTANTS FWUPD Exported Constants
+  @{
+*/
+#define FWUPD_DIGEST_SIZE               32UL            /*!< SHA-256 digest size in bytes \hideinitializer */
+#define FWUPD_TRAILER_RSVD              64UL            /*!< Bytes at the end of a slot reserved for the commit trailer \hideinitializer */
+#define FWUPD_COMMIT_MAGIC              0x54494D43UL    /*!< First word of the commit trailer, "CMIT" \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define FWUPD_OK                        0L      /*!< Success, or FWUPD_Poll() has nothing left to do \hideinitializer */
+#define FWUPD_BUSY                      1L      /*!< FWUPD_Poll() still has flash work pending \hideinitializer */
+#define FWUPD_ERR_PARAM                 (-1L)   /*!< Invalid configuration \hideinitializer */
+#define FWUPD_ERR_STATE                 (-2L)   /*!< No update in progress \hideinitializer */
+#define FWUPD_ERR_SIZE                  (-3L)   /*!< Image larger than announced or than the slot \hideinitializer */
+#define FWUPD_ERR_FLASH                 (-4L)   /*!< ISP erase or program failed \hideinitializer */
+#define FWUPD_ERR_HASH                  (-5L)   /*!< SHA engine DMA error \hideinitializer */
+#define FWUPD_ERR_DIGEST                (-6L)   /*!< Image digest does not match, slot not committed \hideinitializer */
+
+/*@}*/ /* end of group FWUPD_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup FWUPD_EXPORTED_STRUCTS FWUPD Exported Structs
+  @{
+*/
+
+/**
+  * @details    Update configuration, passed to FWUPD_Begin(). pu8Buf holds two blocks of u32BlockSize
+  *             bytes each and must be word aligned. The slot must not be in the APROM bank the CPU
+  *             executes from, or every erase ahead stalls the CPU until it completes.
+  */
+typedef struct
+{
+    uint32_t u32SlotBase;           /*!< APROM address of the slot, page aligned */
+    uint32_t u32SlotSize;           /*!< Slot size in bytes, a multiple of FMC_FLASH_PAGE_SIZE */
+    uint32_t u32ImageSize;          /*!< Image size if known, limits the erase ahead; 0 erases the whole slot */
+    uint32_t u32Seq;                /*!< Sequence written by the commit, 1 ~ 0xFFFFFFFE, higher boots first */
+    uint8_t  *pu8Buf;               /*!< Two staging blocks, 2 * u32BlockSize bytes */
+    uint32_t u32BlockSize;          /*!< Bytes per block, a power of 2 from 512 to FMC_FLASH_PAGE_SIZE */
+} FWUPD_CFG_T;
+
+/**
+  * @details    Counters of the update started last. Times are measured with the DWT cycle counter.
+  */
+typedef struct
+{
+    uint32_t u32Bytes;              /*!< Image bytes received */
+    uint32_t u32PagesErased;        /*!< Pages erased, including the trailer page */
+    uint32_t u32Bursts;             /*!< FMC_ISPCMD_PROGRAM_MUL bursts */
+    uint32_t u32ProgramUs;          /*!< Time spent feeding program bursts */
+    uint32_t u32StallUs;            /*!< Time FWUPD_Write() waited for a free block, i.e. flash slower than the link */
+    uint32_t u32HashWaitUs;         /*!< Time spent waiting for the SHA engine */
+    uint32_t u32TotalUs;            /*!< FWUPD_Begin() to the end of FWUPD_Finish() */
+    uint32_t u32KBps;               /*!< u32Bytes / u32TotalUs in 1000 bytes per second */
+} FWUPD_STATS_T;
+
+/*@}*/ /* end of group FWUPD_EXPORTED_STRUCTS */
+
+
+/** @addtogroup FWUPD_EXPORTED_FUNCTIONS FWUPD Exported Functions
+  @{
+*/
+
+int32_t FWUPD_Begin(const FWUPD_CFG_T *psCfg);
+int32_t FWUPD_Write(const uint8_t *pu8Data, uint32_t u32Len);
+int32_t FWUPD_Poll(void);
+int32_t FWUPD_Finish(const uint8_t *pu8Expected, uint8_t *pu8Digest);
+int32_t FWUPD_Commit(void);
+void FWUPD_Abort(void);
+uint32_t FWUPD_GetSeq(uint32_t u32SlotBase, uint32_t u32SlotSize);
+void FWUPD_GetStats(FWUPD_STATS_T *psStats);
+
+/*@}*/ /* end of group FWUPD_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group FWUPD_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,137 @@
+/**************************************************************************//**
+ * @file     hsusbd_cdc.h
+ * @version  V1.00
+ * @brief    M480 series HSUSBD CDC-ACM class with UART PDMA bridge header file
+ *
+ * @details  Moves data between the HSUSBD bulk endpoints and two ring buffers with the HSUSBD DMA
+ *           engine, and between the ring buffers and a UART with two PDMA channels, so no byte is
+ *           copied by the CPU. Endpoint and bus events still come from the application's
+ *           USBD20_IRQHandler(), which calls HSCDC_EpHandler() and HSCDC_DmaDoneHandler().
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __HSUSBD_CDC_H__
+#define __HSUSBD_CDC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup HSCDC_Driver HSUSBD CDC Driver
+  @{
+*/
+
+/** @addtogroup HSCDC_EXPORTED_CONSTANTS HSUSBD CDC Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  CDC class specific requests                                                                            */
+/*---------------------------------------------------------------------------------------------------------*/
+#define HSCDC_SET_LINE_CODE             0x20    /*!< SET_LINE_CODING request \hideinitializer */
+#define HSCDC_GET_LINE_CODE             0x21    /*!< GET_LINE_CODING request \hideinitializer */
+#define HSCDC_SET_CONTROL_LINE_STATE    0x22    /*!< SET_CONTROL_LINE_STATE request \hideinitializer */
+
+#define HSCDC_CTRL_DTR                  0x01UL  /*!< Control line state: DTR \hideinitializer */
+#define HSCDC_CTRL_RTS                  0x02UL  /*!< Control line state: RTS \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define HSCDC_OK                        0L      /*!< Success \hideinitializer */
+#define HSCDC_ERR_PARAM                 (-1L)   /*!< Invalid configuration \hideinitializer */
+
+/*@}*/ /* end of group HSCDC_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup HSCDC_EXPORTED_STRUCTS HSUSBD CDC Exported Structs
+  @{
+*/
+
+/**
+  * @details    Line coding, layout as sent on the wire by SET_LINE_CODING / GET_LINE_CODING.
+  */
+typedef struct
+{
+    uint32_t  u32DTERate;       /*!< Baud rate */
+    uint8_t   u8CharFormat;     /*!< Stop bits: 0 - 1, 1 - 1.5, 2 - 2 */
+    uint8_t   u8ParityType;     /*!< Parity: 0 - None, 1 - Odd, 2 - Even, 3 - Mark, 4 - Space */
+    uint8_t   u8DataBits;       /*!< Data bits: 5, 6, 7, 8 */
+} HSCDC_LINE_CODING_T;
+
+/**
+  * @details    Class configuration, passed to HSCDC_Open(). Both rings must be word aligned and their
+  *             sizes must be powers of 2. The UART to USB ring is filled by PDMA in two halves, so it
+  *             must hold at least two high speed packets (1024 bytes).
+  */
+typedef struct
+{
+    UART_T   *uart;                 /*!< Bridged UART, clocked and pinned by the application */
+    uint32_t u32TxPdmaCh;           /*!< PDMA channel moving USB OUT data to the UART */
+    uint32_t u32RxPdmaCh;           /*!< PDMA channel moving UART data to the USB IN ring */
+    uint32_t u32TxPdmaReq;          /*!< PDMA request of UART TX, e.g. PDMA_UART0_TX */
+    uint32_t u32RxPdmaReq;          /*!< PDMA request of UART RX, e.g. PDMA_UART0_RX */
+    uint8_t  *pu8TxRing;            /*!< USB OUT to UART ring */
+    uint32_t u32TxRingSize;         /*!< Size of pu8TxRing in bytes */
+    uint8_t  *pu8RxRing;            /*!< UART to USB IN ring */
+    uint32_t u32RxRingSize;         /*!< Size of pu8RxRing in bytes */
+    uint32_t u32BulkInEp;           /*!< HSUSBD endpoint of bulk IN, EPA ~ EPL */
+    uint32_t u32BulkInEpNum;        /*!< USB endpoint number of bulk IN */
+    uint32_t u32BulkInBufBase;      /*!< Endpoint buffer offset of bulk IN */
+    uint32_t u32BulkOutEp;          /*!< HSUSBD endpoint of bulk OUT, EPA ~ EPL */
+    uint32_t u32BulkOutEpNum;       /*!< USB endpoint number of bulk OUT */
+    uint32_t u32BulkOutBufBase;     /*!< Endpoint buffer offset of bulk OUT */
+    uint32_t u32BulkBufLen;         /*!< Endpoint buffer length of each bulk endpoint, 1024 double buffers high speed packets */
+    uint32_t u32IntInEp;            /*!< HSUSBD endpoint of interrupt IN, EPA ~ EPL */
+    uint32_t u32IntInEpNum;         /*!< USB endpoint number of interrupt IN */
+    uint32_t u32IntInBufBase;       /*!< Endpoint buffer offset of interrupt IN, 64 bytes */
+} HSCDC_CFG_T;
+
+/**
+  * @details    Transfer counters since HSCDC_Open().
+  */
+typedef struct
+{
+    uint32_t u32InBytes;            /*!< Bytes sent to the host */
+    uint32_t u32OutBytes;           /*!< Bytes received from the host */
+    uint32_t u32InZlp;              /*!< Zero length packets sent to end a transfer */
+    uint32_t u32OutNak;             /*!< Times bulk OUT was held off because the UART TX ring was full */
+    uint32_t u32RxPause;            /*!< Times UART RX PDMA was paused because the USB IN ring was full */
+} HSCDC_STATS_T;
+
+/*@}*/ /* end of group HSCDC_EXPORTED_STRUCTS */
+
+
+/** @addtogroup HSCDC_EXPORTED_FUNCTIONS HSUSBD CDC Exported Functions
+  @{
+*/
+
+int32_t HSCDC_Open(const HSCDC_CFG_T *psCfg);
+void HSCDC_InitEndpoints(uint32_t u32HighSpeed);
+void HSCDC_ClassRequest(void);
+void HSCDC_EpHandler(uint32_t u32GIntSts);
+void HSCDC_DmaDoneHandler(void);
+void HSCDC_PdmaHandler(void);
+void HSCDC_Process(void);
+uint32_t HSCDC_GetCtrlLineState(void);
+void HSCDC_GetLineCoding(HSCDC_LINE_CODING_T *psLineCoding);
+void HSCDC_GetStats(HSCDC_STATS_T *psStats);
+
+/*@}*/ /* end of group HSCDC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group HSCDC_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,151 @@
+/**************************************************************************//**
+ * @file     hsusbd_msc.h
+ * @version  V1.00
+ * @brief    M480 series HSUSBD mass storage (Bulk-Only Transport) class header file
+ *
+ * @details  Handles BOT/SCSI for one logical unit and moves sector data between the HSUSBD DMA
+ *           engine and a pluggable block device. Sector data goes through two chunk buffers, so the
+ *           USB DMA of one chunk runs while the block device reads or writes the other one. The
+ *           USB DMA is chained from the interrupt handler and keeps running while a synchronous
+ *           block device holds the CPU.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __HSUSBD_MSC_H__
+#define __HSUSBD_MSC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup HSMSC_Driver HSUSBD MSC Driver
+  @{
+*/
+
+/** @addtogroup HSMSC_EXPORTED_CONSTANTS HSUSBD MSC Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Mass storage class specific requests                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+#define HSMSC_BOT_RESET                 0xFF    /*!< Bulk-Only Mass Storage Reset request \hideinitializer */
+#define HSMSC_GET_MAX_LUN               0xFE    /*!< Get Max LUN request \hideinitializer */
+
+#define HSMSC_SECTOR_SIZE               512UL   /*!< Block size reported to the host \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes, of the class and of the block device functions                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define HSMSC_OK                        0L      /*!< Success \hideinitializer */
+#define HSMSC_BUSY                      1L      /*!< Block device request still running \hideinitializer */
+#define HSMSC_ERR_PARAM                 (-1L)   /*!< Invalid configuration \hideinitializer */
+#define HSMSC_ERR_IO                    (-2L)   /*!< Block device error \hideinitializer */
+
+/*@}*/ /* end of group HSMSC_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup HSMSC_EXPORTED_STRUCTS HSUSBD MSC Exported Structs
+  @{
+*/
+
+/**
+  * @details    Block device. pfnRead() and pfnWrite() start a request of whole 512-byte sectors and
+  *             return HSMSC_OK or HSMSC_ERR_IO. If pfnPoll is NULL the request has completed when they
+  *             return; otherwise the class calls pfnPoll() until it returns something other than
+  *             HSMSC_BUSY, and does not start another request before that.
+  *             HSMSC_Process() returns once a command is done. While it waits on an asynchronous
+  *             device, or on the USB DMA, it calls HSMSC_CFG_T::pfnIdle, so other main loop work
+  *             can go on; a synchronous device holds the CPU for each whole request. The SD card
+  *             (hsusbd_msc_sdh.c), SPI flash read and RAM devices are asynchronous or immediate.
+  */
+typedef struct HSMSC_DISK
+{
+    uint32_t u32Sectors;            /*!< Capacity in sectors */
+    uint32_t u32Base;               /*!< Backend address of sector 0 */
+    uint32_t u32Arg;                /*!< Backend specific */
+    void     *pvPriv;               /*!< Backend specific */
+    int32_t  (*pfnRead)(struct HSMSC_DISK *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf);  /*!< Start reading sectors into pu8Buf */
+    int32_t  (*pfnWrite)(struct HSMSC_DISK *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf); /*!< Start writing sectors from pu8Buf */
+    int32_t  (*pfnPoll)(struct HSMSC_DISK *psDisk);     /*!< HSMSC_BUSY, or the result of the request started last. NULL for synchronous devices. */
+} HSMSC_DISK_T;
+
+/**
+  * @details    Class configuration, passed to HSMSC_Open(). pu8Buf holds two chunk buffers of
+  *             u32ChunkSize bytes each and must be word aligned. Larger chunks mean fewer block
+  *             device requests; 8 KB to 32 KB suits SD cards.
+  */
+typedef struct
+{
+    HSMSC_DISK_T *psDisk;           /*!< Block device, must stay valid */
+    uint8_t  *pu8Buf;               /*!< Two chunk buffers, 2 * u32ChunkSize bytes */
+    uint32_t u32ChunkSize;          /*!< Bytes per chunk, a multiple of 512 */
+    uint32_t u32BulkInEp;           /*!< HSUSBD endpoint of bulk IN, EPA ~ EPL */
+    uint32_t u32BulkInEpNum;        /*!< USB endpoint number of bulk IN */
+    uint32_t u32BulkInBufBase;      /*!< Endpoint buffer offset of bulk IN */
+    uint32_t u32BulkOutEp;          /*!< HSUSBD endpoint of bulk OUT, EPA ~ EPL */
+    uint32_t u32BulkOutEpNum;       /*!< USB endpoint number of bulk OUT */
+    uint32_t u32BulkOutBufBase;     /*!< Endpoint buffer offset of bulk OUT */
+    uint32_t u32BulkBufLen;         /*!< Endpoint buffer length of each bulk endpoint, 1024 double buffers high speed packets */
+    void     (*pfnIdle)(void);      /*!< Called over and over while a command waits for the block device or the USB DMA,
+                                         e.g. to run work queue items. NULL for none. Must not call HSMSC functions. */
+} HSMSC_CFG_T;
+
+/**
+  * @details    Transfer counters since HSMSC_Open() or HSMSC_ClearStats(). Times are measured with the
+  *             DWT cycle counter and cover the data phase of READ and WRITE commands.
+  */
+typedef struct
+{
+    uint32_t u32ReadCmds;           /*!< READ(10)/READ(12) commands */
+    uint32_t u32WriteCmds;          /*!< WRITE(10)/WRITE(12) commands */
+    uint32_t u32ReadBytes;          /*!< Sector bytes sent to the host */
+    uint32_t u32WriteBytes;         /*!< Sector bytes received from the host */
+    uint32_t u32ReadUs;             /*!< Time spent in READ data phases in us */
+    uint32_t u32WriteUs;            /*!< Time spent in WRITE data phases in us */
+    uint32_t u32UsbWaitUs;          /*!< Part of the data phases spent waiting for the USB DMA */
+    uint32_t u32DiskWaitUs;         /*!< Part of the data phases spent waiting for the block device */
+    uint32_t u32ReadKBps;           /*!< u32ReadBytes / u32ReadUs in 1000 bytes per second, divide by 1000 for MB/s */
+    uint32_t u32WriteKBps;          /*!< u32WriteBytes / u32WriteUs in 1000 bytes per second */
+    uint32_t u32DiskErrors;         /*!< Failed block device requests */
+} HSMSC_STATS_T;
+
+/*@}*/ /* end of group HSMSC_EXPORTED_STRUCTS */
+
+
+/** @addtogroup HSMSC_EXPORTED_FUNCTIONS HSUSBD MSC Exported Functions
+  @{
+*/
+
+int32_t HSMSC_Open(const HSMSC_CFG_T *psCfg);
+void HSMSC_InitEndpoints(uint32_t u32HighSpeed);
+void HSMSC_ClassRequest(void);
+void HSMSC_EpHandler(uint32_t u32GIntSts);
+void HSMSC_DmaDoneHandler(void);
+void HSMSC_Process(void);
+void HSMSC_GetStats(HSMSC_STATS_T *psStats);
+void HSMSC_ClearStats(void);
+
+void HSMSC_RamDiskInit(HSMSC_DISK_T *psDisk, uint8_t *pu8Base, uint32_t u32Size);
+void HSMSC_FmcDiskInit(HSMSC_DISK_T *psDisk, uint32_t u32Base, uint32_t u32Size, uint32_t *pu32PageBuf);
+void HSMSC_SdhDiskInit(HSMSC_DISK_T *psDisk, SDH_T *sdh);
+void HSMSC_SpimDiskInit(HSMSC_DISK_T *psDisk, uint32_t u32Base, uint32_t u32Size, uint32_t u32RdCmd, uint32_t *pu32PageBuf);
+
+/*@}*/ /* end of group HSMSC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group HSMSC_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
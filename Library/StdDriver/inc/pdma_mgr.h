@@ -0,0 +1,125 @@
+/**************************************************************************//**
+ * @file     pdma_mgr.h
+ * @version  V1.00
+ * @brief    M480 series PDMA channel manager header file
+ *
+ * @details  Hands out PDMA channels so drivers that take a channel number (HSCDC, EADCACQ, ...)
+ *           no longer collide, and builds scatter-gather chains from lists of segments using
+ *           descriptors from a shared pool. A chain runs once, ending in a basic mode table, or
+ *           loops as a ring until PDMAMGR_Stop(). Callbacks are raised per half segment, per
+ *           segment and at the end of the chain or of each ring lap.
+ *
+ *           Call PDMAMGR_IRQHandler() from PDMA_IRQHandler(). It only clears the flags of the
+ *           channels it started, so drivers with their own PDMA handler can share the interrupt.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __PDMA_MGR_H__
+#define __PDMA_MGR_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup PDMAMGR_Driver PDMA Manager Driver
+  @{
+*/
+
+/** @addtogroup PDMAMGR_EXPORTED_CONSTANTS PDMA Manager Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration. Define before including pdma_mgr.h (or on the compiler command line) to override.       */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef PDMAMGR_DESC_NUM
+#define PDMAMGR_DESC_NUM        32      /*!< Descriptors in the shared pool, at most 255 \hideinitializer */
+#endif
+
+#define PDMAMGR_ALL_CH          0xFFFFUL    /*!< Channel mask: any channel \hideinitializer */
+#define PDMAMGR_TOUT_CH         0x0003UL    /*!< Channel mask: channels 0 and 1, the ones with a request time-out counter \hideinitializer */
+
+#define PDMAMGR_PRIO_NORMAL     0UL     /*!< Round robin arbitration, allocated from the highest free channel \hideinitializer */
+#define PDMAMGR_PRIO_HIGH       1UL     /*!< Fixed high priority, allocated from the lowest free channel \hideinitializer */
+
+#define PDMAMGR_FLAG_RING       0x01UL  /*!< The last table links back to the first, the chain runs until stopped \hideinitializer */
+#define PDMAMGR_FLAG_HALF       0x02UL  /*!< Split every segment in two and report PDMAMGR_EVT_HALF \hideinitializer */
+#define PDMAMGR_FLAG_SEG        0x04UL  /*!< Report PDMAMGR_EVT_SEG at the end of every segment \hideinitializer */
+
+#define PDMAMGR_EVT_HALF        0x01UL  /*!< First half of segment u32Seg transferred \hideinitializer */
+#define PDMAMGR_EVT_SEG         0x02UL  /*!< Segment u32Seg transferred \hideinitializer */
+#define PDMAMGR_EVT_DONE        0x04UL  /*!< Chain finished, or a ring lap completed \hideinitializer */
+#define PDMAMGR_EVT_ABORT       0x08UL  /*!< Bus error, the channel was stopped \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define PDMAMGR_OK              0L      /*!< Success \hideinitializer */
+#define PDMAMGR_ERR_PARAM       (-1L)   /*!< Invalid argument, or channel not allocated \hideinitializer */
+#define PDMAMGR_ERR_BUSY        (-2L)   /*!< No free channel in the mask, or the channel is running \hideinitializer */
+#define PDMAMGR_ERR_NO_DESC     (-3L)   /*!< Not enough free descriptors in the pool \hideinitializer */
+#define PDMAMGR_ERR_DESC        (-4L)   /*!< The pool lies more than 64 KB above PDMA->SCATBA \hideinitializer */
+
+/*@}*/ /* end of group PDMAMGR_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup PDMAMGR_EXPORTED_STRUCTS PDMA Manager Exported Structs
+  @{
+*/
+
+/**
+  * @brief      Channel callback, called from PDMAMGR_IRQHandler()
+  * @param[in]  pvArg       Argument given to PDMAMGR_Build()
+  * @param[in]  u32Ch       Channel
+  * @param[in]  u32Event    PDMAMGR_EVT_HALF, PDMAMGR_EVT_SEG, PDMAMGR_EVT_DONE or PDMAMGR_EVT_ABORT, or'ed
+  * @param[in]  u32Seg      Segment the event belongs to
+  */
+typedef void (*PDMAMGR_CB_FUNC)(void *pvArg, uint32_t u32Ch, uint32_t u32Event, uint32_t u32Seg);
+
+/**
+  * @details    One contiguous transfer of a chain.
+  */
+typedef struct
+{
+    uint32_t u32Src;                /*!< Source address */
+    uint32_t u32Dst;                /*!< Destination address */
+    uint32_t u32Len;                /*!< Length in bytes, a multiple of the width. Longer than 65536 transfers is split. */
+    uint32_t u32Width;              /*!< PDMA_WIDTH_8, PDMA_WIDTH_16 or PDMA_WIDTH_32 */
+    uint32_t u32Mode;               /*!< PDMA_SAR_INC or PDMA_SAR_FIX, or'ed with PDMA_DAR_INC or PDMA_DAR_FIX */
+} PDMAMGR_SEG_T;
+
+/*@}*/ /* end of group PDMAMGR_EXPORTED_STRUCTS */
+
+
+/** @addtogroup PDMAMGR_EXPORTED_FUNCTIONS PDMA Manager Exported Functions
+  @{
+*/
+
+int32_t PDMAMGR_Alloc(uint32_t u32ChMask, uint32_t u32Prio);
+void PDMAMGR_Free(uint32_t u32Ch);
+int32_t PDMAMGR_Build(uint32_t u32Ch, uint32_t u32Req, const PDMAMGR_SEG_T *psSeg, uint32_t u32Count,
+                      uint32_t u32Flags, PDMAMGR_CB_FUNC pfnCb, void *pvArg);
+int32_t PDMAMGR_Start(uint32_t u32Ch);
+void PDMAMGR_Stop(uint32_t u32Ch);
+uint32_t PDMAMGR_IsBusy(uint32_t u32Ch);
+uint32_t PDMAMGR_GetFreeDesc(void);
+void PDMAMGR_IRQHandler(void);
+
+/*@}*/ /* end of group PDMAMGR_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group PDMAMGR_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,202 @@
+/**************************************************************************//**
+ * @file     scapdu.h
+ * @version  V1.00
+ * @brief    M480 series asynchronous smartcard APDU engine header file
+ *
+ * @details  Queues command APDUs per smartcard interface and runs the T=0 or T=1 transmission from
+ *           the interface interrupts, so the interfaces work concurrently and no call waits for a
+ *           card. Each APDU completes through its callback. SCLIB_StartTransmission() blocks for
+ *           the whole exchange instead.
+ *
+ *           T=0: cases 1, 2S, 3S and 4S, with procedure bytes, NULL bytes, GET RESPONSE after 61xx
+ *           and the repeated command after 6Cxx done by the engine.
+ *
+ *           T=1: the command is chained in I-blocks of up to IFSC bytes and the response in I-blocks
+ *           of up to IFSD bytes, 254 by default, negotiated with S(IFS) when the card is attached.
+ *           While a block is on the line the next one is already built, so an acknowledging R-block
+ *           is answered at once; received INF bytes go straight into the response buffer and the
+ *           EDC is checked as they arrive. R-block retransmission, WTX, card IFS requests, ABORT and
+ *           RESYNCH are handled as ISO/IEC 7816-3 11.6 asks.
+ *
+ *           The engine has no hardware dependency: a port (SCAPDU_PORT_T) sends bytes and runs a
+ *           timer, and reports back through SCAPDU_OnRx() and the other event calls. The port on the
+ *           SC interfaces, taking a card over after SCLIB_Activate(), is SmartcardLib/Source/scapdu_sc.c
+ *           with SmartcardLib/Include/scapdu_sc.h; Tool/ScApduSim runs the engine against simulated
+ *           cards on the host.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __SCAPDU_H__
+#define __SCAPDU_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SCAPDU_Driver SC APDU Driver
+  @{
+*/
+
+/** @addtogroup SCAPDU_EXPORTED_CONSTANTS SC APDU Exported Constants
+  @{
+*/
+#ifndef SCAPDU_MAX_SLOTS
+#define SCAPDU_MAX_SLOTS        3UL     /*!< Interfaces, SC_INTERFACE_NUM on the M480 \hideinitializer */
+#endif
+
+#define SCAPDU_MAX_CMD          261UL   /*!< Longest command APDU, case 4S: header, Lc, 255 bytes, Le \hideinitializer */
+#define SCAPDU_MAX_RSP          258UL   /*!< Longest response APDU: 256 bytes, SW1 and SW2 \hideinitializer */
+#define SCAPDU_T1_IFSD          254UL   /*!< IFSD offered by SCAPDU_ParseAtr() \hideinitializer */
+#define SCAPDU_T1_IFS_DEFAULT   32UL    /*!< IFSC and IFSD until changed, ISO/IEC 7816-3 11.4.2 \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  SCAPDU_PARAM_T                                                                                         */
+/*---------------------------------------------------------------------------------------------------------*/
+#define SCAPDU_T0               0U      /*!< T=0 \hideinitializer */
+#define SCAPDU_T1               1U      /*!< T=1 \hideinitializer */
+#define SCAPDU_EDC_LRC          0U      /*!< T=1 epilogue: 1-byte LRC \hideinitializer */
+#define SCAPDU_EDC_CRC          1U      /*!< T=1 epilogue: 2-byte CRC \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  SCAPDU_REQ_T::u32Status                                                                                */
+/*---------------------------------------------------------------------------------------------------------*/
+#define SCAPDU_STS_OK           0UL     /*!< Response received, SW1 SW2 are its last two bytes \hideinitializer */
+#define SCAPDU_STS_OVERFLOW     1UL     /*!< Response longer than u32RspSize, cut short: the last bytes are lost \hideinitializer */
+#define SCAPDU_STS_REMOVED      2UL     /*!< Card removed or detached \hideinitializer */
+#define SCAPDU_STS_TIMEOUT      3UL     /*!< T=0: no character within the work waiting time \hideinitializer */
+#define SCAPDU_STS_PARITY       4UL     /*!< T=0: character error left after the hardware retries \hideinitializer */
+#define SCAPDU_STS_T0_ERROR     5UL     /*!< T=0: invalid procedure byte \hideinitializer */
+#define SCAPDU_STS_T1_ERROR     6UL     /*!< T=1: transmission failed, the blocks were resynchronized \hideinitializer */
+#define SCAPDU_STS_T1_ABORT     7UL     /*!< T=1: the card aborted the chain \hideinitializer */
+#define SCAPDU_STS_DEAD         8UL     /*!< T=1: RESYNCH failed, the card must be reset and attached again \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define SCAPDU_OK               0L      /*!< Success \hideinitializer */
+#define SCAPDU_ERR_PARAM        (-1L)   /*!< Invalid argument, ATR or APDU \hideinitializer */
+#define SCAPDU_ERR_STATE        (-2L)   /*!< Interface not attached, or the card is dead \hideinitializer */
+#define SCAPDU_ERR_BUSY         (-3L)   /*!< Request already queued \hideinitializer */
+
+/*@}*/ /* end of group SCAPDU_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup SCAPDU_EXPORTED_STRUCTS SC APDU Exported Structs
+  @{
+*/
+
+/**
+  * @details    Transmission parameters of a card, from SCAPDU_ParseAtr(). Times are in ETU of the
+  *             rate in use after PPS.
+  */
+typedef struct
+{
+    uint8_t  u8Protocol;            /*!< SCAPDU_T0 or SCAPDU_T1 */
+    uint8_t  u8Edc;                 /*!< T=1: SCAPDU_EDC_LRC or SCAPDU_EDC_CRC */
+    uint8_t  u8Ifsc;                /*!< T=1: longest INF the card receives, 1 ~ 254 */
+    uint8_t  u8Ifsd;                /*!< T=1: longest INF the engine receives, 1 ~ 254. Other than
+                                         SCAPDU_T1_IFS_DEFAULT, it is sent in S(IFS) on attach. */
+    uint32_t u32WaitEtu;            /*!< T=0: work waiting time; T=1: block waiting time */
+    uint32_t u32CharEtu;            /*!< T=1: character waiting time */
+} SCAPDU_PARAM_T;
+
+/**
+  * @details    Port of an interface. All calls are made with the interface interrupt masked or from
+  *             its handler.
+  */
+typedef struct
+{
+    /** Start sending u32Len bytes at pu8Buf, valid until SCAPDU_OnTxDone() */
+    void (*pfnSend)(uint32_t u32Slot, const uint8_t *pu8Buf, uint32_t u32Len);
+    /** Call SCAPDU_OnTimeout() u32Etu ETU from now, replacing the running timeout; 0 stops it */
+    void (*pfnTimer)(uint32_t u32Slot, uint32_t u32Etu);
+    /** Mask the interface interrupt and return a key for pfnUnlock */
+    uint32_t (*pfnLock)(uint32_t u32Slot);
+    /** Restore the interrupt mask */
+    void (*pfnUnlock)(uint32_t u32Slot, uint32_t u32Key);
+} SCAPDU_PORT_T;
+
+struct SCAPDU_REQ;
+
+/**
+  * @brief      APDU callback, from the interface interrupt
+  * @param[in]  pvArg       SCAPDU_REQ_T::pvArg
+  * @param[in]  psReq       The finished request, which may be submitted again from here. The next
+  *                         queued APDU is already running.
+  */
+typedef void (*SCAPDU_DONE_FUNC)(void *pvArg, struct SCAPDU_REQ *psReq);
+
+/**
+  * @details    An APDU. The structure and both buffers belong to the engine from SCAPDU_Submit()
+  *             until the callback, or until SCAPDU_IsQueued() returns 0.
+  */
+typedef struct SCAPDU_REQ
+{
+    const uint8_t *pu8Cmd;          /*!< Command APDU, short form (cases 1, 2S, 3S, 4S) */
+    uint32_t u32CmdLen;             /*!< 4 ~ SCAPDU_MAX_CMD */
+    uint8_t  *pu8Rsp;               /*!< Response APDU */
+    uint32_t u32RspSize;            /*!< Bytes at pu8Rsp, SCAPDU_MAX_RSP holds any response */
+    SCAPDU_DONE_FUNC pfnDone;       /*!< Callback, NULL for none */
+    void     *pvArg;                /*!< Passed to pfnDone */
+    uint32_t u32RspLen;             /*!< Result: response bytes at pu8Rsp */
+    uint32_t u32Status;             /*!< Result: SCAPDU_STS_xxx */
+    struct SCAPDU_REQ *psQNext;     /*!< Private: queue link */
+    volatile uint32_t u32Queued;    /*!< Private: 1 while in the queue */
+} SCAPDU_REQ_T;
+
+/**
+  * @details    Counters of an interface since SCAPDU_Attach().
+  */
+typedef struct
+{
+    uint32_t u32Apdus;              /*!< APDUs completed, any status */
+    uint32_t u32Failed;             /*!< APDUs completed with a status other than SCAPDU_STS_OK */
+    uint32_t u32TxBlocks;           /*!< T=1 blocks sent, retransmissions included */
+    uint32_t u32RxBlocks;           /*!< T=1 blocks received without error */
+    uint32_t u32Chained;            /*!< T=1 I-blocks with the more data bit, both ways */
+    uint32_t u32Retransmits;        /*!< T=1 R-blocks asking for, and blocks sent again after, an error */
+    uint32_t u32Wtx;                /*!< T=1 waiting time extensions; T=0 NULL bytes */
+    uint32_t u32Resynch;            /*!< T=1 successful RESYNCH exchanges */
+} SCAPDU_STATS_T;
+
+/*@}*/ /* end of group SCAPDU_EXPORTED_STRUCTS */
+
+
+/** @addtogroup SCAPDU_EXPORTED_FUNCTIONS SC APDU Exported Functions
+  @{
+*/
+
+int32_t SCAPDU_ParseAtr(const uint8_t *pu8Atr, uint32_t u32Len, SCAPDU_PARAM_T *psParam);
+void SCAPDU_Init(const SCAPDU_PORT_T *psPort);
+int32_t SCAPDU_Attach(uint32_t u32Slot, const SCAPDU_PARAM_T *psParam);
+void SCAPDU_Detach(uint32_t u32Slot);
+int32_t SCAPDU_Submit(uint32_t u32Slot, SCAPDU_REQ_T *psReq);
+uint32_t SCAPDU_IsQueued(const SCAPDU_REQ_T *psReq);
+uint32_t SCAPDU_IsIdle(uint32_t u32Slot);
+void SCAPDU_GetStats(uint32_t u32Slot, SCAPDU_STATS_T *psStats);
+
+/* Port events */
+void SCAPDU_OnTxDone(uint32_t u32Slot);
+void SCAPDU_OnRx(uint32_t u32Slot, const uint8_t *pu8Buf, uint32_t u32Len);
+void SCAPDU_OnTimeout(uint32_t u32Slot);
+void SCAPDU_OnError(uint32_t u32Slot);
+
+/*@}*/ /* end of group SCAPDU_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SCAPDU_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,189 @@
+/**************************************************************************//**
+ * @file     spectrum.h
+ * @version  V1.00
+ * @brief    M480 series streaming spectrum analyzer header file
+ *
+ * @details  Turns a continuous sample stream into averaged magnitude spectra and peak lists with the
+ *           CMSIS-DSP library. Samples written with SPECTRUM_Write() (e.g. the channel blocks
+ *           EADCACQ_Process() delivers) collect in a frame of u32FftLen samples. Every u32Hop new
+ *           samples the frame is windowed (arm_mult_f32() / arm_mult_q31()), transformed
+ *           (arm_rfft_fast_f32(), or arm_rfft_q31() on arm_cfft_q31()) and its magnitudes are added
+ *           to the average; the last u32FftLen - u32Hop samples stay as overlap for the next frame.
+ *           After u32Average frames the averaged spectrum and its strongest peaks go to the callback.
+ *
+ *           Magnitudes are amplitudes: a sine of amplitude A in the middle of a bin reads A with any
+ *           window. All buffers are carved from one arena given to SPECTRUM_Open(), which needs
+ *           SPECTRUM_ARENA_SIZE() bytes; nothing is allocated afterwards.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __SPECTRUM_H__
+#define __SPECTRUM_H__
+
+#include "arm_math.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SPECTRUM_Driver Spectrum Analyzer Driver
+  @{
+*/
+
+/** @addtogroup SPECTRUM_EXPORTED_CONSTANTS Spectrum Analyzer Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration. Define before including spectrum.h (or on the compiler command line) to override.       */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef SPECTRUM_MAX_PEAKS
+#define SPECTRUM_MAX_PEAKS      16UL    /*!< Most peaks reported per result \hideinitializer */
+#endif
+
+#define SPECTRUM_MIN_FFT        32UL    /*!< Shortest FFT \hideinitializer */
+#define SPECTRUM_MAX_FFT        4096UL  /*!< Longest FFT, the arm_rfft_fast_f32() limit \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Sample formats, SPECTRUM_CFG_T::u32Fmt (F32 and Q31 only) and SPECTRUM_Write()                         */
+/*---------------------------------------------------------------------------------------------------------*/
+#define SPECTRUM_F32            0UL     /*!< float32_t \hideinitializer */
+#define SPECTRUM_Q31            1UL     /*!< q31_t \hideinitializer */
+#define SPECTRUM_Q15            2UL     /*!< q15_t, input only \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Windows, SPECTRUM_CFG_T::u32Window                                                                     */
+/*---------------------------------------------------------------------------------------------------------*/
+#define SPECTRUM_WIN_RECT       0UL     /*!< Rectangular \hideinitializer */
+#define SPECTRUM_WIN_HANN       1UL     /*!< Hann \hideinitializer */
+#define SPECTRUM_WIN_HAMMING    2UL     /*!< Hamming \hideinitializer */
+#define SPECTRUM_WIN_BLACKMAN   3UL     /*!< Blackman \hideinitializer */
+#define SPECTRUM_WIN_FLATTOP    4UL     /*!< Flat top, for amplitude accuracy between bins \hideinitializer */
+
+/**
+  * @details    Arena bytes SPECTRUM_Open() needs for an u32Fft point transform in format u32Fmt
+  *             reporting up to u32Peaks peaks: window, frame, FFT input and output, magnitudes,
+  *             average and peak list.
+  * \hideinitializer
+  */
+#define SPECTRUM_ARENA_SIZE(u32Fft, u32Fmt, u32Peaks) \
+    (4UL * ((u32Fft) * (((u32Fmt) == SPECTRUM_Q31) ? 5UL : 4UL) + 2UL * ((u32Fft) / 2UL + 1UL)) + \
+     (u32Peaks) * sizeof(SPECTRUM_PEAK_T))
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define SPECTRUM_OK             0L      /*!< Success \hideinitializer */
+#define SPECTRUM_ERR_PARAM      (-1L)   /*!< Invalid configuration \hideinitializer */
+#define SPECTRUM_ERR_MEM        (-2L)   /*!< Arena too small or not word aligned \hideinitializer */
+
+/*@}*/ /* end of group SPECTRUM_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup SPECTRUM_EXPORTED_STRUCTS Spectrum Analyzer Exported Structs
+  @{
+*/
+
+/**
+  * @details    A spectral peak: a local maximum of the averaged magnitudes, refined by parabolic
+  *             interpolation between the neighbouring bins.
+  */
+typedef struct
+{
+    uint32_t  u32Bin;               /*!< Bin of the local maximum */
+    float32_t f32Freq;              /*!< Interpolated frequency, Hz */
+    float32_t f32Mag;               /*!< Interpolated amplitude */
+} SPECTRUM_PEAK_T;
+
+/**
+  * @details    One averaged spectrum, valid during the callback only.
+  */
+typedef struct
+{
+    const void *pvMag;              /*!< u32Bins amplitudes, float32_t or q31_t as SPECTRUM_CFG_T::u32Fmt */
+    uint32_t u32Bins;               /*!< u32FftLen / 2 + 1, DC to Nyquist */
+    const SPECTRUM_PEAK_T *psPeaks; /*!< Strongest first */
+    uint32_t u32Peaks;              /*!< Peaks in psPeaks */
+    uint32_t u32Seq;                /*!< Result number since SPECTRUM_Open() */
+} SPECTRUM_RESULT_T;
+
+/**
+  * @brief      Result callback
+  * @param[in]  pvArg       SPECTRUM_CFG_T::pvArg
+  * @param[in]  psResult    The averaged spectrum
+  */
+typedef void (*SPECTRUM_RESULT_FUNC)(void *pvArg, const SPECTRUM_RESULT_T *psResult);
+
+/**
+  * @details    Analyzer configuration, passed to SPECTRUM_Open().
+  */
+typedef struct
+{
+    uint32_t  u32Fmt;               /*!< Processing format, SPECTRUM_F32 or SPECTRUM_Q31 */
+    uint32_t  u32FftLen;            /*!< Frame length, a power of two SPECTRUM_MIN_FFT ~ SPECTRUM_MAX_FFT */
+    uint32_t  u32Hop;               /*!< New samples per frame, 1 ~ u32FftLen. u32FftLen / 2: 50 % overlap */
+    uint32_t  u32Window;            /*!< SPECTRUM_WIN_* */
+    uint32_t  u32Average;           /*!< Frames averaged per result, at least 1 */
+    uint32_t  u32MaxPeaks;          /*!< Peaks reported per result, 0 ~ SPECTRUM_MAX_PEAKS */
+    float32_t f32Threshold;         /*!< Peaks of lower amplitude are not reported */
+    float32_t f32SampleRate;        /*!< Hz, for SPECTRUM_PEAK_T::f32Freq */
+    SPECTRUM_RESULT_FUNC pfnResult; /*!< Called by SPECTRUM_Write() for each averaged spectrum */
+    void      *pvArg;               /*!< Passed to pfnResult */
+} SPECTRUM_CFG_T;
+
+/**
+  * @details    Analyzer instance. The members are private; one per sample stream.
+  */
+typedef struct
+{
+    SPECTRUM_CFG_T sCfg;
+    union
+    {
+        arm_rfft_fast_instance_f32 sF32;
+        arm_rfft_instance_q31 sQ31;
+    } uFft;
+    void      *pvWin;               /* u32FftLen window coefficients */
+    void      *pvFrame;             /* u32FftLen samples, the oldest first */
+    void      *pvIn;                /* u32FftLen windowed samples, overwritten by the FFT */
+    void      *pvOut;               /* FFT output, u32FftLen (F32) or 2 x u32FftLen (Q31) */
+    void      *pvMag;               /* u32Bins magnitudes of the last frame */
+    void      *pvAvg;               /* u32Bins running average */
+    SPECTRUM_PEAK_T *psPeaks;       /* u32MaxPeaks */
+    uint32_t  u32Bins;
+    uint32_t  u32Fill;              /* Samples in pvFrame */
+    uint32_t  u32Frames;            /* Frames in pvAvg */
+    uint32_t  u32Seq;
+    float32_t f32Scale;             /* Magnitude to averaged amplitude */
+    q31_t     q31Scale;             /* f32Scale as fraction and shift, Q31 */
+    int8_t    i8Shift;
+} SPECTRUM_T;
+
+/*@}*/ /* end of group SPECTRUM_EXPORTED_STRUCTS */
+
+
+/** @addtogroup SPECTRUM_EXPORTED_FUNCTIONS Spectrum Analyzer Exported Functions
+  @{
+*/
+
+int32_t SPECTRUM_Open(SPECTRUM_T *psSpec, const SPECTRUM_CFG_T *psCfg, void *pvArena, uint32_t u32ArenaSize);
+void SPECTRUM_Reset(SPECTRUM_T *psSpec);
+uint32_t SPECTRUM_Write(SPECTRUM_T *psSpec, const void *pvSrc, uint32_t u32Len, uint32_t u32SrcFmt);
+
+/*@}*/ /* end of group SPECTRUM_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SPECTRUM_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
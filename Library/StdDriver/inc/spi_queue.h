@@ -0,0 +1,174 @@
+/**************************************************************************//**
+ * @file     spi_queue.h
+ * @version  V1.00
+ * @brief    M480 series SPI/QSPI PDMA transaction queue header file
+ *
+ * @details  Runs queued transactions of several devices on one SPI or QSPI master back to back
+ *           through PDMA. Each device has its own mode, data width, bus clock and chip select
+ *           (a GPIO pin, or the controller's SS line). The clock divider and control bits of a
+ *           device are computed once when it is attached, so switching devices between two
+ *           transactions costs two register writes.
+ *
+ *           A transaction is one PDMA transfer with the chip select held. Transactions linked
+ *           through psNext are submitted together, so a complete command sequence (for example
+ *           command, address and quad data phases of a flash read, or the register reads of a
+ *           sensor poll) is prepared once and started with one SPIQ_Submit() call.
+ *
+ *           Up to 8 queued transactions of one device that keep the chip select into the next
+ *           one, and use a single data line, run as one scatter-gather chain per PDMA channel
+ *           without CPU work between them. Any other transaction, e.g. a dual or quad phase or
+ *           one after a device switch, is started from the PDMA interrupt as the previous one
+ *           ends, which leaves the interrupt latency as a gap on the bus.
+ *
+ *           Call SPIQ_PdmaHandler() for every open bus and PDMAMGR_IRQHandler() from
+ *           PDMA_IRQHandler(). The PDMA channels are taken from the PDMA manager (pdma_mgr.h);
+ *           they keep the descriptor tables of the last chain until SPIQ_Close().
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __SPI_QUEUE_H__
+#define __SPI_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SPIQ_Driver SPI Queue Driver
+  @{
+*/
+
+/** @addtogroup SPIQ_EXPORTED_CONSTANTS SPI Queue Exported Constants
+  @{
+*/
+#define SPIQ_BUS_QSPI0          0UL     /*!< QSPI0 \hideinitializer */
+#define SPIQ_BUS_SPI0           1UL     /*!< SPI0 \hideinitializer */
+#define SPIQ_BUS_SPI1           2UL     /*!< SPI1 \hideinitializer */
+#define SPIQ_BUS_SPI2           3UL     /*!< SPI2 \hideinitializer */
+#define SPIQ_BUS_SPI3           4UL     /*!< SPI3 \hideinitializer */
+
+#define SPIQ_CS_ACTIVE_LOW      0UL     /*!< Chip select asserted low \hideinitializer */
+#define SPIQ_CS_ACTIVE_HIGH     1UL     /*!< Chip select asserted high \hideinitializer */
+
+#define SPIQ_XFER_CS_KEEP       0x01UL  /*!< Keep the chip select asserted into the next transaction \hideinitializer */
+#define SPIQ_XFER_DUAL_OUT      0x02UL  /*!< QSPI only: transmit on 2 data lines, pvRx is ignored \hideinitializer */
+#define SPIQ_XFER_DUAL_IN       0x04UL  /*!< QSPI only: receive on 2 data lines, pvTx is ignored \hideinitializer */
+#define SPIQ_XFER_QUAD_OUT      0x08UL  /*!< QSPI only: transmit on 4 data lines, pvRx is ignored \hideinitializer */
+#define SPIQ_XFER_QUAD_IN       0x10UL  /*!< QSPI only: receive on 4 data lines, pvTx is ignored \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define SPIQ_OK                 0L      /*!< Success \hideinitializer */
+#define SPIQ_ERR_PARAM          (-1L)   /*!< Invalid argument \hideinitializer */
+#define SPIQ_ERR_BUSY           (-2L)   /*!< Transaction already queued, or bus not idle \hideinitializer */
+#define SPIQ_ERR_PDMA           (-3L)   /*!< No free PDMA channel \hideinitializer */
+
+/*@}*/ /* end of group SPIQ_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup SPIQ_EXPORTED_STRUCTS SPI Queue Exported Structs
+  @{
+*/
+
+/**
+  * @details    A device on a bus. Fill in the first fields and call SPIQ_AttachDevice().
+  */
+typedef struct
+{
+    uint32_t u32Mode;               /*!< SPI_MODE_0 ~ SPI_MODE_3 */
+    uint32_t u32DataWidth;          /*!< 8, 16 or 32 bits per frame */
+    uint32_t u32BusClock;           /*!< Wanted bus clock in Hz */
+    volatile uint32_t *pu32CsPin;   /*!< GPIO pin data register, e.g. &PA3, or NULL for the controller's SS line */
+    uint32_t u32CsActive;           /*!< SPIQ_CS_ACTIVE_LOW or SPIQ_CS_ACTIVE_HIGH */
+    uint32_t u32Ctl;                /*!< Set by SPIQ_AttachDevice(): control register bits */
+    uint32_t u32ClkDiv;             /*!< Set by SPIQ_AttachDevice(): clock divider */
+} SPIQ_DEV_T;
+
+struct SPIQ_XFER;
+
+/**
+  * @brief      Transaction callback, called from SPIQ_PdmaHandler()
+  * @param[in]  pvArg       SPIQ_XFER_T::pvArg
+  * @param[in]  psXfer      The finished transaction, which may be submitted again from here
+  */
+typedef void (*SPIQ_DONE_FUNC)(void *pvArg, struct SPIQ_XFER *psXfer);
+
+/**
+  * @details    A transaction. The structure and both buffers belong to the queue from
+  *             SPIQ_Submit() until the callback, or until SPIQ_IsQueued() returns 0.
+  */
+typedef struct SPIQ_XFER
+{
+    SPIQ_DEV_T *psDev;              /*!< Target device */
+    const void *pvTx;               /*!< Data to send, NULL sends SPIQ_BUS_T::u32Dummy */
+    void     *pvRx;                 /*!< Received data, NULL discards it */
+    uint32_t u32Len;                /*!< Length in bytes, a multiple of the frame size, at most 65536 frames */
+    uint32_t u32Flags;              /*!< SPIQ_XFER_xxx, or'ed, or 0 */
+    SPIQ_DONE_FUNC pfnDone;         /*!< Callback, NULL for none */
+    void     *pvArg;                /*!< Passed to pfnDone */
+    struct SPIQ_XFER *psNext;       /*!< Next transaction of the sequence, NULL ends it */
+    struct SPIQ_XFER *psQNext;      /*!< Private: queue link */
+    volatile uint32_t u32Queued;    /*!< Private: 1 while in the queue */
+} SPIQ_XFER_T;
+
+/**
+  * @details    Bus state, one per controller, owned by the driver. u32Dummy may be changed while the bus
+  *             is idle.
+  */
+typedef struct
+{
+    QSPI_T   *psRegs;               /*!< Controller; SPI_T has the same layout for the used registers */
+    uint32_t u32TxCh;               /*!< PDMA channel feeding TX */
+    uint32_t u32RxCh;               /*!< PDMA channel draining RX */
+    uint32_t u32Dummy;              /*!< Frame sent when pvTx is NULL, 0xFFFFFFFF by default */
+    uint32_t u32Sink;               /*!< Receives discarded frames */
+    SPIQ_XFER_T *psHead;            /*!< Running transaction, NULL: idle */
+    SPIQ_XFER_T *psTail;            /*!< Last queued transaction */
+    SPIQ_DEV_T *psCsDev;            /*!< Device whose chip select is asserted */
+    uint32_t u32Ctl;                /*!< Control bits of the last transaction */
+    uint32_t u32ClkDiv;             /*!< Clock divider of the last transaction */
+    uint32_t u32DoneCh;             /*!< Channel whose completion ends the running transaction */
+    uint32_t u32Qspi;               /*!< 1 for QSPI0 */
+    uint32_t u32Xfers;              /*!< Transactions completed */
+    uint32_t u32Bytes;              /*!< Bytes transferred */
+    uint32_t u32Switches;           /*!< Clock or mode changes between transactions */
+    uint32_t u32Chained;            /*!< Transactions run as part of a PDMA chain */
+    uint32_t u32TxReq;              /*!< PDMA request of TX, RX is the next one */
+    uint32_t u32Chain;              /*!< Transactions of the running chain, 0: none */
+    volatile uint32_t u32ChainPend; /*!< Channels of the running chain not yet done */
+} SPIQ_BUS_T;
+
+/*@}*/ /* end of group SPIQ_EXPORTED_STRUCTS */
+
+
+/** @addtogroup SPIQ_EXPORTED_FUNCTIONS SPI Queue Exported Functions
+  @{
+*/
+
+int32_t SPIQ_Open(SPIQ_BUS_T *psBus, uint32_t u32Bus);
+void SPIQ_Close(SPIQ_BUS_T *psBus);
+int32_t SPIQ_AttachDevice(SPIQ_BUS_T *psBus, SPIQ_DEV_T *psDev);
+int32_t SPIQ_Submit(SPIQ_BUS_T *psBus, SPIQ_XFER_T *psXfer);
+uint32_t SPIQ_IsQueued(const SPIQ_XFER_T *psXfer);
+uint32_t SPIQ_IsIdle(const SPIQ_BUS_T *psBus);
+void SPIQ_PdmaHandler(SPIQ_BUS_T *psBus);
+
+/*@}*/ /* end of group SPIQ_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SPIQ_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,164 @@
+/**************************************************************************//**
+ * @file     trace.h
+ * @version  V1.00
+ * @brief    M480 series cycle counter trace point header file
+ *
+ * @details  Trace points compile to nothing unless TRACE_ENABLE is defined to 1
+ *           (globally, on the compiler command line), so they can stay in driver
+ *           and middleware hot paths. Records are time stamped with DWT CYCCNT
+ *           and written to a RAM ring buffer and/or an ITM stimulus port. Use
+ *           Tool/TraceDecoder to turn a capture into latency histograms and
+ *           Chrome trace JSON.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup TRACE_Driver TRACE Driver
+  @{
+*/
+
+/** @addtogroup TRACE_EXPORTED_CONSTANTS TRACE Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration                                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE            0       /*!< 1: trace points are compiled in \hideinitializer */
+#endif
+
+#ifndef TRACE_RAM_ENTRIES
+#define TRACE_RAM_ENTRIES       1024    /*!< Records in the RAM ring buffer, must be a power of 2 \hideinitializer */
+#endif
+
+#ifndef TRACE_ITM_PORT
+#define TRACE_ITM_PORT          1       /*!< ITM stimulus port used by the ITM backend \hideinitializer */
+#endif
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Backends, may be combined                                                                              */
+/*---------------------------------------------------------------------------------------------------------*/
+#define TRACE_BACKEND_RAM       0x1UL   /*!< Store records in g_sTraceBuf \hideinitializer */
+#define TRACE_BACKEND_ITM       0x2UL   /*!< Send records to ITM stimulus port TRACE_ITM_PORT \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Record format. Word 0 is DWT CYCCNT, word 1 is (arg << 16) | (type << 8) | id                          */
+/*---------------------------------------------------------------------------------------------------------*/
+#define TRACE_TYPE_BEGIN        0UL     /*!< Start of a span \hideinitializer */
+#define TRACE_TYPE_END          1UL     /*!< End of the most recent span with the same id \hideinitializer */
+#define TRACE_TYPE_EVENT        2UL     /*!< Instant event \hideinitializer */
+
+#define TRACE_MAGIC             0x31435254UL    /*!< "TRC1", first word of g_sTraceBuf \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Trace point ids used by the BSP                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+#define TRACE_ID_EMAC_RX        1UL     /*!< EMAC RX interrupt, arg: INTSTS \hideinitializer */
+#define TRACE_ID_EMAC_TX        2UL     /*!< EMAC TX interrupt, arg: INTSTS >> 16 \hideinitializer */
+#define TRACE_ID_SDH_READ       3UL     /*!< SDH_Read(), begin arg: sectors, end arg: result \hideinitializer */
+#define TRACE_ID_SDH_WRITE      4UL     /*!< SDH_Write(), begin arg: sectors, end arg: result \hideinitializer */
+#define TRACE_ID_USBH_UTR       5UL     /*!< USB host transfer callback, begin arg: bytes transferred, end arg: 0 (the UTR may be freed) \hideinitializer */
+#define TRACE_ID_CRPT_AES       6UL     /*!< AES job, begin before AES_Start() and end in the ISR, both in the application \hideinitializer */
+#define TRACE_ID_CRPT_TDES      7UL     /*!< TDES job, begin before TDES_Start() and end in the ISR, both in the application \hideinitializer */
+#define TRACE_ID_CRPT_SHA       8UL     /*!< SHA/HMAC job, begin before SHA_Start() and end in the ISR, both in the application \hideinitializer */
+#define TRACE_ID_CRPT_ECC       9UL     /*!< ECC engine operation \hideinitializer */
+#define TRACE_ID_DISK_READ      10UL    /*!< FatFs disk_read(), begin arg: sectors \hideinitializer */
+#define TRACE_ID_MAD_FRAME      11UL    /*!< LibMAD mad_frame_decode(), end arg: 0 or error \hideinitializer */
+#define TRACE_ID_USER           32UL    /*!< First id free for the application, up to 255 \hideinitializer */
+
+/*@}*/ /* end of group TRACE_EXPORTED_CONSTANTS */
+
+
+#if TRACE_ENABLE
+
+#include <stdint.h>
+
+/** @addtogroup TRACE_EXPORTED_STRUCTS TRACE Exported Structs
+  @{
+*/
+
+/**
+  * @details    RAM backend buffer. Dump sizeof(g_sTraceBuf) bytes from the debugger to decode it.
+  */
+typedef struct
+{
+    uint32_t u32Magic;                          /*!< TRACE_MAGIC */
+    uint32_t u32Entries;                        /*!< TRACE_RAM_ENTRIES */
+    uint32_t u32CoreClock;                      /*!< CPU clock in Hz when TRACE_Init() was called */
+    volatile uint32_t u32Head;                  /*!< Records written since TRACE_Init(), wraps at 2^32 */
+    uint32_t au32Rec[TRACE_RAM_ENTRIES][2];     /*!< Records, oldest at u32Head % u32Entries once wrapped */
+} TRACE_BUF_T;
+
+/*@}*/ /* end of group TRACE_EXPORTED_STRUCTS */
+
+/** @addtogroup TRACE_EXPORTED_FUNCTIONS TRACE Exported Functions
+  @{
+*/
+
+extern TRACE_BUF_T g_sTraceBuf;
+
+void TRACE_Init(uint32_t u32Backend);
+void TRACE_Start(void);
+void TRACE_Stop(void);
+void TRACE_Record(uint32_t u32Desc);
+
+/**
+  * @brief      Mark the start of a span
+  * @param[in]  id      Trace point id, 1 ~ 255.
+  * @param[in]  arg     16-bit argument recorded with the point.
+  * @return     None
+  * \hideinitializer
+  */
+#define TRACE_BEGIN(id, arg)    TRACE_Record(((uint32_t)(arg) << 16) | (TRACE_TYPE_BEGIN << 8) | (uint32_t)(id))
+
+/**
+  * @brief      Mark the end of the most recent span with the same id
+  * @param[in]  id      Trace point id, 1 ~ 255.
+  * @param[in]  arg     16-bit argument recorded with the point.
+  * @return     None
+  * \hideinitializer
+  */
+#define TRACE_END(id, arg)      TRACE_Record(((uint32_t)(arg) << 16) | (TRACE_TYPE_END << 8) | (uint32_t)(id))
+
+/**
+  * @brief      Record an instant event
+  * @param[in]  id      Trace point id, 1 ~ 255.
+  * @param[in]  arg     16-bit argument recorded with the point.
+  * @return     None
+  * \hideinitializer
+  */
+#define TRACE_EVENT(id, arg)    TRACE_Record(((uint32_t)(arg) << 16) | (TRACE_TYPE_EVENT << 8) | (uint32_t)(id))
+
+/*@}*/ /* end of group TRACE_EXPORTED_FUNCTIONS */
+
+#else
+
+#define TRACE_BEGIN(id, arg)    ((void)0)
+#define TRACE_END(id, arg)      ((void)0)
+#define TRACE_EVENT(id, arg)    ((void)0)
+
+#endif /* TRACE_ENABLE */
+
+/*@}*/ /* end of group TRACE_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
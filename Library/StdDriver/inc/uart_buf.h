@@ -0,0 +1,194 @@
+/**************************************************************************//**
+ * @file     uart_buf.h
+ * @version  V1.00
+ * @brief    M480 series buffered UART and USCI UART driver header file
+ *
+ * @details  Receives through PDMA into a circular buffer that runs for as long as the port is
+ *           open, so no byte depends on the CPU reaching an interrupt in time. An idle line of
+ *           u32IdleBits bit times ends a frame: on UART0 ~ UART5 the receive time-out interrupt
+ *           reports it, on USCI0 and USCI1, which have no receive time-out, the PDMA request
+ *           time-out of channel 0 or 1 does. Received data and frames are handed out as spans
+ *           pointing into the circular buffer and are released with UARTB_RxConsume(); nothing
+ *           is copied.
+ *
+ *           Transmit buffers are queued and sent back to back by PDMA. Each buffer belongs to
+ *           the driver from UARTB_Send() until its callback.
+ *
+ *           Call UARTB_IRQHandler() from the UART or USCI interrupt handler of the port and
+ *           UARTB_PdmaHandler() from PDMA_IRQHandler(). The PDMA channels are taken from the
+ *           PDMA manager (pdma_mgr.h).
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __UART_BUF_H__
+#define __UART_BUF_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup UARTB_Driver Buffered UART Driver
+  @{
+*/
+
+/** @addtogroup UARTB_EXPORTED_CONSTANTS Buffered UART Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration. Define before including uart_buf.h (or on the compiler command line) to override.       */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef UARTB_MAX_FRAMES
+#define UARTB_MAX_FRAMES        16      /*!< Frame ends remembered per port, a power of two \hideinitializer */
+#endif
+
+#define UARTB_PORT_UART0        0UL     /*!< UART0 \hideinitializer */
+#define UARTB_PORT_UART1        1UL     /*!< UART1 \hideinitializer */
+#define UARTB_PORT_UART2        2UL     /*!< UART2 \hideinitializer */
+#define UARTB_PORT_UART3        3UL     /*!< UART3 \hideinitializer */
+#define UARTB_PORT_UART4        4UL     /*!< UART4 \hideinitializer */
+#define UARTB_PORT_UART5        5UL     /*!< UART5 \hideinitializer */
+#define UARTB_PORT_USCI0        6UL     /*!< USCI0 in UART mode \hideinitializer */
+#define UARTB_PORT_USCI1        7UL     /*!< USCI1 in UART mode \hideinitializer */
+
+#define UARTB_EVT_FRAME         0x01UL  /*!< A frame ended with an idle line \hideinitializer */
+#define UARTB_EVT_DATA          0x02UL  /*!< Half of the receive buffer was filled \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define UARTB_OK                0L      /*!< Success \hideinitializer */
+#define UARTB_ERR_PARAM         (-1L)   /*!< Invalid argument \hideinitializer */
+#define UARTB_ERR_BUSY          (-2L)   /*!< Transmit buffer already queued \hideinitializer */
+#define UARTB_ERR_PDMA          (-3L)   /*!< No suitable free PDMA channel \hideinitializer */
+#define UARTB_ERR_DESC          (-4L)   /*!< The port state lies more than 64 KB above PDMA->SCATBA \hideinitializer */
+#define UARTB_ERR_OVERRUN       (-5L)   /*!< Received data was overwritten before it was consumed \hideinitializer */
+
+/*@}*/ /* end of group UARTB_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup UARTB_EXPORTED_STRUCTS Buffered UART Exported Structs
+  @{
+*/
+
+/**
+  * @brief      Receive event callback, called from UARTB_IRQHandler() or UARTB_PdmaHandler()
+  * @param[in]  pvArg       Argument given to UARTB_Open()
+  * @param[in]  u32Event    UARTB_EVT_FRAME or UARTB_EVT_DATA
+  */
+typedef void (*UARTB_RX_FUNC)(void *pvArg, uint32_t u32Event);
+
+struct UARTB_TX;
+
+/**
+  * @brief      Transmit callback, called from UARTB_PdmaHandler()
+  * @param[in]  pvArg   UARTB_TX_T::pvArg
+  * @param[in]  psTx    The sent buffer, which may be queued again from here
+  * @details    The last bytes may still be in the transmit FIFO.
+  */
+typedef void (*UARTB_TX_FUNC)(void *pvArg, struct UARTB_TX *psTx);
+
+/**
+  * @details    A transmit buffer.
+  */
+typedef struct UARTB_TX
+{
+    const uint8_t *pu8Data;         /*!< Data to send */
+    uint32_t u32Len;                /*!< Length in bytes, at least 1 */
+    UARTB_TX_FUNC pfnDone;          /*!< Callback, NULL for none */
+    void     *pvArg;                /*!< Passed to pfnDone */
+    struct UARTB_TX *psQNext;       /*!< Private: queue link */
+    volatile uint32_t u32Queued;    /*!< Private: 1 while in the queue */
+} UARTB_TX_T;
+
+/**
+  * @details    Received bytes in the circular buffer. When they wrap around its end, the rest
+  *             follows at pu8Wrap.
+  */
+typedef struct
+{
+    const uint8_t *pu8Data;         /*!< First part */
+    uint32_t u32Len;                /*!< Length of the first part */
+    const uint8_t *pu8Wrap;         /*!< Second part at the start of the buffer, NULL if none */
+    uint32_t u32WrapLen;            /*!< Length of the second part */
+} UARTB_SPAN_T;
+
+/**
+  * @details    Port counters, cleared by UARTB_Open().
+  */
+typedef struct
+{
+    uint32_t u32RxBytes;            /*!< Bytes consumed */
+    uint32_t u32Frames;             /*!< Frame ends seen */
+    uint32_t u32FrameMerges;        /*!< Frame ends lost because UARTB_MAX_FRAMES were pending */
+    uint32_t u32Overruns;           /*!< Times received data was overwritten in the circular buffer */
+    uint32_t u32FifoOverruns;       /*!< Receive FIFO overruns */
+    uint32_t u32LineErrors;         /*!< Parity, framing and break errors */
+    uint32_t u32TxBytes;            /*!< Bytes sent */
+    uint32_t u32TxBufs;             /*!< Transmit buffers completed */
+} UARTB_STATS_T;
+
+/**
+  * @details    Port state, owned by the driver. Read sStats freely.
+  */
+typedef struct
+{
+    UART_T   *psUart;               /*!< UART controller, NULL for USCI */
+    UUART_T  *psUuart;              /*!< USCI controller, NULL for UART */
+    uint32_t u32TxCh;               /*!< PDMA channel feeding TX */
+    uint32_t u32RxCh;               /*!< PDMA channel draining RX */
+    uint8_t  *pu8Ring;              /*!< Circular receive buffer */
+    uint32_t u32Size;               /*!< Its size in bytes */
+    DSCT_T   asDesc[2];             /*!< Descriptors of the two halves of the receive buffer */
+    volatile uint32_t u32RxBase;    /*!< Bytes received in completed halves, free running */
+    volatile uint32_t u32RxHead;    /*!< Bytes received, free running */
+    uint32_t u32RxTail;             /*!< Bytes consumed, free running */
+    uint32_t u32TailOff;            /*!< Offset of u32RxTail in the buffer */
+    volatile uint32_t au32Mark[UARTB_MAX_FRAMES];  /*!< Frame ends, free running */
+    volatile uint32_t u32MarkIn;    /*!< Frame ends seen */
+    uint32_t u32MarkOut;            /*!< Frame ends passed */
+    UARTB_RX_FUNC pfnRx;            /*!< Receive event callback */
+    void     *pvRxArg;              /*!< Passed to pfnRx */
+    UARTB_TX_T *psTxHead;           /*!< Buffer being sent, NULL: idle */
+    UARTB_TX_T *psTxTail;           /*!< Last queued buffer */
+    uint32_t u32TxOff;              /*!< Bytes of psTxHead given to PDMA before the running part */
+    uint32_t u32TxPart;             /*!< Bytes of the running part */
+    UARTB_STATS_T sStats;           /*!< Counters */
+} UARTB_T;
+
+/*@}*/ /* end of group UARTB_EXPORTED_STRUCTS */
+
+
+/** @addtogroup UARTB_EXPORTED_FUNCTIONS Buffered UART Exported Functions
+  @{
+*/
+
+int32_t UARTB_Open(UARTB_T *psPort, uint32_t u32Port, uint8_t *pu8Ring, uint32_t u32Size, uint32_t u32IdleBits,
+                   UARTB_RX_FUNC pfnRx, void *pvArg);
+void UARTB_Close(UARTB_T *psPort);
+uint32_t UARTB_RxPeek(UARTB_T *psPort, UARTB_SPAN_T *psSpan);
+uint32_t UARTB_RxPeekFrame(UARTB_T *psPort, UARTB_SPAN_T *psSpan);
+int32_t UARTB_RxConsume(UARTB_T *psPort, uint32_t u32Len);
+int32_t UARTB_Send(UARTB_T *psPort, UARTB_TX_T *psTx);
+uint32_t UARTB_IsTxIdle(const UARTB_T *psPort);
+void UARTB_IRQHandler(UARTB_T *psPort);
+void UARTB_PdmaHandler(UARTB_T *psPort);
+
+/*@}*/ /* end of group UARTB_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group UARTB_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,135 @@
+/**************************************************************************//**
+ * @file     workq.h
+ * @version  V1.00
+ * @brief    M480 series deferred interrupt work queue header file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __WORKQ_H__
+#define __WORKQ_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup WORKQ_Driver WORKQ Driver
+  @{
+*/
+
+/** @addtogroup WORKQ_EXPORTED_CONSTANTS WORKQ Exported Constants
+  @{
+*/
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration. Define before including workq.h (or on the compiler command line) to override.          */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef WORKQ_USE_FREERTOS
+#define WORKQ_USE_FREERTOS      0       /*!< 1: drain the queues from FreeRTOS tasks. 0: drain from WORKQ_Poll() \hideinitializer */
+#endif
+
+#ifndef WORKQ_PRIO_NUM
+#define WORKQ_PRIO_NUM          3       /*!< Number of priority levels, level 0 is the most urgent \hideinitializer */
+#endif
+
+#ifndef WORKQ_RING_SIZE
+#define WORKQ_RING_SIZE         32      /*!< Work items per priority level, must be a power of 2 \hideinitializer */
+#endif
+
+#ifndef WORKQ_SRC_NUM
+#define WORKQ_SRC_NUM           8       /*!< Number of work sources that keep statistics \hideinitializer */
+#endif
+
+#ifndef WORKQ_HIST_BINS
+#define WORKQ_HIST_BINS         16      /*!< Latency histogram bins. Bin n counts latencies in [2^(n-1), 2^n) us \hideinitializer */
+#endif
+
+#if WORKQ_USE_FREERTOS
+#ifndef WORKQ_TASK_STACK
+#define WORKQ_TASK_STACK        256     /*!< Stack depth (in words) of each handler task \hideinitializer */
+#endif
+
+#ifndef WORKQ_TASK_PRIO
+#define WORKQ_TASK_PRIO(level)  (configMAX_PRIORITIES - 1 - (level))    /*!< FreeRTOS priority of the task draining a level \hideinitializer */
+#endif
+#endif
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Priority levels                                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+#define WORKQ_PRIO_HIGH         0UL                     /*!< Most urgent level, e.g. audio streaming \hideinitializer */
+#define WORKQ_PRIO_NORMAL       1UL                     /*!< Default level, e.g. network input \hideinitializer */
+#define WORKQ_PRIO_LOW          (WORKQ_PRIO_NUM - 1UL)  /*!< Least urgent level, e.g. card detect \hideinitializer */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Return codes                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define WORKQ_OK                0L      /*!< Success \hideinitializer */
+#define WORKQ_ERR_PARAM         (-1L)   /*!< Invalid priority level or source \hideinitializer */
+#define WORKQ_ERR_FULL          (-2L)   /*!< Ring of the priority level is full, item dropped \hideinitializer */
+#define WORKQ_ERR_NO_SRC        (-3L)   /*!< No free source slot \hideinitializer */
+#define WORKQ_ERR_RTOS          (-4L)   /*!< Failed to create a handler task \hideinitializer */
+
+/*@}*/ /* end of group WORKQ_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup WORKQ_EXPORTED_STRUCTS WORKQ Exported Structs
+  @{
+*/
+
+/**
+  * @details    Work function. Runs in the handler task (or in WORKQ_Poll()) with interrupts enabled.
+  */
+typedef void (WORKQ_FUNC_T)(void *pvArg, uint32_t u32Param);
+
+/**
+  * @details    Statistics of one work source. Latency is measured from WORKQ_Post() to the start of the
+  *             work function, run time is the execution time of the work function.
+  */
+typedef struct
+{
+    const char *pcName;                         /*!< Name given to WORKQ_AddSource() */
+    uint32_t u32Posted;                         /*!< Items successfully posted */
+    uint32_t u32Dropped;                        /*!< Items dropped because the ring was full */
+    uint32_t u32MaxLatencyUs;                   /*!< Worst post-to-start latency */
+    uint32_t u32MaxRunUs;                       /*!< Worst work function run time */
+    uint32_t au32Hist[WORKQ_HIST_BINS];         /*!< Post-to-start latency histogram, log2 microsecond bins */
+} WORKQ_SRC_STATS_T;
+
+/*@}*/ /* end of group WORKQ_EXPORTED_STRUCTS */
+
+
+/** @addtogroup WORKQ_EXPORTED_FUNCTIONS WORKQ Exported Functions
+  @{
+*/
+
+int32_t WORKQ_Init(void);
+int32_t WORKQ_AddSource(const char *pcName);
+int32_t WORKQ_Post(uint32_t u32Prio, int32_t i32Src, WORKQ_FUNC_T *pfnFunc, void *pvArg, uint32_t u32Param);
+int32_t WORKQ_Flush(uint32_t u32Prio);
+uint32_t WORKQ_GetPending(uint32_t u32Prio);
+int32_t WORKQ_GetStats(int32_t i32Src, WORKQ_SRC_STATS_T *psStats);
+void WORKQ_ResetStats(void);
+#if WORKQ_USE_FREERTOS
+int32_t WORKQ_Start(void);
+#else
+uint32_t WORKQ_Poll(uint32_t u32MaxItems);
+#endif
+
+/*@}*/ /* end of group WORKQ_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group WORKQ_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
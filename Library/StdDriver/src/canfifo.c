@@ -0,0 +1,573 @@
+/**************************************************************************//**
+ * @file     canfifo.c
+ * @version  V1.00
+ * @brief    M480 series interrupt driven CAN FIFO engine source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "canfifo.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup CANFIFO_Driver CANFIFO Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define CANFIFO_IF              1UL             /* IF2 belongs to the engine */
+#define CANFIFO_INT_STATUS      0x8000UL        /* IIDR value of a status interrupt */
+
+typedef struct
+{
+    const CANFILT_PLAN_T *psPlan;   /* NULL while closed */
+    CANFIFO_FRAME_T *psRxRing;
+    uint32_t u32RxSize;
+    volatile uint32_t u32RxHead;    /* written by the handler only */
+    volatile uint32_t u32RxTail;    /* written by CANFIFO_Read() only */
+    CANFIFO_FRAME_T *psTxQueue;     /* binary heap, highest priority first */
+    uint32_t u32TxSize;
+    uint32_t u32TxCount;
+    uint32_t u32TxSeq;              /* keeps frames of equal priority in order */
+    uint32_t u32TxObjMask;
+    uint32_t u32TxBusy;             /* transmit objects holding a frame */
+    CANFIFO_STATS_T sStats;
+} CANFIFO_STATE_T;
+
+#if defined(CAN1)
+static CANFIFO_STATE_T s_asState[2];
+#else
+static CANFIFO_STATE_T s_asState[1];
+#endif
+
+static uint32_t CANFIFO_Index(CAN_T *tCAN)
+{
+#if defined(CAN1)
+    return (tCAN == CAN1) ? 1UL : 0UL;
+#else
+    (void)tCAN;
+    return 0UL;
+#endif
+}
+
+static IRQn_Type CANFIFO_IRQn(CAN_T *tCAN)
+{
+#if defined(CAN1)
+    if (tCAN == CAN1)
+        return CAN1_IRQn;
+#endif
+    (void)tCAN;
+    return CAN0_IRQn;
+}
+
+/* Mask the CAN interrupt in the NVIC, return whether it was enabled */
+static uint32_t CANFIFO_Lock(CAN_T *tCAN)
+{
+    uint32_t u32IRQn = (uint32_t)CANFIFO_IRQn(tCAN);
+    uint32_t u32En = NVIC->ISER[u32IRQn >> 5] & (1UL << (u32IRQn & 0x1FUL));
+
+    NVIC_DisableIRQ((IRQn_Type)u32IRQn);
+    __DSB();
+    __ISB();
+    return u32En;
+}
+
+static void CANFIFO_Unlock(CAN_T *tCAN, uint32_t u32En)
+{
+    if (u32En)
+        NVIC_EnableIRQ(CANFIFO_IRQn(tCAN));
+}
+
+/* Transfer between IF2 and a message object. Takes a few CAN clocks, there is no other user to wait for. */
+static void CANFIFO_Command(CAN_T *tCAN, uint32_t u32Obj)
+{
+    tCAN->IF[CANFIFO_IF].CREQ = u32Obj + 1UL;
+    while (tCAN->IF[CANFIFO_IF].CREQ & CAN_IF_CREQ_BUSY_Msk)
+    {
+    }
+}
+
+/* Arbitration priority, lower wins: base identifier, then standard before extended, then data before remote */
+static uint32_t CANFIFO_Key(const CANFIFO_FRAME_T *psFrame)
+{
+    uint32_t u32Key;
+
+    if (psFrame->u8IdType == CAN_EXT_ID)
+        u32Key = ((psFrame->u32Id >> 18) << 19) | (1UL << 18) | (psFrame->u32Id & 0x3FFFFUL);
+    else
+        u32Key = (psFrame->u32Id & 0x7FFUL) << 19;
+
+    return (u32Key << 1) | (psFrame->u8FrameType == CAN_REMOTE_FRAME);
+}
+
+/* Frames in the queue keep their enqueue sequence in u32Stamp */
+static uint32_t CANFIFO_Before(const CANFIFO_FRAME_T *psA, const CANFIFO_FRAME_T *psB)
+{
+    uint32_t u32KeyA = CANFIFO_Key(psA), u32KeyB = CANFIFO_Key(psB);
+
+    if (u32KeyA != u32KeyB)
+        return u32KeyA < u32KeyB;
+    return (int32_t)(psA->u32Stamp - psB->u32Stamp) < 0;
+}
+
+static void CANFIFO_TxPush(CANFIFO_STATE_T *psState, const CANFIFO_FRAME_T *psFrame)
+{
+    CANFIFO_FRAME_T *psHeap = psState->psTxQueue, sTmp;
+    uint32_t i = psState->u32TxCount++, u32Parent;
+
+    psHeap[i] = *psFrame;
+    psHeap[i].u32Stamp = psState->u32TxSeq++;
+    while (i > 0UL)
+    {
+        u32Parent = (i - 1UL) >> 1;
+        if (!CANFIFO_Before(&psHeap[i], &psHeap[u32Parent]))
+            break;
+        sTmp = psHeap[i];
+        psHeap[i] = psHeap[u32Parent];
+        psHeap[u32Parent] = sTmp;
+        i = u32Parent;
+    }
+}
+
+static void CANFIFO_TxPop(CANFIFO_STATE_T *psState, CANFIFO_FRAME_T *psFrame)
+{
+    CANFIFO_FRAME_T *psHeap = psState->psTxQueue, sTmp;
+    uint32_t i = 0UL, u32Child, u32Count;
+
+    *psFrame = psHeap[0];
+    u32Count = --psState->u32TxCount;
+    psHeap[0] = psHeap[u32Count];
+    for (;;)
+    {
+        u32Child = 2UL * i + 1UL;
+        if (u32Child >= u32Count)
+            break;
+        if ((u32Child + 1UL < u32Count) && CANFIFO_Before(&psHeap[u32Child + 1UL], &psHeap[u32Child]))
+            u32Child++;
+        if (!CANFIFO_Before(&psHeap[u32Child], &psHeap[i]))
+            break;
+        sTmp = psHeap[i];
+        psHeap[i] = psHeap[u32Child];
+        psHeap[u32Child] = sTmp;
+        i = u32Child;
+    }
+}
+
+static void CANFIFO_WriteTx(CAN_T *tCAN, uint32_t u32Obj, const CANFIFO_FRAME_T *psFrame)
+{
+    volatile CAN_IF_T *psIF = &tCAN->IF[CANFIFO_IF];
+    uint32_t u32Dir = (psFrame->u8FrameType == CAN_REMOTE_FRAME) ? 0UL : CAN_IF_ARB2_DIR_Msk;
+
+    psIF->CMASK = CAN_IF_CMASK_WRRD_Msk | CAN_IF_CMASK_ARB_Msk | CAN_IF_CMASK_CONTROL_Msk |
+                  CAN_IF_CMASK_DATAA_Msk | CAN_IF_CMASK_DATAB_Msk;
+    if (psFrame->u8IdType == CAN_STD_ID)
+    {
+        psIF->ARB1 = 0UL;
+        psIF->ARB2 = ((psFrame->u32Id & 0x7FFUL) << 2) | u32Dir | CAN_IF_ARB2_MSGVAL_Msk;
+    }
+    else
+    {
+        psIF->ARB1 = psFrame->u32Id & 0xFFFFUL;
+        psIF->ARB2 = ((psFrame->u32Id & 0x1FFF0000UL) >> 16) | u32Dir | CAN_IF_ARB2_XTD_Msk | CAN_IF_ARB2_MSGVAL_Msk;
+    }
+    psIF->DAT_A1 = (uint32_t)psFrame->au8Data[0] | ((uint32_t)psFrame->au8Data[1] << 8);
+    psIF->DAT_A2 = (uint32_t)psFrame->au8Data[2] | ((uint32_t)psFrame->au8Data[3] << 8);
+    psIF->DAT_B1 = (uint32_t)psFrame->au8Data[4] | ((uint32_t)psFrame->au8Data[5] << 8);
+    psIF->DAT_B2 = (uint32_t)psFrame->au8Data[6] | ((uint32_t)psFrame->au8Data[7] << 8);
+    psIF->MCON = CAN_IF_MCON_NEWDAT_Msk | CAN_IF_MCON_TxRqst_Msk | CAN_IF_MCON_TXIE_Msk | CAN_IF_MCON_EOB_Msk |
+                 psFrame->u8Dlc;
+    CANFIFO_Command(tCAN, u32Obj);
+}
+
+/* Move queued frames into free transmit objects, the highest priority into the lowest object, which the
+   controller sends first. Called from the handler or with the interrupt masked. */
+static void CANFIFO_TxLoad(CAN_T *tCAN, CANFIFO_STATE_T *psState)
+{
+    CANFIFO_FRAME_T sFrame;
+    uint32_t u32Free, u32Obj;
+
+    u32Free = psState->u32TxObjMask & ~psState->u32TxBusy;
+    while ((u32Free != 0UL) && (psState->u32TxCount != 0UL))
+    {
+        u32Obj = __CLZ(__RBIT(u32Free));
+        u32Free &= u32Free - 1UL;
+        CANFIFO_TxPop(psState, &sFrame);
+        CANFIFO_WriteTx(tCAN, u32Obj, &sFrame);
+        psState->u32TxBusy |= 1UL << u32Obj;
+    }
+}
+
+static void CANFIFO_Receive(CAN_T *tCAN, CANFIFO_STATE_T *psState, uint32_t u32Obj)
+{
+    volatile CAN_IF_T *psIF = &tCAN->IF[CANFIFO_IF];
+    CANFIFO_FRAME_T *psFrame;
+    uint32_t u32Head, u32Arb2, u32Mcon, u32Fill, u32IdType, u32Id;
+    int32_t i32Rule;
+
+    /* Reading with TxRqst/NewDat and ClrIntPnd frees the object for the next frame */
+    psIF->CMASK = CAN_IF_CMASK_ARB_Msk | CAN_IF_CMASK_CONTROL_Msk | CAN_IF_CMASK_DATAA_Msk |
+                  CAN_IF_CMASK_DATAB_Msk | CAN_IF_CMASK_CLRINTPND_Msk | CAN_IF_CMASK_TXRQSTNEWDAT_Msk;
+    CANFIFO_Command(tCAN, u32Obj);
+    u32Arb2 = psIF->ARB2;
+    u32Mcon = psIF->MCON;
+    if (u32Arb2 & CAN_IF_ARB2_XTD_Msk)
+    {
+        u32IdType = CAN_EXT_ID;
+        u32Id = ((u32Arb2 & 0x1FFFUL) << 16) | (psIF->ARB1 & 0xFFFFUL);
+    }
+    else
+    {
+        u32IdType = CAN_STD_ID;
+        u32Id = (u32Arb2 & CAN_IF_ARB2_ID_Msk) >> 2;
+    }
+
+    u32Head = psState->u32RxHead;
+    i32Rule = CANFILT_Match(psState->psPlan, psState->psPlan->au8ObjFilter[u32Obj], u32IdType, u32Id);
+    if (i32Rule < 0)
+    {
+        psState->sStats.u32RxRejected++;
+    }
+    else if (u32Head - psState->u32RxTail >= psState->u32RxSize)
+    {
+        psState->sStats.u32RxRingFull++;
+    }
+    else
+    {
+        psFrame = &psState->psRxRing[u32Head & (psState->u32RxSize - 1UL)];
+        psFrame->u32Id = u32Id;
+        psFrame->u8IdType = (uint8_t)u32IdType;
+        psFrame->u32Stamp = DWT->CYCCNT;
+        psFrame->u8FrameType = CAN_DATA_FRAME;
+        psFrame->u8Dlc = (uint8_t)(u32Mcon & CAN_IF_MCON_DLC_Msk);
+        psFrame->u8Rule = (uint8_t)i32Rule;
+        psFrame->au8Data[0] = (uint8_t)psIF->DAT_A1;
+        psFrame->au8Data[1] = (uint8_t)(psIF->DAT_A1 >> 8);
+        psFrame->au8Data[2] = (uint8_t)psIF->DAT_A2;
+        psFrame->au8Data[3] = (uint8_t)(psIF->DAT_A2 >> 8);
+        psFrame->au8Data[4] = (uint8_t)psIF->DAT_B1;
+        psFrame->au8Data[5] = (uint8_t)(psIF->DAT_B1 >> 8);
+        psFrame->au8Data[6] = (uint8_t)psIF->DAT_B2;
+        psFrame->au8Data[7] = (uint8_t)(psIF->DAT_B2 >> 8);
+
+        __DMB();
+        psState->u32RxHead = u32Head + 1UL;
+        psState->sStats.u32RxFrames++;
+        u32Fill = u32Head + 1UL - psState->u32RxTail;
+        if (u32Fill > psState->sStats.u32RxPeak)
+            psState->sStats.u32RxPeak = u32Fill;
+    }
+
+    if (u32Mcon & CAN_IF_MCON_MsgLst_Msk)
+    {
+        psState->sStats.u32RxHwLost++;
+
+        /*
+         *  MCON can only be written whole. Re-read it, so a frame stored in the object since the read
+         *  above keeps its NewDat and IntPnd and is received on the next interrupt. Only the two
+         *  interface commands between this read and the write remain open to a frame, much shorter
+         *  than the frame itself.
+         */
+        psIF->CMASK = CAN_IF_CMASK_CONTROL_Msk;
+        CANFIFO_Command(tCAN, u32Obj);
+        u32Mcon = psIF->MCON;
+        psIF->CMASK = CAN_IF_CMASK_WRRD_Msk | CAN_IF_CMASK_CONTROL_Msk;
+        psIF->MCON = u32Mcon & ~CAN_IF_MCON_MsgLst_Msk;
+        CANFIFO_Command(tCAN, u32Obj);
+    }
+}
+
+static void CANFIFO_ConfigObj(CAN_T *tCAN, const CANFILT_PLAN_T *psPlan, uint32_t u32Obj)
+{
+    volatile CAN_IF_T *psIF = &tCAN->IF[CANFIFO_IF];
+    const CANFILT_FILTER_T *psFilter;
+    uint32_t u32Filter = psPlan->au8ObjFilter[u32Obj];
+
+    psIF->CMASK = CAN_IF_CMASK_WRRD_Msk | CAN_IF_CMASK_MASK_Msk | CAN_IF_CMASK_ARB_Msk | CAN_IF_CMASK_CONTROL_Msk;
+    if (u32Filter == CANFILT_OBJ_TX)
+    {
+        /* Invalid until a frame is loaded */
+        psIF->MASK1 = 0UL;
+        psIF->MASK2 = 0UL;
+        psIF->ARB1 = 0UL;
+        psIF->ARB2 = 0UL;
+        psIF->MCON = 0UL;
+    }
+    else
+    {
+        /* Compare the identifier type and direction too, so only data frames of the one type match */
+        psFilter = &psPlan->asFilter[u32Filter];
+        if (psFilter->u8IdType == CANFILT_STD_ID)
+        {
+            psIF->MASK1 = 0UL;
+            psIF->MASK2 = CAN_IF_MASK2_MXTD_Msk | CAN_IF_MASK2_MDIR_Msk | ((psFilter->u32Mask & 0x7FFUL) << 2);
+            psIF->ARB1 = 0UL;
+            psIF->ARB2 = CAN_IF_ARB2_MSGVAL_Msk | ((psFilter->u32Id & 0x7FFUL) << 2);
+        }
+        else
+        {
+            psIF->MASK1 = psFilter->u32Mask & 0xFFFFUL;
+            psIF->MASK2 = CAN_IF_MASK2_MXTD_Msk | CAN_IF_MASK2_MDIR_Msk | ((psFilter->u32Mask >> 16) & 0x1FFFUL);
+            psIF->ARB1 = psFilter->u32Id & 0xFFFFUL;
+            psIF->ARB2 = CAN_IF_ARB2_MSGVAL_Msk | CAN_IF_ARB2_XTD_Msk | ((psFilter->u32Id >> 16) & 0x1FFFUL);
+        }
+        psIF->MCON = CAN_IF_MCON_UMASK_Msk | CAN_IF_MCON_RXIE_Msk |
+                     ((u32Obj + 1UL == (uint32_t)psFilter->u8First + psFilter->u8Depth) ? CAN_IF_MCON_EOB_Msk : 0UL);
+    }
+    CANFIFO_Command(tCAN, u32Obj);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup CANFIFO_EXPORTED_FUNCTIONS CANFIFO Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Start the engine on a CAN
+  *
+  * @param[in]  tCAN    The pointer to CAN module base address, opened with CAN_Open() in CAN_NORMAL_MODE
+  * @param[in]  psCfg   Configuration
+  *
+  * @retval     CANFIFO_OK          Success
+  * @retval     CANFIFO_ERR_PARAM   Invalid configuration
+  *
+  * @details    Programs all 32 message objects and enables the module and error interrupts, also in
+  *             the NVIC. CANx_IRQHandler() must call CANFIFO_IRQHandler().
+  */
+int32_t CANFIFO_Open(CAN_T *tCAN, const CANFIFO_CFG_T *psCfg)
+{
+    CANFIFO_STATE_T *psState = &s_asState[CANFIFO_Index(tCAN)];
+    uint32_t u32Obj;
+
+    if ((psCfg == NULL) || (psCfg->psPlan == NULL) || (psCfg->psRxRing == NULL) || (psCfg->u32RxSize < 2UL) ||
+            (psCfg->u32RxSize & (psCfg->u32RxSize - 1UL)) ||
+            ((psCfg->psPlan->u32TxObjs != 0UL) && ((psCfg->psTxQueue == NULL) || (psCfg->u32TxSize == 0UL))))
+        return CANFIFO_ERR_PARAM;
+
+    NVIC_DisableIRQ(CANFIFO_IRQn(tCAN));
+    tCAN->CON &= ~(CAN_CON_IE_Msk | CAN_CON_SIE_Msk | CAN_CON_EIE_Msk);
+
+    memset(psState, 0, sizeof(CANFIFO_STATE_T));
+    psState->psRxRing = psCfg->psRxRing;
+    psState->u32RxSize = psCfg->u32RxSize;
+    psState->psTxQueue = psCfg->psTxQueue;
+    psState->u32TxSize = psCfg->u32TxSize;
+    psState->u32TxObjMask = (1UL << psCfg->psPlan->u32TxObjs) - 1UL;
+
+    for (u32Obj = 0UL; u32Obj < CANFILT_MSG_OBJS; u32Obj++)
+        CANFIFO_ConfigObj(tCAN, psCfg->psPlan, u32Obj);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    psState->psPlan = psCfg->psPlan;
+    tCAN->CON |= CAN_CON_IE_Msk | CAN_CON_EIE_Msk;
+    NVIC_EnableIRQ(CANFIFO_IRQn(tCAN));
+
+    return CANFIFO_OK;
+}
+
+/**
+  * @brief      Stop the engine on a CAN
+  *
+  * @param[in]  tCAN    The pointer to CAN module base address
+  *
+  * @return     None
+  *
+  * @details    Disables the CAN interrupts and invalidates all message objects. Queued frames not yet
+  *             in a transmit object are discarded.
+  */
+void CANFIFO_Close(CAN_T *tCAN)
+{
+    CANFIFO_STATE_T *psState = &s_asState[CANFIFO_Index(tCAN)];
+    uint32_t u32Obj;
+
+    NVIC_DisableIRQ(CANFIFO_IRQn(tCAN));
+    tCAN->CON &= ~(CAN_CON_IE_Msk | CAN_CON_SIE_Msk | CAN_CON_EIE_Msk);
+
+    tCAN->IF[CANFIFO_IF].CMASK = CAN_IF_CMASK_WRRD_Msk | CAN_IF_CMASK_ARB_Msk | CAN_IF_CMASK_CONTROL_Msk;
+    tCAN->IF[CANFIFO_IF].ARB1 = 0UL;
+    tCAN->IF[CANFIFO_IF].ARB2 = 0UL;
+    tCAN->IF[CANFIFO_IF].MCON = 0UL;
+    for (u32Obj = 0UL; u32Obj < CANFILT_MSG_OBJS; u32Obj++)
+        CANFIFO_Command(tCAN, u32Obj);
+
+    psState->psPlan = NULL;
+}
+
+/**
+  * @brief      CAN interrupt service
+  *
+  * @param[in]  tCAN    The pointer to CAN module base address
+  *
+  * @return     None
+  *
+  * @details    Call from CAN0_IRQHandler() or CAN1_IRQHandler(). Loops until no message object has
+  *             an interrupt pending, so frames arriving meanwhile are taken in the same run.
+  */
+void CANFIFO_IRQHandler(CAN_T *tCAN)
+{
+    CANFIFO_STATE_T *psState = &s_asState[CANFIFO_Index(tCAN)];
+    uint32_t u32Start = DWT->CYCCNT, u32Pend, u32RxPend, u32TxPend, u32Obj, u32Cycles;
+
+    if (psState->psPlan == NULL)
+    {
+        (void)tCAN->STATUS;
+        return;
+    }
+
+    for (;;)
+    {
+        if (tCAN->IIDR == CANFIFO_INT_STATUS)
+        {
+            /* Reading STATUS clears the interrupt. Bus off sets INIT; clearing it starts the recovery. */
+            if (tCAN->STATUS & CAN_STATUS_BOFF_Msk)
+            {
+                psState->sStats.u32BusOff++;
+                tCAN->CON &= ~CAN_CON_INIT_Msk;
+            }
+        }
+
+        u32Pend = (tCAN->IPND1 & CAN_IPND1_IntPnd16_1_Msk) | (tCAN->IPND2 << 16);
+        if (u32Pend == 0UL)
+            break;
+
+        u32RxPend = u32Pend & ~psState->u32TxObjMask;
+        while (u32RxPend != 0UL)
+        {
+            u32Obj = __CLZ(__RBIT(u32RxPend));
+            u32RxPend &= u32RxPend - 1UL;
+            CANFIFO_Receive(tCAN, psState, u32Obj);
+        }
+
+        u32TxPend = u32Pend & psState->u32TxObjMask;
+        while (u32TxPend != 0UL)
+        {
+            u32Obj = __CLZ(__RBIT(u32TxPend));
+            u32TxPend &= u32TxPend - 1UL;
+            tCAN->IF[CANFIFO_IF].CMASK = CAN_IF_CMASK_CLRINTPND_Msk;
+            CANFIFO_Command(tCAN, u32Obj);
+            psState->u32TxBusy &= ~(1UL << u32Obj);
+            psState->sStats.u32TxFrames++;
+        }
+        CANFIFO_TxLoad(tCAN, psState);
+    }
+
+    u32Cycles = DWT->CYCCNT - u32Start;
+    if (u32Cycles > psState->sStats.u32IsrMaxCycles)
+        psState->sStats.u32IsrMaxCycles = u32Cycles;
+}
+
+/**
+  * @brief      Take the oldest received frame
+  *
+  * @param[in]  tCAN    The pointer to CAN module base address
+  * @param[out] psFrame Receives the frame
+  *
+  * @retval     CANFIFO_OK          Success
+  * @retval     CANFIFO_ERR_EMPTY   No frame waiting
+  * @retval     CANFIFO_ERR_STATE   The engine is not open
+  *
+  * @details    Lock free against the handler. Only one context may read a CAN.
+  */
+int32_t CANFIFO_Read(CAN_T *tCAN, CANFIFO_FRAME_T *psFrame)
+{
+    CANFIFO_STATE_T *psState = &s_asState[CANFIFO_Index(tCAN)];
+    uint32_t u32Tail;
+
+    if (psState->psPlan == NULL)
+        return CANFIFO_ERR_STATE;
+
+    u32Tail = psState->u32RxTail;
+    if (u32Tail == psState->u32RxHead)
+        return CANFIFO_ERR_EMPTY;
+    __DMB();
+
+    *psFrame = psState->psRxRing[u32Tail & (psState->u32RxSize - 1UL)];
+    __DMB();
+    psState->u32RxTail = u32Tail + 1UL;
+
+    return CANFIFO_OK;
+}
+
+/**
+  * @brief      Number of received frames waiting
+  *
+  * @param[in]  tCAN    The pointer to CAN module base address
+  *
+  * @return     Frames CANFIFO_Read() can take
+  */
+uint32_t CANFIFO_GetRxCount(CAN_T *tCAN)
+{
+    CANFIFO_STATE_T *psState = &s_asState[CANFIFO_Index(tCAN)];
+
+    return psState->u32RxHead - psState->u32RxTail;
+}
+
+/**
+  * @brief      Queue a frame for transmission
+  *
+  * @param[in]  tCAN    The pointer to CAN module base address
+  * @param[in]  psFrame Frame. u32Stamp and u8Rule are ignored.
+  *
+  * @retval     CANFIFO_OK          Queued
+  * @retval     CANFIFO_ERR_FULL    The queue is full
+  * @retval     CANFIFO_ERR_PARAM   Invalid frame, or the plan has no transmit objects
+  * @retval     CANFIFO_ERR_STATE   The engine is not open
+  *
+  * @details    Queued frames go out in bus arbitration order, frames of equal priority in queue
+  *             order. A frame already loaded into a transmit object is not overtaken by one queued
+  *             later, so a lower priority frame delays another by at most the number of transmit
+  *             objects minus one. Masks the CAN interrupt for the queue insert.
+  */
+int32_t CANFIFO_Send(CAN_T *tCAN, const CANFIFO_FRAME_T *psFrame)
+{
+    CANFIFO_STATE_T *psState = &s_asState[CANFIFO_Index(tCAN)];
+    int32_t i32Ret = CANFIFO_OK;
+    uint32_t u32En;
+
+    if (psState->psPlan == NULL)
+        return CANFIFO_ERR_STATE;
+    if ((psFrame == NULL) || (psFrame->u8Dlc > 8U) || (psState->u32TxObjMask == 0UL))
+        return CANFIFO_ERR_PARAM;
+
+    u32En = CANFIFO_Lock(tCAN);
+    if (psState->u32TxCount == psState->u32TxSize)
+    {
+        i32Ret = CANFIFO_ERR_FULL;
+    }
+    else
+    {
+        CANFIFO_TxPush(psState, psFrame);
+        CANFIFO_TxLoad(tCAN, psState);
+    }
+    CANFIFO_Unlock(tCAN, u32En);
+
+    return i32Ret;
+}
+
+/**
+  * @brief      Get the engine counters
+  *
+  * @param[in]  tCAN     The pointer to CAN module base address
+  * @param[out] psStats  Receives the counters
+  *
+  * @return     None
+  */
+void CANFIFO_GetStats(CAN_T *tCAN, CANFIFO_STATS_T *psStats)
+{
+    *psStats = s_asState[CANFIFO_Index(tCAN)].sStats;
+}
+
+/*@}*/ /* end of group CANFIFO_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group CANFIFO_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,306 @@
+/**************************************************************************//**
+ * @file     canfilt.c
+ * @version  V1.00
+ * @brief    M480 series CAN acceptance filter compiler source file
+ *
+ * @note     Free of hardware access; Tool/CanFilter builds this file on the host.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "canfilt.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup CANFILT_Driver CANFILT Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+typedef struct
+{
+    CANFILT_FILTER_T sFilter;
+    uint32_t u32Weight;
+} CANFILT_GROUP_T;
+
+static uint32_t CANFILT_Bits(uint32_t u32Val)
+{
+    uint32_t u32Cnt = 0UL;
+
+    while (u32Val != 0UL)
+    {
+        u32Val &= u32Val - 1UL;
+        u32Cnt++;
+    }
+    return u32Cnt;
+}
+
+static uint32_t CANFILT_Width(uint32_t u32IdType)
+{
+    return (u32IdType == CANFILT_EXT_ID) ? 29UL : 11UL;
+}
+
+/* Identifiers accepted by an identifier type and mask */
+static uint64_t CANFILT_Size(uint32_t u32IdType, uint32_t u32Mask)
+{
+    return 1ULL << (CANFILT_Width(u32IdType) - CANFILT_Bits(u32Mask));
+}
+
+/* Does filter a accept every identifier filter b accepts */
+static uint32_t CANFILT_Covers(const CANFILT_FILTER_T *psA, const CANFILT_FILTER_T *psB)
+{
+    return (psA->u8IdType == psB->u8IdType) && ((psA->u32Mask & ~psB->u32Mask) == 0UL) &&
+           (((psA->u32Id ^ psB->u32Id) & psA->u32Mask) == 0UL);
+}
+
+static void CANFILT_Remove(CANFILT_GROUP_T *psGroup, uint32_t *pu32Num, uint32_t u32Idx)
+{
+    (*pu32Num)--;
+    memmove(&psGroup[u32Idx], &psGroup[u32Idx + 1UL], (*pu32Num - u32Idx) * sizeof(CANFILT_GROUP_T));
+}
+
+/* Fold every group into a group that covers it. Exact, the accepted identifiers do not change. */
+static void CANFILT_Absorb(CANFILT_GROUP_T *psGroup, uint32_t *pu32Num)
+{
+    uint32_t i, j;
+
+    for (i = 0UL; i < *pu32Num; i++)
+    {
+        for (j = 0UL; j < *pu32Num; j++)
+        {
+            if ((i != j) && CANFILT_Covers(&psGroup[i].sFilter, &psGroup[j].sFilter))
+            {
+                psGroup[i].sFilter.u32Rules |= psGroup[j].sFilter.u32Rules;
+                psGroup[i].u32Weight += psGroup[j].u32Weight;
+                CANFILT_Remove(psGroup, pu32Num, j);
+                if (j < i)
+                    i--;
+                j = (uint32_t)-1;       /* rescan, i may cover more now */
+            }
+        }
+    }
+}
+
+/* Identifiers a merge of two filters accepts that neither accepted before */
+static uint64_t CANFILT_MergeCost(const CANFILT_FILTER_T *psA, const CANFILT_FILTER_T *psB, uint32_t *pu32Mask)
+{
+    uint64_t u64Both = 0ULL;
+
+    *pu32Mask = psA->u32Mask & psB->u32Mask & ~(psA->u32Id ^ psB->u32Id);
+    if (((psA->u32Id ^ psB->u32Id) & psA->u32Mask & psB->u32Mask) == 0UL)
+        u64Both = CANFILT_Size(psA->u8IdType, psA->u32Mask | psB->u32Mask);
+
+    return CANFILT_Size(psA->u8IdType, *pu32Mask) + u64Both -
+           CANFILT_Size(psA->u8IdType, psA->u32Mask) - CANFILT_Size(psB->u8IdType, psB->u32Mask);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup CANFILT_EXPORTED_FUNCTIONS CANFILT Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Compile acceptance rules into a message object layout
+  *
+  * @param[in]  psRules     Rules
+  * @param[in]  u32Count    Number of rules, 1 ~ CANFILT_MAX_RULES
+  * @param[in]  u32TxObjs   Message objects to keep for transmission, 0 ~ 31
+  * @param[in]  u32MinDepth Minimum message objects per receive FIFO, 1 or more
+  * @param[out] psPlan      Receives the layout
+  *
+  * @retval     CANFILT_OK          Success
+  * @retval     CANFILT_ERR_PARAM   Invalid argument or rule
+  * @retval     CANFILT_ERR_BUDGET  Not even merging fits the rules, e.g. standard and extended rules with
+  *                                 room for only one FIFO
+  *
+  * @details    Every identifier a rule accepts is accepted by the first filter in object order that
+  *             accepts it. Frames of lossy filters still need CANFILT_Match().
+  */
+int32_t CANFILT_Compile(const CANFILT_RULE_T *psRules, uint32_t u32Count, uint32_t u32TxObjs,
+                        uint32_t u32MinDepth, CANFILT_PLAN_T *psPlan)
+{
+    CANFILT_GROUP_T asGroup[CANFILT_MAX_RULES], sTmp;
+    uint32_t au32Rem[CANFILT_MAX_RULES];
+    uint32_t u32Num, u32Budget, u32RxObjs, u32Spare, u32Left, u32Weight, u32Mask, u32BestMask = 0UL;
+    uint32_t i, j, u32BestI = 0UL, u32BestJ = 0UL, u32Obj;
+    uint64_t u64Cost, u64Best;
+    CANFILT_GROUP_T *psGroup;
+
+    if ((psRules == NULL) || (psPlan == NULL) || (u32Count == 0UL) || (u32Count > CANFILT_MAX_RULES) ||
+            (u32TxObjs >= CANFILT_MSG_OBJS) || (u32MinDepth == 0UL))
+        return CANFILT_ERR_PARAM;
+
+    u32RxObjs = CANFILT_MSG_OBJS - u32TxObjs;
+    u32Budget = u32RxObjs / u32MinDepth;
+    if (u32Budget == 0UL)
+        return CANFILT_ERR_BUDGET;
+
+    memset(psPlan, 0, sizeof(CANFILT_PLAN_T));
+    for (i = 0UL; i < u32Count; i++)
+    {
+        if (psRules[i].u8IdType > CANFILT_EXT_ID)
+            return CANFILT_ERR_PARAM;
+
+        psPlan->asRule[i] = psRules[i];
+        psPlan->asRule[i].u32Mask &= (psRules[i].u8IdType == CANFILT_EXT_ID) ? CANFILT_EXT_MASK : CANFILT_STD_MASK;
+        psPlan->asRule[i].u32Id &= psPlan->asRule[i].u32Mask;
+
+        psGroup = &asGroup[i];
+        psGroup->sFilter.u32Id = psPlan->asRule[i].u32Id;
+        psGroup->sFilter.u32Mask = psPlan->asRule[i].u32Mask;
+        psGroup->sFilter.u32Rules = 1UL << i;
+        psGroup->sFilter.u8IdType = psRules[i].u8IdType;
+        psGroup->sFilter.u8Lossy = 0U;
+        psGroup->u32Weight = (psRules[i].u8Weight != 0U) ? psRules[i].u8Weight : 1UL;
+    }
+    psPlan->u32Rules = u32Count;
+    u32Num = u32Count;
+    CANFILT_Absorb(asGroup, &u32Num);
+
+    /* Merge the cheapest pair until the FIFOs fit */
+    while (u32Num > u32Budget)
+    {
+        u64Best = ~0ULL;
+        for (i = 0UL; i < u32Num; i++)
+        {
+            for (j = i + 1UL; j < u32Num; j++)
+            {
+                if (asGroup[i].sFilter.u8IdType != asGroup[j].sFilter.u8IdType)
+                    continue;
+                u64Cost = CANFILT_MergeCost(&asGroup[i].sFilter, &asGroup[j].sFilter, &u32Mask);
+                if (u64Cost < u64Best)
+                {
+                    u64Best = u64Cost;
+                    u32BestI = i;
+                    u32BestJ = j;
+                    u32BestMask = u32Mask;
+                }
+            }
+        }
+        if (u64Best == ~0ULL)
+            return CANFILT_ERR_BUDGET;
+
+        psGroup = &asGroup[u32BestI];
+        psGroup->sFilter.u32Mask = u32BestMask;
+        psGroup->sFilter.u32Id &= u32BestMask;
+        psGroup->sFilter.u32Rules |= asGroup[u32BestJ].sFilter.u32Rules;
+        psGroup->sFilter.u8Lossy |= asGroup[u32BestJ].sFilter.u8Lossy | (uint8_t)(u64Best != 0ULL);
+        psGroup->u32Weight += asGroup[u32BestJ].u32Weight;
+        CANFILT_Remove(asGroup, &u32Num, u32BestJ);
+        CANFILT_Absorb(asGroup, &u32Num);
+    }
+
+    /* The more specific filters first, lower objects win acceptance */
+    for (i = 1UL; i < u32Num; i++)
+    {
+        sTmp = asGroup[i];
+        for (j = i; (j > 0UL) && (CANFILT_Bits(asGroup[j - 1UL].sFilter.u32Mask) < CANFILT_Bits(sTmp.sFilter.u32Mask)); j--)
+            asGroup[j] = asGroup[j - 1UL];
+        asGroup[j] = sTmp;
+    }
+
+    /* Minimum depth each, the spare objects by weight, largest remainders last */
+    u32Weight = 0UL;
+    for (i = 0UL; i < u32Num; i++)
+        u32Weight += asGroup[i].u32Weight;
+    u32Spare = u32RxObjs - u32Num * u32MinDepth;
+    u32Left = u32Spare;
+    for (i = 0UL; i < u32Num; i++)
+    {
+        asGroup[i].sFilter.u8Depth = (uint8_t)(u32MinDepth + u32Spare * asGroup[i].u32Weight / u32Weight);
+        au32Rem[i] = u32Spare * asGroup[i].u32Weight % u32Weight;
+        u32Left -= u32Spare * asGroup[i].u32Weight / u32Weight;
+    }
+    while (u32Left != 0UL)
+    {
+        j = 0UL;
+        for (i = 1UL; i < u32Num; i++)
+            if (au32Rem[i] > au32Rem[j])
+                j = i;
+        asGroup[j].sFilter.u8Depth++;
+        au32Rem[j] = 0UL;
+        u32Left--;
+    }
+
+    psPlan->u32TxObjs = u32TxObjs;
+    psPlan->u32Filters = u32Num;
+    for (u32Obj = 0UL; u32Obj < u32TxObjs; u32Obj++)
+        psPlan->au8ObjFilter[u32Obj] = CANFILT_OBJ_TX;
+    for (i = 0UL; i < u32Num; i++)
+    {
+        asGroup[i].sFilter.u8First = (uint8_t)u32Obj;
+        psPlan->asFilter[i] = asGroup[i].sFilter;
+        for (j = 0UL; j < asGroup[i].sFilter.u8Depth; j++)
+            psPlan->au8ObjFilter[u32Obj++] = (uint8_t)i;
+    }
+
+    return CANFILT_OK;
+}
+
+/**
+  * @brief      Find the filter the hardware stores a frame with
+  *
+  * @param[in]  psPlan      Layout from CANFILT_Compile()
+  * @param[in]  u32IdType   CANFILT_STD_ID or CANFILT_EXT_ID
+  * @param[in]  u32Id       Identifier
+  *
+  * @return     Filter index, or -1 if no message object accepts the frame
+  */
+int32_t CANFILT_Accept(const CANFILT_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32Id)
+{
+    const CANFILT_FILTER_T *psFilter;
+    uint32_t i;
+
+    for (i = 0UL; i < psPlan->u32Filters; i++)
+    {
+        psFilter = &psPlan->asFilter[i];
+        if ((psFilter->u8IdType == u32IdType) && (((u32Id ^ psFilter->u32Id) & psFilter->u32Mask) == 0UL))
+            return (int32_t)i;
+    }
+    return -1;
+}
+
+/**
+  * @brief      Find the rule a received frame belongs to
+  *
+  * @param[in]  psPlan      Layout from CANFILT_Compile()
+  * @param[in]  u32Filter   Filter that received the frame
+  * @param[in]  u32IdType   CANFILT_STD_ID or CANFILT_EXT_ID
+  * @param[in]  u32Id       Identifier
+  *
+  * @return     Rule index, or -1 if the frame only passed a lossy filter and is not wanted
+  *
+  * @details    Only the rules of the filter are tried, except for a lossy filter, which can also take
+  *             frames of rules served by a later filter.
+  */
+int32_t CANFILT_Match(const CANFILT_PLAN_T *psPlan, uint32_t u32Filter, uint32_t u32IdType, uint32_t u32Id)
+{
+    const CANFILT_RULE_T *psRule;
+    uint32_t u32Rules, i;
+
+    u32Rules = psPlan->asFilter[u32Filter].u32Rules;
+    if (psPlan->asFilter[u32Filter].u8Lossy)
+        u32Rules = (psPlan->u32Rules < 32UL) ? ((1UL << psPlan->u32Rules) - 1UL) : 0xFFFFFFFFUL;
+
+    for (i = 0UL; u32Rules != 0UL; i++, u32Rules >>= 1)
+    {
+        psRule = &psPlan->asRule[i];
+        if ((u32Rules & 1UL) && (psRule->u8IdType == u32IdType) && (((u32Id ^ psRule->u32Id) & psRule->u32Mask) == 0UL))
+            return (int32_t)i;
+    }
+    return -1;
+}
+
+/*@}*/ /* end of group CANFILT_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group CANFILT_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "NuMicro.h"
+#include "trace.h"
 
 /** @cond HIDDEN_SYMBOLS */
 
@@ -1233,12 +1234,14 @@ int32_t  ECC_GeneratePublicKey(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *privat
         }
 
         g_ECC_done = g_ECCERR_done = 0UL;
+        TRACE_BEGIN(TRACE_ID_CRPT_ECC, ECCOP_POINT_MUL >> CRPT_ECC_CTL_ECCOP_Pos);
         crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) |
                          ECCOP_POINT_MUL | CRPT_ECC_CTL_START_Msk;
 
         while ((g_ECC_done | g_ECCERR_done) == 0UL)
         {
         }
+        TRACE_END(TRACE_ID_CRPT_ECC, g_ECCERR_done);
 
         Reg2Hex(pCurve->Echar, crpt->ECC_X1, public_k1);
         Reg2Hex(pCurve->Echar, crpt->ECC_Y1, public_k2);
@@ -1292,12 +1295,14 @@ int32_t  ECC_Mutiply(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char x1[], char y1[],
         }
 
         g_ECC_done = g_ECCERR_done = 0UL;
+        TRACE_BEGIN(TRACE_ID_CRPT_ECC, ECCOP_POINT_MUL >> CRPT_ECC_CTL_ECCOP_Pos);
         crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) |
                          ECCOP_POINT_MUL | CRPT_ECC_CTL_START_Msk;
 
         while ((g_ECC_done | g_ECCERR_done) == 0UL)
         {
         }
+        TRACE_END(TRACE_ID_CRPT_ECC, g_ECCERR_done);
 
         Reg2Hex(pCurve->Echar, crpt->ECC_X1, x2);
         Reg2Hex(pCurve->Echar, crpt->ECC_Y1, y2);
@@ -1364,12 +1369,14 @@ int32_t  ECC_GenerateSecretZ(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *private_
             crpt->ECC_CTL = CRPT_ECC_CTL_FSEL_Msk;
         }
         g_ECC_done = g_ECCERR_done = 0UL;
+        TRACE_BEGIN(TRACE_ID_CRPT_ECC, ECCOP_POINT_MUL >> CRPT_ECC_CTL_ECCOP_Pos);
         crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) |
                          ECCOP_POINT_MUL | CRPT_ECC_CTL_START_Msk;
 
         while ((g_ECC_done | g_ECCERR_done) == 0UL)
         {
         }
+        TRACE_END(TRACE_ID_CRPT_ECC, g_ECCERR_done);
 
         Reg2Hex(pCurve->Echar, crpt->ECC_X1, secret_z);
     }
@@ -1400,6 +1407,7 @@ static void run_ecc_codec(CRPT_T *crpt, uint32_t mode)
     }
 
     g_ECC_done = g_ECCERR_done = 0UL;
+    TRACE_BEGIN(TRACE_ID_CRPT_ECC, (mode & (CRPT_ECC_CTL_ECCOP_Msk | CRPT_ECC_CTL_MODOP_Msk)) >> CRPT_ECC_CTL_ECCOP_Pos);
     crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) | mode | CRPT_ECC_CTL_START_Msk;
     while ((g_ECC_done | g_ECCERR_done) == 0UL)
     {
@@ -1408,6 +1416,7 @@ static void run_ecc_codec(CRPT_T *crpt, uint32_t mode)
     while (crpt->ECC_STS & CRPT_ECC_STS_BUSY_Msk)
     {
     }
+    TRACE_END(TRACE_ID_CRPT_ECC, g_ECCERR_done);
 }
 /** @endcond HIDDEN_SYMBOLS */
 
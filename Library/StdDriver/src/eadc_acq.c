@@ -0,0 +1,369 @@
+/**************************************************************************//**
+ * @file     eadc_acq.c
+ * @version  V1.00
+ * @brief    M480 series continuous EADC acquisition engine source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "eadc_acq.h"
+#if EADCACQ_USE_DSP
+#include "arm_math.h"
+#endif
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup EADCACQ_Driver EADC Acquisition Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define EADCACQ_DESC_CTL    (PDMA_OP_SCATTER | PDMA_REQ_SINGLE | PDMA_TBINTDIS_ENABLE | PDMA_SAR_FIX | PDMA_DAR_INC | PDMA_WIDTH_16)
+
+static EADCACQ_CFG_T s_sCfg;
+static uint32_t s_u32Open;
+static uint32_t s_u32Running;
+static uint32_t s_u32BlockLen;                  /* Samples per block, frames x channels */
+
+/* Descriptors of the ring, linked in a loop. Table offsets from PDMA->SCATBA are 16-bit. */
+static DSCT_T s_asDesc[EADCACQ_MAX_BLOCKS];
+
+/* Free running block counts. s_u32Done: blocks PDMA completed. s_u32Taken: blocks processed or dropped. */
+static volatile uint32_t s_u32Done;
+static uint32_t s_u32Taken;
+static volatile uint32_t s_u32LastIrq;          /* DWT->CYCCNT at the last block interrupt */
+static volatile uint32_t s_u32BlockCycles;
+static EADCACQ_STATS_T s_sStats;
+
+#if EADCACQ_USE_DSP
+static arm_fir_decimate_instance_q15 s_asFir[EADCACQ_MAX_CH];
+#endif
+
+static uint32_t EADCACQ_CyclesToUs(uint32_t u32Cycles)
+{
+    return u32Cycles / (SystemCoreClock / 1000000UL);
+}
+
+static void EADCACQ_LinkRing(void)
+{
+    uint32_t i, u32Next;
+
+    for (i = 0UL; i < s_sCfg.u32Blocks; i++)
+    {
+        u32Next = (i + 1UL == s_sCfg.u32Blocks) ? 0UL : (i + 1UL);
+        s_asDesc[i].CTL = EADCACQ_DESC_CTL | ((s_u32BlockLen - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos);
+        s_asDesc[i].SA = (uint32_t)&EADC->CURDAT;
+        s_asDesc[i].DA = (uint32_t)&s_sCfg.pu16Ring[i * s_u32BlockLen];
+        s_asDesc[i].NEXT = (uint32_t)&s_asDesc[u32Next] - PDMA->SCATBA;
+    }
+}
+
+/* Q15 from the 12-bit unsigned result, channel-major */
+static void EADCACQ_Deinterleave(const uint16_t *pu16Src, int16_t *pi16Dst)
+{
+    uint32_t u32Ch, u32Frame, u32Channels = s_sCfg.u32Channels, u32Frames = s_sCfg.u32Frames;
+    const uint16_t *pu16In;
+    int16_t *pi16Out;
+
+    for (u32Ch = 0UL; u32Ch < u32Channels; u32Ch++)
+    {
+        pu16In = &pu16Src[u32Ch];
+        pi16Out = &pi16Dst[u32Ch * u32Frames];
+
+        for (u32Frame = 0UL; u32Frame < u32Frames; u32Frame++)
+        {
+            pi16Out[u32Frame] = (int16_t)(((int32_t)(*pu16In & 0xFFFUL) - 2048L) * 16L);
+            pu16In += u32Channels;
+        }
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief      Open the acquisition engine
+  * @param[in]  psCfg   Engine configuration
+  * @retval     EADCACQ_OK          Success
+  * @retval     EADCACQ_ERR_PARAM   Invalid configuration, or decimation without EADCACQ_USE_DSP
+  * @retval     EADCACQ_ERR_STATE   Already open
+  * @retval     EADCACQ_ERR_DESC    The descriptors lie more than 64 KB above PDMA->SCATBA
+  * @details    Checks the configuration, sets up the decimation filters and enables the DWT cycle
+  *             counter. The EADC must already be clocked and opened with EADC_Open(); the trigger
+  *             source is configured and started by the application.
+  */
+int32_t EADCACQ_Open(const EADCACQ_CFG_T *psCfg)
+{
+    uint32_t u32M;
+#if EADCACQ_USE_DSP
+    uint32_t i;
+#endif
+
+    if (s_u32Open)
+        return EADCACQ_ERR_STATE;
+
+    if ((psCfg == NULL) || (psCfg->pu8Channel == NULL) || (psCfg->pu16Ring == NULL) || (psCfg->pi16Work == NULL) ||
+            (psCfg->u32Channels == 0UL) || (psCfg->u32Channels > EADCACQ_MAX_CH) ||
+            (psCfg->u32Blocks < 2UL) || (psCfg->u32Blocks > EADCACQ_MAX_BLOCKS) || (psCfg->u32Frames == 0UL) ||
+            (psCfg->u32Frames * psCfg->u32Channels > EADCACQ_MAX_BLOCK_LEN) || (psCfg->u32PdmaCh >= PDMA_CH_MAX) ||
+            ((uint32_t)psCfg->pu16Ring & 1UL))
+        return EADCACQ_ERR_PARAM;
+
+    u32M = (psCfg->u32Decimate > 1UL) ? psCfg->u32Decimate : 1UL;
+
+    if (u32M > 1UL)
+    {
+#if EADCACQ_USE_DSP
+        if ((psCfg->u32Frames % u32M) || (psCfg->pi16Coeffs == NULL) || (psCfg->u32Taps == 0UL) ||
+                (psCfg->pi16FirState == NULL))
+            return EADCACQ_ERR_PARAM;
+#else
+        return EADCACQ_ERR_PARAM;
+#endif
+    }
+
+    if (((uint32_t)&s_asDesc[EADCACQ_MAX_BLOCKS - 1] - PDMA->SCATBA) > 0xFFFFUL)
+        return EADCACQ_ERR_DESC;
+
+    s_sCfg = *psCfg;
+    s_sCfg.u32Decimate = u32M;
+    s_u32BlockLen = psCfg->u32Frames * psCfg->u32Channels;
+
+#if EADCACQ_USE_DSP
+    if (u32M > 1UL)
+    {
+        for (i = 0UL; i < psCfg->u32Channels; i++)
+        {
+            if (arm_fir_decimate_init_q15(&s_asFir[i], (uint16_t)psCfg->u32Taps, (uint8_t)u32M, (q15_t *)psCfg->pi16Coeffs,
+                                          &psCfg->pi16FirState[i * (psCfg->u32Taps + psCfg->u32Frames - 1UL)],
+                                          psCfg->u32Frames) != ARM_MATH_SUCCESS)
+                return EADCACQ_ERR_PARAM;
+        }
+    }
+#endif
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    s_u32Open = 1UL;
+    return EADCACQ_OK;
+}
+
+/**
+  * @brief      Close the acquisition engine
+  * @param      None
+  * @return     None
+  * @details    Stops the acquisition if it is running. The buffers may be reused afterwards.
+  */
+void EADCACQ_Close(void)
+{
+    EADCACQ_Stop();
+    s_u32Open = 0UL;
+}
+
+/**
+  * @brief      Start sampling
+  * @param      None
+  * @retval     EADCACQ_OK          Success
+  * @retval     EADCACQ_ERR_STATE   Not open, or already running
+  * @details    Configures sample modules 0 ~ u32Channels - 1 on the shared trigger, links the
+  *             descriptor ring and arms the PDMA channel. Sampling begins with the next trigger.
+  *             The sample module interrupts are disabled, as EADC PDMA mode requires. Call
+  *             EADCACQ_PdmaHandler() from PDMA_IRQHandler().
+  */
+int32_t EADCACQ_Start(void)
+{
+    uint32_t i, u32Ch = s_sCfg.u32PdmaCh;
+
+    if ((s_u32Open == 0UL) || s_u32Running)
+        return EADCACQ_ERR_STATE;
+
+    s_u32Done = 0UL;
+    s_u32Taken = 0UL;
+    s_u32BlockCycles = 0UL;
+    memset(&s_sStats, 0, sizeof(s_sStats));
+
+    EADC->CTL &= ~(EADC_CTL_ADCIEN0_Msk | EADC_CTL_ADCIEN1_Msk | EADC_CTL_ADCIEN2_Msk | EADC_CTL_ADCIEN3_Msk);
+
+    for (i = 0UL; i < s_sCfg.u32Channels; i++)
+        EADC_ConfigSampleModule(EADC, i, s_sCfg.u32Trigger, s_sCfg.pu8Channel[i]);
+
+    EADC_CLR_SAMPLE_MODULE_OV_FLAG(EADC, (1UL << s_sCfg.u32Channels) - 1UL);
+
+    EADCACQ_LinkRing();
+    PDMA_Open(PDMA, 1UL << u32Ch);
+    PDMA_SetTransferMode(PDMA, u32Ch, PDMA_ADC_RX, TRUE, (uint32_t)&s_asDesc[0]);
+    PDMA_CLR_TD_FLAG(PDMA, 1UL << u32Ch);
+    PDMA_EnableInt(PDMA, u32Ch, PDMA_INT_TRANS_DONE);
+    NVIC_EnableIRQ(PDMA_IRQn);
+
+    s_u32LastIrq = DWT->CYCCNT;
+    s_u32Running = 1UL;
+    EADC_ENABLE_PDMA(EADC);
+
+    return EADCACQ_OK;
+}
+
+/**
+  * @brief      Stop sampling
+  * @param      None
+  * @return     None
+  * @details    Returns the sample modules to software trigger and stops the PDMA channel. Blocks
+  *             completed before the call can still be processed with EADCACQ_Process().
+  */
+void EADCACQ_Stop(void)
+{
+    uint32_t i, u32Ch = s_sCfg.u32PdmaCh;
+
+    if (s_u32Running == 0UL)
+        return;
+
+    for (i = 0UL; i < s_sCfg.u32Channels; i++)
+        EADC_ConfigSampleModule(EADC, i, EADC_SOFTWARE_TRIGGER, s_sCfg.pu8Channel[i]);
+
+    EADC_DISABLE_PDMA(EADC);
+    PDMA_DisableInt(PDMA, u32Ch, PDMA_INT_TRANS_DONE);
+    PDMA_STOP(PDMA, u32Ch);
+    PDMA->CHCTL &= ~(1UL << u32Ch);
+    PDMA_CLR_TD_FLAG(PDMA, 1UL << u32Ch);
+
+    s_u32Running = 0UL;
+}
+
+/**
+  * @brief      PDMA interrupt service
+  * @param      None
+  * @return     None
+  * @details    Call from PDMA_IRQHandler(). Counts a completed block and times the block period.
+  *             Only the transfer done flag of the engine's channel is cleared.
+  */
+void EADCACQ_PdmaHandler(void)
+{
+    uint32_t u32Now, u32Mask = 1UL << s_sCfg.u32PdmaCh;
+
+    if ((PDMA->INTSTS & PDMA_INTSTS_TDIF_Msk) == 0UL)
+        return;
+
+    if (PDMA->TDSTS & u32Mask)
+    {
+        PDMA_CLR_TD_FLAG(PDMA, u32Mask);
+        u32Now = DWT->CYCCNT;
+        s_u32BlockCycles = u32Now - s_u32LastIrq;
+        s_u32LastIrq = u32Now;
+        s_u32Done++;
+    }
+}
+
+/**
+  * @brief      Deliver completed blocks
+  * @param      None
+  * @return     Blocks passed to the callback
+  * @details    Call from the main loop or a task, at least once per (u32Blocks - 1) block periods
+  *             to keep up. Each completed block is converted to Q15, de-interleaved, decimated if
+  *             configured and passed to the callback, oldest first. A block the PDMA has wrapped
+  *             onto, before or while it was copied, is skipped and counted in u32Overruns.
+  */
+uint32_t EADCACQ_Process(void)
+{
+    uint32_t u32Seq, u32Pend, u32Start, u32Cycles, u32Ov, u32Count = 0UL;
+    uint32_t u32Frames = s_sCfg.u32Frames;
+    int16_t *pi16Out = s_sCfg.pi16Work;
+#if EADCACQ_USE_DSP
+    uint32_t i;
+#endif
+
+    if (s_u32Open == 0UL)
+        return 0UL;
+
+    for (;;)
+    {
+        u32Seq = s_u32Taken;
+        u32Pend = s_u32Done - u32Seq;
+
+        if (u32Pend == 0UL)
+            break;
+
+        /* Block u32Seq is being overwritten once u32Pend reaches u32Blocks */
+        if (u32Pend >= s_sCfg.u32Blocks)
+        {
+            u32Pend -= s_sCfg.u32Blocks - 1UL;
+            s_u32Taken += u32Pend;
+            s_sStats.u32Overruns += u32Pend;
+            continue;
+        }
+
+        u32Start = DWT->CYCCNT;
+
+        EADCACQ_Deinterleave(&s_sCfg.pu16Ring[(u32Seq % s_sCfg.u32Blocks) * s_u32BlockLen], s_sCfg.pi16Work);
+        s_u32Taken = u32Seq + 1UL;
+
+        if ((s_u32Done - u32Seq) >= s_sCfg.u32Blocks)
+        {
+            s_sStats.u32Overruns++;
+            continue;
+        }
+
+#if EADCACQ_USE_DSP
+        if (s_sCfg.u32Decimate > 1UL)
+        {
+            pi16Out = &s_sCfg.pi16Work[s_u32BlockLen];
+            u32Frames = s_sCfg.u32Frames / s_sCfg.u32Decimate;
+
+            for (i = 0UL; i < s_sCfg.u32Channels; i++)
+                arm_fir_decimate_q15(&s_asFir[i], &s_sCfg.pi16Work[i * s_sCfg.u32Frames], &pi16Out[i * u32Frames],
+                                     s_sCfg.u32Frames);
+        }
+#endif
+
+        if (s_sCfg.pfnBlock)
+            s_sCfg.pfnBlock(s_sCfg.pvArg, pi16Out, u32Frames, u32Seq);
+
+        u32Cycles = DWT->CYCCNT - u32Start;
+        s_sStats.u32ProcUs = EADCACQ_CyclesToUs(u32Cycles);
+
+        if (s_sStats.u32ProcUs > s_sStats.u32ProcMaxUs)
+            s_sStats.u32ProcMaxUs = s_sStats.u32ProcUs;
+
+        s_sStats.u32Processed++;
+        u32Count++;
+    }
+
+    /* Triggers that arrived while their sample module was still converting are lost samples */
+    u32Ov = EADC->OVSTS & ((1UL << s_sCfg.u32Channels) - 1UL);
+
+    if (u32Ov)
+    {
+        EADC_CLR_SAMPLE_MODULE_OV_FLAG(EADC, u32Ov);
+
+        while (u32Ov)
+        {
+            u32Ov &= u32Ov - 1UL;
+            s_sStats.u32SampleOverruns++;
+        }
+    }
+
+    return u32Count;
+}
+
+/**
+  * @brief      Read the counters
+  * @param[out] psStats     Counters since EADCACQ_Start()
+  * @return     None
+  * @details    u32ProcMaxUs over u32BlockUs is the worst processing load.
+  */
+void EADCACQ_GetStats(EADCACQ_STATS_T *psStats)
+{
+    *psStats = s_sStats;
+    psStats->u32Blocks = s_u32Done;
+    psStats->u32BlockUs = EADCACQ_CyclesToUs(s_u32BlockCycles);
+}
+
+/*@}*/ /* end of group EADCACQ_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
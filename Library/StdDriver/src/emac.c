@@ -112,7 +112,7 @@ typedef struct
 /** Tx/Rx buffer structure */
 typedef struct
 {
-    uint8_t au8Buf[1520];
+    uint8_t au8Buf[EMAC_FRAME_SIZE];
 } EMAC_FRAME_T;
 
 /*@}*/ /* end of group EMAC_EXPORTED_TYPEDEF */
@@ -632,6 +632,70 @@ void EMAC_RecvPktDone(void)
 }
 
 
+/**
+  * @brief Receive an Ethernet packet by exchanging buffers with the Rx descriptor
+  * @param[in] pu8Buf Pointer to a free, word aligned buffer of \ref EMAC_FRAME_SIZE bytes. It replaces
+  *                   the buffer of the received packet in the Rx descriptor.
+  * @param[out] pu32Size Received packet size (without 4 byte CRC).
+  * @return Pointer to the buffer holding the received packet, now owned by the application
+  * @retval NULL No packet available for receive, pu8Buf is still owned by the application
+  * @details Unlike \ref EMAC_RecvPkt, the packet is not copied. The descriptor is given back to EMAC
+  *          with pu8Buf attached, and the returned buffer can be passed to the next call once the
+  *          application is done with it. Frames received with error are dropped and their descriptors
+  *          given back to EMAC with the buffer they already hold.
+  * @note Do not mix this function with \ref EMAC_RecvPkt, \ref EMAC_RecvPktTS or \ref EMAC_RecvPktDone,
+  *       which expect the buffers set by \ref EMAC_Open.
+  */
+uint8_t *EMAC_RecvPktSwap(uint8_t *pu8Buf, uint32_t *pu32Size)
+{
+    EMAC_DESCRIPTOR_T *desc;
+    uint32_t status, reg;
+    uint8_t *pu8Pkt = NULL;
+
+    /* Clear Rx interrupt flags */
+    reg = EMAC->INTSTS;
+    EMAC->INTSTS = reg & 0xFFFFUL;  /* Clear all RX related interrupt status */
+
+    if (reg & EMAC_INTSTS_RXBEIF_Msk)
+    {
+        /* Bus error occurred, this is usually a bad sign about software bug and will occur again... */
+        while(1) {}
+    }
+
+    /* Get Rx Frame Descriptor */
+    desc = (EMAC_DESCRIPTOR_T *)u32CurrentRxDesc;
+
+    while((pu8Pkt == NULL) && ((desc->u32Status1 & EMAC_DESC_OWN_EMAC) != EMAC_DESC_OWN_EMAC))   /* ownership=CPU */
+    {
+        status = desc->u32Status1 >> 16;
+
+        /* If Rx frame is good, take its buffer and attach the free one */
+        if(status & EMAC_RXFD_RXGD)
+        {
+            /* lower 16 bit in descriptor status1 stores the Rx packet length */
+            *pu32Size = desc->u32Status1 & 0xFFFFUL;
+            pu8Pkt = (uint8_t *)desc->u32Backup1;
+            desc->u32Backup1 = (uint32_t)pu8Buf;
+        }
+
+        /* Restore descriptor link list and data pointer they will be overwrite if time stamp enabled */
+        desc->u32Data = desc->u32Backup1;
+        desc->u32Next = desc->u32Backup2;
+
+        /* Change ownership to DMA for next use */
+        desc->u32Status1 = EMAC_DESC_OWN_EMAC;
+
+        desc = (EMAC_DESCRIPTOR_T *)desc->u32Next;
+    }
+
+    /* Save last processed Rx descriptor */
+    u32CurrentRxDesc = (uint32_t)desc;
+
+    EMAC_TRIGGER_RX();
+
+    return(pu8Pkt);
+}
+
 /**
   * @brief Send an Ethernet packet
   * @param[in] pu8Data Pointer to a buffer holds the packet to transmit
@@ -673,6 +737,49 @@ uint32_t EMAC_SendPkt(uint8_t *pu8Data, uint32_t u32Size)
 }
 
 
+/**
+  * @brief Send an Ethernet packet by exchanging buffers with the Tx descriptor
+  * @param[in] pu8Data Pointer to a word aligned buffer of \ref EMAC_FRAME_SIZE bytes holding the packet.
+  *                    EMAC owns it from now on.
+  * @param[in] u32Size Packet size (without 4 byte CRC).
+  * @return Pointer to the buffer the Tx descriptor held before, now owned by the application
+  * @retval NULL Transmit failed due to descriptor unavailable, pu8Data is still owned by the application
+  * @details Unlike \ref EMAC_SendPkt, the packet is not copied. The buffer returned belongs to a packet
+  *          transmitted earlier (or is one set by \ref EMAC_Open) and is free for the next packet.
+  *          \ref EMAC_SendPktDone must still be called from the Tx interrupt service routine.
+  */
+uint8_t *EMAC_SendPktSwap(uint8_t *pu8Data, uint32_t u32Size)
+{
+    EMAC_DESCRIPTOR_T *desc;
+    uint8_t *pu8Free = NULL;
+
+    /* Get Tx frame descriptor */
+    desc = (EMAC_DESCRIPTOR_T *)u32NextTxDesc;
+
+    /* Check descriptor ownership */
+    if((desc->u32Status1 & EMAC_DESC_OWN_EMAC) != EMAC_DESC_OWN_EMAC)
+    {
+        pu8Free = (uint8_t *)desc->u32Backup1;
+
+        /* Attach the packet, the backup keeps it for EMAC_SendPktDone */
+        desc->u32Data = (uint32_t)pu8Data;
+        desc->u32Backup1 = (uint32_t)pu8Data;
+
+        /* Set Tx descriptor transmit byte count */
+        desc->u32Status2 = u32Size;
+
+        /* Change descriptor ownership to EMAC */
+        desc->u32Status1 |= EMAC_DESC_OWN_EMAC;
+
+        /* Get next Tx descriptor */
+        u32NextTxDesc = (uint32_t)(desc->u32Next);
+
+        /* Trigger EMAC to send the packet */
+        EMAC_TRIGGER_TX();
+    }
+    return(pu8Free);
+}
+
 /**
   * @brief Clean up process after packet(s) are sent
   * @param None
@@ -0,0 +1,931 @@
+/**************************************************************************//**
+ * @file     fbank.c
+ * @version  V1.00
+ * @brief    M480 series interleaved multi-channel filter bank source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include <math.h>
+#include "fbank.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup FBANK_Driver Filter Bank Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define FBANK_PI            3.14159265358979323846
+#define FBANK_LR_Q          0.70710678118654752440      /* Butterworth, two make a Linkwitz-Riley section */
+
+#ifndef ARM_MATH_CM0_FAMILY
+#define FBANK_SAT_Q15(x)    __SSAT((x), 16)
+#else
+#define FBANK_SAT_Q15(x)    clip_q31_to_q15(x)              /* arm_math.h's __SSAT() is a loop without the DSP extension */
+#endif
+
+/*
+ * RBJ audio EQ cookbook section, in double: sections far below the sample rate put their poles
+ * close to the unit circle and need more than float32_t to land there. CMSIS order and signs:
+ * y = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2].
+ */
+static int32_t FBANK_DesignSection(const FBANK_SECTION_T *psSection, double dFs, double *pdCoeffs)
+{
+    double dW, dCos, dAlpha, dA, dSqA, b0, b1, b2, a0, a1, a2;
+
+    if ((psSection->f32Freq <= 0.0f) || ((double)psSection->f32Freq >= dFs / 2.0) || (psSection->f32Q <= 0.0f))
+        return FBANK_ERR_PARAM;
+
+    dW = 2.0 * FBANK_PI * (double)psSection->f32Freq / dFs;
+    dCos = cos(dW);
+    dAlpha = sin(dW) / (2.0 * (double)psSection->f32Q);
+    dA = pow(10.0, (double)psSection->f32GainDb / 40.0);
+    dSqA = 2.0 * sqrt(dA) * dAlpha;
+
+    switch (psSection->u32Type)
+    {
+    case FBANK_LOWPASS:
+        b0 = (1.0 - dCos) / 2.0;
+        b1 = 1.0 - dCos;
+        b2 = b0;
+        a0 = 1.0 + dAlpha;
+        a1 = -2.0 * dCos;
+        a2 = 1.0 - dAlpha;
+        break;
+    case FBANK_HIGHPASS:
+        b0 = (1.0 + dCos) / 2.0;
+        b1 = -(1.0 + dCos);
+        b2 = b0;
+        a0 = 1.0 + dAlpha;
+        a1 = -2.0 * dCos;
+        a2 = 1.0 - dAlpha;
+        break;
+    case FBANK_BANDPASS:
+        b0 = dAlpha;
+        b1 = 0.0;
+        b2 = -dAlpha;
+        a0 = 1.0 + dAlpha;
+        a1 = -2.0 * dCos;
+        a2 = 1.0 - dAlpha;
+        break;
+    case FBANK_NOTCH:
+        b0 = 1.0;
+        b1 = -2.0 * dCos;
+        b2 = 1.0;
+        a0 = 1.0 + dAlpha;
+        a1 = -2.0 * dCos;
+        a2 = 1.0 - dAlpha;
+        break;
+    case FBANK_PEAK:
+        b0 = 1.0 + dAlpha * dA;
+        b1 = -2.0 * dCos;
+        b2 = 1.0 - dAlpha * dA;
+        a0 = 1.0 + dAlpha / dA;
+        a1 = -2.0 * dCos;
+        a2 = 1.0 - dAlpha / dA;
+        break;
+    case FBANK_LOWSHELF:
+        b0 = dA * ((dA + 1.0) - (dA - 1.0) * dCos + dSqA);
+        b1 = 2.0 * dA * ((dA - 1.0) - (dA + 1.0) * dCos);
+        b2 = dA * ((dA + 1.0) - (dA - 1.0) * dCos - dSqA);
+        a0 = (dA + 1.0) + (dA - 1.0) * dCos + dSqA;
+        a1 = -2.0 * ((dA - 1.0) + (dA + 1.0) * dCos);
+        a2 = (dA + 1.0) + (dA - 1.0) * dCos - dSqA;
+        break;
+    case FBANK_HIGHSHELF:
+        b0 = dA * ((dA + 1.0) + (dA - 1.0) * dCos + dSqA);
+        b1 = -2.0 * dA * ((dA - 1.0) + (dA + 1.0) * dCos);
+        b2 = dA * ((dA + 1.0) + (dA - 1.0) * dCos - dSqA);
+        a0 = (dA + 1.0) - (dA - 1.0) * dCos + dSqA;
+        a1 = 2.0 * ((dA - 1.0) - (dA + 1.0) * dCos);
+        a2 = (dA + 1.0) - (dA - 1.0) * dCos - dSqA;
+        break;
+    case FBANK_ALLPASS:
+        b0 = 1.0 - dAlpha;
+        b1 = -2.0 * dCos;
+        b2 = 1.0 + dAlpha;
+        a0 = 1.0 + dAlpha;
+        a1 = -2.0 * dCos;
+        a2 = 1.0 - dAlpha;
+        break;
+    default:
+        return FBANK_ERR_PARAM;
+    }
+
+    pdCoeffs[0] = b0 / a0;
+    pdCoeffs[1] = b1 / a0;
+    pdCoeffs[2] = b2 / a0;
+    pdCoeffs[3] = -a1 / a0;
+    pdCoeffs[4] = -a2 / a0;
+    return FBANK_OK;
+}
+
+/*
+ * Quantizes the u32Stages sections of pdCoeffs into band u32Band with the smallest post shift
+ * that fits the largest coefficient. The state is kept when only the coefficients change, so a
+ * running equalizer can be retuned without a click; a new section count starts from silence.
+ */
+static void FBANK_Load(FBANK_T *psBank, uint32_t u32Band, const double *pdCoeffs, uint32_t u32Stages)
+{
+    double dMax = 0.0, dFull, dScale;
+    uint32_t i, u32Shift = 0UL;
+    FBANK_BIQUAD_Q31_T *psQ31 = &psBank->uBiquad.asQ31[u32Band];
+    FBANK_BIQUAD_Q15_T *psQ15 = &psBank->uBiquad.asQ15[u32Band];
+    q31_t *pq31C = psBank->uCoeffs.aq31[u32Band];
+    q15_t *pq15C = psBank->uCoeffs.aq15[u32Band];
+
+    for (i = 0UL; i < 5UL * u32Stages; i++)
+    {
+        if (fabs(pdCoeffs[i]) > dMax)
+            dMax = fabs(pdCoeffs[i]);
+    }
+    /* The largest coefficient must not round up to +1.0, one step above the largest Q value */
+    dFull = (psBank->u32Fmt == FBANK_Q31) ? 2147483648.0 : 32768.0;
+    while ((floor(dMax * dFull / (double)(1UL << u32Shift) + 0.5) >= dFull) && (u32Shift < 7UL))
+        u32Shift++;
+    dScale = dFull / (double)(1UL << u32Shift);
+
+    for (i = 0UL; i < 5UL * u32Stages; i++)
+    {
+        if (psBank->u32Fmt == FBANK_Q31)
+        {
+            pq31C[i] = (q31_t)floor(pdCoeffs[i] * dScale + 0.5);
+        }
+        else
+        {
+            /* {b0, 0, b1, b2, a1, a2} */
+            *pq15C++ = (q15_t)floor(pdCoeffs[i] * dScale + 0.5);
+            if ((i % 5UL) == 0UL)
+                *pq15C++ = 0;
+        }
+    }
+
+    if (psBank->u32Fmt == FBANK_Q31)
+    {
+        if (psQ31->u8Stages != u32Stages)
+            FBANK_BiquadInitQ31(psQ31, (uint8_t)psBank->u32Channels, (uint8_t)u32Stages, psBank->uCoeffs.aq31[u32Band],
+                                psBank->uState.aq31[u32Band], (uint8_t)u32Shift);
+        psQ31->u8PostShift = (uint8_t)u32Shift;
+    }
+    else
+    {
+        if (psQ15->u8Stages != u32Stages)
+            FBANK_BiquadInitQ15(psQ15, (uint8_t)psBank->u32Channels, (uint8_t)u32Stages, psBank->uCoeffs.aq15[u32Band],
+                                psBank->uState.aq15[u32Band], (uint8_t)u32Shift);
+        psQ15->u8PostShift = (uint8_t)u32Shift;
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief      Set up an interleaved Q31 biquad cascade
+  * @param[out] psS             Cascade instance
+  * @param[in]  u8Channels      Channels filtered, the first u8Channels samples of each frame
+  * @param[in]  u8Stages        Biquad sections
+  * @param[in]  pq31Coeffs      u8Stages x {b0, b1, b2, a1, a2} scaled down by 2^u8PostShift, as for
+  *                             arm_biquad_cascade_df1_init_q31(). Used by all channels.
+  * @param[in]  pq31State       FBANK_BIQUAD_STATE_LEN(u8Channels, u8Stages) q31_t, cleared here
+  * @param[in]  u8PostShift     Coefficient scale
+  */
+void FBANK_BiquadInitQ31(FBANK_BIQUAD_Q31_T *psS, uint8_t u8Channels, uint8_t u8Stages, const q31_t *pq31Coeffs,
+                         q31_t *pq31State, uint8_t u8PostShift)
+{
+    psS->u8Channels = u8Channels;
+    psS->u8Stages = u8Stages;
+    psS->u8PostShift = u8PostShift;
+    psS->pq31Coeffs = pq31Coeffs;
+    psS->pq31State = pq31State;
+    memset(pq31State, 0, FBANK_BIQUAD_STATE_LEN(u8Channels, u8Stages) * sizeof(q31_t));
+}
+
+/**
+  * @brief      Filter interleaved Q31 frames with a biquad cascade
+  * @param[in]  psS             Cascade instance
+  * @param[in]  pq31Src         First source frame
+  * @param[in]  u32SrcStride    Samples from one source frame to the next, at least psS->u8Channels
+  * @param[out] pq31Dst         First destination frame, may be pq31Src with the same stride
+  * @param[in]  u32DstStride    Samples from one destination frame to the next
+  * @param[in]  u32Frames       Frames to filter
+  * @details    Section by section, the channels are filtered two at a time: the section's coefficients
+  *             are loaded once for both and the state of both stays in registers for the whole block.
+  *             The first section reads the source and the others filter the destination in place.
+  *             Other samples of the destination frames are left alone. Without sections the channels
+  *             are copied.
+  */
+void FBANK_BiquadQ31(const FBANK_BIQUAD_Q31_T *psS, const q31_t *pq31Src, uint32_t u32SrcStride,
+                     q31_t *pq31Dst, uint32_t u32DstStride, uint32_t u32Frames)
+{
+    const q31_t *pq31C = psS->pq31Coeffs, *pq31In;
+    q31_t *pq31St = psS->pq31State, *pq31Out;
+    q31_t b0, b1, b2, a1, a2, x0, x1, x2, y1, y2, u0, u1, u2, v1, v2;
+    q63_t acc, acc2;
+    uint32_t u32Stage, u32Ch, u32Stride, n, u32Shift = 31UL - psS->u8PostShift;
+
+    if (psS->u8Stages == 0U)
+    {
+        for (n = 0UL; (n < u32Frames) && (pq31Src != pq31Dst); n++)
+            memcpy(&pq31Dst[n * u32DstStride], &pq31Src[n * u32SrcStride], psS->u8Channels * sizeof(q31_t));
+        return;
+    }
+
+    for (u32Stage = 0UL; u32Stage < psS->u8Stages; u32Stage++)
+    {
+        b0 = pq31C[0];
+        b1 = pq31C[1];
+        b2 = pq31C[2];
+        a1 = pq31C[3];
+        a2 = pq31C[4];
+        pq31C += 5;
+        u32Stride = (u32Stage == 0UL) ? u32SrcStride : u32DstStride;
+
+        for (u32Ch = 0UL; u32Ch < psS->u8Channels; u32Ch += 2UL)
+        {
+            pq31In = (u32Stage == 0UL) ? &pq31Src[u32Ch] : &pq31Dst[u32Ch];
+            pq31Out = &pq31Dst[u32Ch];
+
+            x1 = pq31St[0];
+            x2 = pq31St[1];
+            y1 = pq31St[2];
+            y2 = pq31St[3];
+
+            if (u32Ch + 1UL < psS->u8Channels)
+            {
+                u1 = pq31St[4];
+                u2 = pq31St[5];
+                v1 = pq31St[6];
+                v2 = pq31St[7];
+
+                for (n = u32Frames; n > 0UL; n--)
+                {
+                    x0 = pq31In[0];
+                    u0 = pq31In[1];
+                    pq31In += u32Stride;
+
+                    acc = (q63_t)b0 * x0 + (q63_t)b1 * x1 + (q63_t)b2 * x2 + (q63_t)a1 * y1 + (q63_t)a2 * y2;
+                    acc2 = (q63_t)b0 * u0 + (q63_t)b1 * u1 + (q63_t)b2 * u2 + (q63_t)a1 * v1 + (q63_t)a2 * v2;
+                    x2 = x1;
+                    x1 = x0;
+                    y2 = y1;
+                    y1 = clip_q63_to_q31(acc >> u32Shift);
+                    u2 = u1;
+                    u1 = u0;
+                    v2 = v1;
+                    v1 = clip_q63_to_q31(acc2 >> u32Shift);
+
+                    pq31Out[0] = y1;
+                    pq31Out[1] = v1;
+                    pq31Out += u32DstStride;
+                }
+
+                pq31St[4] = u1;
+                pq31St[5] = u2;
+                pq31St[6] = v1;
+                pq31St[7] = v2;
+            }
+            else
+            {
+                for (n = u32Frames; n > 0UL; n--)
+                {
+                    x0 = *pq31In;
+                    pq31In += u32Stride;
+
+                    acc = (q63_t)b0 * x0 + (q63_t)b1 * x1 + (q63_t)b2 * x2 + (q63_t)a1 * y1 + (q63_t)a2 * y2;
+                    x2 = x1;
+                    x1 = x0;
+                    y2 = y1;
+                    y1 = clip_q63_to_q31(acc >> u32Shift);
+
+                    *pq31Out = y1;
+                    pq31Out += u32DstStride;
+                }
+            }
+
+            pq31St[0] = x1;
+            pq31St[1] = x2;
+            pq31St[2] = y1;
+            pq31St[3] = y2;
+            pq31St += (u32Ch + 1UL < psS->u8Channels) ? 8UL : 4UL;
+        }
+    }
+}
+
+/**
+  * @brief      Set up an interleaved Q15 biquad cascade
+  * @param[out] psS             Cascade instance
+  * @param[in]  u8Channels      Channels filtered, the first u8Channels samples of each frame
+  * @param[in]  u8Stages        Biquad sections
+  * @param[in]  pq15Coeffs      u8Stages x {b0, 0, b1, b2, a1, a2} scaled down by 2^u8PostShift, as for
+  *                             arm_biquad_cascade_df1_init_q15(). Used by all channels.
+  * @param[in]  pq15State       FBANK_BIQUAD_STATE_LEN(u8Channels, u8Stages) q15_t, cleared here
+  * @param[in]  u8PostShift     Coefficient scale
+  */
+void FBANK_BiquadInitQ15(FBANK_BIQUAD_Q15_T *psS, uint8_t u8Channels, uint8_t u8Stages, const q15_t *pq15Coeffs,
+                         q15_t *pq15State, uint8_t u8PostShift)
+{
+    psS->u8Channels = u8Channels;
+    psS->u8Stages = u8Stages;
+    psS->u8PostShift = u8PostShift;
+    psS->pq15Coeffs = pq15Coeffs;
+    psS->pq15State = pq15State;
+    memset(pq15State, 0, FBANK_BIQUAD_STATE_LEN(u8Channels, u8Stages) * sizeof(q15_t));
+}
+
+/**
+  * @brief      Filter interleaved Q15 frames with a biquad cascade
+  * @param[in]  psS             Cascade instance
+  * @param[in]  pq15Src         First source frame
+  * @param[in]  u32SrcStride    Samples from one source frame to the next, at least psS->u8Channels
+  * @param[out] pq15Dst         First destination frame, may be pq15Src with the same stride
+  * @param[in]  u32DstStride    Samples from one destination frame to the next
+  * @param[in]  u32Frames       Frames to filter
+  * @details    As FBANK_BiquadQ31(). On the Cortex-M4 {b1, b2} and {a1, a2} are packed for the dual
+  *             16-bit MACs as in arm_biquad_cascade_df1_q15(). Products are summed in 64 bits and the
+  *             result saturates.
+  */
+void FBANK_BiquadQ15(const FBANK_BIQUAD_Q15_T *psS, const q15_t *pq15Src, uint32_t u32SrcStride,
+                     q15_t *pq15Dst, uint32_t u32DstStride, uint32_t u32Frames)
+{
+    const q15_t *pq15C = psS->pq15Coeffs, *pq15In;
+    q15_t *pq15St = psS->pq15State, *pq15Out;
+    q63_t acc, acc2;
+    uint32_t u32Stage, u32Ch, u32Stride, n, u32Shift = 15UL - psS->u8PostShift;
+#ifndef ARM_MATH_CM0_FAMILY
+    q31_t q31B0, q31B12, q31A12, q31X, q31Y, q31U, q31V, x0, y0, u0, v0;
+#else
+    q31_t b0, b1, b2, a1, a2, x0, x1, x2, y1, y2, u0, u1, u2, v1, v2;
+#endif
+
+    if (psS->u8Stages == 0U)
+    {
+        for (n = 0UL; (n < u32Frames) && (pq15Src != pq15Dst); n++)
+            memcpy(&pq15Dst[n * u32DstStride], &pq15Src[n * u32SrcStride], psS->u8Channels * sizeof(q15_t));
+        return;
+    }
+
+    for (u32Stage = 0UL; u32Stage < psS->u8Stages; u32Stage++)
+    {
+#ifndef ARM_MATH_CM0_FAMILY
+        /* Packed as arm_biquad_cascade_df1_q15() does: {b1, b2} and {a1, a2} are one dual MAC each */
+        q31B0 = pq15C[0];
+        q31B12 = __PKHBT(pq15C[2], pq15C[3], 16);
+        q31A12 = __PKHBT(pq15C[4], pq15C[5], 16);
+#else
+        b0 = pq15C[0];
+        b1 = pq15C[2];
+        b2 = pq15C[3];
+        a1 = pq15C[4];
+        a2 = pq15C[5];
+#endif
+        pq15C += 6;
+        u32Stride = (u32Stage == 0UL) ? u32SrcStride : u32DstStride;
+
+        for (u32Ch = 0UL; u32Ch < psS->u8Channels; u32Ch += 2UL)
+        {
+            pq15In = (u32Stage == 0UL) ? &pq15Src[u32Ch] : &pq15Dst[u32Ch];
+            pq15Out = &pq15Dst[u32Ch];
+
+#ifndef ARM_MATH_CM0_FAMILY
+            /* {x[n-1], x[n-2]} and {y[n-1], y[n-2]} of the first channel, {u..}, {v..} of the second */
+            q31X = __PKHBT(pq15St[0], pq15St[1], 16);
+            q31Y = __PKHBT(pq15St[2], pq15St[3], 16);
+
+            if (u32Ch + 1UL < psS->u8Channels)
+            {
+                q31U = __PKHBT(pq15St[4], pq15St[5], 16);
+                q31V = __PKHBT(pq15St[6], pq15St[7], 16);
+
+                for (n = u32Frames; n > 0UL; n--)
+                {
+                    x0 = pq15In[0];
+                    u0 = pq15In[1];
+                    pq15In += u32Stride;
+
+                    acc = (q63_t)__SMLALD((uint32_t)q31B12, (uint32_t)q31X, (uint64_t)(q63_t)(q31B0 * x0));
+                    acc = (q63_t)__SMLALD((uint32_t)q31A12, (uint32_t)q31Y, (uint64_t)acc);
+                    acc2 = (q63_t)__SMLALD((uint32_t)q31B12, (uint32_t)q31U, (uint64_t)(q63_t)(q31B0 * u0));
+                    acc2 = (q63_t)__SMLALD((uint32_t)q31A12, (uint32_t)q31V, (uint64_t)acc2);
+                    y0 = FBANK_SAT_Q15((q31_t)(acc >> u32Shift));
+                    v0 = FBANK_SAT_Q15((q31_t)(acc2 >> u32Shift));
+
+                    q31X = __PKHBT(x0, q31X, 16);
+                    q31Y = __PKHBT(y0, q31Y, 16);
+                    q31U = __PKHBT(u0, q31U, 16);
+                    q31V = __PKHBT(v0, q31V, 16);
+
+                    pq15Out[0] = (q15_t)y0;
+                    pq15Out[1] = (q15_t)v0;
+                    pq15Out += u32DstStride;
+                }
+
+                pq15St[4] = (q15_t)q31U;
+                pq15St[5] = (q15_t)(q31U >> 16);
+                pq15St[6] = (q15_t)q31V;
+                pq15St[7] = (q15_t)(q31V >> 16);
+            }
+            else
+            {
+                for (n = u32Frames; n > 0UL; n--)
+                {
+                    x0 = *pq15In;
+                    pq15In += u32Stride;
+
+                    acc = (q63_t)__SMLALD((uint32_t)q31B12, (uint32_t)q31X, (uint64_t)(q63_t)(q31B0 * x0));
+                    acc = (q63_t)__SMLALD((uint32_t)q31A12, (uint32_t)q31Y, (uint64_t)acc);
+                    y0 = FBANK_SAT_Q15((q31_t)(acc >> u32Shift));
+
+                    q31X = __PKHBT(x0, q31X, 16);
+                    q31Y = __PKHBT(y0, q31Y, 16);
+
+                    *pq15Out = (q15_t)y0;
+                    pq15Out += u32DstStride;
+                }
+            }
+
+            pq15St[0] = (q15_t)q31X;
+            pq15St[1] = (q15_t)(q31X >> 16);
+            pq15St[2] = (q15_t)q31Y;
+            pq15St[3] = (q15_t)(q31Y >> 16);
+#else
+            x1 = pq15St[0];
+            x2 = pq15St[1];
+            y1 = pq15St[2];
+            y2 = pq15St[3];
+
+            if (u32Ch + 1UL < psS->u8Channels)
+            {
+                u1 = pq15St[4];
+                u2 = pq15St[5];
+                v1 = pq15St[6];
+                v2 = pq15St[7];
+
+                for (n = u32Frames; n > 0UL; n--)
+                {
+                    x0 = pq15In[0];
+                    u0 = pq15In[1];
+                    pq15In += u32Stride;
+
+                    acc = (q63_t)(b0 * x0) + (b1 * x1) + (b2 * x2) + (a1 * y1) + (a2 * y2);
+                    acc2 = (q63_t)(b0 * u0) + (b1 * u1) + (b2 * u2) + (a1 * v1) + (a2 * v2);
+                    x2 = x1;
+                    x1 = x0;
+                    y2 = y1;
+                    y1 = FBANK_SAT_Q15((q31_t)(acc >> u32Shift));
+                    u2 = u1;
+                    u1 = u0;
+                    v2 = v1;
+                    v1 = FBANK_SAT_Q15((q31_t)(acc2 >> u32Shift));
+
+                    pq15Out[0] = (q15_t)y1;
+                    pq15Out[1] = (q15_t)v1;
+                    pq15Out += u32DstStride;
+                }
+
+                pq15St[4] = (q15_t)u1;
+                pq15St[5] = (q15_t)u2;
+                pq15St[6] = (q15_t)v1;
+                pq15St[7] = (q15_t)v2;
+            }
+            else
+            {
+                for (n = u32Frames; n > 0UL; n--)
+                {
+                    x0 = *pq15In;
+                    pq15In += u32Stride;
+
+                    acc = (q63_t)(b0 * x0) + (b1 * x1) + (b2 * x2) + (a1 * y1) + (a2 * y2);
+                    x2 = x1;
+                    x1 = x0;
+                    y2 = y1;
+                    y1 = FBANK_SAT_Q15((q31_t)(acc >> u32Shift));
+
+                    *pq15Out = (q15_t)y1;
+                    pq15Out += u32DstStride;
+                }
+            }
+
+            pq15St[0] = (q15_t)x1;
+            pq15St[1] = (q15_t)x2;
+            pq15St[2] = (q15_t)y1;
+            pq15St[3] = (q15_t)y2;
+#endif
+            pq15St += (u32Ch + 1UL < psS->u8Channels) ? 8UL : 4UL;
+        }
+    }
+}
+
+/**
+  * @brief      Set up an interleaved Q31 FIR filter
+  * @param[out] psS             Filter instance
+  * @param[in]  u8Channels      Channels filtered, the first u8Channels samples of each frame
+  * @param[in]  u16Taps         Coefficients
+  * @param[in]  pq31Coeffs      u16Taps coefficients, time reversed as for arm_fir_init_q31(). Used by all channels.
+  * @param[in]  pq31State       FBANK_FIR_STATE_LEN(u8Channels, u16Taps, u32MaxFrames) q31_t, cleared here
+  * @param[in]  u32MaxFrames    Most frames per FBANK_FirQ31() call
+  */
+void FBANK_FirInitQ31(FBANK_FIR_Q31_T *psS, uint8_t u8Channels, uint16_t u16Taps, const q31_t *pq31Coeffs,
+                      q31_t *pq31State, uint32_t u32MaxFrames)
+{
+    psS->u8Channels = u8Channels;
+    psS->u16Taps = u16Taps;
+    psS->u32MaxFrames = u32MaxFrames;
+    psS->pq31Coeffs = pq31Coeffs;
+    psS->pq31State = pq31State;
+    memset(pq31State, 0, FBANK_FIR_STATE_LEN(u8Channels, u16Taps, u32MaxFrames) * sizeof(q31_t));
+}
+
+/**
+  * @brief      Filter interleaved Q31 frames with an FIR filter
+  * @param[in]  psS             Filter instance
+  * @param[in]  pq31Src         First source frame
+  * @param[in]  u32SrcStride    Samples from one source frame to the next, at least psS->u8Channels
+  * @param[out] pq31Dst         First destination frame, may be pq31Src
+  * @param[in]  u32DstStride    Samples from one destination frame to the next
+  * @param[in]  u32Frames       Frames to filter, at most psS->u32MaxFrames
+  * @details    Each channel keeps its history in one piece of the state, and its new samples are
+  *             gathered straight from the frames into it. The filter then computes four outputs per
+  *             pass: each coefficient and each history sample is loaded once for the four, whose
+  *             64-bit sums and the three samples they share stay in registers.
+  */
+void FBANK_FirQ31(const FBANK_FIR_Q31_T *psS, const q31_t *pq31Src, uint32_t u32SrcStride,
+                  q31_t *pq31Dst, uint32_t u32DstStride, uint32_t u32Frames)
+{
+    uint32_t u32Taps = psS->u16Taps, u32Len = u32Taps - 1UL + psS->u32MaxFrames;
+    uint32_t n, k, c;
+    q31_t *pq31Hist, *pq31Out, q31C, x0, x1, x2, x3;
+    const q31_t *pq31In, *pq31C, *pq31X;
+    q63_t acc0, acc1, acc2, acc3;
+
+    for (c = 0UL; c < psS->u8Channels; c++)
+    {
+        pq31Hist = &psS->pq31State[c * u32Len];
+        pq31In = &pq31Src[c];
+        for (n = 0UL; n < u32Frames; n++)
+        {
+            pq31Hist[u32Taps - 1UL + n] = *pq31In;
+            pq31In += u32SrcStride;
+        }
+
+        pq31Out = &pq31Dst[c];
+        for (n = 0UL; n + 4UL <= u32Frames; n += 4UL)
+        {
+            pq31C = psS->pq31Coeffs;
+            pq31X = &pq31Hist[n];
+            x0 = pq31X[0];
+            x1 = pq31X[1];
+            x2 = pq31X[2];
+            pq31X += 3;
+            acc0 = acc1 = acc2 = acc3 = 0;
+            for (k = u32Taps; k > 0UL; k--)
+            {
+                q31C = *pq31C++;
+                x3 = *pq31X++;
+                acc0 += (q63_t)q31C * x0;
+                acc1 += (q63_t)q31C * x1;
+                acc2 += (q63_t)q31C * x2;
+                acc3 += (q63_t)q31C * x3;
+                x0 = x1;
+                x1 = x2;
+                x2 = x3;
+            }
+            pq31Out[0] = clip_q63_to_q31(acc0 >> 31);
+            pq31Out[u32DstStride] = clip_q63_to_q31(acc1 >> 31);
+            pq31Out[2UL * u32DstStride] = clip_q63_to_q31(acc2 >> 31);
+            pq31Out[3UL * u32DstStride] = clip_q63_to_q31(acc3 >> 31);
+            pq31Out += 4UL * u32DstStride;
+        }
+        for (; n < u32Frames; n++)
+        {
+            pq31C = psS->pq31Coeffs;
+            pq31X = &pq31Hist[n];
+            acc0 = 0;
+            for (k = u32Taps; k > 0UL; k--)
+                acc0 += (q63_t)*pq31C++ * *pq31X++;
+            *pq31Out = clip_q63_to_q31(acc0 >> 31);
+            pq31Out += u32DstStride;
+        }
+
+        memmove(pq31Hist, &pq31Hist[u32Frames], (u32Taps - 1UL) * sizeof(q31_t));
+    }
+}
+
+/**
+  * @brief      Set up an interleaved Q15 FIR filter
+  * @param[out] psS             Filter instance
+  * @param[in]  u8Channels      Channels filtered, the first u8Channels samples of each frame
+  * @param[in]  u16Taps         Coefficients
+  * @param[in]  pq15Coeffs      u16Taps coefficients, time reversed as for arm_fir_init_q15(). Used by all channels.
+  * @param[in]  pq15State       FBANK_FIR_STATE_LEN(u8Channels, u16Taps, u32MaxFrames) q15_t, cleared here
+  * @param[in]  u32MaxFrames    Most frames per FBANK_FirQ15() call
+  */
+void FBANK_FirInitQ15(FBANK_FIR_Q15_T *psS, uint8_t u8Channels, uint16_t u16Taps, const q15_t *pq15Coeffs,
+                      q15_t *pq15State, uint32_t u32MaxFrames)
+{
+    psS->u8Channels = u8Channels;
+    psS->u16Taps = u16Taps;
+    psS->u32MaxFrames = u32MaxFrames;
+    psS->pq15Coeffs = pq15Coeffs;
+    psS->pq15State = pq15State;
+    memset(pq15State, 0, FBANK_FIR_STATE_LEN(u8Channels, u16Taps, u32MaxFrames) * sizeof(q15_t));
+}
+
+/**
+  * @brief      Filter interleaved Q15 frames with an FIR filter
+  * @param[in]  psS             Filter instance
+  * @param[in]  pq15Src         First source frame
+  * @param[in]  u32SrcStride    Samples from one source frame to the next, at least psS->u8Channels
+  * @param[out] pq15Dst         First destination frame, may be pq15Src
+  * @param[in]  u32DstStride    Samples from one destination frame to the next
+  * @param[in]  u32Frames       Frames to filter, at most psS->u32MaxFrames
+  * @details    As FBANK_FirQ31(). On the Cortex-M4 the taps go in pairs through the dual 16-bit MACs,
+  *             as in arm_fir_q15(). Products are summed in 64 bits and the result saturates.
+  */
+void FBANK_FirQ15(const FBANK_FIR_Q15_T *psS, const q15_t *pq15Src, uint32_t u32SrcStride,
+                  q15_t *pq15Dst, uint32_t u32DstStride, uint32_t u32Frames)
+{
+    uint32_t u32Taps = psS->u16Taps, u32Len = u32Taps - 1UL + psS->u32MaxFrames;
+    uint32_t n, k, c;
+    q15_t *pq15Hist, *pq15Out;
+    const q15_t *pq15In, *pq15C, *pq15X;
+    q31_t q31C, x0, x1, x2, x3;
+    q63_t acc0, acc1, acc2, acc3;
+
+    for (c = 0UL; c < psS->u8Channels; c++)
+    {
+        pq15Hist = &psS->pq15State[c * u32Len];
+        pq15In = &pq15Src[c];
+        for (n = 0UL; n < u32Frames; n++)
+        {
+            pq15Hist[u32Taps - 1UL + n] = *pq15In;
+            pq15In += u32SrcStride;
+        }
+
+        pq15Out = &pq15Dst[c];
+        for (n = 0UL; n + 4UL <= u32Frames; n += 4UL)
+        {
+            pq15C = psS->pq15Coeffs;
+            pq15X = &pq15Hist[n];
+            acc0 = acc1 = acc2 = acc3 = 0;
+#ifndef ARM_MATH_CM0_FAMILY
+            /* {x[k], x[k+1]} of the four outputs, two taps per dual MAC */
+            x0 = _SIMD32_OFFSET(pq15X);
+            x1 = _SIMD32_OFFSET(pq15X + 1);
+            for (k = u32Taps >> 1; k > 0UL; k--)
+            {
+                q31C = _SIMD32_OFFSET(pq15C);
+                pq15C += 2;
+                x2 = _SIMD32_OFFSET(pq15X + 2);
+                x3 = _SIMD32_OFFSET(pq15X + 3);
+                pq15X += 2;
+                acc0 = (q63_t)__SMLALD((uint32_t)q31C, (uint32_t)x0, (uint64_t)acc0);
+                acc1 = (q63_t)__SMLALD((uint32_t)q31C, (uint32_t)x1, (uint64_t)acc1);
+                acc2 = (q63_t)__SMLALD((uint32_t)q31C, (uint32_t)x2, (uint64_t)acc2);
+                acc3 = (q63_t)__SMLALD((uint32_t)q31C, (uint32_t)x3, (uint64_t)acc3);
+                x0 = x2;
+                x1 = x3;
+            }
+            if (u32Taps & 1UL)
+            {
+                q31C = *pq15C;
+                acc0 += q31C * pq15X[0];
+                acc1 += q31C * pq15X[1];
+                acc2 += q31C * pq15X[2];
+                acc3 += q31C * pq15X[3];
+            }
+#else
+            x0 = pq15X[0];
+            x1 = pq15X[1];
+            x2 = pq15X[2];
+            pq15X += 3;
+            for (k = u32Taps; k > 0UL; k--)
+            {
+                q31C = *pq15C++;
+                x3 = *pq15X++;
+                acc0 += q31C * x0;
+                acc1 += q31C * x1;
+                acc2 += q31C * x2;
+                acc3 += q31C * x3;
+                x0 = x1;
+                x1 = x2;
+                x2 = x3;
+            }
+#endif
+            pq15Out[0] = (q15_t)FBANK_SAT_Q15((q31_t)(acc0 >> 15));
+            pq15Out[u32DstStride] = (q15_t)FBANK_SAT_Q15((q31_t)(acc1 >> 15));
+            pq15Out[2UL * u32DstStride] = (q15_t)FBANK_SAT_Q15((q31_t)(acc2 >> 15));
+            pq15Out[3UL * u32DstStride] = (q15_t)FBANK_SAT_Q15((q31_t)(acc3 >> 15));
+            pq15Out += 4UL * u32DstStride;
+        }
+        for (; n < u32Frames; n++)
+        {
+            pq15C = psS->pq15Coeffs;
+            pq15X = &pq15Hist[n];
+            acc0 = 0;
+            for (k = u32Taps; k > 0UL; k--)
+                acc0 += (q31_t)*pq15C++ * *pq15X++;
+            *pq15Out = (q15_t)FBANK_SAT_Q15((q31_t)(acc0 >> 15));
+            pq15Out += u32DstStride;
+        }
+
+        memmove(pq15Hist, &pq15Hist[u32Frames], (u32Taps - 1UL) * sizeof(q15_t));
+    }
+}
+
+/**
+  * @brief      Design a biquad section
+  * @param[in]  psSection       Section type and parameters
+  * @param[in]  f32SampleRate   Hz
+  * @param[out] pf32Coeffs      {b0, b1, b2, a1, a2} in CMSIS order and signs, e.g. for
+  *                             arm_biquad_cascade_df1_f32()
+  * @retval     FBANK_OK        Success
+  * @retval     FBANK_ERR_PARAM Unknown type, frequency not below half the sample rate or Q not positive
+  */
+int32_t FBANK_Design(const FBANK_SECTION_T *psSection, float32_t f32SampleRate, float32_t *pf32Coeffs)
+{
+    double adCoeffs[5];
+    uint32_t i;
+
+    if (FBANK_DesignSection(psSection, (double)f32SampleRate, adCoeffs) != FBANK_OK)
+        return FBANK_ERR_PARAM;
+
+    for (i = 0UL; i < 5UL; i++)
+        pf32Coeffs[i] = (float32_t)adCoeffs[i];
+    return FBANK_OK;
+}
+
+/**
+  * @brief      Open a filter bank
+  * @param[out] psBank          Filter bank instance
+  * @param[in]  u32Fmt          Sample format, FBANK_Q31 or FBANK_Q15
+  * @param[in]  u32Channels     Channels, 1 ~ FBANK_MAX_CH: the first u32Channels samples of each frame
+  * @param[in]  f32SampleRate   Frame rate, Hz
+  * @retval     FBANK_OK        Success
+  * @retval     FBANK_ERR_PARAM Invalid parameter
+  * @details    The bank starts as an equalizer without sections, which copies the channels.
+  */
+int32_t FBANK_Open(FBANK_T *psBank, uint32_t u32Fmt, uint32_t u32Channels, float32_t f32SampleRate)
+{
+    uint32_t u32Band;
+
+    if ((psBank == NULL) || (u32Fmt > FBANK_Q15) || (u32Channels == 0UL) || (u32Channels > FBANK_MAX_CH) ||
+            (f32SampleRate <= 0.0f))
+        return FBANK_ERR_PARAM;
+
+    memset(psBank, 0, sizeof(FBANK_T));
+    psBank->u32Fmt = u32Fmt;
+    psBank->u32Channels = u32Channels;
+    psBank->u32Bands = 1UL;
+    psBank->f32SampleRate = f32SampleRate;
+    for (u32Band = 0UL; u32Band < FBANK_MAX_BANDS; u32Band++)
+    {
+        if (u32Fmt == FBANK_Q31)
+            FBANK_BiquadInitQ31(&psBank->uBiquad.asQ31[u32Band], (uint8_t)u32Channels, 0U,
+                                psBank->uCoeffs.aq31[u32Band], psBank->uState.aq31[u32Band], 0U);
+        else
+            FBANK_BiquadInitQ15(&psBank->uBiquad.asQ15[u32Band], (uint8_t)u32Channels, 0U,
+                                psBank->uCoeffs.aq15[u32Band], psBank->uState.aq15[u32Band], 0U);
+    }
+    return FBANK_OK;
+}
+
+/**
+  * @brief      Make a filter bank an equalizer
+  * @param[in]  psBank          Filter bank instance
+  * @param[in]  psSections      Sections, applied in order to every channel
+  * @param[in]  u32Sections     Sections at psSections, 0 ~ FBANK_MAX_STAGES
+  * @retval     FBANK_OK        Success
+  * @retval     FBANK_ERR_PARAM Invalid section; the bank is unchanged
+  * @details    Retuning with the same number of sections keeps the filter state. Boosts need
+  *             headroom in the signal: the output saturates. Not to be called during FBANK_Process().
+  */
+int32_t FBANK_SetEQ(FBANK_T *psBank, const FBANK_SECTION_T *psSections, uint32_t u32Sections)
+{
+    double adCoeffs[5UL * FBANK_MAX_STAGES];
+    uint32_t i;
+
+    if (u32Sections > FBANK_MAX_STAGES)
+        return FBANK_ERR_PARAM;
+    for (i = 0UL; i < u32Sections; i++)
+    {
+        if (FBANK_DesignSection(&psSections[i], (double)psBank->f32SampleRate, &adCoeffs[5UL * i]) != FBANK_OK)
+            return FBANK_ERR_PARAM;
+    }
+
+    if (psBank->u32Bands != 1UL)
+    {
+        FBANK_Reset(psBank);
+        psBank->u32Bands = 1UL;
+    }
+    FBANK_Load(psBank, 0UL, adCoeffs, u32Sections);
+    return FBANK_OK;
+}
+
+/**
+  * @brief      Make a filter bank a Linkwitz-Riley crossover
+  * @param[in]  psBank          Filter bank instance
+  * @param[in]  pf32Freq        u32Bands - 1 crossover frequencies, ascending, Hz
+  * @param[in]  u32Bands        Bands, 2 ~ FBANK_MAX_BANDS
+  * @retval     FBANK_OK        Success
+  * @retval     FBANK_ERR_PARAM Invalid frequencies or band count; the bank is unchanged
+  * @details    Fourth order (24 dB/octave) Linkwitz-Riley splits: the bands are in phase at each
+  *             crossover and their sum is flat. Each band is computed from the input with the high
+  *             passes of the crossovers below it, the low pass of its upper crossover and all passes
+  *             matching the crossovers above it, so a band of the sum sees every crossover once.
+  */
+int32_t FBANK_SetCrossover(FBANK_T *psBank, const float32_t *pf32Freq, uint32_t u32Bands)
+{
+    double adCoeffs[5UL * FBANK_MAX_STAGES];
+    FBANK_SECTION_T sSection;
+    uint32_t u32Band, j, u32Stages;
+
+    if ((u32Bands < 2UL) || (u32Bands > FBANK_MAX_BANDS) || (2UL * (u32Bands - 1UL) > FBANK_MAX_STAGES))
+        return FBANK_ERR_PARAM;
+    for (j = 0UL; j < u32Bands - 1UL; j++)
+    {
+        if ((pf32Freq[j] <= 0.0f) || (2.0f * pf32Freq[j] >= psBank->f32SampleRate) ||
+                ((j > 0UL) && (pf32Freq[j] <= pf32Freq[j - 1UL])))
+            return FBANK_ERR_PARAM;
+    }
+
+    FBANK_Reset(psBank);
+    psBank->u32Bands = u32Bands;
+    sSection.f32Q = (float32_t)FBANK_LR_Q;
+    sSection.f32GainDb = 0.0f;
+
+    for (u32Band = 0UL; u32Band < u32Bands; u32Band++)
+    {
+        u32Stages = 0UL;
+        for (j = 0UL; j < u32Bands - 1UL; j++)
+        {
+            sSection.f32Freq = pf32Freq[j];
+            if (j < u32Band)
+                sSection.u32Type = FBANK_HIGHPASS;
+            else if (j == u32Band)
+                sSection.u32Type = FBANK_LOWPASS;
+            else
+                sSection.u32Type = FBANK_ALLPASS;
+
+            FBANK_DesignSection(&sSection, (double)psBank->f32SampleRate, &adCoeffs[5UL * u32Stages]);
+            u32Stages++;
+            /* Linkwitz-Riley: the Butterworth pass section twice */
+            if (sSection.u32Type != FBANK_ALLPASS)
+            {
+                memcpy(&adCoeffs[5UL * u32Stages], &adCoeffs[5UL * (u32Stages - 1UL)], 5UL * sizeof(double));
+                u32Stages++;
+            }
+        }
+        FBANK_Load(psBank, u32Band, adCoeffs, u32Stages);
+    }
+    return FBANK_OK;
+}
+
+/**
+  * @brief      Clear the filter state
+  * @param[in]  psBank  Filter bank instance
+  * @details    For a new stream, e.g. after the audio was stopped.
+  */
+void FBANK_Reset(FBANK_T *psBank)
+{
+    memset(&psBank->uState, 0, sizeof(psBank->uState));
+}
+
+/**
+  * @brief      Filter interleaved frames
+  * @param[in]  psBank          Filter bank instance
+  * @param[in]  pvSrc           First source frame, q31_t or q15_t as opened
+  * @param[in]  u32SrcStride    Samples from one source frame to the next: the channels are the first
+  *                             samples of each frame, e.g. some of the slots of a TDM frame
+  * @param[out] pvDst           First destination frame. An equalizer may filter in place (pvSrc with
+  *                             the same stride); a crossover needs a separate destination.
+  * @param[in]  u32DstStride    Samples from one destination frame to the next, at least the bands
+  *                             times the channels
+  * @param[in]  u32Frames       Frames to filter
+  * @details    Band b of channel c is written to sample b x channels + c of each destination frame,
+  *             e.g. a stereo 4-way crossover fills all eight slots of a TDM frame.
+  */
+void FBANK_Process(FBANK_T *psBank, const void *pvSrc, uint32_t u32SrcStride, void *pvDst, uint32_t u32DstStride,
+                   uint32_t u32Frames)
+{
+    uint32_t u32Band;
+
+    for (u32Band = 0UL; u32Band < psBank->u32Bands; u32Band++)
+    {
+        if (psBank->u32Fmt == FBANK_Q31)
+            FBANK_BiquadQ31(&psBank->uBiquad.asQ31[u32Band], (const q31_t *)pvSrc, u32SrcStride,
+                            (q31_t *)pvDst + u32Band * psBank->u32Channels, u32DstStride, u32Frames);
+        else
+            FBANK_BiquadQ15(&psBank->uBiquad.asQ15[u32Band], (const q15_t *)pvSrc, u32SrcStride,
+                            (q15_t *)pvDst + u32Band * psBank->u32Channels, u32DstStride, u32Frames);
+    }
+}
+
+/*@}*/ /* end of group FBANK_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
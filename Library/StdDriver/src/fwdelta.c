@@ -0,0 +1,346 @@
+/**************************************************************************//**
+ * @file     fwdelta.c
+ * @version  V1.00
+ * @brief    M480 series delta firmware update patch decoder source file
+ *
+ * @note     Free of hardware access; Tool/FwDelta builds this file on the host.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "fwdelta.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup FWDELTA_Driver FWDELTA Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/* Parser states, saved in FWDELTA_POS_T::u32State */
+#define FWDELTA_ST_OP           0UL
+#define FWDELTA_ST_DIFF_LEN     1UL
+#define FWDELTA_ST_DIFF_SEEK    2UL
+#define FWDELTA_ST_ZERO_LEN     3UL
+#define FWDELTA_ST_ZERO         4UL     /* Copying old bytes */
+#define FWDELTA_ST_LIT_LEN      5UL
+#define FWDELTA_ST_LIT          6UL     /* Old bytes plus literal differences */
+#define FWDELTA_ST_INS_LEN      7UL
+#define FWDELTA_ST_INS          8UL     /* Literal bytes */
+#define FWDELTA_ST_END          9UL
+
+static uint32_t FWDELTA_GetLE32(const uint8_t *pu8Buf)
+{
+    return (uint32_t)pu8Buf[0] | ((uint32_t)pu8Buf[1] << 8) |
+           ((uint32_t)pu8Buf[2] << 16) | ((uint32_t)pu8Buf[3] << 24);
+}
+
+static void FWDELTA_PutLE32(uint8_t *pu8Buf, uint32_t u32Val)
+{
+    pu8Buf[0] = (uint8_t)u32Val;
+    pu8Buf[1] = (uint8_t)(u32Val >> 8);
+    pu8Buf[2] = (uint8_t)(u32Val >> 16);
+    pu8Buf[3] = (uint8_t)(u32Val >> 24);
+}
+
+/* Produce up to the end of the run, the window or the input; returns the input bytes used or an error */
+static int32_t FWDELTA_Produce(FWDELTA_DEC_T *psDec, const uint8_t *pu8In, uint32_t u32Len)
+{
+    FWDELTA_POS_T *psPos = &psDec->sPos;
+    uint32_t u32Fill = psPos->u32OutPos % psDec->u32WinSize;
+    uint32_t u32Cnt = psPos->u32RunLeft;
+    uint8_t  *pu8Dst = psDec->pu8Win + u32Fill;
+    uint32_t i;
+    int32_t  i32Ret;
+
+    if (u32Cnt > psDec->u32WinSize - u32Fill)
+        u32Cnt = psDec->u32WinSize - u32Fill;
+    if ((psPos->u32State != FWDELTA_ST_ZERO) && (u32Cnt > u32Len))
+        u32Cnt = u32Len;
+
+    if (psPos->u32State == FWDELTA_ST_INS)
+    {
+        memcpy(pu8Dst, pu8In, u32Cnt);
+    }
+    else
+    {
+        i32Ret = psDec->pfnOld(psDec->pvArg, psPos->u32OldPos, pu8Dst, u32Cnt);
+        if (i32Ret != FWDELTA_OK)
+            return i32Ret;
+        if (psPos->u32State == FWDELTA_ST_LIT)
+        {
+            for (i = 0UL; i < u32Cnt; i++)
+                pu8Dst[i] = (uint8_t)(pu8Dst[i] + pu8In[i]);
+        }
+        psPos->u32OldPos += u32Cnt;
+        psPos->u32OpLeft -= u32Cnt;
+    }
+
+    psPos->u32RunLeft -= u32Cnt;
+    psPos->u32OutPos += u32Cnt;
+    if (psPos->u32State != FWDELTA_ST_ZERO)
+        psPos->u32InPos += u32Cnt;
+
+    /* The position is complete before the flush, so a checkpoint taken there can be resumed */
+    if ((u32Fill + u32Cnt) == psDec->u32WinSize)
+    {
+        i32Ret = psDec->pfnFlush(psDec->pvArg, psPos->u32OutPos - psDec->u32WinSize, psDec->pu8Win, psDec->u32WinSize);
+        if (i32Ret != FWDELTA_OK)
+            return i32Ret;
+    }
+
+    return (psPos->u32State == FWDELTA_ST_ZERO) ? 0L : (int32_t)u32Cnt;
+}
+
+/* A complete varint value for the current state */
+static int32_t FWDELTA_Value(FWDELTA_DEC_T *psDec, uint32_t u32Val)
+{
+    FWDELTA_POS_T *psPos = &psDec->sPos;
+    uint32_t u32Old;
+
+    switch (psPos->u32State)
+    {
+    case FWDELTA_ST_DIFF_LEN:
+        if ((u32Val == 0UL) || (u32Val > psDec->u32NewSize - psPos->u32OutPos))
+            return FWDELTA_ERR_FORMAT;
+        psPos->u32OpLeft = u32Val;
+        psPos->u32State = FWDELTA_ST_DIFF_SEEK;
+        break;
+
+    case FWDELTA_ST_DIFF_SEEK:
+        /* Zigzag: 0, -1, 1, -2, ... ; unsigned wrap-around makes a negative result fail the check */
+        u32Old = psPos->u32OldPos + ((u32Val >> 1) ^ (0UL - (u32Val & 1UL)));
+        if ((u32Old > psDec->u32OldSize) || (psPos->u32OpLeft > psDec->u32OldSize - u32Old))
+            return FWDELTA_ERR_FORMAT;
+        psPos->u32OldPos = u32Old;
+        psPos->u32State = FWDELTA_ST_ZERO_LEN;
+        break;
+
+    case FWDELTA_ST_ZERO_LEN:
+    case FWDELTA_ST_LIT_LEN:
+        if (u32Val > psPos->u32OpLeft)
+            return FWDELTA_ERR_FORMAT;
+        psPos->u32RunLeft = u32Val;
+        psPos->u32State = (psPos->u32State == FWDELTA_ST_ZERO_LEN) ? FWDELTA_ST_ZERO : FWDELTA_ST_LIT;
+        break;
+
+    default:    /* FWDELTA_ST_INS_LEN */
+        if ((u32Val == 0UL) || (u32Val > psDec->u32NewSize - psPos->u32OutPos))
+            return FWDELTA_ERR_FORMAT;
+        psPos->u32RunLeft = u32Val;
+        psPos->u32State = FWDELTA_ST_INS;
+        break;
+    }
+    return FWDELTA_OK;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup FWDELTA_EXPORTED_FUNCTIONS FWDELTA Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Update a CRC-32
+  *
+  * @param[in]  u32Crc      CRC of the data before, 0 to start
+  * @param[in]  pu8Data     Data
+  * @param[in]  u32Len      Bytes in pu8Data
+  *
+  * @return     CRC-32 of all data so far
+  *
+  * @details    The standard reflected CRC-32 (polynomial 0xEDB88320), equal to FMC_GetChkSum() of the
+  *             same bytes. Bitwise, for headers and progress records; images use FMC_GetChkSum().
+  */
+uint32_t FWDELTA_Crc32(uint32_t u32Crc, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t i;
+
+    u32Crc = ~u32Crc;
+    while (u32Len--)
+    {
+        u32Crc ^= *pu8Data++;
+        for (i = 0UL; i < 8UL; i++)
+            u32Crc = (u32Crc >> 1) ^ (0xEDB88320UL & (0UL - (u32Crc & 1UL)));
+    }
+    return ~u32Crc;
+}
+
+/**
+  * @brief      Serialize a patch header
+  *
+  * @param[in,out] psHdr    Header. u32Magic and u32HdrCrc are filled in.
+  * @param[out] pu8Buf      Receives FWDELTA_HDR_SIZE bytes
+  *
+  * @return     None
+  */
+void FWDELTA_PackHeader(FWDELTA_HDR_T *psHdr, uint8_t *pu8Buf)
+{
+    psHdr->u32Magic = FWDELTA_MAGIC;
+    FWDELTA_PutLE32(&pu8Buf[0], psHdr->u32Magic);
+    FWDELTA_PutLE32(&pu8Buf[4], psHdr->u32Flags);
+    FWDELTA_PutLE32(&pu8Buf[8], psHdr->u32OldSize);
+    FWDELTA_PutLE32(&pu8Buf[12], psHdr->u32OldCrc);
+    FWDELTA_PutLE32(&pu8Buf[16], psHdr->u32NewSize);
+    FWDELTA_PutLE32(&pu8Buf[20], psHdr->u32NewCrc);
+    FWDELTA_PutLE32(&pu8Buf[24], psHdr->u32BodySize);
+    psHdr->u32HdrCrc = FWDELTA_Crc32(0UL, pu8Buf, FWDELTA_HDR_SIZE - 4UL);
+    FWDELTA_PutLE32(&pu8Buf[28], psHdr->u32HdrCrc);
+}
+
+/**
+  * @brief      Parse and check a patch header
+  *
+  * @param[in]  pu8Buf      FWDELTA_HDR_SIZE bytes
+  * @param[out] psHdr       Receives the header
+  *
+  * @retval     FWDELTA_OK          Valid header
+  * @retval     FWDELTA_ERR_FORMAT  Wrong magic or CRC, or unknown flags
+  */
+int32_t FWDELTA_ParseHeader(const uint8_t *pu8Buf, FWDELTA_HDR_T *psHdr)
+{
+    psHdr->u32Magic = FWDELTA_GetLE32(&pu8Buf[0]);
+    psHdr->u32Flags = FWDELTA_GetLE32(&pu8Buf[4]);
+    psHdr->u32OldSize = FWDELTA_GetLE32(&pu8Buf[8]);
+    psHdr->u32OldCrc = FWDELTA_GetLE32(&pu8Buf[12]);
+    psHdr->u32NewSize = FWDELTA_GetLE32(&pu8Buf[16]);
+    psHdr->u32NewCrc = FWDELTA_GetLE32(&pu8Buf[20]);
+    psHdr->u32BodySize = FWDELTA_GetLE32(&pu8Buf[24]);
+    psHdr->u32HdrCrc = FWDELTA_GetLE32(&pu8Buf[28]);
+
+    if ((psHdr->u32Magic != FWDELTA_MAGIC) || (psHdr->u32Flags != 0UL) ||
+            (psHdr->u32HdrCrc != FWDELTA_Crc32(0UL, pu8Buf, FWDELTA_HDR_SIZE - 4UL)))
+        return FWDELTA_ERR_FORMAT;
+    return FWDELTA_OK;
+}
+
+/**
+  * @brief      Prepare a decoder for the commands after a header
+  *
+  * @param[in,out] psDec    Decoder. The window and callback fields are set by the caller.
+  * @param[in]  psHdr       Parsed patch header
+  *
+  * @return     None
+  *
+  * @details    To resume, call it and then restore psDec->sPos from a checkpoint taken in pfnFlush();
+  *             the commands continue at FWDELTA_HDR_SIZE + sPos.u32InPos of the patch.
+  */
+void FWDELTA_DecInit(FWDELTA_DEC_T *psDec, const FWDELTA_HDR_T *psHdr)
+{
+    memset(&psDec->sPos, 0, sizeof(psDec->sPos));
+    psDec->u32OldSize = psHdr->u32OldSize;
+    psDec->u32NewSize = psHdr->u32NewSize;
+}
+
+/**
+  * @brief      Decode patch commands
+  *
+  * @param[in,out] psDec    Decoder
+  * @param[in]  pu8In       Command bytes, continuing where the previous call stopped
+  * @param[in]  u32Len      Bytes in pu8In, any size
+  *
+  * @retval     FWDELTA_OK          All bytes consumed, more expected
+  * @retval     FWDELTA_DONE        FWDELTA_OP_END decoded and the output flushed
+  * @retval     FWDELTA_ERR_FORMAT  Corrupt command, out of range reference or data after the end
+  * @retval     <0                  Error returned by a callback
+  */
+int32_t FWDELTA_Decode(FWDELTA_DEC_T *psDec, const uint8_t *pu8In, uint32_t u32Len)
+{
+    FWDELTA_POS_T *psPos = &psDec->sPos;
+    uint32_t u32State, u32Val, u32Fill;
+    uint8_t  u8Byte;
+    int32_t  i32Ret;
+
+    for (;;)
+    {
+        u32State = psPos->u32State;
+
+        if ((u32State == FWDELTA_ST_ZERO) || (u32State == FWDELTA_ST_LIT) || (u32State == FWDELTA_ST_INS))
+        {
+            if (psPos->u32RunLeft == 0UL)
+            {
+                if ((u32State == FWDELTA_ST_INS) || (psPos->u32OpLeft == 0UL))
+                    psPos->u32State = FWDELTA_ST_OP;
+                else
+                    psPos->u32State = (u32State == FWDELTA_ST_ZERO) ? FWDELTA_ST_LIT_LEN : FWDELTA_ST_ZERO_LEN;
+                continue;
+            }
+            if ((u32State != FWDELTA_ST_ZERO) && (u32Len == 0UL))
+                return FWDELTA_OK;
+
+            i32Ret = FWDELTA_Produce(psDec, pu8In, u32Len);
+            if (i32Ret < 0)
+                return i32Ret;
+            pu8In += i32Ret;
+            u32Len -= (uint32_t)i32Ret;
+            continue;
+        }
+
+        if (u32State == FWDELTA_ST_END)
+            return (u32Len == 0UL) ? FWDELTA_DONE : FWDELTA_ERR_FORMAT;
+
+        if (u32Len == 0UL)
+            return FWDELTA_OK;
+        u8Byte = *pu8In++;
+        u32Len--;
+        psPos->u32InPos++;
+
+        if (u32State == FWDELTA_ST_OP)
+        {
+            psPos->u32Var = 0UL;
+            psPos->u32VarShift = 0UL;
+            if (u8Byte == FWDELTA_OP_DIFF)
+            {
+                psPos->u32State = FWDELTA_ST_DIFF_LEN;
+            }
+            else if (u8Byte == FWDELTA_OP_INSERT)
+            {
+                psPos->u32State = FWDELTA_ST_INS_LEN;
+            }
+            else if ((u8Byte == FWDELTA_OP_END) && (psPos->u32OutPos == psDec->u32NewSize))
+            {
+                u32Fill = psPos->u32OutPos % psDec->u32WinSize;
+                if (u32Fill != 0UL)
+                {
+                    i32Ret = psDec->pfnFlush(psDec->pvArg, psPos->u32OutPos - u32Fill, psDec->pu8Win, u32Fill);
+                    if (i32Ret != FWDELTA_OK)
+                        return i32Ret;
+                }
+                psPos->u32State = FWDELTA_ST_END;
+            }
+            else
+            {
+                return FWDELTA_ERR_FORMAT;
+            }
+            continue;
+        }
+
+        /* Varint states */
+        if (psPos->u32VarShift > 28UL)
+            return FWDELTA_ERR_FORMAT;
+        psPos->u32Var |= (uint32_t)(u8Byte & 0x7FU) << psPos->u32VarShift;
+        psPos->u32VarShift += 7UL;
+        if (u8Byte & 0x80U)
+            continue;
+
+        u32Val = psPos->u32Var;
+        psPos->u32Var = 0UL;
+        psPos->u32VarShift = 0UL;
+        i32Ret = FWDELTA_Value(psDec, u32Val);
+        if (i32Ret != FWDELTA_OK)
+            return i32Ret;
+    }
+}
+
+/*@}*/ /* end of group FWDELTA_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group FWDELTA_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,405 @@
+/**************************************************************************//**
+ * @file     fwdelta_fmc.c
+ * @version  V1.00
+ * @brief    M480 series delta firmware update flash applier source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "fwdelta.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup FWDELTA_Driver FWDELTA Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define FWDELTA_STATE_IDLE      0UL
+#define FWDELTA_STATE_RUN       1UL
+#define FWDELTA_STATE_END       2UL     /* FWDELTA_OP_END decoded, waiting for FWDELTA_Finish() */
+
+/*
+ * Progress record: magic, sequence, header, decoder position, CRC-32 of the words before.
+ * Programmed 8 bytes at a time with the CRC last, so a record torn by a power failure is ignored.
+ */
+#define FWDELTA_REC_MAGIC       0x474F5250UL    /* "PROG" */
+#define FWDELTA_REC_WORDS       20UL
+#define FWDELTA_REC_SLOT        128UL
+#define FWDELTA_REC_PER_PAGE    (FMC_FLASH_PAGE_SIZE / FWDELTA_REC_SLOT)
+
+typedef struct
+{
+    uint32_t u32Magic;
+    uint32_t u32Seq;
+    FWDELTA_HDR_T sHdr;
+    FWDELTA_POS_T sPos;
+    uint32_t u32Rsvd;
+    uint32_t u32Crc;
+} FWDELTA_REC_T;
+
+static FWDELTA_CFG_T s_sCfg;
+static FWDELTA_STATS_T s_sStats;
+static FWDELTA_DEC_T s_sDec;
+static FWDELTA_HDR_T s_sHdr;
+static uint8_t  s_au8Hdr[FWDELTA_HDR_SIZE];
+static uint32_t s_u32HdrLen;
+static uint32_t s_u32State = FWDELTA_STATE_IDLE;
+static uint32_t s_u32CyclesPerUs = 1UL;
+
+static uint32_t s_u32Seq;
+static uint32_t s_u32LogPage;           /* Log page being appended, 0 or 1 */
+static uint32_t s_u32LogSlot;           /* Next record slot in it */
+
+static uint32_t FWDELTA_CrcSize(uint32_t u32Size)
+{
+    return (u32Size + FWDELTA_CRC_ALIGN - 1UL) & ~(FWDELTA_CRC_ALIGN - 1UL);
+}
+
+static void FWDELTA_StartCounter(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    s_u32CyclesPerUs = SystemCoreClock / 1000000UL;
+    if (s_u32CyclesPerUs == 0UL)
+        s_u32CyclesPerUs = 1UL;
+}
+
+static int32_t FWDELTA_EraseLog(void)
+{
+    if ((FMC_Erase(s_sCfg.u32LogBase) != 0) || (FMC_Erase(s_sCfg.u32LogBase + FMC_FLASH_PAGE_SIZE) != 0))
+        return FWDELTA_ERR_FLASH;
+    s_u32LogPage = 0UL;
+    s_u32LogSlot = 0UL;
+    return FWDELTA_OK;
+}
+
+/* Record that everything below the decoder output position is programmed */
+static int32_t FWDELTA_Checkpoint(void)
+{
+    FWDELTA_REC_T sRec;
+    uint32_t *pu32Rec = (uint32_t *)&sRec;
+    uint32_t u32Addr, i;
+
+    if (s_u32LogSlot == FWDELTA_REC_PER_PAGE)
+    {
+        /* The full page keeps the newest record until the other one has a newer one */
+        s_u32LogPage ^= 1UL;
+        s_u32LogSlot = 0UL;
+        if (FMC_Erase(s_sCfg.u32LogBase + s_u32LogPage * FMC_FLASH_PAGE_SIZE) != 0)
+            return FWDELTA_ERR_FLASH;
+    }
+
+    sRec.u32Magic = FWDELTA_REC_MAGIC;
+    sRec.u32Seq = ++s_u32Seq;
+    sRec.sHdr = s_sHdr;
+    sRec.sPos = s_sDec.sPos;
+    sRec.u32Rsvd = 0xFFFFFFFFUL;
+    sRec.u32Crc = FWDELTA_Crc32(0UL, (uint8_t *)&sRec, sizeof(sRec) - 4UL);
+
+    u32Addr = s_sCfg.u32LogBase + s_u32LogPage * FMC_FLASH_PAGE_SIZE + s_u32LogSlot * FWDELTA_REC_SLOT;
+    s_u32LogSlot++;
+    for (i = 0UL; i < FWDELTA_REC_WORDS; i += 2UL)
+    {
+        if (FMC_Write8Bytes(u32Addr + i * 4UL, pu32Rec[i], pu32Rec[i + 1UL]) != 0)
+            return FWDELTA_ERR_FLASH;
+    }
+    s_sStats.u32Checkpoints++;
+    return FWDELTA_OK;
+}
+
+/* Read through ISP, the log changes too often to trust the flash cache */
+static int32_t FWDELTA_ReadRec(uint32_t u32Addr, FWDELTA_REC_T *psRec)
+{
+    uint32_t *pu32Rec = (uint32_t *)psRec;
+    uint32_t i;
+
+    for (i = 0UL; i < FWDELTA_REC_WORDS; i++)
+        pu32Rec[i] = FMC_Read(u32Addr + i * 4UL);
+
+    if ((psRec->u32Magic != FWDELTA_REC_MAGIC) ||
+            (psRec->u32Crc != FWDELTA_Crc32(0UL, (uint8_t *)psRec, sizeof(*psRec) - 4UL)))
+        return FWDELTA_ERR_STATE;
+    return FWDELTA_OK;
+}
+
+static int32_t FWDELTA_OldRead(void *pvArg, uint32_t u32Off, uint8_t *pu8Dst, uint32_t u32Len)
+{
+    (void)pvArg;
+    memcpy(pu8Dst, (const void *)(s_sCfg.u32OldBase + u32Off), u32Len);
+    return FWDELTA_OK;
+}
+
+static int32_t FWDELTA_PageFlush(void *pvArg, uint32_t u32Off, const uint8_t *pu8Win, uint32_t u32Len)
+{
+    uint32_t u32Addr = s_sCfg.u32NewBase + u32Off;
+    uint32_t u32Start = DWT->CYCCNT;
+    int32_t  i32Ret;
+
+    (void)pvArg;
+    (void)pu8Win;   /* The window is s_sCfg.pu8PageBuf */
+
+    /* The last page is padded as the image CRC expects */
+    if (u32Len < FMC_FLASH_PAGE_SIZE)
+        memset(s_sCfg.pu8PageBuf + u32Len, 0xFF, FMC_FLASH_PAGE_SIZE - u32Len);
+
+    if (FMC_Erase(u32Addr) != 0)
+        return FWDELTA_ERR_FLASH;
+    i32Ret = FMC_WriteMultiple(u32Addr, (uint32_t *)s_sCfg.pu8PageBuf, FMC_FLASH_PAGE_SIZE);
+    if ((i32Ret != (int32_t)FMC_FLASH_PAGE_SIZE) || FMC_GET_FAIL_FLAG())
+    {
+        FMC_CLR_FAIL_FLAG();
+        return FWDELTA_ERR_FLASH;
+    }
+    s_sStats.u32FlashUs += (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+    s_sStats.u32Pages++;
+    s_sStats.u32OutBytes += u32Len;
+
+    /* After the last page only FWDELTA_Finish() is left, which needs no checkpoint */
+    return (u32Len == FMC_FLASH_PAGE_SIZE) ? FWDELTA_Checkpoint() : FWDELTA_OK;
+}
+
+static int32_t FWDELTA_Setup(const FWDELTA_CFG_T *psCfg)
+{
+    if ((psCfg == NULL) || (psCfg->pu8PageBuf == NULL) || ((uint32_t)psCfg->pu8PageBuf & 3UL) ||
+            (psCfg->u32OldBase & ~FMC_PAGE_ADDR_MASK) || (psCfg->u32NewBase & ~FMC_PAGE_ADDR_MASK) ||
+            (psCfg->u32LogBase & ~FMC_PAGE_ADDR_MASK) ||
+            (psCfg->u32SlotSize == 0UL) || (psCfg->u32SlotSize & ~FMC_PAGE_ADDR_MASK) ||
+            (psCfg->u32OldBase + psCfg->u32SlotSize > FMC_APROM_END) ||
+            (psCfg->u32NewBase + psCfg->u32SlotSize > FMC_APROM_END) ||
+            ((psCfg->u32OldBase < psCfg->u32NewBase + psCfg->u32SlotSize) &&
+             (psCfg->u32NewBase < psCfg->u32OldBase + psCfg->u32SlotSize)))
+        return FWDELTA_ERR_PARAM;
+
+    s_sCfg = *psCfg;
+    memset(&s_sStats, 0, sizeof(s_sStats));
+    FWDELTA_StartCounter();
+
+    s_sDec.pu8Win = s_sCfg.pu8PageBuf;
+    s_sDec.u32WinSize = FMC_FLASH_PAGE_SIZE;
+    s_sDec.pvArg = NULL;
+    s_sDec.pfnOld = FWDELTA_OldRead;
+    s_sDec.pfnFlush = FWDELTA_PageFlush;
+    return FWDELTA_OK;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup FWDELTA_EXPORTED_FUNCTIONS FWDELTA Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Begin applying a patch
+  *
+  * @param[in]  psCfg       Applier configuration. Copied, need not stay valid.
+  *
+  * @retval     FWDELTA_OK          Success, pass the patch from its first byte to FWDELTA_Write()
+  * @retval     FWDELTA_ERR_PARAM   Misaligned or overlapping slots, or no page buffer
+  * @retval     FWDELTA_ERR_FLASH   The progress log could not be erased
+  *
+  * @details    The application opens FMC and enables APROM update beforehand, and data flash holds
+  *             the log pages. Discards the progress of an earlier update. Starts the DWT cycle
+  *             counter used for the statistics.
+  */
+int32_t FWDELTA_Begin(const FWDELTA_CFG_T *psCfg)
+{
+    int32_t i32Ret = FWDELTA_Setup(psCfg);
+
+    if (i32Ret != FWDELTA_OK)
+        return i32Ret;
+
+    s_u32State = FWDELTA_STATE_IDLE;
+    i32Ret = FWDELTA_EraseLog();
+    if (i32Ret != FWDELTA_OK)
+        return i32Ret;
+
+    s_u32Seq = 0UL;
+    s_u32HdrLen = 0UL;
+    s_u32State = FWDELTA_STATE_RUN;
+    return FWDELTA_OK;
+}
+
+/**
+  * @brief      Resume an interrupted update
+  *
+  * @param[in]  psCfg       Applier configuration, the same as the interrupted update
+  * @param[out] psHdr       Receives the header of the interrupted patch
+  * @param[out] pu32PatchOff Receives the patch offset to continue FWDELTA_Write() from
+  *
+  * @retval     FWDELTA_OK          Success
+  * @retval     FWDELTA_ERR_PARAM   Invalid configuration
+  * @retval     FWDELTA_ERR_STATE   No progress record, the update completed or never began
+  * @retval     FWDELTA_ERR_FLASH   The log could not be rewritten
+  *
+  * @details    Call at boot, before FWDELTA_Begin(). The application checks psHdr->u32NewCrc against
+  *             the patch it has, then feeds that patch from *pu32PatchOff. The old image is not
+  *             checked again, it was checked when the update began.
+  */
+int32_t FWDELTA_Resume(const FWDELTA_CFG_T *psCfg, FWDELTA_HDR_T *psHdr, uint32_t *pu32PatchOff)
+{
+    FWDELTA_REC_T sRec, sBest;
+    uint32_t u32Page, u32Slot, u32BestPage = 0UL, u32Found = 0UL;
+    int32_t  i32Ret = FWDELTA_Setup(psCfg);
+
+    if (i32Ret != FWDELTA_OK)
+        return i32Ret;
+
+    s_u32State = FWDELTA_STATE_IDLE;
+    for (u32Page = 0UL; u32Page < 2UL; u32Page++)
+    {
+        for (u32Slot = 0UL; u32Slot < FWDELTA_REC_PER_PAGE; u32Slot++)
+        {
+            if (FWDELTA_ReadRec(s_sCfg.u32LogBase + u32Page * FMC_FLASH_PAGE_SIZE + u32Slot * FWDELTA_REC_SLOT,
+                                &sRec) != FWDELTA_OK)
+                continue;
+            if ((u32Found == 0UL) || (sRec.u32Seq > sBest.u32Seq))
+            {
+                sBest = sRec;
+                u32BestPage = u32Page;
+                u32Found = 1UL;
+            }
+        }
+    }
+    if (u32Found == 0UL)
+        return FWDELTA_ERR_STATE;
+
+    s_sHdr = sBest.sHdr;
+    FWDELTA_DecInit(&s_sDec, &s_sHdr);
+    s_sDec.sPos = sBest.sPos;
+    s_u32Seq = sBest.u32Seq;
+    s_u32HdrLen = FWDELTA_HDR_SIZE;
+
+    /*
+     * Continue on the other page, holding only the resumed record. The page of the best record is
+     * erased after that, as slots after it may be torn, so a power failure in between still finds
+     * a record to resume from.
+     */
+    s_u32LogPage = u32BestPage ^ 1UL;
+    s_u32LogSlot = 0UL;
+    if (FMC_Erase(s_sCfg.u32LogBase + s_u32LogPage * FMC_FLASH_PAGE_SIZE) != 0)
+        return FWDELTA_ERR_FLASH;
+    i32Ret = FWDELTA_Checkpoint();
+    if (i32Ret != FWDELTA_OK)
+        return i32Ret;
+    if (FMC_Erase(s_sCfg.u32LogBase + u32BestPage * FMC_FLASH_PAGE_SIZE) != 0)
+        return FWDELTA_ERR_FLASH;
+
+    *psHdr = s_sHdr;
+    *pu32PatchOff = FWDELTA_HDR_SIZE + s_sDec.sPos.u32InPos;
+    s_sStats.u32PatchBytes = *pu32PatchOff;
+    s_sStats.u32OutBytes = s_sDec.sPos.u32OutPos;
+    s_u32State = FWDELTA_STATE_RUN;
+    return FWDELTA_OK;
+}
+
+/**
+  * @brief      Apply patch data
+  *
+  * @param[in]  pu8Data     Patch data, continuing where the previous call stopped
+  * @param[in]  u32Len      Bytes in pu8Data, any size
+  *
+  * @retval     FWDELTA_OK          Data consumed, more expected
+  * @retval     FWDELTA_DONE        The patch is complete, call FWDELTA_Finish()
+  * @retval     FWDELTA_ERR_STATE   No update in progress
+  * @retval     FWDELTA_ERR_FORMAT  Corrupt patch, or the image does not fit the slot
+  * @retval     FWDELTA_ERR_OLD     The old slot does not hold the image the patch was made for
+  * @retval     FWDELTA_ERR_FLASH   Erase or program failed
+  *
+  * @details    Every FMC_FLASH_PAGE_SIZE bytes of output, the page is erased, programmed with
+  *             multi-word bursts and a progress record is written. The update stops at the first
+  *             error; FWDELTA_Resume() can continue it from the last record.
+  */
+int32_t FWDELTA_Write(const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Copy;
+    int32_t  i32Ret;
+
+    if (s_u32State == FWDELTA_STATE_END)
+        return (u32Len == 0UL) ? FWDELTA_DONE : FWDELTA_ERR_FORMAT;
+    if (s_u32State != FWDELTA_STATE_RUN)
+        return FWDELTA_ERR_STATE;
+
+    s_sStats.u32PatchBytes += u32Len;
+
+    if (s_u32HdrLen < FWDELTA_HDR_SIZE)
+    {
+        u32Copy = FWDELTA_HDR_SIZE - s_u32HdrLen;
+        if (u32Copy > u32Len)
+            u32Copy = u32Len;
+        memcpy(&s_au8Hdr[s_u32HdrLen], pu8Data, u32Copy);
+        s_u32HdrLen += u32Copy;
+        pu8Data += u32Copy;
+        u32Len -= u32Copy;
+        if (s_u32HdrLen < FWDELTA_HDR_SIZE)
+            return FWDELTA_OK;
+
+        s_u32State = FWDELTA_STATE_IDLE;
+        if ((FWDELTA_ParseHeader(s_au8Hdr, &s_sHdr) != FWDELTA_OK) ||
+                (s_sHdr.u32OldSize == 0UL) || (s_sHdr.u32OldSize > s_sCfg.u32SlotSize) ||
+                (s_sHdr.u32NewSize == 0UL) || (s_sHdr.u32NewSize > s_sCfg.u32SlotSize))
+            return FWDELTA_ERR_FORMAT;
+        if (FMC_GetChkSum(s_sCfg.u32OldBase, FWDELTA_CrcSize(s_sHdr.u32OldSize)) != s_sHdr.u32OldCrc)
+            return FWDELTA_ERR_OLD;
+
+        FWDELTA_DecInit(&s_sDec, &s_sHdr);
+        i32Ret = FWDELTA_Checkpoint();
+        if (i32Ret != FWDELTA_OK)
+            return i32Ret;
+        s_u32State = FWDELTA_STATE_RUN;
+    }
+
+    i32Ret = FWDELTA_Decode(&s_sDec, pu8Data, u32Len);
+    if (i32Ret == FWDELTA_DONE)
+        s_u32State = FWDELTA_STATE_END;
+    else if (i32Ret < 0)
+        s_u32State = FWDELTA_STATE_IDLE;
+    return i32Ret;
+}
+
+/**
+  * @brief      Verify the new image and end the update
+  *
+  * @retval     FWDELTA_OK          The new slot holds the image the patch describes
+  * @retval     FWDELTA_ERR_STATE   The patch is not complete
+  * @retval     FWDELTA_ERR_VERIFY  CRC mismatch, the progress is kept so the update can be resumed
+  * @retval     FWDELTA_ERR_FLASH   The progress log could not be erased
+  *
+  * @details    Checks the new image with the FMC CRC-32 command, then erases the progress log. Marking
+  *             the new slot bootable is left to the application.
+  */
+int32_t FWDELTA_Finish(void)
+{
+    if (s_u32State != FWDELTA_STATE_END)
+        return FWDELTA_ERR_STATE;
+
+    s_u32State = FWDELTA_STATE_IDLE;
+    if (FMC_GetChkSum(s_sCfg.u32NewBase, FWDELTA_CrcSize(s_sHdr.u32NewSize)) != s_sHdr.u32NewCrc)
+        return FWDELTA_ERR_VERIFY;
+    return FWDELTA_EraseLog();
+}
+
+/**
+  * @brief      Get the counters of the update begun or resumed last
+  *
+  * @param[out] psStats     Receives the counters
+  *
+  * @return     None
+  */
+void FWDELTA_GetStats(FWDELTA_STATS_T *psStats)
+{
+    *psStats = s_sStats;
+}
+
+/*@}*/ /* end of group FWDELTA_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group FWDELTA_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,521 @@
+/**************************************************************************//**
+ * @file     fwupd.c
+ * @version  V1.00
+ * @brief    M480 series streaming firmware update engine source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "fwupd.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup FWUPD_Driver FWUPD Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define FWUPD_STATE_IDLE    0UL
+#define FWUPD_STATE_RUN     1UL
+#define FWUPD_STATE_DONE    2UL         /* Image complete and hashed, FWUPD_Commit() allowed */
+
+#define FWUPD_NONE          0xFFFFFFFFUL
+
+static FWUPD_CFG_T s_sCfg;
+static FWUPD_STATS_T s_sStats;
+static uint32_t s_u32State = FWUPD_STATE_IDLE;
+static int32_t  s_i32Error;
+static uint32_t s_u32CyclesPerUs = 1UL;
+static uint32_t s_u32LastCycle;
+
+static uint32_t s_u32MaxBytes;          /* Image size limit */
+static uint32_t s_u32Fill;              /* Block being filled, 0 or 1 */
+static uint32_t s_u32FillLen;
+static uint32_t s_u32FillAddr;          /* Flash address of the block being filled */
+static uint32_t s_u32FillQueued;        /* The block being filled is already handed to the programmer */
+
+static uint32_t s_u32Prog = FWUPD_NONE; /* Block being programmed */
+static uint32_t s_u32ProgAddr;
+static uint32_t s_u32ProgOff;
+static uint32_t s_u32ProgLen;
+
+static uint32_t s_u32TrailerPage;       /* Erased by FWUPD_Begin(), never by the erase ahead */
+static uint32_t s_u32EraseNext;         /* Pages below are erased */
+static uint32_t s_u32EraseEnd;
+static uint32_t s_u32Erasing;           /* Page erase of s_u32EraseNext in flight */
+
+static uint32_t s_u32ShaOps;            /* SHA DMA operations of this image */
+static uint32_t s_u32ShaBusy;
+static uint32_t s_au32Digest[8];
+
+static uint8_t *FWUPD_Block(uint32_t u32Idx)
+{
+    return s_sCfg.pu8Buf + u32Idx * s_sCfg.u32BlockSize;
+}
+
+/* Accumulates u32TotalUs on every call, so the 32-bit cycle counter may wrap between calls */
+static void FWUPD_Tick(void)
+{
+    uint32_t u32Us = (DWT->CYCCNT - s_u32LastCycle) / s_u32CyclesPerUs;
+
+    s_sStats.u32TotalUs += u32Us;
+    s_u32LastCycle += u32Us * s_u32CyclesPerUs;
+}
+
+static int32_t FWUPD_Fail(int32_t i32Err)
+{
+    if (s_i32Error == FWUPD_OK)
+        s_i32Error = i32Err;
+    return s_i32Error;
+}
+
+static int32_t FWUPD_ShaWait(void)
+{
+    uint32_t u32Start, u32Sts;
+
+    if (s_u32ShaBusy == 0UL)
+        return FWUPD_OK;
+
+    u32Start = DWT->CYCCNT;
+    while (SHA_GET_INT_FLAG(CRPT) == 0UL) { }
+    s_sStats.u32HashWaitUs += (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+
+    u32Sts = CRPT->INTSTS;
+    SHA_CLR_INT_FLAG(CRPT);
+    s_u32ShaBusy = 0UL;
+    if (u32Sts & CRPT_INTSTS_HMACEIF_Msk)
+        return FWUPD_Fail(FWUPD_ERR_HASH);
+    return FWUPD_OK;
+}
+
+/* Non-last operations must be a multiple of the 64-byte SHA-256 block, which every full block is */
+static int32_t FWUPD_ShaStart(uint8_t *pu8Data, uint32_t u32Len, uint32_t u32Last)
+{
+    uint32_t u32Mode;
+    int32_t  i32Ret;
+
+    i32Ret = FWUPD_ShaWait();
+    if (i32Ret != FWUPD_OK)
+        return i32Ret;
+
+    if (u32Last)
+        u32Mode = s_u32ShaOps ? CRYPTO_DMA_LAST : CRYPTO_DMA_ONE_SHOT;
+    else
+        u32Mode = s_u32ShaOps ? CRYPTO_DMA_CONTINUE : CRYPTO_DMA_FIRST;
+
+    SHA_SetDMATransfer(CRPT, (uint32_t)pu8Data, u32Len);
+    SHA_Start(CRPT, u32Mode);
+    s_u32ShaOps++;
+    s_u32ShaBusy = 1UL;
+    return FWUPD_OK;
+}
+
+/* Hand the block being filled to the programmer, which must be free */
+static void FWUPD_Queue(void)
+{
+    s_u32Prog = s_u32Fill;
+    s_u32ProgAddr = s_u32FillAddr;
+    s_u32ProgOff = 0UL;
+    s_u32ProgLen = (s_u32FillLen + 15UL) & ~15UL;
+    s_u32FillQueued = 1UL;
+}
+
+/* Runs FWUPD_Poll() until the other block is programmed, so it can be filled again */
+static int32_t FWUPD_WaitOther(void)
+{
+    uint32_t u32Start = DWT->CYCCNT;
+    int32_t  i32Ret = FWUPD_OK;
+
+    while (s_u32Prog == (s_u32Fill ^ 1UL))
+    {
+        i32Ret = FWUPD_Poll();
+        if (i32Ret < 0)
+            break;
+    }
+    s_sStats.u32StallUs += (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+    return (i32Ret < 0) ? i32Ret : FWUPD_OK;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup FWUPD_EXPORTED_FUNCTIONS FWUPD Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Start updating a slot
+  *
+  * @param[in]  psCfg       Update configuration. Copied, need not stay valid.
+  *
+  * @retval     FWUPD_OK            Success
+  * @retval     FWUPD_ERR_PARAM     Invalid slot, block size, buffer, image size or sequence
+  * @retval     FWUPD_ERR_FLASH     The trailer page could not be erased
+  *
+  * @details    The application opens FMC, enables APROM update and the CRPT clock beforehand. The
+  *             engine owns the SHA engine until FWUPD_Finish() or FWUPD_Abort() and polls its flag,
+  *             so the SHA interrupt is disabled. Erases the last page of the slot before returning,
+  *             which revokes the commit trailer of the image the slot held. An update still running
+  *             is aborted. Starts the DWT cycle counter used for the statistics.
+  */
+int32_t FWUPD_Begin(const FWUPD_CFG_T *psCfg)
+{
+    uint32_t u32Size;
+
+    if ((psCfg == NULL) || (psCfg->pu8Buf == NULL) || ((uint32_t)psCfg->pu8Buf & 3UL))
+        return FWUPD_ERR_PARAM;
+
+    u32Size = psCfg->u32BlockSize;
+    if ((u32Size < FMC_MULTI_WORD_PROG_LEN) || (u32Size > FMC_FLASH_PAGE_SIZE) || (u32Size & (u32Size - 1UL)))
+        return FWUPD_ERR_PARAM;
+
+    if ((psCfg->u32SlotBase & ~FMC_PAGE_ADDR_MASK) || (psCfg->u32SlotSize == 0UL) ||
+            (psCfg->u32SlotSize & ~FMC_PAGE_ADDR_MASK) ||
+            (psCfg->u32SlotBase + psCfg->u32SlotSize > FMC_APROM_END) ||
+            (psCfg->u32ImageSize > psCfg->u32SlotSize - FWUPD_TRAILER_RSVD) ||
+            (psCfg->u32Seq == 0UL) || (psCfg->u32Seq == 0xFFFFFFFFUL))
+        return FWUPD_ERR_PARAM;
+
+    if (s_u32State == FWUPD_STATE_RUN)
+        FWUPD_Abort();
+
+    s_sCfg = *psCfg;
+    memset(&s_sStats, 0, sizeof(s_sStats));
+    s_i32Error = FWUPD_OK;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    s_u32CyclesPerUs = SystemCoreClock / 1000000UL;
+    if (s_u32CyclesPerUs == 0UL)
+        s_u32CyclesPerUs = 1UL;
+    s_u32LastCycle = DWT->CYCCNT;
+
+    /* Invalidate the slot before anything else is written to it */
+    s_u32TrailerPage = s_sCfg.u32SlotBase + s_sCfg.u32SlotSize - FMC_FLASH_PAGE_SIZE;
+    if (FMC_Erase(s_u32TrailerPage) != 0)
+        return FWUPD_ERR_FLASH;
+    s_sStats.u32PagesErased = 1UL;
+
+    s_u32MaxBytes = s_sCfg.u32ImageSize ? s_sCfg.u32ImageSize : (s_sCfg.u32SlotSize - FWUPD_TRAILER_RSVD);
+    s_u32EraseNext = s_sCfg.u32SlotBase;
+    s_u32EraseEnd = s_sCfg.u32SlotBase + ((s_u32MaxBytes + FMC_FLASH_PAGE_SIZE - 1UL) & FMC_PAGE_ADDR_MASK);
+    if (s_u32EraseEnd > s_u32TrailerPage)
+        s_u32EraseEnd = s_u32TrailerPage;
+    s_u32Erasing = 0UL;
+
+    s_u32Fill = 0UL;
+    s_u32FillLen = 0UL;
+    s_u32FillAddr = s_sCfg.u32SlotBase;
+    s_u32FillQueued = 0UL;
+    s_u32Prog = FWUPD_NONE;
+
+    SHA_DISABLE_INT(CRPT);
+    SHA_CLR_INT_FLAG(CRPT);
+    SHA_Open(CRPT, SHA_MODE_SHA256, SHA_IN_SWAP, 0UL);
+    s_u32ShaOps = 0UL;
+    s_u32ShaBusy = 0UL;
+
+    s_u32State = FWUPD_STATE_RUN;
+    return FWUPD_OK;
+}
+
+/**
+  * @brief      Append image data
+  *
+  * @param[in]  pu8Data     Image data, any alignment
+  * @param[in]  u32Len      Bytes in pu8Data, any size
+  *
+  * @retval     FWUPD_OK            Data accepted
+  * @retval     FWUPD_ERR_STATE     No update in progress
+  * @retval     FWUPD_ERR_SIZE      The data would exceed the image size or the slot, nothing accepted
+  * @retval     <0                  An earlier erase, program or hash failed
+  *
+  * @details    Copies the data into the staging blocks and returns. It only waits when both blocks are
+  *             full, that is when data arrives faster than the flash is programmed; the time is counted
+  *             in u32StallUs. Not reentrant, call it from one context together with FWUPD_Poll().
+  */
+int32_t FWUPD_Write(const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Size = s_sCfg.u32BlockSize;
+    uint32_t u32Copy;
+    int32_t  i32Ret;
+
+    if (s_u32State != FWUPD_STATE_RUN)
+        return FWUPD_ERR_STATE;
+    if (s_i32Error != FWUPD_OK)
+        return s_i32Error;
+    if (u32Len > s_u32MaxBytes - s_sStats.u32Bytes)
+        return FWUPD_ERR_SIZE;
+
+    while (u32Len > 0UL)
+    {
+        if (s_u32FillLen == u32Size)
+        {
+            /* More data follows, so the full block is hashed as a non-last part and the other
+               block, whose hash FWUPD_ShaStart() waits for, is filled next */
+            i32Ret = FWUPD_WaitOther();
+            if (i32Ret != FWUPD_OK)
+                return i32Ret;
+            if (s_u32FillQueued == 0UL)
+                FWUPD_Queue();
+            i32Ret = FWUPD_ShaStart(FWUPD_Block(s_u32Fill), u32Size, 0UL);
+            if (i32Ret != FWUPD_OK)
+                return i32Ret;
+
+            s_u32Fill ^= 1UL;
+            s_u32FillAddr += u32Size;
+            s_u32FillLen = 0UL;
+            s_u32FillQueued = 0UL;
+        }
+
+        u32Copy = u32Size - s_u32FillLen;
+        if (u32Copy > u32Len)
+            u32Copy = u32Len;
+        memcpy(FWUPD_Block(s_u32Fill) + s_u32FillLen, pu8Data, u32Copy);
+        s_u32FillLen += u32Copy;
+        s_sStats.u32Bytes += u32Copy;
+        pu8Data += u32Copy;
+        u32Len -= u32Copy;
+
+        /* Program a full block right away when the programmer is free */
+        if ((s_u32FillLen == u32Size) && (s_u32Prog == FWUPD_NONE))
+            FWUPD_Queue();
+    }
+
+    i32Ret = FWUPD_Poll();
+    return (i32Ret < 0) ? i32Ret : FWUPD_OK;
+}
+
+/**
+  * @brief      Advance the flash work
+  *
+  * @retval     FWUPD_OK            Nothing pending
+  * @retval     FWUPD_BUSY          Flash work still pending
+  * @retval     FWUPD_ERR_STATE     No update in progress
+  * @retval     <0                  An erase, program or hash failed
+  *
+  * @details    Returns at once while the ISP is busy. Otherwise it feeds one FMC_ISPCMD_PROGRAM_MUL
+  *             burst of up to FMC_MULTI_WORD_PROG_LEN bytes of a queued block whose page is erased,
+  *             or triggers the erase of the next page without waiting for it. Call it from the main
+  *             loop while waiting for image data; FWUPD_Write() calls it once per chunk as well.
+  */
+int32_t FWUPD_Poll(void)
+{
+    uint32_t u32Len, u32Start;
+    int32_t  i32Ret;
+
+    if (s_u32State == FWUPD_STATE_DONE)
+        return FWUPD_OK;
+    if (s_u32State != FWUPD_STATE_RUN)
+        return FWUPD_ERR_STATE;
+    if (s_i32Error != FWUPD_OK)
+        return s_i32Error;
+
+    FWUPD_Tick();
+
+    if (FMC->MPSTS & FMC_MPSTS_MPBUSY_Msk)
+        return FWUPD_BUSY;
+
+    if (FMC_GET_FAIL_FLAG())
+    {
+        FMC_CLR_FAIL_FLAG();
+        return FWUPD_Fail(FWUPD_ERR_FLASH);
+    }
+
+    if (s_u32Erasing)
+    {
+        s_u32Erasing = 0UL;
+        s_u32EraseNext += FMC_FLASH_PAGE_SIZE;
+        s_sStats.u32PagesErased++;
+    }
+
+    if ((s_u32Prog != FWUPD_NONE) &&
+            ((s_u32ProgAddr + s_u32ProgLen <= s_u32EraseNext) || (s_u32ProgAddr >= s_u32TrailerPage)))
+    {
+        u32Len = s_u32ProgLen - s_u32ProgOff;
+        if (u32Len > FMC_MULTI_WORD_PROG_LEN)
+            u32Len = FMC_MULTI_WORD_PROG_LEN;
+
+        u32Start = DWT->CYCCNT;
+        i32Ret = FMC_WriteMultiple(s_u32ProgAddr + s_u32ProgOff,
+                                   (uint32_t *)(FWUPD_Block(s_u32Prog) + s_u32ProgOff), u32Len);
+        s_sStats.u32ProgramUs += (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+        if (i32Ret <= 0)
+            return FWUPD_Fail(FWUPD_ERR_FLASH);
+
+        /* A burst cut short by the ISP is resumed from where it stopped */
+        s_sStats.u32Bursts++;
+        s_u32ProgOff += (uint32_t)i32Ret;
+        if (s_u32ProgOff >= s_u32ProgLen)
+            s_u32Prog = FWUPD_NONE;
+        return FWUPD_BUSY;
+    }
+
+    if (s_u32EraseNext < s_u32EraseEnd)
+    {
+        FMC->ISPCMD = FMC_ISPCMD_PAGE_ERASE;
+        FMC->ISPADDR = s_u32EraseNext;
+        FMC->ISPTRG = FMC_ISPTRG_ISPGO_Msk;     /* no wait, see FMC_Dual_Bank */
+        s_u32Erasing = 1UL;
+        return FWUPD_BUSY;
+    }
+
+    return (s_u32Prog == FWUPD_NONE) ? FWUPD_OK : FWUPD_BUSY;
+}
+
+/**
+  * @brief      Complete the image and optionally commit it
+  *
+  * @param[in]  pu8Expected Expected SHA-256 digest of the image. NULL to only compute it.
+  * @param[out] pu8Digest   Receives the SHA-256 digest of the image, FWUPD_DIGEST_SIZE bytes. May be NULL.
+  *
+  * @retval     FWUPD_OK            Image programmed, and committed if pu8Expected was given
+  * @retval     FWUPD_ERR_STATE     No update in progress
+  * @retval     FWUPD_ERR_SIZE      No data, or less than the announced image size
+  * @retval     FWUPD_ERR_DIGEST    The digest differs from pu8Expected, the slot stays uncommitted
+  * @retval     <0                  An erase, program, hash or commit failed
+  *
+  * @details    Programs the last block, padded with 0xFF, and waits for all flash work. With
+  *             pu8Expected NULL the application can check the digest against a manifest received
+  *             later and call FWUPD_Commit() itself.
+  */
+int32_t FWUPD_Finish(const uint8_t *pu8Expected, uint8_t *pu8Digest)
+{
+    uint8_t  au8Digest[FWUPD_DIGEST_SIZE];
+    uint32_t u32End, i;
+    int32_t  i32Ret;
+
+    if (s_u32State != FWUPD_STATE_RUN)
+        return FWUPD_ERR_STATE;
+    if (s_i32Error != FWUPD_OK)
+        return s_i32Error;
+    if ((s_sStats.u32Bytes == 0UL) ||
+            (s_sCfg.u32ImageSize && (s_sStats.u32Bytes != s_sCfg.u32ImageSize)))
+        return FWUPD_ERR_SIZE;
+
+    /* FMC_WriteMultiple() may load a few words past the length it was given; make them erased values */
+    memset(FWUPD_Block(s_u32Fill) + s_u32FillLen, 0xFF, s_sCfg.u32BlockSize - s_u32FillLen);
+
+    i32Ret = FWUPD_ShaStart(FWUPD_Block(s_u32Fill), s_u32FillLen, 1UL);
+    if (i32Ret == FWUPD_OK)
+        i32Ret = FWUPD_WaitOther();
+    if (i32Ret != FWUPD_OK)
+        return i32Ret;
+    if (s_u32FillQueued == 0UL)
+        FWUPD_Queue();
+
+    /* Pages past the image need no erase when its size was not known */
+    u32End = (s_u32FillAddr + s_u32FillLen + FMC_FLASH_PAGE_SIZE - 1UL) & FMC_PAGE_ADDR_MASK;
+    if (s_u32EraseEnd > u32End)
+        s_u32EraseEnd = u32End;
+
+    while ((i32Ret = FWUPD_Poll()) == FWUPD_BUSY) { }
+    if (i32Ret == FWUPD_OK)
+        i32Ret = FWUPD_ShaWait();
+    if (i32Ret != FWUPD_OK)
+        return i32Ret;
+
+    SHA_Read(CRPT, s_au32Digest);
+    s_u32State = FWUPD_STATE_DONE;
+    FWUPD_Tick();
+    if (s_sStats.u32TotalUs != 0UL)
+        s_sStats.u32KBps = (uint32_t)(((uint64_t)s_sStats.u32Bytes * 1000UL) / s_sStats.u32TotalUs);
+
+    for (i = 0UL; i < FWUPD_DIGEST_SIZE; i++)
+        au8Digest[i] = (uint8_t)(s_au32Digest[i / 4UL] >> (24UL - 8UL * (i % 4UL)));
+    if (pu8Digest != NULL)
+        memcpy(pu8Digest, au8Digest, FWUPD_DIGEST_SIZE);
+
+    if (pu8Expected == NULL)
+        return FWUPD_OK;
+    if (memcmp(pu8Expected, au8Digest, FWUPD_DIGEST_SIZE) != 0)
+        return FWUPD_ERR_DIGEST;
+    return FWUPD_Commit();
+}
+
+/**
+  * @brief      Make the finished slot bootable
+  *
+  * @retval     FWUPD_OK            The commit trailer is programmed
+  * @retval     FWUPD_ERR_STATE     FWUPD_Finish() has not completed
+  * @retval     FWUPD_ERR_FLASH     Program failed
+  *
+  * @details    Programs FWUPD_COMMIT_MAGIC and the sequence into the last 8 bytes of the slot with one
+  *             64-bit ISP program, so the slot switches from invalid to committed in one step.
+  */
+int32_t FWUPD_Commit(void)
+{
+    if (s_u32State != FWUPD_STATE_DONE)
+        return FWUPD_ERR_STATE;
+
+    if (FMC_Write8Bytes(s_sCfg.u32SlotBase + s_sCfg.u32SlotSize - 8UL, FWUPD_COMMIT_MAGIC, s_sCfg.u32Seq) != 0)
+        return FWUPD_ERR_FLASH;
+
+    s_u32State = FWUPD_STATE_IDLE;
+    return FWUPD_OK;
+}
+
+/**
+  * @brief      Abandon the update
+  *
+  * @return     None
+  *
+  * @details    Waits for the ISP and SHA engine to go idle. The slot stays uncommitted.
+  */
+void FWUPD_Abort(void)
+{
+    if (s_u32State == FWUPD_STATE_RUN)
+    {
+        while (FMC->MPSTS & FMC_MPSTS_MPBUSY_Msk) { }
+        FMC_CLR_FAIL_FLAG();
+        (void)FWUPD_ShaWait();
+    }
+    s_u32Prog = FWUPD_NONE;
+    s_u32State = FWUPD_STATE_IDLE;
+}
+
+/**
+  * @brief      Read the commit sequence of a slot
+  *
+  * @param[in]  u32SlotBase APROM address of the slot
+  * @param[in]  u32SlotSize Slot size in bytes
+  *
+  * @return     Sequence of the committed image, 0 if the slot is not committed
+  *
+  * @details    Reads through ISP, so it works from LDROM with any vector page mapping. A loader
+  *             boots the slot with the highest sequence.
+  */
+uint32_t FWUPD_GetSeq(uint32_t u32SlotBase, uint32_t u32SlotSize)
+{
+    uint32_t u32Addr = u32SlotBase + u32SlotSize - 8UL;
+    uint32_t u32Seq;
+
+    if (FMC_Read(u32Addr) != FWUPD_COMMIT_MAGIC)
+        return 0UL;
+    u32Seq = FMC_Read(u32Addr + 4UL);
+    return (u32Seq == 0xFFFFFFFFUL) ? 0UL : u32Seq;
+}
+
+/**
+  * @brief      Get the counters of the update started last
+  *
+  * @param[out] psStats     Receives the counters
+  *
+  * @return     None
+  */
+void FWUPD_GetStats(FWUPD_STATS_T *psStats)
+{
+    *psStats = s_sStats;
+}
+
+/*@}*/ /* end of group FWUPD_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group FWUPD_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,608 @@
+/**************************************************************************//**
+ * @file     hsusbd_cdc.c
+ * @version  V1.00
+ * @brief    M480 series HSUSBD CDC-ACM class with UART PDMA bridge source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "hsusbd_cdc.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup HSCDC_Driver HSUSBD CDC Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define HSCDC_DMA_IDLE      0UL
+#define HSCDC_DMA_IN        1UL
+#define HSCDC_DMA_OUT       2UL
+
+#define HSCDC_EP_GINT(ep)   (1UL << (HSUSBD_GINTSTS_EPAIF_Pos + (ep)))
+
+#define HSCDC_PDMA_TX_CTL   (PDMA_OP_BASIC | PDMA_REQ_SINGLE | PDMA_DSCT_CTL_TBINTDIS_Msk | PDMA_SAR_INC | PDMA_DAR_FIX | PDMA_WIDTH_8)
+#define HSCDC_PDMA_RX_CTL   (PDMA_OP_BASIC | PDMA_REQ_SINGLE | PDMA_DSCT_CTL_TBINTDIS_Msk | PDMA_SAR_FIX | PDMA_DAR_INC | PDMA_WIDTH_8)
+#define HSCDC_PDMA_MAX_CNT  0x10000UL
+
+static HSCDC_CFG_T s_sCfg;
+static HSCDC_LINE_CODING_T s_sLineCoding = {115200, 0, 0, 8};
+static volatile uint32_t s_u32CtrlLine;
+static HSCDC_STATS_T s_sStats;
+static uint32_t s_u32Mps = 512UL;
+
+/* USB OUT to UART ring. Head and tail are free running byte counts. */
+static volatile uint32_t s_u32TxHead;           /* Advanced when a bulk OUT DMA completes */
+static volatile uint32_t s_u32TxTail;           /* Advanced when a UART TX PDMA block completes */
+static volatile uint32_t s_u32TxPdmaLen;        /* Bytes in the running UART TX PDMA block, 0: idle */
+
+/* UART to USB IN ring. PDMA fills it in halves; the head inside a half is sampled from TXCNT. */
+static volatile uint32_t s_u32RxHead;
+static volatile uint32_t s_u32RxTail;           /* Advanced when a bulk IN DMA completes */
+static volatile uint32_t s_u32RxPdmaBase;       /* Ring position of the half being filled */
+static volatile uint32_t s_u32RxPdmaOn;
+static volatile uint32_t s_u32RxPaused;
+
+/* HSUSBD DMA engine, shared by both bulk directions */
+static volatile uint32_t s_u32DmaOp = HSCDC_DMA_IDLE;
+static volatile uint32_t s_u32DmaLen;
+static volatile uint32_t s_u32OutPend;          /* Bytes waiting in the bulk OUT endpoint buffer */
+static volatile uint32_t s_u32OutHeld;
+static volatile uint32_t s_u32InShort;          /* The IN DMA in flight ends with a short packet */
+static volatile uint32_t s_u32InZlp;            /* The last IN data ended on a packet boundary */
+
+static void HSCDC_SetLine(void)
+{
+    uint32_t u32DataWidth, u32Parity, u32StopBits;
+
+    switch (s_sLineCoding.u8DataBits)
+    {
+    case 5:
+        u32DataWidth = UART_WORD_LEN_5;
+        break;
+    case 6:
+        u32DataWidth = UART_WORD_LEN_6;
+        break;
+    case 7:
+        u32DataWidth = UART_WORD_LEN_7;
+        break;
+    default:
+        u32DataWidth = UART_WORD_LEN_8;
+        break;
+    }
+
+    switch (s_sLineCoding.u8ParityType)
+    {
+    case 1:
+        u32Parity = UART_PARITY_ODD;
+        break;
+    case 2:
+        u32Parity = UART_PARITY_EVEN;
+        break;
+    case 3:
+        u32Parity = UART_PARITY_MARK;
+        break;
+    case 4:
+        u32Parity = UART_PARITY_SPACE;
+        break;
+    default:
+        u32Parity = UART_PARITY_NONE;
+        break;
+    }
+
+    u32StopBits = (s_sLineCoding.u8CharFormat > 0) ? UART_STOP_BIT_2 : UART_STOP_BIT_1;
+
+    /* The PDMA channels keep running, only the character format changes */
+    UART_SetLineConfig(s_sCfg.uart, s_sLineCoding.u32DTERate, u32DataWidth, u32Parity, u32StopBits);
+}
+
+/* Follow the UART RX PDMA inside the half it is filling */
+static void HSCDC_RxSample(void)
+{
+    uint32_t u32Ctl, u32Head;
+
+    if (s_u32RxPdmaOn)
+    {
+        u32Ctl = PDMA->DSCT[s_sCfg.u32RxPdmaCh].CTL;
+        if (u32Ctl & PDMA_DSCT_CTL_OPMODE_Msk)
+        {
+            u32Head = s_u32RxPdmaBase + (s_sCfg.u32RxRingSize >> 1) -
+                      (((u32Ctl & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos) + 1UL);
+            if ((int32_t)(u32Head - s_u32RxHead) > 0)
+                s_u32RxHead = u32Head;
+        }
+        /* else the block just completed, the PDMA interrupt advances the head */
+    }
+}
+
+/* Arm UART RX PDMA on the next half of the ring once the USB side has drained it */
+static void HSCDC_RxArm(void)
+{
+    uint32_t u32Half = s_sCfg.u32RxRingSize >> 1;
+    uint32_t u32Ch = s_sCfg.u32RxPdmaCh;
+
+    if (s_u32RxPdmaOn)
+        return;
+
+    if ((s_u32RxPdmaBase + u32Half - s_u32RxTail) > s_sCfg.u32RxRingSize)
+    {
+        /* Ring full. The UART FIFO fills up and, with auto flow control, nRTS stops the sender. */
+        if (!s_u32RxPaused)
+        {
+            s_u32RxPaused = 1UL;
+            s_sStats.u32RxPause++;
+        }
+        return;
+    }
+
+    s_u32RxPaused = 0UL;
+    PDMA->DSCT[u32Ch].SA = (uint32_t)&s_sCfg.uart->DAT;
+    PDMA->DSCT[u32Ch].DA = (uint32_t)&s_sCfg.pu8RxRing[s_u32RxPdmaBase & (s_sCfg.u32RxRingSize - 1UL)];
+    PDMA->DSCT[u32Ch].CTL = ((u32Half - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos) | HSCDC_PDMA_RX_CTL;
+    s_u32RxPdmaOn = 1UL;
+    s_sCfg.uart->INTEN |= UART_INTEN_RXPDMAEN_Msk;
+}
+
+/* Start UART TX PDMA on the longest contiguous block of the USB OUT ring */
+static void HSCDC_TxKick(void)
+{
+    uint32_t u32Ch = s_sCfg.u32TxPdmaCh;
+    uint32_t u32Idx, u32Len;
+
+    if (s_u32TxPdmaLen != 0UL)
+        return;
+
+    u32Len = s_u32TxHead - s_u32TxTail;
+    if (u32Len == 0UL)
+        return;
+
+    u32Idx = s_u32TxTail & (s_sCfg.u32TxRingSize - 1UL);
+    if (u32Len > s_sCfg.u32TxRingSize - u32Idx)
+        u32Len = s_sCfg.u32TxRingSize - u32Idx;
+    if (u32Len > HSCDC_PDMA_MAX_CNT)
+        u32Len = HSCDC_PDMA_MAX_CNT;
+
+    PDMA->DSCT[u32Ch].SA = (uint32_t)&s_sCfg.pu8TxRing[u32Idx];
+    PDMA->DSCT[u32Ch].DA = (uint32_t)&s_sCfg.uart->DAT;
+    PDMA->DSCT[u32Ch].CTL = ((u32Len - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos) | HSCDC_PDMA_TX_CTL;
+    s_u32TxPdmaLen = u32Len;
+    s_sCfg.uart->INTEN |= UART_INTEN_TXPDMAEN_Msk;
+}
+
+/* Start the next HSUSBD DMA. Bulk OUT goes first so the host is not NAKed longer than needed. */
+static void HSCDC_UsbKick(void)
+{
+    uint32_t u32Sts, u32Idx, u32Len, u32Room;
+
+    if ((s_u32DmaOp != HSCDC_DMA_IDLE) || (g_hsusbd_Configured == 0U))
+        return;
+
+    if (s_u32OutPend)
+    {
+        /* Move the whole endpoint buffer in one go, otherwise leave bulk OUT NAKing */
+        if ((s_sCfg.u32TxRingSize - (s_u32TxHead - s_u32TxTail)) >= s_u32OutPend)
+        {
+            s_u32OutHeld = 0UL;
+            u32Idx = s_u32TxHead & (s_sCfg.u32TxRingSize - 1UL);
+            u32Len = s_u32OutPend;
+            if (u32Len > s_sCfg.u32TxRingSize - u32Idx)
+                u32Len = s_sCfg.u32TxRingSize - u32Idx;
+
+            HSUSBD_SET_DMA_WRITE(s_sCfg.u32BulkOutEpNum);
+            HSUSBD_SET_DMA_ADDR((uint32_t)&s_sCfg.pu8TxRing[u32Idx]);
+            HSUSBD_SET_DMA_LEN(u32Len);
+            s_u32DmaLen = u32Len;
+            s_u32DmaOp = HSCDC_DMA_OUT;
+            HSUSBD_ENABLE_DMA();
+            return;
+        }
+        if (!s_u32OutHeld)
+        {
+            s_u32OutHeld = 1UL;
+            s_sStats.u32OutNak++;
+        }
+    }
+
+    HSCDC_RxSample();
+    u32Len = s_u32RxHead - s_u32RxTail;
+    u32Sts = HSUSBD_GET_EP_INT_FLAG(s_sCfg.u32BulkInEp);
+
+    if (u32Len == 0UL)
+    {
+        /* End a transfer that finished on a packet boundary so the host read completes */
+        if (s_u32InZlp && (u32Sts & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk))
+        {
+            s_u32InZlp = 0UL;
+            s_sStats.u32InZlp++;
+            HSUSBD->EP[s_sCfg.u32BulkInEp].EPRSPCTL = (HSUSBD->EP[s_sCfg.u32BulkInEp].EPRSPCTL & HSUSBD_EP_RSPCTL_HALT) | HSUSBD_EP_RSPCTL_ZEROLEN;
+        }
+        return;
+    }
+
+    /* Endpoint buffer holds whole packets, so "not full" leaves room for at least one more */
+    if (u32Sts & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk)
+        u32Room = s_sCfg.u32BulkBufLen;
+    else if ((u32Sts & HSUSBD_EPINTSTS_BUFFULLIF_Msk) == 0UL)
+        u32Room = s_u32Mps;
+    else
+    {
+        HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkInEp, HSUSBD_EPINTEN_TXPKIEN_Msk);
+        return;
+    }
+
+    u32Idx = s_u32RxTail & (s_sCfg.u32RxRingSize - 1UL);
+    if (u32Len > u32Room)
+        u32Len = u32Room;
+    if (u32Len > s_sCfg.u32RxRingSize - u32Idx)
+        u32Len = s_sCfg.u32RxRingSize - u32Idx;
+
+    if (u32Len >= s_u32Mps)
+    {
+        u32Len -= (u32Len % s_u32Mps);      /* full packets are validated by hardware */
+        s_u32InShort = 0UL;
+    }
+    else
+        s_u32InShort = 1UL;
+
+    HSUSBD_SET_DMA_READ(s_sCfg.u32BulkInEpNum);
+    HSUSBD_SET_DMA_ADDR((uint32_t)&s_sCfg.pu8RxRing[u32Idx]);
+    HSUSBD_SET_DMA_LEN(u32Len);
+    s_u32DmaLen = u32Len;
+    s_u32DmaOp = HSCDC_DMA_IN;
+    HSUSBD_ENABLE_DMA();
+    HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkInEp, HSUSBD_EPINTEN_TXPKIEN_Msk);
+}
+
+static void HSCDC_Kick(void)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+    HSCDC_RxArm();
+    HSCDC_UsbKick();
+    HSCDC_TxKick();
+    __set_PRIMASK(u32PriMask);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup HSCDC_EXPORTED_FUNCTIONS HSUSBD CDC Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Open the CDC class and start the UART bridge
+  *
+  * @param[in]  psCfg       Class configuration. Copied, need not stay valid.
+  *
+  * @retval     HSCDC_OK            Success
+  * @retval     HSCDC_ERR_PARAM     Ring sizes are not powers of 2, rings are too small or not word aligned,
+  *                                 or the PDMA channels are invalid
+  *
+  * @details    Call after HSUSBD_Open(), with HSCDC_ClassRequest() given as its class request handler.
+  *             The application enables the PDMA clock, the UART (HSCDC_Open() sets its character format
+  *             to 115200 8N1 until the host sends SET_LINE_CODING), HSUSBD_BUSINTEN_DMADONEIEN_Msk in
+  *             HSUSBD->BUSINTEN, and PDMA_IRQn / USBD20_IRQn in the NVIC.
+  */
+int32_t HSCDC_Open(const HSCDC_CFG_T *psCfg)
+{
+    if ((psCfg->u32TxRingSize & (psCfg->u32TxRingSize - 1UL)) ||
+            (psCfg->u32RxRingSize & (psCfg->u32RxRingSize - 1UL)) ||
+            (psCfg->u32TxRingSize < psCfg->u32BulkBufLen) ||
+            (psCfg->u32RxRingSize < 1024UL) ||
+            (((uint32_t)psCfg->pu8TxRing | (uint32_t)psCfg->pu8RxRing) & 3UL) ||
+            (psCfg->u32TxPdmaCh >= PDMA_CH_MAX) || (psCfg->u32RxPdmaCh >= PDMA_CH_MAX) ||
+            (psCfg->u32TxPdmaCh == psCfg->u32RxPdmaCh))
+        return HSCDC_ERR_PARAM;
+
+    s_sCfg = *psCfg;
+    memset(&s_sStats, 0, sizeof(s_sStats));
+    s_u32CtrlLine = 0UL;
+    s_u32TxHead = s_u32TxTail = s_u32TxPdmaLen = 0UL;
+    s_u32RxHead = s_u32RxTail = s_u32RxPdmaBase = 0UL;
+    s_u32RxPdmaOn = s_u32RxPaused = 0UL;
+    s_u32DmaOp = HSCDC_DMA_IDLE;
+    s_u32OutPend = s_u32OutHeld = s_u32InShort = s_u32InZlp = 0UL;
+
+    s_sCfg.uart->INTEN &= ~(UART_INTEN_TXPDMAEN_Msk | UART_INTEN_RXPDMAEN_Msk);
+    HSCDC_SetLine();
+
+    PDMA_Open(PDMA, (1UL << s_sCfg.u32TxPdmaCh) | (1UL << s_sCfg.u32RxPdmaCh));
+    PDMA_SetTransferMode(PDMA, s_sCfg.u32TxPdmaCh, s_sCfg.u32TxPdmaReq, 0UL, 0UL);
+    PDMA_SetTransferMode(PDMA, s_sCfg.u32RxPdmaCh, s_sCfg.u32RxPdmaReq, 0UL, 0UL);
+    PDMA->DSCT[s_sCfg.u32TxPdmaCh].CTL = 0UL;
+    PDMA->DSCT[s_sCfg.u32RxPdmaCh].CTL = 0UL;
+    PDMA_EnableInt(PDMA, s_sCfg.u32TxPdmaCh, PDMA_INT_TRANS_DONE);
+    PDMA_EnableInt(PDMA, s_sCfg.u32RxPdmaCh, PDMA_INT_TRANS_DONE);
+
+    HSCDC_Kick();
+
+    return HSCDC_OK;
+}
+
+/**
+  * @brief      Configure the class endpoints
+  *
+  * @param[in]  u32HighSpeed    1: 512-byte bulk packets. 0: 64-byte full speed packets.
+  *
+  * @return     None
+  *
+  * @details    Call once after HSCDC_Open() and again on every bus reset, after HSUSBD_ResetDMA(). Data
+  *             already in the rings is kept; an HSUSBD DMA cut short by the reset is restarted.
+  */
+void HSCDC_InitEndpoints(uint32_t u32HighSpeed)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+
+    s_u32Mps = u32HighSpeed ? 512UL : 64UL;
+
+    HSUSBD_SetEpBufAddr(s_sCfg.u32BulkInEp, s_sCfg.u32BulkInBufBase, s_sCfg.u32BulkBufLen);
+    HSUSBD_SET_MAX_PAYLOAD(s_sCfg.u32BulkInEp, s_u32Mps);
+    HSUSBD_ConfigEp(s_sCfg.u32BulkInEp, s_sCfg.u32BulkInEpNum, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_IN);
+
+    HSUSBD_SetEpBufAddr(s_sCfg.u32BulkOutEp, s_sCfg.u32BulkOutBufBase, s_sCfg.u32BulkBufLen);
+    HSUSBD_SET_MAX_PAYLOAD(s_sCfg.u32BulkOutEp, s_u32Mps);
+    HSUSBD_ConfigEp(s_sCfg.u32BulkOutEp, s_sCfg.u32BulkOutEpNum, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_OUT);
+    HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkOutEp, HSUSBD_EPINTEN_RXPKIEN_Msk | HSUSBD_EPINTEN_SHORTRXIEN_Msk);
+
+    HSUSBD_SetEpBufAddr(s_sCfg.u32IntInEp, s_sCfg.u32IntInBufBase, 64UL);
+    HSUSBD_SET_MAX_PAYLOAD(s_sCfg.u32IntInEp, 64UL);
+    HSUSBD_ConfigEp(s_sCfg.u32IntInEp, s_sCfg.u32IntInEpNum, HSUSBD_EP_CFG_TYPE_INT, HSUSBD_EP_CFG_DIR_IN);
+
+    s_u32DmaOp = HSCDC_DMA_IDLE;
+    s_u32OutPend = s_u32OutHeld = s_u32InShort = s_u32InZlp = 0UL;
+
+    __set_PRIMASK(u32PriMask);
+}
+
+/**
+  * @brief      CDC class request handler
+  * @param      None
+  * @return     None
+  * @details    Give to HSUSBD_Open(). Handles SET/GET_LINE_CODING and SET_CONTROL_LINE_STATE of interface 0.
+  */
+void HSCDC_ClassRequest(void)
+{
+    if (gUsbCmd.bmRequestType & 0x80)   /* request data transfer direction */
+    {
+        // Device to host
+        switch (gUsbCmd.bRequest)
+        {
+        case HSCDC_GET_LINE_CODE:
+        {
+            if ((gUsbCmd.wIndex & 0xff) == 0)
+                HSUSBD_PrepareCtrlIn((uint8_t *)&s_sLineCoding, 7);
+            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_INTKIF_Msk);
+            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_INTKIEN_Msk);
+            break;
+        }
+        default:
+        {
+            /* Setup error, stall the device */
+            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
+            break;
+        }
+        }
+    }
+    else
+    {
+        // Host to device
+        switch (gUsbCmd.bRequest)
+        {
+        case HSCDC_SET_CONTROL_LINE_STATE:
+        {
+            if ((gUsbCmd.wIndex & 0xff) == 0)
+                s_u32CtrlLine = gUsbCmd.wValue;
+
+            /* Status stage */
+            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_STSDONEIF_Msk);
+            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_NAKCLR);
+            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_STSDONEIEN_Msk);
+            break;
+        }
+        case HSCDC_SET_LINE_CODE:
+        {
+            if ((gUsbCmd.wIndex & 0xff) == 0)
+                HSUSBD_CtrlOut((uint8_t *)&s_sLineCoding, 7);
+
+            /* Status stage */
+            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_STSDONEIF_Msk);
+            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_NAKCLR);
+            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_STSDONEIEN_Msk);
+
+            if ((gUsbCmd.wIndex & 0xff) == 0)
+                HSCDC_SetLine();
+            break;
+        }
+        default:
+        {
+            /* Setup error, stall the device */
+            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
+            break;
+        }
+        }
+    }
+}
+
+/**
+  * @brief      Handle the class endpoint interrupts
+  *
+  * @param[in]  u32GIntSts  HSUSBD->GINTSTS & HSUSBD->GINTEN. Other endpoints' bits are ignored.
+  *
+  * @return     None
+  *
+  * @details    Call from USBD20_IRQHandler(). A bulk OUT packet disables the bulk OUT interrupt until its
+  *             data is in the ring, so while the UART TX ring is full the endpoint buffer fills up and
+  *             the host is NAKed.
+  */
+void HSCDC_EpHandler(uint32_t u32GIntSts)
+{
+    uint32_t u32IrqSt;
+
+    if (u32GIntSts & HSCDC_EP_GINT(s_sCfg.u32BulkInEp))
+    {
+        u32IrqSt = HSUSBD->EP[s_sCfg.u32BulkInEp].EPINTSTS & HSUSBD->EP[s_sCfg.u32BulkInEp].EPINTEN;
+        HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkInEp, 0);
+        HSUSBD_CLR_EP_INT_FLAG(s_sCfg.u32BulkInEp, u32IrqSt);
+        HSCDC_Kick();
+    }
+
+    if (u32GIntSts & HSCDC_EP_GINT(s_sCfg.u32BulkOutEp))
+    {
+        u32IrqSt = HSUSBD->EP[s_sCfg.u32BulkOutEp].EPINTSTS & HSUSBD->EP[s_sCfg.u32BulkOutEp].EPINTEN;
+        /* Clear before reading the count, a packet arriving later raises the flag again */
+        HSUSBD_CLR_EP_INT_FLAG(s_sCfg.u32BulkOutEp, u32IrqSt);
+        if (u32IrqSt & (HSUSBD_EPINTSTS_RXPKIF_Msk | HSUSBD_EPINTSTS_SHORTRXIF_Msk))
+        {
+            s_u32OutPend = HSUSBD->EP[s_sCfg.u32BulkOutEp].EPDATCNT & 0xffff;
+            if (s_u32OutPend)
+            {
+                HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkOutEp, 0);
+                HSCDC_Kick();
+            }
+            /* else zero length packet, nothing to move */
+        }
+    }
+
+    if (u32GIntSts & HSCDC_EP_GINT(s_sCfg.u32IntInEp))
+    {
+        u32IrqSt = HSUSBD->EP[s_sCfg.u32IntInEp].EPINTSTS & HSUSBD->EP[s_sCfg.u32IntInEp].EPINTEN;
+        HSUSBD_CLR_EP_INT_FLAG(s_sCfg.u32IntInEp, u32IrqSt);
+    }
+}
+
+/**
+  * @brief      Handle HSUSBD DMA completion
+  * @param      None
+  * @return     None
+  * @details    Call from USBD20_IRQHandler() on HSUSBD_BUSINTSTS_DMADONEIF_Msk, after clearing the flag.
+  *             Does nothing if the class did not start the DMA.
+  */
+void HSCDC_DmaDoneHandler(void)
+{
+    uint32_t u32Ep = s_sCfg.u32BulkInEp;
+
+    if (s_u32DmaOp == HSCDC_DMA_OUT)
+    {
+        s_u32TxHead += s_u32DmaLen;
+        s_u32OutPend -= s_u32DmaLen;
+        s_sStats.u32OutBytes += s_u32DmaLen;
+        s_u32DmaOp = HSCDC_DMA_IDLE;
+        if (s_u32OutPend == 0UL)
+            HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkOutEp, HSUSBD_EPINTEN_RXPKIEN_Msk | HSUSBD_EPINTEN_SHORTRXIEN_Msk);
+    }
+    else if (s_u32DmaOp == HSCDC_DMA_IN)
+    {
+        s_u32RxTail += s_u32DmaLen;
+        s_sStats.u32InBytes += s_u32DmaLen;
+        if (s_u32InShort)
+        {
+            HSUSBD->EP[u32Ep].EPRSPCTL = (HSUSBD->EP[u32Ep].EPRSPCTL & HSUSBD_EP_RSPCTL_HALT) | HSUSBD_EP_RSPCTL_SHORTTXEN;    // packet end
+            s_u32InZlp = 0UL;
+        }
+        else
+            s_u32InZlp = 1UL;
+        s_u32DmaOp = HSCDC_DMA_IDLE;
+    }
+    else
+        return;
+
+    HSCDC_Kick();
+}
+
+/**
+  * @brief      Handle the class PDMA channels
+  * @param      None
+  * @return     None
+  * @details    Call from PDMA_IRQHandler(). Only the transfer done flags of the two class channels are
+  *             cleared, other channels are left to the caller.
+  */
+void HSCDC_PdmaHandler(void)
+{
+    uint32_t u32TdSts;
+
+    if ((PDMA->INTSTS & PDMA_INTSTS_TDIF_Msk) == 0UL)
+        return;
+
+    u32TdSts = PDMA->TDSTS;
+
+    if (u32TdSts & (1UL << s_sCfg.u32TxPdmaCh))
+    {
+        PDMA_CLR_TD_FLAG(PDMA, 1UL << s_sCfg.u32TxPdmaCh);
+        s_sCfg.uart->INTEN &= ~UART_INTEN_TXPDMAEN_Msk;
+        s_u32TxTail += s_u32TxPdmaLen;
+        s_u32TxPdmaLen = 0UL;
+    }
+
+    if (u32TdSts & (1UL << s_sCfg.u32RxPdmaCh))
+    {
+        PDMA_CLR_TD_FLAG(PDMA, 1UL << s_sCfg.u32RxPdmaCh);
+        s_sCfg.uart->INTEN &= ~UART_INTEN_RXPDMAEN_Msk;
+        s_u32RxPdmaBase += (s_sCfg.u32RxRingSize >> 1);
+        s_u32RxHead = s_u32RxPdmaBase;
+        s_u32RxPdmaOn = 0UL;
+    }
+
+    HSCDC_Kick();
+}
+
+/**
+  * @brief      Forward UART data that has not filled a ring half yet
+  * @param      None
+  * @return     None
+  * @details    Call from the main loop. Samples how far UART RX PDMA got, starts bulk IN on it and
+  *             resumes paused transfers. All other progress is interrupt driven.
+  */
+void HSCDC_Process(void)
+{
+    HSCDC_Kick();
+}
+
+/**
+  * @brief      Get the control line state set by the host
+  * @param      None
+  * @return     Combination of HSCDC_CTRL_DTR and HSCDC_CTRL_RTS
+  */
+uint32_t HSCDC_GetCtrlLineState(void)
+{
+    return s_u32CtrlLine;
+}
+
+/**
+  * @brief      Get the line coding set by the host
+  * @param[out] psLineCoding    Current line coding
+  * @return     None
+  */
+void HSCDC_GetLineCoding(HSCDC_LINE_CODING_T *psLineCoding)
+{
+    *psLineCoding = s_sLineCoding;
+}
+
+/**
+  * @brief      Get the transfer counters
+  * @param[out] psStats     Counters since HSCDC_Open()
+  * @return     None
+  */
+void HSCDC_GetStats(HSCDC_STATS_T *psStats)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+    *psStats = s_sStats;
+    __set_PRIMASK(u32PriMask);
+}
+
+/*@}*/ /* end of group HSCDC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group HSCDC_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,1116 @@
+/**************************************************************************//**
+ * @file     hsusbd_msc.c
+ * @version  V1.00
+ * @brief    M480 series HSUSBD mass storage (Bulk-Only Transport) class source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "hsusbd_msc.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup HSMSC_Driver HSUSBD MSC Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define HSMSC_DMA_IDLE      0UL
+#define HSMSC_DMA_IN        1UL
+#define HSMSC_DMA_OUT       2UL
+
+#define HSMSC_MAX_DMA_LEN   0x1000UL
+#define HSMSC_ABORT         (-3L)       /* Bus reset or BOT reset during a command */
+
+#define HSMSC_EP_GINT(ep)   (1UL << (HSUSBD_GINTSTS_EPAIF_Pos + (ep)))
+
+#define HSMSC_CBW_SIGNATURE 0x43425355UL
+#define HSMSC_CSW_SIGNATURE 0x53425355UL
+
+/* SCSI commands */
+#define UFI_TEST_UNIT_READY                 0x00
+#define UFI_REQUEST_SENSE                   0x03
+#define UFI_INQUIRY                         0x12
+#define UFI_MODE_SELECT_6                   0x15
+#define UFI_MODE_SENSE_6                    0x1A
+#define UFI_START_STOP                      0x1B
+#define UFI_PREVENT_ALLOW_MEDIUM_REMOVAL    0x1E
+#define UFI_READ_FORMAT_CAPACITY            0x23
+#define UFI_READ_CAPACITY                   0x25
+#define UFI_READ_10                         0x28
+#define UFI_READ_12                         0xA8
+#define UFI_WRITE_10                        0x2A
+#define UFI_WRITE_12                        0xAA
+#define UFI_VERIFY_10                       0x2F
+#define UFI_MODE_SELECT_10                  0x55
+#define UFI_MODE_SENSE_10                   0x5A
+
+/* Command Block Wrapper, 31 bytes on the wire */
+typedef struct
+{
+    uint32_t  dCBWSignature;
+    uint32_t  dCBWTag;
+    uint32_t  dCBWDataTransferLength;
+    uint8_t   bmCBWFlags;
+    uint8_t   bCBWLUN;
+    uint8_t   bCBWCBLength;
+    uint8_t   u8OPCode;
+    uint8_t   u8LUN;
+    uint8_t   au8Data[14];
+} HSMSC_CBW_T;
+
+/* Command Status Wrapper, 13 bytes on the wire */
+typedef struct
+{
+    uint32_t  dCSWSignature;
+    uint32_t  dCSWTag;
+    uint32_t  dCSWDataResidue;
+    uint8_t   bCSWStatus;
+} HSMSC_CSW_T;
+
+static HSMSC_CFG_T s_sCfg;
+static HSMSC_STATS_T s_sStats;
+static uint32_t s_u32Mps = 512UL;
+static uint32_t s_u32CyclesPerUs = 1UL;
+static uint32_t s_u32MaxLun = 0UL;
+
+static HSMSC_CBW_T s_sCBW;
+static HSMSC_CSW_T s_sCSW;
+static uint32_t s_au32Cmd[32];                  /* CBW, CSW and short data phases */
+static uint8_t s_au8SenseKey[3];
+static uint8_t s_u8Prevent;
+static volatile uint8_t s_u8Remove;
+
+static volatile uint32_t s_u32OutPkt;           /* Bulk OUT packet received, checked for a CBW */
+static volatile uint32_t s_u32Abort;
+
+/* HSUSBD DMA engine, chained from the interrupt handler in pieces of up to HSMSC_MAX_DMA_LEN */
+static volatile uint32_t s_u32UsbDir = HSMSC_DMA_IDLE;
+static volatile uint32_t s_u32UsbAddr;
+static volatile uint32_t s_u32UsbLeft;
+static volatile uint32_t s_u32DmaLen;
+static volatile uint32_t s_u32InShort;          /* The IN DMA in flight ends with a short packet */
+static volatile uint32_t s_u32InWait;           /* Waiting for the bulk IN buffer to drain */
+
+/* Block device request */
+static uint32_t s_u32DiskBusy;
+static int32_t s_i32DiskRet;
+
+static const uint8_t s_au8InquiryID[36] =
+{
+    0x00,                   /* Peripheral Device Type */
+    0x80,                   /* RMB */
+    0x00,                   /* ISO/ECMA, ANSI Version */
+    0x00,                   /* Response Data Format */
+    0x1F, 0x00, 0x00, 0x00, /* Additional Length */
+
+    /* Vendor Identification */
+    'N', 'u', 'v', 'o', 't', 'o', 'n', ' ',
+
+    /* Product Identification */
+    'U', 'S', 'B', ' ', 'M', 'a', 's', 's', ' ', 'S', 't', 'o', 'r', 'a', 'g', 'e',
+
+    /* Product Revision */
+    '1', '.', '0', '0'
+};
+
+/* Mode pages returned by MODE SENSE(10) */
+static const uint8_t s_au8ModePage_01[12] =
+{
+    0x01, 0x0A, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x00
+};
+
+static const uint8_t s_au8ModePage_05[32] =
+{
+    0x05, 0x1E, 0x13, 0x88, 0x08, 0x20, 0x02, 0x00,
+    0x01, 0xF4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x05, 0x1E, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x68, 0x00, 0x00
+};
+
+static const uint8_t s_au8ModePage_1B[12] =
+{
+    0x1B, 0x0A, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00
+};
+
+static const uint8_t s_au8ModePage_1C[8] =
+{
+    0x1C, 0x06, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00
+};
+
+static const uint8_t s_au8ModePage[4] =
+{
+    0x03, 0x00, 0x00, 0x00
+};
+
+static uint32_t HSMSC_GetBe32(const uint8_t *pu8Buf)
+{
+    return ((uint32_t)pu8Buf[0] << 24) | ((uint32_t)pu8Buf[1] << 16) |
+           ((uint32_t)pu8Buf[2] << 8) | (uint32_t)pu8Buf[3];
+}
+
+static void HSMSC_PutBe32(uint8_t *pu8Buf, uint32_t u32Val)
+{
+    pu8Buf[0] = (uint8_t)(u32Val >> 24);
+    pu8Buf[1] = (uint8_t)(u32Val >> 16);
+    pu8Buf[2] = (uint8_t)(u32Val >> 8);
+    pu8Buf[3] = (uint8_t)u32Val;
+}
+
+static void HSMSC_SetSense(uint8_t u8Key, uint8_t u8Asc)
+{
+    s_au8SenseKey[0] = u8Key;
+    s_au8SenseKey[1] = u8Asc;
+    s_au8SenseKey[2] = 0;
+}
+
+/* Start the next piece of the current USB transfer. Interrupts are masked or this is the USB interrupt. */
+static void HSMSC_UsbNext(uint32_t u32InEmpty)
+{
+    uint32_t u32Ep = s_sCfg.u32BulkInEp;
+    uint32_t u32Len = s_u32UsbLeft;
+
+    if (u32Len == 0UL)
+    {
+        s_u32UsbDir = HSMSC_DMA_IDLE;
+        return;
+    }
+
+    if (u32Len > HSMSC_MAX_DMA_LEN)
+        u32Len = HSMSC_MAX_DMA_LEN;
+
+    if (s_u32UsbDir == HSMSC_DMA_IN)
+    {
+        if (u32Len >= s_u32Mps)
+        {
+            u32Len -= (u32Len % s_u32Mps);      /* full packets are validated by hardware */
+            s_u32InShort = 0UL;
+        }
+        else
+        {
+            /* The short packet is ended by SHORTTXEN, so the full packets before it must be gone */
+            if (!u32InEmpty && ((HSUSBD_GET_EP_INT_FLAG(u32Ep) & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk) == 0UL))
+            {
+                s_u32InWait = 1UL;
+                HSUSBD_ENABLE_EP_INT(u32Ep, HSUSBD_EPINTEN_BUFEMPTYIEN_Msk);
+                return;
+            }
+            s_u32InShort = 1UL;
+        }
+        HSUSBD_SET_DMA_READ(s_sCfg.u32BulkInEpNum);
+    }
+    else
+        HSUSBD_SET_DMA_WRITE(s_sCfg.u32BulkOutEpNum);
+
+    HSUSBD_SET_DMA_ADDR(s_u32UsbAddr);
+    HSUSBD_SET_DMA_LEN(u32Len);
+    s_u32DmaLen = u32Len;
+    HSUSBD_ENABLE_DMA();
+}
+
+/* Start a bulk transfer. It runs from the USB interrupt until HSMSC_UsbWait() sees it idle. */
+static void HSMSC_UsbStart(uint32_t u32Dir, void *pvBuf, uint32_t u32Len)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+    s_u32UsbAddr = (uint32_t)pvBuf;
+    s_u32UsbLeft = u32Len;
+    s_u32UsbDir = u32Dir;
+    HSMSC_UsbNext(0UL);
+    __set_PRIMASK(u32PriMask);
+}
+
+static int32_t HSMSC_UsbWait(void)
+{
+    uint32_t u32Start;
+
+    if (s_u32UsbDir != HSMSC_DMA_IDLE)
+    {
+        u32Start = DWT->CYCCNT;
+        while (s_u32UsbDir != HSMSC_DMA_IDLE)
+        {
+            if (s_u32Abort || (g_hsusbd_Configured == 0U) || !HSUSBD_IS_ATTACHED())
+                return HSMSC_ABORT;
+            if (s_sCfg.pfnIdle != NULL)
+                s_sCfg.pfnIdle();
+        }
+        s_sStats.u32UsbWaitUs += (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+    }
+
+    return s_u32Abort ? HSMSC_ABORT : HSMSC_OK;
+}
+
+/* Stall bulk IN once the data already queued has been sent */
+static void HSMSC_StallIn(void)
+{
+    uint32_t u32Ep = s_sCfg.u32BulkInEp;
+
+    while ((HSUSBD_GET_EP_INT_FLAG(u32Ep) & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk) == 0UL)
+    {
+        if (s_u32Abort || (g_hsusbd_Configured == 0U) || !HSUSBD_IS_ATTACHED())
+            return;
+    }
+    HSUSBD_SetEpStall(u32Ep);
+}
+
+/* Send up to u32Len bytes of a short data phase, the rest of the host length is the residue */
+static int32_t HSMSC_DataIn(uint32_t u32Len)
+{
+    uint32_t u32Host = s_sCBW.dCBWDataTransferLength;
+
+    if (u32Len > u32Host)
+        u32Len = u32Host;
+
+    HSMSC_UsbStart(HSMSC_DMA_IN, s_au32Cmd, u32Len);
+    s_sCSW.dCSWDataResidue = u32Host - u32Len;
+    s_sCSW.bCSWStatus = 0;
+
+    /* A data phase ending on a packet boundary is not terminated, stall to end it */
+    if ((u32Len < u32Host) && ((u32Len % s_u32Mps) == 0UL))
+    {
+        if (HSMSC_UsbWait() != HSMSC_OK)
+            return HSMSC_ABORT;
+        HSMSC_StallIn();
+    }
+
+    return HSMSC_UsbWait();
+}
+
+static void HSMSC_DiskDone(int32_t i32Ret)
+{
+    s_i32DiskRet = i32Ret;
+    if (i32Ret != HSMSC_OK)
+        s_sStats.u32DiskErrors++;
+}
+
+static void HSMSC_DiskStart(uint32_t u32Write, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    HSMSC_DISK_T *psDisk = s_sCfg.psDisk;
+    uint32_t u32Start = DWT->CYCCNT;
+    int32_t i32Ret;
+
+    if (u32Write)
+        i32Ret = psDisk->pfnWrite(psDisk, u32Sector, u32Count, pu8Buf);
+    else
+        i32Ret = psDisk->pfnRead(psDisk, u32Sector, u32Count, pu8Buf);
+
+    if ((i32Ret == HSMSC_OK) && (psDisk->pfnPoll != NULL))
+        s_u32DiskBusy = 1UL;
+    else
+    {
+        /* Synchronous device, the call was the whole request */
+        s_sStats.u32DiskWaitUs += (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+        HSMSC_DiskDone(i32Ret);
+    }
+}
+
+static int32_t HSMSC_DiskWait(void)
+{
+    HSMSC_DISK_T *psDisk = s_sCfg.psDisk;
+    uint32_t u32Start;
+    int32_t i32Ret;
+
+    if (s_u32DiskBusy)
+    {
+        u32Start = DWT->CYCCNT;
+        while ((i32Ret = psDisk->pfnPoll(psDisk)) == HSMSC_BUSY)
+        {
+            if (s_sCfg.pfnIdle != NULL)
+                s_sCfg.pfnIdle();
+        }
+        s_sStats.u32DiskWaitUs += (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+        s_u32DiskBusy = 0UL;
+        HSMSC_DiskDone(i32Ret);
+    }
+
+    return s_i32DiskRet;
+}
+
+/* READ data phase. Chunk N goes out by USB DMA while the block device reads chunk N+1. */
+static int32_t HSMSC_ReadData(uint32_t u32Sector, uint32_t u32Count)
+{
+    uint8_t *apu8Buf[2];
+    uint32_t u32Chunk = s_sCfg.u32ChunkSize / HSMSC_SECTOR_SIZE;
+    uint32_t u32Idx = 0UL, u32Len;
+    int32_t i32Ret = HSMSC_OK;
+
+    if (u32Count == 0UL)
+        return HSMSC_OK;
+
+    apu8Buf[0] = s_sCfg.pu8Buf;
+    apu8Buf[1] = s_sCfg.pu8Buf + s_sCfg.u32ChunkSize;
+    s_i32DiskRet = HSMSC_OK;
+
+    u32Len = (u32Count < u32Chunk) ? u32Count : u32Chunk;
+    HSMSC_DiskStart(0UL, u32Sector, u32Len, apu8Buf[0]);
+
+    while (u32Count)
+    {
+        /* Chunk in apu8Buf[u32Idx] read, the other buffer sent */
+        if (HSMSC_DiskWait() != HSMSC_OK)
+            i32Ret = HSMSC_ERR_IO;
+        if (HSMSC_UsbWait() != HSMSC_OK)
+            return HSMSC_ABORT;     /* no block device request is running here */
+
+        /* The host still gets its data after an error, the CSW reports the failure */
+        HSMSC_UsbStart(HSMSC_DMA_IN, apu8Buf[u32Idx], u32Len * HSMSC_SECTOR_SIZE);
+        u32Sector += u32Len;
+        u32Count -= u32Len;
+
+        if (u32Count)
+        {
+            u32Len = (u32Count < u32Chunk) ? u32Count : u32Chunk;
+            u32Idx ^= 1UL;
+            if (i32Ret == HSMSC_OK)
+                HSMSC_DiskStart(0UL, u32Sector, u32Len, apu8Buf[u32Idx]);
+        }
+    }
+
+    if (HSMSC_UsbWait() != HSMSC_OK)
+        return HSMSC_ABORT;
+
+    return i32Ret;
+}
+
+/* WRITE data phase. Chunk N+1 comes in by USB DMA while the block device writes chunk N. */
+static int32_t HSMSC_WriteData(uint32_t u32Sector, uint32_t u32Count)
+{
+    uint8_t *apu8Buf[2];
+    uint32_t u32Chunk = s_sCfg.u32ChunkSize / HSMSC_SECTOR_SIZE;
+    uint32_t u32Idx = 0UL, u32Len, u32Cur;
+    int32_t i32Ret = HSMSC_OK;
+
+    if (u32Count == 0UL)
+        return HSMSC_OK;
+
+    apu8Buf[0] = s_sCfg.pu8Buf;
+    apu8Buf[1] = s_sCfg.pu8Buf + s_sCfg.u32ChunkSize;
+    s_i32DiskRet = HSMSC_OK;
+
+    u32Len = (u32Count < u32Chunk) ? u32Count : u32Chunk;
+    HSMSC_UsbStart(HSMSC_DMA_OUT, apu8Buf[0], u32Len * HSMSC_SECTOR_SIZE);
+
+    while (u32Count)
+    {
+        /* Chunk in apu8Buf[u32Idx] received, the other buffer written */
+        if (HSMSC_UsbWait() != HSMSC_OK)
+        {
+            HSMSC_DiskWait();
+            return HSMSC_ABORT;
+        }
+        if (HSMSC_DiskWait() != HSMSC_OK)
+            i32Ret = HSMSC_ERR_IO;
+
+        u32Cur = u32Len;
+        u32Count -= u32Cur;
+        if (u32Count)
+        {
+            u32Len = (u32Count < u32Chunk) ? u32Count : u32Chunk;
+            HSMSC_UsbStart(HSMSC_DMA_OUT, apu8Buf[u32Idx ^ 1UL], u32Len * HSMSC_SECTOR_SIZE);
+        }
+
+        /* The host data is still drained after an error, the CSW reports the failure */
+        if (i32Ret == HSMSC_OK)
+            HSMSC_DiskStart(1UL, u32Sector, u32Cur, apu8Buf[u32Idx]);
+        u32Sector += u32Cur;
+        u32Idx ^= 1UL;
+    }
+
+    if (HSMSC_DiskWait() != HSMSC_OK)
+        i32Ret = HSMSC_ERR_IO;
+
+    return i32Ret;
+}
+
+static void HSMSC_AckCmd(void)
+{
+    /* The host sends the next CBW only after this CSW, any earlier OUT packet was data */
+    s_u32OutPkt = 0UL;
+    memcpy(s_au32Cmd, &s_sCSW, 13);
+    HSMSC_UsbStart(HSMSC_DMA_IN, s_au32Cmd, 13);
+    HSMSC_UsbWait();
+}
+
+/* Fail a command whose data phase is not done, stalling the pipe the host expects data on */
+static void HSMSC_FailCmd(void)
+{
+    s_u8Prevent = 1;
+    s_sCSW.bCSWStatus = 0x01;
+    s_sCSW.dCSWDataResidue = s_sCBW.dCBWDataTransferLength;
+    if (s_sCBW.dCBWDataTransferLength)
+    {
+        if (s_sCBW.bmCBWFlags & 0x80)
+            HSMSC_StallIn();
+        else
+            HSUSBD_SetEpStall(s_sCfg.u32BulkOutEp);
+    }
+}
+
+static int32_t HSMSC_ReadWrite(uint32_t u32Write)
+{
+    uint32_t u32Lba, u32Count, u32Host, u32Xfer, u32Start, u32Us;
+    int32_t i32Ret;
+
+    u32Host = s_sCBW.dCBWDataTransferLength;
+    u32Lba = HSMSC_GetBe32(&s_sCBW.au8Data[0]);
+    if ((s_sCBW.u8OPCode == UFI_READ_10) || (s_sCBW.u8OPCode == UFI_WRITE_10))
+        u32Count = ((uint32_t)s_sCBW.au8Data[5] << 8) | s_sCBW.au8Data[6];
+    else
+        u32Count = HSMSC_GetBe32(&s_sCBW.au8Data[4]);
+
+    /* Direction mismatch, Ho <> Di (Case 10) or Hi <> Do (Case 8) */
+    if ((u32Host != 0UL) && (((s_sCBW.bmCBWFlags & 0x80) != 0) == (u32Write != 0UL)))
+    {
+        HSMSC_FailCmd();
+        return HSMSC_OK;
+    }
+
+    if ((u32Lba >= s_sCfg.psDisk->u32Sectors) || (u32Count > s_sCfg.psDisk->u32Sectors - u32Lba))
+    {
+        HSMSC_SetSense(0x05, 0x21);     /* LOGICAL BLOCK ADDRESS OUT OF RANGE */
+        HSMSC_FailCmd();
+        return HSMSC_OK;
+    }
+
+    s_sCSW.bCSWStatus = 0;
+    if (u32Host != u32Count * HSMSC_SECTOR_SIZE)
+    {
+        /* Hn < Di/Do (Case 2/3), Hi < Di (Case 7), Ho < Do (Case 13), Hi > Di (Case 4/5), Ho > Do (Case 11) */
+        s_u8Prevent = 1;
+        s_sCSW.bCSWStatus = 0x01;
+        if (u32Count > u32Host / HSMSC_SECTOR_SIZE)
+            u32Count = u32Host / HSMSC_SECTOR_SIZE;
+    }
+    u32Xfer = u32Count * HSMSC_SECTOR_SIZE;
+    s_sCSW.dCSWDataResidue = u32Host - u32Xfer;
+
+    u32Start = DWT->CYCCNT;
+    if (u32Write)
+        i32Ret = HSMSC_WriteData(u32Lba, u32Count);
+    else
+        i32Ret = HSMSC_ReadData(u32Lba, u32Count);
+    if (i32Ret == HSMSC_ABORT)
+        return HSMSC_ABORT;
+    u32Us = (DWT->CYCCNT - u32Start) / s_u32CyclesPerUs;
+
+    if (u32Write)
+    {
+        s_sStats.u32WriteCmds++;
+        s_sStats.u32WriteBytes += u32Xfer;
+        s_sStats.u32WriteUs += u32Us;
+    }
+    else
+    {
+        s_sStats.u32ReadCmds++;
+        s_sStats.u32ReadBytes += u32Xfer;
+        s_sStats.u32ReadUs += u32Us;
+    }
+
+    if (i32Ret != HSMSC_OK)
+    {
+        if (u32Write)
+            HSMSC_SetSense(0x03, 0x0C);     /* WRITE ERROR */
+        else
+            HSMSC_SetSense(0x03, 0x11);     /* UNRECOVERED READ ERROR */
+        s_u8Prevent = 1;
+        s_sCSW.bCSWStatus = 0x01;
+    }
+
+    /* Stop the host from waiting for the rest of its transfer length */
+    if (s_sCSW.dCSWDataResidue)
+    {
+        if (u32Write)
+            HSUSBD_SetEpStall(s_sCfg.u32BulkOutEp);
+        else
+            HSMSC_StallIn();
+    }
+
+    return HSMSC_OK;
+}
+
+static int32_t HSMSC_RequestSense(void)
+{
+    uint8_t *pu8Buf = (uint8_t *)s_au32Cmd;
+
+    memset(pu8Buf, 0, 18);
+    if (s_u8Prevent)
+    {
+        s_u8Prevent = 0;
+        pu8Buf[0] = 0x70;
+    }
+    else
+        pu8Buf[0] = 0xf0;
+
+    pu8Buf[2] = s_au8SenseKey[0];
+    pu8Buf[7] = 0x0a;
+    pu8Buf[12] = s_au8SenseKey[1];
+    pu8Buf[13] = s_au8SenseKey[2];
+    HSMSC_SetSense(0, 0);
+
+    return HSMSC_DataIn(18);
+}
+
+static int32_t HSMSC_ReadFormatCapacity(void)
+{
+    uint8_t *pu8Buf = (uint8_t *)s_au32Cmd;
+
+    memset(pu8Buf, 0, 20);
+    pu8Buf[3] = 0x10;
+    HSMSC_PutBe32(&pu8Buf[4], s_sCfg.psDisk->u32Sectors);
+    pu8Buf[8] = 0x02;
+    pu8Buf[10] = 0x02;
+    HSMSC_PutBe32(&pu8Buf[12], s_sCfg.psDisk->u32Sectors);
+    pu8Buf[18] = 0x02;
+
+    return HSMSC_DataIn(20);
+}
+
+static int32_t HSMSC_ReadCapacity(void)
+{
+    uint8_t *pu8Buf = (uint8_t *)s_au32Cmd;
+
+    HSMSC_PutBe32(&pu8Buf[0], s_sCfg.psDisk->u32Sectors - 1UL);
+    HSMSC_PutBe32(&pu8Buf[4], HSMSC_SECTOR_SIZE);
+
+    return HSMSC_DataIn(8);
+}
+
+static uint32_t HSMSC_AddPage(uint8_t *pu8Buf, uint32_t u32Len, const uint8_t *pu8Page, uint32_t u32PageLen)
+{
+    memcpy(&pu8Buf[u32Len], pu8Page, u32PageLen);
+    return u32Len + u32PageLen;
+}
+
+static int32_t HSMSC_ModeSense10(void)
+{
+    uint8_t *pu8Buf = (uint8_t *)s_au32Cmd;
+    uint32_t u32Len = 8UL, u32Cyl, u32Geo = 0UL;
+
+    memset(pu8Buf, 0, 8);
+
+    switch (s_sCBW.au8Data[0] & 0x3F)
+    {
+    case 0x01:
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_01, sizeof(s_au8ModePage_01));
+        break;
+
+    case 0x05:
+        u32Geo = u32Len;
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_05, sizeof(s_au8ModePage_05));
+        break;
+
+    case 0x1B:
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_1B, sizeof(s_au8ModePage_1B));
+        break;
+
+    case 0x1C:
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_1C, sizeof(s_au8ModePage_1C));
+        break;
+
+    case 0x3F:
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_01, sizeof(s_au8ModePage_01));
+        u32Geo = u32Len;
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_05, sizeof(s_au8ModePage_05));
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_1B, sizeof(s_au8ModePage_1B));
+        u32Len = HSMSC_AddPage(pu8Buf, u32Len, s_au8ModePage_1C, sizeof(s_au8ModePage_1C));
+        break;
+
+    default:
+        HSMSC_SetSense(0x05, 0x24);     /* INVALID FIELD IN CDB */
+        break;
+    }
+
+    if (u32Geo)
+    {
+        /* Flexible disk page: 2 heads, 64 sectors per track */
+        u32Cyl = s_sCfg.psDisk->u32Sectors / 128UL;
+        pu8Buf[u32Geo + 4] = 2;
+        pu8Buf[u32Geo + 5] = 64;
+        pu8Buf[u32Geo + 8] = (uint8_t)(u32Cyl >> 8);
+        pu8Buf[u32Geo + 9] = (uint8_t)u32Cyl;
+    }
+    pu8Buf[1] = (uint8_t)(u32Len - 2UL);
+
+    return HSMSC_DataIn(u32Len);
+}
+
+/* Process one CBW. Returns HSMSC_ABORT if a reset cut the command short, no CSW is sent then. */
+static int32_t HSMSC_ProcessCbw(void)
+{
+    uint32_t u32Host, u32Len;
+    int32_t i32Ret = HSMSC_OK;
+
+    u32Len = HSUSBD->EP[s_sCfg.u32BulkOutEp].EPDATCNT & 0xffff;
+    if (u32Len == 0UL)
+        return HSMSC_OK;
+    if (u32Len > sizeof(s_au32Cmd))
+        u32Len = sizeof(s_au32Cmd);
+    HSMSC_UsbStart(HSMSC_DMA_OUT, s_au32Cmd, u32Len);
+    if (HSMSC_UsbWait() != HSMSC_OK)
+        return HSMSC_ABORT;
+
+    /* Check Signature & length of CBW */
+    if ((s_au32Cmd[0] != HSMSC_CBW_SIGNATURE) || (u32Len != 31UL))
+    {
+        /* Invalid CBW, stall both pipes until a Bulk-Only Mass Storage Reset */
+        s_u8Prevent = 1;
+        HSUSBD_SetEpStall(s_sCfg.u32BulkInEp);
+        HSUSBD_SetEpStall(s_sCfg.u32BulkOutEp);
+        g_u32HsEpStallLock = (1UL << s_sCfg.u32BulkInEp) | (1UL << s_sCfg.u32BulkOutEp);
+        return HSMSC_OK;
+    }
+
+    memcpy(&s_sCBW, s_au32Cmd, 31);
+
+    /* Prepare to echo the tag from CBW to CSW */
+    s_sCSW.dCSWSignature = HSMSC_CSW_SIGNATURE;
+    s_sCSW.dCSWTag = s_sCBW.dCBWTag;
+    s_sCSW.dCSWDataResidue = 0;
+    s_sCSW.bCSWStatus = 0;
+    u32Host = s_sCBW.dCBWDataTransferLength;
+
+    /* Parse Op-Code of CBW */
+    switch (s_sCBW.u8OPCode)
+    {
+    case UFI_READ_10:
+    case UFI_READ_12:
+        i32Ret = HSMSC_ReadWrite(0UL);
+        break;
+
+    case UFI_WRITE_10:
+    case UFI_WRITE_12:
+        i32Ret = HSMSC_ReadWrite(1UL);
+        break;
+
+    case UFI_PREVENT_ALLOW_MEDIUM_REMOVAL:
+    {
+        if (s_sCBW.au8Data[2] & 0x01)
+        {
+            HSMSC_SetSense(0x05, 0x24);     /* INVALID COMMAND */
+            s_u8Prevent = 1;
+        }
+        else
+            s_u8Prevent = 0;
+        s_sCSW.bCSWStatus = s_u8Prevent;
+        break;
+    }
+
+    case UFI_TEST_UNIT_READY:
+    {
+        if (u32Host != 0UL)                 /* Hi/Ho > Dn (Case 4/9) */
+            HSMSC_FailCmd();
+        else if (s_u8Remove)                /* Hn == Dn (Case 1) */
+        {
+            s_sCSW.bCSWStatus = 1;
+            HSMSC_SetSense(0x02, 0x3A);     /* MEDIUM NOT PRESENT */
+            s_u8Prevent = 1;
+        }
+        break;
+    }
+
+    case UFI_START_STOP:
+    {
+        if ((s_sCBW.au8Data[2] & 0x03) == 0x2)
+            s_u8Remove = 1;
+        break;
+    }
+
+    case UFI_VERIFY_10:
+        break;
+
+    case UFI_REQUEST_SENSE:
+    case UFI_INQUIRY:
+    case UFI_READ_FORMAT_CAPACITY:
+    case UFI_READ_CAPACITY:
+    case UFI_MODE_SENSE_10:
+    case UFI_MODE_SENSE_6:
+    {
+        if ((u32Host == 0UL) || ((s_sCBW.bmCBWFlags & 0x80) == 0))
+        {
+            HSMSC_FailCmd();
+            break;
+        }
+
+        if (s_sCBW.u8OPCode == UFI_REQUEST_SENSE)
+            i32Ret = HSMSC_RequestSense();
+        else if (s_sCBW.u8OPCode == UFI_INQUIRY)
+        {
+            memcpy(s_au32Cmd, s_au8InquiryID, sizeof(s_au8InquiryID));
+            i32Ret = HSMSC_DataIn(sizeof(s_au8InquiryID));
+        }
+        else if (s_sCBW.u8OPCode == UFI_READ_FORMAT_CAPACITY)
+            i32Ret = HSMSC_ReadFormatCapacity();
+        else if (s_sCBW.u8OPCode == UFI_READ_CAPACITY)
+            i32Ret = HSMSC_ReadCapacity();
+        else if (s_sCBW.u8OPCode == UFI_MODE_SENSE_10)
+            i32Ret = HSMSC_ModeSense10();
+        else
+        {
+            memcpy(s_au32Cmd, s_au8ModePage, sizeof(s_au8ModePage));
+            i32Ret = HSMSC_DataIn(sizeof(s_au8ModePage));
+        }
+        break;
+    }
+
+    case UFI_MODE_SELECT_6:
+    case UFI_MODE_SELECT_10:
+    {
+        /* Parameters are accepted and ignored */
+        u32Len = (u32Host < s_sCfg.u32ChunkSize) ? u32Host : s_sCfg.u32ChunkSize;
+        HSMSC_UsbStart(HSMSC_DMA_OUT, s_sCfg.pu8Buf, u32Len);
+        i32Ret = HSMSC_UsbWait();
+        s_sCSW.dCSWDataResidue = u32Host - u32Len;
+        if (s_sCSW.dCSWDataResidue)
+            HSUSBD_SetEpStall(s_sCfg.u32BulkOutEp);
+        break;
+    }
+
+    default:
+    {
+        /* Unsupported command */
+        HSMSC_SetSense(0x05, 0x20);         /* INVALID COMMAND OPERATION CODE */
+        HSMSC_FailCmd();
+        break;
+    }
+    }
+
+    if (i32Ret == HSMSC_ABORT)
+        return HSMSC_ABORT;
+
+    HSMSC_AckCmd();
+    return HSMSC_OK;
+}
+
+static void HSMSC_Reset(void)
+{
+    HSUSBD_ResetDMA();
+    HSUSBD->EP[s_sCfg.u32BulkInEp].EPRSPCTL = HSUSBD_EPRSPCTL_FLUSH_Msk;
+    HSUSBD->EP[s_sCfg.u32BulkOutEp].EPRSPCTL = HSUSBD_EPRSPCTL_FLUSH_Msk;
+    s_u32UsbDir = HSMSC_DMA_IDLE;
+    s_u32InWait = 0UL;
+    s_u32OutPkt = 0UL;
+    s_u32Abort = 1UL;
+}
+
+static int32_t HSMSC_RamRead(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    memcpy(pu8Buf, (uint8_t *)(psDisk->u32Base + u32Sector * HSMSC_SECTOR_SIZE), u32Count * HSMSC_SECTOR_SIZE);
+    return HSMSC_OK;
+}
+
+static int32_t HSMSC_RamWrite(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    memcpy((uint8_t *)(psDisk->u32Base + u32Sector * HSMSC_SECTOR_SIZE), pu8Buf, u32Count * HSMSC_SECTOR_SIZE);
+    return HSMSC_OK;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup HSMSC_EXPORTED_FUNCTIONS HSUSBD MSC Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Open the mass storage class
+  *
+  * @param[in]  psCfg       Class configuration. Copied, need not stay valid.
+  *
+  * @retval     HSMSC_OK            Success
+  * @retval     HSMSC_ERR_PARAM     The chunk size is not a multiple of 512, the buffer is not word
+  *                                 aligned or the block device is incomplete
+  *
+  * @details    Call after HSUSBD_Open(), with HSMSC_ClassRequest() given as its class request handler,
+  *             and after the block device is initialized. The application enables
+  *             HSUSBD_BUSINTEN_DMADONEIEN_Msk in HSUSBD->BUSINTEN and USBD20_IRQn in the NVIC.
+  *             Starts the DWT cycle counter used for the statistics.
+  */
+int32_t HSMSC_Open(const HSMSC_CFG_T *psCfg)
+{
+    HSMSC_DISK_T *psDisk = psCfg->psDisk;
+
+    if ((psDisk == NULL) || (psDisk->pfnRead == NULL) || (psDisk->pfnWrite == NULL) ||
+            (psDisk->u32Sectors == 0UL) ||
+            (psCfg->u32ChunkSize == 0UL) || (psCfg->u32ChunkSize % HSMSC_SECTOR_SIZE) ||
+            ((uint32_t)psCfg->pu8Buf & 3UL))
+        return HSMSC_ERR_PARAM;
+
+    s_sCfg = *psCfg;
+    memset(&s_sStats, 0, sizeof(s_sStats));
+    s_u8Prevent = 0;
+    s_u8Remove = 0;
+    HSMSC_SetSense(0, 0);
+    s_u32UsbDir = HSMSC_DMA_IDLE;
+    s_u32InWait = s_u32OutPkt = 0UL;
+    s_u32DiskBusy = 0UL;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    s_u32CyclesPerUs = SystemCoreClock / 1000000UL;
+    if (s_u32CyclesPerUs == 0UL)
+        s_u32CyclesPerUs = 1UL;
+
+    return HSMSC_OK;
+}
+
+/**
+  * @brief      Configure the class endpoints
+  *
+  * @param[in]  u32HighSpeed    1: 512-byte bulk packets. 0: 64-byte full speed packets.
+  *
+  * @return     None
+  *
+  * @details    Call once after HSMSC_Open() and again on every bus reset. A command in progress is
+  *             abandoned without a CSW and the medium is reported present again.
+  */
+void HSMSC_InitEndpoints(uint32_t u32HighSpeed)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+
+    s_u32Mps = u32HighSpeed ? 512UL : 64UL;
+
+    HSMSC_Reset();
+    s_u8Remove = 0;
+
+    HSUSBD_SetEpBufAddr(s_sCfg.u32BulkInEp, s_sCfg.u32BulkInBufBase, s_sCfg.u32BulkBufLen);
+    HSUSBD_SET_MAX_PAYLOAD(s_sCfg.u32BulkInEp, s_u32Mps);
+    HSUSBD_ConfigEp(s_sCfg.u32BulkInEp, s_sCfg.u32BulkInEpNum, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_IN);
+
+    HSUSBD_SetEpBufAddr(s_sCfg.u32BulkOutEp, s_sCfg.u32BulkOutBufBase, s_sCfg.u32BulkBufLen);
+    HSUSBD_SET_MAX_PAYLOAD(s_sCfg.u32BulkOutEp, s_u32Mps);
+    HSUSBD_ConfigEp(s_sCfg.u32BulkOutEp, s_sCfg.u32BulkOutEpNum, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_OUT);
+    HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkOutEp, HSUSBD_EPINTEN_RXPKIEN_Msk);
+
+    __set_PRIMASK(u32PriMask);
+}
+
+/**
+  * @brief      Mass storage class request handler
+  * @param      None
+  * @return     None
+  * @details    Give to HSUSBD_Open(). Handles Get Max LUN and Bulk-Only Mass Storage Reset of interface 0.
+  */
+void HSMSC_ClassRequest(void)
+{
+    if (gUsbCmd.bmRequestType & 0x80)   /* request data transfer direction */
+    {
+        // Device to host
+        switch (gUsbCmd.bRequest)
+        {
+        case HSMSC_GET_MAX_LUN:
+        {
+            /* Check interface number with cfg descriptor and check wValue = 0, wLength = 1 */
+            if ((gUsbCmd.wValue == 0) && (gUsbCmd.wIndex == 0) && (gUsbCmd.wLength == 1))
+            {
+                HSUSBD_PrepareCtrlIn((uint8_t *)&s_u32MaxLun, 1);
+                HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_INTKIF_Msk);
+                HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_INTKIEN_Msk);
+            }
+            else     /* Invalid Get MaxLun command */
+            {
+                HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
+            }
+            break;
+        }
+        default:
+        {
+            /* Setup error, stall the device */
+            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
+            break;
+        }
+        }
+    }
+    else
+    {
+        // Host to device
+        switch (gUsbCmd.bRequest)
+        {
+        case HSMSC_BOT_RESET:
+        {
+            /* Check interface number with cfg descriptor and check wValue = 0, wLength = 0 */
+            if ((gUsbCmd.wValue == 0) && (gUsbCmd.wIndex == 0) && (gUsbCmd.wLength == 0))
+            {
+                s_u8Prevent = 1;
+                /* Status stage */
+                HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_STSDONEIF_Msk);
+                HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_NAKCLR);
+                HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_STSDONEIEN_Msk);
+
+                g_u32HsEpStallLock = 0;
+                HSMSC_Reset();
+            }
+            else     /* Invalid reset command */
+            {
+                HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
+            }
+            break;
+        }
+        default:
+        {
+            /* Setup error, stall the device */
+            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
+            break;
+        }
+        }
+    }
+}
+
+/**
+  * @brief      Handle the class endpoint interrupts
+  *
+  * @param[in]  u32GIntSts  HSUSBD->GINTSTS & HSUSBD->GINTEN. Other endpoints' bits are ignored.
+  *
+  * @return     None
+  *
+  * @details    Call from USBD20_IRQHandler().
+  */
+void HSMSC_EpHandler(uint32_t u32GIntSts)
+{
+    uint32_t u32IrqSt;
+
+    if (u32GIntSts & HSMSC_EP_GINT(s_sCfg.u32BulkInEp))
+    {
+        u32IrqSt = HSUSBD->EP[s_sCfg.u32BulkInEp].EPINTSTS & HSUSBD->EP[s_sCfg.u32BulkInEp].EPINTEN;
+        HSUSBD_ENABLE_EP_INT(s_sCfg.u32BulkInEp, 0);
+        HSUSBD_CLR_EP_INT_FLAG(s_sCfg.u32BulkInEp, u32IrqSt);
+        if (s_u32InWait && (u32IrqSt & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk))
+        {
+            s_u32InWait = 0UL;
+            HSMSC_UsbNext(1UL);
+        }
+    }
+
+    if (u32GIntSts & HSMSC_EP_GINT(s_sCfg.u32BulkOutEp))
+    {
+        u32IrqSt = HSUSBD->EP[s_sCfg.u32BulkOutEp].EPINTSTS & HSUSBD->EP[s_sCfg.u32BulkOutEp].EPINTEN;
+        if (u32IrqSt & HSUSBD_EPINTSTS_RXPKIF_Msk)
+            s_u32OutPkt = 1UL;
+        HSUSBD_CLR_EP_INT_FLAG(s_sCfg.u32BulkOutEp, u32IrqSt);
+    }
+}
+
+/**
+  * @brief      Handle HSUSBD DMA completion
+  * @param      None
+  * @return     None
+  * @details    Call from USBD20_IRQHandler() on HSUSBD_BUSINTSTS_DMADONEIF_Msk, after clearing the flag.
+  *             Starts the next piece of the running bulk transfer. Does nothing if the class did not
+  *             start the DMA.
+  */
+void HSMSC_DmaDoneHandler(void)
+{
+    uint32_t u32Ep = s_sCfg.u32BulkInEp;
+
+    if ((s_u32UsbDir == HSMSC_DMA_IDLE) || s_u32InWait)
+        return;
+
+    if ((s_u32UsbDir == HSMSC_DMA_IN) && s_u32InShort)
+    {
+        HSUSBD->EP[u32Ep].EPRSPCTL = (HSUSBD->EP[u32Ep].EPRSPCTL & HSUSBD_EP_RSPCTL_HALT) | HSUSBD_EP_RSPCTL_SHORTTXEN;    // packet end
+        s_u32InShort = 0UL;
+    }
+
+    s_u32UsbAddr += s_u32DmaLen;
+    s_u32UsbLeft -= s_u32DmaLen;
+    HSMSC_UsbNext(0UL);
+}
+
+/**
+  * @brief      Process a received command
+  * @param      None
+  * @return     None
+  * @details    Call from the main loop. When a CBW has arrived, runs the whole command including its
+  *             data phase and CSW before returning, and calls HSMSC_CFG_T::pfnIdle while it waits.
+  *             Block device calls are made from here, never from an interrupt handler.
+  */
+void HSMSC_Process(void)
+{
+    uint32_t u32Ep = s_sCfg.u32BulkInEp;
+
+    if (g_hsusbd_Configured == 0U)
+        return;
+
+    if (s_u32OutPkt)
+    {
+        s_u32OutPkt = 0UL;
+        s_u32Abort = 0UL;
+        HSMSC_ProcessCbw();
+    }
+
+    /* For MSC compliance test, keep an invalid CBW stalled until Bulk-Only Mass Storage Reset */
+    if (g_u32HsEpStallLock && (HSUSBD_GET_EP_INT_FLAG(u32Ep) & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk))
+    {
+        if (g_u32HsEpStallLock & (1UL << u32Ep))
+            HSUSBD_SetEpStall(u32Ep);
+        if (g_u32HsEpStallLock & (1UL << s_sCfg.u32BulkOutEp))
+            HSUSBD_SetEpStall(s_sCfg.u32BulkOutEp);
+    }
+}
+
+/**
+  * @brief      Get the transfer counters
+  * @param[out] psStats     Counters since HSMSC_Open() or HSMSC_ClearStats(), with the throughput filled in
+  * @return     None
+  */
+void HSMSC_GetStats(HSMSC_STATS_T *psStats)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+    *psStats = s_sStats;
+    __set_PRIMASK(u32PriMask);
+
+    if (psStats->u32ReadUs)
+        psStats->u32ReadKBps = (uint32_t)(((uint64_t)psStats->u32ReadBytes * 1000UL) / psStats->u32ReadUs);
+    if (psStats->u32WriteUs)
+        psStats->u32WriteKBps = (uint32_t)(((uint64_t)psStats->u32WriteBytes * 1000UL) / psStats->u32WriteUs);
+}
+
+/**
+  * @brief      Reset the transfer counters
+  * @param      None
+  * @return     None
+  */
+void HSMSC_ClearStats(void)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+    memset(&s_sStats, 0, sizeof(s_sStats));
+    __set_PRIMASK(u32PriMask);
+}
+
+/**
+  * @brief      Set up a RAM block device
+  *
+  * @param[out] psDisk      Block device to fill in
+  * @param[in]  pu8Base     Start of the RAM disk
+  * @param[in]  u32Size     Size of the RAM disk in bytes, rounded down to whole sectors
+  *
+  * @return     None
+  */
+void HSMSC_RamDiskInit(HSMSC_DISK_T *psDisk, uint8_t *pu8Base, uint32_t u32Size)
+{
+    memset(psDisk, 0, sizeof(HSMSC_DISK_T));
+    psDisk->u32Sectors = u32Size / HSMSC_SECTOR_SIZE;
+    psDisk->u32Base = (uint32_t)pu8Base;
+    psDisk->pfnRead = HSMSC_RamRead;
+    psDisk->pfnWrite = HSMSC_RamWrite;
+}
+
+/*@}*/ /* end of group HSMSC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group HSMSC_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
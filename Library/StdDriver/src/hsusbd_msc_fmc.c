@@ -0,0 +1,122 @@
+/**************************************************************************//**
+ * @file     hsusbd_msc_fmc.c
+ * @version  V1.00
+ * @brief    M480 series HSUSBD mass storage internal flash block device source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "hsusbd_msc.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup HSMSC_Driver HSUSBD MSC Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+static int32_t HSMSC_FmcRead(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    /* Flash is memory mapped, a block copy beats one ISP read command per word */
+    memcpy(pu8Buf, (const uint8_t *)(psDisk->u32Base + u32Sector * HSMSC_SECTOR_SIZE), u32Count * HSMSC_SECTOR_SIZE);
+    return HSMSC_OK;
+}
+
+static int32_t HSMSC_FmcProgram(uint32_t u32Addr, uint32_t *pu32Buf, uint32_t u32Len)
+{
+    int32_t i32Done;
+
+    while (u32Len)
+    {
+        i32Done = FMC_WriteMultiple(u32Addr, pu32Buf, u32Len);
+        if (i32Done <= 0)
+            return HSMSC_ERR_IO;
+        u32Addr += (uint32_t)i32Done;
+        pu32Buf += (uint32_t)i32Done / 4UL;
+        u32Len -= (uint32_t)i32Done;
+    }
+
+    return HSMSC_OK;
+}
+
+static int32_t HSMSC_FmcWrite(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    uint32_t *pu32Page = (uint32_t *)psDisk->pvPriv;
+    uint32_t u32Addr = psDisk->u32Base + u32Sector * HSMSC_SECTOR_SIZE;
+    uint32_t u32Len = u32Count * HSMSC_SECTOR_SIZE;
+    uint32_t u32PageAddr, u32Offset, u32Size;
+    uint32_t *pu32Src;
+
+    while (u32Len)
+    {
+        u32PageAddr = u32Addr & ~(FMC_FLASH_PAGE_SIZE - 1UL);
+        u32Offset = u32Addr - u32PageAddr;
+        u32Size = FMC_FLASH_PAGE_SIZE - u32Offset;
+        if (u32Size > u32Len)
+            u32Size = u32Len;
+
+        if (u32Size == FMC_FLASH_PAGE_SIZE)
+            pu32Src = (uint32_t *)pu8Buf;       /* whole page, program straight from the chunk */
+        else
+        {
+            /* Merge the sectors into the rest of the page */
+            memcpy(pu32Page, (const uint8_t *)u32PageAddr, FMC_FLASH_PAGE_SIZE);
+            memcpy((uint8_t *)pu32Page + u32Offset, pu8Buf, u32Size);
+            pu32Src = pu32Page;
+        }
+
+        if (FMC_Erase(u32PageAddr) != 0)
+            return HSMSC_ERR_IO;
+        if (HSMSC_FmcProgram(u32PageAddr, pu32Src, FMC_FLASH_PAGE_SIZE) != HSMSC_OK)
+            return HSMSC_ERR_IO;
+
+        u32Addr += u32Size;
+        pu8Buf += u32Size;
+        u32Len -= u32Size;
+    }
+
+    return HSMSC_OK;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup HSMSC_EXPORTED_FUNCTIONS HSUSBD MSC Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Set up an internal flash block device
+  *
+  * @param[out] psDisk      Block device to fill in
+  * @param[in]  u32Base     Flash address of sector 0, aligned to FMC_FLASH_PAGE_SIZE
+  * @param[in]  u32Size     Size of the disk in bytes, a multiple of FMC_FLASH_PAGE_SIZE
+  * @param[in]  pu32PageBuf Word aligned FMC_FLASH_PAGE_SIZE buffer for partial page writes
+  *
+  * @return     None
+  *
+  * @details    The device is synchronous. Reads copy from the memory mapped flash; writes erase and
+  *             program whole pages with multi-word programming. The application unlocks the protected
+  *             registers, calls FMC_Open() and enables updating the region, e.g. FMC_ENABLE_AP_UPDATE().
+  */
+void HSMSC_FmcDiskInit(HSMSC_DISK_T *psDisk, uint32_t u32Base, uint32_t u32Size, uint32_t *pu32PageBuf)
+{
+    memset(psDisk, 0, sizeof(HSMSC_DISK_T));
+    psDisk->u32Sectors = u32Size / HSMSC_SECTOR_SIZE;
+    psDisk->u32Base = u32Base;
+    psDisk->pvPriv = pu32PageBuf;
+    psDisk->pfnRead = HSMSC_FmcRead;
+    psDisk->pfnWrite = HSMSC_FmcWrite;
+}
+
+/*@}*/ /* end of group HSMSC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group HSMSC_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,219 @@
+/**************************************************************************//**
+ * @file     hsusbd_msc_sdh.c
+ * @version  V1.00
+ * @brief    M480 series HSUSBD mass storage SD card block device source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "hsusbd_msc.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup HSMSC_Driver HSUSBD MSC Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define HSMSC_SDH_MAX_BLK   255UL       /* SDH_CTL BLKCNT is 8 bits */
+
+/* Request states */
+#define HSMSC_SDH_IDLE      0UL
+#define HSMSC_SDH_DATA      1UL         /* Block transfer of up to 255 sectors by the SDH DMA */
+#define HSMSC_SDH_BUSY      2UL         /* Card busy on DAT0 after CMD12 */
+
+/* sdh.c helpers, not in sdh.h */
+extern uint32_t SDH_SDCmdAndRsp(SDH_T *sdh, uint32_t ucCmd, uint32_t uArg, uint32_t ntickCount);
+extern uint32_t SDH_SDCommand(SDH_T *sdh, uint32_t ucCmd, uint32_t uArg);
+extern void SDH_CheckRB(SDH_T *sdh);
+
+/* The class runs one block device request at a time */
+static struct
+{
+    uint32_t u32State;
+    uint32_t u32Write;
+    uint32_t u32Left;                   /* Sectors not yet started */
+    int32_t  i32Ret;
+} s_sSdhReq;
+
+/* Start the next block transfer: BLKCNT sectors, with the command on the first one */
+static void HSMSC_SdhNext(SDH_T *sdh, uint32_t u32First)
+{
+    uint32_t u32Cnt = (s_sSdhReq.u32Left < HSMSC_SDH_MAX_BLK) ? s_sSdhReq.u32Left : HSMSC_SDH_MAX_BLK;
+    uint32_t u32Reg;
+
+    s_sSdhReq.u32Left -= u32Cnt;
+    g_u8SDDataReadyFlag = (uint8_t)FALSE;
+    if (s_sSdhReq.u32Write)
+    {
+        u32Reg = (sdh->CTL & 0xff00c080) | (u32Cnt << 16);
+        if (u32First)
+            sdh->CTL = u32Reg | (25ul << 8) | (SDH_CTL_COEN_Msk | SDH_CTL_RIEN_Msk | SDH_CTL_DOEN_Msk);
+        else
+            sdh->CTL = u32Reg | SDH_CTL_DOEN_Msk;
+    }
+    else
+    {
+        u32Reg = (sdh->CTL & ~(SDH_CTL_CMDCODE_Msk | SDH_CTL_BLKCNT_Msk)) | (u32Cnt << 16);
+        if (u32First)
+            sdh->CTL = u32Reg | (18ul << 8) | (SDH_CTL_COEN_Msk | SDH_CTL_RIEN_Msk | SDH_CTL_DIEN_Msk);
+        else
+            sdh->CTL = u32Reg | SDH_CTL_DIEN_Msk;
+    }
+}
+
+/* Same steps as SDH_Read() and SDH_Write(), up to the first block transfer */
+static int32_t HSMSC_SdhStart(HSMSC_DISK_T *psDisk, uint32_t u32Write, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    SDH_T *sdh = (SDH_T *)psDisk->pvPriv;
+    SDH_INFO_T *pSD = (sdh == SDH0) ? &SD0 : &SD1;
+
+    if ((u32Count == 0UL) || (pSD->IsCardInsert == FALSE))
+        return HSMSC_ERR_IO;
+    if (SDH_SDCmdAndRsp(sdh, 7ul, pSD->RCA, 0ul) != Successful)
+        return HSMSC_ERR_IO;
+    SDH_CheckRB(sdh);
+
+    sdh->BLEN = HSMSC_SECTOR_SIZE - 1ul;
+    if ((pSD->CardType == SDH_TYPE_SD_HIGH) || (pSD->CardType == SDH_TYPE_EMMC))
+        sdh->CMDARG = u32Sector;
+    else
+        sdh->CMDARG = u32Sector * HSMSC_SECTOR_SIZE;
+    sdh->DMASA = (uint32_t)pu8Buf;
+
+    s_sSdhReq.u32Write = u32Write;
+    s_sSdhReq.u32Left = u32Count;
+    s_sSdhReq.i32Ret = HSMSC_OK;
+    s_sSdhReq.u32State = HSMSC_SDH_DATA;
+    HSMSC_SdhNext(sdh, 1UL);
+    return HSMSC_OK;
+}
+
+static int32_t HSMSC_SdhRead(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    return HSMSC_SdhStart(psDisk, 0UL, u32Sector, u32Count, pu8Buf);
+}
+
+static int32_t HSMSC_SdhWrite(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    return HSMSC_SdhStart(psDisk, 1UL, u32Sector, u32Count, pu8Buf);
+}
+
+/* Each call advances the request by what the card has done, and never waits for the card */
+static int32_t HSMSC_SdhPoll(HSMSC_DISK_T *psDisk)
+{
+    SDH_T *sdh = (SDH_T *)psDisk->pvPriv;
+    SDH_INFO_T *pSD = (sdh == SDH0) ? &SD0 : &SD1;
+
+    if (s_sSdhReq.u32State == HSMSC_SDH_DATA)
+    {
+        if (pSD->IsCardInsert == FALSE)
+        {
+            s_sSdhReq.u32State = HSMSC_SDH_IDLE;
+            return HSMSC_ERR_IO;
+        }
+        /* Set by SDHn_IRQHandler() on BLKDIF */
+        if (!g_u8SDDataReadyFlag)
+            return HSMSC_BUSY;
+
+        if (s_sSdhReq.u32Write)
+        {
+            if (sdh->INTSTS & SDH_INTSTS_CRCIF_Msk)
+            {
+                sdh->INTSTS = SDH_INTSTS_CRCIF_Msk;
+                s_sSdhReq.i32Ret = HSMSC_ERR_IO;
+            }
+        }
+        else if (((sdh->INTSTS & SDH_INTSTS_CRC7_Msk) == 0UL) || ((sdh->INTSTS & SDH_INTSTS_CRC16_Msk) == 0UL))
+        {
+            s_sSdhReq.i32Ret = HSMSC_ERR_IO;
+        }
+
+        if ((s_sSdhReq.i32Ret == HSMSC_OK) && s_sSdhReq.u32Left)
+        {
+            HSMSC_SdhNext(sdh, 0UL);
+            return HSMSC_BUSY;
+        }
+
+        /* Stop the transfer, also after an error. A write keeps the card busy while it programs. */
+        if (s_sSdhReq.u32Write)
+            sdh->INTSTS = SDH_INTSTS_CRCIF_Msk;
+        if (SDH_SDCmdAndRsp(sdh, 12ul, 0ul, 0ul))
+            s_sSdhReq.i32Ret = HSMSC_ERR_IO;
+        sdh->CTL |= SDH_CTL_CLK8OEN_Msk;
+        s_sSdhReq.u32State = HSMSC_SDH_BUSY;
+        return HSMSC_BUSY;
+    }
+
+    if (s_sSdhReq.u32State == HSMSC_SDH_BUSY)
+    {
+        /* SDH_CheckRB() one step at a time: 8 clocks, then sample DAT0 */
+        if (sdh->CTL & SDH_CTL_CLK8OEN_Msk)
+            return HSMSC_BUSY;
+        if ((sdh->INTSTS & SDH_INTSTS_DAT0STS_Msk) == 0UL)
+        {
+            if (pSD->IsCardInsert == FALSE)
+            {
+                s_sSdhReq.u32State = HSMSC_SDH_IDLE;
+                return HSMSC_ERR_IO;
+            }
+            sdh->CTL |= SDH_CTL_CLK8OEN_Msk;
+            return HSMSC_BUSY;
+        }
+
+        /* Deselect the card */
+        SDH_SDCommand(sdh, 7ul, 0ul);
+        sdh->CTL |= SDH_CTL_CLK8OEN_Msk;
+        while ((sdh->CTL & SDH_CTL_CLK8OEN_Msk) == SDH_CTL_CLK8OEN_Msk)
+        {
+        }
+        s_sSdhReq.u32State = HSMSC_SDH_IDLE;
+    }
+
+    return s_sSdhReq.i32Ret;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup HSMSC_EXPORTED_FUNCTIONS HSUSBD MSC Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Set up an SD card block device
+  *
+  * @param[out] psDisk      Block device to fill in
+  * @param[in]  sdh         SDH0 or SDH1, opened and probed by the application
+  *
+  * @return     None
+  *
+  * @details    The device is asynchronous: pfnRead() and pfnWrite() select the card and start the
+  *             SDH DMA, and pfnPoll() moves the request on without waiting, in blocks of up to 255
+  *             sectors, and through the card busy time after a write. It takes the steps of SDH_Read()
+  *             and SDH_Write(), so SDHn_IRQHandler() must set g_u8SDDataReadyFlag on BLKDIF as usual,
+  *             and no other SDH call may run on the card while HSMSC_Process() is inside a command.
+  *             Multi-sector requests of a whole chunk let the card stream, so use chunks of 8 KB or
+  *             more.
+  */
+void HSMSC_SdhDiskInit(HSMSC_DISK_T *psDisk, SDH_T *sdh)
+{
+    memset(psDisk, 0, sizeof(HSMSC_DISK_T));
+    psDisk->u32Sectors = (sdh == SDH0) ? SD0.totalSectorN : SD1.totalSectorN;
+    psDisk->pvPriv = sdh;
+    psDisk->pfnRead = HSMSC_SdhRead;
+    psDisk->pfnWrite = HSMSC_SdhWrite;
+    psDisk->pfnPoll = HSMSC_SdhPoll;
+}
+
+/*@}*/ /* end of group HSMSC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group HSMSC_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
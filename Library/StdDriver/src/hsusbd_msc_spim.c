@@ -0,0 +1,115 @@
+/**************************************************************************//**
+ * @file     hsusbd_msc_spim.c
+ * @version  V1.00
+ * @brief    M480 series HSUSBD mass storage SPIM flash block device source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "hsusbd_msc.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup HSMSC_Driver HSUSBD MSC Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define HSMSC_SPIM_BLOCK    0x1000UL    /* 4 KB erase block */
+
+static int32_t HSMSC_SpimRead(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    /* Started only, HSMSC_SpimPoll() reports completion */
+    SPIM_DMA_Read(psDisk->u32Base + u32Sector * HSMSC_SECTOR_SIZE, 0, u32Count * HSMSC_SECTOR_SIZE,
+                  pu8Buf, psDisk->u32Arg, 0);
+    return HSMSC_OK;
+}
+
+static int32_t HSMSC_SpimWrite(HSMSC_DISK_T *psDisk, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    uint8_t *pu8Block = (uint8_t *)psDisk->pvPriv;
+    uint32_t u32Addr = psDisk->u32Base + u32Sector * HSMSC_SECTOR_SIZE;
+    uint32_t u32Len = u32Count * HSMSC_SECTOR_SIZE;
+    uint32_t u32BlockAddr, u32Offset, u32Size;
+    uint8_t *pu8Src;
+
+    while (u32Len)
+    {
+        u32BlockAddr = u32Addr & ~(HSMSC_SPIM_BLOCK - 1UL);
+        u32Offset = u32Addr - u32BlockAddr;
+        u32Size = HSMSC_SPIM_BLOCK - u32Offset;
+        if (u32Size > u32Len)
+            u32Size = u32Len;
+
+        if (u32Size == HSMSC_SPIM_BLOCK)
+            pu8Src = pu8Buf;                    /* whole block, program straight from the chunk */
+        else
+        {
+            /* Merge the sectors into the rest of the block */
+            SPIM_DMA_Read(u32BlockAddr, 0, HSMSC_SPIM_BLOCK, pu8Block, psDisk->u32Arg, 1);
+            memcpy(pu8Block + u32Offset, pu8Buf, u32Size);
+            pu8Src = pu8Block;
+        }
+
+        SPIM_EraseBlock(u32BlockAddr, 0, OPCODE_SE_4K, 1UL, 1);
+        SPIM_DMA_Write(u32BlockAddr, 0, HSMSC_SPIM_BLOCK, pu8Src, CMD_NORMAL_PAGE_PROGRAM);
+
+        u32Addr += u32Size;
+        pu8Buf += u32Size;
+        u32Len -= u32Size;
+    }
+
+    return HSMSC_OK;
+}
+
+static int32_t HSMSC_SpimPoll(HSMSC_DISK_T *psDisk)
+{
+    return SPIM_IS_BUSY() ? HSMSC_BUSY : HSMSC_OK;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup HSMSC_EXPORTED_FUNCTIONS HSUSBD MSC Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Set up an SPIM flash block device
+  *
+  * @param[out] psDisk      Block device to fill in
+  * @param[in]  u32Base     Flash address of sector 0, aligned to 4 KB, within the 3-byte address range
+  * @param[in]  u32Size     Size of the disk in bytes, a multiple of 4 KB
+  * @param[in]  u32RdCmd    DMA read command, e.g. CMD_DMA_FAST_READ or CMD_DMA_FAST_QUAD_READ
+  * @param[in]  pu32PageBuf Word aligned 4 KB buffer for partial block writes
+  *
+  * @return     None
+  *
+  * @details    Reads run as SPIM DMA in the background and overlap the USB DMA of the previous chunk.
+  *             Writes erase 4 KB blocks and page program them before returning. The application
+  *             initializes SPIM (and the flash quad enable bit for quad reads) and must not use SPIM
+  *             while the class is running.
+  */
+void HSMSC_SpimDiskInit(HSMSC_DISK_T *psDisk, uint32_t u32Base, uint32_t u32Size, uint32_t u32RdCmd, uint32_t *pu32PageBuf)
+{
+    memset(psDisk, 0, sizeof(HSMSC_DISK_T));
+    psDisk->u32Sectors = u32Size / HSMSC_SECTOR_SIZE;
+    psDisk->u32Base = u32Base;
+    psDisk->u32Arg = u32RdCmd;
+    psDisk->pvPriv = pu32PageBuf;
+    psDisk->pfnRead = HSMSC_SpimRead;
+    psDisk->pfnWrite = HSMSC_SpimWrite;
+    psDisk->pfnPoll = HSMSC_SpimPoll;
+}
+
+/*@}*/ /* end of group HSMSC_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group HSMSC_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,501 @@
+/**************************************************************************//**
+ * @file     pdma_mgr.c
+ * @version  V1.00
+ * @brief    M480 series PDMA channel manager source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include "NuMicro.h"
+#include "pdma_mgr.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup PDMAMGR_Driver PDMA Manager Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define PDMAMGR_MAX_CNT     0x10000UL       /* Transfers per table */
+#define PDMAMGR_NONE        0xFFU
+
+typedef struct
+{
+    PDMAMGR_CB_FUNC pfnCb;
+    void     *pvArg;
+    uint32_t u32Req;
+    uint32_t u32Flags;
+    uint8_t  u8First;               /* First table of the chain, PDMAMGR_NONE: no chain */
+    uint8_t  u8FirstIrq;            /* First table raising an interrupt */
+    volatile uint8_t u8Pos;         /* Table whose interrupt comes next */
+} PDMAMGR_CH_T;
+
+static DSCT_T s_asDesc[PDMAMGR_DESC_NUM];
+static uint8_t s_au8Owner[PDMAMGR_DESC_NUM];    /* Channel + 1, 0: free */
+static uint8_t s_au8Next[PDMAMGR_DESC_NUM];     /* Next table of the chain */
+static uint8_t s_au8IrqNext[PDMAMGR_DESC_NUM];  /* Next table of the chain raising an interrupt */
+static uint8_t s_au8Evt[PDMAMGR_DESC_NUM];
+static uint8_t s_au8Seg[PDMAMGR_DESC_NUM];
+static uint32_t s_u32FreeDesc = PDMAMGR_DESC_NUM;
+
+static PDMAMGR_CH_T s_asCh[PDMA_CH_MAX];
+static uint32_t s_u32Owned;                     /* Allocated channels */
+static volatile uint32_t s_u32Started;          /* Channels whose interrupts the manager serves */
+
+static void PDMAMGR_ReleaseChain(uint32_t u32Ch)
+{
+    uint32_t i;
+
+    for (i = 0UL; i < PDMAMGR_DESC_NUM; i++)
+    {
+        if (s_au8Owner[i] == (uint8_t)(u32Ch + 1UL))
+        {
+            s_au8Owner[i] = 0U;
+            s_u32FreeDesc++;
+        }
+    }
+
+    s_asCh[u32Ch].u8First = PDMAMGR_NONE;
+}
+
+static uint32_t PDMAMGR_ChainDesc(uint32_t u32Ch)
+{
+    uint32_t i, u32Cnt = 0UL;
+
+    for (i = 0UL; i < PDMAMGR_DESC_NUM; i++)
+    {
+        if (s_au8Owner[i] == (uint8_t)(u32Ch + 1UL))
+            u32Cnt++;
+    }
+
+    return u32Cnt;
+}
+
+/* Stop the channel and forget it in the interrupt handler. Called with interrupts masked or from the handler. */
+static void PDMAMGR_Halt(uint32_t u32Ch)
+{
+    uint32_t u32Mask = 1UL << u32Ch;
+
+    PDMA_DisableInt(PDMA, u32Ch, PDMA_INT_TRANS_DONE);
+    PDMA_STOP(PDMA, u32Ch);
+    PDMA->CHCTL &= ~u32Mask;
+    PDMA_CLR_TD_FLAG(PDMA, u32Mask);
+    s_u32Started &= ~u32Mask;
+}
+
+static uint32_t PDMAMGR_TakeDesc(uint32_t u32Ch)
+{
+    uint32_t i;
+
+    for (i = 0UL; s_au8Owner[i] != 0U; i++) {}
+
+    s_au8Owner[i] = (uint8_t)(u32Ch + 1UL);
+    s_u32FreeDesc--;
+    return i;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief      Allocate a channel
+  * @param[in]  u32ChMask   Acceptable channels, e.g. PDMAMGR_ALL_CH or PDMAMGR_TOUT_CH, or a single
+  *                         channel for code that needs a fixed one
+  * @param[in]  u32Prio     PDMAMGR_PRIO_NORMAL or PDMAMGR_PRIO_HIGH
+  * @return     Channel number, or PDMAMGR_ERR_BUSY if every channel in the mask is taken
+  * @details    High priority channels are given fixed priority arbitration and taken from the low
+  *             channel numbers, normal ones round robin from the high numbers, so the two kinds
+  *             rarely compete for the same mask.
+  */
+int32_t PDMAMGR_Alloc(uint32_t u32ChMask, uint32_t u32Prio)
+{
+    uint32_t u32Free, u32Ch, u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+
+    u32Free = u32ChMask & PDMAMGR_ALL_CH & ~s_u32Owned;
+
+    if (u32Free == 0UL)
+    {
+        __set_PRIMASK(u32PriMask);
+        return PDMAMGR_ERR_BUSY;
+    }
+
+    u32Ch = (u32Prio == PDMAMGR_PRIO_HIGH) ? __CLZ(__RBIT(u32Free)) : (31UL - __CLZ(u32Free));
+    s_u32Owned |= 1UL << u32Ch;
+    s_asCh[u32Ch].pfnCb = NULL;
+    s_asCh[u32Ch].u8First = PDMAMGR_NONE;
+
+    __set_PRIMASK(u32PriMask);
+
+    if (u32Prio == PDMAMGR_PRIO_HIGH)
+        PDMA->PRISET = 1UL << u32Ch;
+    else
+        PDMA->PRICLR = 1UL << u32Ch;
+
+    return (int32_t)u32Ch;
+}
+
+/**
+  * @brief      Free a channel
+  * @param[in]  u32Ch   Channel from PDMAMGR_Alloc()
+  * @return     None
+  * @details    Stops the channel and returns its descriptors to the pool.
+  */
+void PDMAMGR_Free(uint32_t u32Ch)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    if ((u32Ch >= PDMA_CH_MAX) || ((s_u32Owned & (1UL << u32Ch)) == 0UL))
+        return;
+
+    __disable_irq();
+    PDMAMGR_Halt(u32Ch);
+    PDMAMGR_ReleaseChain(u32Ch);
+    s_u32Owned &= ~(1UL << u32Ch);
+    __set_PRIMASK(u32PriMask);
+
+    PDMA->PRICLR = 1UL << u32Ch;
+}
+
+/**
+  * @brief      Build the scatter-gather chain of a channel
+  * @param[in]  u32Ch       Channel from PDMAMGR_Alloc()
+  * @param[in]  u32Req      PDMA request, e.g. PDMA_SPI0_TX, or PDMA_MEM for memory to memory
+  * @param[in]  psSeg       Segments, transferred in order
+  * @param[in]  u32Count    Number of segments, 1 ~ 255
+  * @param[in]  u32Flags    PDMAMGR_FLAG_RING, PDMAMGR_FLAG_HALF, PDMAMGR_FLAG_SEG, or'ed, or 0
+  * @param[in]  pfnCb       Callback, NULL for none
+  * @param[in]  pvArg       Passed to pfnCb
+  * @retval     PDMAMGR_OK          Success
+  * @retval     PDMAMGR_ERR_PARAM   Invalid argument or segment
+  * @retval     PDMAMGR_ERR_BUSY    The channel is running
+  * @retval     PDMAMGR_ERR_NO_DESC Not enough free descriptors
+  * @retval     PDMAMGR_ERR_DESC    The pool is out of reach of PDMA->SCATBA
+  * @details    Replaces the previous chain of the channel, whose tables are reused; on an error
+  *             the previous chain is kept. A segment takes one table per 65536
+  *             transfers, twice that with PDMAMGR_FLAG_HALF. Peripheral requests use single
+  *             transfers, memory to memory uses bursts of 128. Only tables that end a reported
+  *             event raise an interrupt; without PDMAMGR_FLAG_RING the last one always does.
+  *             Each of those tables must last longer than the PDMA interrupt latency, as
+  *             completions that merge into one interrupt are reported as one.
+  */
+int32_t PDMAMGR_Build(uint32_t u32Ch, uint32_t u32Req, const PDMAMGR_SEG_T *psSeg, uint32_t u32Count,
+                      uint32_t u32Flags, PDMAMGR_CB_FUNC pfnCb, void *pvArg)
+{
+    uint32_t i, u32Half, u32Parts, u32Shift, u32Xfer, u32Part, u32Cnt, u32Off, u32Need, u32D, u32Prev;
+    uint32_t u32Ctl, u32EvtMask, u32PriMask;
+    PDMAMGR_CH_T *psCh;
+
+    if ((u32Ch >= PDMA_CH_MAX) || ((s_u32Owned & (1UL << u32Ch)) == 0UL) || (psSeg == NULL) ||
+            (u32Count == 0UL) || (u32Count > 255UL))
+        return PDMAMGR_ERR_PARAM;
+
+    if (((uint32_t)&s_asDesc[PDMAMGR_DESC_NUM - 1] - PDMA->SCATBA) > 0xFFFFUL)
+        return PDMAMGR_ERR_DESC;
+
+    u32Parts = (u32Flags & PDMAMGR_FLAG_HALF) ? 2UL : 1UL;
+    u32Need = 0UL;
+
+    for (i = 0UL; i < u32Count; i++)
+    {
+        if ((psSeg[i].u32Width & ~PDMA_DSCT_CTL_TXWIDTH_Msk) || (psSeg[i].u32Width == PDMA_DSCT_CTL_TXWIDTH_Msk))
+            return PDMAMGR_ERR_PARAM;
+
+        u32Shift = psSeg[i].u32Width >> PDMA_DSCT_CTL_TXWIDTH_Pos;
+        u32Xfer = psSeg[i].u32Len >> u32Shift;
+
+        if ((u32Xfer < u32Parts) || (psSeg[i].u32Len & ((1UL << u32Shift) - 1UL)) ||
+                (psSeg[i].u32Mode & ~(PDMA_SAR_FIX | PDMA_DAR_FIX)))
+            return PDMAMGR_ERR_PARAM;
+
+        for (u32Half = 0UL; u32Half < u32Parts; u32Half++)
+        {
+            u32Part = (u32Parts == 2UL) ? ((u32Half == 0UL) ? (u32Xfer >> 1) : (u32Xfer - (u32Xfer >> 1))) : u32Xfer;
+            u32Need += (u32Part + PDMAMGR_MAX_CNT - 1UL) / PDMAMGR_MAX_CNT;
+        }
+    }
+
+    psCh = &s_asCh[u32Ch];
+    u32EvtMask = (pfnCb != NULL) ? (PDMAMGR_EVT_HALF | PDMAMGR_EVT_SEG | PDMAMGR_EVT_DONE) : 0UL;
+
+    if ((u32Flags & PDMAMGR_FLAG_RING) == 0UL)
+        u32EvtMask |= PDMAMGR_EVT_DONE;
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+
+    if (s_u32Started & (1UL << u32Ch))
+    {
+        __set_PRIMASK(u32PriMask);
+        return PDMAMGR_ERR_BUSY;
+    }
+
+    /* The tables of the previous chain count as free, but it is kept if the new one does not fit */
+    if (u32Need > s_u32FreeDesc + PDMAMGR_ChainDesc(u32Ch))
+    {
+        __set_PRIMASK(u32PriMask);
+        return PDMAMGR_ERR_NO_DESC;
+    }
+
+    PDMAMGR_ReleaseChain(u32Ch);
+
+    /* Reserve the tables; they are filled in with interrupts enabled again */
+    u32Prev = PDMAMGR_NONE;
+
+    for (i = 0UL; i < u32Need; i++)
+    {
+        u32D = PDMAMGR_TakeDesc(u32Ch);
+
+        if (u32Prev == PDMAMGR_NONE)
+            psCh->u8First = (uint8_t)u32D;
+        else
+            s_au8Next[u32Prev] = (uint8_t)u32D;
+
+        u32Prev = u32D;
+    }
+
+    s_au8Next[u32Prev] = psCh->u8First;
+    __set_PRIMASK(u32PriMask);
+
+    u32D = psCh->u8First;
+    u32Ctl = (u32Req == PDMA_MEM) ? (PDMA_REQ_BURST | PDMA_BURST_128) : (PDMA_REQ_SINGLE | PDMA_BURST_1);
+
+    for (i = 0UL; i < u32Count; i++)
+    {
+        u32Shift = psSeg[i].u32Width >> PDMA_DSCT_CTL_TXWIDTH_Pos;
+        u32Xfer = psSeg[i].u32Len >> u32Shift;
+        u32Off = 0UL;
+
+        for (u32Half = 0UL; u32Half < u32Parts; u32Half++)
+        {
+            u32Part = (u32Parts == 2UL) ? ((u32Half == 0UL) ? (u32Xfer >> 1) : (u32Xfer - (u32Xfer >> 1))) : u32Xfer;
+
+            while (u32Part)
+            {
+                u32Cnt = (u32Part > PDMAMGR_MAX_CNT) ? PDMAMGR_MAX_CNT : u32Part;
+                u32Part -= u32Cnt;
+
+                s_asDesc[u32D].SA = psSeg[i].u32Src + (((psSeg[i].u32Mode & PDMA_SAR_FIX) == PDMA_SAR_FIX) ? 0UL : u32Off);
+                s_asDesc[u32D].DA = psSeg[i].u32Dst + (((psSeg[i].u32Mode & PDMA_DAR_FIX) == PDMA_DAR_FIX) ? 0UL : u32Off);
+                s_asDesc[u32D].NEXT = (uint32_t)&s_asDesc[s_au8Next[u32D]] - PDMA->SCATBA;
+                s_asDesc[u32D].CTL = u32Ctl | psSeg[i].u32Width | psSeg[i].u32Mode |
+                                     ((u32Cnt - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_OP_SCATTER;
+                s_au8Seg[u32D] = (uint8_t)i;
+                s_au8Evt[u32D] = 0U;
+                u32Off += u32Cnt << u32Shift;
+
+                if (u32Part == 0UL)
+                {
+                    if (u32Half + 1UL < u32Parts)
+                        s_au8Evt[u32D] = PDMAMGR_EVT_HALF;
+                    else if (u32Flags & PDMAMGR_FLAG_SEG)
+                        s_au8Evt[u32D] = PDMAMGR_EVT_SEG;
+                }
+
+                if (s_au8Next[u32D] == psCh->u8First)
+                {
+                    s_au8Evt[u32D] |= PDMAMGR_EVT_DONE;
+
+                    if ((u32Flags & PDMAMGR_FLAG_RING) == 0UL)
+                        s_asDesc[u32D].CTL = (s_asDesc[u32D].CTL & ~PDMA_DSCT_CTL_OPMODE_Msk) | PDMA_OP_BASIC;
+                }
+
+                s_au8Evt[u32D] &= (uint8_t)u32EvtMask;
+
+                if (s_au8Evt[u32D] == 0U)
+                    s_asDesc[u32D].CTL |= PDMA_TBINTDIS_DISABLE;
+
+                u32D = s_au8Next[u32D];
+            }
+        }
+    }
+
+    /* Link the tables that interrupt, in chain order and looping like the chain */
+    u32Prev = PDMAMGR_NONE;
+    psCh->u8FirstIrq = PDMAMGR_NONE;
+    u32D = psCh->u8First;
+
+    do
+    {
+        if (s_au8Evt[u32D])
+        {
+            if (u32Prev == PDMAMGR_NONE)
+                psCh->u8FirstIrq = (uint8_t)u32D;
+            else
+                s_au8IrqNext[u32Prev] = (uint8_t)u32D;
+
+            u32Prev = u32D;
+        }
+
+        u32D = s_au8Next[u32D];
+    }
+    while (u32D != psCh->u8First);
+
+    if (u32Prev != PDMAMGR_NONE)
+        s_au8IrqNext[u32Prev] = psCh->u8FirstIrq;
+
+    psCh->pfnCb = pfnCb;
+    psCh->pvArg = pvArg;
+    psCh->u32Req = u32Req;
+    psCh->u32Flags = u32Flags;
+
+    return PDMAMGR_OK;
+}
+
+/**
+  * @brief      Start the chain of a channel
+  * @param[in]  u32Ch   Channel with a chain from PDMAMGR_Build()
+  * @retval     PDMAMGR_OK          Success
+  * @retval     PDMAMGR_ERR_PARAM   No chain built
+  * @retval     PDMAMGR_ERR_BUSY    The channel is running
+  * @details    A chain can be started again once it finished; descriptors are not consumed.
+  *             Memory to memory chains are triggered by software here, peripheral chains wait
+  *             for their requests.
+  */
+int32_t PDMAMGR_Start(uint32_t u32Ch)
+{
+    uint32_t u32Mask = 1UL << u32Ch, u32PriMask;
+    PDMAMGR_CH_T *psCh;
+
+    if ((u32Ch >= PDMA_CH_MAX) || ((s_u32Owned & u32Mask) == 0UL) || (s_asCh[u32Ch].u8First == PDMAMGR_NONE))
+        return PDMAMGR_ERR_PARAM;
+
+    psCh = &s_asCh[u32Ch];
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+
+    if (s_u32Started & u32Mask)
+    {
+        __set_PRIMASK(u32PriMask);
+        return PDMAMGR_ERR_BUSY;
+    }
+
+    PDMA_Open(PDMA, u32Mask);
+    PDMA_SetTransferMode(PDMA, u32Ch, psCh->u32Req, TRUE, (uint32_t)&s_asDesc[psCh->u8First]);
+    PDMA_CLR_TD_FLAG(PDMA, u32Mask);
+    PDMA->ABTSTS = u32Mask;
+    psCh->u8Pos = psCh->u8FirstIrq;
+    s_u32Started |= u32Mask;
+
+    if (psCh->u8FirstIrq != PDMAMGR_NONE)
+    {
+        PDMA_EnableInt(PDMA, u32Ch, PDMA_INT_TRANS_DONE);
+        NVIC_EnableIRQ(PDMA_IRQn);
+    }
+
+    if (psCh->u32Req == PDMA_MEM)
+        PDMA_Trigger(PDMA, u32Ch);
+
+    __set_PRIMASK(u32PriMask);
+
+    return PDMAMGR_OK;
+}
+
+/**
+  * @brief      Stop a channel
+  * @param[in]  u32Ch   Channel from PDMAMGR_Alloc()
+  * @return     None
+  * @details    Ends a ring or abandons a chain in progress. No callback is raised. The chain is
+  *             kept and can be started again.
+  */
+void PDMAMGR_Stop(uint32_t u32Ch)
+{
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    if ((u32Ch >= PDMA_CH_MAX) || ((s_u32Owned & (1UL << u32Ch)) == 0UL))
+        return;
+
+    __disable_irq();
+    PDMAMGR_Halt(u32Ch);
+    __set_PRIMASK(u32PriMask);
+}
+
+/**
+  * @brief      Check whether a channel is running
+  * @param[in]  u32Ch   Channel
+  * @return     1 while the chain runs, 0 after PDMAMGR_EVT_DONE, PDMAMGR_EVT_ABORT or PDMAMGR_Stop()
+  * @details    A ring runs until stopped.
+  */
+uint32_t PDMAMGR_IsBusy(uint32_t u32Ch)
+{
+    return (u32Ch < PDMA_CH_MAX) ? ((s_u32Started >> u32Ch) & 1UL) : 0UL;
+}
+
+/**
+  * @brief      Free descriptors in the pool
+  * @param      None
+  * @return     Descriptors not used by any chain
+  */
+uint32_t PDMAMGR_GetFreeDesc(void)
+{
+    return s_u32FreeDesc;
+}
+
+/**
+  * @brief      PDMA interrupt service
+  * @param      None
+  * @return     None
+  * @details    Call from PDMA_IRQHandler(). Raises the callbacks of the tables that completed and
+  *             stops channels that reported a bus error. Flags of channels the manager did not
+  *             start are left alone.
+  */
+void PDMAMGR_IRQHandler(void)
+{
+    uint32_t u32Sts, u32Flags, u32Ch, u32D, u32Evt;
+    PDMAMGR_CH_T *psCh;
+
+    u32Sts = PDMA->INTSTS;
+
+    if (u32Sts & PDMA_INTSTS_ABTIF_Msk)
+    {
+        u32Flags = PDMA->ABTSTS & s_u32Started;
+        PDMA->ABTSTS = u32Flags;
+
+        while (u32Flags)
+        {
+            u32Ch = __CLZ(__RBIT(u32Flags));
+            u32Flags &= u32Flags - 1UL;
+            psCh = &s_asCh[u32Ch];
+            PDMAMGR_Halt(u32Ch);
+
+            if (psCh->pfnCb)
+                psCh->pfnCb(psCh->pvArg, u32Ch, PDMAMGR_EVT_ABORT,
+                            (psCh->u8Pos != PDMAMGR_NONE) ? s_au8Seg[psCh->u8Pos] : 0UL);
+        }
+    }
+
+    if (u32Sts & PDMA_INTSTS_TDIF_Msk)
+    {
+        u32Flags = PDMA->TDSTS & s_u32Started;
+        PDMA_CLR_TD_FLAG(PDMA, u32Flags);
+
+        while (u32Flags)
+        {
+            u32Ch = __CLZ(__RBIT(u32Flags));
+            u32Flags &= u32Flags - 1UL;
+            psCh = &s_asCh[u32Ch];
+            u32D = psCh->u8Pos;
+
+            if (u32D == PDMAMGR_NONE)
+                continue;
+
+            u32Evt = s_au8Evt[u32D];
+            psCh->u8Pos = s_au8IrqNext[u32D];
+
+            if ((u32Evt & PDMAMGR_EVT_DONE) && ((psCh->u32Flags & PDMAMGR_FLAG_RING) == 0UL))
+                PDMAMGR_Halt(u32Ch);
+
+            if (psCh->pfnCb)
+                psCh->pfnCb(psCh->pvArg, u32Ch, u32Evt, s_au8Seg[u32D]);
+        }
+    }
+}
+
+/*@}*/ /* end of group PDMAMGR_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
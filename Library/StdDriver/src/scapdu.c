@@ -0,0 +1,1115 @@
+/**************************************************************************//**
+ * @file     scapdu.c
+ * @version  V1.00
+ * @brief    M480 series asynchronous smartcard APDU engine source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "scapdu.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SCAPDU_Driver SC APDU Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define SCAPDU_T1_RETRIES       3U              /* Repetitions of a block before RESYNCH, and of RESYNCH */
+#define SCAPDU_T1_BLOCK         (3UL + 254UL + 2UL)
+
+/* T=1 PCB, ISO/IEC 7816-3 11.3.2.2 */
+#define T1_PCB_R                0x80U
+#define T1_PCB_S                0xC0U
+#define T1_PCB_I_NS             0x40U
+#define T1_PCB_I_MORE           0x20U
+#define T1_PCB_R_NR             0x10U
+#define T1_PCB_S_RESP           0x20U
+#define T1_S_RESYNCH            0x00U
+#define T1_S_IFS                0x01U
+#define T1_S_ABORT              0x02U
+#define T1_S_WTX                0x03U
+#define T1_S_NONE               0xFFU           /* No S request of ours running */
+#define T1_R_EDC                0x01U           /* R-block: EDC or parity error */
+#define T1_R_OTHER              0x02U           /* R-block: other error */
+
+/* Slot states */
+#define ST_IDLE                 0UL
+#define ST_TX                   1UL             /* The port is sending */
+#define ST_T1_RX                2UL             /* Waiting for, or receiving, a block */
+#define ST_T0_PROC              3UL             /* Waiting for a procedure byte */
+#define ST_T0_DATA              4UL             /* Receiving the rest of the TPDU data */
+#define ST_T0_DATA1             5UL             /* Receiving one data byte */
+#define ST_T0_SW2               6UL
+
+/* What the block sent asks of the card */
+#define EXP_ACK                 0U              /* R-block acknowledging a chained I-block */
+#define EXP_I                   1U              /* I-block of the response */
+#define EXP_S                   2U              /* S response to our request */
+#define EXP_NONE                3U              /* Nothing: the APDU ended with the block */
+
+typedef struct
+{
+    SCAPDU_PARAM_T sParam;
+    uint32_t u32Attached;
+    uint32_t u32Dead;
+    SCAPDU_REQ_T *psHead;           /* running APDU */
+    SCAPDU_REQ_T *psTail;
+    uint32_t u32State;
+    uint32_t u32RspLen;             /* response bytes so far, may pass u32RspSize */
+    SCAPDU_STATS_T sStats;
+
+    /* T=0 */
+    uint8_t  au8Hdr[5];             /* TPDU header */
+    uint8_t  u8Sw1;
+    uint8_t  u8T0Retried;           /* 6Cxx answered once */
+    uint32_t u32T0Lc;               /* command data of the TPDU */
+    uint32_t u32T0Sent;
+    uint32_t u32T0Le;               /* response data expected by the TPDU */
+    uint32_t u32T0Rcvd;
+
+    /* T=1 transmitter: the last I-block sent, kept for retransmission, and the next one of the chain */
+    uint8_t  au8Blk[2][SCAPDU_T1_BLOCK];
+    uint32_t au32BlkLen[2];
+    uint32_t au32BlkEnd[2];         /* command offset after the INF of the block */
+    uint32_t u32Cur;
+    uint32_t u32NextReady;
+    uint8_t  au8Ctl[5];             /* last R- or S-block sent */
+    uint32_t u32CtlLen;
+    uint8_t  u8Ns;                  /* N(S) of the next I-block built */
+    uint8_t  u8Nr;                  /* N(S) expected of the next card I-block */
+    uint8_t  u8Expect;
+    uint8_t  u8Op;                  /* S request of ours running, T1_S_NONE */
+    uint8_t  u8Errors;              /* consecutive errors */
+    uint8_t  u8Wtx;                 /* BWT multiplier for the next wait */
+    uint8_t  u8IfscAtr;             /* IFSC on attach, restored by RESYNCH */
+    uint32_t u32RxChain;            /* response I-blocks accepted for the running APDU */
+
+    /* T=1 receiver */
+    uint32_t u32RxPos;              /* bytes of the block received */
+    uint32_t u32RxError;            /* character error reported by the port */
+    uint8_t  au8RxPro[3];           /* NAD, PCB, LEN */
+    uint8_t  au8RxEpi[2];
+    uint8_t  u8RxInf0;              /* first INF byte, for S-blocks */
+    uint16_t u16RxEdc;              /* running EDC of prologue and INF */
+} SCAPDU_SLOT_T;
+
+static const SCAPDU_PORT_T *s_psPort;
+static SCAPDU_SLOT_T s_asSlot[SCAPDU_MAX_SLOTS];
+
+static void SCAPDU_Start(uint32_t u32Slot);
+
+/* CRC of ISO/IEC 13239 as T=1 uses it: reflected 0x1021, preset 0xFFFF, sent high byte first */
+static uint16_t SCAPDU_Crc(uint16_t u16Crc, uint8_t u8Data)
+{
+    uint32_t i;
+
+    u16Crc ^= u8Data;
+    for (i = 0UL; i < 8UL; i++)
+        u16Crc = (u16Crc & 1U) ? (uint16_t)((u16Crc >> 1) ^ 0x8408U) : (uint16_t)(u16Crc >> 1);
+    return u16Crc;
+}
+
+static uint16_t SCAPDU_EdcStep(const SCAPDU_SLOT_T *psS, uint16_t u16Edc, uint8_t u8Data)
+{
+    return (psS->sParam.u8Edc == SCAPDU_EDC_CRC) ? SCAPDU_Crc(u16Edc, u8Data) : (uint16_t)(u16Edc ^ u8Data);
+}
+
+static uint16_t SCAPDU_EdcInit(const SCAPDU_SLOT_T *psS)
+{
+    return (psS->sParam.u8Edc == SCAPDU_EDC_CRC) ? 0xFFFFU : 0U;
+}
+
+/* Append the EDC to a block of u32Len bytes, return the block length */
+static uint32_t SCAPDU_T1Seal(const SCAPDU_SLOT_T *psS, uint8_t *pu8Blk, uint32_t u32Len)
+{
+    uint16_t u16Edc = SCAPDU_EdcInit(psS);
+    uint32_t i;
+
+    for (i = 0UL; i < u32Len; i++)
+        u16Edc = SCAPDU_EdcStep(psS, u16Edc, pu8Blk[i]);
+    if (psS->sParam.u8Edc == SCAPDU_EDC_CRC)
+    {
+        pu8Blk[u32Len++] = (uint8_t)(u16Edc >> 8);
+        pu8Blk[u32Len++] = (uint8_t)u16Edc;
+    }
+    else
+    {
+        pu8Blk[u32Len++] = (uint8_t)u16Edc;
+    }
+    return u32Len;
+}
+
+/* APDU case check: 4 byte header, then nothing, Le, Lc and data, or Lc, data and Le */
+static uint32_t SCAPDU_ValidCmd(const uint8_t *pu8Cmd, uint32_t u32Len)
+{
+    if ((u32Len < 4UL) || (u32Len > SCAPDU_MAX_CMD))
+        return 0UL;
+    if (u32Len <= 5UL)
+        return 1UL;
+    return (pu8Cmd[4] != 0U) && ((u32Len == 5UL + pu8Cmd[4]) || (u32Len == 6UL + pu8Cmd[4]));
+}
+
+static void SCAPDU_Send(uint32_t u32Slot, const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    s_asSlot[u32Slot].u32State = ST_TX;
+    s_psPort->pfnTimer(u32Slot, 0UL);
+    s_psPort->pfnSend(u32Slot, pu8Buf, u32Len);
+}
+
+/* Take the running APDU off the queue, start the next one and call back */
+static void SCAPDU_Complete(uint32_t u32Slot, uint32_t u32Status)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    SCAPDU_REQ_T *psReq = psS->psHead;
+
+    /* A block still going out (S(ABORT) response) holds the next APDU back until it is out */
+    if (psS->u32State != ST_TX)
+    {
+        s_psPort->pfnTimer(u32Slot, 0UL);
+        psS->u32State = ST_IDLE;
+    }
+    if (psReq == NULL)
+        return;
+
+    psS->psHead = psReq->psQNext;
+    if (psS->psHead == NULL)
+        psS->psTail = NULL;
+
+    if ((u32Status == SCAPDU_STS_OK) && (psS->u32RspLen > psReq->u32RspSize))
+        u32Status = SCAPDU_STS_OVERFLOW;
+    psReq->u32RspLen = (psS->u32RspLen < psReq->u32RspSize) ? psS->u32RspLen : psReq->u32RspSize;
+    psReq->u32Status = u32Status;
+    psReq->u32Queued = 0UL;
+    psS->sStats.u32Apdus++;
+    if (u32Status != SCAPDU_STS_OK)
+        psS->sStats.u32Failed++;
+
+    SCAPDU_Start(u32Slot);
+    if (psReq->pfnDone != NULL)
+        psReq->pfnDone(psReq->pvArg, psReq);
+}
+
+/* Fail the running and all queued APDUs */
+static void SCAPDU_FailAll(uint32_t u32Slot, uint32_t u32Status)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    psS->u32Dead = 1UL;
+    while (psS->psHead != NULL)
+    {
+        psS->u32RspLen = 0UL;
+        SCAPDU_Complete(u32Slot, u32Status);
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  T=0, ISO/IEC 7816-3 10.3                                                                               */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* Send the TPDU header; u32Le is the response data the TPDU asks for */
+static void SCAPDU_T0Header(uint32_t u32Slot, uint32_t u32Lc, uint32_t u32Le)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    psS->u32T0Lc = u32Lc;
+    psS->u32T0Sent = 0UL;
+    psS->u32T0Le = u32Le;
+    psS->u32T0Rcvd = 0UL;
+    SCAPDU_Send(u32Slot, psS->au8Hdr, 5UL);
+}
+
+static void SCAPDU_T0Start(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    const SCAPDU_REQ_T *psReq = psS->psHead;
+    uint32_t u32Lc = 0UL, u32Le = 0UL;
+
+    memcpy(psS->au8Hdr, psReq->pu8Cmd, 4UL);
+    psS->au8Hdr[4] = 0U;
+    psS->u8T0Retried = 0U;
+    if (psReq->u32CmdLen == 5UL)
+    {
+        /* Case 2S */
+        psS->au8Hdr[4] = psReq->pu8Cmd[4];
+        u32Le = (psReq->pu8Cmd[4] != 0U) ? psReq->pu8Cmd[4] : 256UL;
+    }
+    else if (psReq->u32CmdLen > 5UL)
+    {
+        /* Cases 3S and 4S: the data goes out, a 4S response comes with GET RESPONSE */
+        psS->au8Hdr[4] = psReq->pu8Cmd[4];
+        u32Lc = psReq->pu8Cmd[4];
+    }
+    SCAPDU_T0Header(u32Slot, u32Lc, u32Le);
+}
+
+static void SCAPDU_T0Data(uint32_t u32Slot, uint8_t u8Byte)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    SCAPDU_REQ_T *psReq = psS->psHead;
+
+    if (psS->u32RspLen < psReq->u32RspSize)
+        psReq->pu8Rsp[psS->u32RspLen] = u8Byte;
+    psS->u32RspLen++;
+    psS->u32T0Rcvd++;
+}
+
+static void SCAPDU_T0Status(uint32_t u32Slot, uint8_t u8Sw2)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    const SCAPDU_REQ_T *psReq = psS->psHead;
+
+    if ((psS->u8Sw1 == 0x6CU) && (psS->u32T0Lc == 0UL) && (psS->u8T0Retried == 0U))
+    {
+        /* Wrong Le: the same header again with the length the card asks for */
+        psS->u8T0Retried = 1U;
+        psS->u32RspLen -= psS->u32T0Rcvd;
+        psS->au8Hdr[4] = u8Sw2;
+        SCAPDU_T0Header(u32Slot, 0UL, (u8Sw2 != 0U) ? u8Sw2 : 256UL);
+        return;
+    }
+    if (psS->u8Sw1 == 0x61U)
+    {
+        /* More data: GET RESPONSE, appended to what came so far */
+        psS->au8Hdr[0] = psReq->pu8Cmd[0];
+        psS->au8Hdr[1] = 0xC0U;
+        psS->au8Hdr[2] = 0U;
+        psS->au8Hdr[3] = 0U;
+        psS->au8Hdr[4] = u8Sw2;
+        psS->u8T0Retried = 0U;
+        SCAPDU_T0Header(u32Slot, 0UL, (u8Sw2 != 0U) ? u8Sw2 : 256UL);
+        return;
+    }
+
+    SCAPDU_T0Data(u32Slot, psS->u8Sw1);
+    SCAPDU_T0Data(u32Slot, u8Sw2);
+    SCAPDU_Complete(u32Slot, SCAPDU_STS_OK);
+}
+
+static void SCAPDU_T0Rx(uint32_t u32Slot, uint8_t u8Byte)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    const SCAPDU_REQ_T *psReq = psS->psHead;
+    uint8_t u8Ins = psS->au8Hdr[1], u8Cpl = (uint8_t)(psS->au8Hdr[1] ^ 0xFFU);
+
+    s_psPort->pfnTimer(u32Slot, psS->sParam.u32WaitEtu);
+    switch (psS->u32State)
+    {
+    case ST_T0_PROC:
+        if (u8Byte == 0x60U)
+        {
+            psS->sStats.u32Wtx++;
+        }
+        else if (((u8Byte & 0xF0U) == 0x60U) || ((u8Byte & 0xF0U) == 0x90U))
+        {
+            psS->u8Sw1 = u8Byte;
+            psS->u32State = ST_T0_SW2;
+        }
+        else if ((u8Byte == u8Ins) || (u8Byte == u8Cpl))
+        {
+            /* ACK: all remaining data, INS complement: one byte */
+            if (psS->u32T0Sent < psS->u32T0Lc)
+            {
+                uint32_t u32N = (u8Byte == u8Ins) ? (psS->u32T0Lc - psS->u32T0Sent) : 1UL;
+
+                SCAPDU_Send(u32Slot, &psReq->pu8Cmd[5UL + psS->u32T0Sent], u32N);
+                psS->u32T0Sent += u32N;
+            }
+            else if (psS->u32T0Rcvd < psS->u32T0Le)
+            {
+                psS->u32State = (u8Byte == u8Ins) ? ST_T0_DATA : ST_T0_DATA1;
+            }
+            else
+            {
+                SCAPDU_Complete(u32Slot, SCAPDU_STS_T0_ERROR);
+            }
+        }
+        else
+        {
+            SCAPDU_Complete(u32Slot, SCAPDU_STS_T0_ERROR);
+        }
+        break;
+
+    case ST_T0_DATA:
+    case ST_T0_DATA1:
+        SCAPDU_T0Data(u32Slot, u8Byte);
+        if ((psS->u32State == ST_T0_DATA1) || (psS->u32T0Rcvd == psS->u32T0Le))
+            psS->u32State = ST_T0_PROC;
+        break;
+
+    case ST_T0_SW2:
+        SCAPDU_T0Status(u32Slot, u8Byte);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  T=1, ISO/IEC 7816-3 11                                                                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* Build the I-block of the running command starting at u32Off into au8Blk[u32Idx] */
+static void SCAPDU_T1BuildI(SCAPDU_SLOT_T *psS, uint32_t u32Idx, uint32_t u32Off)
+{
+    const SCAPDU_REQ_T *psReq = psS->psHead;
+    uint8_t *pu8Blk = psS->au8Blk[u32Idx];
+    uint32_t u32Len = psReq->u32CmdLen - u32Off;
+
+    if (u32Len > psS->sParam.u8Ifsc)
+        u32Len = psS->sParam.u8Ifsc;
+
+    pu8Blk[0] = 0U;
+    pu8Blk[1] = (uint8_t)((psS->u8Ns ? T1_PCB_I_NS : 0U) | ((u32Off + u32Len < psReq->u32CmdLen) ? T1_PCB_I_MORE : 0U));
+    pu8Blk[2] = (uint8_t)u32Len;
+    memcpy(&pu8Blk[3], &psReq->pu8Cmd[u32Off], u32Len);
+    psS->au32BlkLen[u32Idx] = SCAPDU_T1Seal(psS, pu8Blk, 3UL + u32Len);
+    psS->au32BlkEnd[u32Idx] = u32Off + u32Len;
+    psS->u8Ns ^= 1U;
+}
+
+/* Send au8Blk[u32Cur], then build the block after it while this one is on the line */
+static void SCAPDU_T1SendI(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    uint32_t u32Cur = psS->u32Cur;
+
+    psS->sStats.u32TxBlocks++;
+    SCAPDU_Send(u32Slot, psS->au8Blk[u32Cur], psS->au32BlkLen[u32Cur]);
+    psS->u32NextReady = 0UL;
+    if (psS->au8Blk[u32Cur][1] & T1_PCB_I_MORE)
+    {
+        psS->sStats.u32Chained++;
+        psS->u8Expect = EXP_ACK;
+        SCAPDU_T1BuildI(psS, u32Cur ^ 1UL, psS->au32BlkEnd[u32Cur]);
+        psS->u32NextReady = 1UL;
+    }
+    else
+    {
+        psS->u8Expect = EXP_I;
+    }
+}
+
+/* Discard the prebuilt block, giving its N(S) back */
+static void SCAPDU_T1DropNext(SCAPDU_SLOT_T *psS)
+{
+    if (psS->u32NextReady)
+    {
+        psS->u8Ns ^= 1U;
+        psS->u32NextReady = 0UL;
+    }
+}
+
+/* Send an R- or S-block with at most one INF byte */
+static void SCAPDU_T1SendCtl(uint32_t u32Slot, uint8_t u8Pcb, uint32_t u32InfLen, uint8_t u8Inf)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    psS->au8Ctl[0] = 0U;
+    psS->au8Ctl[1] = u8Pcb;
+    psS->au8Ctl[2] = (uint8_t)u32InfLen;
+    psS->au8Ctl[3] = u8Inf;
+    psS->u32CtlLen = SCAPDU_T1Seal(psS, psS->au8Ctl, 3UL + u32InfLen);
+    psS->sStats.u32TxBlocks++;
+    SCAPDU_Send(u32Slot, psS->au8Ctl, psS->u32CtlLen);
+}
+
+static void SCAPDU_T1Request(uint32_t u32Slot, uint8_t u8Type, uint32_t u32InfLen, uint8_t u8Inf)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    psS->u8Op = u8Type;
+    psS->u8Expect = EXP_S;
+    SCAPDU_T1SendCtl(u32Slot, (uint8_t)(T1_PCB_S | u8Type), u32InfLen, u8Inf);
+}
+
+static void SCAPDU_T1Start(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    psS->u32RxChain = 0UL;
+    SCAPDU_T1BuildI(psS, psS->u32Cur, 0UL);
+    SCAPDU_T1SendI(u32Slot);
+}
+
+/*
+ * A block went wrong (EDC, parity, length, timeout or a block that makes no sense here): ask again with
+ * an R-block, or repeat our S request. After SCAPDU_T1_RETRIES in a row, RESYNCH; when that fails
+ * too, the card is given up.
+ */
+static void SCAPDU_T1Error(uint32_t u32Slot, uint8_t u8Why)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    if (++psS->u8Errors <= SCAPDU_T1_RETRIES)
+    {
+        psS->sStats.u32Retransmits++;
+        if (psS->u8Expect == EXP_S)
+            SCAPDU_T1Request(u32Slot, psS->u8Op, (psS->u8Op == T1_S_IFS) ? 1UL : 0UL, psS->sParam.u8Ifsd);
+        else
+            SCAPDU_T1SendCtl(u32Slot, (uint8_t)(T1_PCB_R | (psS->u8Nr ? T1_PCB_R_NR : 0U) | u8Why), 0UL, 0U);
+        return;
+    }
+
+    if (psS->u8Op == T1_S_RESYNCH)
+    {
+        s_psPort->pfnTimer(u32Slot, 0UL);
+        psS->u32State = ST_IDLE;
+        psS->u8Op = T1_S_NONE;
+        SCAPDU_FailAll(u32Slot, SCAPDU_STS_DEAD);
+        return;
+    }
+    psS->u8Errors = 0U;
+    SCAPDU_T1DropNext(psS);
+    SCAPDU_T1Request(u32Slot, T1_S_RESYNCH, 0UL, 0U);
+}
+
+static void SCAPDU_T1SResponse(uint32_t u32Slot, uint8_t u8Type)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    if ((psS->u8Expect != EXP_S) || (u8Type != psS->u8Op) ||
+            ((u8Type == T1_S_IFS) && (psS->u8RxInf0 != psS->sParam.u8Ifsd)))
+    {
+        SCAPDU_T1Error(u32Slot, T1_R_OTHER);
+        return;
+    }
+
+    psS->u8Op = T1_S_NONE;
+    psS->u32State = ST_IDLE;
+    s_psPort->pfnTimer(u32Slot, 0UL);
+    if (u8Type == T1_S_RESYNCH)
+    {
+        /* Whether the card ran the command is unknown, so the APDU fails; the next one starts afresh
+           with the initial block numbers and sizes */
+        psS->sStats.u32Resynch++;
+        psS->u8Ns = 0U;
+        psS->u8Nr = 0U;
+        psS->sParam.u8Ifsc = psS->u8IfscAtr;
+        psS->sParam.u8Ifsd = (uint8_t)SCAPDU_T1_IFS_DEFAULT;
+        psS->u32NextReady = 0UL;
+        if (psS->psHead != NULL)
+        {
+            psS->u32RspLen = 0UL;
+            SCAPDU_Complete(u32Slot, SCAPDU_STS_T1_ERROR);
+            return;
+        }
+    }
+    SCAPDU_Start(u32Slot);
+}
+
+static void SCAPDU_T1SRequest(uint32_t u32Slot, uint8_t u8Type)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    uint8_t u8Inf = psS->u8RxInf0;
+
+    switch (u8Type)
+    {
+    case T1_S_WTX:
+        psS->u8Wtx = u8Inf;
+        psS->sStats.u32Wtx++;
+        break;
+    case T1_S_IFS:
+        if ((u8Inf == 0U) || (u8Inf == 0xFFU))
+        {
+            SCAPDU_T1Error(u32Slot, T1_R_OTHER);
+            return;
+        }
+        psS->sParam.u8Ifsc = u8Inf;
+        if (psS->u32NextReady)
+        {
+            SCAPDU_T1DropNext(psS);
+            SCAPDU_T1BuildI(psS, psS->u32Cur ^ 1UL, psS->au32BlkEnd[psS->u32Cur]);
+            psS->u32NextReady = 1UL;
+        }
+        break;
+    case T1_S_ABORT:
+        /* The block sent counts as received; the rest of the chain is dropped */
+        psS->u8Expect = EXP_NONE;
+        SCAPDU_T1SendCtl(u32Slot, (uint8_t)(T1_PCB_S | T1_PCB_S_RESP | T1_S_ABORT), 0UL, 0U);
+        SCAPDU_T1DropNext(psS);
+        psS->u32RspLen = 0UL;
+        SCAPDU_Complete(u32Slot, SCAPDU_STS_T1_ABORT);
+        return;
+    default:
+        SCAPDU_T1Error(u32Slot, T1_R_OTHER);
+        return;
+    }
+    SCAPDU_T1SendCtl(u32Slot, (uint8_t)(T1_PCB_S | T1_PCB_S_RESP | u8Type), 1UL, u8Inf);
+}
+
+static void SCAPDU_T1Block(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    uint8_t u8Pcb = psS->au8RxPro[1], u8Nr;
+    uint32_t u32Len = psS->au8RxPro[2];
+    uint16_t u16Edc = psS->u16RxEdc;
+
+    s_psPort->pfnTimer(u32Slot, 0UL);
+    psS->u32State = ST_IDLE;
+
+    /* Epilogue, then the length rules of the block type */
+    if (psS->sParam.u8Edc == SCAPDU_EDC_CRC)
+    {
+        if ((psS->au8RxEpi[0] != (uint8_t)(u16Edc >> 8)) || (psS->au8RxEpi[1] != (uint8_t)u16Edc))
+            psS->u32RxError = 1UL;
+    }
+    else if (psS->au8RxEpi[0] != (uint8_t)u16Edc)
+    {
+        psS->u32RxError = 1UL;
+    }
+    if (psS->u32RxError)
+    {
+        SCAPDU_T1Error(u32Slot, T1_R_EDC);
+        return;
+    }
+    if ((psS->au8RxPro[0] != 0U) ||
+            (((u8Pcb & T1_PCB_R) == 0U) && (u32Len > psS->sParam.u8Ifsd)) ||
+            (((u8Pcb & T1_PCB_S) == T1_PCB_R) && (u32Len != 0UL)) ||
+            (((u8Pcb & T1_PCB_S) == T1_PCB_S) && (u32Len != ((((u8Pcb & 0x1FU) == T1_S_IFS) || ((u8Pcb & 0x1FU) == T1_S_WTX)) ? 1UL : 0UL))))
+    {
+        SCAPDU_T1Error(u32Slot, T1_R_OTHER);
+        return;
+    }
+
+    if ((u8Pcb & T1_PCB_S) == T1_PCB_S)
+    {
+        psS->sStats.u32RxBlocks++;
+        if (u8Pcb & T1_PCB_S_RESP)
+            SCAPDU_T1SResponse(u32Slot, (uint8_t)(u8Pcb & 0x1FU));
+        else
+            SCAPDU_T1SRequest(u32Slot, (uint8_t)(u8Pcb & 0x1FU));
+        return;
+    }
+
+    if ((u8Pcb & T1_PCB_S) == T1_PCB_R)
+    {
+        psS->sStats.u32RxBlocks++;
+        u8Nr = (u8Pcb & T1_PCB_R_NR) ? 1U : 0U;
+        if ((psS->u8Expect == EXP_ACK) && (u8Nr != ((psS->au8Blk[psS->u32Cur][1] & T1_PCB_I_NS) ? 1U : 0U)))
+        {
+            /* Chained block acknowledged: the next one is ready */
+            psS->u8Errors = 0U;
+            psS->u32Cur ^= 1UL;
+            SCAPDU_T1SendI(u32Slot);
+        }
+        else if ((psS->u8Expect != EXP_S) && (psS->u32RxChain == 0UL) &&
+                 (u8Nr == ((psS->au8Blk[psS->u32Cur][1] & T1_PCB_I_NS) ? 1U : 0U)) &&
+                 (++psS->u8Errors <= SCAPDU_T1_RETRIES))
+        {
+            /* The card asks for our I-block again */
+            psS->sStats.u32Retransmits++;
+            psS->sStats.u32TxBlocks++;
+            SCAPDU_Send(u32Slot, psS->au8Blk[psS->u32Cur], psS->au32BlkLen[psS->u32Cur]);
+        }
+        else if ((psS->u8Expect == EXP_I) && (psS->u32RxChain != 0UL) &&
+                 (++psS->u8Errors <= SCAPDU_T1_RETRIES))
+        {
+            /* Our acknowledgement of its chained block was lost */
+            psS->sStats.u32Retransmits++;
+            SCAPDU_T1SendCtl(u32Slot, (uint8_t)(T1_PCB_R | (psS->u8Nr ? T1_PCB_R_NR : 0U)), 0UL, 0U);
+        }
+        else
+        {
+            if (psS->u8Errors > SCAPDU_T1_RETRIES)
+                psS->u8Errors = SCAPDU_T1_RETRIES;
+            SCAPDU_T1Error(u32Slot, T1_R_OTHER);
+        }
+        return;
+    }
+
+    /* I-block */
+    if ((psS->u8Expect != EXP_I) || (((u8Pcb & T1_PCB_I_NS) ? 1U : 0U) != psS->u8Nr) || (psS->psHead == NULL))
+    {
+        SCAPDU_T1Error(u32Slot, T1_R_OTHER);
+        return;
+    }
+    psS->sStats.u32RxBlocks++;
+    psS->u8Errors = 0U;
+    psS->u8Nr ^= 1U;
+    psS->u32RxChain++;
+    psS->u32RspLen += u32Len;
+    if (u8Pcb & T1_PCB_I_MORE)
+    {
+        psS->sStats.u32Chained++;
+        SCAPDU_T1SendCtl(u32Slot, (uint8_t)(T1_PCB_R | (psS->u8Nr ? T1_PCB_R_NR : 0U)), 0UL, 0U);
+    }
+    else
+    {
+        SCAPDU_Complete(u32Slot, SCAPDU_STS_OK);
+    }
+}
+
+static void SCAPDU_T1Rx(uint32_t u32Slot, uint8_t u8Byte)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    SCAPDU_REQ_T *psReq = psS->psHead;
+    uint32_t u32Pos = psS->u32RxPos, u32Len, u32Inf;
+
+    if (psS->u32State != ST_T1_RX)
+        return;
+    psS->u32RxPos++;
+    s_psPort->pfnTimer(u32Slot, psS->sParam.u32CharEtu);
+
+    if (u32Pos < 3UL)
+    {
+        psS->au8RxPro[u32Pos] = u8Byte;
+        psS->u16RxEdc = SCAPDU_EdcStep(psS, (u32Pos == 0UL) ? SCAPDU_EdcInit(psS) : psS->u16RxEdc, u8Byte);
+        /* LEN 255 is reserved: the block runs into the character timeout and is rejected */
+        if ((u32Pos == 2UL) && (u8Byte == 0xFFU))
+            psS->u32RxError = 1UL;
+        return;
+    }
+
+    u32Len = psS->au8RxPro[2];
+    if (u32Pos < 3UL + u32Len)
+    {
+        u32Inf = u32Pos - 3UL;
+        psS->u16RxEdc = SCAPDU_EdcStep(psS, psS->u16RxEdc, u8Byte);
+        if (u32Inf == 0UL)
+            psS->u8RxInf0 = u8Byte;
+        /* I-block INF lands in place in the response; it counts once the block is accepted */
+        if (((psS->au8RxPro[1] & T1_PCB_R) == 0U) && (psReq != NULL) &&
+                (psS->u32RspLen + u32Inf < psReq->u32RspSize))
+            psReq->pu8Rsp[psS->u32RspLen + u32Inf] = u8Byte;
+        return;
+    }
+
+    psS->au8RxEpi[u32Pos - 3UL - u32Len] = u8Byte;
+    if (u32Pos + 1UL == 3UL + u32Len + ((psS->sParam.u8Edc == SCAPDU_EDC_CRC) ? 2UL : 1UL))
+        SCAPDU_T1Block(u32Slot);
+}
+
+/* Start the next queued APDU if the interface is free */
+static void SCAPDU_Start(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    if ((psS->psHead == NULL) || (psS->u32State != ST_IDLE) || psS->u32Dead || (psS->u8Op != T1_S_NONE))
+        return;
+
+    psS->u32RspLen = 0UL;
+    if (psS->sParam.u8Protocol == SCAPDU_T1)
+        SCAPDU_T1Start(u32Slot);
+    else
+        SCAPDU_T0Start(u32Slot);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup SCAPDU_EXPORTED_FUNCTIONS SC APDU Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Read the transmission parameters from an ATR
+  * @param[in]  pu8Atr      Answer to reset, from TS
+  * @param[in]  u32Len      Bytes at pu8Atr
+  * @param[out] psParam     Parameters: the specific mode of TA2 or else the first protocol offered, with
+  *                         IFSD SCAPDU_T1_IFSD and the waiting times at the Fi/Di of TA1
+  * @retval     SCAPDU_OK           Success
+  * @retval     SCAPDU_ERR_PARAM    Truncated ATR or wrong TCK
+  * @details    The protocol actually used is the one PPS settled on, e.g. SCLIB_CARD_INFO_T::T;
+  *             set u8Protocol from it where the two may differ.
+  */
+int32_t SCAPDU_ParseAtr(const uint8_t *pu8Atr, uint32_t u32Len, SCAPDU_PARAM_T *psParam)
+{
+    static const uint16_t au16Fi[16] = { 372, 372, 558, 744, 1116, 1488, 1860, 0, 0, 512, 768, 1024, 1536, 2048, 0, 0 };
+    static const uint8_t au8Di[16] = { 0, 1, 2, 4, 8, 16, 32, 64, 12, 20, 0, 0, 0, 0, 0, 0 };
+    uint32_t u32Pos = 2UL, u32I = 1UL, u32T = 0UL, u32First = 0xFFUL, u32Specific = 0xFFUL, u32Tck = 0UL;
+    uint32_t u32Fi = 372UL, u32Di = 1UL, u32Wi = 10UL, u32Bwi = 4UL, u32Cwi = 13UL, u32T1Done = 0UL, i;
+    uint8_t au8X[4], u8Y, u8Sum = 0U;
+
+    if ((pu8Atr == NULL) || (psParam == NULL) || (u32Len < 2UL))
+        return SCAPDU_ERR_PARAM;
+
+    psParam->u8Edc = SCAPDU_EDC_LRC;
+    psParam->u8Ifsc = (uint8_t)SCAPDU_T1_IFS_DEFAULT;
+    psParam->u8Ifsd = (uint8_t)SCAPDU_T1_IFSD;
+
+    /* Interface byte groups: TAi TBi TCi TDi as Y of T0 or TDi-1 says, read for the protocol of TDi-1 */
+    u8Y = pu8Atr[1];
+    for (;;)
+    {
+        for (i = 0UL; i < 4UL; i++)
+        {
+            au8X[i] = 0U;
+            if (u8Y & (0x10U << i))
+            {
+                if (u32Pos >= u32Len)
+                    return SCAPDU_ERR_PARAM;
+                au8X[i] = pu8Atr[u32Pos++];
+            }
+        }
+
+        if ((u32I == 1UL) && (u8Y & 0x10U) && (au16Fi[au8X[0] >> 4] != 0U) && (au8Di[au8X[0] & 0xFU] != 0U))
+        {
+            u32Fi = au16Fi[au8X[0] >> 4];
+            u32Di = au8Di[au8X[0] & 0xFU];
+        }
+        if ((u32I == 2UL) && (u8Y & 0x10U))
+            u32Specific = au8X[0] & 0xFUL;
+        if ((u32I == 2UL) && (u8Y & 0x40U) && (au8X[2] != 0U))
+            u32Wi = au8X[2];
+        if ((u32I >= 3UL) && (u32T == 1UL) && (u32T1Done == 0UL))
+        {
+            /* The first T=1 specific group */
+            u32T1Done = 1UL;
+            if ((u8Y & 0x10U) && (au8X[0] != 0U) && (au8X[0] != 0xFFU))
+                psParam->u8Ifsc = au8X[0];
+            if (u8Y & 0x20U)
+            {
+                u32Bwi = au8X[1] >> 4;
+                u32Cwi = au8X[1] & 0xFUL;
+            }
+            if ((u8Y & 0x40U) && (au8X[2] & 1U))
+                psParam->u8Edc = SCAPDU_EDC_CRC;
+        }
+
+        if ((u8Y & 0x80U) == 0U)
+            break;
+        u8Y = au8X[3];
+        u32T = u8Y & 0xFUL;
+        if (u32First == 0xFFUL)
+            u32First = u32T;
+        if (u32T != 0UL)
+            u32Tck = 1UL;
+        u32I++;
+    }
+
+    /* Historical bytes, then TCK unless T=0 is the only protocol */
+    u32Pos += pu8Atr[1] & 0xFUL;
+    if (u32Pos + u32Tck > u32Len)
+        return SCAPDU_ERR_PARAM;
+    if (u32Tck)
+    {
+        for (i = 1UL; i <= u32Pos; i++)
+            u8Sum ^= pu8Atr[i];
+        if (u8Sum != 0U)
+            return SCAPDU_ERR_PARAM;
+    }
+
+    if (u32Specific == 0xFFUL)
+        u32Specific = (u32First == 0xFFUL) ? 0UL : u32First;
+    psParam->u8Protocol = (u32Specific == 1UL) ? SCAPDU_T1 : SCAPDU_T0;
+    if (u32Bwi > 9UL)
+        u32Bwi = 9UL;
+
+    /* ISO/IEC 7816-3 10.2 and 11.4.3, in ETU of Fi/Di */
+    if (psParam->u8Protocol == SCAPDU_T1)
+    {
+        psParam->u32WaitEtu = 11UL + ((960UL * 372UL * u32Di / u32Fi) << u32Bwi);
+        psParam->u32CharEtu = 11UL + (1UL << u32Cwi);
+    }
+    else
+    {
+        psParam->u32WaitEtu = 960UL * u32Wi * u32Di;
+        psParam->u32CharEtu = psParam->u32WaitEtu;
+    }
+    return SCAPDU_OK;
+}
+
+/**
+  * @brief      Initialize the engine
+  * @param[in]  psPort      Port of the interfaces, kept
+  * @return     None
+  * @details    All interfaces start detached.
+  */
+void SCAPDU_Init(const SCAPDU_PORT_T *psPort)
+{
+    uint32_t i;
+
+    s_psPort = psPort;
+    memset(s_asSlot, 0, sizeof(s_asSlot));
+    for (i = 0UL; i < SCAPDU_MAX_SLOTS; i++)
+        s_asSlot[i].u8Op = T1_S_NONE;
+}
+
+/**
+  * @brief      Start APDU processing on an interface with an activated card
+  * @param[in]  u32Slot     Interface, 0 ~ SCAPDU_MAX_SLOTS - 1
+  * @param[in]  psParam     Transmission parameters, copied
+  * @retval     SCAPDU_OK           Success
+  * @retval     SCAPDU_ERR_PARAM    Invalid interface or parameters
+  * @retval     SCAPDU_ERR_STATE    Already attached
+  * @details    For T=1 with u8Ifsd other than SCAPDU_T1_IFS_DEFAULT, S(IFS) is sent first; APDUs
+  *             submitted meanwhile wait for it. When the card does not take it, IFSD stays
+  *             SCAPDU_T1_IFS_DEFAULT.
+  */
+int32_t SCAPDU_Attach(uint32_t u32Slot, const SCAPDU_PARAM_T *psParam)
+{
+    SCAPDU_SLOT_T *psS;
+    uint32_t u32Key;
+
+    if ((u32Slot >= SCAPDU_MAX_SLOTS) || (psParam == NULL) || (psParam->u8Protocol > SCAPDU_T1) ||
+            (psParam->u32WaitEtu == 0UL) ||
+            ((psParam->u8Protocol == SCAPDU_T1) && ((psParam->u8Ifsc == 0U) || (psParam->u8Ifsc == 0xFFU) ||
+                    (psParam->u8Ifsd == 0U) || (psParam->u8Ifsd == 0xFFU) || (psParam->u32CharEtu == 0UL))))
+        return SCAPDU_ERR_PARAM;
+
+    psS = &s_asSlot[u32Slot];
+    u32Key = s_psPort->pfnLock(u32Slot);
+    if (psS->u32Attached)
+    {
+        s_psPort->pfnUnlock(u32Slot, u32Key);
+        return SCAPDU_ERR_STATE;
+    }
+
+    memset(psS, 0, sizeof(*psS));
+    psS->sParam = *psParam;
+    psS->u8IfscAtr = psParam->u8Ifsc;
+    psS->u8Op = T1_S_NONE;
+    psS->u8Wtx = 1U;
+    psS->u32Attached = 1UL;
+    if ((psParam->u8Protocol == SCAPDU_T1) && (psParam->u8Ifsd != SCAPDU_T1_IFS_DEFAULT))
+    {
+        /* The card keeps IFSD 32 until it answers; the receiver allows the larger size throughout */
+        SCAPDU_T1Request(u32Slot, T1_S_IFS, 1UL, psParam->u8Ifsd);
+    }
+    s_psPort->pfnUnlock(u32Slot, u32Key);
+    return SCAPDU_OK;
+}
+
+/**
+  * @brief      Stop APDU processing on an interface
+  * @param[in]  u32Slot     Interface
+  * @return     None
+  * @details    On card removal, or before deactivating the card. The running and queued APDUs complete
+  *             with SCAPDU_STS_REMOVED, their callbacks called from here.
+  */
+void SCAPDU_Detach(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS;
+    SCAPDU_REQ_T *psReq, *psList;
+    uint32_t u32Key;
+
+    if (u32Slot >= SCAPDU_MAX_SLOTS)
+        return;
+
+    psS = &s_asSlot[u32Slot];
+    u32Key = s_psPort->pfnLock(u32Slot);
+    s_psPort->pfnTimer(u32Slot, 0UL);
+    psList = psS->psHead;
+    psS->psHead = NULL;
+    psS->psTail = NULL;
+    psS->u32Attached = 0UL;
+    psS->u32State = ST_IDLE;
+    psS->u8Op = T1_S_NONE;
+    for (psReq = psList; psReq != NULL; psReq = psReq->psQNext)
+    {
+        psReq->u32RspLen = 0UL;
+        psReq->u32Status = SCAPDU_STS_REMOVED;
+        psS->sStats.u32Apdus++;
+        psS->sStats.u32Failed++;
+    }
+    s_psPort->pfnUnlock(u32Slot, u32Key);
+
+    while (psList != NULL)
+    {
+        psReq = psList;
+        psList = psReq->psQNext;
+        psReq->u32Queued = 0UL;
+        if (psReq->pfnDone != NULL)
+            psReq->pfnDone(psReq->pvArg, psReq);
+    }
+}
+
+/**
+  * @brief      Queue an APDU
+  * @param[in]  u32Slot     Interface
+  * @param[in]  psReq       Request with pu8Cmd, u32CmdLen, pu8Rsp, u32RspSize, pfnDone and pvArg set
+  * @retval     SCAPDU_OK           Queued; it starts at once when the interface is free
+  * @retval     SCAPDU_ERR_PARAM    Invalid interface, or APDU not of case 1, 2S, 3S or 4S
+  * @retval     SCAPDU_ERR_STATE    Interface not attached, or the card is dead
+  * @retval     SCAPDU_ERR_BUSY     The request is still queued
+  * @details    May be called from the callbacks and other interrupts.
+  */
+int32_t SCAPDU_Submit(uint32_t u32Slot, SCAPDU_REQ_T *psReq)
+{
+    SCAPDU_SLOT_T *psS;
+    uint32_t u32Key;
+    int32_t i32Ret = SCAPDU_OK;
+
+    if ((u32Slot >= SCAPDU_MAX_SLOTS) || (psReq == NULL) || (psReq->pu8Cmd == NULL) ||
+            (psReq->pu8Rsp == NULL) || (psReq->u32RspSize < 2UL) || !SCAPDU_ValidCmd(psReq->pu8Cmd, psReq->u32CmdLen))
+        return SCAPDU_ERR_PARAM;
+
+    psS = &s_asSlot[u32Slot];
+    u32Key = s_psPort->pfnLock(u32Slot);
+    if (psReq->u32Queued)
+    {
+        i32Ret = SCAPDU_ERR_BUSY;
+    }
+    else if (!psS->u32Attached || psS->u32Dead)
+    {
+        i32Ret = SCAPDU_ERR_STATE;
+    }
+    else
+    {
+        psReq->psQNext = NULL;
+        psReq->u32RspLen = 0UL;
+        psReq->u32Queued = 1UL;
+        if (psS->psTail != NULL)
+            psS->psTail->psQNext = psReq;
+        else
+            psS->psHead = psReq;
+        psS->psTail = psReq;
+        SCAPDU_Start(u32Slot);
+    }
+    s_psPort->pfnUnlock(u32Slot, u32Key);
+    return i32Ret;
+}
+
+/**
+  * @brief      Check whether a request is still queued or running
+  * @param[in]  psReq       Request
+  * @retval     0   Completed (or never submitted): the result is valid
+  * @retval     1   Queued or running
+  */
+uint32_t SCAPDU_IsQueued(const SCAPDU_REQ_T *psReq)
+{
+    return psReq->u32Queued;
+}
+
+/**
+  * @brief      Check whether an interface has nothing to do
+  * @param[in]  u32Slot     Interface
+  * @retval     0   APDUs queued, or IFS negotiation or RESYNCH running
+  * @retval     1   Idle
+  */
+uint32_t SCAPDU_IsIdle(uint32_t u32Slot)
+{
+    const SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    return (psS->psHead == NULL) && (psS->u8Op == T1_S_NONE) && (psS->u32State == ST_IDLE);
+}
+
+/**
+  * @brief      Read the counters of an interface
+  * @param[in]  u32Slot     Interface
+  * @param[out] psStats     Counters since SCAPDU_Attach()
+  * @return     None
+  */
+void SCAPDU_GetStats(uint32_t u32Slot, SCAPDU_STATS_T *psStats)
+{
+    uint32_t u32Key = s_psPort->pfnLock(u32Slot);
+
+    *psStats = s_asSlot[u32Slot].sStats;
+    s_psPort->pfnUnlock(u32Slot, u32Key);
+}
+
+/**
+  * @brief      Port event: the bytes of pfnSend are out
+  * @param[in]  u32Slot     Interface
+  * @return     None
+  * @details    Starts the block waiting time (T=1) or the work waiting time (T=0).
+  */
+void SCAPDU_OnTxDone(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    uint32_t u32Etu = psS->sParam.u32WaitEtu;
+
+    if (!psS->u32Attached || (psS->u32State != ST_TX))
+        return;
+
+    if ((psS->sParam.u8Protocol == SCAPDU_T1) && (psS->u8Expect == EXP_NONE))
+    {
+        psS->u32State = ST_IDLE;
+        SCAPDU_Start(u32Slot);
+        return;
+    }
+    if (psS->sParam.u8Protocol == SCAPDU_T1)
+    {
+        psS->u32State = ST_T1_RX;
+        psS->u32RxPos = 0UL;
+        psS->u32RxError = 0UL;
+        u32Etu *= psS->u8Wtx;
+        psS->u8Wtx = 1U;
+    }
+    else
+    {
+        psS->u32State = ST_T0_PROC;
+    }
+    s_psPort->pfnTimer(u32Slot, u32Etu);
+}
+
+/**
+  * @brief      Port event: bytes received
+  * @param[in]  u32Slot     Interface
+  * @param[in]  pu8Buf      Bytes, in order
+  * @param[in]  u32Len      Number of bytes
+  * @return     None
+  */
+void SCAPDU_OnRx(uint32_t u32Slot, const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+    uint32_t i;
+
+    if (!psS->u32Attached)
+        return;
+
+    for (i = 0UL; i < u32Len; i++)
+    {
+        if (psS->sParam.u8Protocol == SCAPDU_T1)
+            SCAPDU_T1Rx(u32Slot, pu8Buf[i]);
+        else if ((psS->u32State >= ST_T0_PROC) && (psS->psHead != NULL))
+            SCAPDU_T0Rx(u32Slot, pu8Buf[i]);
+    }
+}
+
+/**
+  * @brief      Port event: the pfnTimer time passed
+  * @param[in]  u32Slot     Interface
+  * @return     None
+  */
+void SCAPDU_OnTimeout(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    if (!psS->u32Attached)
+        return;
+
+    if ((psS->sParam.u8Protocol == SCAPDU_T1) && (psS->u32State == ST_T1_RX))
+    {
+        psS->u32State = ST_IDLE;
+        SCAPDU_T1Error(u32Slot, T1_R_OTHER);
+    }
+    else if ((psS->sParam.u8Protocol == SCAPDU_T0) && (psS->u32State >= ST_T0_PROC))
+    {
+        SCAPDU_Complete(u32Slot, SCAPDU_STS_TIMEOUT);
+    }
+}
+
+/**
+  * @brief      Port event: a character error the hardware could not recover
+  * @param[in]  u32Slot     Interface
+  * @return     None
+  * @details    T=1 rejects the block being received with an R-block when it ends or times out; T=0
+  *             fails the APDU.
+  */
+void SCAPDU_OnError(uint32_t u32Slot)
+{
+    SCAPDU_SLOT_T *psS = &s_asSlot[u32Slot];
+
+    if (!psS->u32Attached)
+        return;
+
+    if (psS->sParam.u8Protocol == SCAPDU_T1)
+        psS->u32RxError = 1UL;
+    else if (psS->u32State >= ST_T0_PROC)
+        SCAPDU_Complete(u32Slot, SCAPDU_STS_PARITY);
+}
+
+/*@}*/ /* end of group SCAPDU_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SCAPDU_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
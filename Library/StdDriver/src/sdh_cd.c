@@ -0,0 +1,92 @@
+/**************************************************************************//**
+ * @file     sdh_cd.c
+ * @version  V1.00
+ * @brief    M480 series SDH card detect handler with deferred card initialization
+ *
+ * @details  SDHn_IRQHandler() calls SDH_CardDetectHandler() on a card detect
+ *           interrupt. A removal is handled in the interrupt: SDH_Read() and
+ *           SDH_Write() wait for the block done flag or for IsCardInsert to
+ *           drop, so clearing it from the main loop, where they run, would
+ *           never end a transfer the card was pulled from. Only an insertion,
+ *           where SDH_Open() and SDH_Probe() take milliseconds, is posted to
+ *           the work queue.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "workq.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SDH_Driver SDH Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+static void SDH_CardInsertWork(void *pvArg, uint32_t u32CardDetSrc)
+{
+    SDH_T *sdh = (SDH_T *)pvArg;
+
+    /* The card may have gone again since the item was posted */
+    if (sdh->INTSTS & SDH_INTSTS_CDSTS_Msk)
+        return;
+
+    SDH_Open(sdh, u32CardDetSrc);
+    SDH_Probe(sdh);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/** @addtogroup SDH_EXPORTED_FUNCTIONS SDH Exported Functions
+  @{
+*/
+
+/**
+ *  @brief  Handle a card detect interrupt.
+ *
+ *  @param[in]  sdh             Select SDH0 or SDH1.
+ *  @param[in]  u32CardDetSrc   Card detection source passed to SDH_Open() on insertion. ( \ref CardDetect_From_GPIO / \ref CardDetect_From_DAT3)
+ *  @param[in]  i32WorkSrc      Work queue source of the card initialization, from WORKQ_AddSource(), or -1.
+ *
+ *  @return None
+ *
+ *  @details Call from SDHn_IRQHandler() when SDH_INTSTS_CDIF is set, and clear CDIF afterwards.
+ *           A removal clears the card information at once. An insertion runs SDH_Open() and
+ *           SDH_Probe() from a WORKQ_PRIO_LOW work item, or inline if the level is full.
+ */
+void SDH_CardDetectHandler(SDH_T *sdh, uint32_t u32CardDetSrc, int32_t i32WorkSrc)
+{
+    SDH_INFO_T *pSD = (sdh == SDH0) ? &SD0 : &SD1;
+    uint32_t u32Isr;
+
+    //----- SD interrupt status
+    // it is work to delay 50 times for SD_CLK = 200KHz
+    {
+        int volatile i;         // delay 30 fail, 50 OK
+        for (i=0; i<0x500; i++);  // delay to make sure got updated value from REG_SDISR.
+        u32Isr = sdh->INTSTS;
+    }
+
+    if (u32Isr & SDH_INTSTS_CDSTS_Msk)
+    {
+        pSD->IsCardInsert = FALSE;   // SDISR_CD_Card = 1 means card remove for GPIO mode
+        memset(pSD, 0, sizeof(SDH_INFO_T));
+    }
+    else
+    {
+        if (WORKQ_Post(WORKQ_PRIO_LOW, i32WorkSrc, SDH_CardInsertWork, sdh, u32CardDetSrc) != WORKQ_OK)
+            SDH_CardInsertWork(sdh, u32CardDetSrc);
+    }
+}
+
+/*@}*/ /* end of group SDH_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SDH_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
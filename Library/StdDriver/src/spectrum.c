@@ -0,0 +1,333 @@
+/**************************************************************************//**
+ * @file     spectrum.c
+ * @version  V1.00
+ * @brief    M480 series streaming spectrum analyzer source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include <math.h>
+#include "spectrum.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SPECTRUM_Driver Spectrum Analyzer Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define SPECTRUM_2PI    6.28318530717958647692f
+
+/* Periodic window, the coefficient sum is returned for the amplitude scale */
+static float32_t SPECTRUM_MakeWindow(float32_t *pf32Win, uint32_t u32Len, uint32_t u32Window)
+{
+    uint32_t i;
+    float32_t f32X, f32W, f32Sum = 0.0f;
+
+    for (i = 0UL; i < u32Len; i++)
+    {
+        f32X = SPECTRUM_2PI * (float32_t)i / (float32_t)u32Len;
+
+        switch (u32Window)
+        {
+        case SPECTRUM_WIN_HANN:
+            f32W = 0.5f - 0.5f * cosf(f32X);
+            break;
+        case SPECTRUM_WIN_HAMMING:
+            f32W = 0.54f - 0.46f * cosf(f32X);
+            break;
+        case SPECTRUM_WIN_BLACKMAN:
+            f32W = 0.42f - 0.5f * cosf(f32X) + 0.08f * cosf(2.0f * f32X);
+            break;
+        case SPECTRUM_WIN_FLATTOP:
+            f32W = 0.21557895f - 0.41663158f * cosf(f32X) + 0.277263158f * cosf(2.0f * f32X) -
+                   0.083578947f * cosf(3.0f * f32X) + 0.006947368f * cosf(4.0f * f32X);
+            break;
+        default:
+            f32W = 1.0f;
+            break;
+        }
+
+        /* Peak of 1.0 (flat top slightly above) would saturate the Q31 window */
+        if (f32W > 0.9999999f)
+            f32W = 0.9999999f;
+        pf32Win[i] = f32W;
+        f32Sum += f32W;
+    }
+    return f32Sum;
+}
+
+/* Appends u32Len samples converted to the processing format at pvFrame[u32Fill] */
+static void SPECTRUM_Append(SPECTRUM_T *psSpec, const void *pvSrc, uint32_t u32Len, uint32_t u32SrcFmt)
+{
+    if (psSpec->sCfg.u32Fmt == SPECTRUM_F32)
+    {
+        float32_t *pf32Dst = (float32_t *)psSpec->pvFrame + psSpec->u32Fill;
+
+        if (u32SrcFmt == SPECTRUM_Q15)
+            arm_q15_to_float((q15_t *)pvSrc, pf32Dst, u32Len);
+        else if (u32SrcFmt == SPECTRUM_Q31)
+            arm_q31_to_float((q31_t *)pvSrc, pf32Dst, u32Len);
+        else
+            memcpy(pf32Dst, pvSrc, u32Len * sizeof(float32_t));
+    }
+    else
+    {
+        q31_t *pq31Dst = (q31_t *)psSpec->pvFrame + psSpec->u32Fill;
+
+        if (u32SrcFmt == SPECTRUM_Q15)
+            arm_q15_to_q31((q15_t *)pvSrc, pq31Dst, u32Len);
+        else if (u32SrcFmt == SPECTRUM_F32)
+            arm_float_to_q31((float32_t *)pvSrc, pq31Dst, u32Len);
+        else
+            memcpy(pq31Dst, pvSrc, u32Len * sizeof(q31_t));
+    }
+    psSpec->u32Fill += u32Len;
+}
+
+/* Window, transform and add the amplitudes of the full frame to the average */
+static void SPECTRUM_Frame(SPECTRUM_T *psSpec)
+{
+    uint32_t u32N = psSpec->sCfg.u32FftLen, u32Half = u32N / 2UL, u32Bins = psSpec->u32Bins;
+
+    if (psSpec->sCfg.u32Fmt == SPECTRUM_F32)
+    {
+        float32_t *pf32Out = (float32_t *)psSpec->pvOut, *pf32Mag = (float32_t *)psSpec->pvMag;
+
+        arm_mult_f32((float32_t *)psSpec->pvFrame, (float32_t *)psSpec->pvWin, (float32_t *)psSpec->pvIn, u32N);
+        arm_rfft_fast_f32(&psSpec->uFft.sF32, (float32_t *)psSpec->pvIn, pf32Out, 0U);
+        /* The packed output holds the real DC and Nyquist terms in its first complex slot */
+        arm_cmplx_mag_f32(pf32Out, pf32Mag, u32Half);
+        pf32Mag[0] = 0.5f * fabsf(pf32Out[0]);
+        pf32Mag[u32Half] = 0.5f * fabsf(pf32Out[1]);
+        arm_scale_f32(pf32Mag, psSpec->f32Scale, pf32Mag, u32Bins);
+        arm_add_f32((float32_t *)psSpec->pvAvg, pf32Mag, (float32_t *)psSpec->pvAvg, u32Bins);
+    }
+    else
+    {
+        q31_t *pq31Mag = (q31_t *)psSpec->pvMag;
+
+        arm_mult_q31((q31_t *)psSpec->pvFrame, (q31_t *)psSpec->pvWin, (q31_t *)psSpec->pvIn, u32N);
+        arm_rfft_q31(&psSpec->uFft.sQ31, (q31_t *)psSpec->pvIn, (q31_t *)psSpec->pvOut);
+        arm_cmplx_mag_q31((q31_t *)psSpec->pvOut, pq31Mag, u32Bins);
+        pq31Mag[0] >>= 1;
+        pq31Mag[u32Half] >>= 1;
+        arm_scale_q31(pq31Mag, psSpec->q31Scale, psSpec->i8Shift, pq31Mag, u32Bins);
+        arm_add_q31((q31_t *)psSpec->pvAvg, pq31Mag, (q31_t *)psSpec->pvAvg, u32Bins);
+    }
+
+    /* Keep the overlap for the next frame */
+    psSpec->u32Fill = u32N - psSpec->sCfg.u32Hop;
+    memmove(psSpec->pvFrame, (uint32_t *)psSpec->pvFrame + psSpec->sCfg.u32Hop, psSpec->u32Fill * 4UL);
+    psSpec->u32Frames++;
+}
+
+static float32_t SPECTRUM_Avg(const SPECTRUM_T *psSpec, uint32_t u32Bin)
+{
+    if (psSpec->sCfg.u32Fmt == SPECTRUM_F32)
+        return ((const float32_t *)psSpec->pvAvg)[u32Bin];
+    return (float32_t)((const q31_t *)psSpec->pvAvg)[u32Bin] * (1.0f / 2147483648.0f);
+}
+
+/* Local maxima above the threshold, strongest first */
+static uint32_t SPECTRUM_FindPeaks(SPECTRUM_T *psSpec)
+{
+    SPECTRUM_PEAK_T *psPeaks = psSpec->psPeaks;
+    uint32_t u32Max = psSpec->sCfg.u32MaxPeaks, u32Cnt = 0UL, i, j;
+    float32_t f32A, f32B, f32C, f32D, f32Den, f32Mag;
+
+    if (u32Max == 0UL)
+        return 0UL;
+
+    f32A = SPECTRUM_Avg(psSpec, 0UL);
+    f32B = SPECTRUM_Avg(psSpec, 1UL);
+    for (i = 1UL; i + 1UL < psSpec->u32Bins; i++)
+    {
+        f32C = SPECTRUM_Avg(psSpec, i + 1UL);
+
+        if ((f32B > f32A) && (f32B >= f32C) && (f32B >= psSpec->sCfg.f32Threshold) &&
+                ((u32Cnt < u32Max) || (f32B > psPeaks[u32Max - 1UL].f32Mag)))
+        {
+            f32Den = f32A - 2.0f * f32B + f32C;
+            f32D = (f32Den < 0.0f) ? (0.5f * (f32A - f32C) / f32Den) : 0.0f;
+            f32Mag = f32B - 0.25f * (f32A - f32C) * f32D;
+
+            /* Insertion into the sorted list, the weakest falls off a full list */
+            j = (u32Cnt < u32Max) ? u32Cnt++ : (u32Max - 1UL);
+            while ((j > 0UL) && (psPeaks[j - 1UL].f32Mag < f32Mag))
+            {
+                psPeaks[j] = psPeaks[j - 1UL];
+                j--;
+            }
+            psPeaks[j].u32Bin = i;
+            psPeaks[j].f32Freq = ((float32_t)i + f32D) * psSpec->sCfg.f32SampleRate / (float32_t)psSpec->sCfg.u32FftLen;
+            psPeaks[j].f32Mag = f32Mag;
+        }
+        f32A = f32B;
+        f32B = f32C;
+    }
+    return u32Cnt;
+}
+
+static void SPECTRUM_Result(SPECTRUM_T *psSpec)
+{
+    SPECTRUM_RESULT_T sResult;
+
+    sResult.pvMag = psSpec->pvAvg;
+    sResult.u32Bins = psSpec->u32Bins;
+    sResult.psPeaks = psSpec->psPeaks;
+    sResult.u32Peaks = SPECTRUM_FindPeaks(psSpec);
+    sResult.u32Seq = psSpec->u32Seq++;
+
+    if (psSpec->sCfg.pfnResult != NULL)
+        psSpec->sCfg.pfnResult(psSpec->sCfg.pvArg, &sResult);
+
+    memset(psSpec->pvAvg, 0, psSpec->u32Bins * 4UL);
+    psSpec->u32Frames = 0UL;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief      Open an analyzer
+  * @param[out] psSpec          Analyzer instance
+  * @param[in]  psCfg           Analyzer configuration
+  * @param[in]  pvArena         Word aligned memory for all buffers, used until the instance is dropped
+  * @param[in]  u32ArenaSize    Bytes at pvArena, at least SPECTRUM_ARENA_SIZE()
+  * @retval     SPECTRUM_OK         Success
+  * @retval     SPECTRUM_ERR_PARAM  Invalid configuration
+  * @retval     SPECTRUM_ERR_MEM    Arena too small or not word aligned
+  * @details    Sets up the transform, computes the window and the amplitude scale and clears the frame.
+  *             Several instances may run side by side, one per stream.
+  */
+int32_t SPECTRUM_Open(SPECTRUM_T *psSpec, const SPECTRUM_CFG_T *psCfg, void *pvArena, uint32_t u32ArenaSize)
+{
+    uint32_t u32N, *pu32Mem = (uint32_t *)pvArena;
+    float32_t f32Sum, f32Scale;
+    int8_t i8Shift = 0;
+    arm_status eStatus;
+
+    if ((psSpec == NULL) || (psCfg == NULL))
+        return SPECTRUM_ERR_PARAM;
+
+    u32N = psCfg->u32FftLen;
+    if ((u32N < SPECTRUM_MIN_FFT) || (u32N > SPECTRUM_MAX_FFT) || (u32N & (u32N - 1UL)) ||
+            ((psCfg->u32Fmt != SPECTRUM_F32) && (psCfg->u32Fmt != SPECTRUM_Q31)) ||
+            (psCfg->u32Hop == 0UL) || (psCfg->u32Hop > u32N) || (psCfg->u32Window > SPECTRUM_WIN_FLATTOP) ||
+            (psCfg->u32Average == 0UL) || (psCfg->u32MaxPeaks > SPECTRUM_MAX_PEAKS))
+        return SPECTRUM_ERR_PARAM;
+
+    if ((pvArena == NULL) || ((uintptr_t)pvArena & 3UL) ||
+            (u32ArenaSize < SPECTRUM_ARENA_SIZE(u32N, psCfg->u32Fmt, psCfg->u32MaxPeaks)))
+        return SPECTRUM_ERR_MEM;
+
+    memset(psSpec, 0, sizeof(SPECTRUM_T));
+    psSpec->sCfg = *psCfg;
+    psSpec->u32Bins = u32N / 2UL + 1UL;
+
+    if (psCfg->u32Fmt == SPECTRUM_F32)
+        eStatus = arm_rfft_fast_init_f32(&psSpec->uFft.sF32, (uint16_t)u32N);
+    else
+        eStatus = arm_rfft_init_q31(&psSpec->uFft.sQ31, u32N, 0UL, 1UL);
+    if (eStatus != ARM_MATH_SUCCESS)
+        return SPECTRUM_ERR_PARAM;
+
+    psSpec->pvWin = pu32Mem;
+    pu32Mem += u32N;
+    psSpec->pvFrame = pu32Mem;
+    pu32Mem += u32N;
+    psSpec->pvIn = pu32Mem;
+    pu32Mem += u32N;
+    psSpec->pvOut = pu32Mem;
+    pu32Mem += (psCfg->u32Fmt == SPECTRUM_Q31) ? (2UL * u32N) : u32N;
+    psSpec->pvMag = pu32Mem;
+    pu32Mem += psSpec->u32Bins;
+    psSpec->pvAvg = pu32Mem;
+    pu32Mem += psSpec->u32Bins;
+    psSpec->psPeaks = (SPECTRUM_PEAK_T *)pu32Mem;
+
+    /*
+     * A sine of amplitude A shows as A * sum(window) / 2 in its bin. The Q31 transform also
+     * scales its output down by u32N and arm_cmplx_mag_q31() returns 2.30, so the Q31
+     * magnitudes need 2 * u32N more. 1 / u32Average is folded in for the average.
+     */
+    f32Sum = SPECTRUM_MakeWindow((float32_t *)psSpec->pvWin, u32N, psCfg->u32Window);
+    f32Scale = 2.0f / (f32Sum * (float32_t)psCfg->u32Average);
+    psSpec->f32Scale = f32Scale;
+
+    if (psCfg->u32Fmt == SPECTRUM_Q31)
+    {
+        arm_float_to_q31((float32_t *)psSpec->pvWin, (q31_t *)psSpec->pvWin, u32N);
+
+        f32Scale *= 2.0f * (float32_t)u32N;
+        while (f32Scale >= 1.0f)
+        {
+            f32Scale *= 0.5f;
+            i8Shift++;
+        }
+        psSpec->q31Scale = (q31_t)(f32Scale * 2147483648.0f);
+        psSpec->i8Shift = i8Shift;
+    }
+
+    SPECTRUM_Reset(psSpec);
+    return SPECTRUM_OK;
+}
+
+/**
+  * @brief      Restart an analyzer
+  * @param[in]  psSpec  Analyzer instance
+  * @details    Drops the collected samples and the partial average, e.g. after a gap in the stream.
+  */
+void SPECTRUM_Reset(SPECTRUM_T *psSpec)
+{
+    psSpec->u32Fill = 0UL;
+    psSpec->u32Frames = 0UL;
+    memset(psSpec->pvAvg, 0, psSpec->u32Bins * 4UL);
+}
+
+/**
+  * @brief      Feed samples
+  * @param[in]  psSpec      Analyzer instance
+  * @param[in]  pvSrc       Samples, converted to the processing format as they are copied in
+  * @param[in]  u32Len      Samples at pvSrc, any number
+  * @param[in]  u32SrcFmt   Format of pvSrc: SPECTRUM_F32, SPECTRUM_Q31 or SPECTRUM_Q15
+  * @return     Frames transformed
+  * @details    Transforms a frame each time u32Hop new samples complete it and calls the result
+  *             callback, from this context, when u32Average frames are averaged.
+  */
+uint32_t SPECTRUM_Write(SPECTRUM_T *psSpec, const void *pvSrc, uint32_t u32Len, uint32_t u32SrcFmt)
+{
+    uint32_t u32Cnt, u32Frames = 0UL;
+    uint32_t u32Size = (u32SrcFmt == SPECTRUM_Q15) ? sizeof(q15_t) : 4UL;
+
+    while (u32Len)
+    {
+        u32Cnt = psSpec->sCfg.u32FftLen - psSpec->u32Fill;
+        if (u32Cnt > u32Len)
+            u32Cnt = u32Len;
+
+        SPECTRUM_Append(psSpec, pvSrc, u32Cnt, u32SrcFmt);
+        pvSrc = (const uint8_t *)pvSrc + u32Cnt * u32Size;
+        u32Len -= u32Cnt;
+
+        if (psSpec->u32Fill == psSpec->sCfg.u32FftLen)
+        {
+            SPECTRUM_Frame(psSpec);
+            u32Frames++;
+
+            if (psSpec->u32Frames == psSpec->sCfg.u32Average)
+                SPECTRUM_Result(psSpec);
+        }
+    }
+    return u32Frames;
+}
+
+/*@}*/ /* end of group SPECTRUM_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
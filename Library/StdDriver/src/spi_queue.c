@@ -0,0 +1,508 @@
+/**************************************************************************//**
+ * @file     spi_queue.c
+ * @version  V1.00
+ * @brief    M480 series SPI/QSPI PDMA transaction queue source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "pdma_mgr.h"
+#include "spi_queue.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SPIQ_Driver SPI Queue Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/* Control bits owned by a device or a transaction phase. SPI_T uses the same positions. */
+#define SPIQ_CTL_MASK       (QSPI_CTL_CLKPOL_Msk | QSPI_CTL_TXNEG_Msk | QSPI_CTL_RXNEG_Msk | QSPI_CTL_DWIDTH_Msk | \
+                             QSPI_CTL_LSB_Msk | QSPI_CTL_DATDIR_Msk | QSPI_CTL_DUALIOEN_Msk | QSPI_CTL_QUADIOEN_Msk)
+#define SPIQ_XFER_OUT       (SPIQ_XFER_DUAL_OUT | SPIQ_XFER_QUAD_OUT)
+#define SPIQ_XFER_IN        (SPIQ_XFER_DUAL_IN | SPIQ_XFER_QUAD_IN)
+#define SPIQ_XFER_MULTI     (SPIQ_XFER_OUT | SPIQ_XFER_IN)
+#define SPIQ_PDMA_CTL       (PDMA_OP_BASIC | PDMA_REQ_SINGLE | PDMA_DSCT_CTL_TBINTDIS_Msk)
+#define SPIQ_MAX_FRAMES     0x10000UL
+#define SPIQ_CHAIN_MAX      8UL         /* Transactions in one PDMA chain, one table each per channel */
+
+static void SPIQ_Cs(SPIQ_BUS_T *psBus, const SPIQ_DEV_T *psDev, uint32_t u32On)
+{
+    if (psDev->pu32CsPin != NULL)
+        *psDev->pu32CsPin = (psDev->u32CsActive == SPIQ_CS_ACTIVE_HIGH) ? u32On : (u32On ^ 1UL);
+    else
+        psBus->psRegs->SSCTL = (psBus->psRegs->SSCTL & ~(QSPI_SSCTL_SSACTPOL_Msk | QSPI_SSCTL_SS_Msk)) |
+                               ((psDev->u32CsActive == SPIQ_CS_ACTIVE_HIGH) ? QSPI_SSCTL_SSACTPOL_Msk : 0UL) |
+                               (u32On ? QSPI_SSCTL_SS_Msk : 0UL);
+}
+
+static void SPIQ_Start(SPIQ_BUS_T *psBus);
+
+/* The transactions of the finished run are taken off the queue, the next one is started, then the callbacks run */
+static void SPIQ_Finish(SPIQ_BUS_T *psBus, uint32_t u32Count)
+{
+    SPIQ_XFER_T *psXfer = psBus->psHead, *psLast = psXfer, *psNext;
+    uint32_t i;
+
+    psBus->psRegs->PDMACTL = 0UL;
+
+    for (i = 1UL; i < u32Count; i++)
+        psLast = psLast->psQNext;
+
+    if ((psLast->u32Flags & SPIQ_XFER_CS_KEEP) == 0UL)
+    {
+        SPIQ_Cs(psBus, psLast->psDev, 0UL);
+        psBus->psCsDev = NULL;
+    }
+
+    psBus->psHead = psLast->psQNext;
+
+    if (psBus->psHead == NULL)
+        psBus->psTail = NULL;
+    else
+        SPIQ_Start(psBus);
+
+    for (i = 0UL; i < u32Count; i++)
+    {
+        psNext = psXfer->psQNext;
+        psBus->u32Xfers++;
+        psBus->u32Bytes += psXfer->u32Len;
+        psXfer->u32Queued = 0UL;
+
+        if (psXfer->pfnDone != NULL)
+            psXfer->pfnDone(psXfer->pvArg, psXfer);
+
+        psXfer = psNext;
+    }
+}
+
+/* PDMA manager callback of both channels of a chain. The run is over once both have stopped. */
+static void SPIQ_ChainDone(void *pvArg, uint32_t u32Ch, uint32_t u32Event, uint32_t u32Seg)
+{
+    SPIQ_BUS_T *psBus = (SPIQ_BUS_T *)pvArg;
+    uint32_t u32Count = psBus->u32Chain;
+
+    (void)u32Ch;
+    (void)u32Seg;
+
+    if (u32Count == 0UL)
+        return;
+
+    if (u32Event & PDMAMGR_EVT_ABORT)
+    {
+        PDMAMGR_Stop(psBus->u32TxCh);
+        PDMAMGR_Stop(psBus->u32RxCh);
+        psBus->u32ChainPend = 0UL;
+    }
+    else if (u32Event & PDMAMGR_EVT_DONE)
+    {
+        psBus->u32ChainPend--;
+    }
+
+    if (psBus->u32ChainPend == 0UL)
+    {
+        psBus->u32Chain = 0UL;
+        SPIQ_Finish(psBus, u32Count);
+    }
+}
+
+/* Control bits of a transaction, switched to along with the clock divider if they differ, and chip select asserted */
+static void SPIQ_Select(SPIQ_BUS_T *psBus, const SPIQ_XFER_T *psXfer)
+{
+    SPIQ_DEV_T *psDev = psXfer->psDev;
+    QSPI_T *qspi = psBus->psRegs;
+    uint32_t u32Ctl;
+
+    if ((psBus->psCsDev != NULL) && (psBus->psCsDev != psDev))
+    {
+        SPIQ_Cs(psBus, psBus->psCsDev, 0UL);
+        psBus->psCsDev = NULL;
+    }
+
+    u32Ctl = psDev->u32Ctl;
+
+    if (psXfer->u32Flags & SPIQ_XFER_OUT)
+        u32Ctl |= QSPI_CTL_DATDIR_Msk;
+
+    if (psXfer->u32Flags & (SPIQ_XFER_DUAL_OUT | SPIQ_XFER_DUAL_IN))
+        u32Ctl |= QSPI_CTL_DUALIOEN_Msk;
+    else if (psXfer->u32Flags & (SPIQ_XFER_QUAD_OUT | SPIQ_XFER_QUAD_IN))
+        u32Ctl |= QSPI_CTL_QUADIOEN_Msk;
+
+    if ((u32Ctl != psBus->u32Ctl) || (psDev->u32ClkDiv != psBus->u32ClkDiv))
+    {
+        qspi->CTL = (qspi->CTL & ~SPIQ_CTL_MASK) | u32Ctl;
+        qspi->CLKDIV = psDev->u32ClkDiv;
+        psBus->u32Ctl = u32Ctl;
+        psBus->u32ClkDiv = psDev->u32ClkDiv;
+        psBus->u32Switches++;
+    }
+
+    if (psBus->psCsDev == NULL)
+    {
+        SPIQ_Cs(psBus, psDev, 1UL);
+        psBus->psCsDev = psDev;
+    }
+}
+
+/*
+ *  Run psBus->psHead and the transactions after it as one scatter-gather chain per channel when they
+ *  are full duplex on a single line, of one device, and all but the last keep the chip select: the
+ *  bus needs no change between them. Returns 0 if there is no such run or the descriptors are short.
+ */
+static uint32_t SPIQ_StartChain(SPIQ_BUS_T *psBus)
+{
+    PDMAMGR_SEG_T asTx[SPIQ_CHAIN_MAX], asRx[SPIQ_CHAIN_MAX];
+    SPIQ_XFER_T *psXfer = psBus->psHead;
+    SPIQ_DEV_T *psDev = psXfer->psDev;
+    QSPI_T *qspi = psBus->psRegs;
+    uint32_t u32Count = 0UL, u32Width = (psDev->u32DataWidth >> 4) << PDMA_DSCT_CTL_TXWIDTH_Pos;
+
+    while ((psXfer != NULL) && (u32Count < SPIQ_CHAIN_MAX) && (psXfer->psDev == psDev) &&
+            ((psXfer->u32Flags & SPIQ_XFER_MULTI) == 0UL))
+    {
+        asTx[u32Count].u32Src = (psXfer->pvTx != NULL) ? (uint32_t)psXfer->pvTx : (uint32_t)&psBus->u32Dummy;
+        asTx[u32Count].u32Dst = (uint32_t)&qspi->TX;
+        asTx[u32Count].u32Len = psXfer->u32Len;
+        asTx[u32Count].u32Width = u32Width;
+        asTx[u32Count].u32Mode = ((psXfer->pvTx != NULL) ? PDMA_SAR_INC : PDMA_SAR_FIX) | PDMA_DAR_FIX;
+        asRx[u32Count].u32Src = (uint32_t)&qspi->RX;
+        asRx[u32Count].u32Dst = (psXfer->pvRx != NULL) ? (uint32_t)psXfer->pvRx : (uint32_t)&psBus->u32Sink;
+        asRx[u32Count].u32Len = psXfer->u32Len;
+        asRx[u32Count].u32Width = u32Width;
+        asRx[u32Count].u32Mode = PDMA_SAR_FIX | ((psXfer->pvRx != NULL) ? PDMA_DAR_INC : PDMA_DAR_FIX);
+        u32Count++;
+
+        if ((psXfer->u32Flags & SPIQ_XFER_CS_KEEP) == 0UL)
+            break;
+
+        psXfer = psXfer->psQNext;
+    }
+
+    if (u32Count < 2UL)
+        return 0UL;
+
+    if ((PDMAMGR_Build(psBus->u32TxCh, psBus->u32TxReq, asTx, u32Count, 0UL, SPIQ_ChainDone, psBus) != PDMAMGR_OK) ||
+            (PDMAMGR_Build(psBus->u32RxCh, psBus->u32TxReq + 1UL, asRx, u32Count, 0UL, SPIQ_ChainDone, psBus) != PDMAMGR_OK))
+        return 0UL;
+
+    SPIQ_Select(psBus, psBus->psHead);
+    PDMA->INTEN &= ~((1UL << psBus->u32TxCh) | (1UL << psBus->u32RxCh));
+    psBus->u32Chain = u32Count;
+    psBus->u32ChainPend = 2UL;
+    psBus->u32Chained += u32Count;
+    PDMAMGR_Start(psBus->u32RxCh);
+    PDMAMGR_Start(psBus->u32TxCh);
+    qspi->PDMACTL = QSPI_PDMACTL_RXPDMAEN_Msk | QSPI_PDMACTL_TXPDMAEN_Msk;
+
+    return 1UL;
+}
+
+/* Start psBus->psHead. Called with the PDMA interrupt masked or from the PDMA interrupt. */
+static void SPIQ_Start(SPIQ_BUS_T *psBus)
+{
+    SPIQ_XFER_T *psXfer = psBus->psHead;
+    SPIQ_DEV_T *psDev = psXfer->psDev;
+    QSPI_T *qspi = psBus->psRegs;
+    uint32_t u32Shift, u32Cnt, u32Width;
+
+    if (SPIQ_StartChain(psBus))
+        return;
+
+    SPIQ_Select(psBus, psXfer);
+
+    /* A chain leaves the channels disabled */
+    PDMA->CHCTL |= (1UL << psBus->u32TxCh) | (1UL << psBus->u32RxCh);
+
+    u32Shift = psDev->u32DataWidth >> 4;       /* 8, 16, 32 bits: 0, 1, 2 */
+    u32Width = u32Shift << PDMA_DSCT_CTL_TXWIDTH_Pos;
+    u32Cnt = (psXfer->u32Len >> u32Shift) - 1UL;
+
+    PDMA->DSCT[psBus->u32TxCh].SA = ((psXfer->pvTx != NULL) && !(psXfer->u32Flags & SPIQ_XFER_IN)) ?
+                                    (uint32_t)psXfer->pvTx : (uint32_t)&psBus->u32Dummy;
+    PDMA->DSCT[psBus->u32TxCh].DA = (uint32_t)&qspi->TX;
+    PDMA->DSCT[psBus->u32TxCh].CTL = SPIQ_PDMA_CTL | u32Width | PDMA_DAR_FIX | (u32Cnt << PDMA_DSCT_CTL_TXCNT_Pos) |
+                                     (((psXfer->pvTx != NULL) && !(psXfer->u32Flags & SPIQ_XFER_IN)) ? PDMA_SAR_INC : PDMA_SAR_FIX);
+
+    if (psXfer->u32Flags & SPIQ_XFER_OUT)
+    {
+        /* Nothing to receive: the transaction ends with TX, once the shifter is idle */
+        psBus->u32DoneCh = psBus->u32TxCh;
+        PDMA->INTEN = (PDMA->INTEN & ~(1UL << psBus->u32RxCh)) | (1UL << psBus->u32TxCh);
+        qspi->PDMACTL = QSPI_PDMACTL_TXPDMAEN_Msk;
+    }
+    else
+    {
+        PDMA->DSCT[psBus->u32RxCh].SA = (uint32_t)&qspi->RX;
+        PDMA->DSCT[psBus->u32RxCh].DA = (psXfer->pvRx != NULL) ? (uint32_t)psXfer->pvRx : (uint32_t)&psBus->u32Sink;
+        PDMA->DSCT[psBus->u32RxCh].CTL = SPIQ_PDMA_CTL | u32Width | PDMA_SAR_FIX | (u32Cnt << PDMA_DSCT_CTL_TXCNT_Pos) |
+                                         ((psXfer->pvRx != NULL) ? PDMA_DAR_INC : PDMA_DAR_FIX);
+        psBus->u32DoneCh = psBus->u32RxCh;
+        PDMA->INTEN = (PDMA->INTEN & ~(1UL << psBus->u32TxCh)) | (1UL << psBus->u32RxCh);
+        qspi->PDMACTL = QSPI_PDMACTL_RXPDMAEN_Msk | QSPI_PDMACTL_TXPDMAEN_Msk;
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief      Open a transaction queue on a controller
+  * @param[out] psBus   Bus state, kept by the caller until SPIQ_Close()
+  * @param[in]  u32Bus  SPIQ_BUS_QSPI0 or SPIQ_BUS_SPI0 ~ SPIQ_BUS_SPI3
+  * @retval     SPIQ_OK         Success
+  * @retval     SPIQ_ERR_PARAM  Invalid bus
+  * @retval     SPIQ_ERR_PDMA   Two free PDMA channels are not available
+  * @details    The controller must already be opened as master with QSPI_Open() or SPI_Open(),
+  *             clocked and pinned. Automatic slave select is turned off; chip selects are driven
+  *             per transaction.
+  */
+int32_t SPIQ_Open(SPIQ_BUS_T *psBus, uint32_t u32Bus)
+{
+    static QSPI_T *const s_apsRegs[] = {QSPI0, (QSPI_T *)SPI0, (QSPI_T *)SPI1, (QSPI_T *)SPI2, (QSPI_T *)SPI3};
+    uint32_t u32TxReq, u32RxReq;
+    int32_t i32Tx, i32Rx;
+
+    if ((psBus == NULL) || (u32Bus > SPIQ_BUS_SPI3))
+        return SPIQ_ERR_PARAM;
+
+    /* QSPI0_TX/RX are requests 20/21, SPIn_TX/RX follow in pairs */
+    u32TxReq = PDMA_QSPI0_TX + (u32Bus << 1);
+    u32RxReq = PDMA_QSPI0_RX + (u32Bus << 1);
+
+    i32Tx = PDMAMGR_Alloc(PDMAMGR_ALL_CH, PDMAMGR_PRIO_NORMAL);
+
+    if (i32Tx < 0)
+        return SPIQ_ERR_PDMA;
+
+    i32Rx = PDMAMGR_Alloc(PDMAMGR_ALL_CH, PDMAMGR_PRIO_NORMAL);
+
+    if (i32Rx < 0)
+    {
+        PDMAMGR_Free((uint32_t)i32Tx);
+        return SPIQ_ERR_PDMA;
+    }
+
+    memset(psBus, 0, sizeof(SPIQ_BUS_T));
+    psBus->psRegs = s_apsRegs[u32Bus];
+    psBus->u32Qspi = (u32Bus == SPIQ_BUS_QSPI0) ? 1UL : 0UL;
+    psBus->u32TxCh = (uint32_t)i32Tx;
+    psBus->u32RxCh = (uint32_t)i32Rx;
+    psBus->u32TxReq = u32TxReq;
+    psBus->u32Dummy = 0xFFFFFFFFUL;
+    psBus->u32Ctl = psBus->psRegs->CTL & SPIQ_CTL_MASK;
+    psBus->u32ClkDiv = psBus->psRegs->CLKDIV;
+
+    psBus->psRegs->PDMACTL = 0UL;
+    psBus->psRegs->SSCTL &= ~(QSPI_SSCTL_AUTOSS_Msk | QSPI_SSCTL_SS_Msk);
+
+    PDMA_Open(PDMA, (1UL << psBus->u32TxCh) | (1UL << psBus->u32RxCh));
+    PDMA_SetTransferMode(PDMA, psBus->u32TxCh, u32TxReq, FALSE, 0UL);
+    PDMA_SetTransferMode(PDMA, psBus->u32RxCh, u32RxReq, FALSE, 0UL);
+    NVIC_EnableIRQ(PDMA_IRQn);
+
+    return SPIQ_OK;
+}
+
+/**
+  * @brief      Close a transaction queue
+  * @param[in]  psBus   Bus state
+  * @return     None
+  * @details    Abandons the running transaction and drops the queued ones without callbacks,
+  *             releases the chip select and returns the PDMA channels.
+  */
+void SPIQ_Close(SPIQ_BUS_T *psBus)
+{
+    SPIQ_XFER_T *psXfer;
+    uint32_t u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+
+    psBus->psRegs->PDMACTL = 0UL;
+    PDMA->INTEN &= ~((1UL << psBus->u32TxCh) | (1UL << psBus->u32RxCh));
+    PDMAMGR_Free(psBus->u32TxCh);
+    PDMAMGR_Free(psBus->u32RxCh);
+    psBus->u32Chain = 0UL;
+
+    for (psXfer = psBus->psHead; psXfer != NULL; psXfer = psXfer->psQNext)
+        psXfer->u32Queued = 0UL;
+
+    psBus->psHead = NULL;
+    psBus->psTail = NULL;
+
+    if (psBus->psCsDev != NULL)
+    {
+        SPIQ_Cs(psBus, psBus->psCsDev, 0UL);
+        psBus->psCsDev = NULL;
+    }
+
+    __set_PRIMASK(u32PriMask);
+
+    QSPI_ClearRxFIFO(psBus->psRegs);
+    QSPI_ClearTxFIFO(psBus->psRegs);
+}
+
+/**
+  * @brief      Prepare a device for a bus
+  * @param[in]  psBus   Bus state
+  * @param[in,out] psDev    Device, u32Mode, u32DataWidth, u32BusClock, pu32CsPin and u32CsActive filled in
+  * @retval     SPIQ_OK         Success
+  * @retval     SPIQ_ERR_PARAM  Invalid mode or data width
+  * @retval     SPIQ_ERR_BUSY   The bus is not idle
+  * @details    Computes the clock divider with the controller's own clock setting code and drives
+  *             the chip select inactive. Only one device per bus may use the controller's SS line.
+  */
+int32_t SPIQ_AttachDevice(SPIQ_BUS_T *psBus, SPIQ_DEV_T *psDev)
+{
+    uint32_t u32ClkDiv;
+
+    if ((psDev == NULL) || (psDev->u32Mode & ~(QSPI_CTL_CLKPOL_Msk | QSPI_CTL_TXNEG_Msk | QSPI_CTL_RXNEG_Msk)) ||
+            ((psDev->u32DataWidth != 8UL) && (psDev->u32DataWidth != 16UL) && (psDev->u32DataWidth != 32UL)) ||
+            (psDev->u32BusClock == 0UL))
+        return SPIQ_ERR_PARAM;
+
+    if (psBus->psHead != NULL)
+        return SPIQ_ERR_BUSY;
+
+    u32ClkDiv = psBus->psRegs->CLKDIV;
+
+    if (psBus->u32Qspi)
+        QSPI_SetBusClock(psBus->psRegs, psDev->u32BusClock);
+    else
+        SPI_SetBusClock((SPI_T *)psBus->psRegs, psDev->u32BusClock);
+
+    psDev->u32ClkDiv = psBus->psRegs->CLKDIV;
+    psBus->psRegs->CLKDIV = u32ClkDiv;
+
+    /* DWIDTH 0 means 32 bits */
+    psDev->u32Ctl = psDev->u32Mode | ((psDev->u32DataWidth & 0x1FUL) << QSPI_CTL_DWIDTH_Pos);
+
+    if (psDev->pu32CsPin != NULL)
+        SPIQ_Cs(psBus, psDev, 0UL);
+
+    return SPIQ_OK;
+}
+
+/**
+  * @brief      Queue a transaction or a sequence
+  * @param[in]  psBus   Bus state
+  * @param[in]  psXfer  First transaction; the ones linked through psNext follow it
+  * @retval     SPIQ_OK         Queued
+  * @retval     SPIQ_ERR_PARAM  Invalid transaction, nothing queued
+  * @retval     SPIQ_ERR_BUSY   A transaction of the sequence is still queued, nothing queued
+  * @details    May be called from interrupt handlers, including a callback. A transaction without
+  *             SPIQ_XFER_CS_KEEP releases the chip select when it ends. Single line transactions
+  *             held together by SPIQ_XFER_CS_KEEP run as one PDMA chain; the others start from the
+  *             PDMA interrupt. If the PDMA manager is short of descriptors, a chain is run one
+  *             transaction at a time.
+  */
+int32_t SPIQ_Submit(SPIQ_BUS_T *psBus, SPIQ_XFER_T *psXfer)
+{
+    SPIQ_XFER_T *psX;
+    uint32_t u32Multi, u32Shift, u32PriMask;
+
+    if (psXfer == NULL)
+        return SPIQ_ERR_PARAM;
+
+    for (psX = psXfer; psX != NULL; psX = psX->psNext)
+    {
+        if (psX->psDev == NULL)
+            return SPIQ_ERR_PARAM;
+
+        u32Multi = psX->u32Flags & SPIQ_XFER_MULTI;
+        u32Shift = psX->psDev->u32DataWidth >> 4;
+
+        if ((psX->u32Len == 0UL) || (psX->u32Len & ((1UL << u32Shift) - 1UL)) ||
+                ((psX->u32Len >> u32Shift) > SPIQ_MAX_FRAMES) || (u32Multi & (u32Multi - 1UL)) ||
+                (u32Multi && (psBus->u32Qspi == 0UL)))
+            return SPIQ_ERR_PARAM;
+
+        if (psX->u32Queued)
+            return SPIQ_ERR_BUSY;
+    }
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+
+    for (psX = psXfer; psX != NULL; psX = psX->psNext)
+    {
+        psX->psQNext = NULL;
+        psX->u32Queued = 1UL;
+
+        if (psBus->psTail != NULL)
+            psBus->psTail->psQNext = psX;
+        else
+            psBus->psHead = psX;
+
+        psBus->psTail = psX;
+    }
+
+    /* The bus was idle if the sequence is at the head */
+    if (psBus->psHead == psXfer)
+        SPIQ_Start(psBus);
+
+    __set_PRIMASK(u32PriMask);
+
+    return SPIQ_OK;
+}
+
+/**
+  * @brief      Check a transaction
+  * @param[in]  psXfer  Transaction
+  * @return     1 while queued or running, 0 once finished
+  */
+uint32_t SPIQ_IsQueued(const SPIQ_XFER_T *psXfer)
+{
+    return psXfer->u32Queued;
+}
+
+/**
+  * @brief      Check a bus
+  * @param[in]  psBus   Bus state
+  * @return     1 if no transaction is queued or running
+  */
+uint32_t SPIQ_IsIdle(const SPIQ_BUS_T *psBus)
+{
+    return (psBus->psHead == NULL) ? 1UL : 0UL;
+}
+
+/**
+  * @brief      PDMA interrupt service
+  * @param[in]  psBus   Bus state
+  * @return     None
+  * @details    Call from PDMA_IRQHandler(), along with PDMAMGR_IRQHandler() which ends chains.
+  *             Ends the running transaction, starts the next one and then calls the callback of
+  *             the finished one. A transmit-only dual or quad phase
+  *             waits here for the last frames to leave the FIFO, at most 8 frames.
+  */
+void SPIQ_PdmaHandler(SPIQ_BUS_T *psBus)
+{
+    SPIQ_XFER_T *psXfer = psBus->psHead;
+    QSPI_T *qspi = psBus->psRegs;
+
+    /* A chain is ended by PDMAMGR_IRQHandler() */
+    if ((psXfer == NULL) || (psBus->u32Chain != 0UL) || ((PDMA->INTSTS & PDMA_INTSTS_TDIF_Msk) == 0UL) ||
+            ((PDMA->TDSTS & (1UL << psBus->u32DoneCh)) == 0UL))
+        return;
+
+    PDMA_CLR_TD_FLAG(PDMA, (1UL << psBus->u32TxCh) | (1UL << psBus->u32RxCh));
+
+    if (psXfer->u32Flags & SPIQ_XFER_OUT)
+    {
+        while (qspi->STATUS & QSPI_STATUS_BUSY_Msk) {}
+
+        QSPI_ClearRxFIFO(qspi);
+    }
+
+    SPIQ_Finish(psBus, 1UL);
+}
+
+/*@}*/ /* end of group SPIQ_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
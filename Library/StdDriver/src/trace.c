@@ -0,0 +1,150 @@
+/**************************************************************************//**
+ * @file     trace.c
+ * @version  V1.00
+ * @brief    M480 series cycle counter trace point source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include "NuMicro.h"
+#include "trace.h"
+
+#if TRACE_ENABLE
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup TRACE_Driver TRACE Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#if (TRACE_RAM_ENTRIES & (TRACE_RAM_ENTRIES - 1)) != 0
+#error "TRACE_RAM_ENTRIES must be a power of 2"
+#endif
+
+static volatile uint32_t s_u32Backend;
+static volatile uint32_t s_u32Run;
+
+/// @endcond HIDDEN_SYMBOLS
+
+/** @addtogroup TRACE_EXPORTED_FUNCTIONS TRACE Exported Functions
+  @{
+*/
+
+TRACE_BUF_T g_sTraceBuf;    /*!< RAM backend buffer */
+
+/**
+  * @brief      Initialize tracing and start recording
+  *
+  * @param[in]  u32Backend  Where records go, combination of:
+  *                         - \ref TRACE_BACKEND_RAM
+  *                         - \ref TRACE_BACKEND_ITM
+  *
+  * @return     None
+  *
+  * @details    Starts the DWT cycle counter and clears g_sTraceBuf. The ITM backend only emits records
+  *             while the debugger has enabled ITM and stimulus port TRACE_ITM_PORT (e.g. SWO capture
+  *             running), so it can be left selected without a probe attached.
+  */
+void TRACE_Init(uint32_t u32Backend)
+{
+    uint32_t i;
+
+    s_u32Run = 0UL;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    g_sTraceBuf.u32Magic = TRACE_MAGIC;
+    g_sTraceBuf.u32Entries = TRACE_RAM_ENTRIES;
+    g_sTraceBuf.u32CoreClock = SystemCoreClock;
+    g_sTraceBuf.u32Head = 0UL;
+    for (i = 0UL; i < TRACE_RAM_ENTRIES; i++)
+    {
+        g_sTraceBuf.au32Rec[i][0] = 0UL;
+        g_sTraceBuf.au32Rec[i][1] = 0UL;
+    }
+
+    s_u32Backend = u32Backend;
+    s_u32Run = 1UL;
+}
+
+/**
+  * @brief      Resume recording after TRACE_Stop()
+  * @param      None
+  * @return     None
+  */
+void TRACE_Start(void)
+{
+    s_u32Run = 1UL;
+}
+
+/**
+  * @brief      Stop recording, e.g. to freeze the RAM buffer when a fault is detected
+  * @param      None
+  * @return     None
+  */
+void TRACE_Stop(void)
+{
+    s_u32Run = 0UL;
+}
+
+/**
+  * @brief      Write one trace record
+  *
+  * @param[in]  u32Desc     Record descriptor, (arg << 16) | (type << 8) | id.
+  *
+  * @return     None
+  *
+  * @details    Called through TRACE_BEGIN(), TRACE_END() and TRACE_EVENT(). The cycle counter is read and
+  *             the record is written with interrupts masked, so records of nested interrupts never
+  *             interleave and time stamps in the buffer are always in order. Safe to call from any interrupt level.
+  */
+void TRACE_Record(uint32_t u32Desc)
+{
+    uint32_t u32Backend = s_u32Backend;
+    uint32_t u32PriMask, u32Stamp, u32Idx;
+
+    if ((s_u32Run == 0UL) || (u32Backend == 0UL))
+        return;
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+    u32Stamp = DWT->CYCCNT;
+
+    if (u32Backend & TRACE_BACKEND_RAM)
+    {
+        u32Idx = g_sTraceBuf.u32Head & (TRACE_RAM_ENTRIES - 1UL);
+        g_sTraceBuf.au32Rec[u32Idx][0] = u32Stamp;
+        g_sTraceBuf.au32Rec[u32Idx][1] = u32Desc;
+        g_sTraceBuf.u32Head++;
+    }
+
+    if ((u32Backend & TRACE_BACKEND_ITM) &&
+            (ITM->TCR & ITM_TCR_ITMENA_Msk) &&
+            (ITM->TER & (1UL << TRACE_ITM_PORT)))
+    {
+        while (ITM->PORT[TRACE_ITM_PORT].u32 == 0UL)
+        {
+        }
+        ITM->PORT[TRACE_ITM_PORT].u32 = u32Stamp;
+        while (ITM->PORT[TRACE_ITM_PORT].u32 == 0UL)
+        {
+        }
+        ITM->PORT[TRACE_ITM_PORT].u32 = u32Desc;
+    }
+
+    __set_PRIMASK(u32PriMask);
+}
+
+/*@}*/ /* end of group TRACE_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group TRACE_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#endif /* TRACE_ENABLE */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
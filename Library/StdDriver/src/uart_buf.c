@@ -0,0 +1,605 @@
+/**************************************************************************//**
+ * @file     uart_buf.c
+ * @version  V1.00
+ * @brief    M480 series buffered UART and USCI UART driver source file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "pdma_mgr.h"
+#include "uart_buf.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup UARTB_Driver Buffered UART Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define UARTB_RX_CTL        (PDMA_OP_SCATTER | PDMA_REQ_SINGLE | PDMA_TBINTDIS_ENABLE | PDMA_SAR_FIX | PDMA_DAR_INC | PDMA_WIDTH_8)
+#define UARTB_TX_CTL        (PDMA_OP_BASIC | PDMA_REQ_SINGLE | PDMA_DSCT_CTL_TBINTDIS_Msk | PDMA_SAR_INC | PDMA_DAR_FIX | PDMA_WIDTH_8)
+#define UARTB_MAX_XFER      0x10000UL
+#define UARTB_MARK_MASK     (UARTB_MAX_FRAMES - 1UL)
+#define UARTB_USCI_MIN_IDLE 12UL        /* The USCI time-out is armed at a start bit, a character before the first request */
+
+#define UARTB_UART_RX_INT   (UART_INTEN_RXTOIEN_Msk | UART_INTEN_TOCNTEN_Msk | UART_INTEN_RLSIEN_Msk | \
+                             UART_INTEN_BUFERRIEN_Msk | UART_INTEN_RXPDMAEN_Msk)
+#define UARTB_UART_LINE_ERR (UART_FIFOSTS_BIF_Msk | UART_FIFOSTS_FEF_Msk | UART_FIFOSTS_PEF_Msk)
+#define UARTB_UUART_LINE_ERR (UUART_PROTSTS_BREAK_Msk | UUART_PROTSTS_FRMERR_Msk | UUART_PROTSTS_PARITYERR_Msk)
+
+/* Bytes received, free running. Never below an earlier result; when the completion of a half is
+   not served yet only that half counts. */
+static uint32_t UARTB_RxHead(UARTB_T *psPort)
+{
+    uint32_t u32Half = psPort->u32Size >> 1, u32Left, u32Head, u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (PDMA->TDSTS & (1UL << psPort->u32RxCh))
+        u32Head = psPort->u32RxBase + u32Half;
+    else
+    {
+        u32Left = ((PDMA->DSCT[psPort->u32RxCh].CTL & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos) + 1UL;
+        u32Head = psPort->u32RxBase + u32Half - ((u32Left > u32Half) ? u32Half : u32Left);
+    }
+
+    if ((int32_t)(u32Head - psPort->u32RxHead) > 0)
+        psPort->u32RxHead = u32Head;
+
+    u32Head = psPort->u32RxHead;
+    __set_PRIMASK(u32PriMask);
+
+    return u32Head;
+}
+
+/* Bytes received and not consumed. Data overwritten before it was consumed is dropped with the
+   frame ends behind it. */
+static uint32_t UARTB_RxPending(UARTB_T *psPort)
+{
+    uint32_t u32Len = UARTB_RxHead(psPort) - psPort->u32RxTail;
+
+    if (u32Len > psPort->u32Size)
+    {
+        psPort->u32RxTail += u32Len;
+        psPort->u32TailOff = (psPort->u32TailOff + u32Len) % psPort->u32Size;
+        psPort->u32MarkOut = psPort->u32MarkIn;
+        psPort->sStats.u32Overruns++;
+        u32Len = 0UL;
+    }
+
+    return u32Len;
+}
+
+static uint32_t UARTB_Span(const UARTB_T *psPort, uint32_t u32Len, UARTB_SPAN_T *psSpan)
+{
+    uint32_t u32First = psPort->u32Size - psPort->u32TailOff;
+
+    psSpan->pu8Data = &psPort->pu8Ring[psPort->u32TailOff];
+
+    if (u32Len > u32First)
+    {
+        psSpan->u32Len = u32First;
+        psSpan->pu8Wrap = psPort->pu8Ring;
+        psSpan->u32WrapLen = u32Len - u32First;
+    }
+    else
+    {
+        psSpan->u32Len = u32Len;
+        psSpan->pu8Wrap = NULL;
+        psSpan->u32WrapLen = 0UL;
+    }
+
+    return u32Len;
+}
+
+/* Called from the interrupt handlers when the line went idle */
+static void UARTB_MarkFrame(UARTB_T *psPort)
+{
+    uint32_t u32Head = UARTB_RxHead(psPort), u32In = psPort->u32MarkIn;
+
+    /* Nothing arrived since the last frame end */
+    if (u32Head == psPort->au32Mark[(u32In - 1UL) & UARTB_MARK_MASK])
+        return;
+
+    if ((u32In - psPort->u32MarkOut) >= UARTB_MAX_FRAMES)
+    {
+        /* Extend the newest frame instead */
+        u32In--;
+        psPort->sStats.u32FrameMerges++;
+    }
+
+    psPort->au32Mark[u32In & UARTB_MARK_MASK] = u32Head;
+    psPort->u32MarkIn = u32In + 1UL;
+    psPort->sStats.u32Frames++;
+
+    if (psPort->pfnRx != NULL)
+        psPort->pfnRx(psPort->pvRxArg, UARTB_EVT_FRAME);
+}
+
+/* Start the next part of psPort->psTxHead. Called with interrupts masked or from UARTB_PdmaHandler(). */
+static void UARTB_TxStart(UARTB_T *psPort)
+{
+    UARTB_TX_T *psTx = psPort->psTxHead;
+    uint32_t u32Len = psTx->u32Len - psPort->u32TxOff;
+
+    if (u32Len > UARTB_MAX_XFER)
+        u32Len = UARTB_MAX_XFER;
+
+    psPort->u32TxPart = u32Len;
+    PDMA->DSCT[psPort->u32TxCh].SA = (uint32_t)&psTx->pu8Data[psPort->u32TxOff];
+
+    if (psPort->psUart != NULL)
+    {
+        PDMA->DSCT[psPort->u32TxCh].DA = (uint32_t)&psPort->psUart->DAT;
+        PDMA->DSCT[psPort->u32TxCh].CTL = UARTB_TX_CTL | ((u32Len - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos);
+        psPort->psUart->INTEN |= UART_INTEN_TXPDMAEN_Msk;
+    }
+    else
+    {
+        PDMA->DSCT[psPort->u32TxCh].DA = (uint32_t)&psPort->psUuart->TXDAT;
+        PDMA->DSCT[psPort->u32TxCh].CTL = UARTB_TX_CTL | ((u32Len - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos);
+        psPort->psUuart->PDMACTL |= UUART_PDMACTL_TXPDMAEN_Msk;
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief      Open a buffered port
+  * @param[out] psPort      Port state, kept by the caller until UARTB_Close(), within 64 KB above
+  *                         PDMA->SCATBA
+  * @param[in]  u32Port     UARTB_PORT_UART0 ~ UARTB_PORT_UART5, UARTB_PORT_USCI0 or UARTB_PORT_USCI1
+  * @param[in]  pu8Ring     Circular receive buffer
+  * @param[in]  u32Size     Its size in bytes, even, 4 ~ 131072
+  * @param[in]  u32IdleBits Idle bit times that end a frame, 1 ~ 255 on a UART, at least 12 on USCI
+  * @param[in]  pfnRx       Receive event callback, NULL for none
+  * @param[in]  pvArg       Passed to pfnRx
+  * @retval     UARTB_OK        Success
+  * @retval     UARTB_ERR_PARAM Invalid argument
+  * @retval     UARTB_ERR_PDMA  No suitable PDMA channels free; USCI ports need channel 0 or 1
+  * @retval     UARTB_ERR_DESC  psPort is out of reach of PDMA->SCATBA
+  * @details    The controller must already be opened with UART_Open() or UUART_Open(), clocked
+  *             and pinned; its baud rate must not change while the port is open. Reception starts
+  *             here. Each half of the buffer must take longer to fill than the PDMA interrupt
+  *             latency, and the application must consume data within a buffer's worth of time.
+  *             Give the port's interrupt and the PDMA interrupt the same priority.
+  */
+int32_t UARTB_Open(UARTB_T *psPort, uint32_t u32Port, uint8_t *pu8Ring, uint32_t u32Size, uint32_t u32IdleBits,
+                   UARTB_RX_FUNC pfnRx, void *pvArg)
+{
+    static UART_T *const s_apsUart[] = {UART0, UART1, UART2, UART3, UART4, UART5};
+    static const IRQn_Type s_aeIrq[] = {UART0_IRQn, UART1_IRQn, UART2_IRQn, UART3_IRQn, UART4_IRQn, UART5_IRQn,
+                                        USCI0_IRQn, USCI1_IRQn
+                                       };
+    uint32_t i, u32Half = u32Size >> 1, u32Req, u32RxMask, u32Data, u32Brg, u32Baud, u32Ticks;
+    int32_t i32Tx, i32Rx;
+
+    if ((psPort == NULL) || (u32Port > UARTB_PORT_USCI1) || (pu8Ring == NULL) || (u32Size & 1UL) ||
+            (u32Half < 2UL) || (u32Half > UARTB_MAX_XFER) || (u32IdleBits == 0UL) ||
+            ((u32Port < UARTB_PORT_USCI0) && (u32IdleBits > (UART_TOUT_TOIC_Msk >> UART_TOUT_TOIC_Pos))))
+        return UARTB_ERR_PARAM;
+
+    if (((uint32_t)&psPort->asDesc[1] - PDMA->SCATBA) > 0xFFFFUL)
+        return UARTB_ERR_DESC;
+
+    /* Receive at high priority. Only channels 0 and 1 have the request time-out USCI needs. */
+    if (u32Port >= UARTB_PORT_USCI0)
+        i32Rx = PDMAMGR_Alloc(PDMAMGR_TOUT_CH, PDMAMGR_PRIO_HIGH);
+    else
+    {
+        i32Rx = PDMAMGR_Alloc(PDMAMGR_ALL_CH & ~PDMAMGR_TOUT_CH, PDMAMGR_PRIO_HIGH);
+
+        if (i32Rx < 0)
+            i32Rx = PDMAMGR_Alloc(PDMAMGR_ALL_CH, PDMAMGR_PRIO_HIGH);
+    }
+
+    if (i32Rx < 0)
+        return UARTB_ERR_PDMA;
+
+    i32Tx = PDMAMGR_Alloc(PDMAMGR_ALL_CH, PDMAMGR_PRIO_NORMAL);
+
+    if (i32Tx < 0)
+    {
+        PDMAMGR_Free((uint32_t)i32Rx);
+        return UARTB_ERR_PDMA;
+    }
+
+    memset(psPort, 0, sizeof(UARTB_T));
+    psPort->u32TxCh = (uint32_t)i32Tx;
+    psPort->u32RxCh = (uint32_t)i32Rx;
+    psPort->pu8Ring = pu8Ring;
+    psPort->u32Size = u32Size;
+    psPort->pfnRx = pfnRx;
+    psPort->pvRxArg = pvArg;
+    u32RxMask = 1UL << psPort->u32RxCh;
+
+    if (u32Port >= UARTB_PORT_USCI0)
+    {
+        psPort->psUuart = (u32Port == UARTB_PORT_USCI0) ? UUART0 : UUART1;
+        u32Data = (uint32_t)&psPort->psUuart->RXDAT;
+    }
+    else
+    {
+        psPort->psUart = s_apsUart[u32Port];
+        u32Data = (uint32_t)&psPort->psUart->DAT;
+    }
+
+    /* The two halves of the buffer, linked in a loop; the end of each raises an interrupt */
+    for (i = 0UL; i < 2UL; i++)
+    {
+        psPort->asDesc[i].CTL = UARTB_RX_CTL | ((u32Half - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos);
+        psPort->asDesc[i].SA = u32Data;
+        psPort->asDesc[i].DA = (uint32_t)&pu8Ring[i * u32Half];
+        psPort->asDesc[i].NEXT = (uint32_t)&psPort->asDesc[i ^ 1UL] - PDMA->SCATBA;
+    }
+
+    /* UARTn_TX/RX are requests 4 ~ 15 and USCIn_TX/RX 16 ~ 19, in pairs */
+    u32Req = PDMA_UART0_TX + (u32Port << 1);
+
+    PDMA_Open(PDMA, (1UL << psPort->u32TxCh) | u32RxMask);
+    PDMA_SetTransferMode(PDMA, psPort->u32TxCh, u32Req, FALSE, 0UL);
+    PDMA_SetTransferMode(PDMA, psPort->u32RxCh, u32Req + 1UL, TRUE, (uint32_t)&psPort->asDesc[0]);
+    /* Until the first table is fetched the channel shows a whole half left, as UARTB_RxHead() expects */
+    PDMA->DSCT[psPort->u32RxCh].CTL |= (u32Half - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos;
+    PDMA_CLR_TD_FLAG(PDMA, (1UL << psPort->u32TxCh) | u32RxMask);
+    PDMA_EnableInt(PDMA, psPort->u32TxCh, PDMA_INT_TRANS_DONE);
+    PDMA_EnableInt(PDMA, psPort->u32RxCh, PDMA_INT_TRANS_DONE);
+
+    if (psPort->psUuart != NULL)
+    {
+        /* Idle time in PDMA time-out clocks of HCLK/256 */
+        u32Brg = psPort->psUuart->BRGEN;
+        u32Baud = ((u32Port == UARTB_PORT_USCI0) ? CLK_GetPCLK0Freq() : CLK_GetPCLK1Freq()) /
+                  ((((u32Brg & UUART_BRGEN_CLKDIV_Msk) >> UUART_BRGEN_CLKDIV_Pos) + 1UL) *
+                   (((u32Brg & UUART_BRGEN_DSCNT_Msk) >> UUART_BRGEN_DSCNT_Pos) + 1UL) *
+                   (((u32Brg & UUART_BRGEN_PDSCNT_Msk) >> UUART_BRGEN_PDSCNT_Pos) + 1UL));
+
+        if (u32IdleBits < UARTB_USCI_MIN_IDLE)
+            u32IdleBits = UARTB_USCI_MIN_IDLE;
+
+        u32Ticks = (u32IdleBits * (SystemCoreClock >> 8)) / u32Baud;
+
+        if (u32Ticks == 0UL)
+            u32Ticks = 1UL;
+        else if (u32Ticks > 0xFFFFUL)
+            u32Ticks = 0xFFFFUL;
+
+        PDMA->TOUTPSC &= ~(PDMA_TOUTPSC_TOUTPSC0_Msk << (psPort->u32RxCh * PDMA_TOUTPSC_TOUTPSC1_Pos));
+        PDMA_SetTimeOut(PDMA, psPort->u32RxCh, TRUE, u32Ticks);
+        PDMA->INTSTS = PDMA_INTSTS_REQTOF0_Msk << psPort->u32RxCh;
+        PDMA_EnableInt(PDMA, psPort->u32RxCh, PDMA_INT_TIMEOUT);
+        PDMA->TOUTEN |= u32RxMask;
+
+        psPort->psUuart->PROTSTS = UARTB_UUART_LINE_ERR | UUART_PROTSTS_RXSTIF_Msk;
+        psPort->psUuart->BUFSTS = UUART_BUFSTS_RXOVIF_Msk;
+        psPort->psUuart->PROTIEN |= UUART_PROTIEN_RLSIEN_Msk;
+        psPort->psUuart->BUFCTL |= UUART_BUFCTL_RXOVIEN_Msk;
+        psPort->psUuart->PDMACTL = UUART_PDMACTL_PDMAEN_Msk | UUART_PDMACTL_RXPDMAEN_Msk;
+    }
+    else
+    {
+        psPort->psUart->TOUT = (psPort->psUart->TOUT & ~UART_TOUT_TOIC_Msk) | (u32IdleBits << UART_TOUT_TOIC_Pos);
+        psPort->psUart->FIFOSTS = UARTB_UART_LINE_ERR | UART_FIFOSTS_RXOVIF_Msk;
+        psPort->psUart->INTEN |= UARTB_UART_RX_INT;
+    }
+
+    NVIC_EnableIRQ(PDMA_IRQn);
+    NVIC_EnableIRQ(s_aeIrq[u32Port]);
+
+    return UARTB_OK;
+}
+
+/**
+  * @brief      Close a buffered port
+  * @param[in]  psPort  Port state
+  * @return     None
+  * @details    Stops reception, abandons the running transmit buffer and drops the queued ones
+  *             without callbacks, and returns the PDMA channels.
+  */
+void UARTB_Close(UARTB_T *psPort)
+{
+    UARTB_TX_T *psTx;
+    uint32_t u32RxMask = 1UL << psPort->u32RxCh, u32PriMask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (psPort->psUuart != NULL)
+    {
+        psPort->psUuart->PDMACTL = 0UL;
+        psPort->psUuart->INTEN &= ~UUART_INTEN_RXSTIEN_Msk;
+        psPort->psUuart->PROTIEN &= ~UUART_PROTIEN_RLSIEN_Msk;
+        psPort->psUuart->BUFCTL &= ~UUART_BUFCTL_RXOVIEN_Msk;
+        PDMA->TOUTEN &= ~u32RxMask;
+        PDMA_DisableInt(PDMA, psPort->u32RxCh, PDMA_INT_TIMEOUT);
+        PDMA->INTSTS = PDMA_INTSTS_REQTOF0_Msk << psPort->u32RxCh;
+    }
+    else
+        psPort->psUart->INTEN &= ~(UARTB_UART_RX_INT | UART_INTEN_TXPDMAEN_Msk);
+
+    PDMA->INTEN &= ~((1UL << psPort->u32TxCh) | u32RxMask);
+    PDMAMGR_Free(psPort->u32TxCh);
+    PDMAMGR_Free(psPort->u32RxCh);
+
+    for (psTx = psPort->psTxHead; psTx != NULL; psTx = psTx->psQNext)
+        psTx->u32Queued = 0UL;
+
+    psPort->psTxHead = NULL;
+    psPort->psTxTail = NULL;
+
+    __set_PRIMASK(u32PriMask);
+}
+
+/**
+  * @brief      Look at the received data
+  * @param[in]  psPort  Port state
+  * @param[out] psSpan  Received bytes not consumed yet, in place in the receive buffer
+  * @return     Number of bytes, 0 if none
+  * @details    The data stays valid until it is consumed or overwritten; UARTB_RxConsume()
+  *             tells which.
+  */
+uint32_t UARTB_RxPeek(UARTB_T *psPort, UARTB_SPAN_T *psSpan)
+{
+    return UARTB_Span(psPort, UARTB_RxPending(psPort), psSpan);
+}
+
+/**
+  * @brief      Look at the next complete frame
+  * @param[in]  psPort  Port state
+  * @param[out] psSpan  Bytes up to the next frame end, in place in the receive buffer
+  * @return     Frame length, 0 if no frame has ended
+  * @details    A frame starts at the first byte not consumed yet. Consume it, or part of it,
+  *             with UARTB_RxConsume().
+  */
+uint32_t UARTB_RxPeekFrame(UARTB_T *psPort, UARTB_SPAN_T *psSpan)
+{
+    uint32_t u32Len;
+
+    (void)UARTB_RxPending(psPort);
+
+    while (psPort->u32MarkOut != psPort->u32MarkIn)
+    {
+        u32Len = psPort->au32Mark[psPort->u32MarkOut & UARTB_MARK_MASK] - psPort->u32RxTail;
+
+        if ((int32_t)u32Len > 0)
+            return UARTB_Span(psPort, u32Len, psSpan);
+
+        psPort->u32MarkOut++;
+    }
+
+    return UARTB_Span(psPort, 0UL, psSpan);
+}
+
+/**
+  * @brief      Release received data
+  * @param[in]  psPort  Port state
+  * @param[in]  u32Len  Bytes to release, from the start of the last span
+  * @retval     UARTB_OK            Released
+  * @retval     UARTB_ERR_PARAM     More bytes than were received
+  * @retval     UARTB_ERR_OVERRUN   The data was overwritten while it was held; it has been
+  *                                 dropped and anything read from the span is invalid
+  */
+int32_t UARTB_RxConsume(UARTB_T *psPort, uint32_t u32Len)
+{
+    uint32_t u32Overruns = psPort->sStats.u32Overruns, u32Pending = UARTB_RxPending(psPort);
+
+    if (psPort->sStats.u32Overruns != u32Overruns)
+        return UARTB_ERR_OVERRUN;
+
+    if (u32Len > u32Pending)
+        return UARTB_ERR_PARAM;
+
+    psPort->u32RxTail += u32Len;
+    psPort->u32TailOff += u32Len;
+
+    if (psPort->u32TailOff >= psPort->u32Size)
+        psPort->u32TailOff -= psPort->u32Size;
+
+    psPort->sStats.u32RxBytes += u32Len;
+
+    while ((psPort->u32MarkOut != psPort->u32MarkIn) &&
+            ((int32_t)(psPort->au32Mark[psPort->u32MarkOut & UARTB_MARK_MASK] - psPort->u32RxTail) <= 0))
+        psPort->u32MarkOut++;
+
+    return UARTB_OK;
+}
+
+/**
+  * @brief      Queue a transmit buffer
+  * @param[in]  psPort  Port state
+  * @param[in]  psTx    Buffer
+  * @retval     UARTB_OK        Queued
+  * @retval     UARTB_ERR_PARAM Invalid buffer
+  * @retval     UARTB_ERR_BUSY  The buffer is still queued
+  * @details    May be called from interrupt handlers, including a callback. Buffers are sent in
+  *             order without gaps other than the PDMA interrupt latency.
+  */
+int32_t UARTB_Send(UARTB_T *psPort, UARTB_TX_T *psTx)
+{
+    uint32_t u32PriMask;
+
+    if ((psTx == NULL) || (psTx->pu8Data == NULL) || (psTx->u32Len == 0UL))
+        return UARTB_ERR_PARAM;
+
+    if (psTx->u32Queued)
+        return UARTB_ERR_BUSY;
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+
+    psTx->psQNext = NULL;
+    psTx->u32Queued = 1UL;
+
+    if (psPort->psTxTail != NULL)
+        psPort->psTxTail->psQNext = psTx;
+    else
+    {
+        psPort->psTxHead = psTx;
+        psPort->u32TxOff = 0UL;
+        UARTB_TxStart(psPort);
+    }
+
+    psPort->psTxTail = psTx;
+    __set_PRIMASK(u32PriMask);
+
+    return UARTB_OK;
+}
+
+/**
+  * @brief      Check the transmit queue
+  * @param[in]  psPort  Port state
+  * @return     1 if no buffer is queued or being sent
+  * @details    The last bytes may still be in the transmit FIFO.
+  */
+uint32_t UARTB_IsTxIdle(const UARTB_T *psPort)
+{
+    return (psPort->psTxHead == NULL) ? 1UL : 0UL;
+}
+
+/**
+  * @brief      UART or USCI interrupt service
+  * @param[in]  psPort  Port state
+  * @return     None
+  * @details    Call from the UARTn_IRQHandler() or USCIn_IRQHandler() of the port. Ends a frame
+  *             on the receive time-out and counts line errors and FIFO overruns.
+  */
+void UARTB_IRQHandler(UARTB_T *psPort)
+{
+    UART_T *uart = psPort->psUart;
+    UUART_T *uuart = psPort->psUuart;
+    uint32_t u32Sts, u32Err;
+
+    if (uart != NULL)
+    {
+        u32Sts = uart->INTSTS;
+
+        if (u32Sts & (UART_INTSTS_HWRLSIF_Msk | UART_INTSTS_RLSIF_Msk))
+        {
+            u32Err = uart->FIFOSTS & UARTB_UART_LINE_ERR;
+
+            if (u32Err)
+            {
+                psPort->sStats.u32LineErrors++;
+                uart->FIFOSTS = u32Err;
+            }
+        }
+
+        if (u32Sts & (UART_INTSTS_HWBUFEIF_Msk | UART_INTSTS_BUFERRIF_Msk))
+        {
+            psPort->sStats.u32FifoOverruns++;
+            uart->FIFOSTS = UART_FIFOSTS_RXOVIF_Msk;
+        }
+
+        if (u32Sts & (UART_INTSTS_HWTOIF_Msk | UART_INTSTS_RXTOIF_Msk))
+            UARTB_MarkFrame(psPort);
+    }
+    else if (uuart != NULL)
+    {
+        u32Sts = uuart->PROTSTS;
+        u32Err = u32Sts & UARTB_UUART_LINE_ERR;
+
+        if (u32Err)
+        {
+            psPort->sStats.u32LineErrors++;
+            uuart->PROTSTS = u32Err;
+        }
+
+        if (uuart->BUFSTS & UUART_BUFSTS_RXOVIF_Msk)
+        {
+            psPort->sStats.u32FifoOverruns++;
+            uuart->BUFSTS = UUART_BUFSTS_RXOVIF_Msk;
+        }
+
+        /* A new frame starts: time the idle line again */
+        if ((u32Sts & UUART_PROTSTS_RXSTIF_Msk) && (uuart->INTEN & UUART_INTEN_RXSTIEN_Msk))
+        {
+            uuart->INTEN &= ~UUART_INTEN_RXSTIEN_Msk;
+            uuart->PROTSTS = UUART_PROTSTS_RXSTIF_Msk;
+            PDMA->TOUTEN |= 1UL << psPort->u32RxCh;
+        }
+    }
+}
+
+/**
+  * @brief      PDMA interrupt service
+  * @param[in]  psPort  Port state
+  * @return     None
+  * @details    Call from PDMA_IRQHandler(). Tracks the receive buffer, ends a frame on the USCI
+  *             request time-out, and starts the next transmit buffer before calling the callback
+  *             of the finished one.
+  */
+void UARTB_PdmaHandler(UARTB_T *psPort)
+{
+    UARTB_TX_T *psTx;
+    uint32_t u32RxMask = 1UL << psPort->u32RxCh, u32TxMask = 1UL << psPort->u32TxCh, u32Sts = PDMA->INTSTS;
+
+    if ((psPort->psUuart != NULL) && (u32Sts & (PDMA_INTSTS_REQTOF0_Msk << psPort->u32RxCh)))
+    {
+        /* Stop timing until the next start bit, or an idle line would interrupt at this rate */
+        PDMA->TOUTEN &= ~u32RxMask;
+        PDMA->INTSTS = PDMA_INTSTS_REQTOF0_Msk << psPort->u32RxCh;
+        psPort->psUuart->PROTSTS = UUART_PROTSTS_RXSTIF_Msk;
+        psPort->psUuart->INTEN |= UUART_INTEN_RXSTIEN_Msk;
+        UARTB_MarkFrame(psPort);
+    }
+
+    if ((u32Sts & PDMA_INTSTS_TDIF_Msk) == 0UL)
+        return;
+
+    if (PDMA->TDSTS & u32RxMask)
+    {
+        /* Flag first: UARTB_RxHead() must not count the half twice */
+        PDMA_CLR_TD_FLAG(PDMA, u32RxMask);
+        psPort->u32RxBase += psPort->u32Size >> 1;
+
+        if (psPort->pfnRx != NULL)
+            psPort->pfnRx(psPort->pvRxArg, UARTB_EVT_DATA);
+    }
+
+    psTx = psPort->psTxHead;
+
+    if ((psTx == NULL) || ((PDMA->TDSTS & u32TxMask) == 0UL))
+        return;
+
+    PDMA_CLR_TD_FLAG(PDMA, u32TxMask);
+    psPort->u32TxOff += psPort->u32TxPart;
+    psPort->sStats.u32TxBytes += psPort->u32TxPart;
+
+    /* Longer than one PDMA transfer */
+    if (psPort->u32TxOff < psTx->u32Len)
+    {
+        UARTB_TxStart(psPort);
+        return;
+    }
+
+    psPort->psTxHead = psTx->psQNext;
+    psPort->u32TxOff = 0UL;
+
+    if (psPort->psTxHead != NULL)
+        UARTB_TxStart(psPort);
+    else
+    {
+        psPort->psTxTail = NULL;
+
+        if (psPort->psUart != NULL)
+            psPort->psUart->INTEN &= ~UART_INTEN_TXPDMAEN_Msk;
+        else
+            psPort->psUuart->PDMACTL &= ~UUART_PDMACTL_TXPDMAEN_Msk;
+    }
+
+    psTx->u32Queued = 0UL;
+    psPort->sStats.u32TxBufs++;
+
+    if (psTx->pfnDone != NULL)
+        psTx->pfnDone(psTx->pvArg, psTx);
+}
+
+/*@}*/ /* end of group UARTB_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
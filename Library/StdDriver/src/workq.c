@@ -0,0 +1,470 @@
+/**************************************************************************//**
+ * @file     workq.c
+ * @version  V1.00
+ * @brief    M480 series deferred interrupt work queue source file
+ *
+ * @details  Interrupt handlers post small work items (function, argument,
+ *           parameter) with WORKQ_Post() instead of running protocol work
+ *           inline. Each priority level owns a bounded ring that any number
+ *           of interrupts may post to without disabling interrupts
+ *           (LDREX/STREX slot reservation with per-slot sequence numbers).
+ *           Every ring has exactly one consumer: a FreeRTOS task per level
+ *           when WORKQ_USE_FREERTOS is 1, otherwise WORKQ_Poll() called
+ *           from the main loop. Handlers never take work from another level.
+ *
+ *           Post time is stamped with the DWT cycle counter, so the latency
+ *           until the work function starts and its run time are recorded
+ *           per source in a log2 microsecond histogram.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#if defined(WORKQ_USE_FREERTOS) && WORKQ_USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+#include "workq.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup WORKQ_Driver WORKQ Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#if (WORKQ_RING_SIZE & (WORKQ_RING_SIZE - 1)) != 0
+#error "WORKQ_RING_SIZE must be a power of 2"
+#endif
+
+typedef struct
+{
+    volatile uint32_t u32Seq;       /* == position: free, == position + 1: holds an item */
+    WORKQ_FUNC_T *pfnFunc;
+    void *pvArg;
+    uint32_t u32Param;
+    int32_t i32Src;
+    uint32_t u32Stamp;              /* DWT->CYCCNT at post time */
+} WORKQ_SLOT_T;
+
+typedef struct
+{
+    volatile uint32_t u32Head;      /* next position to post, shared by all producers */
+    volatile uint32_t u32Tail;      /* next position to run, owned by the consumer */
+    volatile uint32_t u32Done;      /* work functions that have returned */
+    WORKQ_SLOT_T asSlot[WORKQ_RING_SIZE];
+} WORKQ_RING_T;
+
+static WORKQ_RING_T s_asRing[WORKQ_PRIO_NUM];
+static WORKQ_SRC_STATS_T s_asSrc[WORKQ_SRC_NUM];
+static volatile uint32_t s_u32SrcNum;
+static uint32_t s_u32CyclesPerUs;
+
+#if WORKQ_USE_FREERTOS
+static TaskHandle_t s_ahTask[WORKQ_PRIO_NUM];
+#endif
+
+static void WORKQ_AtomicInc(volatile uint32_t *pu32Cnt)
+{
+    do
+    {
+    }
+    while (__STREXW(__LDREXW(pu32Cnt) + 1UL, pu32Cnt) != 0UL);
+}
+
+static void WORKQ_Account(int32_t i32Src, uint32_t u32LatCycles, uint32_t u32RunCycles)
+{
+    WORKQ_SRC_STATS_T *psSrc;
+    uint32_t u32LatUs, u32RunUs, u32Bin;
+
+    if (i32Src < 0)
+        return;
+
+    psSrc = &s_asSrc[i32Src];
+    u32LatUs = u32LatCycles / s_u32CyclesPerUs;
+    u32RunUs = u32RunCycles / s_u32CyclesPerUs;
+
+    /* bin 0: < 1 us, bin n: [2^(n-1), 2^n) us, last bin collects the rest */
+    u32Bin = 32UL - __CLZ(u32LatUs);
+    if (u32Bin >= WORKQ_HIST_BINS)
+        u32Bin = WORKQ_HIST_BINS - 1UL;
+    WORKQ_AtomicInc(&psSrc->au32Hist[u32Bin]);
+
+    if (u32LatUs > psSrc->u32MaxLatencyUs)
+        psSrc->u32MaxLatencyUs = u32LatUs;
+    if (u32RunUs > psSrc->u32MaxRunUs)
+        psSrc->u32MaxRunUs = u32RunUs;
+}
+
+/* Run the oldest item of a ring. Returns 0 if the ring is empty. Only the one consumer of the ring may call this. */
+static uint32_t WORKQ_RunOne(WORKQ_RING_T *psRing)
+{
+    WORKQ_SLOT_T *psSlot;
+    WORKQ_FUNC_T *pfnFunc;
+    void *pvArg;
+    uint32_t u32Pos, u32Param, u32Stamp, u32Start;
+    int32_t i32Src;
+
+    u32Pos = psRing->u32Tail;
+    psSlot = &psRing->asSlot[u32Pos & (WORKQ_RING_SIZE - 1UL)];
+
+    /* empty, or the producer that reserved this slot has not finished writing it yet (it will notify again) */
+    if (psSlot->u32Seq != u32Pos + 1UL)
+        return 0UL;
+    __DMB();
+
+    pfnFunc = psSlot->pfnFunc;
+    pvArg = psSlot->pvArg;
+    u32Param = psSlot->u32Param;
+    i32Src = psSlot->i32Src;
+    u32Stamp = psSlot->u32Stamp;
+
+    /* hand the slot back before running, work functions may post again */
+    __DMB();
+    psSlot->u32Seq = u32Pos + WORKQ_RING_SIZE;
+    psRing->u32Tail = u32Pos + 1UL;
+
+    u32Start = DWT->CYCCNT;
+    pfnFunc(pvArg, u32Param);
+    WORKQ_Account(i32Src, u32Start - u32Stamp, DWT->CYCCNT - u32Start);
+    psRing->u32Done++;
+
+    return 1UL;
+}
+
+#if WORKQ_USE_FREERTOS
+static void WORKQ_Task(void *pvParameters)
+{
+    WORKQ_RING_T *psRing = (WORKQ_RING_T *)pvParameters;
+
+    for (;;)
+    {
+        while (WORKQ_RunOne(psRing) != 0UL)
+        {
+        }
+        (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+#endif
+
+/// @endcond HIDDEN_SYMBOLS
+
+/** @addtogroup WORKQ_EXPORTED_FUNCTIONS WORKQ Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Initialize the work queue
+  *
+  * @param      None
+  *
+  * @retval     WORKQ_OK        Success
+  *
+  * @details    Empties all rings, clears all sources and starts the DWT cycle counter used for latency
+  *             measurement. Must be called before any interrupt that posts work is enabled.
+  */
+int32_t WORKQ_Init(void)
+{
+    uint32_t i, j;
+
+    for (i = 0UL; i < WORKQ_PRIO_NUM; i++)
+    {
+        s_asRing[i].u32Head = 0UL;
+        s_asRing[i].u32Tail = 0UL;
+        s_asRing[i].u32Done = 0UL;
+        for (j = 0UL; j < WORKQ_RING_SIZE; j++)
+            s_asRing[i].asSlot[j].u32Seq = j;
+    }
+
+    memset(s_asSrc, 0, sizeof(s_asSrc));
+    s_u32SrcNum = 0UL;
+
+    s_u32CyclesPerUs = SystemCoreClock / 1000000UL;
+    if (s_u32CyclesPerUs == 0UL)
+        s_u32CyclesPerUs = 1UL;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    return WORKQ_OK;
+}
+
+/**
+  * @brief      Register a work source
+  *
+  * @param[in]  pcName      Name reported in the statistics. The string is not copied.
+  *
+  * @return     Source index to pass to WORKQ_Post(), or WORKQ_ERR_NO_SRC if all WORKQ_SRC_NUM sources are used.
+  *
+  * @details    Call from thread context during initialization. Each interrupt should use its own source so
+  *             its latency can be told apart from the others.
+  */
+int32_t WORKQ_AddSource(const char *pcName)
+{
+    uint32_t u32Idx;
+
+    if (s_u32SrcNum >= WORKQ_SRC_NUM)
+        return WORKQ_ERR_NO_SRC;
+
+    u32Idx = s_u32SrcNum++;
+    s_asSrc[u32Idx].pcName = pcName;
+
+    return (int32_t)u32Idx;
+}
+
+/**
+  * @brief      Post a work item
+  *
+  * @param[in]  u32Prio     Priority level, 0 (\ref WORKQ_PRIO_HIGH) to WORKQ_PRIO_NUM - 1 (\ref WORKQ_PRIO_LOW).
+  * @param[in]  i32Src      Source index returned by WORKQ_AddSource(), or -1 to skip the statistics.
+  * @param[in]  pfnFunc     Work function.
+  * @param[in]  pvArg       First argument passed to the work function.
+  * @param[in]  u32Param    Second argument passed to the work function.
+  *
+  * @retval     WORKQ_OK        Item queued
+  * @retval     WORKQ_ERR_FULL  Ring of the level is full, item dropped and counted
+  * @retval     WORKQ_ERR_PARAM Invalid level, source or function
+  *
+  * @details    May be called from any interrupt and from thread context; it never disables interrupts.
+  *             With WORKQ_USE_FREERTOS the posting interrupt must not be above
+  *             configMAX_SYSCALL_INTERRUPT_PRIORITY since the handler task is notified.
+  */
+int32_t WORKQ_Post(uint32_t u32Prio, int32_t i32Src, WORKQ_FUNC_T *pfnFunc, void *pvArg, uint32_t u32Param)
+{
+    WORKQ_RING_T *psRing;
+    WORKQ_SLOT_T *psSlot;
+    uint32_t u32Pos;
+
+    if ((u32Prio >= WORKQ_PRIO_NUM) || (i32Src >= (int32_t)WORKQ_SRC_NUM) || (pfnFunc == NULL))
+        return WORKQ_ERR_PARAM;
+
+    psRing = &s_asRing[u32Prio];
+
+    /* Reserve a slot. Any exception between LDREX and STREX clears the exclusive monitor, so a preempting
+       post makes the STREX fail and the reservation is retried with the new head. */
+    do
+    {
+        u32Pos = __LDREXW(&psRing->u32Head);
+        psSlot = &psRing->asSlot[u32Pos & (WORKQ_RING_SIZE - 1UL)];
+        if (psSlot->u32Seq != u32Pos)
+        {
+            __CLREX();
+            if (i32Src >= 0)
+                WORKQ_AtomicInc(&s_asSrc[i32Src].u32Dropped);
+            return WORKQ_ERR_FULL;
+        }
+    }
+    while (__STREXW(u32Pos + 1UL, &psRing->u32Head) != 0UL);
+
+    psSlot->pfnFunc = pfnFunc;
+    psSlot->pvArg = pvArg;
+    psSlot->u32Param = u32Param;
+    psSlot->i32Src = i32Src;
+    psSlot->u32Stamp = DWT->CYCCNT;
+    __DMB();
+    psSlot->u32Seq = u32Pos + 1UL;
+
+    if (i32Src >= 0)
+        WORKQ_AtomicInc(&s_asSrc[i32Src].u32Posted);
+
+#if WORKQ_USE_FREERTOS
+    if (s_ahTask[u32Prio] != NULL)
+    {
+        if (__get_IPSR() != 0UL)
+        {
+            BaseType_t xWoken = pdFALSE;
+
+            vTaskNotifyGiveFromISR(s_ahTask[u32Prio], &xWoken);
+            portYIELD_FROM_ISR(xWoken);
+        }
+        else
+        {
+            (void)xTaskNotifyGive(s_ahTask[u32Prio]);
+        }
+    }
+#endif
+
+    return WORKQ_OK;
+}
+
+#if WORKQ_USE_FREERTOS
+/**
+  * @brief      Create the handler tasks
+  *
+  * @param      None
+  *
+  * @retval     WORKQ_OK        Success
+  * @retval     WORKQ_ERR_RTOS  A task could not be created
+  *
+  * @details    Creates one task per priority level with priority WORKQ_TASK_PRIO(level). Items posted before
+  *             this call are run once the scheduler starts.
+  */
+int32_t WORKQ_Start(void)
+{
+    static char s_aacName[WORKQ_PRIO_NUM][8];
+    uint32_t i;
+
+    for (i = 0UL; i < WORKQ_PRIO_NUM; i++)
+    {
+        s_aacName[i][0] = 'w';
+        s_aacName[i][1] = 'o';
+        s_aacName[i][2] = 'r';
+        s_aacName[i][3] = 'k';
+        s_aacName[i][4] = 'q';
+        s_aacName[i][5] = (char)('0' + i);
+        s_aacName[i][6] = '\0';
+
+        if (xTaskCreate(WORKQ_Task, s_aacName[i], WORKQ_TASK_STACK, &s_asRing[i],
+                        WORKQ_TASK_PRIO(i), &s_ahTask[i]) != pdPASS)
+            return WORKQ_ERR_RTOS;
+    }
+
+    return WORKQ_OK;
+}
+#else
+/**
+  * @brief      Run queued work items
+  *
+  * @param[in]  u32MaxItems Maximum number of items to run, 0 for no limit.
+  *
+  * @return     Number of items run.
+  *
+  * @details    Bare-metal consumer, call from the main loop only. After every item the most urgent non-empty
+  *             level is picked again, so a burst of low level items cannot delay high level work by more
+  *             than one item.
+  */
+uint32_t WORKQ_Poll(uint32_t u32MaxItems)
+{
+    uint32_t u32Cnt = 0UL, i;
+
+    do
+    {
+        for (i = 0UL; i < WORKQ_PRIO_NUM; i++)
+        {
+            if (WORKQ_RunOne(&s_asRing[i]) != 0UL)
+                break;
+        }
+        if (i == WORKQ_PRIO_NUM)
+            break;
+        u32Cnt++;
+    }
+    while ((u32MaxItems == 0UL) || (u32Cnt < u32MaxItems));
+
+    return u32Cnt;
+}
+#endif
+
+/**
+  * @brief      Wait until posted work has run
+  *
+  * @param[in]  u32Prio     Priority level.
+  *
+  * @retval     WORKQ_OK        All items posted to the level before the call have returned
+  * @retval     WORKQ_ERR_PARAM Invalid level
+  *
+  * @details    Call from thread context before freeing memory that queued items still refer to, e.g. when a
+  *             device is disconnected. When called by the consumer of the level itself (from a work function,
+  *             from the main loop in bare-metal mode or before the scheduler runs) the items are run inline.
+  *             With WORKQ_USE_FREERTOS this needs xTaskGetCurrentTaskHandle() and xTaskGetSchedulerState().
+  */
+int32_t WORKQ_Flush(uint32_t u32Prio)
+{
+    WORKQ_RING_T *psRing;
+    uint32_t u32Target;
+
+    if (u32Prio >= WORKQ_PRIO_NUM)
+        return WORKQ_ERR_PARAM;
+
+    psRing = &s_asRing[u32Prio];
+    u32Target = psRing->u32Head;
+
+#if WORKQ_USE_FREERTOS
+    if ((s_ahTask[u32Prio] != NULL) &&
+            (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) &&
+            (xTaskGetCurrentTaskHandle() != s_ahTask[u32Prio]))
+    {
+        while ((int32_t)(psRing->u32Done - u32Target) < 0)
+            vTaskDelay(1);
+
+        return WORKQ_OK;
+    }
+#endif
+
+    while ((int32_t)(psRing->u32Tail - u32Target) < 0)
+    {
+        if (WORKQ_RunOne(psRing) == 0UL)
+            break;
+    }
+
+    return WORKQ_OK;
+}
+
+/**
+  * @brief      Number of items waiting in a level
+  *
+  * @param[in]  u32Prio     Priority level.
+  *
+  * @return     Items posted but not yet started, 0 for an invalid level.
+  */
+uint32_t WORKQ_GetPending(uint32_t u32Prio)
+{
+    if (u32Prio >= WORKQ_PRIO_NUM)
+        return 0UL;
+
+    return s_asRing[u32Prio].u32Head - s_asRing[u32Prio].u32Tail;
+}
+
+/**
+  * @brief      Read the statistics of a source
+  *
+  * @param[in]  i32Src      Source index returned by WORKQ_AddSource().
+  * @param[out] psStats     Copy of the statistics.
+  *
+  * @retval     WORKQ_OK        Success
+  * @retval     WORKQ_ERR_PARAM Invalid source
+  */
+int32_t WORKQ_GetStats(int32_t i32Src, WORKQ_SRC_STATS_T *psStats)
+{
+    if ((i32Src < 0) || ((uint32_t)i32Src >= s_u32SrcNum) || (psStats == NULL))
+        return WORKQ_ERR_PARAM;
+
+    *psStats = s_asSrc[i32Src];
+
+    return WORKQ_OK;
+}
+
+/**
+  * @brief      Clear the counters and histograms of all sources
+  *
+  * @param      None
+  *
+  * @return     None
+  *
+  * @details    Source registrations are kept. Items that complete while the counters are cleared may be
+  *             counted either way.
+  */
+void WORKQ_ResetStats(void)
+{
+    uint32_t i, j;
+
+    for (i = 0UL; i < s_u32SrcNum; i++)
+    {
+        s_asSrc[i].u32Posted = 0UL;
+        s_asSrc[i].u32Dropped = 0UL;
+        s_asSrc[i].u32MaxLatencyUs = 0UL;
+        s_asSrc[i].u32MaxRunUs = 0UL;
+        for (j = 0UL; j < WORKQ_HIST_BINS; j++)
+            s_asSrc[i].au32Hist[j] = 0UL;
+    }
+}
+
+/*@}*/ /* end of group WORKQ_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group WORKQ_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
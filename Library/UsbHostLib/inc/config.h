@@ -64,6 +64,19 @@
 #define MEM_POOL_UNIT_SIZE     64      /*!< A fixed hard coding setting. Do not change it!            */
 #define MEM_POOL_UNIT_NUM     256      /*!< Increase this or heap size if memory allocate failed.     */
 
+/*----------------------------------------------------------------------------------------*/
+/*   Deferred class driver callbacks                                                      */
+/*----------------------------------------------------------------------------------------*/
+/* Run CDC bulk-in and UAC iso-in completions, including the user callbacks, from the
+   StdDriver work queue (workq.h) instead of the USB interrupt. WORKQ_Init() must be
+   called before usbh_core_init().                                                        */
+//#define USBH_DEFER_CALLBACK
+#define USBH_DEFER_PRIO        0            /* work queue level of the deferred callbacks */
+
+#ifdef USBH_DEFER_CALLBACK
+#include "workq.h"
+#endif
+
 /*----------------------------------------------------------------------------------------*/
 /*   Re-defined staff for various compiler                                                */
 /*----------------------------------------------------------------------------------------*/
@@ -267,29 +267,47 @@ int32_t usbh_cdc_start_polling_status(CDC_DEV_T *cdev, CDC_CB_FUNC *func)
     return 0;
 }
 /// @cond HIDDEN_SYMBOLS
+/*
+ * CDC BULK-in data delivery. rx_busy stays set until the callback returned,
+ * so rx_buff is not reused while the user still reads it.
+ */
+static void  cdc_bulk_in_done(void *arg, uint32_t param)
+{
+    UTR_T       *utr = (UTR_T *)arg;
+    CDC_DEV_T   *cdev = (CDC_DEV_T *)utr->context;
+
+    if (cdev->rx_func)
+        cdev->rx_func(cdev, utr->buff, utr->xfer_len);
+
+    free_utr(utr);
+    cdev->utr_rx = NULL;
+    cdev->rx_busy = 0;
+}
+
+#ifdef USBH_DEFER_CALLBACK
+static int32_t  cdc_workq_src = -1;
+static int      cdc_workq_reg = 0;
+#endif
+
 /*
  * CDC BULK-in complete function
  */
 static void  cdc_bulk_in_irq(UTR_T *utr)
 {
-    CDC_DEV_T   *cdev;
-
     //CDC_DBGMSG("cdc_bulk_in_irq. %d\n", utr->xfer_len);
 
-    cdev = (CDC_DEV_T *)utr->context;
-
     if (utr->status)
     {
         CDC_DBGMSG("cdc_bulk_in_irq - has error: 0x%x\n", utr->status);
         return;
     }
 
-    if (cdev->rx_func)
-        cdev->rx_func(cdev, utr->buff, utr->xfer_len);
-
-    free_utr(utr);
-    cdev->utr_rx = NULL;
-    cdev->rx_busy = 0;
+#ifdef USBH_DEFER_CALLBACK
+    /* run inline only if the work queue level is full */
+    if (WORKQ_Post(USBH_DEFER_PRIO, cdc_workq_src, cdc_bulk_in_done, utr, 0) == WORKQ_OK)
+        return;
+#endif
+    cdc_bulk_in_done(utr, 0);
 }
 
 /// @endcond HIDDEN_SYMBOLS
@@ -314,6 +332,14 @@ int32_t usbh_cdc_start_to_receive_data(CDC_DEV_T *cdev, CDC_CB_FUNC *func)
     if (!func)
         return USBH_ERR_INVALID_PARAM;
 
+#ifdef USBH_DEFER_CALLBACK
+    if (!cdc_workq_reg)
+    {
+        cdc_workq_src = WORKQ_AddSource("USBH CDC bulk-in");
+        cdc_workq_reg = 1;
+    }
+#endif
+
     ep = cdev->ep_rx;
     if (ep == NULL)
     {
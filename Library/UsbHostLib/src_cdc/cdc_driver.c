@@ -224,6 +224,10 @@ static void  cdc_disconnect(IFACE_T *iface)
         }
     }
 
+#ifdef USBH_DEFER_CALLBACK
+    WORKQ_Flush(USBH_DEFER_PRIO);               /* deliver bulk-in data already completed     */
+#endif
+
     if (cdev->utr_sts)
     {
         usbh_quit_utr(cdev->utr_sts);             /* Quit the UTR                               */
@@ -13,6 +13,7 @@
 #include "NuMicro.h"
 
 #include "usb.h"
+#include "trace.h"
 #include "hub.h"
 
 
@@ -960,7 +961,11 @@ static void scan_asynchronous_list()
 
             utr->bIsTransferDone = 1;
             if (utr->func)
+            {
+                TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
                 utr->func(utr);
+                TRACE_END(TRACE_ID_USBH_UTR, 0);
+            }
 
             _ehci->UCMDR |= HSUSBH_UCMDR_IAAD_Msk;   /* trigger IAA to reclaim done_list  */
         }
@@ -1009,7 +1014,11 @@ static void scan_periodic_frame_list()
 
             utr->bIsTransferDone = 1;
             if (utr->func)
+            {
+                TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
                 utr->func(utr);
+                TRACE_END(TRACE_ID_USBH_UTR, 0);
+            }
 
             _ehci->UCMDR |= HSUSBH_UCMDR_IAAD_Msk;   /* trigger IAA to reclaim done_list  */
         }
@@ -1059,7 +1068,11 @@ void iaad_remove_qh()
             utr->status = USBH_ERR_ABORT;
             utr->bIsTransferDone = 1;
             if (utr->func)
+            {
+                TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
                 utr->func(utr);             /* call back                                  */
+                TRACE_END(TRACE_ID_USBH_UTR, 0);
+            }
         }
         free_ehci_QH(qh);                   /* free the QH                                */
     }
@@ -13,6 +13,7 @@
 #include "NuMicro.h"
 
 #include "usb.h"
+#include "trace.h"
 #include "hub.h"
 
 
@@ -107,7 +108,11 @@ static int  review_itd(iTD_T *itd)
     {
         utr->bIsTransferDone = 1;
         if (utr->func)
+        {
+            TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
             utr->func(utr);
+            TRACE_END(TRACE_ID_USBH_UTR, 0);
+        }
     }
 
     return 1;                               /* to be reclaimed                            */
@@ -182,7 +187,11 @@ static int  review_sitd(siTD_T *sitd)
     {
         utr->bIsTransferDone = 1;
         if (utr->func)
+        {
+            TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
             utr->func(utr);
+            TRACE_END(TRACE_ID_USBH_UTR, 0);
+        }
     }
     return 1;                               /* to be reclaimed                            */
 }
@@ -888,7 +897,11 @@ int ehci_quit_iso_xfer(UTR_T *utr, EP_INFO_T *ep)
         {
             utr->bIsTransferDone = 1;
             if (utr->func)
+            {
+                TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
                 utr->func(utr);
+                TRACE_END(TRACE_ID_USBH_UTR, 0);
+            }
             utr->status = USBH_ERR_ABORT;
         }
         free_ehci_iTD(itd);
@@ -13,6 +13,7 @@
 #include "NuMicro.h"
 
 #include "usb.h"
+#include "trace.h"
 #include "hub.h"
 #include "ohci.h"
 
@@ -1015,7 +1016,11 @@ td_out:
     {
         utr->bIsTransferDone = 1;
         if (utr->func)
+        {
+            TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
             utr->func(utr);
+            TRACE_END(TRACE_ID_USBH_UTR, 0);
+        }
     }
 }
 
@@ -1125,7 +1130,11 @@ static void remove_ed()
                         utr->status = USBH_ERR_ABORT;
                         utr->bIsTransferDone = 1;
                         if (utr->func)
+                        {
+                            TRACE_BEGIN(TRACE_ID_USBH_UTR, utr->xfer_len);
                             utr->func(utr);
+                            TRACE_END(TRACE_ID_USBH_UTR, 0);
+                        }
                     }
                 }
             }
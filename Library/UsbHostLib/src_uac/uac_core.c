@@ -501,8 +501,9 @@ int  usbh_uac_find_best_alt(IFACE_T *iface, uint8_t dir, uint8_t attr, int pkt_s
 }
 
 
-static void iso_in_irq(UTR_T *utr)
+static void iso_in_done(void *arg, uint32_t param)
 {
+    UTR_T       *utr = (UTR_T *)arg;
     UAC_DEV_T   *uac = (UAC_DEV_T *)utr->context;
     int         i, ret;
 
@@ -539,6 +540,26 @@ static void iso_in_irq(UTR_T *utr)
         UAC_DBGMSG("usbh_iso_xfer failed!\n");
 }
 
+#ifdef USBH_DEFER_CALLBACK
+static int32_t  uac_workq_src = -1;
+static int      uac_workq_reg = 0;
+#endif
+
+/*
+ *  Isochronous in complete function. When deferred, the UTR is re-scheduled
+ *  by the work queue, so the queue latency must stay below the IF_PER_UTR
+ *  frames covered by the other UTR(s).
+ */
+static void iso_in_irq(UTR_T *utr)
+{
+#ifdef USBH_DEFER_CALLBACK
+    /* run inline only if the work queue level is full */
+    if (WORKQ_Post(USBH_DEFER_PRIO, uac_workq_src, iso_in_done, utr, 0) == WORKQ_OK)
+        return;
+#endif
+    iso_in_done(utr, 0);
+}
+
 /// @endcond HIDDEN_SYMBOLS
 
 
@@ -576,6 +597,14 @@ int usbh_uac_start_audio_in(UAC_DEV_T *uac, UAC_CB_FUNC *func)
 
     uac->func_au_in = func;
 
+#ifdef USBH_DEFER_CALLBACK
+    if (!uac_workq_reg)
+    {
+        uac_workq_src = WORKQ_AddSource("USBH UAC iso-in");
+        uac_workq_reg = 1;
+    }
+#endif
+
     ret = usbh_set_interface(iface, bAlternateSetting);
     if (ret < 0)
     {
@@ -678,6 +707,9 @@ err_out:
             usbh_quit_utr(asif->utr[i]);
     }
     asif->flag_streaming = 0;
+#ifdef USBH_DEFER_CALLBACK
+    WORKQ_Flush(USBH_DEFER_PRIO);           /* drop completions still queued              */
+#endif
     /* free USB transfer buffer                   */
     if ((asif->utr[0] != NULL) &&
             (asif->utr[0]->buff != NULL))
@@ -722,6 +754,10 @@ int usbh_uac_stop_audio_in(UAC_DEV_T *uac)
             usbh_quit_utr(asif->utr[i]);
     }
 
+#ifdef USBH_DEFER_CALLBACK
+    WORKQ_Flush(USBH_DEFER_PRIO);           /* drop completions still queued              */
+#endif
+
     if ((asif->utr[0] != NULL) &&
             (asif->utr[0]->buff != NULL))       /* free audio buffer                          */
         usbh_free_mem(asif->utr[0]->buff, asif->utr[0]->data_len * NUM_UTR);
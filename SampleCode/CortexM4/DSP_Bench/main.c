@@ -0,0 +1,94 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V1.00
+ * @brief    Run the CMSIS-DSP regression suite and benchmark (Tool/DspBench) on the M480.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include "NuMicro.h"
+
+/* Tool/DspBench/dspbench.c, built with DSPBENCH_M4 */
+extern uint32_t DSPBENCH_Run(uint32_t u32Ms, const char *pcFilter);
+
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Set XT1_OUT(PF.2) and XT1_IN(PF.3) to input mode */
+    PF->MODE &= ~(GPIO_MODE_MODE2_Msk | GPIO_MODE_MODE3_Msk);
+
+    /* Enable External XTAL (4~24 MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for 12MHz clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(FREQ_192MHZ);
+
+    /* Set both PCLK0 and PCLK1 as HCLK/2 */
+    CLK->PCLKDIV = CLK_PCLKDIV_PCLK0DIV2 | CLK_PCLKDIV_PCLK1DIV2;
+
+    /* Enable IP clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select IP clock source */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UART0SEL_HXT, CLK_CLKDIV0_UART0(1));
+
+    /* Update System Core Clock */
+    /* User can use SystemCoreClockUpdate() to calculate SystemCoreClock. */
+    SystemCoreClockUpdate();
+
+
+    /* Set GPB multi-function pins for UART0 RXD and TXD */
+    SYS->GPB_MFPH &= ~(SYS_GPB_MFPH_PB12MFP_Msk | SYS_GPB_MFPH_PB13MFP_Msk);
+    SYS->GPB_MFPH |= (SYS_GPB_MFPH_PB12MFP_UART0_RXD | SYS_GPB_MFPH_PB13MFP_UART0_TXD);
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+}
+
+void UART_Init()
+{
+    UART_Open(UART0, 115200);
+}
+
+int main()
+{
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    SYS_Init();
+    UART_Init();
+
+    /*
+        Checks the FIR, biquad, FFT, matrix and statistics kernels of the CMSIS DSP library against
+        double precision references and reports the core cycles per sample of each.
+    */
+
+    printf("\n\n");
+    printf("+----------------------------------------+\n");
+    printf("|          DSP Benchmark Sample Code     |\n");
+    printf("+----------------------------------------+\n");
+    printf("Core clock %d Hz\n\n", SystemCoreClock);
+
+    if(DSPBENCH_Run(0, NULL) != 0)
+    {
+        printf("ERROR: DSP kernel check fail!\n");
+    }
+    else
+    {
+        printf("DSP kernel check ok!\n");
+    }
+
+    while(SYS->PDID);
+}
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
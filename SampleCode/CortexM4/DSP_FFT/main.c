@@ -8,9 +8,15 @@
 #include <stdio.h>
 #include "NuMicro.h"
 #include "arm_math.h"
+#include "spectrum.h"
 
 #define TEST_LENGTH_SAMPLES 2048
 
+/* Streaming spectrum analyzer on the real part of the test input */
+#define SPEC_FFT_LEN        256
+#define SPEC_BLOCK          32
+#define SPEC_PEAKS          4
+
 /* -------------------------------------------------------------------
 * External Input and Output buffer Declarations for FFT Bin Example
 * ------------------------------------------------------------------- */
@@ -27,6 +33,10 @@ uint32_t doBitReverse = 1;
 /* Reference index at which maximum energy of bin occur */
 uint32_t refIndex = 213, testIndex = 0;
 
+static SPECTRUM_T s_sSpec;
+static uint32_t s_au32SpecArena[SPECTRUM_ARENA_SIZE(SPEC_FFT_LEN, SPECTRUM_F32, SPEC_PEAKS) / 4];
+static float32_t s_fSpecPeak;
+
 
 void SYS_Init(void)
 {
@@ -76,6 +86,53 @@ void UART_Init()
     UART_Open(UART0, 115200);
 }
 
+void SpectrumResult(void *pvArg, const SPECTRUM_RESULT_T *psResult)
+{
+    uint32_t i;
+
+    printf("Spectrum %u:", psResult->u32Seq);
+    for(i = 0; i < psResult->u32Peaks; i++)
+        printf(" %.0f Hz (%.3f)", psResult->psPeaks[i].f32Freq, psResult->psPeaks[i].f32Mag);
+    printf("\n");
+
+    if(psResult->u32Peaks)
+        s_fSpecPeak = psResult->psPeaks[0].f32Freq;
+}
+
+/* Stream the real part of the test input through the spectrum analyzer in blocks, as an ADC would deliver it */
+int32_t SpectrumTest(void)
+{
+    SPECTRUM_CFG_T sCfg;
+    float32_t afBlock[SPEC_BLOCK];
+    uint32_t i, j;
+
+    sCfg.u32Fmt = SPECTRUM_F32;
+    sCfg.u32FftLen = SPEC_FFT_LEN;
+    sCfg.u32Hop = SPEC_FFT_LEN / 2;
+    sCfg.u32Window = SPECTRUM_WIN_HANN;
+    sCfg.u32Average = 4;
+    sCfg.u32MaxPeaks = SPEC_PEAKS;
+    sCfg.f32Threshold = 0.05f;
+    sCfg.f32SampleRate = 48000.0f;
+    sCfg.pfnResult = SpectrumResult;
+    sCfg.pvArg = NULL;
+
+    if(SPECTRUM_Open(&s_sSpec, &sCfg, s_au32SpecArena, sizeof(s_au32SpecArena)) != SPECTRUM_OK)
+        return -1;
+
+    for(i = 0; i < TEST_LENGTH_SAMPLES / 2; i += SPEC_BLOCK)
+    {
+        for(j = 0; j < SPEC_BLOCK; j++)
+            afBlock[j] = testInput_f32_10khz[2 * (i + j)];
+        SPECTRUM_Write(&s_sSpec, afBlock, SPEC_BLOCK, SPECTRUM_F32);
+    }
+
+    /* 10 kHz within one bin */
+    if(fabsf(s_fSpecPeak - 10000.0f) > 48000.0f / SPEC_FFT_LEN)
+        return -1;
+    return 0;
+}
+
 
 int main()
 {
@@ -97,6 +154,16 @@ int main()
     printf("|             DSP FFT Sample Code        |\n");
     printf("+----------------------------------------+\n");
 
+    /* The spectrum analyzer reads the input, the in-place FFT below overwrites it */
+    if(SpectrumTest() != 0)
+    {
+        printf("ERROR: Spectrum analyzer result fail!\n");
+    }
+    else
+    {
+        printf("Spectrum analyzer test ok!\n");
+    }
+
     /* Initialize the CFFT/CIFFT module */
     arm_cfft_radix4_init_f32(&S, fftSize, ifftFlag, doBitReverse);
 
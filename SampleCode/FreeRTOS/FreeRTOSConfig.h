@@ -120,6 +120,17 @@ extern uint32_t SystemCoreClock;
 #define configGENERATE_RUN_TIME_STATS   0
 #define configUSE_QUEUE_SETS            1
 
+/* Set to 2 to stop the tick and enter Power-down while idle, see
+Tickless/tickless_m480.h.  main() then calls vM480TicklessInit() before the
+scheduler is started. */
+#define configUSE_TICKLESS_IDLE         0
+#if ( configUSE_TICKLESS_IDLE == 2 )
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vM480TicklessSleep( xExpectedIdleTime )
+#if defined (__ICCARM__) || defined(__GNUC__) || defined(__ARMCC_VERSION)
+void vM480TicklessSleep( uint32_t xExpectedIdleTime );
+#endif
+#endif
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES       0
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
@@ -0,0 +1,508 @@
+/**************************************************************************//**
+ * @file     tickless_m480.c
+ * @version  V1.00
+ * @brief    FreeRTOS tickless idle port for M480 series using a LXT clocked
+ *           timer as wake-up source and Power-down mode while idle.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "tickless_m480.h"
+
+/* Only built for configUSE_TICKLESS_IDLE 2, so projects can always list this
+file and FreeRTOSConfig.h alone turns the port on. */
+#if( configUSE_TICKLESS_IDLE == 2 )
+
+#if( ( configM480_TICKLESS_PD_MODE != CLK_PMUCTL_PDMSEL_PD ) && ( configM480_TICKLESS_PD_MODE != CLK_PMUCTL_PDMSEL_LLPD ) && ( configM480_TICKLESS_PD_MODE != CLK_PMUCTL_PDMSEL_FWPD ) )
+#error configM480_TICKLESS_PD_MODE must be a Power-down mode that retains the CPU state
+#endif
+
+/* The timer runs in continuous counting mode; the 24-bit counter wraps after
+512 seconds with a 32.768 kHz clock. */
+#define tlCOUNTER_MASK          TIMER_CNT_CNT_Msk
+
+/* Keep the compare point this far away from wrap-around so a sleep can never
+be mistaken for a full counter period. */
+#define tlMAX_SLEEP_COUNTS      ( tlCOUNTER_MASK - 0x10000UL )
+
+/* Time is accumulated in units of 1/configM480_TICKLESS_CLOCK_HZ of a tick so
+that both SysTick fractions and timer counts can be added without loss. */
+#define tlFRACTIONS_PER_TICK    ( ( uint64_t ) configM480_TICKLESS_CLOCK_HZ )
+
+static M480TicklessBudget_t pxBudgets[ configM480_TICKLESS_MAX_BUDGETS ];
+static M480TicklessStats_t xStats;
+static uint64_t ullTotalCounts, ullSleepCounts, ullPowerDownCounts;
+static uint32_t ulLastStamp;
+
+/*-----------------------------------------------------------*/
+
+/* The counter is clocked asynchronously to HCLK, read it until two
+consecutive reads agree. */
+static uint32_t prvReadCounter( void )
+{
+    uint32_t ulFirst, ulSecond;
+
+    ulSecond = configM480_TICKLESS_TIMER->CNT & tlCOUNTER_MASK;
+    do
+    {
+        ulFirst = ulSecond;
+        ulSecond = configM480_TICKLESS_TIMER->CNT & tlCOUNTER_MASK;
+    }
+    while( ulFirst != ulSecond );
+
+    return ulSecond;
+}
+
+static uint32_t prvCountsToUs( uint64_t ullCounts )
+{
+    return ( uint32_t ) ( ( ullCounts * 1000000ULL ) / configM480_TICKLESS_CLOCK_HZ );
+}
+
+/* Advance the time base to the current counter value and return it. */
+static uint32_t prvUpdateTotal( void )
+{
+    uint32_t ulNow = prvReadCounter();
+
+    ullTotalCounts += ( ulNow - ulLastStamp ) & tlCOUNTER_MASK;
+    ulLastStamp = ulNow;
+
+    return ulNow;
+}
+
+/* Smallest Power-down budget allowed by the registered callbacks. */
+static TickType_t prvGetPowerDownBudget( TickType_t xExpectedIdleTime )
+{
+    TickType_t xBudget = xExpectedIdleTime, xLimit;
+    uint32_t i;
+
+    for( i = 0UL; i < configM480_TICKLESS_MAX_BUDGETS; i++ )
+    {
+        if( pxBudgets[ i ] != NULL )
+        {
+            xLimit = ( TickType_t ) pxBudgets[ i ]();
+            if( xLimit < xBudget )
+            {
+                xBudget = xLimit;
+            }
+        }
+    }
+
+    return xBudget;
+}
+
+/*-----------------------------------------------------------*/
+
+void configM480_TICKLESS_TIMER_HANDLER( void )
+{
+    /* Only needed to wake the chip; the elapsed time is computed from the
+    counter by vM480TicklessSleep().  The interrupt stays enabled because CTL
+    writes are slow to synchronise; a stale compare match every counter wrap
+    only ends up here. */
+    configM480_TICKLESS_TIMER->INTSTS = TIMER_INTSTS_TIF_Msk | TIMER_INTSTS_TWKF_Msk;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief       Start the LXT clocked timer used as sleep clock
+ *
+ * @return      None
+ *
+ * @details     Must be called before vTaskStartScheduler(). Enables LXT if it is not running yet.
+ */
+void vM480TicklessInit( void )
+{
+    uint32_t u32RegLocked = SYS_IsRegLocked();
+
+    SYS_UnlockReg();
+
+    if( ( CLK->PWRCTL & CLK_PWRCTL_LXTEN_Msk ) == 0UL )
+    {
+        /* Set X32_OUT(PF.4) and X32_IN(PF.5) to input mode */
+        PF->MODE &= ~( GPIO_MODE_MODE4_Msk | GPIO_MODE_MODE5_Msk );
+        CLK_EnableXtalRC( CLK_PWRCTL_LXTEN_Msk );
+        CLK_WaitClockReady( CLK_STATUS_LXTSTB_Msk );
+    }
+
+    CLK_EnableModuleClock( configM480_TICKLESS_TIMER_MODULE );
+    CLK_SetModuleClock( configM480_TICKLESS_TIMER_MODULE, configM480_TICKLESS_TIMER_CLKSEL, 0UL );
+    CLK_SetPowerDownMode( configM480_TICKLESS_PD_MODE );
+
+    if( u32RegLocked )
+    {
+        SYS_LockReg();
+    }
+
+    /* Free running counter with prescale 1, wake-up enabled.  Each write to
+    CTL is synchronised to the slow timer clock, wait for it to take effect. */
+    configM480_TICKLESS_TIMER->CTL = 0UL;
+    while( TIMER_IS_ACTIVE( configM480_TICKLESS_TIMER ) ) {}
+    configM480_TICKLESS_TIMER->CMP = tlCOUNTER_MASK;
+    configM480_TICKLESS_TIMER->INTSTS = TIMER_INTSTS_TIF_Msk | TIMER_INTSTS_TWKF_Msk;
+    configM480_TICKLESS_TIMER->CTL = TIMER_CONTINUOUS_MODE | TIMER_CTL_WKEN_Msk | TIMER_CTL_INTEN_Msk | TIMER_CTL_CNTEN_Msk;
+    while( !TIMER_IS_ACTIVE( configM480_TICKLESS_TIMER ) ) {}
+
+    NVIC_SetPriority( configM480_TICKLESS_TIMER_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( configM480_TICKLESS_TIMER_IRQn );
+
+    ulLastStamp = prvReadCounter();
+    vM480TicklessResetStats();
+}
+
+/**
+ * @brief       Register a Power-down budget callback
+ *
+ * @param[in]   pxBudget    Callback returning the number of ticks Power-down is allowed for
+ *
+ * @retval      0   Success
+ * @retval      -1  No free slot, increase configM480_TICKLESS_MAX_BUDGETS
+ *
+ * @details     Callbacks are invoked from the idle task with interrupts enabled and must not block.
+ */
+int32_t xM480TicklessAddBudget( M480TicklessBudget_t pxBudget )
+{
+    uint32_t i;
+    int32_t i32Ret = -1;
+
+    taskENTER_CRITICAL();
+    for( i = 0UL; i < configM480_TICKLESS_MAX_BUDGETS; i++ )
+    {
+        if( pxBudgets[ i ] == NULL )
+        {
+            pxBudgets[ i ] = pxBudget;
+            i32Ret = 0;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return i32Ret;
+}
+
+/**
+ * @brief       Power-down budget for the EMAC
+ *
+ * @retval      0               The TX DMA owns a descriptor, or the receiver is on without wake-on-LAN
+ * @retval      portMAX_DELAY   The EMAC is idle, stopped, not clocked, or only waits for a Magic Packet
+ *
+ * @details     Frames arriving while HCLK is stopped are lost and queued frames are not sent. A frame
+ *              is queued while the descriptor at EMAC_CTXDSA belongs to the EMAC. The receiver must
+ *              keep HCLK unless WOLEN is set, in which case the application has chosen to drop
+ *              everything but the Magic Packet that wakes the chip. A veto only rules out Power-down,
+ *              the tick is still suppressed while the idle task sleeps in WFI.
+ */
+uint32_t ulM480TicklessEmacBudget( void )
+{
+    uint32_t ulCtl, ulTxDesc;
+
+    if( ( CLK->AHBCLK & CLK_AHBCLK_EMACCKEN_Msk ) == 0UL )
+    {
+        return portMAX_DELAY;
+    }
+
+    ulCtl = EMAC->CTL;
+    if( ( ulCtl & EMAC_CTL_TXON_Msk ) != 0UL )
+    {
+        /* Bit 31 of the first descriptor word is the EMAC ownership bit. */
+        ulTxDesc = EMAC->CTXDSA;
+        if( ( ulTxDesc != 0UL ) && ( ( *( volatile uint32_t * ) ulTxDesc & 0x80000000UL ) != 0UL ) )
+        {
+            return 0UL;
+        }
+    }
+
+    if( ( ( ulCtl & EMAC_CTL_RXON_Msk ) != 0UL ) && ( ( ulCtl & EMAC_CTL_WOLEN_Msk ) == 0UL ) )
+    {
+        return 0UL;
+    }
+
+    return portMAX_DELAY;
+}
+
+/**
+ * @brief       Power-down budget for the USB controllers
+ *
+ * @retval      0               A USB host controller runs, or a USB device is on a bus that is not suspended
+ * @retval      portMAX_DELAY   Otherwise
+ *
+ * @details     A running host controller sends a SOF every frame. A full speed device may sleep
+ *              while the bus is suspended, the resume wakes the chip. The high speed device
+ *              controller has no suspend status, so it vetoes while VBUS is present and it is
+ *              connected to the bus.
+ */
+uint32_t ulM480TicklessUsbBudget( void )
+{
+    if( ( CLK->AHBCLK & CLK_AHBCLK_USBHCKEN_Msk ) != 0UL )
+    {
+        if( ( ( USBH->HcControl & USBH_HcControl_HCFS_Msk ) == ( 2UL << USBH_HcControl_HCFS_Pos ) ) ||
+                ( ( HSUSBH->UCMDR & HSUSBH_UCMDR_RUN_Msk ) != 0UL ) )
+        {
+            return 0UL;
+        }
+    }
+
+    if( ( ( CLK->APBCLK0 & CLK_APBCLK0_USBDCKEN_Msk ) != 0UL ) &&
+            ( ( USBD->ATTR & ( USBD_ATTR_USBEN_Msk | USBD_ATTR_SUSPEND_Msk ) ) == USBD_ATTR_USBEN_Msk ) &&
+            ( ( USBD->VBUSDET & USBD_VBUSDET_VBUSDET_Msk ) != 0UL ) )
+    {
+        return 0UL;
+    }
+
+    if( ( ( CLK->AHBCLK & CLK_AHBCLK_HSUSBDCKEN_Msk ) != 0UL ) &&
+            ( ( HSUSBD->PHYCTL & ( HSUSBD_PHYCTL_VBUSDET_Msk | HSUSBD_PHYCTL_DPPUEN_Msk ) ) ==
+              ( HSUSBD_PHYCTL_VBUSDET_Msk | HSUSBD_PHYCTL_DPPUEN_Msk ) ) )
+    {
+        return 0UL;
+    }
+
+    return portMAX_DELAY;
+}
+
+/**
+ * @brief       Get low-power residency and wake-up statistics
+ *
+ * @param[out]  pxStats     Receives a snapshot of the statistics
+ *
+ * @return      None
+ */
+void vM480TicklessGetStats( M480TicklessStats_t *pxStats )
+{
+    taskENTER_CRITICAL();
+    prvUpdateTotal();
+    xStats.ullTotalUs = ( ullTotalCounts * 1000000ULL ) / configM480_TICKLESS_CLOCK_HZ;
+    xStats.ullSleepUs = ( ullSleepCounts * 1000000ULL ) / configM480_TICKLESS_CLOCK_HZ;
+    xStats.ullPowerDownUs = ( ullPowerDownCounts * 1000000ULL ) / configM480_TICKLESS_CLOCK_HZ;
+    *pxStats = xStats;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief       Clear low-power residency and wake-up statistics
+ *
+ * @return      None
+ */
+void vM480TicklessResetStats( void )
+{
+    taskENTER_CRITICAL();
+    memset( &xStats, 0, sizeof( xStats ) );
+    ullTotalCounts = 0ULL;
+    ullSleepCounts = 0ULL;
+    ullPowerDownCounts = 0ULL;
+    ulLastStamp = prvReadCounter();
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+/* WFI with the SysTick still running, used when the sleep would not even last
+two ticks. */
+static void prvLightSleep( void )
+{
+    uint32_t ulStart;
+
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    if( eTaskConfirmSleepModeStatus() == eAbortSleep )
+    {
+        xStats.ulAbortCount++;
+    }
+    else
+    {
+        ulStart = prvUpdateTotal();
+
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        __DSB();
+        __WFI();
+        __ISB();
+
+        ullSleepCounts += ( prvUpdateTotal() - ulStart ) & tlCOUNTER_MASK;
+        xStats.ulSleepCount++;
+    }
+
+    __enable_irq();
+}
+
+/**
+ * @brief       Suppress the RTOS tick and sleep, called by the idle task
+ *
+ * @param[in]   xExpectedIdleTime   Ticks until the next task is due
+ *
+ * @return      None
+ *
+ * @details     Installed as portSUPPRESS_TICKS_AND_SLEEP(). The SysTick is stopped for the
+ *              whole idle time. The chip enters Power-down when the registered budgets allow at
+ *              least configM480_TICKLESS_MIN_PD_TICKS ticks of it, and sleeps in WFI otherwise;
+ *              either way the tickless timer or any other interrupt ends the sleep.
+ */
+void vM480TicklessSleep( uint32_t xExpectedIdleTime )
+{
+    TickType_t xBudget, xModifiableIdleTime, xCompleteTicks;
+    BaseType_t xPowerDown;
+    uint32_t ulTickCycles, ulElapsedCycles, ulSleepCounts, ulStart, ulEnd, ulCompare, ulLatency, ulReload;
+    uint32_t u32RegLocked;
+    uint64_t ullFractions, ullElapsed, ullRemainder;
+    int32_t i32TimerWake;
+
+    xBudget = prvGetPowerDownBudget( ( TickType_t ) xExpectedIdleTime );
+
+    xPowerDown = ( xBudget >= configM480_TICKLESS_MIN_PD_TICKS ) ? pdTRUE : pdFALSE;
+
+    if( xPowerDown == pdFALSE )
+    {
+        if( xBudget < ( TickType_t ) xExpectedIdleTime )
+        {
+            xStats.ulVetoCount++;
+        }
+
+        /* The budgets only limit Power-down.  HCLK keeps running in WFI, so
+        the tick is suppressed for the whole expected idle time. */
+        xBudget = ( TickType_t ) xExpectedIdleTime;
+        if( xBudget < 2UL )
+        {
+            prvLightSleep();
+            return;
+        }
+    }
+
+    /* Enter a critical section but don't use the taskENTER_CRITICAL()
+    method as that will mask interrupts that should exit sleep mode. */
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    /* Abandon the sleep if a task became ready or a tick is already
+    pending. */
+    if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) || ( ( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk ) != 0UL ) )
+    {
+        xStats.ulAbortCount++;
+        __enable_irq();
+        return;
+    }
+
+    /* Stop the SysTick and remember how far into the current tick period it
+    was, in tick fractions. */
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    ulTickCycles = SysTick->LOAD + 1UL;
+    ulElapsedCycles = ulTickCycles - SysTick->VAL;
+    ullFractions = ( ( uint64_t ) ulElapsedCycles * tlFRACTIONS_PER_TICK ) / ulTickCycles;
+
+    /* Sleep until the end of the tick period xBudget ticks from the last
+    tick, rounded down so that the kernel is never stepped past the time the
+    next task is due. */
+    ullElapsed = ( ( uint64_t ) xBudget * tlFRACTIONS_PER_TICK ) - ullFractions;
+    ullElapsed /= configTICK_RATE_HZ;
+    ulSleepCounts = ( ullElapsed > tlMAX_SLEEP_COUNTS ) ? tlMAX_SLEEP_COUNTS : ( uint32_t ) ullElapsed;
+
+    ulStart = prvUpdateTotal();
+    ulCompare = ( ulStart + ulSleepCounts ) & tlCOUNTER_MASK;
+    if( ulCompare < 2UL )
+    {
+        /* CMPDAT 0 and 1 are not allowed. */
+        ulCompare = 2UL;
+    }
+    configM480_TICKLESS_TIMER->CMP = ulCompare;
+    configM480_TICKLESS_TIMER->INTSTS = TIMER_INTSTS_TIF_Msk | TIMER_INTSTS_TWKF_Msk;
+
+    /* configPRE_SLEEP_PROCESSING() can set its parameter to 0 to indicate
+    that it entered low power itself. */
+    xModifiableIdleTime = xBudget;
+    configPRE_SLEEP_PROCESSING( xModifiableIdleTime );
+    if( ( xModifiableIdleTime > 0 ) && ( xPowerDown == pdFALSE ) )
+    {
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        __DSB();
+        __WFI();
+        __ISB();
+    }
+    else if( xModifiableIdleTime > 0 )
+    {
+        u32RegLocked = SYS_IsRegLocked();
+        SYS_UnlockReg();
+
+        CLK_PowerDown();
+
+        /* Return to plain sleep for the next WFI. */
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        CLK->PWRCTL &= ~CLK_PWRCTL_PDEN_Msk;
+
+        if( u32RegLocked )
+        {
+            SYS_LockReg();
+        }
+    }
+    configPOST_SLEEP_PROCESSING( xBudget );
+
+    ulEnd = prvUpdateTotal();
+    i32TimerWake = ( configM480_TICKLESS_TIMER->INTSTS & TIMER_INTSTS_TIF_Msk ) ? 1 : 0;
+    ulSleepCounts = ( ulEnd - ulStart ) & tlCOUNTER_MASK;
+
+    /* Work out how many complete ticks passed and how far into the next one
+    the kernel is now. */
+    ullFractions += ( uint64_t ) ulSleepCounts * configTICK_RATE_HZ;
+    xCompleteTicks = ( TickType_t ) ( ullFractions / tlFRACTIONS_PER_TICK );
+    ullRemainder = ullFractions % tlFRACTIONS_PER_TICK;
+
+    if( xCompleteTicks >= ( TickType_t ) xExpectedIdleTime )
+    {
+        /* Woken late: step to one tick short of the expected idle time and
+        let the pending SysTick provide the last one. */
+        xCompleteTicks = ( TickType_t ) xExpectedIdleTime - 1UL;
+        SysTick->LOAD = ulTickCycles - 1UL;
+        SysTick->VAL = 0UL;
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+    else
+    {
+        /* Restart the SysTick so that it expires at the end of the current
+        tick period, then restore the normal reload value which is used from
+        the following period on. */
+        ulReload = ( uint32_t ) ( ( ( tlFRACTIONS_PER_TICK - ullRemainder ) * ulTickCycles ) / tlFRACTIONS_PER_TICK );
+        SysTick->LOAD = ( ulReload > 2UL ) ? ( ulReload - 1UL ) : 1UL;
+        SysTick->VAL = 0UL;
+    }
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = ulTickCycles - 1UL;
+
+    vTaskStepTick( xCompleteTicks );
+
+    /* Statistics */
+    if( xPowerDown == pdFALSE )
+    {
+        ullSleepCounts += ulSleepCounts;
+        xStats.ulSleepCount++;
+    }
+    else if( i32TimerWake )
+    {
+        xStats.ulTimerWakeCount++;
+        ulLatency = prvCountsToUs( ( ulEnd - ulCompare ) & tlCOUNTER_MASK );
+        xStats.ulLastWakeLatencyUs = ulLatency;
+        if( ulLatency > xStats.ulMaxWakeLatencyUs )
+        {
+            xStats.ulMaxWakeLatencyUs = ulLatency;
+        }
+    }
+    else
+    {
+        xStats.ulEventWakeCount++;
+    }
+
+    if( xPowerDown != pdFALSE )
+    {
+        ullPowerDownCounts += ulSleepCounts;
+        xStats.ulPowerDownCount++;
+    }
+
+    /* Exit with interrupts enabled, so the source that ended the sleep is
+    serviced now. */
+    __enable_irq();
+}
+
+#endif /* configUSE_TICKLESS_IDLE == 2 */
@@ -0,0 +1,121 @@
+/**************************************************************************//**
+ * @file     tickless_m480.h
+ * @version  V1.00
+ * @brief    FreeRTOS tickless idle port for M480 series using a LXT clocked
+ *           timer as wake-up source and Power-down mode while idle.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __TICKLESS_M480_H__
+#define __TICKLESS_M480_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * To use this port add Tickless/tickless_m480.c to the project, with the
+ * Tickless directory after the sample's own directory in the include path so
+ * the sample's FreeRTOSConfig.h is used, and put the following in
+ * FreeRTOSConfig.h:
+ *
+ *   #define configUSE_TICKLESS_IDLE                 2
+ *   #define portSUPPRESS_TICKS_AND_SLEEP( x )       vM480TicklessSleep( x )
+ *   void vM480TicklessSleep( uint32_t xExpectedIdleTime );
+ *
+ * and call vM480TicklessInit() from main() before vTaskStartScheduler().
+ * tickless_m480.c compiles to nothing while configUSE_TICKLESS_IDLE is not 2,
+ * so a project can list it and leave the choice to FreeRTOSConfig.h.
+ *
+ * While idle the SysTick is stopped and the chip enters Power-down mode with
+ * a TIMER, clocked from the 32.768 kHz LXT, programmed to wake it when the
+ * next task is due.  Any other enabled wake-up source (GPIO, UART, RTC, EMAC
+ * wake-on-LAN, USB) ends the sleep early; the time spent is measured with the
+ * same timer so the RTOS tick count stays correct.
+ *
+ * Standby (SPD) and Deep Power-down modes wake through a chip reset and so
+ * cannot be used for tickless idle; only PD, LLPD and FWPD are accepted.
+ *
+ * Peripherals that need HCLK while a transfer is in progress (EMAC RX DMA,
+ * USB host/device, PDMA) must veto Power-down through a budget callback
+ * registered with xM480TicklessAddBudget().  A callback returns the number of
+ * ticks the system may spend in Power-down from now on:
+ *   - portMAX_DELAY when it does not care,
+ *   - 0 while it is busy,
+ *   - any other value to cap the time in Power-down.
+ * A budget below configM480_TICKLESS_MIN_PD_TICKS only rules out Power-down:
+ * the SysTick is still stopped for the whole expected idle time and the idle
+ * task sleeps in WFI, where HCLK keeps running, until the tickless timer or
+ * any other interrupt wakes it.
+ *
+ * ulM480TicklessEmacBudget() and ulM480TicklessUsbBudget() are budgets for the
+ * EMAC and the USB controllers that only look at the hardware; the
+ * NuMaker-PFM-M487 LwIP_TCP_EchoServer sample registers them.  The EMAC allows
+ * Power-down once its TX DMA is idle and the receiver is off or only waits for
+ * a wake-on-LAN Magic Packet.
+ *
+ * With lwIP running on FreeRTOS the next lwIP timeout is already part of the
+ * expected idle time, because tcpip_thread blocks on its mailbox with that
+ * timeout.
+ */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Configuration, may be overridden in FreeRTOSConfig.h                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef configM480_TICKLESS_TIMER
+#define configM480_TICKLESS_TIMER           TIMER3                      /*!< Timer used as sleep clock and wake-up source */
+#define configM480_TICKLESS_TIMER_MODULE    TMR3_MODULE                 /*!< Module clock of the timer */
+#define configM480_TICKLESS_TIMER_CLKSEL    CLK_CLKSEL1_TMR3SEL_LXT     /*!< Clock source of the timer, must keep running in Power-down */
+#define configM480_TICKLESS_TIMER_IRQn      TMR3_IRQn                   /*!< Interrupt number of the timer */
+#define configM480_TICKLESS_TIMER_HANDLER   TMR3_IRQHandler             /*!< Interrupt handler name of the timer */
+#endif
+
+#ifndef configM480_TICKLESS_CLOCK_HZ
+#define configM480_TICKLESS_CLOCK_HZ        32768UL                     /*!< Frequency of the timer clock source */
+#endif
+
+#ifndef configM480_TICKLESS_PD_MODE
+#define configM480_TICKLESS_PD_MODE         CLK_PMUCTL_PDMSEL_FWPD      /*!< Power-down mode used while idle (PD, LLPD or FWPD) */
+#endif
+
+#ifndef configM480_TICKLESS_MIN_PD_TICKS
+#define configM480_TICKLESS_MIN_PD_TICKS    3                           /*!< Idle periods shorter than this sleep in WFI, still without ticks */
+#endif
+
+#ifndef configM480_TICKLESS_MAX_BUDGETS
+#define configM480_TICKLESS_MAX_BUDGETS     4                           /*!< Number of budget callbacks that can be registered */
+#endif
+
+/** Budget callback, returns the number of ticks Power-down is allowed for. */
+typedef uint32_t (*M480TicklessBudget_t)( void );
+
+/** Low-power residency and wake-up statistics, see vM480TicklessGetStats(). */
+typedef struct
+{
+    uint64_t ullTotalUs;            /*!< Time covered by the statistics */
+    uint64_t ullSleepUs;            /*!< Time spent in WFI */
+    uint64_t ullPowerDownUs;        /*!< Time spent in Power-down */
+    uint32_t ulSleepCount;          /*!< Number of WFI sleeps */
+    uint32_t ulPowerDownCount;      /*!< Number of Power-down entries */
+    uint32_t ulTimerWakeCount;      /*!< Power-down ended by the tickless timer */
+    uint32_t ulEventWakeCount;      /*!< Power-down ended by another wake-up source */
+    uint32_t ulAbortCount;          /*!< Sleep abandoned because a task became ready */
+    uint32_t ulVetoCount;           /*!< Power-down refused by a budget callback */
+    uint32_t ulLastWakeLatencyUs;   /*!< Timer compare match to code resume, last timer wake */
+    uint32_t ulMaxWakeLatencyUs;    /*!< Timer compare match to code resume, worst case */
+} M480TicklessStats_t;
+
+void vM480TicklessInit( void );
+void vM480TicklessSleep( uint32_t xExpectedIdleTime );
+int32_t xM480TicklessAddBudget( M480TicklessBudget_t pxBudget );
+void vM480TicklessGetStats( M480TicklessStats_t *pxStats );
+void vM480TicklessResetStats( void );
+uint32_t ulM480TicklessEmacBudget( void );
+uint32_t ulM480TicklessUsbBudget( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TICKLESS_M480_H__ */
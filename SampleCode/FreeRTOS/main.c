@@ -52,6 +52,7 @@
 
 /* Hardware and starter kit includes. */
 #include "NuMicro.h"
+#include "tickless_m480.h"
 
 /* Priorities for the demo application tasks. */
 #define mainFLASH_TASK_PRIORITY             ( tskIDLE_PRIORITY + 1UL )
@@ -131,6 +132,11 @@ int main(void)
 
     printf("FreeRTOS is starting ...\n");
 
+#if( configUSE_TICKLESS_IDLE == 2 )
+    /* Stop the tick and enter Power-down while idle */
+    vM480TicklessInit();
+#endif
+
     /* Start the scheduler. */
     vTaskStartScheduler();
 
@@ -16,6 +16,7 @@
 #include "ble_gap.h"
 #include "cfg_sector_m0.h"
 #include "trspx.h"
+#include "bt_porting_spi.h"
 
 #define PLL_CLOCK           192000000
 #define UART_TX_PDMA_CH     2
@@ -27,23 +28,13 @@
 #if defined(UART_RX_USE_PDMA)
 #define UART_RX_PDMA_CH     1
 void UART1_RX_Recv(void);
-
-#else
-/*uart rx buffer control*/
-#define RX_BUF_RESET()      (rx_buf_ridx = rx_buf_widx = 0)
-#define RX_BUF_PUSH(d)      (rx_buf[(uint8_t)(rx_buf_widx++)] = (d))
-#define RX_BUF_POP()        (rx_buf[(rx_buf_ridx++)])
-#define RX_BUF_DROP(d)      (rx_buf_ridx += d)
-#define RX_BUF_READ(idx)    (rx_buf[(uint8_t)(rx_buf_ridx+idx)])
-#define RX_BUF_EMPTY()      ((rx_buf_ridx) == (rx_buf_widx))
-#define RX_BUF_FULL()       ((rx_buf_ridx) == ((uint8_t)(rx_buf_widx + 1)))
-#define RX_BUF_COUNT()      ((uint8_t)(rx_buf_widx - rx_buf_ridx))
+void UART1_RX_Done(bool is_timeout);
 
 /*---------------------------------------------------------------------------------------------------------*/
 /* Global variables                                                                                        */
 /*---------------------------------------------------------------------------------------------------------*/
-static uint8_t rx_buf[256];
-static uint8_t rx_buf_ridx, rx_buf_widx;
+/* UART1 rx PDMA block, TRSPX_mtu bytes are received at a time */
+static uint8_t uart_rx_dma[sizeof(TRSPX_Read_Data)] __attribute__((aligned(4)));
 
 #endif
 
@@ -56,28 +47,49 @@ int cmd_utx(void *context, int argc, char** argv);
 // use UART1 interface, keep UART1_TX_Send for the unique naming
 void UART1_TX_Send(uint32_t len, uint8_t *ptr);
 void UART1_IRQHandler(void);
+void PendSV_Handler(void);
 
 /*---------------------------------------------------------------------------------------------------------*/
 /* static function                                                                                         */
 /*---------------------------------------------------------------------------------------------------------*/
-/* 1000 bytes pending to stop UART1 rx, then 500 bytes will allow again*/
-static uint8_t RFTX_Pending_Check()
+/*
+ * UART data waits in the TRSPX queue while the stack holds a full budget.
+ * Once the controller has sent some of it, the pump is run from PendSV so it
+ * stays at the interrupt priority of the stack.
+ */
+static void RFTX_Pending_Check()
 {
-    static volatile uint8_t rf_pending = 0;
-    if(rf_pending)
-    {
-        if(BT_Pending_TxCnt() < 500)
-        {
-            rf_pending = 0;
-            NVIC_EnableIRQ(UART1_IRQn);
-        }
-    }
-    else if(BT_Pending_TxCnt() > 1000)
+    if(TRSPX_pump_ready())
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#if !defined(UART_RX_USE_PDMA)
+    /* UART1 rx stops while the queue is full, resume at half */
+    if(TRSPX_queue_space() >= TRSPX_TXQ_SIZE / 2)
+        NVIC_EnableIRQ(UART1_IRQn);
+#endif
+}
+
+/* Prints notification and SPI throughput every second while data is moving */
+static void Throughput_Report()
+{
+    static TRSPX_STATS last;
+    static uint32_t last_spi_bytes, last_spi_tran;
+    uint32_t notify;
+
+    if(!TIMER_GetIntFlag(TIMER1))
+        return;
+    TIMER_ClearIntFlag(TIMER1);
+
+    notify = TRSPX_stats.notify - last.notify;
+    if(notify)
     {
-        NVIC_DisableIRQ(UART1_IRQn);
-        rf_pending = 1;
+        printf("notify %d B/s, %d/s (%d full), held %d, drop %d | spi %d B/s, %d tran/s\n",
+               TRSPX_stats.bytes - last.bytes, notify, TRSPX_stats.full - last.full,
+               TRSPX_stats.held - last.held, TRSPX_stats.dropped - last.dropped,
+               bt_spi_stats.bytes - last_spi_bytes, bt_spi_stats.tran - last_spi_tran);
     }
-    return rf_pending;
+    last = TRSPX_stats;
+    last_spi_bytes = bt_spi_stats.bytes;
+    last_spi_tran = bt_spi_stats.tran;
 }
 
 void SYS_Init(void)
@@ -99,12 +111,15 @@ void SYS_Init(void)
     /* Enable IP clock */
     CLK->APBCLK0 |= CLK_APBCLK0_UART0CKEN_Msk; // UART0 Clock Enable
     CLK->APBCLK0 |= CLK_APBCLK0_UART1CKEN_Msk; // UART1 Clock Enable
+    CLK->APBCLK0 |= CLK_APBCLK0_TMR1CKEN_Msk;  // TIMER1 Clock Enable
 
     /* Select IP clock source */
     /* Select UART0 clock source is HXT */
     CLK->CLKSEL1 = (CLK->CLKSEL1 & ~CLK_CLKSEL1_UART0SEL_Msk) | (0x0 << CLK_CLKSEL1_UART0SEL_Pos);
     /* Select UART1 clock source is HXT */
     CLK->CLKSEL1 = (CLK->CLKSEL1 & ~CLK_CLKSEL1_UART1SEL_Msk) | (0x0 << CLK_CLKSEL1_UART1SEL_Pos);
+    /* Select TIMER1 clock source is HXT */
+    CLK->CLKSEL1 = (CLK->CLKSEL1 & ~CLK_CLKSEL1_TMR1SEL_Msk) | CLK_CLKSEL1_TMR1SEL_HXT;
 
     /*---------------------------------------------------------------------------------------------------------*/
     /* Init I/O Multi-function                                                                                 */
@@ -227,13 +242,15 @@ int main(void)
     UART1_Init();
 #if defined(UART_RX_USE_PDMA)
     printf("UART RX uses PDMA\n");
-#else
-    RX_BUF_RESET();
 #endif
     TRSPX_init();
+    /* 1 Hz tick for the throughput report */
+    TIMER_Open(TIMER1, TIMER_PERIODIC_MODE, 1);
+    TIMER_Start(TIMER1);
     while(1)
     {
         RFTX_Pending_Check();
+        Throughput_Report();
     }
 }
 
@@ -275,7 +292,7 @@ void UART1_RX_Recv(void)
     PDMA_SetTransferCnt(PDMA, UART_RX_PDMA_CH, PDMA_WIDTH_8, TRSPX_mtu);
     /* Set source/destination address and attributes */
     PDMA_SetTransferAddr(PDMA, UART_RX_PDMA_CH, (uint32_t)&UART1->DAT, PDMA_SAR_FIX,
-                         (uint32_t)TRSPX_Read_Data, PDMA_DAR_INC);
+                         (uint32_t)uart_rx_dma, PDMA_DAR_INC);
     /* Set service selection; set Memory-to-Peripheral mode. */
     PDMA_SetTransferMode(PDMA, UART_RX_PDMA_CH, PDMA_UART1_RX, FALSE, 0);
     /* Single request type */
@@ -294,40 +311,54 @@ void UART1_RX_Recv(void)
     UART1->INTEN |= UART_INTEN_RXPDMAEN_Msk;
 }
 
+/* Called from PDMA_IRQHandler when the rx block is full or UART1 went idle */
+void UART1_RX_Done(bool is_timeout)
+{
+    uint16_t cnt = TRSPX_mtu;
+
+    if(is_timeout)
+        cnt = TRSPX_mtu - 1 - ((PDMA->DSCT[UART_RX_PDMA_CH].CTL & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos);
+    TRSPX_receive(uart_rx_dma, cnt, is_timeout);
+
+    if(is_timeout)
+    {
+        /* Set transfer count and trigger again */
+        PDMA_SetTransferCnt(PDMA, UART_RX_PDMA_CH, PDMA_WIDTH_8, TRSPX_mtu);
+    }
+    else
+    {
+        /* Set UART RX PAMA again */
+        UART1_RX_Recv();
+    }
+}
+
 #else
 void UART1_IRQHandler(void)
 {
+    uint8_t buf[16], cnt = 0;
     uint8_t tout = 0;
     uint32_t u32IntSts = UART1->INTSTS;
-    /*Check if RF pending too much*/
-    if(RFTX_Pending_Check())
-        return;
+
     if(u32IntSts & (UART_INTSTS_HWTOIF_Msk|UART_INTSTS_RXTOIF_Msk))
         tout = 1;
-    while(!UART_GET_RX_EMPTY(UART1))
-    {
-        uint8_t dat;
-        if(RX_BUF_FULL())
-            break;
-        dat = UART_READ(UART1);
-        RX_BUF_PUSH(dat);
-    }
-    if(RX_BUF_COUNT() >= TRSPX_mtu)
-    {
-        uint8_t i;
-        for(i = 0; i < TRSPX_mtu; i++)
-            TRSPX_Read_Data[i] = RX_BUF_POP();
-        //printf("%d\n", TRSPX_mtu);
-        TRSPX_send(TRSPX_mtu);
-    }
-    else if(tout)
+    while(!UART_GET_RX_EMPTY(UART1) && (cnt < TRSPX_queue_space()))
     {
-        uint8_t cnt, i;
-        cnt = RX_BUF_COUNT();
-        for(i = 0; i < cnt; i++)
-            TRSPX_Read_Data[i] = RX_BUF_POP();
-        //printf("%d\n", cnt);
-        TRSPX_send(cnt);
+        buf[cnt++] = UART_READ(UART1);
+        if(cnt == sizeof(buf))
+        {
+            TRSPX_receive(buf, cnt, false);
+            cnt = 0;
+        }
     }
+    TRSPX_receive(buf, cnt, tout);
+    /* Queue full, leave the rest in the FIFO until RFTX_Pending_Check() resumes */
+    if(!UART_GET_RX_EMPTY(UART1))
+        NVIC_DisableIRQ(UART1_IRQn);
 }
 #endif
+
+/* Notification pump pended by RFTX_Pending_Check() */
+void PendSV_Handler(void)
+{
+    TRSPX_pump();
+}
@@ -117,6 +117,8 @@ static void TRSPX_connection_complete_handler(bt_evt_t *evt)
 static void TRSPX_disconnection_complete_handler(bt_evt_t *evt)
 {
     TRSPX_ble_status = BLE_IDLE;
+    TRSPX_reset();
+    TRSPX_mtu = TRSPX_DEFAULT_MTU - 3;
 
     TRSPX_ble_set_adv_parameter_cb(0, 0);
 }
@@ -125,7 +127,10 @@ static void TRSPX_mtu_exchanged(bt_evt_t *evt)
 {
     ble_gatt_evt_mtu_exchange_t * p = &evt->evt.gatt_evt.gatt.mtu_exchanged;
 
-    TRSPX_mtu = p->new_mtu;
+    /* notification payload, bounded by the attribute buffer */
+    TRSPX_mtu = p->new_mtu - 3;
+    if(TRSPX_mtu > sizeof(TRSPX_Read_Data))
+        TRSPX_mtu = sizeof(TRSPX_Read_Data);
 }
 
 void TRSPX_bt_evt_hdl(bt_evt_t *evt)
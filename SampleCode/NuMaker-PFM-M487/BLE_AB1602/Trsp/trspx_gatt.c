@@ -15,6 +15,37 @@ uint8_t TRSPX_Write_Data[200];
 uint8_t TRSPX_Read_Data[200];
 uint8_t TRSPX_CCCD_Data[2];
 
+#if (TRSPX_TXQ_SIZE & (TRSPX_TXQ_SIZE - 1))
+#error "TRSPX_TXQ_SIZE must be a power of two"
+#endif
+
+TRSPX_STATS TRSPX_stats;
+
+/* UART data queue, written by TRSPX_receive() and drained by TRSPX_pump() */
+static uint8_t TRSPX_txq[TRSPX_TXQ_SIZE];
+static volatile uint16_t TRSPX_txq_ridx, TRSPX_txq_widx;
+/* set when the UART went idle, the queue tail is sent without waiting for a full MTU */
+static volatile bool TRSPX_txq_flush;
+
+#define TXQ_COUNT()     ((uint16_t)(TRSPX_txq_widx - TRSPX_txq_ridx))
+
+/* ATT (3) + L2CAP (4) header on every notification, LL PDU payload 27 */
+#define NOTIFY_OVERHEAD 7
+#define LL_PDU_SIZE     27
+
+/*
+ * Bytes the stack may hold before the pump waits: what the controller can
+ * send in TRSPX_TX_EVENTS connection events, and at least one notification.
+ */
+static uint32_t TRSPX_tx_budget(void)
+{
+    uint32_t budget = TRSPX_TX_EVENTS * TRSPX_PDU_PER_EVENT * LL_PDU_SIZE;
+
+    if(budget < TRSPX_mtu + NOTIFY_OVERHEAD)
+        budget = TRSPX_mtu + NOTIFY_OVERHEAD;
+    return budget;
+}
+
 void _LeXport_RxCB(ATT_CB_TYPE type, uint8_t linkindex, uint16_t handle)
 {
     uint16_t att_current_Len;
@@ -44,6 +75,92 @@ void TRSPX_send(uint16_t len)
     }
 }
 
+/*
+ * Queues UART data for notification and pumps what can go out now. flush
+ * lets the last partial MTU go, call it with true when the UART went idle.
+ * Returns the number of bytes queued; the rest is dropped.
+ */
+uint16_t TRSPX_receive(const uint8_t *data, uint16_t len, bool flush)
+{
+    uint16_t i, space;
+
+    space = TRSPX_queue_space();
+    if(len > space)
+    {
+        TRSPX_stats.dropped += len - space;
+        len = space;
+    }
+    for(i = 0; i < len; i++)
+        TRSPX_txq[(uint16_t)(TRSPX_txq_widx + i) % TRSPX_TXQ_SIZE] = data[i];
+    TRSPX_txq_widx += len;
+    if(flush)
+        TRSPX_txq_flush = true;
+
+    TRSPX_pump();
+    return len;
+}
+
+uint16_t TRSPX_queue_space(void)
+{
+    return TRSPX_TXQ_SIZE - TXQ_COUNT();
+}
+
+/* True when TRSPX_pump() would send something now */
+bool TRSPX_pump_ready(void)
+{
+    uint16_t cnt = TXQ_COUNT();
+
+    if((TRSPX_ble_status != BLE_CONNECTED) || !cnt)
+        return false;
+    if((cnt < TRSPX_mtu) && !TRSPX_txq_flush)
+        return false;
+    return BT_Pending_TxCnt() + (cnt < TRSPX_mtu ? cnt : TRSPX_mtu) + NOTIFY_OVERHEAD <= TRSPX_tx_budget();
+}
+
+/*
+ * Sends queued data as notifications of up to TRSPX_mtu bytes, back to back,
+ * until the stack holds TRSPX_tx_budget() bytes. Call it from the same
+ * interrupt priority as the stack.
+ */
+void TRSPX_pump(void)
+{
+    uint16_t cnt, len, i;
+
+    if(TRSPX_ble_status != BLE_CONNECTED)
+        return;
+
+    while((cnt = TXQ_COUNT()) != 0)
+    {
+        len = (cnt < TRSPX_mtu) ? cnt : TRSPX_mtu;
+        if((len < TRSPX_mtu) && !TRSPX_txq_flush)
+            break;  /* wait for a full MTU or the UART timeout */
+        if(BT_Pending_TxCnt() + len + NOTIFY_OVERHEAD > TRSPX_tx_budget())
+        {
+            TRSPX_stats.held++;
+            break;
+        }
+
+        for(i = 0; i < len; i++)
+            TRSPX_Read_Data[i] = TRSPX_txq[(uint16_t)(TRSPX_txq_ridx + i) % TRSPX_TXQ_SIZE];
+        TRSPX_txq_ridx += len;
+        TRSPX_send(len);
+
+        TRSPX_stats.notify++;
+        TRSPX_stats.bytes += len;
+        if(len == TRSPX_mtu)
+            TRSPX_stats.full++;
+    }
+    if(!TXQ_COUNT())
+        TRSPX_txq_flush = false;
+}
+
+/* Drops queued data, on disconnection */
+void TRSPX_reset(void)
+{
+    TRSPX_txq_ridx = TRSPX_txq_widx;
+    TRSPX_txq_flush = false;
+}
+
 void TRSPX_service_init(void)
 {
     trspx_init_para trspx_para =
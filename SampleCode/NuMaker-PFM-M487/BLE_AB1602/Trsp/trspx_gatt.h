@@ -9,8 +9,36 @@ NOTES
 #ifndef __TRSPX_GATT_HH__
 #define __TRSPX_GATT_HH__
 
+#include <stdbool.h>
 #include "service_trspx.h"
 
+/******************************************************************************/
+/* notification pipeline                                                      */
+/******************************************************************************/
+/* UART bytes waiting to be notified, a power of two */
+#ifndef TRSPX_TXQ_SIZE
+#define TRSPX_TXQ_SIZE             1024
+#endif
+/* LL data PDUs (27 bytes) the controller sends per connection event */
+#ifndef TRSPX_PDU_PER_EVENT
+#define TRSPX_PDU_PER_EVENT        4
+#endif
+/* connection events of data kept queued in the stack */
+#ifndef TRSPX_TX_EVENTS
+#define TRSPX_TX_EVENTS            2
+#endif
+
+typedef struct
+{
+    uint32_t notify;       /* notifications sent */
+    uint32_t bytes;        /* payload bytes notified */
+    uint32_t full;         /* notifications carrying a full MTU */
+    uint32_t held;         /* pump stops because the stack held a full budget */
+    uint32_t dropped;      /* UART bytes lost because the queue was full */
+} TRSPX_STATS;
+
+extern TRSPX_STATS TRSPX_stats;
+
 
 extern uint8_t TRSPX_Write_Data[200];
 extern uint8_t TRSPX_Read_Data[200];
@@ -18,5 +46,10 @@ extern uint8_t TRSPX_CCCD_Data[2];
 
 void TRSPX_service_init(void);
 void TRSPX_send(uint16_t len);
+uint16_t TRSPX_receive(const uint8_t *data, uint16_t len, bool flush);
+uint16_t TRSPX_queue_space(void);
+bool TRSPX_pump_ready(void);
+void TRSPX_pump(void);
+void TRSPX_reset(void);
 
 #endif
@@ -6,18 +6,20 @@
 #include <stddef.h>
 #include "M480.h"
 #include "ab_queue.h"
+#include "bt_porting_spi.h"
 /******************************************************************************
  * typedef
  ******************************************************************************/
-typedef struct
+typedef struct spi_tran_entry_s
 {
+    struct spi_tran_entry_s *next;
     uint16_t txlen;
     uint16_t rxlen;
     uint8_t *rxbuf;
     void(*tran_complete)(uint8_t *rxbuf, uint16_t rxlen);
     uint8_t *rxbuf_orig;
     uint16_t rxlen_orig;
-    uint8_t is_rxbuf_self_create:1;
+    uint8_t is_pool:1;
     uint8_t is_half_duplex : 1;
     uint8_t __attribute__ ((aligned(4)))
     txbuf[1];   //because nuvoton's PDMA can't allow non 4 aligned address
@@ -26,19 +28,35 @@ typedef struct
 #define DMA_Master_TX 3
 #define DMA_Master_RX 4
 
+#if (BT_SPI_SLOT_NUM > 32)
+#error "BT_SPI_SLOT_NUM must not exceed 32"
+#endif
+
+/*transaction queue and pool are shared by the stack's callers and the PDMA ISR*/
+#define SPI_LOCK()      uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define SPI_UNLOCK()    __set_PRIMASK(primask)
+
+#define IS_TX_ONLY(e)   ((e)->is_half_duplex && !(e)->rxlen)
+
 #if defined(UART_RX_USE_PDMA)
 #define UART_RX_PDMA_CH    1
-void TRSPX_send(uint16_t len);
-void UART1_RX_Recv(void);
-extern uint32_t TRSPX_mtu;
+void UART1_RX_Done(bool is_timeout);
 #endif
 
 /******************************************************************************
  * Variable
  ******************************************************************************/
-static void *tran_queue = NULL;
+static spi_tran_entry *tran_head = NULL;
+static spi_tran_entry *tran_tail = NULL;
+static spi_tran_entry *tran_cur = NULL;
+static uint32_t tran_pool[BT_SPI_SLOT_NUM][BT_SPI_SLOT_SIZE / 4];
+static uint32_t tran_pool_free = (uint32_t)((1ULL << BT_SPI_SLOT_NUM) - 1);
+#if BT_SPI_COALESCE
+static uint32_t spi_burst[BT_SPI_BURST_SIZE / 4];
+#endif
 static void (*bt_data_rdy)(void) = NULL;
 static uint8_t spi_busy = false;
+volatile bt_spi_stats_t bt_spi_stats;
 /******************************************************************************
  * Prototype
  ******************************************************************************/
@@ -49,69 +67,84 @@ static void free_spi_tran_entry(spi_tran_entry* entry);
  ******************************************************************************/
 static void free_spi_tran_entry(spi_tran_entry* entry)
 {
-    if(entry->is_rxbuf_self_create)
+    uint32_t slot;
+
+    if(entry->is_pool)
     {
-        free(entry->rxbuf);
+        slot = ((uint32_t)entry - (uint32_t)tran_pool) / sizeof(tran_pool[0]);
+        SPI_LOCK();
+        tran_pool_free |= 1UL << slot;
+        SPI_UNLOCK();
     }
-    AB_queue_entry_free(entry);
+    else
+        AB_queue_entry_free(entry);
 }
 
+/*
+ * Slots come from a static pool; only transactions larger than a slot go to
+ * the heap. Received data is written over the copied tx data (PDMA reads each
+ * tx byte before its rx byte is clocked in), so no rx buffer is allocated.
+ */
 static spi_tran_entry *alloc_spi_tran_entry(uint8_t *txbuf, uint16_t txlen,
         uint8_t *rxbuf, uint16_t rxlen,
         uint8_t is_half_duplex, void(*tran_complete)(uint8_t *, uint16_t))
 {
-    spi_tran_entry *entry;
-    /*if user didn't provide rx buf, we need to create one*/
+    spi_tran_entry *entry = NULL;
+    uint32_t size, slot;
+
     if(is_half_duplex)
-        entry = AB_queue_entry_alloc(sizeof(spi_tran_entry) + (txlen + rxlen) - 1);
+        size = sizeof(spi_tran_entry) + (txlen + rxlen) - 1;
     else
-        entry = AB_queue_entry_alloc(sizeof(spi_tran_entry) + txlen - 1);
-
-    if(!entry)
-        return NULL;
-
-    entry->is_half_duplex = is_half_duplex;
+        size = sizeof(spi_tran_entry) + txlen - 1;
 
-    if(is_half_duplex)
+    if(size <= BT_SPI_SLOT_SIZE)
     {
-        if(rxlen)
+        SPI_LOCK();
+        if(tran_pool_free)
         {
-            entry->rxbuf_orig = rxbuf;
-            entry->rxlen_orig = rxlen;
-            rxbuf = malloc(rxlen + txlen);
-            entry->is_rxbuf_self_create = true;
-        }
-        else
-        {
-            entry->rxbuf_orig = 0;
-            entry->rxlen_orig = 0;
-            entry->is_rxbuf_self_create = false;
+            slot = __CLZ(__RBIT(tran_pool_free));
+            tran_pool_free &= ~(1UL << slot);
+            entry = (spi_tran_entry *)tran_pool[slot];
         }
+        SPI_UNLOCK();
     }
+
+    if(entry)
+        entry->is_pool = true;
     else
     {
-        if(rxlen && !rxbuf)
-        {
-            entry->rxbuf_orig = rxbuf;
-            rxbuf = malloc(rxlen);
-            entry->is_rxbuf_self_create = true;
-        }
-        else
-            entry->is_rxbuf_self_create = false;
+        entry = AB_queue_entry_alloc(size);
+        if(!entry)
+            return NULL;
+        entry->is_pool = false;
+        bt_spi_stats.heap++;
     }
+
+    entry->next = NULL;
+    entry->is_half_duplex = is_half_duplex;
     entry->tran_complete = tran_complete;
     if(is_half_duplex)
     {
         if(rxlen)
+        {
+            entry->rxbuf_orig = rxbuf;
+            entry->rxlen_orig = rxlen;
             entry->rxlen = rxlen + txlen;
+            rxbuf = entry->txbuf;
+        }
         else
+        {
+            entry->rxbuf_orig = 0;
+            entry->rxlen_orig = 0;
             entry->rxlen = 0;
-
+        }
         entry->txlen = txlen + rxlen;
         memcpy(entry->txbuf, txbuf, txlen+rxlen/*for test*/);
     }
     else
     {
+        if(rxlen && !rxbuf)
+            rxbuf = entry->txbuf;
         entry->rxlen = rxlen;
         entry->txlen = txlen;
         memcpy(entry->txbuf, txbuf, txlen);
@@ -120,6 +153,29 @@ static spi_tran_entry *alloc_spi_tran_entry(uint8_t *txbuf, uint16_t txlen,
     return entry;
 }
 
+static void complete_spi_tran_entry(spi_tran_entry *entry)
+{
+    uint8_t *rx;
+
+    bt_spi_stats.tran++;
+    if(entry->tran_complete)
+    {
+        if(entry->is_half_duplex)
+        {
+            rx = &entry->rxbuf[entry->rxlen - entry->rxlen_orig];
+            if(entry->rxbuf_orig)
+            {
+                memcpy(entry->rxbuf_orig, rx, entry->rxlen_orig);
+                rx = entry->rxbuf_orig;
+            }
+            entry->tran_complete(rx, entry->rxlen_orig);
+        }
+        else
+            entry->tran_complete(entry->rxbuf, entry->rxlen);
+    }
+    free_spi_tran_entry(entry);
+}
+
 void GPA_IRQHandler(void)
 {
     if(GPIO_GET_INT_FLAG(PA, BIT4))
@@ -130,43 +186,99 @@ void GPA_IRQHandler(void)
     }
 }
 
+#if BT_SPI_COALESCE
+/*
+ * Moves the write-only transactions queued behind entry into spi_burst after
+ * it. They stay linked to entry and complete with it. Returns the burst length,
+ * 0 if nothing could be added.
+ */
+static uint16_t spi_burst_build(spi_tran_entry *entry)
+{
+    spi_tran_entry *last = entry;
+    uint32_t len = entry->txlen;
+    uint32_t cnt = 1;
+
+    SPI_LOCK();
+    while(tran_head && IS_TX_ONLY(tran_head) &&
+            (len + tran_head->txlen <= BT_SPI_BURST_SIZE))
+    {
+        last->next = tran_head;
+        last = tran_head;
+        len += tran_head->txlen;
+        cnt++;
+        tran_head = tran_head->next;
+        if(!tran_head)
+            tran_tail = NULL;
+    }
+    last->next = NULL;
+    SPI_UNLOCK();
+
+    if(cnt == 1)
+        return 0;
+
+    len = 0;
+    for(last = entry; last; last = last->next)
+    {
+        memcpy((uint8_t *)spi_burst + len, last->txbuf, last->txlen);
+        len += last->txlen;
+    }
+    bt_spi_stats.burst++;
+    bt_spi_stats.burst_tran += cnt;
+    return len;
+}
+#endif
+
 void SPITransactionStart(spi_tran_entry *entry)
 {
+    uint8_t *txbuf = entry->txbuf;
+    uint16_t txlen = entry->txlen;
+
     if(((uint32_t)entry->txbuf & 0x3) || ((uint32_t)entry->rxbuf & 0x3))
         printf("spi (%d, %d) = (%x, %x)\n", entry->txlen, entry->rxlen, entry->txbuf, entry->rxbuf);
 
+#if BT_SPI_COALESCE
+    if(IS_TX_ONLY(entry))
+    {
+        uint16_t len = spi_burst_build(entry);
+        if(len)
+        {
+            txbuf = (uint8_t *)spi_burst;
+            txlen = len;
+        }
+    }
+#endif
+
     spi_busy = true;
+    tran_cur = entry;
+    bt_spi_stats.bytes += txlen;
     /* Disable SPI DMA function */
     SPI_DISABLE_RX_PDMA(SPI0);
     SPI_DISABLE_TX_PDMA(SPI0);
+    /* The previous transaction has been clocked in completely, one clear is enough */
+    SPI_ClearRxFIFO(SPI0);
     if(entry->rxlen)
     {
         SPI0->PDMACTL |= SPI_PDMACTL_PDMARST_Msk;
-        while(SPI0->STATUS & (SPI_STATUS_RXEMPTY_Msk | SPI_STATUS_RXFULL_Msk) != SPI_STATUS_RXEMPTY_Msk)
-            SPI0->FIFOCTL |= SPI_FIFOCTL_RXFBCLR_Msk;
 
         /* Set source/destination address and attributes */
         PDMA_SetTransferAddr(PDMA, DMA_Master_RX, (uint32_t)&SPI0->RX, PDMA_SAR_FIX,
                              (uint32_t)entry->rxbuf, PDMA_DAR_INC);
 
-        PDMA_SetTransferAddr(PDMA, DMA_Master_TX, (uint32_t)entry->txbuf, PDMA_SAR_INC,
+        PDMA_SetTransferAddr(PDMA, DMA_Master_TX, (uint32_t)txbuf, PDMA_SAR_INC,
                              (uint32_t)&SPI0->TX, PDMA_DAR_FIX);
         /* Set transfer width (8 bits) and transfer count */
-        PDMA_SetTransferCnt(PDMA, DMA_Master_TX, PDMA_WIDTH_8, entry->txlen);
+        PDMA_SetTransferCnt(PDMA, DMA_Master_TX, PDMA_WIDTH_8, txlen);
         PDMA_SetTransferCnt(PDMA, DMA_Master_RX, PDMA_WIDTH_8, entry->rxlen);
     }
-    else //tx only
+    else //tx only, rx is discarded over the tx data
     {
-        while(SPI0->STATUS & (SPI_STATUS_RXEMPTY_Msk | SPI_STATUS_RXFULL_Msk) != SPI_STATUS_RXEMPTY_Msk)
-            SPI0->FIFOCTL |= SPI_FIFOCTL_RXFBCLR_Msk;
-
         PDMA_SetTransferAddr(PDMA, DMA_Master_RX, (uint32_t)&SPI0->RX, PDMA_SAR_FIX,
-                             (uint32_t)entry->txbuf, PDMA_DAR_INC);
+                             (uint32_t)txbuf, PDMA_DAR_INC);
 
-        PDMA_SetTransferAddr(PDMA, DMA_Master_TX, (uint32_t)entry->txbuf, PDMA_SAR_INC,
+        PDMA_SetTransferAddr(PDMA, DMA_Master_TX, (uint32_t)txbuf, PDMA_SAR_INC,
                              (uint32_t)&SPI0->TX, PDMA_DAR_FIX);
-        PDMA_SetTransferCnt(PDMA, DMA_Master_TX, PDMA_WIDTH_8, entry->txlen);
-        PDMA_SetTransferCnt(PDMA, DMA_Master_RX, PDMA_WIDTH_8, entry->txlen);
+        PDMA_SetTransferCnt(PDMA, DMA_Master_TX, PDMA_WIDTH_8, txlen);
+        PDMA_SetTransferCnt(PDMA, DMA_Master_RX, PDMA_WIDTH_8, txlen);
     }
     /* Set request source; set basic mode. */
     PDMA_SetTransferMode(PDMA, DMA_Master_RX, PDMA_SPI0_RX, FALSE, 0);
@@ -185,38 +297,59 @@ void SPITransactionStart(spi_tran_entry *entry)
 
 static void HandlerSPIComplete(spi_tran_entry *entry)
 {
-    spi_tran_entry *new_entry;
-
-    spi_busy = false;
+    spi_tran_entry *new_entry, *next;
 
-    //check for new transaction
-    new_entry = AB_queue_pop(tran_queue);
+    //check for new transaction, start it before running the callbacks
+    SPI_LOCK();
+    new_entry = tran_head;
     if(new_entry)
     {
+        tran_head = new_entry->next;
+        if(!tran_head)
+            tran_tail = NULL;
+        new_entry->next = NULL;
+    }
+    else
+    {
+        spi_busy = false;
+        tran_cur = NULL;
+    }
+    SPI_UNLOCK();
+
+    if(new_entry)
         SPITransactionStart(new_entry);
+
+    //info save complete and free save entry, a burst completes all its entries
+    for(; entry; entry = next)
+    {
+        next = entry->next;
+        complete_spi_tran_entry(entry);
     }
+}
 
-    //info save complete
-    if(entry->tran_complete)
+/* Starts entry now if SPI is idle, else queues it. Returns false when queued. */
+static bool SPITransactionSubmit(spi_tran_entry *entry)
+{
+    bool is_idle;
+
+    SPI_LOCK();
+    is_idle = !spi_busy;
+    if(is_idle)
+        spi_busy = true;
+    else
     {
-        if(entry->is_half_duplex)
-        {
-            if(entry->rxbuf_orig)
-            {
-                memcpy(entry->rxbuf_orig, &entry->rxbuf[entry->rxlen - entry->rxlen_orig],
-                       entry->rxlen_orig);
-                entry->tran_complete(entry->rxbuf_orig, entry->rxlen_orig);
-            }
-            else
-                entry->tran_complete(&entry->rxbuf[entry->rxlen - entry->rxlen_orig],
-                                     entry->rxlen_orig);
-        }
+        if(tran_tail)
+            tran_tail->next = entry;
         else
-            entry->tran_complete(entry->rxbuf, entry->rxlen);
+            tran_head = entry;
+        tran_tail = entry;
+        bt_spi_stats.queued++;
     }
-    //free save entry
-    free_spi_tran_entry(entry);
+    SPI_UNLOCK();
 
+    if(is_idle)
+        SPITransactionStart(entry);
+    return is_idle;
 }
 
 void PDMA_IRQHandler (void)
@@ -234,19 +367,14 @@ void PDMA_IRQHandler (void)
         PDMA->TOUTEN &= ~(1 << UART_RX_PDMA_CH);
         PDMA->TOUTEN |= (1 << UART_RX_PDMA_CH);
 
-        uint8_t cnt;
-        cnt = TRSPX_mtu - 1 - ((PDMA->DSCT[UART_RX_PDMA_CH].CTL & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos);
-        TRSPX_send(cnt);
-
-        /* Set transfer count and trigger again */
-        PDMA_SetTransferCnt(PDMA, UART_RX_PDMA_CH, PDMA_WIDTH_8, TRSPX_mtu);
+        UART1_RX_Done(true);
         pdma_tout = 1;
         /* Get the latest status for SPI PDMA again */
         status = PDMA_GET_INT_STATUS(PDMA);
     }
 #endif
 
-    entry = (spi_tran_entry*) (PDMA->DSCT[DMA_Master_TX].SA - offsetof(spi_tran_entry, txbuf));
+    entry = tran_cur;
     if(status & PDMA_INTSTS_ABTIF_Msk)  /* Target Abort */
     {
         PDMA->ABTSTS = PDMA->ABTSTS;
@@ -258,14 +386,6 @@ void PDMA_IRQHandler (void)
         {
             /* Clear PDMA transfer done interrupt flag */
             PDMA_CLR_TD_FLAG(PDMA, (1 << DMA_Master_TX));
-
-            /*
-            if(!entry->rxlen) //TX only
-            {
-                SPI0->STATUS |= SPI_STATUS_RX_OVERRUN_Msk;
-                SPI0->FIFO_CTL |= SPI_FIFO_CTL_RX_CLR_Msk;
-                HandlerSPIComplete(entry);
-            }*/
         }
 
         /* Rx PDMA transfer done interrupt flag */
@@ -274,13 +394,9 @@ void PDMA_IRQHandler (void)
             /* Clear PDMA transfer done interrupt flag */
             PDMA_CLR_TD_FLAG(PDMA, (1 << DMA_Master_RX));
 
-            //PDMA_STOP(DMA_Master_RX);
-
-            /* Handle PDMA transfer done interrupt event */
-            //if(entry->rxlen) //TX/RX both
-            {
+            /* Handle PDMA transfer done interrupt event, rx done means the transaction is clocked out */
+            if(entry)
                 HandlerSPIComplete(entry);
-            }
         }
 
 #if defined(UART_RX_USE_PDMA)
@@ -290,10 +406,7 @@ void PDMA_IRQHandler (void)
             /* Clear PDMA transfer done interrupt flag */
             PDMA_CLR_TD_FLAG(PDMA, (1 << UART_RX_PDMA_CH));
 
-            TRSPX_send(TRSPX_mtu);
-
-            /* Set UART RX PAMA again */
-            UART1_RX_Recv();
+            UART1_RX_Done(false);
         }
 #endif
     }
@@ -308,9 +421,9 @@ bool AB_SPI_Open(int foo, void *deadbeef)
     /*---------------------------------------------------------------------------------------------------------*/
     /* Init SPI                                                                                                */
     /*---------------------------------------------------------------------------------------------------------*/
-    /* Configure SPI0 as a master, SPI clock rate 2MHz,
+    /* Configure SPI0 as a master, SPI clock rate BT_SPI_CLOCK,
        clock idle low, 8-bit transaction, drive output on falling clock edge and latch input on rising edge. */
-    SPI_Open(SPI0, SPI_MASTER, SPI_MODE_0, 8, 1000000);
+    SPI_Open(SPI0, SPI_MASTER, SPI_MODE_0, 8, BT_SPI_CLOCK);
     /* Enable the automatic hardware slave selection function. Select the SPI0_SS pin and configure as low-active. */
     SPI_EnableAutoSS(SPI0, SPI_SS, SPI_SS_ACTIVE_LOW);
     /* Set TX FIFO threshold, enable TX FIFO threshold interrupt and RX FIFO time-out interrupt */
@@ -325,7 +438,6 @@ bool AB_SPI_Open(int foo, void *deadbeef)
     PDMA_EnableInt(PDMA, DMA_Master_RX, PDMA_INT_TRANS_DONE);
     /* Set PDMA SPI0 TX & RX Selection */
     NVIC_EnableIRQ(PDMA_IRQn);
-    tran_queue = AB_queue_alloc();
     return true;
 }
 
@@ -344,18 +456,7 @@ bool AB_SPI_WriteThenRead(int spi_num, uint8_t *txbuf, uint16_t txlen, uint8_t *
     entry = alloc_spi_tran_entry(txbuf, txlen, rxbuf, rxlen, 1, tran_complete);
     if(!entry)
         return false;
-    if(spi_busy || SPI_GetStatus(SPI0, SPI_BUSY_MASK))
-    {
-        //printf("busy\n");
-        AB_queue_push(tran_queue, entry);
-        return false;
-    }
-    else
-    {
-        spi_busy = true;
-        SPITransactionStart(entry);
-    }
-    return true;
+    return SPITransactionSubmit(entry);
 }
 
 
@@ -366,17 +467,7 @@ bool AB_SPI_WriteAndRead(int spi_num, uint8_t *txbuf, uint8_t *rxbuf,
     entry = alloc_spi_tran_entry(txbuf, rxlen, rxbuf, rxlen, 0, tran_complete);
     if(!entry)
         return false;
-    if(spi_busy || SPI_GetStatus(SPI0, SPI_BUSY_MASK))
-    {
-        //printf("busy\n");
-        AB_queue_push(tran_queue, entry);
-        return false;
-    }
-    else
-    {
-        SPITransactionStart(entry);
-    }
-    return true;
+    return SPITransactionSubmit(entry);
 }
 
 
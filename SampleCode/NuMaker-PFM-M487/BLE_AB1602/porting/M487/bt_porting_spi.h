@@ -0,0 +1,52 @@
+#ifndef BT_PORTING_SPI_HH
+#define BT_PORTING_SPI_HH
+
+#include <stdint.h>
+
+/******************************************************************************
+ * config
+ ******************************************************************************/
+/*SPI0 clock to the AB1602*/
+#ifndef BT_SPI_CLOCK
+#define BT_SPI_CLOCK        1000000
+#endif
+
+/*transaction slots kept in static memory, header + tx data of one slot in bytes*/
+#ifndef BT_SPI_SLOT_NUM
+#define BT_SPI_SLOT_NUM     8
+#endif
+#ifndef BT_SPI_SLOT_SIZE
+#define BT_SPI_SLOT_SIZE    288
+#endif
+
+/*
+ * Send queued write-only transactions back to back in one PDMA run (one SS
+ * assertion). Only enable it for controller firmware that accepts several HCI
+ * packets in one SPI frame; the AB1602 default expects one packet per frame.
+ */
+#ifndef BT_SPI_COALESCE
+#define BT_SPI_COALESCE     0
+#endif
+#ifndef BT_SPI_BURST_SIZE
+#define BT_SPI_BURST_SIZE   512
+#endif
+
+/******************************************************************************
+ * typedef
+ ******************************************************************************/
+typedef struct
+{
+    uint32_t tran;          /*transactions completed*/
+    uint32_t bytes;         /*bytes clocked on SPI*/
+    uint32_t queued;        /*transactions that had to wait for the previous one*/
+    uint32_t heap;          /*transactions too large for a slot, taken from the heap*/
+    uint32_t burst;         /*PDMA runs carrying more than one transaction*/
+    uint32_t burst_tran;    /*transactions carried in those runs*/
+} bt_spi_stats_t;
+
+/******************************************************************************
+ * Variable
+ ******************************************************************************/
+extern volatile bt_spi_stats_t bt_spi_stats;
+
+#endif
@@ -74,6 +74,17 @@ extern uint32_t SystemCoreClock;
 #define configGENERATE_RUN_TIME_STATS   0
 #define configUSE_QUEUE_SETS            1
 
+/* Set to 2 to stop the tick and enter Power-down while idle, see
+FreeRTOS/Tickless/tickless_m480.h.  main() then starts the port and registers
+the EMAC, USB and lwIP budgets. */
+#define configUSE_TICKLESS_IDLE         0
+#if ( configUSE_TICKLESS_IDLE == 2 )
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vM480TicklessSleep( xExpectedIdleTime )
+#if defined( __ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+void vM480TicklessSleep( uint32_t xExpectedIdleTime );
+#endif
+#endif
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES       0
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
@@ -58,6 +58,7 @@
 
 /* Hardware and starter kit includes. */
 #include "NuMicro.h"
+#include "tickless_m480.h"
 
 #include "lwip/netifapi.h"
 #include "lwip/tcpip.h"
@@ -140,6 +141,16 @@ int main(void)
 
     printf("FreeRTOS is starting ...\n");
 
+#if( configUSE_TICKLESS_IDLE == 2 )
+    /* Stop the tick while idle and enter Power-down unless the EMAC or a USB
+    controller is running.  The EMAC receives from ETH_init() on, so with the
+    network up the idle task sleeps in WFI, still without ticks, until the next
+    task or lwIP timeout is due or a frame arrives. */
+    vM480TicklessInit();
+    xM480TicklessAddBudget( ulM480TicklessEmacBudget );
+    xM480TicklessAddBudget( ulM480TicklessUsbBudget );
+#endif
+
     /* Start the scheduler. */
     vTaskStartScheduler();
 
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   IEEE 1588-2008 (PTPv2) ordinary clock over UDP/IPv4 header
+ *
+ * One port, end-to-end delay mechanism, two-step master. Needs TIME_STAMPING, LWIP_UDP and
+ * LWIP_IGMP, two UDP PCBs and three sys_timeout() entries on top of the application's own.
+ */
+#ifndef __LWIP_PTP_H__
+#define __LWIP_PTP_H__
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/netif.h"
+#include "lwip/ptp_servo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Port states, numbered as in IEEE 1588-2008 table 8
+#define PTP_STATE_INITIALIZING      1
+#define PTP_STATE_LISTENING         4
+#define PTP_STATE_MASTER            6
+#define PTP_STATE_UNCALIBRATED      8
+#define PTP_STATE_SLAVE             9
+
+struct ptp_config
+{
+    u8_t domain;                        // domainNumber, 0
+    u8_t slave_only;                    // 1: never become master, 1
+    u8_t priority1;                     // 128
+    u8_t priority2;                     // 128
+    u8_t clock_class;                   // 248, forced to 255 when slave only
+    u8_t clock_accuracy;                // 0xFE, unknown
+    u16_t offset_scaled_log_variance;   // 0xFFFF
+    u8_t time_source;                   // 0xA0, internal oscillator
+    s16_t current_utc_offset;           // TAI - UTC, 37 s
+    s8_t log_announce_interval;         // 1 (2 s)
+    s8_t log_sync_interval;             // -3 (1/8 s), used as master
+    s8_t log_min_delay_req_interval;    // -3, used as master and until a master tells otherwise
+    u8_t announce_receipt_timeout;      // 3 announce intervals
+    s32_t step_threshold;               // Offset that steps the clock once locked, ns; 0: slew only
+    s32_t first_step_threshold;         // Offset stepped on the first lock to a master, ns, 20000
+    s32_t max_ppb;                      // Frequency adjustment limit, PTP_SERVO_MAX_PPB
+    u8_t delay_filter_len;              // Path delay median window, PTP_DELAY_FILTER_LEN
+};
+
+struct ptp_status
+{
+    u8_t state;                         // PTP_STATE_xxx
+    u8_t parent_port_id[10];            // Port identity of the master, own identity as master
+    u8_t gm_id[8];                      // Grandmaster clock identity
+    uint32_t servo_state;               // PTP_SERVO_xxx
+    int64_t offset;                     // Last offset from master, ns
+    int64_t mean_path_delay;            // Filtered mean path delay, ns
+    s32_t freq_ppb;                     // Frequency adjustment in use
+    u32_t steps;                        // Clock steps
+    u32_t announce_rx;
+    u32_t sync_rx;
+    u32_t follow_up_rx;
+    u32_t delay_req_tx;
+    u32_t delay_resp_rx;
+    u32_t announce_tx;
+    u32_t sync_tx;
+    u32_t delay_resp_tx;
+    u32_t missing_ts;                   // Event messages without a hardware time stamp
+    struct ptp_stats_result offset_stats;   // Offset from master while locked, since the last reset
+    struct ptp_stats_result delay_stats;    // Filtered mean path delay, since the last reset
+};
+
+void ptp_config_default(struct ptp_config *cfg);
+err_t ptp_start(struct netif *netif, const struct ptp_config *cfg);
+void ptp_stop(void);
+void ptp_get_status(struct ptp_status *st, u8_t reset_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWIP_PTP_H__ */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   PTP clock servo, path delay filter and offset statistics header
+ *
+ * Free of hardware and lwIP dependencies; Tool/PtpSim builds ptp_servo.c on the host
+ * and runs it against a simulated EMAC time stamp counter.
+ */
+#ifndef __LWIP_PTP_SERVO_H__
+#define __LWIP_PTP_SERVO_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef PTP_SERVO_KP_SCALE
+#define PTP_SERVO_KP_SCALE          0.7f    // Proportional gain at a 1 s sync interval
+#endif
+#ifndef PTP_SERVO_KI_SCALE
+#define PTP_SERVO_KI_SCALE          0.3f    // Integral gain at a 1 s sync interval
+#endif
+#ifndef PTP_SERVO_MAX_PPB
+#define PTP_SERVO_MAX_PPB           500000  // Frequency adjustment limit
+#endif
+#ifndef PTP_DELAY_FILTER_LEN
+#define PTP_DELAY_FILTER_LEN        9       // Path delay samples in the median window, at most 16
+#endif
+
+// Results of ptp_servo_sample()
+#define PTP_SERVO_UNLOCKED          0       // Collecting samples, keep the returned frequency
+#define PTP_SERVO_JUMP              1       // Step the clock by -offset, then apply the frequency
+#define PTP_SERVO_LOCKED            2       // Apply the frequency
+
+struct ptp_servo
+{
+    float kp;                   // Proportional gain for the current sync interval
+    float ki;                   // Integral gain for the current sync interval
+    float drift;                // Integral term, ppb
+    float ppb;                  // Last frequency adjustment
+    int64_t step_threshold;     // Offset that forces a step once locked, ns; 0: never step again
+    int64_t first_step_threshold; // Offset that is stepped instead of slewed on the first lock, ns
+    int64_t offset0;            // First sample while unlocked
+    int64_t local0;             // Its local receive time
+    int32_t max_ppb;            // Adjustment limit
+    uint32_t count;             // Samples since the last reset
+    uint32_t first_update;      // 1 until the first lock, which may use first_step_threshold
+    uint32_t state;             // PTP_SERVO_UNLOCKED, PTP_SERVO_JUMP or PTP_SERVO_LOCKED
+};
+
+struct ptp_delay_filter
+{
+    int64_t sample[PTP_DELAY_FILTER_LEN];
+    uint32_t len;               // Window length
+    uint32_t count;             // Samples held, up to len
+    uint32_t idx;               // Next slot
+};
+
+struct ptp_stats
+{
+    uint32_t count;
+    int64_t min;
+    int64_t max;
+    double mean;                // Running mean (Welford)
+    double m2;                  // Sum of squared differences from the mean
+    double sumsq;               // Sum of squares
+};
+
+struct ptp_stats_result
+{
+    uint32_t count;             // Samples
+    int32_t min;                // ns
+    int32_t max;                // ns
+    int32_t mean;               // ns
+    uint32_t rms;               // Root mean square, ns
+    uint32_t stddev;            // Standard deviation (jitter), ns
+};
+
+void ptp_servo_init(struct ptp_servo *s, int32_t max_ppb, int64_t step_threshold, int64_t first_step_threshold);
+void ptp_servo_interval(struct ptp_servo *s, float interval);
+void ptp_servo_reset(struct ptp_servo *s);
+int32_t ptp_servo_sample(struct ptp_servo *s, int64_t offset, int64_t local_ts, uint32_t *state);
+
+void ptp_delay_filter_init(struct ptp_delay_filter *f, uint32_t len);
+int64_t ptp_delay_filter_add(struct ptp_delay_filter *f, int64_t delay);
+
+void ptp_stats_reset(struct ptp_stats *st);
+void ptp_stats_add(struct ptp_stats *st, int64_t value);
+void ptp_stats_get(const struct ptp_stats *st, struct ptp_stats_result *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWIP_PTP_SERVO_H__ */
@@ -38,12 +38,33 @@ struct ts_timeval
     s32_t nsec;
 };
 
+#define TS_PTP_EVENT_PORT   319     // UDP port of PTP event messages
+#define TS_PTP_ETHERTYPE    0x88F7  // PTP over IEEE 802.3
+#ifndef TS_STAMP_NUM
+#define TS_STAMP_NUM        8       // Time stamps remembered per direction
+#endif
+
+// Identifies a PTP event message: (message type << 16) | sequence id, and a hash of the
+// sourcePortIdentity of the sender
+struct ts_ptp_key
+{
+    u32_t id;
+    u32_t port;
+};
+
 u32_t ts_init(struct ts_timeval *t);
 u32_t ts_update(struct ts_timeval *t);
 u32_t ts_settime(struct ts_timeval *t);
 u32_t ts_gettime(struct ts_timeval *t);
 u32_t ts_adjtimex(s32_t ppb);
 
+u32_t ts_ptp_port_hash(const u8_t *port_id);
+u32_t ts_ptp_classify(const u8_t *frame, u32_t len, struct ts_ptp_key *key);
+void ts_rx_stamp(const u8_t *frame, u32_t len, u32_t sec, u32_t nsec);
+void ts_tx_stamp(const struct ts_ptp_key *key, u32_t sec, u32_t nsec);
+u32_t ts_rx_lookup(u8_t type, u16_t seq, const u8_t *port_id, struct ts_timeval *t);
+u32_t ts_tx_lookup(u8_t type, u16_t seq, const u8_t *port_id, struct ts_timeval *t);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   UDP flow, a fast transmit path for one connected UDP/IPv4 stream header
+ *
+ * A flow is built from a connected udp_pcb. It keeps a ring of frame buffers with the Ethernet,
+ * IPv4 and UDP headers already written, so sending a payload only patches lengths, the IP ID and
+ * the checksums. Needs LWIP_UDP, LWIP_ARP and LWIP_SUPPORT_CUSTOM_PBUF, and ETH_PAD_SIZE 0.
+ */
+#ifndef __LWIP_UDP_FLOW_H__
+#define __LWIP_UDP_FLOW_H__
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "lwip/udp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Header bytes in front of the payload in each frame buffer: Ethernet, IPv4 and UDP
+#define UDP_FLOW_HLEN               42
+
+// pbuf flag of flow frames. A driver may send such a frame in place and drop its reference from
+// its TX interrupt: the frame is one word aligned pbuf and its free hook only marks the buffer free.
+#define PBUF_FLAG_UDP_FLOW          0x80U
+
+// Payload address of frame buffer i, e.g. for a PDMA descriptor that fills it in place
+#define UDP_FLOW_PAYLOAD(flow, i)   ((flow)->buf + (u32_t)(i) * (flow)->buf_size + UDP_FLOW_HLEN)
+
+struct udp_flow;
+
+struct udp_flow_slot
+{
+    struct pbuf_custom pc;              // Handed to netif->linkoutput
+    struct udp_flow *flow;
+    volatile u8_t busy;                 // Until the driver gives up its last reference
+};
+
+struct udp_flow
+{
+    struct netif *netif;
+    struct udp_flow_slot *slot;         // slots entries
+    u8_t *buf;                          // slots * buf_size bytes, word aligned
+    u16_t buf_size;                     // Frame buffer size, a multiple of 4 and at least 60
+    u16_t slots;
+    u16_t head;                         // Next frame buffer to fill
+    u16_t ip_id;
+    u16_t ip_sum;                       // Folded sum of the IP header without length, ID, checksum
+    u16_t udp_sum;                      // Folded sum of pseudo header and UDP ports
+    u8_t chksum;                        // 0: UDP checksum left 0 (UDP_FLAGS_NOCHKSUM on the pcb)
+    u32_t tx;                           // Frames handed to the driver
+    u32_t tx_err;                       // Frames the driver refused
+};
+
+err_t udp_flow_init(struct udp_flow *flow, struct udp_flow_slot *slot, u8_t *buf, u16_t buf_size, u16_t slots);
+err_t udp_flow_connect(struct udp_flow *flow, struct udp_pcb *pcb);
+u8_t *udp_flow_get_buf(struct udp_flow *flow);
+err_t udp_flow_send(struct udp_flow *flow, u16_t len);
+u16_t udp_flow_free_bufs(const struct udp_flow *flow);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWIP_UDP_FLOW_H__ */
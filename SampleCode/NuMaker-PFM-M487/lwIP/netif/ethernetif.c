@@ -54,12 +54,19 @@
 #include "netif/etharp.h"
 //#include "netif/ppp_oe.h"
 #include "netif/m480_eth.h"
+#include "lwip/udp_flow.h"
+#ifdef TIME_STAMPING
+#include "lwip/time_stamp.h"
+#endif
 #include "string.h"
 
 /* Define those to better describe your network interface. */
 #define IFNAME0 'e'
 #define IFNAME1 'n'
 
+/* Shortest frame on the wire, without the FCS */
+#define ETH_MIN_FRAME_LEN 60
+
 
 struct netif *_netif;
 extern u8_t my_mac_addr[6];
@@ -138,6 +145,20 @@ low_level_output(struct netif *netif, struct pbuf *p)
     buf = ETH_get_tx_buf();
     if(buf == NULL)
         return ERR_MEM;
+
+#if LWIP_SUPPORT_CUSTOM_PBUF && !ETH_PAD_SIZE
+    /* A UDP flow frame of at least the minimum size is sent in place; the
+     * driver holds a reference until it is out and drops it in the TX
+     * interrupt, where only the flow's own free hook may run. */
+    if((p->flags & PBUF_FLAG_UDP_FLOW) && (p->next == NULL) && (p->len >= ETH_MIN_FRAME_LEN) &&
+            (((mem_ptr_t)p->payload & 3) == 0))
+    {
+        ETH_trigger_tx(p->len, p);
+        LINK_STATS_INC(link.xmit);
+        return ERR_OK;
+    }
+#endif
+
 #if ETH_PAD_SIZE
     pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
 #endif
@@ -147,11 +168,13 @@ low_level_output(struct netif *netif, struct pbuf *p)
         memcpy((u8_t*)&buf[len], q->payload, q->len);
         len = len + q->len;
     }
-#ifdef TIME_STAMPING
-    ETH_trigger_tx(len, p->flags & PBUF_FLAG_GET_TXTS ? p : NULL);
-#else
+    if(len < ETH_MIN_FRAME_LEN)
+    {
+        /* Zero padding, not what the buffer held before */
+        memset(&buf[len], 0, ETH_MIN_FRAME_LEN - len);
+        len = ETH_MIN_FRAME_LEN;
+    }
     ETH_trigger_tx(len, NULL);
-#endif
 
 #if ETH_PAD_SIZE
     pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
@@ -232,49 +255,15 @@ ethernetif_input(u16_t len, u8_t *buf, u32_t s, u32_t ns)
     struct pbuf *p;
 
 
+#ifdef TIME_STAMPING
+    /* remember the time stamp if this is a PTP event message */
+    ts_rx_stamp(buf, len, s, ns);
+#endif
+
     /* move received packet into a new pbuf */
     p = low_level_input(_netif, len, buf);
     /* no packet could be read, silently ignore this */
     if (p == NULL) return;
-#ifdef TIME_STAMPING
-    p->ts_sec = s;
-    p->ts_nsec = ns;
-#endif
-
-    /* points to packet payload, which starts with an Ethernet header */
-    ethhdr = p->payload;
-
-    switch (htons(ethhdr->type))
-    {
-    /* IP or ARP packet? */
-    case ETHTYPE_IP:
-    case ETHTYPE_ARP:
-#if PPPOE_SUPPORT
-    /* PPPoE packet? */
-    case ETHTYPE_PPPOEDISC:
-    case ETHTYPE_PPPOE:
-#endif /* PPPOE_SUPPORT */
-        /* full packet send to tcpip_thread to process */
-        if (_netif->input(p, _netif)!=ERR_OK)
-        {
-            LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
-            pbuf_free(p);
-            p = NULL;
-        }
-        break;
-
-    default:
-        pbuf_free(p);
-        p = NULL;
-        break;
-    }
-}
-
-#ifdef    TIME_STAMPING
-void
-ethernetif_loopback_input(struct pbuf *p)           // TODO: make sure packet not drop in input()
-{
-    struct eth_hdr *ethhdr;
 
     /* points to packet payload, which starts with an Ethernet header */
     ethhdr = p->payload;
@@ -305,8 +294,6 @@ ethernetif_loopback_input(struct pbuf *p)           // TODO: make sure packet no
     }
 }
 
-#endif
-
 /**
  * Should be called at the beginning of the program to set up the
  * network interface. It calls the function low_level_init() to do the
@@ -4,6 +4,10 @@
  */
 #include "netif/m480_eth.h"
 #include "arch/sys_arch.h"
+#ifdef TIME_STAMPING
+#include "lwip/time_stamp.h"
+#endif
+#include "trace.h"
 
 #define ETH_TRIGGER_RX()    do{EMAC->RXST = 0;}while(0)
 #define ETH_TRIGGER_TX()    do{EMAC->TXST = 0;}while(0)
@@ -24,9 +28,10 @@ struct eth_descriptor volatile *cur_tx_desc_ptr, *cur_rx_desc_ptr, *fin_tx_desc_
 
 u8_t rx_buf[RX_DESCRIPTOR_NUM][PACKET_BUFFER_SIZE];
 u8_t tx_buf[TX_DESCRIPTOR_NUM][PACKET_BUFFER_SIZE];
+// pbuf a descriptor sends in place, released by the TX interrupt
+static struct pbuf *tx_pbuf[TX_DESCRIPTOR_NUM];
 
 extern void ethernetif_input(u16_t len, u8_t *buf, u32_t s, u32_t ns);
-extern void ethernetif_loopback_input(struct pbuf *p);
 
 // PTP source clock is 84MHz (Real chip using PLL). Each tick is 11.90ns
 // Assume we want to set each tick to 100ns.
@@ -37,10 +42,23 @@ extern void ethernetif_loopback_input(struct pbuf *p);
 #ifdef TIME_STAMPING
 #define DEFAULT_ADDNED    0x1E70C600
 #define DEFAULT_INC    0xD7
+
+static u32_t subsec2nsec(u32_t subsec);
 #endif
 
 extern portBASE_TYPE xInsideISR;
 
+// Define ETH_RX_DEFER to move frame processing out of EMAC_RX_IRQHandler into the
+// StdDriver work queue (workq.h). WORKQ_Init() and WORKQ_Start() must be called
+// before ETH_init().
+#ifdef ETH_RX_DEFER
+#include "workq.h"
+#ifndef ETH_RX_DEFER_PRIO
+#define ETH_RX_DEFER_PRIO   WORKQ_PRIO_NORMAL
+#endif
+static int32_t eth_rx_src = -1;
+#endif
+
 
 static void mdio_write(u8_t addr, u8_t reg, u16_t val)
 {
@@ -220,6 +238,10 @@ void ETH_init(u8_t *mac_addr)
                    EMAC_INTEN_TXABTIEN_Msk |
                    EMAC_INTEN_TXCPIEN_Msk |
                    EMAC_INTEN_TXBEIEN_Msk;
+#ifdef ETH_RX_DEFER
+    if (eth_rx_src < 0)
+        eth_rx_src = WORKQ_AddSource("EMAC RX");
+#endif
     /* Limit the max receive frame length to 1514 + 4 */
     EMAC->MRFL = 1518;
     EMAC->RXST = 0;  // trigger Rx
@@ -233,17 +255,13 @@ void  ETH_halt(void)
     EMAC->CTL &= ~(EMAC_CTL_RXON_Msk | EMAC_CTL_TXON_Msk);
 }
 
-void EMAC_RX_IRQHandler(void)
+// Hand received frames to lwIP and give the descriptors back to EMAC
+static void eth_rx_drain(void)
 {
     unsigned int status;
-
-    xInsideISR = pdTRUE;
-    status = EMAC->INTSTS & 0xFFFF;
-    EMAC->INTSTS = status;
-    if (status & EMAC_INTSTS_RXBEIF_Msk)
-    {
-        // Shouldn't goes here, unless descriptor corrupted
-    }
+#ifdef    TIME_STAMPING
+    u32_t ts_sec, ts_nsec;
+#endif
 
     do
     {
@@ -257,17 +275,26 @@ void EMAC_RX_IRQHandler(void)
         if(status & OWNERSHIP_EMAC)
             break;
 
+#ifdef    TIME_STAMPING
+        ts_sec = ts_nsec = 0;
+        if(status & RXFD_RTSAS)
+        {
+            // EMAC wrote the time stamp over the buffer and next pointers
+            ts_nsec = subsec2nsec((u32_t)cur_rx_desc_ptr->buf);
+            ts_sec = (u32_t)cur_rx_desc_ptr->next;
+            cur_rx_desc_ptr->buf = (uint8_t *)cur_rx_desc_ptr->backup1;
+            cur_rx_desc_ptr->next = (struct eth_descriptor *)cur_rx_desc_ptr->backup2;
+        }
+#endif
+
         if (status & RXFD_RXGD)
         {
 
 #ifdef    TIME_STAMPING
-            if(status & RXFD_RTSAS)
-            {
-                cur_rx_desc_ptr->buf = (uint8_t *)fin_tx_desc_ptr->backup1;
-                cur_rx_desc_ptr->next = (struct eth_descriptor *)fin_tx_desc_ptr->backup2;
-            }
-#endif
+            ethernetif_input(status & 0xFFFF, cur_rx_desc_ptr->buf, ts_sec, ts_nsec);
+#else
             ethernetif_input(status & 0xFFFF, cur_rx_desc_ptr->buf, cur_rx_desc_ptr->status2, (u32_t)cur_rx_desc_ptr->next);
+#endif
 
 
         }
@@ -279,17 +306,59 @@ void EMAC_RX_IRQHandler(void)
     while (1);
 
     ETH_TRIGGER_RX();
+}
+
+#ifdef ETH_RX_DEFER
+// Runs from the work queue task. The RX interrupt stays masked in NVIC until all
+// descriptors are drained; frames arriving meanwhile leave INTSTS set, so the
+// interrupt fires again as soon as it is unmasked.
+static void eth_rx_work(void *arg, uint32_t param)
+{
+    eth_rx_drain();
+    NVIC_EnableIRQ(EMAC_RX_IRQn);
+}
+#endif
+
+void EMAC_RX_IRQHandler(void)
+{
+    unsigned int status;
+
+    xInsideISR = pdTRUE;
+    status = EMAC->INTSTS & 0xFFFF;
+    EMAC->INTSTS = status;
+    TRACE_BEGIN(TRACE_ID_EMAC_RX, status);
+    if (status & EMAC_INTSTS_RXBEIF_Msk)
+    {
+        // Shouldn't goes here, unless descriptor corrupted
+    }
+
+#ifdef ETH_RX_DEFER
+    NVIC_DisableIRQ(EMAC_RX_IRQn);
+    if (WORKQ_Post(ETH_RX_DEFER_PRIO, eth_rx_src, eth_rx_work, NULL, 0) != WORKQ_OK)
+    {
+        // queue full, fall back to inline processing
+        eth_rx_drain();
+        NVIC_EnableIRQ(EMAC_RX_IRQn);
+    }
+#else
+    eth_rx_drain();
+#endif
+    TRACE_END(TRACE_ID_EMAC_RX, 0);
     xInsideISR = pdFALSE;
 }
 
 void EMAC_TX_IRQHandler(void)
 {
-    unsigned int cur_entry, status;
+    unsigned int cur_entry, status, idx;
+#ifdef  TIME_STAMPING
+    struct ts_ptp_key key;
+#endif
 
 
     xInsideISR = pdTRUE;
     status = EMAC->INTSTS & 0xFFFF0000;
     EMAC->INTSTS = status;
+    TRACE_BEGIN(TRACE_ID_EMAC_TX, status >> 16);
 #ifdef    TIME_STAMPING
     if(status & EMAC_INTSTS_TSALMIF_Msk)
     {
@@ -299,6 +368,7 @@ void EMAC_TX_IRQHandler(void)
     if(status & EMAC_INTSTS_TXBEIF_Msk)
     {
         // Shouldn't goes here, unless descriptor corrupted
+        TRACE_END(TRACE_ID_EMAC_TX, 1);
         return;
     }
 
@@ -306,48 +376,82 @@ void EMAC_TX_IRQHandler(void)
 
     while (cur_entry != (u32_t)fin_tx_desc_ptr)
     {
+        idx = fin_tx_desc_ptr - tx_desc;
 #ifdef  TIME_STAMPING
         if(fin_tx_desc_ptr->status2 & TXFD_TTSAS)
         {
-            if(fin_tx_desc_ptr->reserved1 != NULL)
-            {
-                ((struct pbuf *)(fin_tx_desc_ptr->reserved1))->ts_nsec = (u32_t)(fin_tx_desc_ptr->buf);
-                ((struct pbuf *)(fin_tx_desc_ptr->reserved1))->ts_sec = (u32_t)(fin_tx_desc_ptr->next);
-                ethernetif_loopback_input((struct pbuf *)fin_tx_desc_ptr->reserved1);
-            }
+            // Time stamp of a PTP event message, keyed by ETH_trigger_tx()
+            key.id = fin_tx_desc_ptr->reserved1;
+            key.port = fin_tx_desc_ptr->reserved2;
+            ts_tx_stamp(&key, (u32_t)fin_tx_desc_ptr->next, subsec2nsec((u32_t)fin_tx_desc_ptr->buf));
             fin_tx_desc_ptr->buf = (u8_t *)fin_tx_desc_ptr->backup1;
             fin_tx_desc_ptr->next = (struct eth_descriptor *)fin_tx_desc_ptr->backup2;
         }
-        else
+#endif
+        if(tx_pbuf[idx] != NULL)
         {
-            if((struct pbuf *)fin_tx_desc_ptr->reserved1 != NULL)
-                pbuf_free((struct pbuf *)fin_tx_desc_ptr->reserved1);  //need to define LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT 1
+            fin_tx_desc_ptr->buf = &tx_buf[idx][0];
+            pbuf_free(tx_pbuf[idx]);
+            tx_pbuf[idx] = NULL;
         }
-        fin_tx_desc_ptr->reserved1 = NULL;
-#endif
         fin_tx_desc_ptr = fin_tx_desc_ptr->next;
     }
+    TRACE_END(TRACE_ID_EMAC_TX, 0);
     xInsideISR = pdFALSE;
 }
 
 u8_t *ETH_get_tx_buf(void)
 {
-    if(cur_tx_desc_ptr->status1 & OWNERSHIP_EMAC)
+    // Also busy until the TX interrupt has released a pbuf sent in place
+    if((cur_tx_desc_ptr->status1 & OWNERSHIP_EMAC) || (tx_pbuf[cur_tx_desc_ptr - tx_desc] != NULL))
         return(NULL);
+#ifdef TIME_STAMPING
+    // buf may still hold a time stamp the TX interrupt has not collected yet
+    else
+        return((u8_t *)cur_tx_desc_ptr->backup1);
+#else
     else
         return(cur_tx_desc_ptr->buf);
+#endif
 }
 
+// Sends length bytes from the buffer ETH_get_tx_buf() returned. With p, a single pbuf of length
+// bytes, the frame is sent from p->payload instead, which must be word aligned; the descriptor
+// keeps a reference to p until the TX interrupt sees the frame gone. The last pbuf_free() of p may
+// run in the TX interrupt, so only pass pbufs whose free is safe there (PBUF_FLAG_UDP_FLOW), of at
+// least the 60-byte minimum frame length. PTP event messages to be time stamped are recognized
+// from the frame itself.
 void ETH_trigger_tx(u16_t length, struct pbuf *p)
 {
     struct eth_descriptor volatile *desc;
+#ifdef TIME_STAMPING
+    struct ts_ptp_key key;
+    u32_t ttsen = 0;
+#endif
+
+    if(p != NULL)
+    {
+        pbuf_ref(p);
+        tx_pbuf[cur_tx_desc_ptr - tx_desc] = p;
+        cur_tx_desc_ptr->buf = (u8_t *)p->payload;
+    }
+
+#ifdef TIME_STAMPING
+    if(ts_ptp_classify((p != NULL) ? (u8_t *)p->payload : (u8_t *)cur_tx_desc_ptr->backup1, length, &key))
+    {
+        cur_tx_desc_ptr->reserved1 = key.id;
+        cur_tx_desc_ptr->reserved2 = key.port;
+        ttsen = TXFD_TTSEN;
+    }
+    cur_tx_desc_ptr->status2 = (unsigned int)length;
+    desc = (struct eth_descriptor volatile *)cur_tx_desc_ptr->backup2;
+    cur_tx_desc_ptr->status1 = (cur_tx_desc_ptr->status1 & ~TXFD_TTSEN) | ttsen | OWNERSHIP_EMAC;
+#else
     cur_tx_desc_ptr->status2 = (unsigned int)length;
     desc = cur_tx_desc_ptr->next;    // in case TX is transmitting and overwrite next pointer before we can update cur_tx_desc_ptr
     cur_tx_desc_ptr->status1 |= OWNERSHIP_EMAC;
-    cur_tx_desc_ptr = desc;
-#ifdef TIME_STAMPING
-    cur_tx_desc_ptr->reserved1 = (u32_t)p;
 #endif
+    cur_tx_desc_ptr = desc;
     ETH_TRIGGER_TX();
 
 }
@@ -413,7 +517,7 @@ s32_t ETH_adjtimex(int ppb)
     int64_t addend = EMAC->TSADDEND;
 
 
-    addend = (ppb * DEFAULT_ADDNED) / 1000000000 + DEFAULT_ADDNED;
+    addend = ((int64_t)ppb * DEFAULT_ADDNED) / 1000000000 + DEFAULT_ADDNED;
     if(addend > 0xFFFFFFFF)
         addend = 0xFFFFFFFF;
 
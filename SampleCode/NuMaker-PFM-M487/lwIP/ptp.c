@@ -0,0 +1,767 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   IEEE 1588-2008 (PTPv2) ordinary clock over UDP/IPv4
+ *
+ * The clock listens for Announce messages and picks the best master with the data set
+ * comparison of IEEE 1588 9.3.4 (without foreign master qualification). As a slave it pairs Sync
+ * with Follow_Up, measures the path delay with Delay_Req/Delay_Resp, and feeds the offset to the
+ * PI servo in ptp_servo.c, which steers the EMAC time stamp counter through ts_adjtimex() and
+ * ts_update(). Unless it is slave only, the clock becomes a two-step master when no better master
+ * has been heard for announce_receipt_timeout announce intervals.
+ *
+ * Hardware time stamps of event messages come from time_stamp.c, which the EMAC driver fills for
+ * every PTP event frame it receives or sends. Everything here runs in the lwIP tcpip thread:
+ * call ptp_start() and ptp_stop() from there too, e.g. through tcpip_callback(), after ts_init().
+ */
+#include <string.h>
+#include "lwip/opt.h"
+
+#if defined(TIME_STAMPING) && LWIP_UDP && LWIP_IGMP
+
+#include "lwip/udp.h"
+#include "lwip/igmp.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+#include "lwip/time_stamp.h"
+#include "lwip/ptp.h"
+
+#define PTP_EVENT_PORT          319
+#define PTP_GENERAL_PORT        320
+
+#define PTP_MSG_SYNC            0x0
+#define PTP_MSG_DELAY_REQ       0x1
+#define PTP_MSG_FOLLOW_UP       0x8
+#define PTP_MSG_DELAY_RESP      0x9
+#define PTP_MSG_ANNOUNCE        0xB
+
+#define PTP_HDR_LEN             34
+#define PTP_SYNC_LEN            44      // Also Delay_Req and Follow_Up
+#define PTP_DELAY_RESP_LEN      54
+#define PTP_ANNOUNCE_LEN        64
+#define PTP_MSG_MAX             64
+
+#define PTP_FLAG_TWO_STEP       0x02    // flagField[0]
+#define PTP_FLAG_TIMESCALE      0x08    // flagField[1], PTP timescale
+#define PTP_LOG_UNSPECIFIED     0x7F
+
+#define PTP_TXTS_POLL_MS        1       // Wait between looks for the Sync transmit time stamp
+#define PTP_TXTS_TRIES          10
+
+#define NS_PER_SEC              1000000000LL
+
+// What an Announce tells about a master
+struct ptp_dataset
+{
+    u8_t priority1;
+    u8_t clock_class;
+    u8_t clock_accuracy;
+    u16_t variance;
+    u8_t priority2;
+    u8_t gm_id[8];
+    u16_t steps_removed;
+    u8_t port_id[10];           // Sender
+};
+
+static struct ptp_port
+{
+    struct ptp_config cfg;
+    struct netif *netif;
+    struct udp_pcb *event_pcb;
+    struct udp_pcb *general_pcb;
+    u8_t port_id[10];           // clockIdentity (EUI-64 from the MAC address) and port number 1
+    struct ptp_dataset own;
+    struct ptp_dataset parent;
+    u8_t have_parent;
+    s8_t log_announce;          // Announce interval of the parent
+    s8_t log_sync;              // Sync interval the servo gains are set for
+    s8_t log_delay_req;         // Delay_Req interval
+    u16_t announce_seq;
+    u16_t sync_seq;
+    u16_t delay_req_seq;
+    // Slave
+    u8_t sync_pending;          // Two-step Sync waiting for its Follow_Up
+    u16_t sync_pending_seq;
+    int64_t sync_t2;
+    int64_t sync_corr;
+    u8_t ms_valid;              // ms holds t2 - t1 of the last Sync
+    u32_t ms_gen;
+    int64_t ms;
+    u8_t delay_pending;         // Delay_Req waiting for its Delay_Resp
+    u32_t delay_gen;
+    u32_t step_gen;             // Counts clock steps, which invalidate measurements in flight
+    struct ptp_servo servo;
+    struct ptp_delay_filter filter;
+    struct ptp_stats offset_stats;
+    struct ptp_stats delay_stats;
+    // Master
+    u8_t follow_up_tries;
+    struct ptp_status st;
+} ptp;
+
+static ip_addr_t ptp_group;
+
+static void ptp_announce_tmr(void *arg);
+static void ptp_sync_tmr(void *arg);
+static void ptp_follow_up_tmr(void *arg);
+static void ptp_delay_req_tmr(void *arg);
+static void ptp_receipt_tmr(void *arg);
+
+static u32_t ptp_interval_ms(s8_t log_interval)
+{
+    if(log_interval > 7)
+        log_interval = 7;
+    if(log_interval < -7)
+        log_interval = -7;
+    return (log_interval >= 0) ? (1000UL << log_interval) : (1000UL >> -log_interval);
+}
+
+static int64_t ptp_tv_to_ns(const struct ts_timeval *tv)
+{
+    return (int64_t)(u32_t)tv->sec * NS_PER_SEC + tv->nsec;
+}
+
+static int64_t ptp_now(void)
+{
+    struct ts_timeval tv;
+
+    ts_gettime(&tv);
+    return ptp_tv_to_ns(&tv);
+}
+
+// Adds delta ns to the clock, in the form ts_update() wants
+static void ptp_step(int64_t delta)
+{
+    struct ts_timeval tv;
+    int64_t mag = (delta < 0) ? -delta : delta;
+
+    tv.sec = (s32_t)(mag / NS_PER_SEC);
+    tv.nsec = (s32_t)(mag % NS_PER_SEC);
+    if(delta < 0)
+    {
+        if(tv.sec)
+            tv.sec = -tv.sec;
+        else
+            tv.nsec = -tv.nsec;
+    }
+    ts_update(&tv);
+}
+
+static void ptp_put16(u8_t *b, u16_t v)
+{
+    b[0] = (u8_t)(v >> 8);
+    b[1] = (u8_t)v;
+}
+
+static u16_t ptp_get16(const u8_t *b)
+{
+    return (u16_t)((b[0] << 8) | b[1]);
+}
+
+static u32_t ptp_get32(const u8_t *b)
+{
+    return ((u32_t)b[0] << 24) | ((u32_t)b[1] << 16) | ((u32_t)b[2] << 8) | b[3];
+}
+
+// 48-bit seconds and 32-bit nanoseconds
+static void ptp_put_ts(u8_t *b, int64_t ns)
+{
+    uint64_t sec = (uint64_t)(ns / NS_PER_SEC);
+    u32_t nsec = (u32_t)(ns % NS_PER_SEC);
+
+    ptp_put16(b, (u16_t)(sec >> 32));
+    ptp_put16(b + 2, (u16_t)(sec >> 16));
+    ptp_put16(b + 4, (u16_t)sec);
+    ptp_put16(b + 6, (u16_t)(nsec >> 16));
+    ptp_put16(b + 8, (u16_t)nsec);
+}
+
+static int64_t ptp_get_ts(const u8_t *b)
+{
+    uint64_t sec = ((uint64_t)ptp_get16(b) << 32) | ptp_get32(b + 2);
+
+    return (int64_t)sec * NS_PER_SEC + ptp_get32(b + 6);
+}
+
+// correctionField of a message, in whole ns
+static int64_t ptp_get_corr(const u8_t *m)
+{
+    uint64_t v = ((uint64_t)ptp_get32(m + 8) << 32) | ptp_get32(m + 12);
+
+    return (int64_t)v >> 16;
+}
+
+static void ptp_put_hdr(u8_t *m, u8_t type, u16_t len, u16_t seq, u8_t ctl, s8_t log_interval, u8_t flags0)
+{
+    memset(m, 0, len);
+    m[0] = type;
+    m[1] = 2;
+    ptp_put16(m + 2, len);
+    m[4] = ptp.cfg.domain;
+    m[6] = flags0;
+    m[7] = PTP_FLAG_TIMESCALE;
+    memcpy(m + 20, ptp.port_id, 10);
+    ptp_put16(m + 30, seq);
+    m[32] = ctl;
+    m[33] = (u8_t)log_interval;
+}
+
+static void ptp_send(struct udp_pcb *pcb, u16_t port, const u8_t *m, u16_t len)
+{
+    struct pbuf *p;
+
+    p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if(p == NULL)
+        return;
+    pbuf_take(p, m, len);
+    udp_sendto_if(pcb, p, &ptp_group, port, ptp.netif);
+    pbuf_free(p);
+}
+
+// < 0 if a is the better master (IEEE 1588 9.3.4, without the topology checks)
+static int ptp_compare(const struct ptp_dataset *a, const struct ptp_dataset *b)
+{
+    int r = memcmp(a->gm_id, b->gm_id, 8);
+
+    if(r == 0)
+    {
+        // Same grandmaster: the shorter path wins, then the lower sender identity
+        if(a->steps_removed != b->steps_removed)
+            return (int)a->steps_removed - (int)b->steps_removed;
+        return memcmp(a->port_id, b->port_id, 10);
+    }
+    if(a->priority1 != b->priority1)
+        return (int)a->priority1 - (int)b->priority1;
+    if(a->clock_class != b->clock_class)
+        return (int)a->clock_class - (int)b->clock_class;
+    if(a->clock_accuracy != b->clock_accuracy)
+        return (int)a->clock_accuracy - (int)b->clock_accuracy;
+    if(a->variance != b->variance)
+        return (int)a->variance - (int)b->variance;
+    if(a->priority2 != b->priority2)
+        return (int)a->priority2 - (int)b->priority2;
+    return r;
+}
+
+static void ptp_set_state(u8_t state)
+{
+    ptp.st.state = state;
+}
+
+static void ptp_restart_receipt_tmr(void)
+{
+    sys_untimeout(ptp_receipt_tmr, NULL);
+    sys_timeout(ptp.cfg.announce_receipt_timeout * ptp_interval_ms(ptp.log_announce), ptp_receipt_tmr, NULL);
+}
+
+static void ptp_stop_master(void)
+{
+    sys_untimeout(ptp_announce_tmr, NULL);
+    sys_untimeout(ptp_sync_tmr, NULL);
+    sys_untimeout(ptp_follow_up_tmr, NULL);
+}
+
+static void ptp_become_master(void)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    ptp.have_parent = 0;
+    ptp.sync_pending = 0;
+    ptp.delay_pending = 0;
+    sys_untimeout(ptp_delay_req_tmr, NULL);
+    sys_untimeout(ptp_receipt_tmr, NULL);
+
+    SYS_ARCH_PROTECT(lev);
+    memcpy(ptp.st.parent_port_id, ptp.port_id, 10);
+    memcpy(ptp.st.gm_id, ptp.port_id, 8);
+    ptp_set_state(PTP_STATE_MASTER);
+    SYS_ARCH_UNPROTECT(lev);
+
+    ptp_announce_tmr(NULL);
+    ptp_sync_tmr(NULL);
+}
+
+static void ptp_become_slave(const struct ptp_dataset *ds, s8_t log_announce)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    ptp_stop_master();
+    ptp.parent = *ds;
+    ptp.have_parent = 1;
+    ptp.log_announce = (log_announce == PTP_LOG_UNSPECIFIED) ? ptp.cfg.log_announce_interval : log_announce;
+    ptp.sync_pending = 0;
+    ptp.ms_valid = 0;
+    ptp.delay_pending = 0;
+    ptp.log_delay_req = ptp.cfg.log_min_delay_req_interval;
+    // A new master may keep other time; allow the first step again
+    ptp_servo_reset(&ptp.servo);
+    ptp.servo.first_update = 1;
+    ptp_delay_filter_init(&ptp.filter, ptp.cfg.delay_filter_len);
+
+    SYS_ARCH_PROTECT(lev);
+    memcpy(ptp.st.parent_port_id, ds->port_id, 10);
+    memcpy(ptp.st.gm_id, ds->gm_id, 8);
+    ptp.st.mean_path_delay = 0;
+    ptp.st.servo_state = PTP_SERVO_UNLOCKED;
+    ptp_set_state(PTP_STATE_UNCALIBRATED);
+    SYS_ARCH_UNPROTECT(lev);
+
+    ptp_restart_receipt_tmr();
+    sys_untimeout(ptp_delay_req_tmr, NULL);
+    sys_timeout(ptp_interval_ms(ptp.log_delay_req), ptp_delay_req_tmr, NULL);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Slave                                                                     */
+/*---------------------------------------------------------------------------*/
+
+// t1 includes the correction of Sync and Follow_Up, t2 is the local receive time
+static void ptp_sync_done(int64_t t1, int64_t t2)
+{
+    int64_t offset;
+    s32_t adj;
+    uint32_t sstate;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    ptp.ms = t2 - t1;
+    ptp.ms_gen = ptp.step_gen;
+    ptp.ms_valid = 1;
+
+    offset = ptp.ms - ptp.st.mean_path_delay;
+    adj = ptp_servo_sample(&ptp.servo, offset, t2, &sstate);
+
+    if(sstate == PTP_SERVO_JUMP)
+    {
+        ptp_step(-offset);
+        ptp.step_gen++;
+        ptp.ms_valid = 0;
+    }
+    if(sstate != PTP_SERVO_UNLOCKED)
+        ts_adjtimex(adj);
+
+    SYS_ARCH_PROTECT(lev);
+    ptp.st.offset = offset;
+    ptp.st.servo_state = sstate;
+    if(sstate != PTP_SERVO_UNLOCKED)
+        ptp.st.freq_ppb = adj;
+    if(sstate == PTP_SERVO_JUMP)
+        ptp.st.steps++;
+    if(sstate == PTP_SERVO_LOCKED)
+        ptp_stats_add(&ptp.offset_stats, offset);
+    ptp_set_state((sstate == PTP_SERVO_LOCKED) ? PTP_STATE_SLAVE : PTP_STATE_UNCALIBRATED);
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+static void ptp_rx_sync(const u8_t *m)
+{
+    struct ts_timeval tv;
+    u16_t seq = ptp_get16(m + 30);
+    s8_t log_sync = (s8_t)m[33];
+
+    ptp.st.sync_rx++;
+    if(ts_rx_lookup(PTP_MSG_SYNC, seq, m + 20, &tv))
+    {
+        ptp.st.missing_ts++;
+        return;
+    }
+
+    if((log_sync != PTP_LOG_UNSPECIFIED) && (log_sync != ptp.log_sync))
+    {
+        ptp.log_sync = log_sync;
+        ptp_servo_interval(&ptp.servo, (float)ptp_interval_ms(log_sync) / 1000.0f);
+    }
+
+    if(m[6] & PTP_FLAG_TWO_STEP)
+    {
+        ptp.sync_pending = 1;
+        ptp.sync_pending_seq = seq;
+        ptp.sync_t2 = ptp_tv_to_ns(&tv);
+        ptp.sync_corr = ptp_get_corr(m);
+    }
+    else
+    {
+        ptp.sync_pending = 0;
+        ptp_sync_done(ptp_get_ts(m + 34) + ptp_get_corr(m), ptp_tv_to_ns(&tv));
+    }
+}
+
+static void ptp_rx_follow_up(const u8_t *m)
+{
+    ptp.st.follow_up_rx++;
+    if(!ptp.sync_pending || (ptp_get16(m + 30) != ptp.sync_pending_seq))
+        return;
+    ptp.sync_pending = 0;
+    ptp_sync_done(ptp_get_ts(m + 34) + ptp.sync_corr + ptp_get_corr(m), ptp.sync_t2);
+}
+
+static void ptp_delay_req_tmr(void *arg)
+{
+    u8_t m[PTP_SYNC_LEN];
+    u32_t ms = ptp_interval_ms(ptp.log_delay_req);
+
+    LWIP_UNUSED_ARG(arg);
+
+    ptp_put_hdr(m, PTP_MSG_DELAY_REQ, PTP_SYNC_LEN, ++ptp.delay_req_seq, 1, PTP_LOG_UNSPECIFIED, 0);
+    ptp_put_ts(m + 34, ptp_now());
+    ptp.delay_pending = 1;
+    ptp.delay_gen = ptp.step_gen;
+    ptp_send(ptp.event_pcb, PTP_EVENT_PORT, m, PTP_SYNC_LEN);
+    ptp.st.delay_req_tx++;
+
+    // Spread requests over 0.5 to 1.5 intervals so that slaves do not line up
+#ifdef LWIP_RAND
+    ms = ms / 2 + (u32_t)LWIP_RAND() % (ms + 1);
+#endif
+    sys_timeout(ms ? ms : 1, ptp_delay_req_tmr, NULL);
+}
+
+static void ptp_rx_delay_resp(const u8_t *m)
+{
+    struct ts_timeval tv;
+    int64_t sm, delay;
+    s8_t log_delay_req = (s8_t)m[33];
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    if(memcmp(m + 44, ptp.port_id, 10) != 0)
+        return;
+    ptp.st.delay_resp_rx++;
+    if(!ptp.delay_pending || (ptp_get16(m + 30) != ptp.delay_req_seq))
+        return;
+    ptp.delay_pending = 0;
+
+    if((log_delay_req != PTP_LOG_UNSPECIFIED) && (log_delay_req > -8) && (log_delay_req < 8))
+        ptp.log_delay_req = log_delay_req;
+
+    if(ts_tx_lookup(PTP_MSG_DELAY_REQ, ptp.delay_req_seq, ptp.port_id, &tv))
+    {
+        ptp.st.missing_ts++;
+        return;
+    }
+    // Both halves must lie on the same side of the last step
+    if(!ptp.ms_valid || (ptp.ms_gen != ptp.step_gen) || (ptp.delay_gen != ptp.step_gen))
+        return;
+
+    sm = ptp_get_ts(m + 34) - ptp_get_corr(m) - ptp_tv_to_ns(&tv);
+    delay = (ptp.ms + sm) / 2;
+    if(delay < 0)
+        return;
+    delay = ptp_delay_filter_add(&ptp.filter, delay);
+
+    SYS_ARCH_PROTECT(lev);
+    ptp.st.mean_path_delay = delay;
+    ptp_stats_add(&ptp.delay_stats, delay);
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+static void ptp_receipt_tmr(void *arg)
+{
+    LWIP_UNUSED_ARG(arg);
+
+    // The master went quiet
+    ptp.have_parent = 0;
+    ptp.sync_pending = 0;
+    ptp.delay_pending = 0;
+    sys_untimeout(ptp_delay_req_tmr, NULL);
+    if(ptp.cfg.slave_only)
+        ptp_set_state(PTP_STATE_LISTENING);
+    else
+        ptp_become_master();
+}
+
+static void ptp_rx_announce(const u8_t *m)
+{
+    struct ptp_dataset ds;
+
+    ptp.st.announce_rx++;
+    ds.priority1 = m[47];
+    ds.clock_class = m[48];
+    ds.clock_accuracy = m[49];
+    ds.variance = ptp_get16(m + 50);
+    ds.priority2 = m[52];
+    memcpy(ds.gm_id, m + 53, 8);
+    ds.steps_removed = ptp_get16(m + 61);
+    memcpy(ds.port_id, m + 20, 10);
+    if(ds.steps_removed >= 255)
+        return;
+
+    if(ptp.have_parent && (memcmp(ds.port_id, ptp.parent.port_id, 10) == 0))
+    {
+        // Current master; its data set may have changed
+        ptp.parent = ds;
+        memcpy(ptp.st.gm_id, ds.gm_id, 8);
+        ptp_restart_receipt_tmr();
+        return;
+    }
+    if(ptp.have_parent && (ptp_compare(&ds, &ptp.parent) >= 0))
+        return;
+    if(!ptp.cfg.slave_only && (ptp_compare(&ptp.own, &ds) < 0))
+        return;
+
+    ptp_become_slave(&ds, (s8_t)m[33]);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Master                                                                    */
+/*---------------------------------------------------------------------------*/
+
+static void ptp_announce_tmr(void *arg)
+{
+    u8_t m[PTP_ANNOUNCE_LEN];
+
+    LWIP_UNUSED_ARG(arg);
+
+    ptp_put_hdr(m, PTP_MSG_ANNOUNCE, PTP_ANNOUNCE_LEN, ++ptp.announce_seq, 5, ptp.cfg.log_announce_interval, 0);
+    ptp_put_ts(m + 34, ptp_now());
+    ptp_put16(m + 44, (u16_t)ptp.cfg.current_utc_offset);
+    m[47] = ptp.own.priority1;
+    m[48] = ptp.own.clock_class;
+    m[49] = ptp.own.clock_accuracy;
+    ptp_put16(m + 50, ptp.own.variance);
+    m[52] = ptp.own.priority2;
+    memcpy(m + 53, ptp.own.gm_id, 8);
+    ptp_put16(m + 61, 0);
+    m[63] = ptp.cfg.time_source;
+    ptp_send(ptp.general_pcb, PTP_GENERAL_PORT, m, PTP_ANNOUNCE_LEN);
+    ptp.st.announce_tx++;
+
+    sys_timeout(ptp_interval_ms(ptp.cfg.log_announce_interval), ptp_announce_tmr, NULL);
+}
+
+static void ptp_sync_tmr(void *arg)
+{
+    u8_t m[PTP_SYNC_LEN];
+
+    LWIP_UNUSED_ARG(arg);
+
+    ptp_put_hdr(m, PTP_MSG_SYNC, PTP_SYNC_LEN, ++ptp.sync_seq, 0, ptp.cfg.log_sync_interval, PTP_FLAG_TWO_STEP);
+    ptp_put_ts(m + 34, ptp_now());
+    ptp_send(ptp.event_pcb, PTP_EVENT_PORT, m, PTP_SYNC_LEN);
+    ptp.st.sync_tx++;
+
+    // Follow_Up carries the transmit time stamp once the EMAC has reported it
+    ptp.follow_up_tries = PTP_TXTS_TRIES;
+    sys_untimeout(ptp_follow_up_tmr, NULL);
+    sys_timeout(PTP_TXTS_POLL_MS, ptp_follow_up_tmr, NULL);
+    sys_timeout(ptp_interval_ms(ptp.cfg.log_sync_interval), ptp_sync_tmr, NULL);
+}
+
+static void ptp_follow_up_tmr(void *arg)
+{
+    u8_t m[PTP_SYNC_LEN];
+    struct ts_timeval tv;
+
+    LWIP_UNUSED_ARG(arg);
+
+    if(ts_tx_lookup(PTP_MSG_SYNC, ptp.sync_seq, ptp.port_id, &tv))
+    {
+        if(--ptp.follow_up_tries)
+            sys_timeout(PTP_TXTS_POLL_MS, ptp_follow_up_tmr, NULL);
+        else
+            ptp.st.missing_ts++;
+        return;
+    }
+
+    ptp_put_hdr(m, PTP_MSG_FOLLOW_UP, PTP_SYNC_LEN, ptp.sync_seq, 2, ptp.cfg.log_sync_interval, 0);
+    ptp_put_ts(m + 34, ptp_tv_to_ns(&tv));
+    ptp_send(ptp.general_pcb, PTP_GENERAL_PORT, m, PTP_SYNC_LEN);
+}
+
+static void ptp_rx_delay_req(const u8_t *m)
+{
+    u8_t r[PTP_DELAY_RESP_LEN];
+    struct ts_timeval tv;
+    u16_t seq = ptp_get16(m + 30);
+
+    if(ts_rx_lookup(PTP_MSG_DELAY_REQ, seq, m + 20, &tv))
+    {
+        ptp.st.missing_ts++;
+        return;
+    }
+
+    ptp_put_hdr(r, PTP_MSG_DELAY_RESP, PTP_DELAY_RESP_LEN, seq, 3, ptp.cfg.log_min_delay_req_interval, 0);
+    // The requester's correction is returned, without its sub-nanosecond part
+    memcpy(r + 8, m + 8, 6);
+    ptp_put_ts(r + 34, ptp_tv_to_ns(&tv));
+    memcpy(r + 44, m + 20, 10);
+    ptp_send(ptp.general_pcb, PTP_GENERAL_PORT, r, PTP_DELAY_RESP_LEN);
+    ptp.st.delay_resp_tx++;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Receive                                                                   */
+/*---------------------------------------------------------------------------*/
+
+static void ptp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    u8_t m[PTP_MSG_MAX];
+    u16_t len;
+    u8_t type;
+    static const u16_t min_len[16] = { PTP_SYNC_LEN, PTP_SYNC_LEN, 0, 0, 0, 0, 0, 0,
+                                       PTP_SYNC_LEN, PTP_DELAY_RESP_LEN, 0, PTP_ANNOUNCE_LEN, 0, 0, 0, 0
+                                     };
+
+    LWIP_UNUSED_ARG(pcb);
+    LWIP_UNUSED_ARG(addr);
+    LWIP_UNUSED_ARG(port);
+
+    len = pbuf_copy_partial(p, m, sizeof(m), 0);
+    pbuf_free(p);
+
+    if((len < PTP_HDR_LEN) || ((m[1] & 0x0F) != 2) || (m[4] != ptp.cfg.domain))
+        return;
+    type = m[0] & 0x0F;
+    if((min_len[type] == 0) || (len < min_len[type]) || (memcmp(m + 20, ptp.port_id, 8) == 0))
+        return;
+
+    switch(type)
+    {
+    case PTP_MSG_ANNOUNCE:
+        ptp_rx_announce(m);
+        break;
+    case PTP_MSG_DELAY_REQ:
+        if(ptp.st.state == PTP_STATE_MASTER)
+            ptp_rx_delay_req(m);
+        break;
+    default:
+        // Sync, Follow_Up and Delay_Resp count only from the master we follow
+        if(!ptp.have_parent || (memcmp(m + 20, ptp.parent.port_id, 10) != 0))
+            break;
+        if(type == PTP_MSG_SYNC)
+            ptp_rx_sync(m);
+        else if(type == PTP_MSG_FOLLOW_UP)
+            ptp_rx_follow_up(m);
+        else
+            ptp_rx_delay_resp(m);
+        break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* API                                                                       */
+/*---------------------------------------------------------------------------*/
+
+void ptp_config_default(struct ptp_config *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->slave_only = 1;
+    cfg->priority1 = 128;
+    cfg->priority2 = 128;
+    cfg->clock_class = 248;
+    cfg->clock_accuracy = 0xFE;
+    cfg->offset_scaled_log_variance = 0xFFFF;
+    cfg->time_source = 0xA0;
+    cfg->current_utc_offset = 37;
+    cfg->log_announce_interval = 1;
+    cfg->log_sync_interval = -3;
+    cfg->log_min_delay_req_interval = -3;
+    cfg->announce_receipt_timeout = 3;
+    cfg->step_threshold = 0;
+    cfg->first_step_threshold = 20000;
+    cfg->max_ppb = PTP_SERVO_MAX_PPB;
+    cfg->delay_filter_len = PTP_DELAY_FILTER_LEN;
+}
+
+err_t ptp_start(struct netif *netif, const struct ptp_config *cfg)
+{
+    if((netif == NULL) || (cfg == NULL) || (ptp.event_pcb != NULL))
+        return ERR_ARG;
+
+    memset(&ptp, 0, sizeof(ptp));
+    ptp.cfg = *cfg;
+    if(ptp.cfg.announce_receipt_timeout < 2)
+        ptp.cfg.announce_receipt_timeout = 2;
+    if(ptp.cfg.slave_only)
+        ptp.cfg.clock_class = 255;
+    ptp.netif = netif;
+
+    ptp.port_id[0] = netif->hwaddr[0];
+    ptp.port_id[1] = netif->hwaddr[1];
+    ptp.port_id[2] = netif->hwaddr[2];
+    ptp.port_id[3] = 0xFF;
+    ptp.port_id[4] = 0xFE;
+    ptp.port_id[5] = netif->hwaddr[3];
+    ptp.port_id[6] = netif->hwaddr[4];
+    ptp.port_id[7] = netif->hwaddr[5];
+    ptp_put16(ptp.port_id + 8, 1);
+
+    ptp.own.priority1 = ptp.cfg.priority1;
+    ptp.own.clock_class = ptp.cfg.clock_class;
+    ptp.own.clock_accuracy = ptp.cfg.clock_accuracy;
+    ptp.own.variance = ptp.cfg.offset_scaled_log_variance;
+    ptp.own.priority2 = ptp.cfg.priority2;
+    memcpy(ptp.own.gm_id, ptp.port_id, 8);
+    memcpy(ptp.own.port_id, ptp.port_id, 10);
+
+    ptp.log_announce = ptp.cfg.log_announce_interval;
+    ptp.log_sync = ptp.cfg.log_sync_interval;
+    ptp.log_delay_req = ptp.cfg.log_min_delay_req_interval;
+    ptp_servo_init(&ptp.servo, ptp.cfg.max_ppb, ptp.cfg.step_threshold, ptp.cfg.first_step_threshold);
+    ptp_servo_interval(&ptp.servo, (float)ptp_interval_ms(ptp.log_sync) / 1000.0f);
+    ptp_delay_filter_init(&ptp.filter, ptp.cfg.delay_filter_len);
+    ptp_stats_reset(&ptp.offset_stats);
+    ptp_stats_reset(&ptp.delay_stats);
+
+    IP_ADDR4(&ptp_group, 224, 0, 1, 129);
+    ptp.event_pcb = udp_new();
+    ptp.general_pcb = udp_new();
+    if((ptp.event_pcb == NULL) || (ptp.general_pcb == NULL) ||
+            (udp_bind(ptp.event_pcb, IP_ADDR_ANY, PTP_EVENT_PORT) != ERR_OK) ||
+            (udp_bind(ptp.general_pcb, IP_ADDR_ANY, PTP_GENERAL_PORT) != ERR_OK))
+    {
+        if(ptp.event_pcb)
+            udp_remove(ptp.event_pcb);
+        if(ptp.general_pcb)
+            udp_remove(ptp.general_pcb);
+        ptp.event_pcb = ptp.general_pcb = NULL;
+        return ERR_MEM;
+    }
+    ptp.event_pcb->ttl = ptp.general_pcb->ttl = 1;
+#if LWIP_MULTICAST_TX_OPTIONS
+    udp_set_multicast_ttl(ptp.event_pcb, 1);
+    udp_set_multicast_ttl(ptp.general_pcb, 1);
+#endif
+    udp_recv(ptp.event_pcb, ptp_recv, NULL);
+    udp_recv(ptp.general_pcb, ptp_recv, NULL);
+    igmp_joingroup_netif(netif, ip_2_ip4(&ptp_group));
+
+    ptp_set_state(PTP_STATE_LISTENING);
+    ptp_restart_receipt_tmr();
+    return ERR_OK;
+}
+
+void ptp_stop(void)
+{
+    if(ptp.event_pcb == NULL)
+        return;
+
+    ptp_stop_master();
+    sys_untimeout(ptp_delay_req_tmr, NULL);
+    sys_untimeout(ptp_receipt_tmr, NULL);
+    igmp_leavegroup_netif(ptp.netif, ip_2_ip4(&ptp_group));
+    udp_remove(ptp.event_pcb);
+    udp_remove(ptp.general_pcb);
+    ptp.event_pcb = ptp.general_pcb = NULL;
+    ptp.have_parent = 0;
+    ptp_set_state(PTP_STATE_INITIALIZING);
+}
+
+// May be called from any thread. reset_stats starts new offset and delay statistics.
+void ptp_get_status(struct ptp_status *st, u8_t reset_stats)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    *st = ptp.st;
+    ptp_stats_get(&ptp.offset_stats, &st->offset_stats);
+    ptp_stats_get(&ptp.delay_stats, &st->delay_stats);
+    if(reset_stats)
+    {
+        ptp_stats_reset(&ptp.offset_stats);
+        ptp_stats_reset(&ptp.delay_stats);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    if(st->state == 0)
+        st->state = PTP_STATE_INITIALIZING;
+}
+
+#endif /* TIME_STAMPING && LWIP_UDP && LWIP_IGMP */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   PTP clock servo, path delay filter and offset statistics
+ *
+ * The servo is a PI controller in the form used by linuxptp: the second sample estimates the
+ * frequency error, an offset above the step threshold is removed by stepping the clock, and
+ * from then on the frequency follows kp * offset plus the integral of ki * offset. Gains are
+ * scaled with the sync interval, so the loop bandwidth stays sensible from 1/128 s to 2 s.
+ */
+#include <string.h>
+#include <math.h>
+#include "lwip/ptp_servo.h"
+
+static int64_t ptp_abs64(int64_t v)
+{
+    return (v < 0) ? -v : v;
+}
+
+static int32_t ptp_clip32(int64_t v)
+{
+    if(v > 0x7FFFFFFFLL)
+        return 0x7FFFFFFF;
+    if(v < -0x7FFFFFFFLL)
+        return -0x7FFFFFFF;
+    return (int32_t)v;
+}
+
+void ptp_servo_init(struct ptp_servo *s, int32_t max_ppb, int64_t step_threshold, int64_t first_step_threshold)
+{
+    memset(s, 0, sizeof(*s));
+    s->max_ppb = max_ppb;
+    s->step_threshold = step_threshold;
+    s->first_step_threshold = first_step_threshold;
+    s->first_update = 1;
+    ptp_servo_interval(s, 1.0f);
+}
+
+// Sets the gains for a sync interval given in seconds.
+void ptp_servo_interval(struct ptp_servo *s, float interval)
+{
+    if(interval <= 0.0f)
+        return;
+
+    s->kp = PTP_SERVO_KP_SCALE * powf(interval, -0.3f);
+    if(s->kp > 0.7f / interval)
+        s->kp = 0.7f / interval;
+    s->ki = PTP_SERVO_KI_SCALE * powf(interval, 0.4f);
+    if(s->ki > 0.3f / interval)
+        s->ki = 0.3f / interval;
+}
+
+// Starts over with frequency estimation; the integral term is kept.
+void ptp_servo_reset(struct ptp_servo *s)
+{
+    s->count = 0;
+    s->state = PTP_SERVO_UNLOCKED;
+}
+
+/*
+ * offset is local time minus master time and local_ts the local receive time of the sync,
+ * both in ns. Returns the frequency adjustment for ts_adjtimex(), in ppb, and the action in
+ * *state.
+ */
+int32_t ptp_servo_sample(struct ptp_servo *s, int64_t offset, int64_t local_ts, uint32_t *state)
+{
+    float ki_term;
+    float ppb = s->ppb;
+    int64_t mag = ptp_abs64(offset);
+
+    switch(s->count)
+    {
+    case 0:
+        s->offset0 = offset;
+        s->local0 = local_ts;
+        s->count = 1;
+        s->state = PTP_SERVO_UNLOCKED;
+        break;
+
+    case 1:
+        if(local_ts <= s->local0)
+        {
+            // Clock went backwards between the samples, use this one as the first
+            s->offset0 = offset;
+            s->local0 = local_ts;
+            s->state = PTP_SERVO_UNLOCKED;
+            break;
+        }
+        s->drift += (float)(offset - s->offset0) * 1e9f / (float)(local_ts - s->local0);
+        if(s->drift > (float)s->max_ppb)
+            s->drift = (float)s->max_ppb;
+        else if(s->drift < -(float)s->max_ppb)
+            s->drift = -(float)s->max_ppb;
+
+        if((s->first_update && s->first_step_threshold && mag > s->first_step_threshold) ||
+                (s->step_threshold && mag > s->step_threshold))
+            s->state = PTP_SERVO_JUMP;
+        else
+            s->state = PTP_SERVO_LOCKED;
+        s->first_update = 0;
+        ppb = s->drift;
+        s->count = 2;
+        break;
+
+    default:
+        if(s->step_threshold && mag > s->step_threshold)
+        {
+            // Lost lock, e.g. the master stepped its time
+            s->count = 0;
+            s->state = PTP_SERVO_UNLOCKED;
+            break;
+        }
+        ki_term = s->ki * (float)offset;
+        ppb = s->kp * (float)offset + s->drift + ki_term;
+        if(ppb > (float)s->max_ppb)
+            ppb = (float)s->max_ppb;
+        else if(ppb < -(float)s->max_ppb)
+            ppb = -(float)s->max_ppb;
+        else
+            s->drift += ki_term;
+        s->state = PTP_SERVO_LOCKED;
+        break;
+    }
+
+    s->ppb = ppb;
+    *state = s->state;
+    // A positive ppb means the local clock runs fast, so it is slowed down by that much
+    return (ppb >= 0.0f) ? -(int32_t)(ppb + 0.5f) : (int32_t)(-ppb + 0.5f);
+}
+
+void ptp_delay_filter_init(struct ptp_delay_filter *f, uint32_t len)
+{
+    memset(f, 0, sizeof(*f));
+    if(len == 0)
+        len = 1;
+    if(len > PTP_DELAY_FILTER_LEN)
+        len = PTP_DELAY_FILTER_LEN;
+    f->len = len;
+}
+
+// Adds a mean path delay sample and returns the median of the window.
+int64_t ptp_delay_filter_add(struct ptp_delay_filter *f, int64_t delay)
+{
+    int64_t sorted[PTP_DELAY_FILTER_LEN];
+    int64_t v;
+    uint32_t i, j;
+
+    f->sample[f->idx] = delay;
+    f->idx = (f->idx + 1 == f->len) ? 0 : f->idx + 1;
+    if(f->count < f->len)
+        f->count++;
+
+    for(i = 0; i < f->count; i++)
+    {
+        v = f->sample[i];
+        for(j = i; j > 0 && sorted[j - 1] > v; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+
+    if(f->count & 1)
+        return sorted[f->count / 2];
+    return (sorted[f->count / 2 - 1] + sorted[f->count / 2]) / 2;
+}
+
+void ptp_stats_reset(struct ptp_stats *st)
+{
+    memset(st, 0, sizeof(*st));
+}
+
+void ptp_stats_add(struct ptp_stats *st, int64_t value)
+{
+    double d;
+
+    if(st->count == 0 || value < st->min)
+        st->min = value;
+    if(st->count == 0 || value > st->max)
+        st->max = value;
+    st->count++;
+    d = (double)value - st->mean;
+    st->mean += d / st->count;
+    st->m2 += d * ((double)value - st->mean);
+    st->sumsq += (double)value * (double)value;
+}
+
+void ptp_stats_get(const struct ptp_stats *st, struct ptp_stats_result *res)
+{
+    memset(res, 0, sizeof(*res));
+    if(st->count == 0)
+        return;
+
+    res->count = st->count;
+    res->min = ptp_clip32(st->min);
+    res->max = ptp_clip32(st->max);
+    res->mean = ptp_clip32((int64_t)st->mean);
+    res->rms = (uint32_t)ptp_clip32((int64_t)sqrt(st->sumsq / st->count));
+    res->stddev = (uint32_t)ptp_clip32((int64_t)sqrt(st->m2 / st->count));
+}
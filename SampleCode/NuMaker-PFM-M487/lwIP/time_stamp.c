@@ -4,11 +4,29 @@
  */
 #include "lwip/opt.h"
 #include "lwip/def.h"
+#include "lwip/sys.h"
 #include "lwip/time_stamp.h"
 #include "netif/m480_eth.h"
 
 #ifdef TIME_STAMPING
 
+/*
+ * EMAC time stamps every received frame and every transmitted frame whose descriptor asks for
+ * it, but lwIP pbufs have no room for them. For PTP event messages the driver calls
+ * ts_rx_stamp() and ts_tx_stamp(), which remember the time stamp under the message type,
+ * sequence id and sender; the PTP stack asks for it with ts_rx_lookup() and ts_tx_lookup()
+ * once the message has gone through lwIP.
+ */
+struct ts_stamp
+{
+    struct ts_ptp_key key;
+    u32_t sec;
+    u32_t nsec;
+};
+
+static struct ts_stamp ts_rx_tbl[TS_STAMP_NUM], ts_tx_tbl[TS_STAMP_NUM];
+static u32_t ts_rx_idx, ts_tx_idx;
+
 u32_t ts_init(struct ts_timeval *t)
 {
 
@@ -58,5 +76,124 @@ u32_t ts_adjtimex(s32_t ppb)
 
 }
 
+// FNV-1a over the 10 byte sourcePortIdentity
+u32_t ts_ptp_port_hash(const u8_t *port_id)
+{
+    u32_t h = 0x811C9DC5;
+    int i;
+
+    for(i = 0; i < 10; i++)
+        h = (h ^ port_id[i]) * 0x01000193;
+    return h;
+}
+
+// Returns 1 and fills key if frame is a PTP event message over UDP/IPv4 or IEEE 802.3
+u32_t ts_ptp_classify(const u8_t *frame, u32_t len, struct ts_ptp_key *key)
+{
+    const u8_t *msg;
+    u32_t off = 12, type, ihl;
+
+    if(len < off + 2)
+        return 0;
+    type = (frame[off] << 8) | frame[off + 1];
+    if(type == 0x8100)
+    {
+        // Skip one VLAN tag
+        off += 4;
+        if(len < off + 2)
+            return 0;
+        type = (frame[off] << 8) | frame[off + 1];
+    }
+    off += 2;
+
+    if(type == 0x0800)
+    {
+        // IPv4, not a fragment, UDP to the event port
+        if(len < off + 20)
+            return 0;
+        ihl = (frame[off] & 0x0F) * 4;
+        if(((frame[off] >> 4) != 4) || (ihl < 20) || (frame[off + 9] != 17) ||
+                (((frame[off + 6] & 0x1F) | frame[off + 7]) != 0))
+            return 0;
+        off += ihl;
+        if((len < off + 8) || (((frame[off + 2] << 8) | frame[off + 3]) != TS_PTP_EVENT_PORT))
+            return 0;
+        off += 8;
+    }
+    else if(type != TS_PTP_ETHERTYPE)
+        return 0;
+
+    if(len < off + 34)
+        return 0;
+    msg = &frame[off];
+    // Sync, Delay_Req, Pdelay_Req and Pdelay_Resp are event messages
+    if((msg[0] & 0x0F) > 3)
+        return 0;
+
+    key->id = ((u32_t)(msg[0] & 0x0F) << 16) | (msg[30] << 8) | msg[31];
+    key->port = ts_ptp_port_hash(&msg[20]);
+    return 1;
+}
+
+static void ts_store(struct ts_stamp *tbl, u32_t *idx, const struct ts_ptp_key *key, u32_t sec, u32_t nsec)
+{
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    tbl[*idx].key = *key;
+    tbl[*idx].sec = sec;
+    tbl[*idx].nsec = nsec;
+    *idx = (*idx + 1) % TS_STAMP_NUM;
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+static u32_t ts_lookup(struct ts_stamp *tbl, u8_t type, u16_t seq, const u8_t *port_id, struct ts_timeval *t)
+{
+    u32_t id = ((u32_t)type << 16) | seq, port = ts_ptp_port_hash(port_id), i, ret = 1;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    for(i = 0; i < TS_STAMP_NUM; i++)
+    {
+        if((tbl[i].key.id == id) && (tbl[i].key.port == port) && (tbl[i].sec | tbl[i].nsec))
+        {
+            t->sec = tbl[i].sec;
+            t->nsec = tbl[i].nsec;
+            // Each time stamp is handed out once
+            tbl[i].sec = tbl[i].nsec = 0;
+            ret = 0;
+            break;
+        }
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return ret;
+}
+
+// Called by the driver for each received frame with its time stamp
+void ts_rx_stamp(const u8_t *frame, u32_t len, u32_t sec, u32_t nsec)
+{
+    struct ts_ptp_key key;
+
+    if(ts_ptp_classify(frame, len, &key))
+        ts_store(ts_rx_tbl, &ts_rx_idx, &key, sec, nsec);
+}
+
+// Called by the driver when a frame classified by ts_ptp_classify() has left
+void ts_tx_stamp(const struct ts_ptp_key *key, u32_t sec, u32_t nsec)
+{
+    ts_store(ts_tx_tbl, &ts_tx_idx, key, sec, nsec);
+}
+
+// Time stamps of PTP event messages. Return 0 if found, 1 if not (yet).
+u32_t ts_rx_lookup(u8_t type, u16_t seq, const u8_t *port_id, struct ts_timeval *t)
+{
+    return ts_lookup(ts_rx_tbl, type, seq, port_id, t);
+}
+
+u32_t ts_tx_lookup(u8_t type, u16_t seq, const u8_t *port_id, struct ts_timeval *t)
+{
+    return ts_lookup(ts_tx_tbl, type, seq, port_id, t);
+}
+
 
 #endif
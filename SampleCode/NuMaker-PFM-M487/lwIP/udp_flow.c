@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   UDP flow, a fast transmit path for one connected UDP/IPv4 stream
+ *
+ * udp_send() allocates a header pbuf, walks the routing table and the ARP cache, writes the
+ * headers and checksums the whole datagram for every packet. A flow does that work once in
+ * udp_flow_connect(): it resolves the next hop, writes the complete Ethernet, IPv4 and UDP headers
+ * into every frame buffer of its ring and keeps the checksum sums of the header fields that do not
+ * change. udp_flow_send() then patches lengths, IP ID and checksums and hands the frame buffer to
+ * netif->linkoutput() as a custom pbuf.
+ *
+ * The M480 EMAC driver transmits a pbuf tagged PBUF_FLAG_UDP_FLOW in place and keeps a reference
+ * until the frame has gone out, so a payload filled by the application or by PDMA (UDP_FLOW_PAYLOAD()) is
+ * never copied. A frame buffer becomes free again when the driver drops that reference.
+ *
+ * Call udp_flow_connect() and udp_flow_send() in the tcpip thread or with the core locked
+ * (LOCK_TCPIP_CORE()), the driver TX path is shared with the stack. The cached destination MAC
+ * address is not refreshed: connect again when the peer or the route changes.
+ */
+#include <string.h>
+#include "lwip/opt.h"
+
+#if LWIP_UDP && LWIP_ARP && LWIP_SUPPORT_CUSTOM_PBUF
+
+#include "lwip/def.h"
+#include "lwip/ip4.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/stats.h"
+#include "lwip/etharp.h"
+#include "netif/ethernet.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+#include "lwip/udp_flow.h"
+
+#if ETH_PAD_SIZE
+#error "UDP flow frame buffers have no room for ETH_PAD_SIZE"
+#endif
+
+#define UDP_FLOW_IP_OFS         SIZEOF_ETH_HDR
+#define UDP_FLOW_UDP_OFS        (SIZEOF_ETH_HDR + IP_HLEN)
+
+#define UDP_FLOW_FRAME(flow, i) ((flow)->buf + (u32_t)(i) * (flow)->buf_size)
+
+// Shortest Ethernet frame without the FCS. Shorter flow frames are zero padded in their buffer.
+#define UDP_FLOW_MIN_FRAME      60
+
+// The driver dropped its last reference to a frame buffer, possibly from the EMAC TX interrupt
+static void udp_flow_free(struct pbuf *p)
+{
+    struct udp_flow_slot *slot = (struct udp_flow_slot *)p;
+
+    slot->busy = 0;
+}
+
+static u16_t udp_flow_fold(u32_t sum)
+{
+    sum = FOLD_U32T(sum);
+    sum = FOLD_U32T(sum);
+    return (u16_t)sum;
+}
+
+err_t udp_flow_init(struct udp_flow *flow, struct udp_flow_slot *slot, u8_t *buf, u16_t buf_size, u16_t slots)
+{
+    u16_t i;
+
+    if((flow == NULL) || (slot == NULL) || (buf == NULL) || (slots == 0) ||
+            ((mem_ptr_t)buf & 3) || (buf_size & 3) || (buf_size < UDP_FLOW_MIN_FRAME))
+        return ERR_ARG;
+
+    memset(flow, 0, sizeof(*flow));
+    flow->slot = slot;
+    flow->buf = buf;
+    flow->buf_size = buf_size;
+    flow->slots = slots;
+    for(i = 0; i < slots; i++)
+    {
+        memset(&slot[i], 0, sizeof(slot[i]));
+        slot[i].pc.custom_free_function = udp_flow_free;
+        slot[i].flow = flow;
+    }
+    return ERR_OK;
+}
+
+// Builds the header template from a connected pcb. Returns ERR_INPROGRESS while the next hop is
+// being resolved (an ARP request has been sent, try again later) and ERR_USE while frames of the
+// previous connection are still with the driver.
+err_t udp_flow_connect(struct udp_flow *flow, struct udp_pcb *pcb)
+{
+    const ip4_addr_t *dst, *src, *hop;
+    struct eth_addr *eth_ret;
+    const ip4_addr_t *ip_ret;
+    struct eth_addr dst_mac;
+    struct netif *netif;
+    struct eth_hdr *ethhdr;
+    struct ip_hdr *iphdr;
+    struct udp_hdr *udphdr;
+    u8_t *frame;
+    u32_t sum;
+    u16_t i;
+
+    if((flow == NULL) || (pcb == NULL) || !(pcb->flags & UDP_FLAGS_CONNECTED) || !IP_IS_V4(&pcb->remote_ip))
+        return ERR_ARG;
+    if(udp_flow_free_bufs(flow) != flow->slots)
+        return ERR_USE;
+
+    dst = ip_2_ip4(&pcb->remote_ip);
+    netif = ip4_route(dst);
+    if(netif == NULL)
+        return ERR_RTE;
+    if(!(netif->flags & NETIF_FLAG_ETHARP) || (netif->linkoutput == NULL))
+        return ERR_IF;
+
+    if(ip4_addr_isbroadcast(dst, netif))
+    {
+        dst_mac = ethbroadcast;
+    }
+    else if(ip4_addr_ismulticast(dst))
+    {
+        dst_mac.addr[0] = LL_IP4_MULTICAST_ADDR_0;
+        dst_mac.addr[1] = LL_IP4_MULTICAST_ADDR_1;
+        dst_mac.addr[2] = LL_IP4_MULTICAST_ADDR_2;
+        dst_mac.addr[3] = ip4_addr2(dst) & 0x7f;
+        dst_mac.addr[4] = ip4_addr3(dst);
+        dst_mac.addr[5] = ip4_addr4(dst);
+    }
+    else
+    {
+        hop = dst;
+        if(!ip4_addr_netcmp(dst, netif_ip4_addr(netif), netif_ip4_netmask(netif)) && !ip4_addr_islinklocal(dst))
+        {
+            if(ip4_addr_isany(netif_ip4_gw(netif)))
+                return ERR_RTE;
+            hop = netif_ip4_gw(netif);
+        }
+        if(etharp_find_addr(netif, hop, &eth_ret, &ip_ret) < 0)
+        {
+            etharp_query(netif, hop, NULL);
+            return ERR_INPROGRESS;
+        }
+        dst_mac = *eth_ret;
+    }
+    src = ip4_addr_isany(ip_2_ip4(&pcb->local_ip)) ? netif_ip4_addr(netif) : ip_2_ip4(&pcb->local_ip);
+
+    // Template in the first frame buffer; length, ID and checksum fields stay 0 here
+    frame = UDP_FLOW_FRAME(flow, 0);
+    memset(frame, 0, UDP_FLOW_HLEN);
+    ethhdr = (struct eth_hdr *)frame;
+    SMEMCPY(&ethhdr->dest, &dst_mac, ETH_HWADDR_LEN);
+    SMEMCPY(&ethhdr->src, netif->hwaddr, ETH_HWADDR_LEN);
+    ethhdr->type = PP_HTONS(ETHTYPE_IP);
+
+    iphdr = (struct ip_hdr *)(frame + UDP_FLOW_IP_OFS);
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_TOS_SET(iphdr, pcb->tos);
+    IPH_TTL_SET(iphdr, pcb->ttl);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    ip4_addr_copy(iphdr->src, *src);
+    ip4_addr_copy(iphdr->dest, *dst);
+
+    udphdr = (struct udp_hdr *)(frame + UDP_FLOW_UDP_OFS);
+    udphdr->src = lwip_htons(pcb->local_port);
+    udphdr->dest = lwip_htons(pcb->remote_port);
+
+    flow->ip_sum = (u16_t)~inet_chksum(iphdr, IP_HLEN);
+    // Pseudo header without the length, which udp_flow_send() adds together with the UDP one
+    sum = (u16_t)~inet_chksum(&iphdr->src, 2 * sizeof(ip4_addr_p_t));
+    sum += PP_HTONS(IP_PROTO_UDP);
+    sum += udphdr->src;
+    sum += udphdr->dest;
+    flow->udp_sum = udp_flow_fold(sum);
+    flow->chksum = (pcb->flags & UDP_FLAGS_NOCHKSUM) ? 0 : 1;
+
+    for(i = 1; i < flow->slots; i++)
+        MEMCPY(UDP_FLOW_FRAME(flow, i), frame, UDP_FLOW_HLEN);
+
+    flow->netif = netif;
+    flow->head = 0;
+    return ERR_OK;
+}
+
+// Payload area of the next frame buffer, UDP_FLOW_HLEN bytes into it, or NULL while the driver
+// still holds it. Fill it and pass the length to udp_flow_send().
+u8_t *udp_flow_get_buf(struct udp_flow *flow)
+{
+    if(flow->slot[flow->head].busy)
+        return NULL;
+    return UDP_FLOW_PAYLOAD(flow, flow->head);
+}
+
+// Sends len payload bytes from the next frame buffer. The buffer moves on even if the driver
+// refuses the frame, as udp_send() drops it in that case too.
+err_t udp_flow_send(struct udp_flow *flow, u16_t len)
+{
+    struct udp_flow_slot *slot = &flow->slot[flow->head];
+    struct netif *netif = flow->netif;
+    struct ip_hdr *iphdr;
+    struct udp_hdr *udphdr;
+    struct pbuf *p;
+    u8_t *frame;
+    u32_t sum;
+    u16_t ip_len, udp_len, frame_len;
+    err_t err;
+
+    if(netif == NULL)
+        return ERR_CONN;
+    if((len > flow->buf_size - UDP_FLOW_HLEN) || (len > netif->mtu - IP_HLEN - UDP_HLEN))
+        return ERR_VAL;
+    if(slot->busy)
+        return ERR_MEM;
+    if(!netif_is_up(netif) || !netif_is_link_up(netif))
+        return ERR_RTE;
+
+    frame = UDP_FLOW_FRAME(flow, flow->head);
+    iphdr = (struct ip_hdr *)(frame + UDP_FLOW_IP_OFS);
+    udphdr = (struct udp_hdr *)(frame + UDP_FLOW_UDP_OFS);
+    udp_len = (u16_t)(UDP_HLEN + len);
+    ip_len = (u16_t)(IP_HLEN + udp_len);
+
+    IPH_LEN_SET(iphdr, lwip_htons(ip_len));
+    IPH_ID_SET(iphdr, lwip_htons(flow->ip_id));
+    flow->ip_id++;
+#if CHECKSUM_GEN_IP
+    sum = (u32_t)flow->ip_sum + iphdr->_len + iphdr->_id;
+    IPH_CHKSUM_SET(iphdr, (u16_t)~udp_flow_fold(sum));
+#endif
+
+    udphdr->len = lwip_htons(udp_len);
+    udphdr->chksum = 0;
+#if CHECKSUM_GEN_UDP
+    if(flow->chksum)
+    {
+        sum = (u32_t)flow->udp_sum + 2 * (u32_t)udphdr->len + (u16_t)~inet_chksum(frame + UDP_FLOW_HLEN, len);
+        udphdr->chksum = (u16_t)~udp_flow_fold(sum);
+        if(udphdr->chksum == 0)
+            udphdr->chksum = 0xffff;
+    }
+#endif
+
+    frame_len = (u16_t)(UDP_FLOW_HLEN + len);
+    if(frame_len < UDP_FLOW_MIN_FRAME)
+    {
+        memset(frame + frame_len, 0, UDP_FLOW_MIN_FRAME - frame_len);
+        frame_len = UDP_FLOW_MIN_FRAME;
+    }
+
+    p = pbuf_alloced_custom(PBUF_RAW, frame_len, PBUF_REF, &slot->pc, frame, flow->buf_size);
+    p->flags |= PBUF_FLAG_UDP_FLOW;
+    slot->busy = 1;
+    if(++flow->head == flow->slots)
+        flow->head = 0;
+
+    err = netif->linkoutput(netif, p);
+    pbuf_free(p);
+    if(err == ERR_OK)
+    {
+        flow->tx++;
+        IP_STATS_INC(ip.xmit);
+        UDP_STATS_INC(udp.xmit);
+    }
+    else
+    {
+        flow->tx_err++;
+    }
+    return err;
+}
+
+u16_t udp_flow_free_bufs(const struct udp_flow *flow)
+{
+    u16_t i, n = 0;
+
+    for(i = 0; i < flow->slots; i++)
+    {
+        if(!flow->slot[i].busy)
+            n++;
+    }
+    return n;
+}
+
+#endif /* LWIP_UDP && LWIP_ARP && LWIP_SUPPORT_CUSTOM_PBUF */
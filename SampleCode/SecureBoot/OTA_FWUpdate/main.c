@@ -9,11 +9,20 @@
  ******************************************************************************/
 #include <stdio.h>
 #include "NuMicro.h"
+#include "fwupd.h"
 
 #define AP_BOOT_ADDR0     0x0000
 #define AP_BOOT_ADDR1     0x4000
-#define AP_HEAD           0x8000
+#define AP_SLOT_SIZE      0x4000
 #define RECEIVE_TIMEROUT  0x100
+#define BLOCK_SIZE        1024      /* Staging block, two of them fit the 8 KB RAM of the LDROM build */
+
+#ifdef __ICCARM__
+#pragma data_alignment=4
+static uint8_t s_au8Block[2 * BLOCK_SIZE];
+#else
+static uint8_t s_au8Block[2 * BLOCK_SIZE] __attribute__((aligned(4)));
+#endif
 
 void SYS_Init(void)
 {
@@ -48,6 +57,7 @@ void SYS_Init(void)
 
     /* Enable IP clock */
     CLK->APBCLK0 |= CLK_APBCLK0_UART0CKEN_Msk;
+    CLK->AHBCLK |= CLK_AHBCLK_CRPTCKEN_Msk;
 
 
     /* Set GPB multi-function pins for UART0 RXD and TXD */
@@ -89,6 +99,27 @@ static void PutString(char *str)
     }
 }
 
+static void PutHex(uint8_t u8Val)
+{
+    SendChar_ToUART("0123456789abcdef"[u8Val >> 4]);
+    SendChar_ToUART("0123456789abcdef"[u8Val & 0xF]);
+}
+
+static void PutDec(uint32_t u32Val)
+{
+    char str[11];
+    int i = 10;
+
+    str[i] = '\0';
+    do
+    {
+        str[--i] = '0' + (u32Val % 10);
+        u32Val /= 10;
+    }
+    while (u32Val != 0);
+    PutString(&str[i]);
+}
+
 /**
  * @brief       Receive data from UART0
  *
@@ -110,6 +141,7 @@ uint16_t ReceiveBytes(int32_t cnt)
         {
             return (UART0->DAT);
         }
+        FWUPD_Poll();   /* erase ahead and program while the line is idle */
     }
 }
 
@@ -121,22 +153,27 @@ uint16_t ReceiveBytes(int32_t cnt)
  *
  * @returns     AP_BOOT_ADDR0 or AP_BOOT_ADDR1
  *
+ * @details     The new firmware is the committed slot with the higher sequence. A slot is
+ *              committed only after all of its image was programmed.
  */
 uint32_t Get_Version(int item)
 {
+    uint32_t u32Seq0 = FWUPD_GetSeq(AP_BOOT_ADDR0, AP_SLOT_SIZE);
+    uint32_t u32Seq1 = FWUPD_GetSeq(AP_BOOT_ADDR1, AP_SLOT_SIZE);
+
     if(item==1)
     {
-        if (FMC_Read(AP_HEAD)==1)
-            return AP_BOOT_ADDR0;
-        else
+        if (u32Seq1 > u32Seq0)
             return AP_BOOT_ADDR1;
+        else
+            return AP_BOOT_ADDR0;
     }
     else
     {
-        if (FMC_Read(AP_HEAD)==1)
-            return AP_BOOT_ADDR1;
-        else
+        if (u32Seq1 > u32Seq0)
             return AP_BOOT_ADDR0;
+        else
+            return AP_BOOT_ADDR1;
     }
 }
 
@@ -148,64 +185,82 @@ uint32_t Get_Version(int item)
  *
  * @returns     None
  *
+ * @details     Hands the received bytes to the firmware update engine, which erases ahead, programs
+ *              1 KB blocks with multi-word bursts and hashes them with SHA-256 while the next block
+ *              arrives. The slot is committed once the image is complete; the SHA-256 is printed to be
+ *              compared with the one of the binary file.
  */
 void UpdatedFirmware(uint32_t UpdateAddr)
 {
-    uint8_t IdxBytes=0;
-    uint32_t Addr = UpdateAddr;
-    volatile uint32_t u32TmpPtr[1];
-    volatile uint8_t *u8TmpPtr = (uint8_t *)u32TmpPtr;
-    uint32_t cnt=0;
+    FWUPD_CFG_T sCfg;
+    FWUPD_STATS_T sStats;
+    uint8_t au8Chunk[16];
+    uint8_t au8Digest[FWUPD_DIGEST_SIZE];
+    uint32_t u32Seq0, u32Seq1;
+    uint32_t cnt=0, n=0, i;
     uint16_t tmp;
-    uint8_t ipage=0;
-    *u8TmpPtr=ReceiveBytes(0);
-    cnt++;
-    IdxBytes=1;
-    FMC_Erase(UpdateAddr);   /* Erase page */
+    int32_t ret;
+
+    u32Seq0 = FWUPD_GetSeq(AP_BOOT_ADDR0, AP_SLOT_SIZE);
+    u32Seq1 = FWUPD_GetSeq(AP_BOOT_ADDR1, AP_SLOT_SIZE);
+
+    sCfg.u32SlotBase = UpdateAddr;
+    sCfg.u32SlotSize = AP_SLOT_SIZE;
+    sCfg.u32ImageSize = 0;              /* not known, the transfer ends with a timeout */
+    sCfg.u32Seq = ((u32Seq0 > u32Seq1) ? u32Seq0 : u32Seq1) + 1;
+    sCfg.pu8Buf = s_au8Block;
+    sCfg.u32BlockSize = BLOCK_SIZE;
+    if (FWUPD_Begin(&sCfg) != FWUPD_OK)
+    {
+        PutString("\n.......begin failed\n");
+        return;
+    }
+
+    au8Chunk[n++]=ReceiveBytes(0);
+    ret = FWUPD_OK;
     while(1)
     {
         tmp = ReceiveBytes(0x20);
         if((tmp & RECEIVE_TIMEROUT)==0)
-        {
-            *(u8TmpPtr+IdxBytes)=(uint8_t)tmp;
-            cnt++;
-            IdxBytes++;
-        }
+            au8Chunk[n++]=(uint8_t)tmp;
         else
             break;
 
-        if(IdxBytes==4)
+        if(n==sizeof(au8Chunk))
         {
-            IdxBytes=0;
-            if(cnt%FMC_FLASH_PAGE_SIZE==(FMC_FLASH_PAGE_SIZE-1))
-            {
-                ipage++;
-                FMC_Erase(UpdateAddr+FMC_FLASH_PAGE_SIZE*ipage);   /* Erase page */
-            }
-            FMC_Write(Addr, *u32TmpPtr); /* Write data */
-            Addr+=4;
-            if(cnt%10==0) PutString(".");
+            ret = FWUPD_Write(au8Chunk, n);
+            if (ret != FWUPD_OK)
+                break;
+            cnt+=n;
+            n=0;
+            if(cnt%1024==0) PutString(".");
         }
     }
-    if(cnt%FMC_FLASH_PAGE_SIZE==(FMC_FLASH_PAGE_SIZE-1))
+    if ((ret == FWUPD_OK) && (n != 0))
+        ret = FWUPD_Write(au8Chunk, n);
+    if (ret == FWUPD_OK)
+        ret = FWUPD_Finish(NULL, au8Digest);
+    if (ret == FWUPD_OK)
+        ret = FWUPD_Commit();
+    if (ret != FWUPD_OK)
     {
-        ipage++;
-        FMC_Erase(UpdateAddr+FMC_FLASH_PAGE_SIZE*ipage);   /* Erase page */
+        FWUPD_Abort();
+        PutString("\n.......failed\n");
+        return;
     }
-    FMC_Write(Addr+=4, *u32TmpPtr);
 
-    FMC_Erase(AP_HEAD);
-    if(UpdateAddr==AP_BOOT_ADDR0)
-    {
-        FMC_Write(AP_HEAD, 1);
-        FMC_Write(AP_HEAD+4, 0);
-    }
-    else
-    {
-        FMC_Write(AP_HEAD, 0);
-        FMC_Write(AP_HEAD+4, 1);
-    }
-    PutString("\n.......finished\n");
+    FWUPD_GetStats(&sStats);
+    PutString("\nSHA-256 ");
+    for (i = 0; i < FWUPD_DIGEST_SIZE; i++)
+        PutHex(au8Digest[i]);
+    PutString("\n");
+    PutDec(sStats.u32Bytes);
+    PutString(" bytes, ");
+    PutDec(sStats.u32KBps);
+    PutString(" KB/s, ");
+    PutDec(sStats.u32StallUs);
+    PutString(" us waiting for flash\n");
+    PutString(".......finished\n");
 }
 
 void PutMassage(uint32_t addr)
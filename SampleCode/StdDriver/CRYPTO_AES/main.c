@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "NuMicro.h"
+#include "trace.h"
 
 
 uint32_t au32MyAESKey[8] =
@@ -47,6 +48,7 @@ void CRYPTO_IRQHandler()
     if (AES_GET_INT_FLAG(CRPT))
     {
         g_AES_done = 1;
+        TRACE_END(TRACE_ID_CRPT_AES, CRPT->INTSTS);
         AES_CLR_INT_FLAG(CRPT);
     }
 }
@@ -151,6 +153,7 @@ int32_t main (void)
     AES_SetDMATransfer(CRPT, 0, (uint32_t)au8InputData, (uint32_t)au8OutputData, sizeof(au8InputData));
 
     g_AES_done = 0;
+    TRACE_BEGIN(TRACE_ID_CRPT_AES, 0);
     AES_Start(CRPT, 0, CRYPTO_DMA_ONE_SHOT);
     while (!g_AES_done);
 
@@ -166,6 +169,7 @@ int32_t main (void)
     AES_SetDMATransfer(CRPT, 0, (uint32_t)au8OutputData, (uint32_t)au8InputData, sizeof(au8InputData));
 
     g_AES_done = 0;
+    TRACE_BEGIN(TRACE_ID_CRPT_AES, 0);
     AES_Start(CRPT, 0, CRYPTO_DMA_ONE_SHOT);
     while (!g_AES_done);
 
@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "NuMicro.h"
+#include "trace.h"
 
 #include "parser.c"
 
@@ -23,6 +24,7 @@ void CRYPTO_IRQHandler()
     if (SHA_GET_INT_FLAG(CRPT))
     {
         g_HMAC_done = 1;
+        TRACE_END(TRACE_ID_CRPT_SHA, CRPT->INTSTS >> CRPT_INTSTS_HMACIF_Pos);
         SHA_CLR_INT_FLAG(CRPT);
     }
 }
@@ -52,6 +54,7 @@ int HMAC_test()
     printf("Start HMAC...\n");
 
     g_HMAC_done = 0;
+    TRACE_BEGIN(TRACE_ID_CRPT_SHA, CRYPTO_DMA_ONE_SHOT);
     SHA_Start(CRPT, CRYPTO_DMA_ONE_SHOT);
     while (!g_HMAC_done) ;
 
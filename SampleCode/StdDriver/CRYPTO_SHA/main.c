@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "NuMicro.h"
+#include "trace.h"
 
 
 extern void open_test_vector(void);
@@ -30,6 +31,7 @@ void CRYPTO_IRQHandler()
     if (SHA_GET_INT_FLAG(CRPT))
     {
         g_SHA_done = 1;
+        TRACE_END(TRACE_ID_CRPT_SHA, CRPT->INTSTS >> CRPT_INTSTS_HMACIF_Pos);
         SHA_CLR_INT_FLAG(CRPT);
     }
 }
@@ -61,6 +63,7 @@ int  run_sha()
     printf("Key len= %d bits\n", _i32DataLen);
 
     g_SHA_done = 0;
+    TRACE_BEGIN(TRACE_ID_CRPT_SHA, CRYPTO_DMA_ONE_SHOT);
     SHA_Start(CRPT, CRYPTO_DMA_ONE_SHOT);
     while (!g_SHA_done) ;
 
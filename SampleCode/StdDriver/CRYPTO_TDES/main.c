@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "NuMicro.h"
+#include "trace.h"
 
 /* TDES Key:  1e4678a17f2c8a33 800e15ac47891a4c a011453291c23340 */
 uint32_t au8MyTDESKey[3][2] =
@@ -47,6 +48,7 @@ void CRYPTO_IRQHandler()
     if (TDES_GET_INT_FLAG(CRPT))
     {
         g_TDES_done = 1;
+        TRACE_END(TRACE_ID_CRPT_TDES, CRPT->INTSTS);
         TDES_CLR_INT_FLAG(CRPT);
     }
 }
@@ -150,6 +152,7 @@ int32_t main (void)
     TDES_SetDMATransfer(CRPT, 0, (uint32_t)au8InputData, (uint32_t)au8OutputData, sizeof(au8InputData));
 
     g_TDES_done = 0;
+    TRACE_BEGIN(TRACE_ID_CRPT_TDES, 0);
     TDES_Start(CRPT, 0, CRYPTO_DMA_ONE_SHOT);
     while (!g_TDES_done);
 
@@ -165,6 +168,7 @@ int32_t main (void)
     TDES_SetDMATransfer(CRPT, 0, (uint32_t)au8OutputData, (uint32_t)au8InputData, sizeof(au8InputData));
 
     g_TDES_done = 0;
+    TRACE_BEGIN(TRACE_ID_CRPT_TDES, 0);
     TDES_Start(CRPT, 0, CRYPTO_DMA_ONE_SHOT);
     while (!g_TDES_done);
 
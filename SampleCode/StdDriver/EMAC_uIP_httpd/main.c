@@ -11,18 +11,11 @@
 #include "NuMicro.h"
 #include "uip.h"
 #include "uip_arp.h"
-
-#define BUF ((struct uip_eth_hdr *)&uip_buf[0])
+#include "emacdev.h"
 
 // Our MAC address
 struct uip_eth_addr ethaddr = {{0x00, 0x00, 0x00, 0x59, 0x16, 0x88}};
 
-static uint8_t rxbuf[1514];
-static uint8_t txbuf[1514];
-uint32_t volatile u32PktLen;
-
-// Descriptor pointers holds current Tx and Rx used by IRQ handler here.
-uint32_t u32CurrentTxDesc, u32CurrentRxDesc;
 static uint32_t volatile curTime = 0;
 static uint32_t volatile prevTime = 0;  // increase every 0.5 sec
 
@@ -39,25 +32,6 @@ void EMAC_TX_IRQHandler(void)
 }
 
 
-/**
-  * @brief  EMAC Rx interrupt handler.
-  * @param  None
-  * @return None
-  */
-void EMAC_RX_IRQHandler(void)
-{
-    while(1)
-    {
-        // Get all recv data
-        if(EMAC_RecvPkt(rxbuf, (uint32_t *)&u32PktLen) == 0)
-            break;
-        // Clean up Rx resource occupied by previous received packet
-        EMAC_RecvPktDone();
-    }
-
-
-}
-
 void TMR0_IRQHandler(void)
 {
     curTime++;
@@ -130,48 +104,11 @@ void SYS_Init(void)
 
 
 
-uint32_t uip_read(void)
-{
-    int len = 0;
-
-    while((curTime == prevTime) && u32PktLen == 0);
-    if(u32PktLen != 0)
-    {
-        NVIC_DisableIRQ(EMAC_RX_IRQn);
-
-        if(u32PktLen != 0)
-        {
-            memcpy(uip_buf, rxbuf, u32PktLen);
-            len = u32PktLen;
-            u32PktLen = 0;
-        }
-
-        NVIC_EnableIRQ(EMAC_RX_IRQn);
-    }
-    else
-    {
-        prevTime++;
-    }
-    return len;
-}
-
-
-uint32_t uip_write(void)
-{
-    memcpy(txbuf, uip_buf, 40 + UIP_LLH_LEN);
-    if(uip_len > (40 + UIP_LLH_LEN))
-        memcpy(&txbuf[40 + UIP_LLH_LEN], (const void *)uip_appdata, uip_len - 40 - UIP_LLH_LEN);
-    return EMAC_SendPkt(txbuf, uip_len);
-
-
-}
-
-
 // This sample application can response to ICMP ECHO packets (ping)
 // IP address is configure with DHCP, but if a lease cannot be acquired, a static IP will be used.
 int main(void)
 {
-    u8_t i, arptimer = 0;
+    u8_t arptimer = 0;
     uip_ipaddr_t ipaddr = {0, 0};
 
     SYS_Init();
@@ -181,8 +118,8 @@ int main(void)
 
     // Select RMII interface by default
     EMAC_Open(ethaddr.addr);
+    // Rx descriptors are polled by emacdev_poll(), only Tx completion needs the interrupt
     NVIC_EnableIRQ(EMAC_TX_IRQn);
-    NVIC_EnableIRQ(EMAC_RX_IRQn);
     EMAC_ENABLE_RX();
     EMAC_ENABLE_TX();
 
@@ -200,45 +137,21 @@ int main(void)
     uip_setnetmask(ipaddr);
 
     uip_setethaddr(ethaddr);
+    emacdev_init();
     httpd_init();
 
     while(1)
     {
-        /* Let the network device driver read an entire IP packet
-           into the uip_buf. If it must wait for more than 0.5 seconds, it
-           will return with the return value 0. If so, we know that it is
-           time to call upon the uip_periodic(). Otherwise, the EMAC has
-           received an IP packet that is to be processed by uIP. */
-        uip_len = uip_read();
-        if(uip_len == 0)
-        {
-            for(i = 0; i < UIP_CONNS; i++)
-            {
-                uip_periodic(i);
-                /* If the above function invocation resulted in data that
-                   should be sent out on the network, the global variable
-                   uip_len is set to a value > 0. */
-                if(uip_len > 0)
-                {
-                    uip_arp_out();
-                    uip_write();
-                }
-            }
+        /* Let uIP process the frames the EMAC has received, up to one
+           descriptor ring per pass. The frames are exchanged with uip_buf,
+           not copied, and any reply is sent the same way. */
+        emacdev_poll(EMACDEV_BATCH);
 
-#if UIP_UDP
-            for(i = 0; i < UIP_UDP_CONNS; i++)
-            {
-                uip_udp_periodic(i);
-                /* If the above function invocation resulted in data that
-                   should be sent out on the network, the global variable
-                   uip_len is set to a value > 0. */
-                if(uip_len > 0)
-                {
-                    uip_arp_out();
-                    uip_write();
-                }
-            }
-#endif /* UIP_UDP */
+        /* Every 0.5 seconds it is time to call upon the uip_periodic(). */
+        if(curTime != prevTime)
+        {
+            prevTime++;
+            emacdev_periodic();
 
             /* Call the ARP timer function every 10 seconds. */
             if(++arptimer == 20)
@@ -246,34 +159,6 @@ int main(void)
                 uip_arp_timer();
                 arptimer = 0;
             }
-
-        }
-        else
-        {
-            if(BUF->type == htons(UIP_ETHTYPE_IP))
-            {
-                uip_arp_ipin();
-                uip_input();
-                /* If the above function invocation resulted in data that
-                   should be sent out on the network, the global variable
-                   uip_len is set to a value > 0. */
-                if(uip_len > 0)
-                {
-                    uip_arp_out();
-                    uip_write();
-                }
-            }
-            else if(BUF->type == htons(UIP_ETHTYPE_ARP))
-            {
-                uip_arp_arpin();
-                /* If the above function invocation resulted in data that
-                   should be sent out on the network, the global variable
-                   uip_len is set to a value > 0. */
-                if(uip_len > 0)
-                {
-                    uip_write();
-                }
-            }
         }
     }
 }
@@ -425,6 +425,16 @@ this uIP node, if UIP_FIXEDADDR is
  */
 #define UIP_BUFSIZE     1514//1500
 
+/**
+ * Determines if uip_buf is a pointer rather than an array.
+ *
+ * The EMAC device layer (emacdev.c) points uip_buf at EMAC frame
+ * buffers and exchanges them with the Rx and Tx descriptors instead
+ * of copying packets.
+ *
+ * \hideinitializer
+ */
+#define UIP_BUFPTR      1
 
 /**
  * Determines if statistics support should be compiled in.
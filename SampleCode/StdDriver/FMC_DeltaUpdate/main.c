@@ -0,0 +1,201 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V1.00
+ * @brief    Apply a delta firmware update received over UART0 and resume it
+ *           after a reset.
+ *
+ * @details  The running firmware in APROM bank 0 is the old image. Make the
+ *           patch on the host with Tool/FwDelta from the binary of this sample
+ *           and the new firmware:
+ *               fwdelta diff fmc_deltaupdate.bin new.bin patch.fwd
+ *           and send patch.fwd over UART0 as a raw binary file. The new image
+ *           is built in APROM bank 1, so programming never stalls the code
+ *           running from bank 0. Reset the board in the middle of an update and
+ *           the sample resumes at the last programmed page and asks for the
+ *           rest of the patch. Booting the new image is left out; see
+ *           FMC_MultiBoot for switching the vector page.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+
+#include "NuMicro.h"
+#include "fwdelta.h"
+
+#define OLD_BASE        FMC_APROM_BASE  /* Running firmware, bank 0 */
+#define NEW_BASE        0x40000UL       /* New image, bank 1 */
+#define SLOT_SIZE       0x3C000UL       /* Leaves the last two pages of bank 1 to the log */
+#define LOG_BASE        0x7E000UL       /* Progress log, two pages */
+
+/* UART bytes arriving while a page is erased and programmed */
+#define RX_BUF_SIZE     2048UL
+
+static uint32_t s_au32PageBuf[FMC_FLASH_PAGE_SIZE / 4];
+static uint8_t  s_au8RxBuf[RX_BUF_SIZE];
+static volatile uint32_t s_u32RxHead, s_u32RxTail, s_u32RxOverflow;
+
+
+void SYS_Init(void)
+{
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Set XT1_OUT(PF.2) and XT1_IN(PF.3) to input mode */
+    PF->MODE &= ~(GPIO_MODE_MODE2_Msk | GPIO_MODE_MODE3_Msk);
+
+    /* Enable HXT clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Wait for HXT clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Switch HCLK clock source to HXT */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HXT,CLK_CLKDIV0_HCLK(1));
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(FREQ_192MHZ);
+
+    /* Set both PCLK0 and PCLK1 as HCLK/2 */
+    CLK->PCLKDIV = CLK_PCLKDIV_PCLK0DIV2 | CLK_PCLKDIV_PCLK1DIV2;
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as HXT and UART module clock divider as 1 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UART0SEL_HXT, CLK_CLKDIV0_UART0(1));
+
+    /* Update System Core Clock */
+    SystemCoreClockUpdate();
+
+    /* Set GPB multi-function pins for UART0 RXD and TXD */
+    SYS->GPB_MFPH &= ~(SYS_GPB_MFPH_PB12MFP_Msk | SYS_GPB_MFPH_PB13MFP_Msk);
+    SYS->GPB_MFPH |= (SYS_GPB_MFPH_PB12MFP_UART0_RXD | SYS_GPB_MFPH_PB13MFP_UART0_TXD);
+
+    /* Lock protected registers */
+    SYS_LockReg();
+}
+
+void UART0_Init(void)
+{
+    /* Configure UART0 and set UART0 baud rate */
+    UART_Open(UART0, 115200);
+}
+
+/*
+ *  Patch bytes go to a ring buffer, the main loop feeds them to FWDELTA_Write().
+ *  A full ring drops the byte and fails the update.
+ */
+void UART0_IRQHandler(void)
+{
+    while (!UART_GET_RX_EMPTY(UART0))
+    {
+        if (s_u32RxHead - s_u32RxTail == RX_BUF_SIZE)
+        {
+            (void)UART_READ(UART0);
+            s_u32RxOverflow = 1;
+            continue;
+        }
+        s_au8RxBuf[s_u32RxHead % RX_BUF_SIZE] = UART_READ(UART0);
+        s_u32RxHead++;
+    }
+}
+
+int main()
+{
+    FWDELTA_CFG_T   sCfg;
+    FWDELTA_HDR_T   sHdr;
+    FWDELTA_STATS_T sStats;
+    uint32_t        u32PatchOff = 0, u32Head, u32Idx, u32Len;
+    int32_t         i32Ret;
+
+    SYS_Init();                        /* Init System, IP clock and multi-function I/O */
+
+    UART0_Init();                      /* Initialize UART0 */
+
+    printf("+------------------------------------+\n");
+    printf("|   M480 FMC Delta Update Sample     |\n");
+    printf("+------------------------------------+\n");
+
+    SYS_UnlockReg();                   /* Unlock protected registers */
+
+    FMC_Open();                        /* Enable FMC ISP function */
+
+    FMC_ENABLE_AP_UPDATE();            /* Enable APROM erase/program */
+
+    sCfg.u32OldBase = OLD_BASE;
+    sCfg.u32NewBase = NEW_BASE;
+    sCfg.u32SlotSize = SLOT_SIZE;
+    sCfg.u32LogBase = LOG_BASE;
+    sCfg.pu8PageBuf = (uint8_t *)s_au32PageBuf;
+
+    /*
+     *  An update interrupted by a reset continues from its last progress record.
+     */
+    if (FWDELTA_Resume(&sCfg, &sHdr, &u32PatchOff) == FWDELTA_OK)
+    {
+        printf("\nResuming the update to the image with CRC32 0x%08x.\n", sHdr.u32NewCrc);
+        printf("Send the patch from byte %d on, e.g. tail -c +%d patch.fwd\n", u32PatchOff, u32PatchOff + 1);
+    }
+    else
+    {
+        if (FWDELTA_Begin(&sCfg) != FWDELTA_OK)
+        {
+            printf("Failed to erase the progress log!\n");
+            goto lexit;
+        }
+        printf("\nSend the patch as a raw binary file.\n");
+    }
+
+    UART_ENABLE_INT(UART0, UART_INTEN_RDAIEN_Msk);
+    NVIC_EnableIRQ(UART0_IRQn);
+
+    do
+    {
+        u32Head = s_u32RxHead;
+        if (s_u32RxOverflow)
+        {
+            printf("UART receive buffer overflow!\n");
+            i32Ret = FWDELTA_ERR_FORMAT;
+            break;
+        }
+
+        /* The contiguous part of what has arrived */
+        u32Idx = s_u32RxTail % RX_BUF_SIZE;
+        u32Len = u32Head - s_u32RxTail;
+        if (u32Idx + u32Len > RX_BUF_SIZE)
+            u32Len = RX_BUF_SIZE - u32Idx;
+
+        i32Ret = FWDELTA_Write(&s_au8RxBuf[u32Idx], u32Len);
+        s_u32RxTail += u32Len;
+    }
+    while (i32Ret == FWDELTA_OK);
+
+    NVIC_DisableIRQ(UART0_IRQn);
+    UART_DISABLE_INT(UART0, UART_INTEN_RDAIEN_Msk);
+
+    if (i32Ret == FWDELTA_DONE)
+        i32Ret = FWDELTA_Finish();
+
+    FWDELTA_GetStats(&sStats);
+    printf("\n  Patch bytes ........................... [%d]\n", sStats.u32PatchBytes);
+    printf("  New image bytes ....................... [%d]\n", sStats.u32OutBytes);
+    printf("  Pages programmed ...................... [%d]\n", sStats.u32Pages);
+    printf("  Progress records ...................... [%d]\n", sStats.u32Checkpoints);
+    printf("  Erase and program time ................ [%d ms]\n", sStats.u32FlashUs / 1000);
+
+    if (i32Ret == FWDELTA_OK)
+        printf("\nThe new image at 0x%x is verified.\n", (unsigned int)NEW_BASE);
+    else if (i32Ret == FWDELTA_ERR_OLD)
+        printf("\nThe patch was not made for the running firmware!\n");
+    else
+        printf("\nUpdate failed (%d), reset to resume it.\n", i32Ret);
+
+lexit:
+    FMC_DISABLE_AP_UPDATE();           /* Disable APROM erase/program */
+    FMC_Close();                       /* Disable FMC ISP function */
+    SYS_LockReg();                     /* Lock protected registers */
+
+    while (1);
+}
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include "NuMicro.h"
 #include "massstorage.h"
+#include "hsusbd_msc.h"
 
 #define DATA_FLASH_BASE  0x00040000
 
@@ -63,6 +64,7 @@ void SYS_Init(void)
 int32_t main (void)
 {
     uint32_t au32Config[2];
+    HSMSC_STATS_T sStats;
 
     /* Init System, IP clock and multi-function I/O
        In the end of SYS_Init() will issue SYS_LockReg()
@@ -75,6 +77,7 @@ int32_t main (void)
     UART_Open(UART0, 115200);
 
     printf("M480 HSUSB Mass Storage\n");
+    printf("Press any key to show the transfer rates.\n");
 
     SYS_UnlockReg();
     /* Enable FMC ISP function */
@@ -108,7 +111,7 @@ int32_t main (void)
     }
 
 
-    HSUSBD_Open(&gsHSInfo, MSC_ClassRequest, NULL);
+    HSUSBD_Open(&gsHSInfo, HSMSC_ClassRequest, NULL);
 
     /* Endpoint configuration */
     MSC_Init();
@@ -128,8 +131,20 @@ int32_t main (void)
 
     while(1)
     {
-        if (g_hsusbd_Configured)
-            MSC_ProcessCmd();
+        HSMSC_Process();
+
+        if (!UART_GET_RX_EMPTY(UART0))
+        {
+            getchar();
+            HSMSC_GetStats(&sStats);
+            printf("Read : %d cmds, %d bytes, %d.%03d MB/s\n", sStats.u32ReadCmds, sStats.u32ReadBytes,
+                   sStats.u32ReadKBps / 1000, sStats.u32ReadKBps % 1000);
+            printf("Write: %d cmds, %d bytes, %d.%03d MB/s\n", sStats.u32WriteCmds, sStats.u32WriteBytes,
+                   sStats.u32WriteKBps / 1000, sStats.u32WriteKBps % 1000);
+            printf("Wait : USB %d us, flash %d us, errors %d\n", sStats.u32UsbWaitUs, sStats.u32DiskWaitUs,
+                   sStats.u32DiskErrors);
+            HSMSC_ClearStats();
+        }
     }
 }
 
@@ -10,78 +10,29 @@
 #include <string.h>
 #include "NuMicro.h"
 #include "massstorage.h"
+#include "hsusbd_msc.h"
 
 /*--------------------------------------------------------------------------*/
-/* Global variables for Control Pipe */
-int32_t g_TotalSectors = 0;
-
-/* USB flow control variables */
-uint8_t g_u8BulkState = BULK_NORMAL;
-uint8_t g_u8Prevent = 0;
-uint8_t volatile g_u8MscStart = 0;
-uint8_t g_au8SenseKey[4];
-
-uint32_t g_u32MSCMaxLun = 0;
-uint32_t g_u32LbaAddress;
-uint32_t g_u32MassBase, g_u32StorageBase;
-
-uint32_t g_u32EpMaxPacketSize;
-
-/* CBW/CSW variables */
-struct CBW g_sCBW;
-struct CSW g_sCSW;
-
-
-/*--------------------------------------------------------------------------*/
-uint8_t g_au8InquiryID[36] =
-{
-    0x00,                   /* Peripheral Device Type */
-    0x80,                   /* RMB */
-    0x00,                   /* ISO/ECMA, ANSI Version */
-    0x00,                   /* Response Data Format */
-    0x1F, 0x00, 0x00, 0x00, /* Additional Length */
-
-    /* Vendor Identification */
-    'N', 'u', 'v', 'o', 't', 'o', 'n', ' ',
-
-    /* Product Identification */
-    'U', 'S', 'B', ' ', 'M', 'a', 's', 's', ' ', 'S', 't', 'o', 'r', 'a', 'g', 'e',
-
-    /* Product Revision */
-    '1', '.', '0', '0'
-};
-
-// code = 5Ah, Mode Sense
-static uint8_t g_au8ModePage_01[12] =
+/* Two chunk buffers for the class and the SRAM that holds the disk */
+#ifdef __ICCARM__
+#pragma data_alignment=4
+static uint8_t s_au8ChunkBuf[2 * MSC_CHUNK_SIZE];
+#pragma data_alignment=4
+static uint8_t s_au8RamDisk[MSC_RAM_DISK_SIZE];
+#else
+static uint8_t s_au8ChunkBuf[2 * MSC_CHUNK_SIZE] __attribute__((aligned(4)));
+static uint8_t s_au8RamDisk[MSC_RAM_DISK_SIZE] __attribute__((aligned(4)));
+#endif
+
+static HSMSC_DISK_T s_sDisk;
+
+static const HSMSC_CFG_T s_sMscCfg =
 {
-    0x01, 0x0A, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00,
-    0x03, 0x00, 0x00, 0x00
-};
-
-static uint8_t g_au8ModePage_05[32] =
-{
-    0x05, 0x1E, 0x13, 0x88, 0x08, 0x20, 0x02, 0x00,
-    0x01, 0xF4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x05, 0x1E, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x01, 0x68, 0x00, 0x00
-};
-
-static uint8_t g_au8ModePage_1B[12] =
-{
-    0x1B, 0x0A, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00
-};
-
-static uint8_t g_au8ModePage_1C[8] =
-{
-    0x1C, 0x06, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00
-};
-
-static uint8_t g_au8ModePage[24] =
-{
-    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x02, 0x00, 0x1C, 0x0A, 0x80, 0x03,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01
+    &s_sDisk,
+    s_au8ChunkBuf, MSC_CHUNK_SIZE,
+    EPA, BULK_IN_EP_NUM, EPA_BUF_BASE,
+    EPB, BULK_OUT_EP_NUM, EPB_BUF_BASE,
+    EPA_BUF_LEN
 };
 
 void USBD20_IRQHandler(void)
@@ -103,33 +54,24 @@ void USBD20_IRQHandler(void)
         if (IrqSt & HSUSBD_BUSINTSTS_RSTIF_Msk)
         {
             HSUSBD_SwReset();
-            g_u8MscStart = 0;
-            g_u8BulkState = BULK_NORMAL;
-
-            HSUSBD_ResetDMA();
-            HSUSBD->EP[EPA].EPRSPCTL = HSUSBD_EPRSPCTL_FLUSH_Msk;
-            HSUSBD->EP[EPB].EPRSPCTL = HSUSBD_EPRSPCTL_FLUSH_Msk;
 
-            if (HSUSBD->OPER & 0x04)  /* high speed */
-                MSC_InitForHighSpeed();
-            else                    /* full speed */
-                MSC_InitForFullSpeed();
+            HSMSC_InitEndpoints(HSUSBD->OPER & 0x04);   /* high speed or full speed */
             HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_SETUPPKIEN_Msk);
             HSUSBD_SET_ADDR(0);
-            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_RESUMEIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
+            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk|HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_RESUMEIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_RSTIF_Msk);
             HSUSBD_CLR_CEP_INT_FLAG(0x1ffc);
         }
 
         if (IrqSt & HSUSBD_BUSINTSTS_RESUMEIF_Msk)
         {
-            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
+            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk|HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_RESUMEIF_Msk);
         }
 
         if (IrqSt & HSUSBD_BUSINTSTS_SUSPENDIF_Msk)
         {
-            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_RSTIEN_Msk | HSUSBD_BUSINTEN_RESUMEIEN_Msk);
+            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk | HSUSBD_BUSINTEN_RSTIEN_Msk | HSUSBD_BUSINTEN_RESUMEIEN_Msk);
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_SUSPENDIF_Msk);
         }
 
@@ -143,22 +85,7 @@ void USBD20_IRQHandler(void)
         {
             g_hsusbd_DmaDone = 1;
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_DMADONEIF_Msk);
-
-            if (!(HSUSBD->DMACTL & HSUSBD_DMACTL_DMARD_Msk))
-            {
-                if (g_u8BulkState == BULK_OUT)
-                    g_u8BulkState = BULK_CBW;
-                HSUSBD_ENABLE_EP_INT(EPB, HSUSBD_EPINTEN_RXPKIEN_Msk);
-            }
-
-            if (HSUSBD->DMACTL & HSUSBD_DMACTL_DMARD_Msk)
-            {
-                if (g_hsusbd_ShortPacket == 1)
-                {
-                    HSUSBD->EP[EPA].EPRSPCTL = (HSUSBD->EP[EPA].EPRSPCTL & 0x10) | HSUSBD_EP_RSPCTL_SHORTTXEN;    // packet end
-                    g_hsusbd_ShortPacket = 0;
-                }
-            }
+            HSMSC_DmaDoneHandler();
         }
 
         if (IrqSt & HSUSBD_BUSINTSTS_PHYCLKVLDIF_Msk)
@@ -294,21 +221,8 @@ void USBD20_IRQHandler(void)
         }
     }
 
-    /* bulk in */
-    if (IrqStL & HSUSBD_GINTSTS_EPAIF_Msk)
-    {
-        IrqSt = HSUSBD->EP[EPA].EPINTSTS & HSUSBD->EP[EPA].EPINTEN;
-
-        HSUSBD_ENABLE_EP_INT(EPA, 0);
-        HSUSBD_CLR_EP_INT_FLAG(EPA, IrqSt);
-    }
-    /* bulk out */
-    if (IrqStL & HSUSBD_GINTSTS_EPBIF_Msk)
-    {
-        IrqSt = HSUSBD->EP[EPB].EPINTSTS & HSUSBD->EP[EPB].EPINTEN;
-        HSUSBD_ENABLE_EP_INT(EPB, 0);
-        HSUSBD_CLR_EP_INT_FLAG(EPB, IrqSt);
-    }
+    /* bulk in and bulk out */
+    HSMSC_EpHandler(IrqStL);
 
     if (IrqStL & HSUSBD_GINTSTS_EPCIF_Msk)
     {
@@ -371,40 +285,6 @@ void USBD20_IRQHandler(void)
     }
 }
 
-void MSC_InitForHighSpeed(void)
-{
-    /*****************************************************/
-    /* EPA ==> Bulk IN endpoint, address 1 */
-    HSUSBD_SetEpBufAddr(EPA, EPA_BUF_BASE, EPA_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPA, EPA_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPA, BULK_IN_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_IN);
-
-    /* EPB ==> Bulk OUT endpoint, address 2 */
-    HSUSBD_SetEpBufAddr(EPB, EPB_BUF_BASE, EPB_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPB, EPB_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPB, BULK_OUT_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_OUT);
-    HSUSBD_ENABLE_EP_INT(EPB, HSUSBD_EPINTEN_RXPKIEN_Msk);
-
-    g_u32EpMaxPacketSize = EPA_MAX_PKT_SIZE;
-}
-
-void MSC_InitForFullSpeed(void)
-{
-    /*****************************************************/
-    /* EPA ==> Bulk IN endpoint, address 1 */
-    HSUSBD_SetEpBufAddr(EPA, EPA_BUF_BASE, EPA_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPA, EPA_OTHER_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPA, BULK_IN_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_IN);
-
-    /* EPB ==> Bulk OUT endpoint, address 2 */
-    HSUSBD_SetEpBufAddr(EPB, EPB_BUF_BASE, EPB_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPB, EPB_OTHER_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPB, BULK_OUT_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_OUT);
-    HSUSBD_ENABLE_EP_INT(EPB, HSUSBD_EPINTEN_RXPKIEN_Msk);
-
-    g_u32EpMaxPacketSize = EPA_OTHER_MAX_PKT_SIZE;
-}
-
 void MSC_Init(void)
 {
     /* Configure USB controller */
@@ -420,479 +300,8 @@ void MSC_Init(void)
     HSUSBD_SetEpBufAddr(CEP, CEP_BUF_BASE, CEP_BUF_LEN);
     HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_SETUPPKIEN_Msk|HSUSBD_CEPINTEN_STSDONEIEN_Msk);
 
-    MSC_InitForHighSpeed();
-
-    g_sCSW.dCSWSignature = CSW_SIGNATURE;
-    /* when doing FDBENCH, the disk size should >= 5MB */
-    //g_TotalSectors = 10240;
-    g_TotalSectors = 60;
-    g_u32MassBase = 0x20001000;
-    g_u32StorageBase = 0x20002000;
-}
-
-void MSC_ClassRequest(void)
-{
-    g_u8MscStart = 1;
-    if (gUsbCmd.bmRequestType & 0x80)   /* request data transfer direction */
-    {
-        // Device to host
-        switch (gUsbCmd.bRequest)
-        {
-        case GET_MAX_LUN:
-        {
-            // Return current configuration setting
-            HSUSBD_PrepareCtrlIn((uint8_t *)&g_u32MSCMaxLun, 1);
-            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_INTKIF_Msk);
-            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_INTKIEN_Msk);
-            break;
-        }
-        default:
-        {
-            /* Setup error, stall the device */
-            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
-            break;
-        }
-        }
-    }
-    else
-    {
-        // Host to device
-        switch (gUsbCmd.bRequest)
-        {
-        case BULK_ONLY_MASS_STORAGE_RESET:
-        {
-            /* Status stage */
-            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_STSDONEIF_Msk);
-            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_NAKCLR);
-            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_STSDONEIEN_Msk);
-            break;
-        }
-        default:
-        {
-            // Stall
-            /* Setup error, stall the device */
-            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
-            break;
-        }
-        }
-    }
-}
-
-
-void MSC_RequestSense(void)
-{
-    memset((uint8_t *)(g_u32MassBase), 0, 18);
-    if (g_u8Prevent)
-    {
-        g_u8Prevent = 0;
-        *(uint8_t *)(g_u32MassBase) = 0x70;
-    }
-    else
-        *(uint8_t *)(g_u32MassBase) = 0xf0;
-
-    *(uint8_t *)(g_u32MassBase + 2) = g_au8SenseKey[0];
-    *(uint8_t *)(g_u32MassBase + 7) = 0x0a;
-    *(uint8_t *)(g_u32MassBase + 12) = g_au8SenseKey[1];
-    *(uint8_t *)(g_u32MassBase + 13) = g_au8SenseKey[2];
-    MSC_BulkIn(g_u32MassBase, g_sCBW.dCBWDataTransferLength);
-
-    g_au8SenseKey[0] = 0;
-    g_au8SenseKey[1] = 0;
-    g_au8SenseKey[2] = 0;
-}
-
-void MSC_ReadFormatCapacity(void)
-{
-    memset((uint8_t *)g_u32MassBase, 0, 36);
-
-    *((uint8_t *)(g_u32MassBase+3)) = 0x10;
-    *((uint8_t *)(g_u32MassBase+4)) = *((uint8_t *)&g_TotalSectors+3);
-    *((uint8_t *)(g_u32MassBase+5)) = *((uint8_t *)&g_TotalSectors+2);
-    *((uint8_t *)(g_u32MassBase+6)) = *((uint8_t *)&g_TotalSectors+1);
-    *((uint8_t *)(g_u32MassBase+7)) = *((uint8_t *)&g_TotalSectors+0);
-    *((uint8_t *)(g_u32MassBase+8)) = 0x02;
-    *((uint8_t *)(g_u32MassBase+10)) = 0x02;
-    *((uint8_t *)(g_u32MassBase+12)) = *((uint8_t *)&g_TotalSectors+3);
-    *((uint8_t *)(g_u32MassBase+13)) = *((uint8_t *)&g_TotalSectors+2);
-    *((uint8_t *)(g_u32MassBase+14)) = *((uint8_t *)&g_TotalSectors+1);
-    *((uint8_t *)(g_u32MassBase+15)) = *((uint8_t *)&g_TotalSectors+0);
-    *((uint8_t *)(g_u32MassBase+18)) = 0x02;
-
-    MSC_BulkIn(g_u32MassBase, g_sCBW.dCBWDataTransferLength);
-}
-
-void MSC_ReadCapacity(void)
-{
-    uint32_t tmp;
-
-    memset((uint8_t *)g_u32MassBase, 0, 36);
-
-    tmp = g_TotalSectors - 1;
-    *((uint8_t *)(g_u32MassBase+0)) = *((uint8_t *)&tmp+3);
-    *((uint8_t *)(g_u32MassBase+1)) = *((uint8_t *)&tmp+2);
-    *((uint8_t *)(g_u32MassBase+2)) = *((uint8_t *)&tmp+1);
-    *((uint8_t *)(g_u32MassBase+3)) = *((uint8_t *)&tmp+0);
-    *((uint8_t *)(g_u32MassBase+6)) = 0x02;
-
-    MSC_BulkIn(g_u32MassBase, g_sCBW.dCBWDataTransferLength);
-}
-
-void MSC_ModeSense10(void)
-{
-    uint8_t i,j;
-    uint8_t NumHead,NumSector;
-    uint16_t NumCyl=0;
-
-    /* Clear the command buffer */
-    *((uint32_t *)g_u32MassBase  ) = 0;
-    *((uint32_t *)g_u32MassBase + 1) = 0;
-
-    switch (g_sCBW.au8Data[0])
-    {
-    case 0x01:
-        *((uint8_t *)g_u32MassBase) = 19;
-        i = 8;
-        for (j = 0; j<12; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_01[j];
-        break;
-
-    case 0x05:
-        *((uint8_t *)g_u32MassBase) = 39;
-        i = 8;
-        for (j = 0; j<32; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_05[j];
-
-        NumHead = 2;
-        NumSector = 64;
-        NumCyl = g_TotalSectors / 128;
-
-        *((uint8_t *)(g_u32MassBase+12)) = NumHead;
-        *((uint8_t *)(g_u32MassBase+13)) = NumSector;
-        *((uint8_t *)(g_u32MassBase+16)) = (uint8_t)(NumCyl >> 8);
-        *((uint8_t *)(g_u32MassBase+17)) = (uint8_t)(NumCyl & 0x00ff);
-        break;
-
-    case 0x1B:
-        *((uint8_t *)g_u32MassBase) = 19;
-        i = 8;
-        for (j = 0; j<12; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_1B[j];
-        break;
-
-    case 0x1C:
-        *((uint8_t *)g_u32MassBase) = 15;
-        i = 8;
-        for (j = 0; j<8; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_1C[j];
-        break;
-
-    case 0x3F:
-        *((uint8_t *)g_u32MassBase) = 0x47;
-        i = 8;
-        for (j = 0; j<12; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_01[j];
-        for (j = 0; j<32; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_05[j];
-        for (j = 0; j<12; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_1B[j];
-        for (j = 0; j<8; j++, i++)
-            *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage_1C[j];
-
-        NumHead = 2;
-        NumSector = 64;
-        NumCyl = g_TotalSectors / 128;
-
-        *((uint8_t *)(g_u32MassBase+24)) = NumHead;
-        *((uint8_t *)(g_u32MassBase+25)) = NumSector;
-        *((uint8_t *)(g_u32MassBase+28)) = (uint8_t)(NumCyl >> 8);
-        *((uint8_t *)(g_u32MassBase+29)) = (uint8_t)(NumCyl & 0x00ff);
-        break;
-
-    default:
-        g_au8SenseKey[0] = 0x05;
-        g_au8SenseKey[1] = 0x24;
-        g_au8SenseKey[2] = 0x00;
-    }
-    MSC_BulkIn(g_u32MassBase, g_sCBW.dCBWDataTransferLength);
-}
-
-void MSC_ModeSense6(void)
-{
-    uint8_t i;
-
-    for (i = 0; i<4; i++)
-        *((uint8_t *)(g_u32MassBase+i)) = g_au8ModePage[i];
-
-    MSC_BulkIn(g_u32MassBase, g_sCBW.dCBWDataTransferLength);
-}
-
-void MSC_BulkOut(uint32_t u32Addr, uint32_t u32Len)
-{
-    uint32_t u32Loop;
-    uint32_t i;
-
-    /* bulk out, dma write, epnum = 2 */
-    HSUSBD_SET_DMA_WRITE(BULK_OUT_EP_NUM);
-    g_hsusbd_ShortPacket = 0;
-
-    u32Loop = u32Len / USBD_MAX_DMA_LEN;
-    for (i=0; i<u32Loop; i++)
-    {
-        MSC_ActiveDMA(u32Addr+i*USBD_MAX_DMA_LEN, USBD_MAX_DMA_LEN);
-    }
-
-    u32Loop = u32Len % USBD_MAX_DMA_LEN;
-    if (u32Loop)
-    {
-        MSC_ActiveDMA(u32Addr+i*USBD_MAX_DMA_LEN, u32Loop);
-    }
-}
-
-void MSC_BulkIn(uint32_t u32Addr, uint32_t u32Len)
-{
-    uint32_t u32Loop;
-    uint32_t i, addr, count;
-
-    /* bulk in, dma read, epnum = 1 */
-    HSUSBD_SET_DMA_READ(BULK_IN_EP_NUM);
-
-    u32Loop = u32Len / USBD_MAX_DMA_LEN;
-    for (i=0; i<u32Loop; i++)
-    {
-        HSUSBD_ENABLE_EP_INT(EPA, HSUSBD_EPINTEN_TXPKIEN_Msk);
-        g_hsusbd_ShortPacket = 0;
-        while(1)
-        {
-            if (HSUSBD_GET_EP_INT_FLAG(EPA) & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk)
-            {
-                MSC_ActiveDMA(u32Addr+i*USBD_MAX_DMA_LEN, USBD_MAX_DMA_LEN);
-                break;
-            }
-        }
-    }
-
-    addr = u32Addr + i * USBD_MAX_DMA_LEN;
-    u32Loop = u32Len % USBD_MAX_DMA_LEN;
-    if (u32Loop)
-    {
-        count = u32Loop / g_u32EpMaxPacketSize;
-        if (count)
-        {
-            HSUSBD_ENABLE_EP_INT(EPA, HSUSBD_EPINTEN_TXPKIEN_Msk);
-            g_hsusbd_ShortPacket = 0;
-            while(1)
-            {
-                if (HSUSBD_GET_EP_INT_FLAG(EPA) & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk)
-                {
-                    MSC_ActiveDMA(addr, count * g_u32EpMaxPacketSize);
-                    break;
-                }
-            }
-            addr += (count * g_u32EpMaxPacketSize);
-        }
-        count = u32Loop % g_u32EpMaxPacketSize;
-        if (count)
-        {
-            HSUSBD_ENABLE_EP_INT(EPA, HSUSBD_EPINTEN_TXPKIEN_Msk);
-            g_hsusbd_ShortPacket = 1;
-            while(1)
-            {
-                if (HSUSBD_GET_EP_INT_FLAG(EPA) & HSUSBD_EPINTSTS_BUFEMPTYIF_Msk)
-                {
-                    MSC_ActiveDMA(addr, count);
-                    break;
-                }
-            }
-        }
-    }
-}
-
-
-void MSC_ReceiveCBW(uint32_t u32Buf)
-{
-    /* bulk out, dma write, epnum = 2 */
-    HSUSBD_SET_DMA_WRITE(BULK_OUT_EP_NUM);
-
-    /* Enable BUS interrupt */
-    HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk|HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_VBUSDETIEN_Msk);
-
-    HSUSBD_SET_DMA_ADDR(u32Buf);
-    HSUSBD_SET_DMA_LEN(31);
-
-    g_hsusbd_DmaDone = 0;
-    HSUSBD_ENABLE_DMA();
-
-    while(g_u8MscStart)
-    {
-        if (g_hsusbd_DmaDone == 1)
-            break;
-
-        if (!HSUSBD_IS_ATTACHED())
-            break;
-    }
-}
-
-void MSC_ProcessCmd(void)
-{
-    uint32_t i;
-
-    if (g_u8BulkState == BULK_NORMAL)
-    {
-        g_u8BulkState = BULK_OUT;
-        MSC_ReceiveCBW(g_u32MassBase);
-    }
-
-    if (g_u8BulkState == BULK_CBW)
-    {
-        /* Check Signature of CBW */
-        if ((*(uint32_t *)(g_u32MassBase) != CBW_SIGNATURE))
-        {
-            g_u8BulkState = BULK_NORMAL;
-            return;
-        }
-
-        /* Get the CBW */
-        for (i = 0; i < 31; i++)
-            *((uint8_t *) (&g_sCBW.dCBWSignature) + i) = *(uint8_t *)(g_u32MassBase + i);
-
-        /* Prepare to echo the tag from CBW to CSW */
-        g_sCSW.dCSWTag = g_sCBW.dCBWTag;
-
-        /* Parse Op-Code of CBW */
-        switch (g_sCBW.u8OPCode)
-        {
-        case UFI_READ_10:
-        {
-            /* Get LBA address */
-            g_u32LbaAddress = get_be32(&g_sCBW.au8Data[0]) * USBD_SECTOR_SIZE;
-            //MSC_ReadMedia(g_u32LbaAddress, g_sCBW.dCBWDataTransferLength, (uint8_t *)g_u32StorageBase);
-
-            MSC_BulkIn(g_u32StorageBase+g_u32LbaAddress, g_sCBW.dCBWDataTransferLength);
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_WRITE_10:
-        {
-            g_u32LbaAddress = get_be32(&g_sCBW.au8Data[0]) * USBD_SECTOR_SIZE;
-            MSC_BulkOut(g_u32StorageBase+g_u32LbaAddress, g_sCBW.dCBWDataTransferLength);
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_PREVENT_ALLOW_MEDIUM_REMOVAL:
-        {
-            if (g_sCBW.au8Data[2] & 0x01)
-            {
-                g_au8SenseKey[0] = 0x05;  //INVALID COMMAND
-                g_au8SenseKey[1] = 0x24;
-                g_au8SenseKey[2] = 0;
-                g_u8Prevent = 1;
-            }
-            else
-                g_u8Prevent = 0;
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_VERIFY_10:
-        case UFI_START_STOP:
-        case UFI_TEST_UNIT_READY:
-        {
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_REQUEST_SENSE:
-        {
-            MSC_RequestSense();
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_READ_FORMAT_CAPACITY:
-        {
-            MSC_ReadFormatCapacity();
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_READ_CAPACITY:
-        {
-            MSC_ReadCapacity();
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_MODE_SELECT_10:
-        {
-            MSC_BulkOut(g_u32StorageBase, g_sCBW.dCBWDataTransferLength);
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_MODE_SENSE_10:
-        {
-            MSC_ModeSense10();
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_MODE_SENSE_6:
-        {
-            MSC_ModeSense6();
-            MSC_AckCmd(0);
-            break;
-        }
-        case UFI_INQUIRY:
-        {
-            /* Bulk IN buffer */
-            HSUSBD_MemCopy((uint8_t *)(g_u32MassBase), (uint8_t *)g_au8InquiryID, 36);
-            MSC_BulkIn(g_u32MassBase, g_sCBW.dCBWDataTransferLength);
-            MSC_AckCmd(0);
-            break;
-        }
-        default:
-        {
-            /* Unsupported command */
-            g_au8SenseKey[0] = 0x05;
-            g_au8SenseKey[1] = 0x20;
-            g_au8SenseKey[2] = 0x00;
-
-            /* If CBW request for data phase, just return zero packet to end data phase */
-            if (g_sCBW.dCBWDataTransferLength > 0)
-                MSC_AckCmd(g_sCBW.dCBWDataTransferLength);
-            else
-                MSC_AckCmd(0);
-        }
-        }
-    }
+    /* The SRAM array is the disk, bulk endpoints are run by the MSC class */
+    HSMSC_RamDiskInit(&s_sDisk, s_au8RamDisk, MSC_RAM_DISK_SIZE);
+    HSMSC_Open(&s_sMscCfg);
+    HSMSC_InitEndpoints(1);
 }
-
-void MSC_ActiveDMA(uint32_t u32Addr, uint32_t u32Len)
-{
-    /* Enable BUS interrupt */
-    HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk|HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_VBUSDETIEN_Msk);
-
-    HSUSBD_SET_DMA_ADDR(u32Addr);
-    HSUSBD_SET_DMA_LEN(u32Len);
-    g_hsusbd_DmaDone = 0;
-    HSUSBD_ENABLE_DMA();
-    while(g_u8MscStart)
-    {
-        if (g_hsusbd_DmaDone)
-            break;
-
-        if (!HSUSBD_IS_ATTACHED())
-            break;
-    }
-}
-
-void MSC_AckCmd(uint32_t u32Residue)
-{
-    g_sCSW.dCSWDataResidue = u32Residue;
-    g_sCSW.bCSWStatus = g_u8Prevent;
-    HSUSBD_MemCopy((uint8_t *)g_u32MassBase, (uint8_t *)&g_sCSW.dCSWSignature, 16);
-    MSC_BulkIn(g_u32MassBase, 13);
-    g_u8BulkState = BULK_NORMAL;
-}
-
-void MSC_ReadMedia(uint32_t addr, uint32_t size, uint8_t *buffer)
-{
-}
-
-void MSC_WriteMedia(uint32_t addr, uint32_t size, uint8_t *buffer)
-{
-}
-
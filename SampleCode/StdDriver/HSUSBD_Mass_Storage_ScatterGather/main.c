@@ -2,13 +2,14 @@
  * @file     main.c
  * @version  V1.00
  * @brief    Use internal SRAM as back end storage media to simulate a
- *           30 KB USB pen drive
+ *           30 KB USB pen drive kept in scattered SRAM segments
  *
  * @copyright (C) 2016 Nuvoton Technology Corp. All rights reserved.
  ******************************************************************************/
 #include <stdio.h>
 #include "NuMicro.h"
 #include "massstorage.h"
+#include "hsusbd_msc.h"
 
 /*--------------------------------------------------------------------------*/
 void SYS_Init(void)
@@ -57,11 +58,10 @@ void SYS_Init(void)
 
 }
 
-extern uint8_t volatile g_u8MscStart;
-
-
 int32_t main (void)
 {
+    HSMSC_STATS_T sStats;
+
     /* Init System, IP clock and multi-function I/O
        In the end of SYS_Init() will issue SYS_LockReg()
        to lock protected register. If user want to write
@@ -73,8 +73,9 @@ int32_t main (void)
     UART_Open(UART0, 115200);
 
     printf("M480 HSUSB Mass Storage\n");
+    printf("Press any key to show the transfer rates.\n");
 
-    HSUSBD_Open(&gsHSInfo, MSC_ClassRequest, NULL);
+    HSUSBD_Open(&gsHSInfo, HSMSC_ClassRequest, NULL);
 
     /* Endpoint configuration */
     MSC_Init();
@@ -94,8 +95,20 @@ int32_t main (void)
 
     while(1)
     {
-        if (g_u8MscStart)
-            MSC_ProcessCmd();
+        HSMSC_Process();
+
+        if (!UART_GET_RX_EMPTY(UART0))
+        {
+            getchar();
+            HSMSC_GetStats(&sStats);
+            printf("Read : %d cmds, %d bytes, %d.%03d MB/s\n", sStats.u32ReadCmds, sStats.u32ReadBytes,
+                   sStats.u32ReadKBps / 1000, sStats.u32ReadKBps % 1000);
+            printf("Write: %d cmds, %d bytes, %d.%03d MB/s\n", sStats.u32WriteCmds, sStats.u32WriteBytes,
+                   sStats.u32WriteKBps / 1000, sStats.u32WriteKBps % 1000);
+            printf("Wait : USB %d us, disk %d us, errors %d\n", sStats.u32UsbWaitUs, sStats.u32DiskWaitUs,
+                   sStats.u32DiskErrors);
+            HSMSC_ClearStats();
+        }
     }
 }
 
@@ -8,52 +8,9 @@
 #include <stdio.h>
 #include "NuMicro.h"
 #include "vcom_serial.h"
-
-/*--------------------------------------------------------------------------*/
-STR_VCOM_LINE_CODING gLineCoding = {115200, 0, 0, 8};   /* Baud rate : 115200    */
-/* Stop bit     */
-/* parity       */
-/* data bits    */
-uint16_t gCtrlSignal = 0;     /* BIT0: DTR(Data Terminal Ready) , BIT1: RTS(Request To Send) */
-
-/*--------------------------------------------------------------------------*/
-#define RXBUFSIZE           512 /* RX buffer size */
-#define TXBUFSIZE           512 /* RX buffer size */
-
-#define TX_FIFO_SIZE        16  /* TX Hardware FIFO size */
-
-
-/*---------------------------------------------------------------------------------------------------------*/
-/* Global variables                                                                                        */
-/*---------------------------------------------------------------------------------------------------------*/
-/* UART0 */
-#ifdef __ICCARM__
-#pragma data_alignment=4
-volatile uint8_t comRbuf[RXBUFSIZE];
-volatile uint8_t comTbuf[TXBUFSIZE];
-uint8_t gRxBuf[64] = {0};
-uint8_t gUsbRxBuf[64] = {0};
-#else
-volatile uint8_t comRbuf[RXBUFSIZE] __attribute__((aligned(4)));
-volatile uint8_t comTbuf[TXBUFSIZE]__attribute__((aligned(4)));
-uint8_t gRxBuf[64] __attribute__((aligned(4))) = {0};
-uint8_t gUsbRxBuf[64] __attribute__((aligned(4))) = {0};
-#endif
+#include "hsusbd_cdc.h"
 
 
-volatile uint16_t comRbytes = 0;
-volatile uint16_t comRhead = 0;
-volatile uint16_t comRtail = 0;
-
-volatile uint16_t comTbytes = 0;
-volatile uint16_t comThead = 0;
-volatile uint16_t comTtail = 0;
-
-uint32_t gu32RxSize = 0;
-uint32_t gu32TxSize = 0;
-
-volatile int8_t gi8BulkOutReady = 0;
-
 /*--------------------------------------------------------------------------*/
 void SYS_Init(void)
 {
@@ -94,6 +51,7 @@ void SYS_Init(void)
 
     /* Enable IP clock */
     CLK_EnableModuleClock(UART0_MODULE);
+    CLK_EnableModuleClock(PDMA_MODULE);
 
     /* Set GPB multi-function pins for UART0 RXD and TXD */
     SYS->GPB_MFPH &= ~(SYS_GPB_MFPH_PB12MFP_Msk | SYS_GPB_MFPH_PB13MFP_Msk);
@@ -101,137 +59,10 @@ void SYS_Init(void)
 
 }
 
-void UART0_IRQHandler(void)
+void PDMA_IRQHandler(void)
 {
-    uint8_t bInChar;
-    int32_t size;
-    uint32_t u32IntStatus;
-
-    u32IntStatus = UART0->INTSTS;
-
-    if((u32IntStatus & UART_INTSTS_RDAINT_Msk) || (u32IntStatus & UART_INTSTS_RXTOINT_Msk))
-    {
-        /* Receiver FIFO threshold level is reached or Rx time out */
-
-        /* Get all the input characters */
-        while( (!UART_GET_RX_EMPTY(UART0)) )
-        {
-            /* Get the character from UART Buffer */
-            bInChar = UART_READ(UART0);    /* Rx trigger level is 1 byte*/
-
-            /* Check if buffer full */
-            if(comRbytes < RXBUFSIZE)
-            {
-                /* Enqueue the character */
-                comRbuf[comRtail++] = bInChar;
-                if(comRtail >= RXBUFSIZE)
-                    comRtail = 0;
-                comRbytes++;
-            }
-            else
-            {
-                /* FIFO over run */
-            }
-        }
-    }
-
-    if(u32IntStatus & UART_INTSTS_THREINT_Msk)
-    {
-
-        if(comTbytes)
-        {
-            /* Fill the Tx FIFO */
-            size = comTbytes;
-            if(size >= TX_FIFO_SIZE)
-            {
-                size = TX_FIFO_SIZE;
-            }
-
-            while(size)
-            {
-                bInChar = comTbuf[comThead++];
-                UART_WRITE(UART0, bInChar);
-                if(comThead >= TXBUFSIZE)
-                    comThead = 0;
-                comTbytes--;
-                size--;
-            }
-        }
-        else
-        {
-            /* No more data, just stop Tx (Stop work) */
-            UART0->INTEN &= ~UART_INTEN_THREIEN_Msk;
-        }
-    }
-}
-
-void VCOM_TransferData(void)
-{
-    int32_t i, i32Len;
-
-    /* Check if any data to send to USB & USB is ready to send them out */
-    if(comRbytes && (gu32TxSize == 0))
-    {
-        i32Len = comRbytes;
-        if(i32Len > EPA_MAX_PKT_SIZE)
-            i32Len = EPA_MAX_PKT_SIZE;
-
-        for(i=0; i<i32Len; i++)
-        {
-            gRxBuf[i] = comRbuf[comRhead++];
-            if(comRhead >= RXBUFSIZE)
-                comRhead = 0;
-        }
-
-        NVIC_DisableIRQ(UART0_IRQn);
-        comRbytes -= i32Len;
-        NVIC_EnableIRQ(UART0_IRQn);
-
-        gu32TxSize = i32Len;
-        for (i=0; i<i32Len; i++)
-            HSUSBD->EP[EPA].EPDAT_BYTE = gRxBuf[i];
-        HSUSBD->EP[EPA].EPRSPCTL = HSUSBD_EP_RSPCTL_SHORTTXEN;    // packet end
-        HSUSBD->EP[EPA].EPTXCNT = i32Len;
-        HSUSBD_ENABLE_EP_INT(EPA, HSUSBD_EPINTEN_INTKIEN_Msk);
-    }
-
-    /* Process the Bulk out data when bulk out data is ready. */
-    if(gi8BulkOutReady && (gu32RxSize <= TXBUFSIZE - comTbytes))
-    {
-        for(i=0; i<gu32RxSize; i++)
-        {
-            comTbuf[comTtail++] = gUsbRxBuf[i];
-            if(comTtail >= TXBUFSIZE)
-                comTtail = 0;
-        }
-
-        NVIC_DisableIRQ(UART0_IRQn);
-        comTbytes += gu32RxSize;
-        NVIC_EnableIRQ(UART0_IRQn);
-
-        gu32RxSize = 0;
-        gi8BulkOutReady = 0; /* Clear bulk out ready flag */
-    }
-
-    /* Process the software Tx FIFO */
-    if(comTbytes)
-    {
-        /* Check if Tx is working */
-        if((UART0->INTEN & UART_INTEN_THREIEN_Msk) == 0)
-        {
-            /* Send one bytes out */
-            UART_WRITE(UART0, comTbuf[comThead++]);
-            if(comThead >= TXBUFSIZE)
-                comThead = 0;
-
-            NVIC_DisableIRQ(UART0_IRQn);
-            comTbytes--;
-            NVIC_EnableIRQ(UART0_IRQn);
-
-            /* Enable Tx Empty Interrupt. (Trigger first one) */
-            UART0->INTEN |= UART_INTEN_THREIEN_Msk;
-        }
-    }
+    /* UART0 TX/RX blocks of the CDC bridge */
+    HSCDC_PdmaHandler();
 }
 
 
@@ -239,15 +70,14 @@ int32_t main (void)
 {
     SYS_Init();
     UART_Open(UART0, 115200);
-    /* Enable Interrupt and install the call back function */
-    UART_ENABLE_INT(UART0, (UART_INTEN_RDAIEN_Msk | UART_INTEN_THREIEN_Msk | UART_INTEN_RXTOIEN_Msk));
 
     printf("NuMicro USB CDC VCOM\n");
 
-    HSUSBD_Open(&gsHSInfo, VCOM_ClassRequest, NULL);
+    HSUSBD_Open(&gsHSInfo, HSCDC_ClassRequest, NULL);
 
-    /* Endpoint configuration */
+    /* Endpoint configuration, UART0 is handed over to PDMA from here on */
     VCOM_Init();
+    NVIC_EnableIRQ(PDMA_IRQn);
     NVIC_EnableIRQ(USBD20_IRQn);
 
     /* Start transaction */
@@ -262,7 +92,8 @@ int32_t main (void)
 
     while(1)
     {
-        VCOM_TransferData();
+        /* Forward UART data that has not filled half of the RX ring yet */
+        HSCDC_Process();
     }
 }
 
@@ -10,6 +10,29 @@
 #include <string.h>
 #include "NuMicro.h"
 #include "vcom_serial.h"
+#include "hsusbd_cdc.h"
+
+/*--------------------------------------------------------------------------*/
+#ifdef __ICCARM__
+#pragma data_alignment=4
+static uint8_t s_au8RxRing[RXRING_SIZE];
+#pragma data_alignment=4
+static uint8_t s_au8TxRing[TXRING_SIZE];
+#else
+static uint8_t s_au8RxRing[RXRING_SIZE] __attribute__((aligned(4)));
+static uint8_t s_au8TxRing[TXRING_SIZE] __attribute__((aligned(4)));
+#endif
+
+static const HSCDC_CFG_T s_sCdcCfg =
+{
+    UART0, 0, 1, PDMA_UART0_TX, PDMA_UART0_RX,
+    s_au8TxRing, TXRING_SIZE,
+    s_au8RxRing, RXRING_SIZE,
+    EPA, BULK_IN_EP_NUM, EPA_BUF_BASE,
+    EPB, BULK_OUT_EP_NUM, EPB_BUF_BASE,
+    EPA_BUF_LEN,
+    EPC, INT_IN_EP_NUM, EPC_BUF_BASE
+};
 
 /*--------------------------------------------------------------------------*/
 void USBD20_IRQHandler(void)
@@ -36,26 +59,23 @@ void USBD20_IRQHandler(void)
             HSUSBD->EP[EPA].EPRSPCTL = HSUSBD_EPRSPCTL_FLUSH_Msk;
             HSUSBD->EP[EPB].EPRSPCTL = HSUSBD_EPRSPCTL_FLUSH_Msk;
 
-            if (HSUSBD->OPER & 0x04)  /* high speed */
-                VCOM_InitForHighSpeed();
-            else                    /* full speed */
-                VCOM_InitForFullSpeed();
+            HSCDC_InitEndpoints(HSUSBD->OPER & 0x04);   /* high speed or full speed */
             HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_SETUPPKIEN_Msk);
             HSUSBD_SET_ADDR(0);
-            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_RESUMEIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
+            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk|HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_RESUMEIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_RSTIF_Msk);
             HSUSBD_CLR_CEP_INT_FLAG(0x1ffc);
         }
 
         if (IrqSt & HSUSBD_BUSINTSTS_RESUMEIF_Msk)
         {
-            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
+            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk|HSUSBD_BUSINTEN_RSTIEN_Msk|HSUSBD_BUSINTEN_SUSPENDIEN_Msk);
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_RESUMEIF_Msk);
         }
 
         if (IrqSt & HSUSBD_BUSINTSTS_SUSPENDIF_Msk)
         {
-            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_RSTIEN_Msk | HSUSBD_BUSINTEN_RESUMEIEN_Msk);
+            HSUSBD_ENABLE_BUS_INT(HSUSBD_BUSINTEN_DMADONEIEN_Msk | HSUSBD_BUSINTEN_RSTIEN_Msk | HSUSBD_BUSINTEN_RESUMEIEN_Msk);
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_SUSPENDIF_Msk);
         }
 
@@ -69,20 +89,7 @@ void USBD20_IRQHandler(void)
         {
             g_hsusbd_DmaDone = 1;
             HSUSBD_CLR_BUS_INT_FLAG(HSUSBD_BUSINTSTS_DMADONEIF_Msk);
-
-            if (!(HSUSBD->DMACTL & HSUSBD_DMACTL_DMARD_Msk))
-            {
-                HSUSBD_ENABLE_EP_INT(EPB, HSUSBD_EPINTEN_RXPKIEN_Msk);
-            }
-
-            if (HSUSBD->DMACTL & HSUSBD_DMACTL_DMARD_Msk)
-            {
-                if (g_hsusbd_ShortPacket == 1)
-                {
-                    HSUSBD->EP[EPA].EPRSPCTL = (HSUSBD->EP[EPA].EPRSPCTL & 0x10) | HSUSBD_EP_RSPCTL_SHORTTXEN;    // packet end
-                    g_hsusbd_ShortPacket = 0;
-                }
-            }
+            HSCDC_DmaDoneHandler();
         }
 
         if (IrqSt & HSUSBD_BUSINTSTS_PHYCLKVLDIF_Msk)
@@ -218,35 +225,8 @@ void USBD20_IRQHandler(void)
         }
     }
 
-    /* bulk in */
-    if (IrqStL & HSUSBD_GINTSTS_EPAIF_Msk)
-    {
-        IrqSt = HSUSBD->EP[EPA].EPINTSTS & HSUSBD->EP[EPA].EPINTEN;
-
-        gu32TxSize = 0;
-        HSUSBD_ENABLE_EP_INT(EPA, 0);
-        HSUSBD_CLR_EP_INT_FLAG(EPA, IrqSt);
-    }
-    /* bulk out */
-    if (IrqStL & HSUSBD_GINTSTS_EPBIF_Msk)
-    {
-        int volatile i;
-
-        IrqSt = HSUSBD->EP[EPB].EPINTSTS & HSUSBD->EP[EPB].EPINTEN;
-        gu32RxSize = HSUSBD->EP[EPB].EPDATCNT & 0xffff;
-        for (i=0; i<gu32RxSize; i++)
-            gUsbRxBuf[i] = HSUSBD->EP[EPB].EPDAT_BYTE;
-
-        /* Set a flag to indicate bulk out ready */
-        gi8BulkOutReady = 1;
-        HSUSBD_CLR_EP_INT_FLAG(EPB, IrqSt);
-    }
-
-    if (IrqStL & HSUSBD_GINTSTS_EPCIF_Msk)
-    {
-        IrqSt = HSUSBD->EP[EPC].EPINTSTS & HSUSBD->EP[EPC].EPINTEN;
-        HSUSBD_CLR_EP_INT_FLAG(EPC, IrqSt);
-    }
+    /* bulk in, bulk out and interrupt in */
+    HSCDC_EpHandler(IrqStL);
 
     if (IrqStL & HSUSBD_GINTSTS_EPDIF_Msk)
     {
@@ -304,46 +284,6 @@ void USBD20_IRQHandler(void)
 }
 
 
-void VCOM_InitForHighSpeed(void)
-{
-    /*****************************************************/
-    /* EPA ==> Bulk IN endpoint, address 1 */
-    HSUSBD_SetEpBufAddr(EPA, EPA_BUF_BASE, EPA_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPA, EPA_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPA, BULK_IN_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_IN);
-
-    /* EPB ==> Bulk OUT endpoint, address 2 */
-    HSUSBD_SetEpBufAddr(EPB, EPB_BUF_BASE, EPB_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPB, EPB_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPB, BULK_OUT_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_OUT);
-    HSUSBD_ENABLE_EP_INT(EPB, HSUSBD_EPINTEN_RXPKIEN_Msk | HSUSBD_EPINTEN_SHORTRXIEN_Msk);
-
-    /* EPC ==> Interrupt IN endpoint, address 3 */
-    HSUSBD_SetEpBufAddr(EPC, EPC_BUF_BASE, EPC_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPC, EPC_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPC, INT_IN_EP_NUM, HSUSBD_EP_CFG_TYPE_INT, HSUSBD_EP_CFG_DIR_IN);
-}
-
-void VCOM_InitForFullSpeed(void)
-{
-    /*****************************************************/
-    /* EPA ==> Bulk IN endpoint, address 1 */
-    HSUSBD_SetEpBufAddr(EPA, EPA_BUF_BASE, EPA_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPA, EPA_OTHER_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPA, BULK_IN_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_IN);
-
-    /* EPB ==> Bulk OUT endpoint, address 2 */
-    HSUSBD_SetEpBufAddr(EPB, EPB_BUF_BASE, EPB_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPB, EPB_OTHER_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPB, BULK_OUT_EP_NUM, HSUSBD_EP_CFG_TYPE_BULK, HSUSBD_EP_CFG_DIR_OUT);
-    HSUSBD_ENABLE_EP_INT(EPB, HSUSBD_EPINTEN_RXPKIEN_Msk | HSUSBD_EPINTEN_SHORTRXIEN_Msk);
-
-    /* EPC ==> Interrupt IN endpoint, address 3 */
-    HSUSBD_SetEpBufAddr(EPC, EPC_BUF_BASE, EPC_BUF_LEN);
-    HSUSBD_SET_MAX_PAYLOAD(EPC, EPC_OTHER_MAX_PKT_SIZE);
-    HSUSBD_ConfigEp(EPC, INT_IN_EP_NUM, HSUSBD_EP_CFG_TYPE_INT, HSUSBD_EP_CFG_DIR_IN);
-}
-
 /*--------------------------------------------------------------------------*/
 /**
   * @brief  USBD Endpoint Config.
@@ -365,148 +305,8 @@ void VCOM_Init(void)
     HSUSBD_SetEpBufAddr(CEP, CEP_BUF_BASE, CEP_BUF_LEN);
     HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_SETUPPKIEN_Msk|HSUSBD_CEPINTEN_STSDONEIEN_Msk);
 
-    VCOM_InitForHighSpeed();
+    /* Bulk endpoints and UART0 are bridged by the CDC class, PDMA channel 0 for TX and 1 for RX */
+    HSCDC_Open(&s_sCdcCfg);
+    HSCDC_InitEndpoints(1);
 }
 
-
-void VCOM_ClassRequest(void)
-{
-    if (gUsbCmd.bmRequestType & 0x80)   /* request data transfer direction */
-    {
-        // Device to host
-        switch (gUsbCmd.bRequest)
-        {
-        case GET_LINE_CODE:
-        {
-            if ((gUsbCmd.wIndex & 0xff) == 0)  /* VCOM-1 */
-                HSUSBD_PrepareCtrlIn((uint8_t *)&gLineCoding, 7);
-            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_INTKIF_Msk);
-            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_INTKIEN_Msk);
-            break;
-        }
-        default:
-        {
-            /* Setup error, stall the device */
-            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
-            break;
-        }
-        }
-    }
-    else
-    {
-        // Host to device
-        switch (gUsbCmd.bRequest)
-        {
-        case SET_CONTROL_LINE_STATE:
-        {
-            if ((gUsbCmd.wIndex & 0xff) == 0)   /* VCOM-1 */
-            {
-                gCtrlSignal = gUsbCmd.wValue;
-                //printf("RTS=%d  DTR=%d\n", (gCtrlSignal0 >> 1) & 1, gCtrlSignal0 & 1);
-            }
-            // DATA IN for end of setup
-            /* Status stage */
-            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_STSDONEIF_Msk);
-            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_NAKCLR);
-            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_STSDONEIEN_Msk);
-            break;
-        }
-        case SET_LINE_CODE:
-        {
-            if ((gUsbCmd.wIndex & 0xff) == 0) /* VCOM-1 */
-                HSUSBD_CtrlOut((uint8_t *)&gLineCoding, 7);
-
-            /* Status stage */
-            HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_STSDONEIF_Msk);
-            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_NAKCLR);
-            HSUSBD_ENABLE_CEP_INT(HSUSBD_CEPINTEN_STSDONEIEN_Msk);
-
-            /* UART setting */
-            if ((gUsbCmd.wIndex & 0xff) == 0) /* VCOM-1 */
-                VCOM_LineCoding(0);
-            break;
-        }
-        default:
-        {
-            /* Setup error, stall the device */
-            HSUSBD_SET_CEP_STATE(HSUSBD_CEPCTL_STALLEN_Msk);
-            break;
-        }
-        }
-    }
-}
-
-
-void VCOM_LineCoding(uint8_t port)
-{
-    uint32_t u32Reg;
-    uint32_t u32Baud_Div;
-
-    if (port == 0)
-    {
-        NVIC_DisableIRQ(UART0_IRQn);
-        // Reset software fifo
-        comRbytes = 0;
-        comRhead = 0;
-        comRtail = 0;
-
-        comTbytes = 0;
-        comThead = 0;
-        comTtail = 0;
-
-        // Reset hardware fifo
-        UART0->FIFO = 0x3;
-
-        // Set baudrate
-        u32Baud_Div = UART_BAUD_MODE2_DIVIDER(__HXT, gLineCoding.u32DTERate);
-
-        if(u32Baud_Div > 0xFFFF)
-            UART0->BAUD = (UART_BAUD_MODE0 | UART_BAUD_MODE0_DIVIDER(__HXT, gLineCoding.u32DTERate));
-        else
-            UART0->BAUD = (UART_BAUD_MODE2 | u32Baud_Div);
-
-        // Set parity
-        if(gLineCoding.u8ParityType == 0)
-            u32Reg = 0; // none parity
-        else if(gLineCoding.u8ParityType == 1)
-            u32Reg = 0x08; // odd parity
-        else if(gLineCoding.u8ParityType == 2)
-            u32Reg = 0x18; // even parity
-        else
-            u32Reg = 0;
-
-        // bit width
-        switch(gLineCoding.u8DataBits)
-        {
-        case 5:
-            u32Reg |= 0;
-            break;
-        case 6:
-            u32Reg |= 1;
-            break;
-        case 7:
-            u32Reg |= 2;
-            break;
-        case 8:
-            u32Reg |= 3;
-            break;
-        default:
-            break;
-        }
-
-        // stop bit
-        if(gLineCoding.u8CharFormat > 0)
-            u32Reg |= 0x4; // 2 or 1.5 bits
-
-        UART0->LINE = u32Reg;
-
-        // Re-enable UART interrupt
-        NVIC_EnableIRQ(UART0_IRQn);
-    }
-}
-
-
-
-
-
-
@@ -12,11 +12,6 @@
 #define USBD_VID        0x0416
 #define USBD_PID        0xB002
 
-/*!<Define CDC Class Specific Request */
-#define SET_LINE_CODE           0x20
-#define GET_LINE_CODE           0x21
-#define SET_CONTROL_LINE_STATE  0x22
-
 /* Define DMA Maximum Transfer length */
 #define USBD_MAX_DMA_LEN    0x1000
 
@@ -31,13 +26,14 @@
 #define EPC_MAX_PKT_SIZE        64
 #define EPC_OTHER_MAX_PKT_SIZE  64
 
+/* Bulk endpoint buffers hold two high speed packets, so one can be filled by DMA while the other is sent */
 #define CEP_BUF_BASE    0
 #define CEP_BUF_LEN     CEP_MAX_PKT_SIZE
 #define EPA_BUF_BASE    0x200
-#define EPA_BUF_LEN     EPA_MAX_PKT_SIZE
-#define EPB_BUF_BASE    0x400
-#define EPB_BUF_LEN     EPB_MAX_PKT_SIZE
-#define EPC_BUF_BASE    0x600
+#define EPA_BUF_LEN     (EPA_MAX_PKT_SIZE * 2)
+#define EPB_BUF_BASE    0x600
+#define EPB_BUF_LEN     (EPB_MAX_PKT_SIZE * 2)
+#define EPC_BUF_BASE    0xA00
 #define EPC_BUF_LEN     EPC_MAX_PKT_SIZE
 
 /* Define the interrupt In EP number */
@@ -50,46 +46,12 @@
 #define USBD_REMOTE_WAKEUP              0
 #define USBD_MAX_POWER                  50  /* The unit is in 2mA. ex: 50 * 2mA = 100mA */
 
-/************************************************/
-/* for CDC class */
-/* Line coding structure
-  0-3 dwDTERate    Data terminal rate (baudrate), in bits per second
-  4   bCharFormat  Stop bits: 0 - 1 Stop bit, 1 - 1.5 Stop bits, 2 - 2 Stop bits
-  5   bParityType  Parity:    0 - None, 1 - Odd, 2 - Even, 3 - Mark, 4 - Space
-  6   bDataBits    Data bits: 5, 6, 7, 8, 16  */
-
-typedef struct
-{
-    uint32_t  u32DTERate;     /* Baud rate    */
-    uint8_t   u8CharFormat;   /* stop bit     */
-    uint8_t   u8ParityType;   /* parity       */
-    uint8_t   u8DataBits;     /* data bits    */
-} STR_VCOM_LINE_CODING;
-
-/*-------------------------------------------------------------*/
-extern volatile int8_t gi8BulkOutReady;
-extern STR_VCOM_LINE_CODING gLineCoding;
-extern uint16_t gCtrlSignal;
-extern volatile uint16_t comRbytes;
-extern volatile uint16_t comRhead;
-extern volatile uint16_t comRtail;
-extern volatile uint16_t comTbytes;
-extern volatile uint16_t comThead;
-extern volatile uint16_t comTtail;
-extern uint32_t gu32RxSize;
-extern uint32_t gu32TxSize;
-extern uint8_t gUsbRxBuf[];
+/* UART <-> USB ring buffers */
+#define RXRING_SIZE     4096    /* UART RX to bulk IN, filled by PDMA in two halves */
+#define TXRING_SIZE     4096    /* Bulk OUT to UART TX */
 
 /*-------------------------------------------------------------*/
 void VCOM_Init(void);
-void VCOM_InitForHighSpeed(void);
-void VCOM_InitForFullSpeed(void);
-void VCOM_ClassRequest(void);
-
-void EPA_Handler(void);
-void EPB_Handler(void);
-void VCOM_LineCoding(uint8_t port);
-void VCOM_TransferData(void);
 
 #endif  /* __USBD_CDC_H_ */
 
@@ -28,6 +28,7 @@
 #include "diskio.h"
 #include "ff.h"
 #include "mad.h"
+#include "workq.h"
 
 #define MP3_FILE    "0:\\test.mp3"
 
@@ -265,7 +266,8 @@ void MP3Player(void)
         {
             //if next buffer is still full (playing), wait until it's empty
             if(aPCMBuffer_Full[u8PCMBufferTargetIdx] == 1)
-                while(aPCMBuffer_Full[u8PCMBufferTargetIdx]);
+                while(aPCMBuffer_Full[u8PCMBufferTargetIdx])
+                    WORKQ_Poll(1);
         }
         else
         {
@@ -295,7 +297,8 @@ void MP3Player(void)
                 //printf("change to ==>%d ..\n", u8PCMBufferTargetIdx);
                 /* if next buffer is still full (playing), wait until it's empty */
                 if((aPCMBuffer_Full[u8PCMBufferTargetIdx] == 1) && (audioInfo.mp3Playing))
-                    while(aPCMBuffer_Full[u8PCMBufferTargetIdx]);
+                    while(aPCMBuffer_Full[u8PCMBufferTargetIdx])
+                        WORKQ_Poll(1);
             }
         }
     }
@@ -15,6 +15,7 @@
 #include "config.h"
 #include "diskio.h"
 #include "ff.h"
+#include "workq.h"
 
 #define NAU8822_ADDR        0x1A                /* NAU8822 Device ID */
 
@@ -22,6 +23,7 @@ DMA_DESC_T DMA_DESC[2];
 
 //uint32_t PcmBuff[BUFF_LEN] = {0};
 uint32_t volatile u32BuffPos = 0;
+int32_t i32CardSrc0 = -1;
 FATFS FatFs[FF_VOLUMES];      /* File system object for logical drive */
 #ifdef __ICCARM__
 #pragma data_alignment=32
@@ -305,34 +307,15 @@ void SDH0_IRQHandler(void)
     isr = SDH0->INTSTS;
     if (isr & SDH_INTSTS_BLKDIF_Msk)
     {
-        // block down
+        // block down. Stays here: SDH_Read()/SDH_Write() wait for this flag in the main loop,
+        // which would never get to run a queued item that sets it.
         g_u8SDDataReadyFlag = TRUE;
         SDH0->INTSTS = SDH_INTSTS_BLKDIF_Msk;
     }
 
     if (isr & SDH_INTSTS_CDIF_Msk)   // port 0 card detect
     {
-        //----- SD interrupt status
-        // it is work to delay 50 times for SD_CLK = 200KHz
-        {
-            int volatile i;         // delay 30 fail, 50 OK
-            for (i=0; i<0x500; i++);  // delay to make sure got updated value from REG_SDISR.
-            isr = SDH0->INTSTS;
-        }
-
-        if (isr & SDH_INTSTS_CDSTS_Msk)
-        {
-            printf("\n***** card remove !\n");
-            SD0.IsCardInsert = FALSE;   // SDISR_CD_Card = 1 means card remove for GPIO mode
-            memset(&SD0, 0, sizeof(SDH_INFO_T));
-        }
-        else
-        {
-            printf("***** card insert !\n");
-            SDH_Open(SDH0, CardDetect_From_GPIO);
-            SDH_Probe(SDH0);
-        }
-
+        SDH_CardDetectHandler(SDH0, CardDetect_From_GPIO, i32CardSrc0);
         SDH0->INTSTS = SDH_INTSTS_CDIF_Msk;
     }
 
@@ -477,6 +460,10 @@ int32_t main (void)
     printf("+------------------------------------------------------------------------+\n");
     printf("  NOTE: This sample code needs to work with WAU88L25.\n");
 
+    /* Card detect is handled from the work queue, drained by WAVPlayer() while it waits for a buffer */
+    WORKQ_Init();
+    i32CardSrc0 = WORKQ_AddSource("SDH0 card detect");
+
     /* Configure FATFS */
     SDH_Open_Disk(SDH0, CardDetect_From_GPIO);
     f_chdrive(sd_path);          /* set default path */
@@ -507,7 +494,8 @@ int32_t main (void)
 
     WAVPlayer();
 
-    while(1);
+    while(1)
+        WORKQ_Poll(0);
 }
 
 /*** (C) COPYRIGHT 2016 Nuvoton Technology Corp. ***/
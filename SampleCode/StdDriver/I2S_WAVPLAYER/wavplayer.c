@@ -15,6 +15,7 @@
 
 #include "diskio.h"
 #include "ff.h"
+#include "workq.h"
 
 /*
  * This is perhaps the simplest example use of the MAD high-level API.
@@ -73,7 +74,8 @@ void WAVPlayer(void)
                 printf("Start Playing ...\n");
             }
 
-            while((aPCMBuffer_Full[0] == 1) && (aPCMBuffer_Full[1] == 1));
+            while((aPCMBuffer_Full[0] == 1) && (aPCMBuffer_Full[1] == 1))
+                WORKQ_Poll(1);
             //printf(".");
         }
 
@@ -84,7 +86,8 @@ void WAVPlayer(void)
         if(bAudioPlaying)
         {
             if(aPCMBuffer_Full[u8PCMBufferTargetIdx^1] == 1)
-                while(aPCMBuffer_Full[u8PCMBufferTargetIdx^1]);
+                while(aPCMBuffer_Full[u8PCMBufferTargetIdx^1])
+                    WORKQ_Poll(1);
         }
 
         u8PCMBufferTargetIdx ^= 1;
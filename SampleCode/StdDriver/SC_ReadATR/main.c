@@ -2,16 +2,32 @@
  * @file     main.c
  * @version  V1.00
  * @brief    Read the smartcard ATR from smartcard 1 interface.
- *
+ *           Then hand the card to the APDU engine and select the master file
+ *           without waiting in SCLIB.
  *
  * @copyright (C) 2017 Nuvoton Technology Corp. All rights reserved.
 *****************************************************************************/
 #include <stdio.h>
 #include "NuMicro.h"
 #include "sclib.h"
+#include "scapdu_sc.h"
 
 #define SC_INTF 0  // Smartcard interface 0
 
+// SELECT the master file, 3F00
+static const uint8_t s_au8SelectMF[] = { 0x00, 0xA4, 0x00, 0x00, 0x02, 0x3F, 0x00 };
+static uint8_t s_au8Rsp[SCAPDU_MAX_RSP];
+static SCAPDU_REQ_T s_sReq;
+static volatile int s_iDone;
+
+// Called from SC0_IRQHandler() when the APDU is done
+static void ApduDone(void *pvArg, SCAPDU_REQ_T *psReq)
+{
+    (void)pvArg;
+    (void)psReq;
+    s_iDone = 1;
+}
+
 /**
   * @brief  The interrupt services routine of smartcard port 0
   * @param  None
@@ -22,6 +38,13 @@ void SC0_IRQHandler(void)
     /* Please don't remove any of the function calls below */
     // Card insert/remove event occurred, no need to check other event...
     if(SCLIB_CheckCDEvent(SC_INTF))
+    {
+        // Queued APDUs complete with SCAPDU_STS_REMOVED
+        SCAPDU_SC_Detach(SC_INTF);
+        return;
+    }
+    // Once attached, the APDU engine runs the interface and SCLIB must not see its events
+    if(SCAPDU_SC_IRQHandler(SC_INTF))
         return;
     // Check if there's any timeout event occurs. If so, it usually indicates an error
     SCLIB_CheckTimeOutEvent(SC_INTF);
@@ -134,6 +157,31 @@ int main(void)
         for(i = 0; i < s_info.ATR_Len; i++)
             printf("%02x ", s_info.ATR_Buf[i]);
         printf("\n");
+
+        /*
+            From here on the APDU engine runs the card from SC0_IRQHandler(): the APDU is queued and
+            the CPU is free until the callback, where SCLIB_StartTransmission() would wait.
+        */
+        SCAPDU_SC_Init();
+        if(SCAPDU_SC_Attach(SC_INTF, SCAPDU_T1_IFSD) != SCAPDU_OK)
+        {
+            printf("APDU engine attach failed\n");
+            while(1);
+        }
+        s_sReq.pu8Cmd = s_au8SelectMF;
+        s_sReq.u32CmdLen = sizeof(s_au8SelectMF);
+        s_sReq.pu8Rsp = s_au8Rsp;
+        s_sReq.u32RspSize = sizeof(s_au8Rsp);
+        s_sReq.pfnDone = ApduDone;
+        s_sReq.pvArg = NULL;
+        if(SCAPDU_Submit(SC_INTF, &s_sReq) == SCAPDU_OK)
+        {
+            while(!s_iDone);
+            if(s_sReq.u32Status == SCAPDU_STS_OK && s_sReq.u32RspLen >= 2)
+                printf("SELECT MF: SW %02x %02x\n", s_sReq.pu8Rsp[s_sReq.u32RspLen - 2], s_sReq.pu8Rsp[s_sReq.u32RspLen - 1]);
+            else
+                printf("SELECT MF failed, status %d\n", (int)s_sReq.u32Status);
+        }
     }
     else
         printf("Smartcard activate failed\n");
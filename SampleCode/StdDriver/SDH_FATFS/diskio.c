@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "NuMicro.h"
+#include "trace.h"
 #include "diskio.h"     /* FatFs lower layer API */
 #include "ff.h"
 
@@ -88,6 +89,7 @@ DRESULT disk_read (
     uint32_t tmp_StartBufAddr;
 
     //printf("disk_read - drv:%d, sec:%d, cnt:%d, buff:0x%x\n", pdrv, sector, count, (uint32_t)buff);
+    TRACE_BEGIN(TRACE_ID_DISK_READ, count);
 
     if ((uint32_t)buff%4)
     {
@@ -136,6 +138,7 @@ DRESULT disk_read (
         else
             ret = (DRESULT) SDH_Read(SDH1, buff, sector, count);
     }
+    TRACE_END(TRACE_ID_DISK_READ, ret);
     return ret;
 }
 
@@ -12,6 +12,7 @@
 #include "NuMicro.h"
 #include "diskio.h"
 #include "ff.h"
+#include "workq.h"
 
 #define BUFF_SIZE       (8*1024)
 
@@ -33,6 +34,7 @@ uint8_t Buff_Pool[BUFF_SIZE] __attribute__((aligned(4)));       /* Working buffe
 #endif
 uint8_t  *Buff;
 uint32_t volatile gSec = 0;
+int32_t i32CardSrc0 = -1;
 void TMR0_IRQHandler(void)
 {
     gSec++;
@@ -271,6 +273,8 @@ void get_line (char *buff, int len)
 
     for (;;)
     {
+        while (UART_GET_RX_EMPTY(UART0))
+            WORKQ_Poll(0);          /* card initialization while waiting for input */
         c = getchar();
         putchar(c);
         if (c == '\r') break;
@@ -300,34 +304,15 @@ void SDH0_IRQHandler(void)
     isr = SDH0->INTSTS;
     if (isr & SDH_INTSTS_BLKDIF_Msk)
     {
-        // block down
+        // block down. Stays here: SDH_Read()/SDH_Write() wait for this flag in the main loop,
+        // which would never get to run a queued item that sets it.
         g_u8SDDataReadyFlag = TRUE;
         SDH0->INTSTS = SDH_INTSTS_BLKDIF_Msk;
     }
 
     if (isr & SDH_INTSTS_CDIF_Msk)   // card detect
     {
-        //----- SD interrupt status
-        // it is work to delay 50 times for SD_CLK = 200KHz
-        {
-            int volatile i;         // delay 30 fail, 50 OK
-            for (i=0; i<0x500; i++);  // delay to make sure got updated value from REG_SDISR.
-            isr = SDH0->INTSTS;
-        }
-
-        if (isr & SDH_INTSTS_CDSTS_Msk)
-        {
-            printf("\n***** card remove !\n");
-            SD0.IsCardInsert = FALSE;   // SDISR_CD_Card = 1 means card remove for GPIO mode
-            memset(&SD0, 0, sizeof(SDH_INFO_T));
-        }
-        else
-        {
-            printf("***** card insert !\n");
-            SDH_Open(SDH0, CardDetect_From_GPIO);
-            SDH_Probe(SDH0);
-        }
-
+        SDH_CardDetectHandler(SDH0, CardDetect_From_GPIO, i32CardSrc0);
         SDH0->INTSTS = SDH_INTSTS_CDIF_Msk;
     }
 
@@ -469,11 +454,14 @@ int32_t main(void)
         SD initial state needs 400KHz clock output, driver will use HIRC for SD initial clock source.
         And then switch back to the user's setting.
     */
+    WORKQ_Init();
+    i32CardSrc0 = WORKQ_AddSource("SDH0 card detect");
     SDH_Open_Disk(SDH0, CardDetect_From_GPIO);
     f_chdrive(sd_path);          /* set default path */
 
     for (;;)
     {
+        WORKQ_Poll(0);
         if(!(SDH_CardDetection(SDH0)))
             continue;
 
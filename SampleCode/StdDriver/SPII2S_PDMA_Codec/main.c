@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "NuMicro.h"
+#include "workq.h"
 
 #define NAU8822     1
 
@@ -32,6 +33,17 @@ uint32_t PcmRxBuff[2][BUFF_LEN] = {0};
 uint32_t PcmTxBuff[2][BUFF_LEN] = {0};
 uint32_t volatile u32BuffPos = 0;
 DESC_TABLE_T g_asDescTable_TX[2], g_asDescTable_RX[2];
+int32_t i32CopySrc = -1;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Copy a received buffer to the TX buffer that is played next. Posted by PDMA_IRQHandler() and run from  */
+/*  the main loop. u32Param is the RX buffer index in bits 0..7 and the TX buffer index in bits 8..15.     */
+/*---------------------------------------------------------------------------------------------------------*/
+void PcmCopyWork(void *pvArg, uint32_t u32Param)
+{
+    (void)pvArg;
+    memcpy(&PcmTxBuff[(u32Param >> 8) & 1], &PcmRxBuff[u32Param & 1], BUFF_LEN*4);
+}
 
 
 #if NAU8822
@@ -387,6 +399,10 @@ int32_t main (void)
     /* Set MCLK and enable MCLK */
     SPII2S_EnableMCLK(SPI1, 12000000);
 
+    /* The RX to TX copy runs from the main loop instead of the PDMA interrupt */
+    WORKQ_Init();
+    i32CopySrc = WORKQ_AddSource("PDMA RX copy");
+
     PDMA_Init();
 
     /* Enable I2S Rx function */
@@ -397,7 +413,8 @@ int32_t main (void)
     SPII2S_ENABLE_TXDMA(SPI1);
     SPII2S_ENABLE_TX(SPI1);
 
-    while(1);
+    while(1)
+        WORKQ_Poll(0);
 }
 
 void PDMA_IRQHandler(void)
@@ -414,8 +431,10 @@ void PDMA_IRQHandler(void)
     {
         if (PDMA_GET_TD_STS(PDMA) & 0x4)            /* channel 2 done */
         {
-            /* Copy RX data to TX buffer */
-            memcpy(&PcmTxBuff[u8TxIdx^1], &PcmRxBuff[u8RxIdx], BUFF_LEN*4);
+            /* Copy RX data to TX buffer. The copy has one buffer period to finish before PDMA refills the
+               RX buffer; if the queue is full it is done here as before. */
+            if (WORKQ_Post(WORKQ_PRIO_HIGH, i32CopySrc, PcmCopyWork, NULL, u8RxIdx | ((u8TxIdx^1) << 8)) != WORKQ_OK)
+                memcpy(&PcmTxBuff[u8TxIdx^1], &PcmRxBuff[u8RxIdx], BUFF_LEN*4);
             u8RxIdx ^= 1;
         }
         if (PDMA_GET_TD_STS(PDMA) & 0x2)            /* channel 1 done */
@@ -0,0 +1,929 @@
+/*
+ * FreeRTOS Kernel V10.0.0
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software. If you wish to use our Amazon
+ * FreeRTOS name, please do so in a fair use way that does not cause confusion.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * A sample implementation of pvPortMalloc() and vPortFree() with bounded,
+ * constant execution time, based on the Two-Level Segregated Fit (TLSF)
+ * algorithm.  Like heap_5.c the heap can span several non-contiguous regions,
+ * for example the internal SRAM and an external SRAM connected through EBI.
+ *
+ * Free blocks are kept in segregated lists indexed by a first level (power of
+ * two size class) and a second level (linear subdivision of each class).  Two
+ * bitmaps record which lists are non-empty, so finding a suitable block is a
+ * couple of count-leading-zero operations regardless of how fragmented the
+ * heap is.  Adjacent free blocks are coalesced immediately on vPortFree()
+ * using a back pointer to the previous physical block, so no list walk is
+ * required there either.
+ *
+ * Every allocated block records the statistics entry of the task that
+ * allocated it, which lets the heap keep per task usage and high-water marks.
+ * See heap_tlsf.h for the extra API.
+ *
+ * Usage notes:
+ *
+ * vPortDefineHeapRegions() ***must*** be called before pvPortMalloc(), exactly
+ * as with heap_5.c.  Unlike heap_5.c the regions do not have to be in address
+ * order; each region is managed by its own TLSF control structure and
+ * pvPortMalloc() tries the regions in the order they appear in the array.
+ *
+ * HeapRegion_t xHeapRegions[] =
+ * {
+ * 	{ ucHeap, sizeof( ucHeap ) },                << Internal SRAM, preferred.
+ * 	{ ( uint8_t * ) EBI_BANK0_BASE_ADDR, 0x80000 }, << External SRAM on EBI bank 0.
+ * 	{ NULL, 0 }                                  << Terminates the array.
+ * };
+ *
+ * vPortDefineHeapRegions( xHeapRegions );
+ *
+ * The EBI bus must be configured (EBI_Open()) before the external region is
+ * handed to the heap, as the block headers are written immediately.
+ *
+ * Per task accounting requires xTaskGetCurrentTaskHandle(), so either
+ * INCLUDE_xTaskGetCurrentTaskHandle or configUSE_MUTEXES must be set to 1.
+ * To release the entries of deleted tasks add the following to
+ * FreeRTOSConfig.h:
+ *
+ * void vPortHeapTaskDeleted( void *pvTask );
+ * #define traceTASK_DELETE( pxTCB ) vPortHeapTaskDeleted( pxTCB )
+ */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "heap_tlsf.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+	#error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+#if( ( INCLUDE_xTaskGetCurrentTaskHandle == 0 ) && ( configUSE_MUTEXES == 0 ) )
+	#error heap_tlsf.c requires INCLUDE_xTaskGetCurrentTaskHandle or configUSE_MUTEXES to be set to 1
+#endif
+
+/* log2 of the size limit for a single region.  The default of 21 covers a
+complete 1MB EBI bank; each extra step costs one bitmap bit and
+heapTLSF_SL_COUNT list heads per region. */
+#ifndef configHEAP_TLSF_FL_INDEX_MAX
+	#define configHEAP_TLSF_FL_INDEX_MAX	21
+#endif
+
+#if( portBYTE_ALIGNMENT == 8 )
+	#define heapTLSF_ALIGN_LOG2		3
+#elif( portBYTE_ALIGNMENT == 4 )
+	#define heapTLSF_ALIGN_LOG2		2
+#elif( portBYTE_ALIGNMENT == 16 )
+	#define heapTLSF_ALIGN_LOG2		4
+#else
+	#error heap_tlsf.c does not support this portBYTE_ALIGNMENT
+#endif
+
+/* Each first level class is split into 2^heapTLSF_SL_LOG2 linear sub-classes.
+Blocks smaller than heapTLSF_SMALL_BLOCK_SIZE all live in first level 0, which
+is subdivided in steps of portBYTE_ALIGNMENT. */
+#define heapTLSF_SL_LOG2			4
+#define heapTLSF_SL_COUNT			( 1UL << heapTLSF_SL_LOG2 )
+#define heapTLSF_FL_SHIFT			( heapTLSF_SL_LOG2 + heapTLSF_ALIGN_LOG2 )
+#define heapTLSF_FL_COUNT			( configHEAP_TLSF_FL_INDEX_MAX - heapTLSF_FL_SHIFT + 1 )
+#define heapTLSF_SMALL_BLOCK_SIZE	( ( size_t ) 1 << heapTLSF_FL_SHIFT )
+
+#if( heapTLSF_FL_COUNT > 32 )
+	#error configHEAP_TLSF_FL_INDEX_MAX is too large for a 32-bit first level bitmap
+#endif
+
+/* The two low bits of xSize are free because block sizes are always a multiple
+of portBYTE_ALIGNMENT. */
+#define heapBLOCK_FREE_BIT			( ( size_t ) 1 )
+#define heapPREV_FREE_BIT			( ( size_t ) 2 )
+#define heapBLOCK_FLAGS_MASK		( heapBLOCK_FREE_BIT | heapPREV_FREE_BIT )
+
+/* Define the block header.  Only the first three members are present in an
+allocated block; the free list links overlay the start of the payload and are
+therefore only valid while the block is free. */
+typedef struct A_TLSF_BLOCK
+{
+	struct A_TLSF_BLOCK *pxPrevPhysBlock;	/*<< Previous block in memory, valid only when heapPREV_FREE_BIT is set. */
+	size_t xSize;							/*<< Size of the block including the header, plus flag bits. */
+	TaskHeapStats_t *pxOwner;				/*<< Statistics entry of the task that allocated the block. */
+	struct A_TLSF_BLOCK *pxNextFree;		/*<< Next block in the same segregated list. */
+	struct A_TLSF_BLOCK *pxPrevFree;		/*<< Previous block in the same segregated list. */
+} TlsfBlock_t;
+
+/* One control structure is kept per heap region. */
+typedef struct A_TLSF_CONTROL
+{
+	uint8_t *pucStart;						/*<< First byte of the region, used to find the region a block belongs to. */
+	uint8_t *pucEnd;						/*<< The end of region marker. */
+	uint32_t ulFLBitmap;					/*<< Bit n set when any list of first level n is non-empty. */
+	uint32_t ulSLBitmap[ heapTLSF_FL_COUNT ];	/*<< Bit m of entry n set when list [n][m] is non-empty. */
+	TlsfBlock_t *pxFreeLists[ heapTLSF_FL_COUNT ][ heapTLSF_SL_COUNT ];
+	size_t xFreeBytesRemaining;
+} TlsfControl_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Index (0 based) of the most significant set bit.  ulValue must not be 0.
+ */
+static UBaseType_t prvFls( uint32_t ulValue );
+
+/*
+ * Map a block size onto the segregated list that holds blocks of that size.
+ */
+static void prvMappingInsert( size_t xSize, UBaseType_t *puxFL, UBaseType_t *puxSL );
+
+/*
+ * Find a non-empty list whose blocks are all at least xSize bytes, and remove
+ * and return its first block.  Returns NULL if no such block exists.
+ */
+static TlsfBlock_t *prvLocateFreeBlock( TlsfControl_t *pxControl, size_t xSize );
+
+/*
+ * Add/remove a free block to/from the segregated list matching its size.
+ */
+static void prvInsertFreeBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock );
+static void prvRemoveFreeBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock );
+
+/*
+ * Mark pxBlock as free, merge it with its free physical neighbours and put the
+ * result into the free lists.
+ */
+static void prvReleaseBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock );
+
+/*
+ * Allocate xWantedSize bytes (already adjusted for header and alignment) from
+ * a single region.  Must be called with the scheduler suspended.
+ */
+static void *prvAllocateFromRegion( TlsfControl_t *pxControl, size_t xWantedSize );
+
+/*
+ * Find the statistics entry of xTask, taking an unused one if the task has
+ * none yet, or the overflow entry if the table is full.
+ */
+static TaskHeapStats_t *prvGetTaskStats( TaskHandle_t xTask );
+
+/*
+ * Return an entry to the unused state.
+ */
+static void prvReleaseTaskStats( TaskHeapStats_t *pxStats );
+
+/*-----------------------------------------------------------*/
+
+/* Size of the part of the block header that precedes the payload of an
+allocated block, rounded to the required alignment. */
+static const size_t xHeapStructSize = ( offsetof( TlsfBlock_t, pxNextFree ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* A free block must be able to hold the complete header including the free
+list links. */
+static const size_t xMinimumBlockSize = ( sizeof( TlsfBlock_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+static TlsfControl_t xControls[ configHEAP_TLSF_MAX_REGIONS ];
+static UBaseType_t uxDefinedRegions = 0U;
+
+/* Keeps track of the number of free bytes remaining across all regions. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+
+static TaskHeapStats_t xTaskStats[ configHEAP_TLSF_TASK_STATS_ENTRIES + 1 ];
+
+/*-----------------------------------------------------------*/
+
+#define heapBLOCK_SIZE( pxBlock )		( ( pxBlock )->xSize & ~heapBLOCK_FLAGS_MASK )
+#define heapNEXT_PHYS_BLOCK( pxBlock )	( ( TlsfBlock_t * ) ( ( ( uint8_t * ) ( pxBlock ) ) + heapBLOCK_SIZE( pxBlock ) ) )
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFls( uint32_t ulValue )
+{
+	#if defined( __GNUC__ )
+	{
+		return ( UBaseType_t ) ( 31 - __builtin_clz( ulValue ) );
+	}
+	#elif defined( __ARMCC_VERSION )
+	{
+		return ( UBaseType_t ) ( 31 - __clz( ulValue ) );
+	}
+	#elif defined( __ICCARM__ )
+	{
+		return ( UBaseType_t ) ( 31 - __CLZ( ulValue ) );
+	}
+	#else
+	{
+	UBaseType_t uxBit = 0;
+
+		while( ( ulValue >>= 1 ) != 0UL )
+		{
+			uxBit++;
+		}
+
+		return uxBit;
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFfs( uint32_t ulValue )
+{
+	/* Isolate the least significant set bit and find its index. */
+	return prvFls( ulValue & ( ~ulValue + 1UL ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMappingInsert( size_t xSize, UBaseType_t *puxFL, UBaseType_t *puxSL )
+{
+UBaseType_t uxFL;
+
+	if( xSize < heapTLSF_SMALL_BLOCK_SIZE )
+	{
+		*puxFL = 0;
+		*puxSL = ( UBaseType_t ) ( xSize >> heapTLSF_ALIGN_LOG2 );
+	}
+	else
+	{
+		uxFL = prvFls( ( uint32_t ) xSize );
+		*puxSL = ( UBaseType_t ) ( ( xSize >> ( uxFL - heapTLSF_SL_LOG2 ) ) ^ heapTLSF_SL_COUNT );
+		*puxFL = uxFL - ( heapTLSF_FL_SHIFT - 1 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static TlsfBlock_t *prvLocateFreeBlock( TlsfControl_t *pxControl, size_t xSize )
+{
+UBaseType_t uxFL, uxSL;
+uint32_t ulMap;
+TlsfBlock_t *pxBlock;
+
+	/* Round the request up to the next list boundary so that every block in
+	the list found is large enough - this is what makes the search O(1). */
+	if( xSize >= heapTLSF_SMALL_BLOCK_SIZE )
+	{
+		xSize += ( ( size_t ) 1 << ( prvFls( ( uint32_t ) xSize ) - heapTLSF_SL_LOG2 ) ) - 1U;
+	}
+
+	prvMappingInsert( xSize, &uxFL, &uxSL );
+
+	if( uxFL >= heapTLSF_FL_COUNT )
+	{
+		return NULL;
+	}
+
+	ulMap = pxControl->ulSLBitmap[ uxFL ] & ( ~0UL << uxSL );
+	if( ulMap == 0UL )
+	{
+		/* Nothing in this first level, try the next larger non-empty one. */
+		if( ( uxFL + 1 ) >= heapTLSF_FL_COUNT )
+		{
+			return NULL;
+		}
+
+		ulMap = pxControl->ulFLBitmap & ( ~0UL << ( uxFL + 1 ) );
+		if( ulMap == 0UL )
+		{
+			return NULL;
+		}
+
+		uxFL = prvFfs( ulMap );
+		ulMap = pxControl->ulSLBitmap[ uxFL ];
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	uxSL = prvFfs( ulMap );
+	pxBlock = pxControl->pxFreeLists[ uxFL ][ uxSL ];
+	configASSERT( pxBlock != NULL );
+	prvRemoveFreeBlock( pxControl, pxBlock );
+
+	return pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock )
+{
+UBaseType_t uxFL, uxSL;
+TlsfBlock_t *pxHead;
+
+	prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFL, &uxSL );
+
+	pxHead = pxControl->pxFreeLists[ uxFL ][ uxSL ];
+	pxBlock->pxNextFree = pxHead;
+	pxBlock->pxPrevFree = NULL;
+	if( pxHead != NULL )
+	{
+		pxHead->pxPrevFree = pxBlock;
+	}
+	else
+	{
+		pxControl->ulFLBitmap |= ( 1UL << uxFL );
+		pxControl->ulSLBitmap[ uxFL ] |= ( 1UL << uxSL );
+	}
+
+	pxControl->pxFreeLists[ uxFL ][ uxSL ] = pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock )
+{
+UBaseType_t uxFL, uxSL;
+
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock->pxPrevFree;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock->pxPrevFree != NULL )
+	{
+		pxBlock->pxPrevFree->pxNextFree = pxBlock->pxNextFree;
+	}
+	else
+	{
+		/* The block was the head of its list. */
+		prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFL, &uxSL );
+		pxControl->pxFreeLists[ uxFL ][ uxSL ] = pxBlock->pxNextFree;
+
+		if( pxBlock->pxNextFree == NULL )
+		{
+			pxControl->ulSLBitmap[ uxFL ] &= ~( 1UL << uxSL );
+			if( pxControl->ulSLBitmap[ uxFL ] == 0UL )
+			{
+				pxControl->ulFLBitmap &= ~( 1UL << uxFL );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock )
+{
+TlsfBlock_t *pxNeighbour;
+
+	/* Merge with the previous physical block if that is free. */
+	if( ( pxBlock->xSize & heapPREV_FREE_BIT ) != 0 )
+	{
+		pxNeighbour = pxBlock->pxPrevPhysBlock;
+		prvRemoveFreeBlock( pxControl, pxNeighbour );
+		pxNeighbour->xSize += heapBLOCK_SIZE( pxBlock );
+		pxBlock = pxNeighbour;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	/* Merge with the next physical block if that is free.  The end of region
+	marker is never free, so this cannot run off the end of the region. */
+	pxNeighbour = heapNEXT_PHYS_BLOCK( pxBlock );
+	if( ( pxNeighbour->xSize & heapBLOCK_FREE_BIT ) != 0 )
+	{
+		prvRemoveFreeBlock( pxControl, pxNeighbour );
+		pxBlock->xSize += heapBLOCK_SIZE( pxNeighbour );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxBlock->xSize |= heapBLOCK_FREE_BIT;
+	pxBlock->pxOwner = NULL;
+
+	/* Tell the following block that its predecessor is now free. */
+	pxNeighbour = heapNEXT_PHYS_BLOCK( pxBlock );
+	pxNeighbour->pxPrevPhysBlock = pxBlock;
+	pxNeighbour->xSize |= heapPREV_FREE_BIT;
+
+	prvInsertFreeBlock( pxControl, pxBlock );
+}
+/*-----------------------------------------------------------*/
+
+static void *prvAllocateFromRegion( TlsfControl_t *pxControl, size_t xWantedSize )
+{
+TlsfBlock_t *pxBlock, *pxRemainder, *pxNext;
+size_t xBlockSize;
+
+	if( xWantedSize > pxControl->xFreeBytesRemaining )
+	{
+		return NULL;
+	}
+
+	pxBlock = prvLocateFreeBlock( pxControl, xWantedSize );
+	if( pxBlock == NULL )
+	{
+		return NULL;
+	}
+
+	xBlockSize = heapBLOCK_SIZE( pxBlock );
+
+	/* If the block is larger than required it can be split into two, with the
+	remainder going straight back into the free lists. */
+	if( ( xBlockSize - xWantedSize ) >= xMinimumBlockSize )
+	{
+		pxRemainder = ( TlsfBlock_t * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+		pxRemainder->xSize = ( xBlockSize - xWantedSize ) | heapBLOCK_FREE_BIT;
+		pxRemainder->pxOwner = NULL;
+
+		pxNext = heapNEXT_PHYS_BLOCK( pxRemainder );
+		pxNext->pxPrevPhysBlock = pxRemainder;
+
+		prvInsertFreeBlock( pxControl, pxRemainder );
+
+		/* Keep the previous-free flag of the block, clear its free flag. */
+		pxBlock->xSize = xWantedSize | ( pxBlock->xSize & heapPREV_FREE_BIT );
+	}
+	else
+	{
+		/* Use the whole block; the next block now follows a used one. */
+		pxNext = heapNEXT_PHYS_BLOCK( pxBlock );
+		pxNext->xSize &= ~heapPREV_FREE_BIT;
+		pxBlock->xSize &= ~heapBLOCK_FREE_BIT;
+	}
+
+	pxControl->xFreeBytesRemaining -= heapBLOCK_SIZE( pxBlock );
+
+	return ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapStructSize );
+}
+/*-----------------------------------------------------------*/
+
+static TaskHeapStats_t *prvGetTaskStats( TaskHandle_t xTask )
+{
+TaskHeapStats_t *pxStats = NULL;
+UBaseType_t ux;
+
+	/* The table is small and of fixed size, so the search is bounded.  Entries
+	of deleted tasks hold heapTLSF_DELETED_TASK, so a new task that reuses the
+	handle of a deleted one gets an entry of its own. */
+	for( ux = 0; ux < configHEAP_TLSF_TASK_STATS_ENTRIES; ux++ )
+	{
+		if( xTaskStats[ ux ].xTask == xTask )
+		{
+			return &xTaskStats[ ux ];
+		}
+		else if( ( pxStats == NULL ) && ( xTaskStats[ ux ].xTask == heapTLSF_OVERFLOW_TASK ) )
+		{
+			/* Remember the first unused entry in case xTask is not found. */
+			pxStats = &xTaskStats[ ux ];
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+	if( pxStats == NULL )
+	{
+		/* Table full - use the overflow entry. */
+		pxStats = &xTaskStats[ configHEAP_TLSF_TASK_STATS_ENTRIES ];
+	}
+	else
+	{
+		pxStats->xTask = xTask;
+	}
+
+	return pxStats;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseTaskStats( TaskHeapStats_t *pxStats )
+{
+	pxStats->xTask = heapTLSF_OVERFLOW_TASK;
+	pxStats->xCurrentBytes = 0U;
+	pxStats->xPeakBytes = 0U;
+	pxStats->xAllocations = 0U;
+	pxStats->xFrees = 0U;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvPortMalloc( UBaseType_t uxFirstRegion, UBaseType_t uxLastRegion, size_t xWantedSize )
+{
+void *pvReturn = NULL;
+TlsfBlock_t *pxBlock;
+UBaseType_t uxRegion;
+TaskHeapStats_t *pxStats;
+
+	/* The heap must be initialised before the first call to
+	prvPortMalloc(). */
+	configASSERT( uxDefinedRegions != 0U );
+
+	vTaskSuspendAll();
+	{
+		/* The wanted size is increased so it can contain the block header in
+		addition to the requested amount of bytes, and rounded so the block can
+		later hold the free list links. */
+		if( ( xWantedSize > 0 ) && ( xWantedSize < ( ( size_t ) 1 << configHEAP_TLSF_FL_INDEX_MAX ) ) )
+		{
+			xWantedSize += xHeapStructSize;
+
+			/* Ensure that blocks are always aligned to the required number
+			of bytes. */
+			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+			{
+				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( xWantedSize < xMinimumBlockSize )
+			{
+				xWantedSize = xMinimumBlockSize;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			for( uxRegion = uxFirstRegion; ( uxRegion <= uxLastRegion ) && ( pvReturn == NULL ); uxRegion++ )
+			{
+				pvReturn = prvAllocateFromRegion( &xControls[ uxRegion ], xWantedSize );
+			}
+
+			if( pvReturn != NULL )
+			{
+				pxBlock = ( TlsfBlock_t * ) ( ( ( uint8_t * ) pvReturn ) - xHeapStructSize );
+				pxStats = prvGetTaskStats( xTaskGetCurrentTaskHandle() );
+				pxBlock->pxOwner = pxStats;
+
+				xFreeBytesRemaining -= heapBLOCK_SIZE( pxBlock );
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				pxStats->xCurrentBytes += heapBLOCK_SIZE( pxBlock );
+				pxStats->xAllocations++;
+				if( pxStats->xCurrentBytes > pxStats->xPeakBytes )
+				{
+					pxStats->xPeakBytes = pxStats->xCurrentBytes;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+	return prvPortMalloc( 0U, uxDefinedRegions - 1U, xWantedSize );
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocFromRegion( UBaseType_t uxRegion, size_t xWantedSize )
+{
+	configASSERT( uxRegion < uxDefinedRegions );
+
+	return prvPortMalloc( uxRegion, uxRegion, xWantedSize );
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+uint8_t *puc = ( uint8_t * ) pv;
+TlsfBlock_t *pxBlock;
+TlsfControl_t *pxControl = NULL;
+TaskHeapStats_t *pxStats;
+UBaseType_t uxRegion;
+size_t xBlockSize;
+
+	if( pv != NULL )
+	{
+		/* The memory being freed will have a block header immediately before
+		it. */
+		puc -= xHeapStructSize;
+		pxBlock = ( void * ) puc;
+
+		/* Find the region the block came from. */
+		for( uxRegion = 0; uxRegion < uxDefinedRegions; uxRegion++ )
+		{
+			if( ( puc >= xControls[ uxRegion ].pucStart ) && ( puc < xControls[ uxRegion ].pucEnd ) )
+			{
+				pxControl = &xControls[ uxRegion ];
+				break;
+			}
+		}
+
+		/* Check the block is actually allocated. */
+		configASSERT( pxControl != NULL );
+		configASSERT( ( pxBlock->xSize & heapBLOCK_FREE_BIT ) == 0 );
+
+		if( ( pxControl != NULL ) && ( ( pxBlock->xSize & heapBLOCK_FREE_BIT ) == 0 ) )
+		{
+			vTaskSuspendAll();
+			{
+				xBlockSize = heapBLOCK_SIZE( pxBlock );
+				xFreeBytesRemaining += xBlockSize;
+				pxControl->xFreeBytesRemaining += xBlockSize;
+
+				/* The block is charged to the entry it was allocated from,
+				even if that task has been deleted since. */
+				pxStats = pxBlock->pxOwner;
+				pxStats->xCurrentBytes -= xBlockSize;
+				pxStats->xFrees++;
+				if( ( pxStats->xTask == heapTLSF_DELETED_TASK ) && ( pxStats->xCurrentBytes == 0U ) )
+				{
+					prvReleaseTaskStats( pxStats );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				traceFREE( pv, xBlockSize );
+				prvReleaseBlock( pxControl, pxBlock );
+			}
+			( void ) xTaskResumeAll();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetRegionFreeHeapSize( UBaseType_t uxRegion )
+{
+	configASSERT( uxRegion < uxDefinedRegions );
+
+	return xControls[ uxRegion ].xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetRegionLargestFreeBlock( UBaseType_t uxRegion )
+{
+TlsfControl_t *pxControl;
+TlsfBlock_t *pxBlock;
+UBaseType_t uxFL, uxSL;
+size_t xLargest = 0U;
+
+	configASSERT( uxRegion < uxDefinedRegions );
+	pxControl = &xControls[ uxRegion ];
+
+	vTaskSuspendAll();
+	{
+		if( pxControl->ulFLBitmap != 0UL )
+		{
+			/* Only the highest non-empty list needs to be walked. */
+			uxFL = prvFls( pxControl->ulFLBitmap );
+			uxSL = prvFls( pxControl->ulSLBitmap[ uxFL ] );
+
+			for( pxBlock = pxControl->pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+			{
+				if( heapBLOCK_SIZE( pxBlock ) > xLargest )
+				{
+					xLargest = heapBLOCK_SIZE( pxBlock );
+				}
+			}
+
+			xLargest -= xHeapStructSize;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return xLargest;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortGetTaskHeapStats( TaskHandle_t xTask, TaskHeapStats_t *pxStats )
+{
+BaseType_t xReturn = pdFALSE;
+UBaseType_t ux;
+
+	vTaskSuspendAll();
+	{
+		for( ux = 0; ux < configHEAP_TLSF_TASK_STATS_ENTRIES; ux++ )
+		{
+			if( xTaskStats[ ux ].xTask == xTask )
+			{
+				*pxStats = xTaskStats[ ux ];
+				xReturn = pdTRUE;
+				break;
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortGetAllTaskHeapStats( TaskHeapStats_t *pxStatsArray, UBaseType_t uxArraySize )
+{
+UBaseType_t ux, uxCount = 0;
+
+	vTaskSuspendAll();
+	{
+		for( ux = 0; ( ux <= configHEAP_TLSF_TASK_STATS_ENTRIES ) && ( uxCount < uxArraySize ); ux++ )
+		{
+			/* Unused entries are skipped; the overflow entry (the last one) is
+			reported only when something has been attributed to it. */
+			if( ( ux < configHEAP_TLSF_TASK_STATS_ENTRIES ) && ( xTaskStats[ ux ].xTask == heapTLSF_OVERFLOW_TASK ) )
+			{
+				continue;
+			}
+
+			if( ( ux == configHEAP_TLSF_TASK_STATS_ENTRIES ) && ( xTaskStats[ ux ].xAllocations == 0U ) )
+			{
+				continue;
+			}
+
+			pxStatsArray[ uxCount++ ] = xTaskStats[ ux ];
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTaskDeleted( void *pvTask )
+{
+UBaseType_t ux;
+
+	/* Called from traceTASK_DELETE(), inside the critical section of
+	vTaskDelete(); the nested critical section also covers direct calls. */
+	taskENTER_CRITICAL();
+	{
+		for( ux = 0; ux < configHEAP_TLSF_TASK_STATS_ENTRIES; ux++ )
+		{
+			if( xTaskStats[ ux ].xTask == ( TaskHandle_t ) pvTask )
+			{
+				/* Blocks the task allocated may outlive it, e.g. a buffer
+				handed to another task.  Their entry stays until they are
+				freed, marked so the handle can be reused. */
+				if( xTaskStats[ ux ].xCurrentBytes == 0U )
+				{
+					prvReleaseTaskStats( &xTaskStats[ ux ] );
+				}
+				else
+				{
+					xTaskStats[ ux ].xTask = heapTLSF_DELETED_TASK;
+				}
+				break;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions )
+{
+const HeapRegion_t *pxHeapRegion;
+TlsfControl_t *pxControl;
+TlsfBlock_t *pxFirstBlock, *pxEndMarker;
+size_t xAddress, xEndAddress, xTotalHeapSize = 0;
+UBaseType_t ux;
+
+	/* Can only call once! */
+	configASSERT( uxDefinedRegions == 0U );
+
+	for( ux = 0; ux <= configHEAP_TLSF_TASK_STATS_ENTRIES; ux++ )
+	{
+		prvReleaseTaskStats( &xTaskStats[ ux ] );
+	}
+
+	for( pxHeapRegion = pxHeapRegions; pxHeapRegion->xSizeInBytes > 0; pxHeapRegion++ )
+	{
+		configASSERT( uxDefinedRegions < configHEAP_TLSF_MAX_REGIONS );
+		if( uxDefinedRegions >= configHEAP_TLSF_MAX_REGIONS )
+		{
+			break;
+		}
+
+		/* Ensure the heap region starts and ends on a correctly aligned
+		boundary. */
+		xAddress = ( size_t ) pxHeapRegion->pucStartAddress;
+		xAddress = ( xAddress + ( portBYTE_ALIGNMENT - 1 ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		xEndAddress = ( ( size_t ) pxHeapRegion->pucStartAddress ) + pxHeapRegion->xSizeInBytes;
+		xEndAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+		/* The region must hold at least one minimum block plus the end
+		marker, and must not be larger than the first level table can
+		index. */
+		configASSERT( xEndAddress > ( xAddress + xMinimumBlockSize + xHeapStructSize ) );
+		configASSERT( ( xEndAddress - xAddress ) < ( ( size_t ) 1 << configHEAP_TLSF_FL_INDEX_MAX ) );
+
+		pxControl = &xControls[ uxDefinedRegions ];
+		pxControl->pucStart = ( uint8_t * ) xAddress;
+
+		/* An end marker that is never free terminates the region so that
+		coalescing never looks past its end. */
+		pxEndMarker = ( TlsfBlock_t * ) ( xEndAddress - xHeapStructSize );
+		pxEndMarker->xSize = 0;
+		pxEndMarker->pxOwner = NULL;
+		pxControl->pucEnd = ( uint8_t * ) pxEndMarker;
+
+		/* To start with there is a single free block in the region that is
+		sized to take up the entire region minus the end marker.  The first
+		block never has a free predecessor. */
+		pxFirstBlock = ( TlsfBlock_t * ) xAddress;
+		pxFirstBlock->xSize = ( size_t ) pxEndMarker - xAddress;
+		pxFirstBlock->pxOwner = NULL;
+		pxControl->xFreeBytesRemaining = pxFirstBlock->xSize;
+		prvReleaseBlock( pxControl, pxFirstBlock );
+
+		xTotalHeapSize += pxControl->xFreeBytesRemaining;
+		uxDefinedRegions++;
+	}
+
+	xMinimumEverFreeBytesRemaining = xTotalHeapSize;
+	xFreeBytesRemaining = xTotalHeapSize;
+
+	/* Check something was actually defined before it is accessed. */
+	configASSERT( xTotalHeapSize );
+}
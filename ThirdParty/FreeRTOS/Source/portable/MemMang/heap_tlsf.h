@@ -0,0 +1,113 @@
+/*
+ * FreeRTOS Kernel V10.0.0
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software. If you wish to use our Amazon
+ * FreeRTOS name, please do so in a fair use way that does not cause confusion.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+#ifndef HEAP_TLSF_H
+#define HEAP_TLSF_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h and task.h must appear in source files before include heap_tlsf.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of tasks whose heap usage is tracked individually.  Allocations made
+by further tasks are accumulated in a shared overflow entry whose xTask member
+is set to heapTLSF_OVERFLOW_TASK. */
+#ifndef configHEAP_TLSF_TASK_STATS_ENTRIES
+	#define configHEAP_TLSF_TASK_STATS_ENTRIES	16
+#endif
+
+/* Maximum number of HeapRegion_t entries that can be passed to
+vPortDefineHeapRegions(). */
+#ifndef configHEAP_TLSF_MAX_REGIONS
+	#define configHEAP_TLSF_MAX_REGIONS			2
+#endif
+
+#define heapTLSF_OVERFLOW_TASK		( ( TaskHandle_t ) ~( ( size_t ) 0 ) )
+
+/* xTask of the entry of a deleted task whose blocks are not all freed yet.
+The entry is reused once they are. */
+#define heapTLSF_DELETED_TASK		( ( TaskHandle_t ) ~( ( size_t ) 1 ) )
+
+/* Heap usage attributed to a single task.  Allocations made before the
+scheduler is started are attributed to a NULL task handle. */
+typedef struct xTASK_HEAP_STATS
+{
+	TaskHandle_t xTask;			/*<< The task the statistics belong to. */
+	size_t xCurrentBytes;		/*<< Bytes (including block overhead) currently owned by the task. */
+	size_t xPeakBytes;			/*<< High-water mark of xCurrentBytes. */
+	size_t xAllocations;		/*<< Number of successful pvPortMalloc() calls made by the task. */
+	size_t xFrees;				/*<< Number of blocks owned by the task that have been freed. */
+} TaskHeapStats_t;
+
+/*
+ * Allocate from one specific region, given by its index in the array that was
+ * passed to vPortDefineHeapRegions().  pvPortMalloc() tries the regions in the
+ * order they were defined, so list the fastest memory (internal SRAM) first and
+ * use pvPortMallocFromRegion() to place large buffers in external EBI SRAM.
+ */
+void *pvPortMallocFromRegion( UBaseType_t uxRegion, size_t xWantedSize ) PRIVILEGED_FUNCTION;
+
+/*
+ * Free bytes remaining in a single region.
+ */
+size_t xPortGetRegionFreeHeapSize( UBaseType_t uxRegion ) PRIVILEGED_FUNCTION;
+
+/*
+ * Largest block that can currently be allocated from a single region.  The
+ * ratio between this and xPortGetRegionFreeHeapSize() is a measure of
+ * fragmentation.
+ */
+size_t xPortGetRegionLargestFreeBlock( UBaseType_t uxRegion ) PRIVILEGED_FUNCTION;
+
+/*
+ * Copy the heap statistics of xTask into *pxStats.  Returns pdFALSE if the
+ * task has never allocated from the heap.
+ */
+BaseType_t xPortGetTaskHeapStats( TaskHandle_t xTask, TaskHeapStats_t *pxStats ) PRIVILEGED_FUNCTION;
+
+/*
+ * Copy up to uxArraySize entries of the task statistics table into
+ * pxStatsArray.  Returns the number of entries written.
+ */
+UBaseType_t uxPortGetAllTaskHeapStats( TaskHeapStats_t *pxStatsArray, UBaseType_t uxArraySize ) PRIVILEGED_FUNCTION;
+
+/*
+ * Release the statistics entry of a deleted task, from traceTASK_DELETE().
+ * Without it every task ever created keeps an entry, and once the table is
+ * full all further tasks share the overflow entry.
+ */
+void vPortHeapTaskDeleted( void *pvTask ) PRIVILEGED_FUNCTION;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEAP_TLSF_H */
@@ -36,6 +36,13 @@
 # include "layer12.h"
 # include "layer3.h"
 
+# if defined(TRACE_ENABLE) && TRACE_ENABLE
+#  include "trace.h"
+# else
+#  define TRACE_BEGIN(id, arg)
+#  define TRACE_END(id, arg)
+# endif
+
 static
 unsigned long const bitrate_table[5][15] = {
   /* MPEG-1 */
@@ -439,6 +446,8 @@ int mad_header_decode(struct mad_header *header, struct mad_stream *stream)
  */
 int mad_frame_decode(struct mad_frame *frame, struct mad_stream *stream)
 {
+  TRACE_BEGIN(TRACE_ID_MAD_FRAME, 0);
+
   frame->options = stream->options;
 
   /* header() */
@@ -472,10 +481,12 @@ int mad_frame_decode(struct mad_frame *frame, struct mad_stream *stream)
     mad_bit_finish(&next_frame);
   }
 
+  TRACE_END(TRACE_ID_MAD_FRAME, 0);
   return 0;
 
  fail:
   stream->anc_bitlen = 0;
+  TRACE_END(TRACE_ID_MAD_FRAME, stream->error);
   return -1;
 }
 
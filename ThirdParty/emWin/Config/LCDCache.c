@@ -0,0 +1,392 @@
+/**************************************************************************//**
+ * @file     LCDCache.c
+ * @version  V1.00
+ * @brief    Frame cache with write suppression for MIPI DCS type LCD controllers
+ *
+ * @note     Free of hardware access; Tool/LcdSim builds this file on the host.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "LCDCache.h"
+
+static LCDCACHE_PORT_T s_sPort;
+static uint16_t *s_pu16Frame;
+static uint32_t s_u32Cols, s_u32Pages;          /* Frame memory size with MV = 0 */
+static uint32_t s_u32Stride, s_u32Rows;         /* Column and page count in the current mapping */
+static uint32_t s_u32MinSkip;
+static uint32_t s_u32Filled;
+static uint32_t s_u32Madctl = 0xFFFFFFFFUL;
+
+/* Command decoding */
+static uint32_t s_u32Cmd;
+static uint32_t s_u32Param;
+static uint8_t  s_au8Addr[8];                   /* CASET and PASET parameters */
+static uint32_t s_u32Xs, s_u32Xe, s_u32Ys, s_u32Ye;     /* Window as set by emWin */
+static uint32_t s_u32WinPending;                /* The controller's window differs from emWin's */
+static uint32_t s_u32Pass;                      /* Window outside the cache: pixels pass through */
+
+/* Pixel stream of a memory write */
+static uint32_t s_u32X, s_u32Y;                 /* Position of the next pixel */
+static uint32_t s_u32Sync;                      /* The controller's write pointer is at (s_u32X, s_u32Y) */
+static uint32_t s_u32RowOnly;                   /* The controller's window ends with the current row */
+static uint32_t s_u32Skip, s_u32SkipX, s_u32SkipY;      /* Unchanged pixels behind the position, not sent */
+
+static uint16_t s_au16Stage[LCDCACHE_STAGE_LEN];
+static uint32_t s_u32Staged;
+
+static LCDCACHE_STATS_T s_sStats;
+
+static void LCDCache_ResetStats(void)
+{
+    memset(&s_sStats, 0, sizeof(s_sStats));
+    s_sStats.i32X0 = 0x7FFFFFFF;
+    s_sStats.i32Y0 = 0x7FFFFFFF;
+    s_sStats.i32X1 = -1;
+    s_sStats.i32Y1 = -1;
+}
+
+static void LCDCache_Flush(void)
+{
+    if (s_u32Staged)
+    {
+        s_sPort.pfWriteMultiple(s_au16Stage, (int)s_u32Staged);
+        s_sStats.u32PixelsOut += s_u32Staged;
+        s_u32Staged = 0UL;
+    }
+}
+
+static void LCDCache_Stage(uint16_t u16Pixel)
+{
+    s_au16Stage[s_u32Staged++] = u16Pixel;
+
+    if (s_u32Staged == LCDCACHE_STAGE_LEN)
+        LCDCache_Flush();
+}
+
+static void LCDCache_SetWindow(uint32_t u32X0, uint32_t u32X1, uint32_t u32Y0, uint32_t u32Y1)
+{
+    s_sPort.pfWriteCmd(LCDCACHE_CMD_CASET);
+    s_sPort.pfWriteData((uint16_t)(u32X0 >> 8));
+    s_sPort.pfWriteData((uint16_t)(u32X0 & 0xFFUL));
+    s_sPort.pfWriteData((uint16_t)(u32X1 >> 8));
+    s_sPort.pfWriteData((uint16_t)(u32X1 & 0xFFUL));
+    s_sPort.pfWriteCmd(LCDCACHE_CMD_PASET);
+    s_sPort.pfWriteData((uint16_t)(u32Y0 >> 8));
+    s_sPort.pfWriteData((uint16_t)(u32Y0 & 0xFFUL));
+    s_sPort.pfWriteData((uint16_t)(u32Y1 >> 8));
+    s_sPort.pfWriteData((uint16_t)(u32Y1 & 0xFFUL));
+}
+
+/* Give the controller the window emWin set before a command that relies on it */
+static void LCDCache_SyncWindow(void)
+{
+    if (s_u32WinPending)
+    {
+        LCDCache_SetWindow(s_u32Xs, s_u32Xe, s_u32Ys, s_u32Ye);
+        s_u32WinPending = 0UL;
+    }
+}
+
+/* Point the controller at the current position. A window starting mid-row covers the rest of the row only. */
+static void LCDCache_Readdress(void)
+{
+    LCDCache_Flush();
+    s_u32RowOnly = (s_u32X != s_u32Xs) ? 1UL : 0UL;
+    LCDCache_SetWindow(s_u32X, s_u32Xe, s_u32Y, s_u32RowOnly ? s_u32Y : s_u32Ye);
+    s_sPort.pfWriteCmd(LCDCACHE_CMD_RAMWR);
+    s_u32WinPending = 1UL;
+    s_u32Sync = 1UL;
+    s_sStats.u32Windows++;
+}
+
+static void LCDCache_Advance(uint32_t *pu32X, uint32_t *pu32Y, uint32_t u32Track)
+{
+    if (++*pu32X > s_u32Xe)
+    {
+        *pu32X = s_u32Xs;
+
+        if (u32Track && s_u32RowOnly)
+            s_u32Sync = 0UL;
+
+        if (++*pu32Y > s_u32Ye)
+        {
+            *pu32Y = s_u32Ys;
+
+            if (u32Track)
+                s_u32Sync = 0UL;
+        }
+    }
+}
+
+static void LCDCache_Pixel(uint16_t u16Pixel)
+{
+    uint16_t *pu16Cell;
+    uint32_t i, u32X, u32Y;
+
+    s_sStats.u32PixelsIn++;
+
+    if (s_u32Pass)
+    {
+        LCDCache_Stage(u16Pixel);
+        return;
+    }
+
+    pu16Cell = &s_pu16Frame[s_u32Y * s_u32Stride + s_u32X];
+
+    if (*pu16Cell == u16Pixel)
+    {
+        if (s_u32Skip++ == 0UL)
+        {
+            s_u32SkipX = s_u32X;
+            s_u32SkipY = s_u32Y;
+        }
+    }
+    else
+    {
+        *pu16Cell = u16Pixel;
+        s_sStats.u32Changed++;
+
+        if ((int32_t)s_u32X < s_sStats.i32X0) s_sStats.i32X0 = (int32_t)s_u32X;
+        if ((int32_t)s_u32X > s_sStats.i32X1) s_sStats.i32X1 = (int32_t)s_u32X;
+        if ((int32_t)s_u32Y < s_sStats.i32Y0) s_sStats.i32Y0 = (int32_t)s_u32Y;
+        if ((int32_t)s_u32Y > s_sStats.i32Y1) s_sStats.i32Y1 = (int32_t)s_u32Y;
+
+        if (s_u32Sync && s_u32Skip)
+        {
+            if (s_u32Skip < s_u32MinSkip)
+            {
+                /* Cheaper to resend the short unchanged run than to readdress */
+                u32X = s_u32SkipX;
+                u32Y = s_u32SkipY;
+
+                for (i = 0UL; i < s_u32Skip; i++)
+                {
+                    LCDCache_Stage(s_pu16Frame[u32Y * s_u32Stride + u32X]);
+                    LCDCache_Advance(&u32X, &u32Y, 0UL);
+                }
+            }
+            else
+                s_u32Sync = 0UL;
+        }
+
+        s_u32Skip = 0UL;
+
+        if (s_u32Sync == 0UL)
+            LCDCache_Readdress();
+
+        LCDCache_Stage(u16Pixel);
+    }
+
+    LCDCache_Advance(&s_u32X, &s_u32Y, 1UL);
+}
+
+static void LCDCache_Param(uint16_t u16Data)
+{
+    uint32_t u32Idx = s_u32Param++;
+
+    if ((s_u32Cmd == LCDCACHE_CMD_CASET) || (s_u32Cmd == LCDCACHE_CMD_PASET))
+    {
+        if (u32Idx >= 4UL)
+            return;
+
+        s_au8Addr[((s_u32Cmd == LCDCACHE_CMD_PASET) ? 4UL : 0UL) + u32Idx] = (uint8_t)u16Data;
+
+        if (u32Idx == 3UL)
+        {
+            if (s_u32Cmd == LCDCACHE_CMD_CASET)
+            {
+                s_u32Xs = ((uint32_t)s_au8Addr[0] << 8) | s_au8Addr[1];
+                s_u32Xe = ((uint32_t)s_au8Addr[2] << 8) | s_au8Addr[3];
+            }
+            else
+            {
+                s_u32Ys = ((uint32_t)s_au8Addr[4] << 8) | s_au8Addr[5];
+                s_u32Ye = ((uint32_t)s_au8Addr[6] << 8) | s_au8Addr[7];
+            }
+
+            s_u32WinPending = 1UL;
+        }
+
+        return;
+    }
+
+    if ((s_u32Cmd == LCDCACHE_CMD_MADCTL) && (u32Idx == 0UL) && (u16Data != s_u32Madctl))
+    {
+        s_u32Madctl = u16Data & 0xFFUL;
+        s_u32Stride = (s_u32Madctl & LCDCACHE_MADCTL_MV) ? s_u32Pages : s_u32Cols;
+        s_u32Rows = (s_u32Madctl & LCDCACHE_MADCTL_MV) ? s_u32Cols : s_u32Pages;
+        s_u32Filled = 0UL;
+    }
+
+    s_sPort.pfWriteData(u16Data);
+}
+
+/**
+  * @brief      Set up the cache
+  * @param[in]  psPort      Bus access
+  * @param[in]  pu16Frame   u32Cols x u32Pages words of cache
+  * @param[in]  u32Cols     Columns of the controller's frame memory
+  * @param[in]  u32Pages    Pages (rows) of the controller's frame memory
+  * @param[in]  u32MinSkip  Shortest unchanged run worth new address commands, 0 for the default of 12
+  * @return     None
+  * @details    The cache and display are filled with black before the first memory write, unless
+  *             LCDCache_Fill() is called first.
+  */
+void LCDCache_Init(const LCDCACHE_PORT_T *psPort, uint16_t *pu16Frame, uint32_t u32Cols, uint32_t u32Pages,
+                   uint32_t u32MinSkip)
+{
+    s_sPort = *psPort;
+    s_pu16Frame = pu16Frame;
+    s_u32Cols = u32Cols;
+    s_u32Pages = u32Pages;
+    s_u32Stride = u32Cols;
+    s_u32Rows = u32Pages;
+    s_u32MinSkip = u32MinSkip ? u32MinSkip : 12UL;
+    s_u32Filled = 0UL;
+    s_u32Madctl = 0xFFFFFFFFUL;
+    s_u32Cmd = 0UL;
+    s_u32Sync = 0UL;
+    s_u32Skip = 0UL;
+    s_u32Staged = 0UL;
+    s_u32Pass = 0UL;
+    s_u32Xs = 0UL;
+    s_u32Xe = u32Cols - 1UL;
+    s_u32Ys = 0UL;
+    s_u32Ye = u32Pages - 1UL;
+    s_u32WinPending = 1UL;
+    LCDCache_ResetStats();
+}
+
+/**
+  * @brief      Fill display and cache with one color
+  * @param[in]  u16Color    Pixel value
+  * @return     None
+  * @details    Makes the cache match the display. The controller is left with emWin's window
+  *             pending.
+  */
+void LCDCache_Fill(uint16_t u16Color)
+{
+    uint32_t i, u32Count = s_u32Stride * s_u32Rows;
+
+    LCDCache_Flush();
+    LCDCache_SetWindow(0UL, s_u32Stride - 1UL, 0UL, s_u32Rows - 1UL);
+    s_sPort.pfWriteCmd(LCDCACHE_CMD_RAMWR);
+
+    for (i = 0UL; i < u32Count; i++)
+    {
+        s_pu16Frame[i] = u16Color;
+        LCDCache_Stage(u16Color);
+    }
+
+    LCDCache_Flush();
+    s_u32WinPending = 1UL;
+    s_u32Sync = 0UL;
+    s_u32Filled = 1UL;
+}
+
+/**
+  * @brief      Command write, for GUI_PORT_API::pfWrite16_A0
+  * @param[in]  u16Cmd  Command
+  * @return     None
+  */
+void LCDCache_WriteCmd(uint16_t u16Cmd)
+{
+    LCDCache_Flush();
+    s_u32Skip = 0UL;
+    s_u32Param = 0UL;
+
+    if (u16Cmd == LCDCACHE_CMD_RAMWRC)
+    {
+        /* Continue the stream; the controller needs the command only if it is in step */
+        if ((s_u32Cmd == LCDCACHE_CMD_RAMWR) && s_u32Sync)
+            s_sPort.pfWriteCmd(u16Cmd);
+
+        s_u32Cmd = LCDCACHE_CMD_RAMWR;
+        return;
+    }
+
+    s_u32Cmd = u16Cmd;
+
+    if ((u16Cmd == LCDCACHE_CMD_CASET) || (u16Cmd == LCDCACHE_CMD_PASET))
+        return;
+
+    if (u16Cmd == LCDCACHE_CMD_RAMWR)
+    {
+        if (!s_u32Filled)
+            LCDCache_Fill(0U);
+
+        s_u32X = s_u32Xs;
+        s_u32Y = s_u32Ys;
+        s_u32Sync = 0UL;
+        s_u32RowOnly = 0UL;
+        s_u32Pass = ((s_u32Xe >= s_u32Stride) || (s_u32Ye >= s_u32Rows) || (s_u32Xs > s_u32Xe) || (s_u32Ys > s_u32Ye)) ? 1UL : 0UL;
+
+        if (s_u32Pass)
+        {
+            LCDCache_SyncWindow();
+            s_sPort.pfWriteCmd(u16Cmd);
+        }
+
+        return;
+    }
+
+    LCDCache_SyncWindow();
+    s_u32Sync = 0UL;
+    s_sPort.pfWriteCmd(u16Cmd);
+}
+
+/**
+  * @brief      Data write, for GUI_PORT_API::pfWrite16_A1
+  * @param[in]  u16Data     Parameter or pixel
+  * @return     None
+  */
+void LCDCache_WriteData(uint16_t u16Data)
+{
+    if (s_u32Cmd == LCDCACHE_CMD_RAMWR)
+    {
+        LCDCache_Pixel(u16Data);
+        LCDCache_Flush();
+    }
+    else
+        LCDCache_Param(u16Data);
+}
+
+/**
+  * @brief      Multiple data write, for GUI_PORT_API::pfWriteM16_A1
+  * @param[in]  pu16Data    Parameters or pixels
+  * @param[in]  NumItems    Number of items
+  * @return     None
+  */
+void LCDCache_WriteMultiple(uint16_t *pu16Data, int NumItems)
+{
+    if (s_u32Cmd == LCDCACHE_CMD_RAMWR)
+    {
+        while (NumItems-- > 0)
+            LCDCache_Pixel(*pu16Data++);
+
+        LCDCache_Flush();
+    }
+    else
+    {
+        while (NumItems-- > 0)
+            LCDCache_Param(*pu16Data++);
+    }
+}
+
+/**
+  * @brief      Read and restart the counters
+  * @param[out] psStats     Counters since the previous call, NULL to discard them
+  * @return     None
+  * @details    Call once per frame, e.g. after GUI_Exec().
+  */
+void LCDCache_EndFrame(LCDCACHE_STATS_T *psStats)
+{
+    if (psStats != NULL)
+        *psStats = s_sStats;
+
+    LCDCache_ResetStats();
+}
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,83 @@
+/**************************************************************************//**
+ * @file     LCDCache.h
+ * @version  V1.00
+ * @brief    Frame cache with write suppression for MIPI DCS type LCD controllers
+ *
+ * @details  Sits between the emWin FlexColor port API and the display bus. Memory writes (RAMWR
+ *           0x2C) are compared with a RAM copy of the controller's frame memory and only the
+ *           pixels that changed are sent. Unchanged runs of at least u32MinSkip pixels are jumped
+ *           over with new column/page address commands (CASET 0x2A, PASET 0x2B); shorter ones are
+ *           sent from the cache, as addressing costs about ten bus writes. Window commands from
+ *           emWin are held back until they are needed, so redrawing unchanged content costs no
+ *           bus traffic at all.
+ *
+ *           The cache needs columns x pages 16-bit words and is filled together with the display
+ *           before the first memory write and after every change of the memory access control
+ *           (MADCTL 0x36), which alters the address mapping.
+ *
+ *           The module has no hardware dependency; Tool/LcdSim runs it against a simulated
+ *           controller on the host.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __LCDCACHE_H__
+#define __LCDCACHE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef LCDCACHE_STAGE_LEN
+#define LCDCACHE_STAGE_LEN      256     /*!< Pixels gathered before they are passed to pfWriteMultiple */
+#endif
+
+#define LCDCACHE_CMD_CASET      0x2AU   /*!< Column address set */
+#define LCDCACHE_CMD_PASET      0x2BU   /*!< Page address set */
+#define LCDCACHE_CMD_RAMWR      0x2CU   /*!< Memory write */
+#define LCDCACHE_CMD_MADCTL     0x36U   /*!< Memory access control */
+#define LCDCACHE_CMD_RAMWRC     0x3CU   /*!< Memory write continue */
+#define LCDCACHE_MADCTL_MV      0x20U   /*!< MADCTL row/column exchange */
+
+/**
+  * @details    Bus access used to reach the controller.
+  */
+typedef struct
+{
+    void (*pfWriteCmd)(uint16_t u16Cmd);                            /*!< Write a command (RS low) */
+    void (*pfWriteData)(uint16_t u16Data);                          /*!< Write a parameter (RS high) */
+    void (*pfWriteMultiple)(uint16_t *pu16Data, int NumItems);      /*!< Write pixels (RS high) */
+} LCDCACHE_PORT_T;
+
+/**
+  * @details    Counters since the last LCDCache_EndFrame().
+  */
+typedef struct
+{
+    uint32_t u32PixelsIn;           /*!< Pixels written by emWin */
+    uint32_t u32PixelsOut;          /*!< Pixels sent to the controller */
+    uint32_t u32Changed;            /*!< Pixels that differed from the cache */
+    uint32_t u32Windows;            /*!< Address commands added to jump over unchanged runs */
+    int32_t  i32X0;                 /*!< Dirty rectangle, controller columns and pages; i32X0 > i32X1 if nothing changed */
+    int32_t  i32Y0;                 /*!< Dirty rectangle top */
+    int32_t  i32X1;                 /*!< Dirty rectangle right, inclusive */
+    int32_t  i32Y1;                 /*!< Dirty rectangle bottom, inclusive */
+} LCDCACHE_STATS_T;
+
+void LCDCache_Init(const LCDCACHE_PORT_T *psPort, uint16_t *pu16Frame, uint32_t u32Cols, uint32_t u32Pages,
+                   uint32_t u32MinSkip);
+void LCDCache_Fill(uint16_t u16Color);
+void LCDCache_WriteCmd(uint16_t u16Cmd);
+void LCDCache_WriteData(uint16_t u16Data);
+void LCDCache_WriteMultiple(uint16_t *pu16Data, int NumItems);
+void LCDCache_EndFrame(LCDCACHE_STATS_T *psStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
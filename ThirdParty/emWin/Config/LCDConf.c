@@ -43,11 +43,13 @@ Purpose     : Display controller configuration (single layer)
 
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "GUI.h"
 #include "GUIDRV_FlexColor.h"
 
 #include "M480.h"
+#include "pdma_mgr.h"
 
 #include "M48XTouchPanel.h"
 
@@ -92,6 +94,44 @@ Purpose     : Display controller configuration (single layer)
 #define SET_RST PB6 = 1;
 #define CLR_RST PB6 = 0;
 
+/* LCD Module data register, RS high */
+#define LCD_DATA_OFFSET 0x00030000
+
+//
+// Bulk pixel writes through PDMA. Runs of at least LCD_PDMA_THRESHOLD
+// pixels are copied to one of two bounce buffers and written to the
+// EBI by PDMA, so emWin renders the next run while the previous one is
+// on the bus. Shorter runs are written by the CPU. The channel comes
+// from PDMAMGR_Alloc() and is polled, its interrupt stays disabled; if no
+// channel is free every run is written by the CPU. Define LCD_USE_PDMA as
+// 0 to leave PDMA alone.
+//
+#ifndef   LCD_USE_PDMA
+#define LCD_USE_PDMA        1
+#endif
+#ifndef   LCD_PDMA_THRESHOLD
+#define LCD_PDMA_THRESHOLD  32
+#endif
+#ifndef   LCD_PDMA_BUF_ITEMS
+#define LCD_PDMA_BUF_ITEMS  512
+#endif
+
+//
+// Frame cache (LCDCache.h). Only pixels that differ from the last frame
+// are sent to the module. Needs XSIZE_PHYS * YSIZE_PHYS * 2 bytes, which
+// does not fit on-chip next to the default GUI_NUMBYTES; define
+// LCD_FRAME_CACHE_ADDR to place it in external memory, or reduce
+// GUI_NUMBYTES in GUIConf.c. LCDCache_EndFrame() returns the dirty
+// rectangle and bus counters of the pixels written since its last call.
+//
+#ifndef   LCD_USE_FRAME_CACHE
+#define LCD_USE_FRAME_CACHE 0
+#endif
+
+#if LCD_USE_FRAME_CACHE
+#include "LCDCache.h"
+#endif
+
 /*********************************************************************
 *
 *       Configuration checking
@@ -129,9 +169,72 @@ Purpose     : Display controller configuration (single layer)
 // Write control registers of LCD module  
 // 
 /*-----------------------------------------------*/
+#if LCD_USE_PDMA
+static uint16_t _aDmaBuf[2][LCD_PDMA_BUF_ITEMS];
+static int      _DmaBufIndex;
+static int      _DmaBusy;
+static int      _DmaCh = -1;
+
+/********************************************************************
+*
+*       _LcdWaitDma
+*
+*   Function description:
+*   Waits for the running pixel transfer, if any. Called before every
+*   CPU access to the LCD module.
+*/
+static void _LcdWaitDma(void)
+{
+    if (_DmaBusy) {
+        while ((PDMA->TDSTS & (1UL << _DmaCh)) == 0) {
+        }
+        PDMA->TDSTS = (1UL << _DmaCh);
+        _DmaBusy = 0;
+    }
+}
+
+/********************************************************************
+*
+*       _LcdInitDma
+*/
+static void _LcdInitDma(void)
+{
+    CLK_EnableModuleClock(PDMA_MODULE);
+    //
+    // Leave the time-out channels to the drivers that need them
+    //
+    _DmaCh = PDMAMGR_Alloc(PDMAMGR_ALL_CH & ~PDMAMGR_TOUT_CH, PDMAMGR_PRIO_NORMAL);
+    if (_DmaCh < 0) {
+        return;
+    }
+    PDMA->CHCTL |= (1UL << _DmaCh);
+    PDMA->INTEN &= ~(1UL << _DmaCh);
+    PDMA->TDSTS = (1UL << _DmaCh);
+    (&PDMA->REQSEL0_3)[_DmaCh / 4] &= ~(0x7FUL << ((_DmaCh % 4) * 8));
+    PDMA->DSCT[_DmaCh].DA = EBI_BANK0_BASE_ADDR + LCD_DATA_OFFSET;
+}
+
+/********************************************************************
+*
+*       _LcdStartDma
+*/
+static void _LcdStartDma(uint16_t * pData, int NumItems)
+{
+    PDMA->DSCT[_DmaCh].SA  = (uint32_t)pData;
+    PDMA->DSCT[_DmaCh].CTL = ((uint32_t)(NumItems - 1) << PDMA_DSCT_CTL_TXCNT_Pos) |
+                             PDMA_WIDTH_16 | PDMA_SAR_INC | PDMA_DAR_FIX |
+                             PDMA_REQ_BURST | PDMA_BURST_128 | PDMA_OP_BASIC;
+    _DmaBusy = 1;
+    PDMA->SWREQ = (1UL << _DmaCh);
+}
+#else
+#define _LcdWaitDma()
+#endif
+
 #if PH_CTRL_RS
 void LCD_WR_REG(uint16_t cmd)
 {
+    _LcdWaitDma();
     CLR_RS
     EBI0_WRITE_DATA16(0x00000000, cmd);
     SET_RS
@@ -141,6 +244,7 @@ void LCD_WR_REG(uint16_t cmd)
 #else
 void LCD_WR_REG(uint16_t cmd)
 {
+    _LcdWaitDma();
     EBI0_WRITE_DATA16(0x00000000, cmd);
 }
 
@@ -153,7 +257,8 @@ void LCD_WR_REG(uint16_t cmd)
 /*-----------------------------------------------*/
 void LCD_WR_DATA(uint16_t dat)
 {
-    EBI0_WRITE_DATA16(0x00030000, dat);
+    _LcdWaitDma();
+    EBI0_WRITE_DATA16(LCD_DATA_OFFSET, dat);
 
 }
 
@@ -164,7 +269,8 @@ void LCD_WR_DATA(uint16_t dat)
 /*-----------------------------------------------*/
 uint16_t LCD_RD_DATA(void)
 {
-    return EBI0_READ_DATA16(0x00030000);
+    _LcdWaitDma();
+    return EBI0_READ_DATA16(LCD_DATA_OFFSET);
 
 }
 
@@ -177,8 +283,28 @@ uint16_t LCD_RD_DATA(void)
 */
 static void LcdWriteDataMultiple(uint16_t * pData, int NumItems)
 {
+#if LCD_USE_PDMA
+    int n;
+
+    if ((_DmaCh >= 0) && (NumItems >= LCD_PDMA_THRESHOLD)) {
+        while (NumItems > 0) {
+            n = (NumItems > LCD_PDMA_BUF_ITEMS) ? LCD_PDMA_BUF_ITEMS : NumItems;
+            //
+            // The buffer not in use is filled while the other one drains
+            //
+            memcpy(_aDmaBuf[_DmaBufIndex], pData, (size_t)n * 2);
+            _LcdWaitDma();
+            _LcdStartDma(_aDmaBuf[_DmaBufIndex], n);
+            _DmaBufIndex ^= 1;
+            pData    += n;
+            NumItems -= n;
+        }
+        return;
+    }
+    _LcdWaitDma();
+#endif
     while (NumItems--) {
-        EBI0_WRITE_DATA16(0x00030000,*pData++);
+        EBI0_WRITE_DATA16(LCD_DATA_OFFSET,*pData++);
     }
 }
 
@@ -191,8 +317,9 @@ static void LcdWriteDataMultiple(uint16_t * pData, int NumItems)
 */
 static void LcdReadDataMultiple(uint16_t * pData, int NumItems)
 {
+    _LcdWaitDma();
     while (NumItems--) {
-        *pData++ = EBI0_READ_DATA16(0x00030000);
+        *pData++ = EBI0_READ_DATA16(LCD_DATA_OFFSET);
     }
 }
 
@@ -462,6 +589,10 @@ static void _InitController(void)
     EBI->TCTL0 |= (EBI_TCTL0_WAHDOFF_Msk | EBI_TCTL0_RAHDOFF_Msk);
     printf("\n[EBI CTL0:0x%08X, TCLT0:0x%08X]\n\n", EBI->CTL0, EBI->TCTL0);
 
+#if LCD_USE_PDMA
+    _LcdInitDma();
+#endif
+
     /* Init LCD Module */
     ILI9341_Initial();
     
@@ -477,6 +608,21 @@ static void _InitController(void)
 //    NVIC_EnableIRQ(EINT7_IRQn);
 }
 
+#if LCD_USE_FRAME_CACHE
+#ifdef    LCD_FRAME_CACHE_ADDR
+#define _pFrameCache ((uint16_t *)(LCD_FRAME_CACHE_ADDR))
+#else
+static uint16_t _aFrameCache[XSIZE_PHYS * YSIZE_PHYS];
+#define _pFrameCache _aFrameCache
+#endif
+
+static const LCDCACHE_PORT_T _CachePort = {
+    LCD_WR_REG,
+    LCD_WR_DATA,
+    LcdWriteDataMultiple
+};
+#endif
+
 /*********************************************************************
 *
 *       Public code
@@ -550,10 +696,22 @@ void LCD_X_Config(void)
     //
     // Set controller and operation mode
     //
+#if LCD_USE_FRAME_CACHE
+    //
+    // Writes pass the frame cache, reads go to the module, which the
+    // cache keeps up to date
+    //
+    LCDCache_Init(&_CachePort, _pFrameCache, XSIZE_PHYS, YSIZE_PHYS, 0);
+    PortAPI.pfWrite16_A0  = LCDCache_WriteCmd;
+    PortAPI.pfWrite16_A1  = LCDCache_WriteData;
+    PortAPI.pfWriteM16_A0 = LCDCache_WriteMultiple;
+    PortAPI.pfWriteM16_A1 = LCDCache_WriteMultiple;
+#else
     PortAPI.pfWrite16_A0  = LCD_WR_REG;
     PortAPI.pfWrite16_A1  = LCD_WR_DATA;
     PortAPI.pfWriteM16_A0 = LcdWriteDataMultiple;
     PortAPI.pfWriteM16_A1 = LcdWriteDataMultiple;
+#endif
     PortAPI.pfRead16_A0   = LCD_RD_DATA;
     PortAPI.pfRead16_A1   = LCD_RD_DATA;
     PortAPI.pfReadM16_A0  = LcdReadDataMultiple;
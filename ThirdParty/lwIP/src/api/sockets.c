@@ -216,6 +216,10 @@ struct lwip_sock {
   u8_t err;
   /** counter of how many threads are waiting for this socket using select */
   SELWAIT_T select_waiting;
+#if LWIP_SOCKET_EPOLL
+  /** epoll registrations of this socket, checked by event_callback() */
+  struct lwip_epoll_item *epoll_items;
+#endif /* LWIP_SOCKET_EPOLL */
 };
 
 #if LWIP_NETCONN_SEM_PER_THREAD
@@ -244,6 +248,47 @@ struct lwip_select_cb {
   SELECT_SEM_T sem;
 };
 
+#if LWIP_SOCKET_EPOLL
+/** One socket registered with one epoll instance */
+struct lwip_epoll_item {
+  /** next registration of the same socket */
+  struct lwip_epoll_item *sock_next;
+  /** links in the ready list of the epoll instance */
+  struct lwip_epoll_item *rdy_next;
+  struct lwip_epoll_item *rdy_prev;
+  /** epoll instance, NULL if the item is free */
+  struct lwip_epoll *ep;
+  /** registered socket */
+  struct lwip_sock *sock;
+  /** externally used socket index */
+  int fd;
+  /** LWIP_EPOLLxxx flags of interest */
+  u32_t events;
+  /** returned with the events */
+  lwip_epoll_data_t data;
+  /** 1 while linked into the ready list */
+  u8_t on_ready;
+};
+
+/** An epoll instance: the task waiting in lwip_epoll_wait() only looks at
+    the sockets that event_callback() put on its ready list */
+struct lwip_epoll {
+  /** sockets that became ready, level-triggered ones stay while ready */
+  struct lwip_epoll_item *rdy_head;
+  struct lwip_epoll_item *rdy_tail;
+  /** number of items on the ready list */
+  u16_t rdy_count;
+  /** 1 if the instance is allocated */
+  u8_t used;
+  /** 1 while a task waits on sem */
+  u8_t waiting;
+  /** don't signal the semaphore twice: set to 1 when signalled */
+  u8_t sem_signalled;
+  /** semaphore to wake up the task waiting in lwip_epoll_wait */
+  sys_sem_t sem;
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
 /** A struct sockaddr replacement that has the same alignment as sockaddr_in/
  *  sockaddr_in6 if instantiated.
  */
@@ -289,6 +334,20 @@ static struct lwip_select_cb *select_cb_list;
     and checked in event_callback to see if it has changed. */
 static volatile int select_cb_ctr;
 
+#if LWIP_SOCKET_EPOLL
+/** epoll instances, epoll file descriptors follow the socket range */
+static struct lwip_epoll epolls[LWIP_SOCKET_EPOLL_MAX];
+/** socket registrations shared by all epoll instances */
+static struct lwip_epoll_item epoll_items[LWIP_SOCKET_EPOLL_ITEMS];
+
+#define EPOLL_FD_BASE   (LWIP_SOCKET_OFFSET + NUM_SOCKETS)
+#define IS_EPOLL_FD(s)  (((s) >= EPOLL_FD_BASE) && ((s) < EPOLL_FD_BASE + LWIP_SOCKET_EPOLL_MAX))
+
+static void lwip_epoll_notify(struct lwip_sock *sock, enum netconn_evt evt);
+static void lwip_epoll_sock_closed(struct lwip_sock *sock);
+static int lwip_epoll_close(int epfd);
+#endif /* LWIP_SOCKET_EPOLL */
+
 #if LWIP_SOCKET_SET_ERRNO
 #ifndef set_errno
 #define set_errno(err) do { if (err) { errno = (err); } } while(0)
@@ -420,6 +479,9 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].sendevent  = (NETCONNTYPE_GROUP(newconn->type) == NETCONN_TCP ? (accepted != 0) : 1);
       sockets[i].errevent   = 0;
       sockets[i].err        = 0;
+#if LWIP_SOCKET_EPOLL
+      sockets[i].epoll_items = NULL;
+#endif /* LWIP_SOCKET_EPOLL */
       return i + LWIP_SOCKET_OFFSET;
     }
     SYS_ARCH_UNPROTECT(lev);
@@ -613,6 +675,12 @@ lwip_close(int s)
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_close(%d)\n", s));
 
+#if LWIP_SOCKET_EPOLL
+  if (IS_EPOLL_FD(s)) {
+    return lwip_epoll_close(s);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   sock = get_socket(s);
   if (!sock) {
     return -1;
@@ -629,6 +697,11 @@ lwip_close(int s)
   lwip_socket_drop_registered_memberships(s);
 #endif /* LWIP_IGMP */
 
+#if LWIP_SOCKET_EPOLL
+  /* like Linux, closing a socket removes it from all epoll instances */
+  lwip_epoll_sock_closed(sock);
+#endif /* LWIP_SOCKET_EPOLL */
+
   err = netconn_delete(sock->conn);
   if (err != ERR_OK) {
     sock_set_errno(sock, err_to_errno(err));
@@ -1630,6 +1703,13 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
       break;
   }
 
+#if LWIP_SOCKET_EPOLL
+  if (sock->epoll_items != NULL) {
+    /* only the instances this socket is registered with, not all waiters */
+    lwip_epoll_notify(sock, evt);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   if (sock->select_waiting == 0) {
     /* noone is waiting for this socket, no need to check select_cb_list */
     SYS_ARCH_UNPROTECT(lev);
@@ -1684,6 +1764,456 @@ again:
   SYS_ARCH_UNPROTECT(lev);
 }
 
+#if LWIP_SOCKET_EPOLL
+/**
+ * Events of interest that are pending on a socket. Called with SYS_ARCH protected.
+ * Errors are always reported, as on Linux.
+ */
+static u32_t
+lwip_epoll_revents(struct lwip_sock *sock, u32_t events)
+{
+  u32_t revents = 0;
+
+  if ((events & LWIP_EPOLLIN) && ((sock->lastdata != NULL) || (sock->rcvevent > 0))) {
+    revents |= LWIP_EPOLLIN;
+  }
+  if ((events & LWIP_EPOLLOUT) && (sock->sendevent != 0)) {
+    revents |= LWIP_EPOLLOUT;
+  }
+  if (sock->errevent != 0) {
+    revents |= LWIP_EPOLLERR;
+  }
+  return revents;
+}
+
+/** Append an item to the ready list of its instance and wake up the waiting
+ * task. Called with SYS_ARCH protected. */
+static void
+lwip_epoll_ready(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  if (item->on_ready) {
+    return;
+  }
+  item->on_ready = 1;
+  item->rdy_next = NULL;
+  item->rdy_prev = ep->rdy_tail;
+  if (ep->rdy_tail != NULL) {
+    ep->rdy_tail->rdy_next = item;
+  } else {
+    ep->rdy_head = item;
+  }
+  ep->rdy_tail = item;
+  ep->rdy_count++;
+
+  if (ep->waiting && !ep->sem_signalled) {
+    ep->sem_signalled = 1;
+    /* signal while still protected, the waiter cannot free the semaphore then */
+    sys_sem_signal(&ep->sem);
+  }
+}
+
+/** Remove an item from the ready list of its instance. Called with SYS_ARCH protected. */
+static void
+lwip_epoll_unready(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  if (!item->on_ready) {
+    return;
+  }
+  if (item->rdy_prev != NULL) {
+    item->rdy_prev->rdy_next = item->rdy_next;
+  } else {
+    ep->rdy_head = item->rdy_next;
+  }
+  if (item->rdy_next != NULL) {
+    item->rdy_next->rdy_prev = item->rdy_prev;
+  } else {
+    ep->rdy_tail = item->rdy_prev;
+  }
+  item->rdy_next = NULL;
+  item->rdy_prev = NULL;
+  item->on_ready = 0;
+  ep->rdy_count--;
+}
+
+/**
+ * Called from event_callback() with SYS_ARCH protected. Only events that can
+ * make a socket ready queue it; a socket that stops being ready is dropped by
+ * lwip_epoll_wait() when it gets there.
+ */
+static void
+lwip_epoll_notify(struct lwip_sock *sock, enum netconn_evt evt)
+{
+  struct lwip_epoll_item *item;
+
+  if ((evt == NETCONN_EVT_RCVMINUS) || (evt == NETCONN_EVT_SENDMINUS)) {
+    return;
+  }
+  for (item = sock->epoll_items; item != NULL; item = item->sock_next) {
+    if (lwip_epoll_revents(sock, item->events) != 0) {
+      lwip_epoll_ready(item);
+    }
+  }
+}
+
+/** Unlink and free an item. Called with SYS_ARCH protected. */
+static void
+lwip_epoll_free_item(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll_item **pp;
+
+  lwip_epoll_unready(item);
+  for (pp = &item->sock->epoll_items; *pp != NULL; pp = &(*pp)->sock_next) {
+    if (*pp == item) {
+      *pp = item->sock_next;
+      break;
+    }
+  }
+  item->sock = NULL;
+  item->sock_next = NULL;
+  item->ep = NULL;
+}
+
+/** Remove a socket that is being closed from all epoll instances */
+static void
+lwip_epoll_sock_closed(struct lwip_sock *sock)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  while (sock->epoll_items != NULL) {
+    lwip_epoll_free_item(sock->epoll_items);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Map an epoll file descriptor to its instance.
+ *
+ * @param epfd epoll file descriptor returned by lwip_epoll_create
+ * @return struct lwip_epoll or NULL (errno set to EBADF) if not open
+ */
+static struct lwip_epoll *
+get_epoll(int epfd)
+{
+  struct lwip_epoll *ep;
+
+  if (!IS_EPOLL_FD(epfd)) {
+    set_errno(EBADF);
+    return NULL;
+  }
+  ep = &epolls[epfd - EPOLL_FD_BASE];
+  if (!ep->used) {
+    set_errno(EBADF);
+    return NULL;
+  }
+  return ep;
+}
+
+/**
+ * Create an epoll instance. Its file descriptor is closed with lwip_close().
+ *
+ * @param size ignored, must be positive as on Linux
+ * @return epoll file descriptor; -1 on error
+ */
+int
+lwip_epoll_create(int size)
+{
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create(%d)\n", size));
+
+  if (size <= 0) {
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  for (i = 0; i < LWIP_SOCKET_EPOLL_MAX; i++) {
+    SYS_ARCH_PROTECT(lev);
+    if (!epolls[i].used) {
+      epolls[i].used = 1;
+      SYS_ARCH_UNPROTECT(lev);
+      epolls[i].rdy_head = NULL;
+      epolls[i].rdy_tail = NULL;
+      epolls[i].rdy_count = 0;
+      epolls[i].waiting = 0;
+      epolls[i].sem_signalled = 0;
+      if (sys_sem_new(&epolls[i].sem, 0) != ERR_OK) {
+        epolls[i].used = 0;
+        set_errno(ENOMEM);
+        return -1;
+      }
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create() = %d\n", EPOLL_FD_BASE + i));
+      set_errno(0);
+      return EPOLL_FD_BASE + i;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  set_errno(EMFILE);
+  return -1;
+}
+
+/** Close an epoll instance and drop its registrations; no task may wait on it */
+static int
+lwip_epoll_close(int epfd)
+{
+  struct lwip_epoll *ep;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  LWIP_ASSERT("lwip_epoll_close: task still waiting", !ep->waiting);
+
+  for (i = 0; i < LWIP_SOCKET_EPOLL_ITEMS; i++) {
+    SYS_ARCH_PROTECT(lev);
+    if (epoll_items[i].ep == ep) {
+      lwip_epoll_free_item(&epoll_items[i]);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  sys_sem_free(&ep->sem);
+  SYS_ARCH_SET(ep->used, 0);
+  set_errno(0);
+  return 0;
+}
+
+/** Find the registration of a socket with an instance. Called with SYS_ARCH protected. */
+static struct lwip_epoll_item *
+lwip_epoll_find(struct lwip_epoll *ep, struct lwip_sock *sock)
+{
+  struct lwip_epoll_item *item;
+
+  for (item = sock->epoll_items; item != NULL; item = item->sock_next) {
+    if (item->ep == ep) {
+      return item;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Add, modify or remove the registration of a socket with an epoll instance.
+ * A socket that is ready when added or modified is reported by the next wait.
+ *
+ * @param epfd epoll file descriptor
+ * @param op LWIP_EPOLL_CTL_ADD, LWIP_EPOLL_CTL_MOD or LWIP_EPOLL_CTL_DEL
+ * @param fd socket
+ * @param event events of interest and user data, ignored for LWIP_EPOLL_CTL_DEL
+ * @return 0 on success; -1 on error
+ */
+int
+lwip_epoll_ctl(int epfd, int op, int fd, struct lwip_epoll_event *event)
+{
+  struct lwip_epoll *ep;
+  struct lwip_sock *sock;
+  struct lwip_epoll_item *item;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_ctl(%d, %d, %d)\n", epfd, op, fd));
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  sock = get_socket(fd);
+  if (sock == NULL) {
+    return -1;
+  }
+  if ((op != LWIP_EPOLL_CTL_DEL) && (event == NULL)) {
+    set_errno(EFAULT);
+    return -1;
+  }
+
+  switch (op) {
+    case LWIP_EPOLL_CTL_ADD:
+      SYS_ARCH_PROTECT(lev);
+      if (lwip_epoll_find(ep, sock) != NULL) {
+        SYS_ARCH_UNPROTECT(lev);
+        set_errno(EEXIST);
+        return -1;
+      }
+      for (i = 0; i < LWIP_SOCKET_EPOLL_ITEMS; i++) {
+        if (epoll_items[i].ep == NULL) {
+          break;
+        }
+      }
+      if (i == LWIP_SOCKET_EPOLL_ITEMS) {
+        SYS_ARCH_UNPROTECT(lev);
+        set_errno(ENOMEM);
+        return -1;
+      }
+      item = &epoll_items[i];
+      item->ep = ep;
+      item->sock = sock;
+      item->fd = fd;
+      item->events = event->events;
+      item->data = event->data;
+      item->on_ready = 0;
+      item->rdy_next = NULL;
+      item->rdy_prev = NULL;
+      item->sock_next = sock->epoll_items;
+      sock->epoll_items = item;
+      if (lwip_epoll_revents(sock, item->events) != 0) {
+        lwip_epoll_ready(item);
+      }
+      SYS_ARCH_UNPROTECT(lev);
+      break;
+
+    case LWIP_EPOLL_CTL_MOD:
+      SYS_ARCH_PROTECT(lev);
+      item = lwip_epoll_find(ep, sock);
+      if (item == NULL) {
+        SYS_ARCH_UNPROTECT(lev);
+        set_errno(ENOENT);
+        return -1;
+      }
+      item->events = event->events;
+      item->data = event->data;
+      if (lwip_epoll_revents(sock, item->events) != 0) {
+        lwip_epoll_ready(item);
+      }
+      SYS_ARCH_UNPROTECT(lev);
+      break;
+
+    case LWIP_EPOLL_CTL_DEL:
+      SYS_ARCH_PROTECT(lev);
+      item = lwip_epoll_find(ep, sock);
+      if (item == NULL) {
+        SYS_ARCH_UNPROTECT(lev);
+        set_errno(ENOENT);
+        return -1;
+      }
+      lwip_epoll_free_item(item);
+      SYS_ARCH_UNPROTECT(lev);
+      break;
+
+    default:
+      set_errno(EINVAL);
+      return -1;
+  }
+
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Take up to maxevents ready sockets off the ready list. Level-triggered
+ * sockets that are still ready go back to the tail, so all of them get a turn;
+ * sockets that are no longer ready are dropped.
+ */
+static int
+lwip_epoll_scan(struct lwip_epoll *ep, struct lwip_epoll_event *events, int maxevents)
+{
+  struct lwip_epoll_item *item;
+  u32_t revents;
+  u16_t todo;
+  int nready = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  /* items re-queued in this pass go behind the others and are not looked at twice */
+  todo = ep->rdy_count;
+  while ((todo-- > 0) && (nready < maxevents) && ((item = ep->rdy_head) != NULL)) {
+    lwip_epoll_unready(item);
+    revents = lwip_epoll_revents(item->sock, item->events);
+    if (revents != 0) {
+      events[nready].events = revents;
+      events[nready].data = item->data;
+      nready++;
+      if (!(item->events & LWIP_EPOLLET)) {
+        /* doesn't signal: the only waiter is this task */
+        lwip_epoll_ready(item);
+      }
+    }
+    /* unlock interrupts with each step, this makes sure interrupt protection time is short */
+    SYS_ARCH_UNPROTECT(lev);
+    SYS_ARCH_PROTECT(lev);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return nready;
+}
+
+/**
+ * Wait for events on the sockets registered with an epoll instance. The cost
+ * depends on the number of ready sockets, not on the number registered.
+ * Only one task may wait on an instance at a time.
+ *
+ * @param epfd epoll file descriptor
+ * @param events array that receives the events and user data
+ * @param maxevents size of events, > 0
+ * @param timeout in ms; 0 polls, -1 waits forever
+ * @return number of entries filled in (0 on timeout); -1 on error
+ */
+int
+lwip_epoll_wait(int epfd, struct lwip_epoll_event *events, int maxevents, int timeout)
+{
+  struct lwip_epoll *ep;
+  u32_t start = 0, elapsed, msectimeout;
+  int nready;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait(%d, %d, %d)\n", epfd, maxevents, timeout));
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  if ((events == NULL) || (maxevents <= 0)) {
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  if (timeout > 0) {
+    start = sys_now();
+  }
+  for (;;) {
+    nready = lwip_epoll_scan(ep, events, maxevents);
+    if ((nready > 0) || (timeout == 0)) {
+      break;
+    }
+    if (timeout > 0) {
+      elapsed = sys_now() - start;
+      if (elapsed >= (u32_t)timeout) {
+        break;
+      }
+      msectimeout = (u32_t)timeout - elapsed;
+    } else {
+      msectimeout = 0; /* wait forever */
+    }
+
+    SYS_ARCH_PROTECT(lev);
+    if (ep->rdy_head != NULL) {
+      /* became ready since the scan */
+      SYS_ARCH_UNPROTECT(lev);
+      continue;
+    }
+    LWIP_ASSERT("lwip_epoll_wait: one task per instance", !ep->waiting);
+    ep->waiting = 1;
+    ep->sem_signalled = 0;
+    SYS_ARCH_UNPROTECT(lev);
+
+    /* a signal left over from a timed out wait only costs one more scan */
+    sys_arch_sem_wait(&ep->sem, msectimeout);
+
+    SYS_ARCH_PROTECT(lev);
+    ep->waiting = 0;
+    SYS_ARCH_UNPROTECT(lev);
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait: nready=%d\n", nready));
+  set_errno(0);
+  return nready;
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
 /**
  * Close one end of a full-duplex connection.
  */
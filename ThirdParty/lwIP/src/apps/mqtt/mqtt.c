@@ -200,18 +200,20 @@ msg_generate_packet_id(mqtt_client_t *client)
  * Try send as many bytes as possible from output ring buffer
  * @param rb Output ring buffer
  * @param tpcb TCP connection handle
+ * @return Number of bytes handed to TCP
  */
-static void
+static u16_t
 mqtt_output_send(struct mqtt_ringbuf_t *rb, struct tcp_pcb *tpcb)
 {
   err_t err;
   u8_t wrap = 0;
   u16_t ringbuf_lin_len = mqtt_ringbuf_linear_read_length(rb);
   u16_t send_len = tcp_sndbuf(tpcb);
+  u16_t sent = 0;
   LWIP_ASSERT("mqtt_output_send: tpcb != NULL", tpcb != NULL);
 
   if (send_len == 0 || ringbuf_lin_len == 0) {
-    return;
+    return 0;
   }
 
   LWIP_DEBUGF(MQTT_DEBUG_TRACE,("mqtt_output_send: tcp_sndbuf: %d bytes, ringbuf_linear_available: %d, get %d, put %d\n",
@@ -226,6 +228,7 @@ mqtt_output_send(struct mqtt_ringbuf_t *rb, struct tcp_pcb *tpcb)
   err = tcp_write(tpcb, mqtt_ringbuf_get_ptr(rb), send_len, TCP_WRITE_FLAG_COPY | (wrap ? TCP_WRITE_FLAG_MORE : 0));
   if ((err == ERR_OK) && wrap) {
     mqtt_ringbuf_advance_get_idx(rb, send_len);
+    sent = send_len;
     /* Use the lesser one of ring buffer linear length and TCP send buffer size */
     send_len = LWIP_MIN(tcp_sndbuf(tpcb), mqtt_ringbuf_linear_read_length(rb));
     err = tcp_write(tpcb, mqtt_ringbuf_get_ptr(rb), send_len, TCP_WRITE_FLAG_COPY);
@@ -233,11 +236,13 @@ mqtt_output_send(struct mqtt_ringbuf_t *rb, struct tcp_pcb *tpcb)
 
   if (err == ERR_OK) {
     mqtt_ringbuf_advance_get_idx(rb, send_len);
+    sent += send_len;
     /* Flush */
     tcp_output(tpcb);
   } else {
     LWIP_DEBUGF(MQTT_DEBUG_WARN, ("mqtt_output_send: Send failed with err %d (\"%s\")\n", err, lwip_strerr(err)));
   }
+  return sent;
 }
 
 
@@ -497,14 +502,270 @@ mqtt_output_check_space(struct mqtt_ringbuf_t *rb, u16_t r_length)
 }
 
 
+/*--------------------------------------------------------------------------------------------------------------------- */
+/* Publish pipeline */
+
+#if MQTT_PUB_PIPELINE
+
+/** Publish pipeline states */
+enum {
+  MQTT_PUB_FREE,
+  /** Waiting to be handed to TCP */
+  MQTT_PUB_QUEUED,
+  /** Handed to TCP, waiting for the TCP ACK (and PUBACK for QoS 1) */
+  MQTT_PUB_SENT
+};
+
+/** Max pbufs tcp_write() may queue for one message besides those of the payload */
+#define MQTT_PUB_HDR_PBUFS 3
+
+/**
+ * Unchain a publish from the pipeline, free its slot and call its callback
+ * @param q Publish pipeline
+ * @param m Publish to remove
+ * @param prev Publish before m, NULL if m is the first
+ * @param err Result passed to the callback
+ */
+static void
+mqtt_pub_finish(struct mqtt_pub_queue_t *q, struct mqtt_pub_t *m, struct mqtt_pub_t *prev, err_t err)
+{
+  mqtt_request_cb_t cb = m->cb;
+  void *arg = m->arg;
+
+  if (prev == NULL) {
+    q->head = m->next;
+  } else {
+    prev->next = m->next;
+  }
+  if (q->tail == m) {
+    q->tail = prev;
+  }
+  pbuf_free(m->p);
+  memset(m, 0, sizeof(struct mqtt_pub_t));
+  /* The callback may publish again, the slot is already free */
+  if (cb != NULL) {
+    cb(arg, err);
+  }
+}
+
+/**
+ * Call back publishes that are done: acknowledged by TCP, and by PUBACK for QoS 1.
+ * TCP does not refer to their payload anymore at that point. QoS 0 publishes copied
+ * into TCP are done once handed over.
+ * @param client MQTT client
+ */
+static void
+mqtt_pub_complete(mqtt_client_t *client)
+{
+  struct mqtt_pub_queue_t *q = &client->pub;
+  struct mqtt_pub_t *m, *prev;
+
+again:
+  prev = NULL;
+  for (m = q->head; m != NULL; prev = m, m = m->next) {
+    if ((m->state == MQTT_PUB_SENT) && (m->copied ||
+        (((m->qos == 0) || m->puback) && ((s32_t)(q->tx_acked - m->end) >= 0)))) {
+      mqtt_pub_finish(q, m, prev, ERR_OK);
+      /* The list may have changed in the callback */
+      goto again;
+    }
+  }
+}
+
+/**
+ * Hand queued publishes to TCP, in order, while the QoS 1 window, the TCP send
+ * buffer and the TCP queue allow whole messages. Header and topic are copied, the
+ * payload is passed by reference, or copied for QoS 0 if mqtt_set_pub_qos0_copy()
+ * is on. One tcp_output() sends the batch.
+ * @param client MQTT client
+ */
+static void
+mqtt_pub_output(mqtt_client_t *client)
+{
+  struct mqtt_pub_queue_t *q = &client->pub;
+  struct tcp_pcb *tpcb = client->conn;
+  struct mqtt_pub_t *m;
+  struct pbuf *p;
+  u8_t hdr[6];
+  u16_t hdr_len, r_length, window, n;
+  u32_t total_len;
+  err_t err = ERR_OK;
+  u8_t written = 0, copied = 0, flags;
+
+  if ((client->conn_state != MQTT_CONNECTED) || (tpcb == NULL) || q->broken ||
+      (mqtt_ringbuf_len(&client->output) != 0)) {
+    /* Messages from the ring buffer go first, they must not be split */
+    return;
+  }
+  window = (q->window != 0) ? q->window : MQTT_PUB_INFLIGHT;
+
+  for (m = q->head; m != NULL; m = m->next) {
+    if (m->state != MQTT_PUB_QUEUED) {
+      continue;
+    }
+    if ((m->qos > 0) && (q->inflight >= window)) {
+      /* Keep the order, later QoS 0 publishes wait as well */
+      break;
+    }
+    r_length = (u16_t)(2 + m->topic_len + (m->qos ? 2 : 0) + m->p->tot_len);
+    /* Fixed header, remaining length, topic length */
+    hdr[0] = (u8_t)((MQTT_MSG_TYPE_PUBLISH << 4) | ((m->dup & 1) << 3) | ((m->qos & 3) << 1) | (m->retain & 1));
+    hdr_len = 1;
+    n = r_length;
+    do {
+      hdr[hdr_len++] = (u8_t)((n & 0x7f) | (n >= 128 ? 0x80 : 0));
+      n >>= 7;
+    } while (n > 0);
+    hdr[hdr_len++] = (u8_t)(m->topic_len >> 8);
+    hdr[hdr_len++] = (u8_t)(m->topic_len & 0xff);
+    total_len = (u32_t)hdr_len + r_length - 2;
+
+    if ((tcp_sndbuf(tpcb) < total_len) ||
+        ((u16_t)(TCP_SND_QUEUELEN - tcp_sndqueuelen(tpcb)) <
+         (u16_t)(MQTT_PUB_HDR_PBUFS + pbuf_clen(m->p) + m->p->tot_len / tcp_mss(tpcb)))) {
+      break;
+    }
+
+    err = tcp_write(tpcb, hdr, hdr_len, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+    if (err == ERR_OK) {
+      err = tcp_write(tpcb, m->topic, m->topic_len, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+    }
+    if ((err == ERR_OK) && (m->qos > 0)) {
+      hdr[0] = (u8_t)(m->pkt_id >> 8);
+      hdr[1] = (u8_t)(m->pkt_id & 0xff);
+      err = tcp_write(tpcb, hdr, 2, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+    }
+    flags = ((m->qos == 0) && q->qos0_copy) ? (TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) : TCP_WRITE_FLAG_MORE;
+    for (p = m->p; (p != NULL) && (err == ERR_OK); p = p->next) {
+      if (p->len > 0) {
+        err = tcp_write(tpcb, p->payload, p->len, flags);
+      }
+    }
+    if (err != ERR_OK) {
+      /* Part of the message is queued in TCP and can't be taken back */
+      LWIP_DEBUGF(MQTT_DEBUG_WARN, ("mqtt_pub_output: Send failed with err %d, closing\n", err));
+      q->broken = 1;
+      break;
+    }
+
+    q->tx_written += total_len;
+    m->end = q->tx_written;
+    m->state = MQTT_PUB_SENT;
+    if (m->qos > 0) {
+      q->inflight++;
+    }
+    if (flags & TCP_WRITE_FLAG_COPY) {
+      m->copied = 1;
+      copied = 1;
+    }
+    written = 1;
+  }
+
+  if (written) {
+    tcp_output(tpcb);
+  }
+  if (copied) {
+    /* Free the slots of copied publishes without waiting for the TCP ACK */
+    mqtt_pub_complete(client);
+  }
+}
+
+/**
+ * PUBACK received, look for a matching publish in the pipeline
+ * @param client MQTT client
+ * @param pkt_id Packet identifier
+ * @return 1 if the publish belongs to the pipeline, 0 if not
+ */
+static u8_t
+mqtt_pub_puback(mqtt_client_t *client, u16_t pkt_id)
+{
+  struct mqtt_pub_queue_t *q = &client->pub;
+  struct mqtt_pub_t *m;
+
+  for (m = q->head; m != NULL; m = m->next) {
+    if ((m->state == MQTT_PUB_SENT) && (m->qos > 0) && (m->pkt_id == pkt_id) && !m->puback) {
+      m->puback = 1;
+      q->inflight--;
+      mqtt_pub_complete(client);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Connection is gone: QoS 0 publishes fail, QoS 1 publishes that are not acknowledged
+ * are queued again for the next connection, with DUP set if they went out before.
+ * @param client MQTT client
+ */
+static void
+mqtt_pub_disconnected(mqtt_client_t *client)
+{
+  struct mqtt_pub_queue_t *q = &client->pub;
+  struct mqtt_pub_t *m, *prev;
+
+  q->inflight = 0;
+  q->broken = 0;
+  /* QoS 1 first, the callbacks of the others may publish again */
+  for (m = q->head; m != NULL; m = m->next) {
+    if ((m->qos > 0) && !m->puback) {
+      if (m->state == MQTT_PUB_SENT) {
+        m->dup = 1;
+      }
+      m->state = MQTT_PUB_QUEUED;
+    }
+  }
+again:
+  prev = NULL;
+  for (m = q->head; m != NULL; prev = m, m = m->next) {
+    if (m->qos == 0) {
+      mqtt_pub_finish(q, m, prev, ERR_CONN);
+      goto again;
+    }
+    if (m->puback) {
+      /* Only the TCP ACK was missing, the server has it */
+      mqtt_pub_finish(q, m, prev, ERR_OK);
+      goto again;
+    }
+  }
+}
+
+#endif /* MQTT_PUB_PIPELINE */
+
+/**
+ * Hand output to TCP: first the ring buffer, then the publish pipeline
+ * @param client MQTT client
+ */
+static void
+mqtt_output_flush(mqtt_client_t *client)
+{
+  if (client->conn == NULL) {
+    return;
+  }
+#if MQTT_PUB_PIPELINE
+  if (client->pub.broken) {
+    /* The stream is corrupt, mqtt_tcp_poll_cb closes the connection */
+    return;
+  }
+  client->pub.tx_written += mqtt_output_send(&client->output, client->conn);
+  mqtt_pub_output(client);
+#else /* MQTT_PUB_PIPELINE */
+  mqtt_output_send(&client->output, client->conn);
+#endif /* MQTT_PUB_PIPELINE */
+}
+
+
 /**
  * Close connection to server
  * @param client MQTT client
  * @param reason Reason for disconnection
+ * @return ERR_ABRT if the pcb was aborted, ERR_OK otherwise
  */
-static void
+static err_t
 mqtt_close(mqtt_client_t *client, mqtt_connection_status_t reason)
 {
+  err_t ret = ERR_OK;
+  u8_t prev_state;
   LWIP_ASSERT("mqtt_close: client != NULL", client != NULL);
 
   /* Bring down TCP connection if not already done */
@@ -513,10 +774,20 @@ mqtt_close(mqtt_client_t *client, mqtt_connection_status_t reason)
     tcp_recv(client->conn, NULL);
     tcp_err(client->conn,  NULL);
     tcp_sent(client->conn, NULL);
-    res = tcp_close(client->conn);
-    if (res != ERR_OK) {
+#if MQTT_PUB_PIPELINE
+    if (client->pub.tx_written != client->pub.tx_acked) {
+      /* TCP still refers to publish payloads that are handed back below */
       tcp_abort(client->conn);
-      LWIP_DEBUGF(MQTT_DEBUG_TRACE,("mqtt_close: Close err=%s\n", lwip_strerr(res)));
+      ret = ERR_ABRT;
+    } else
+#endif /* MQTT_PUB_PIPELINE */
+    {
+      res = tcp_close(client->conn);
+      if (res != ERR_OK) {
+        tcp_abort(client->conn);
+        ret = ERR_ABRT;
+        LWIP_DEBUGF(MQTT_DEBUG_TRACE,("mqtt_close: Close err=%s\n", lwip_strerr(res)));
+      }
     }
     client->conn = NULL;
   }
@@ -526,14 +797,19 @@ mqtt_close(mqtt_client_t *client, mqtt_connection_status_t reason)
   /* Stop cyclic timer */
   sys_untimeout(mqtt_cyclic_timer, client);
 
-  /* Notify upper layer of disconnection if changed state */
-  if (client->conn_state != TCP_DISCONNECTED) {
+  prev_state = client->conn_state;
+  client->conn_state = TCP_DISCONNECTED;
+#if MQTT_PUB_PIPELINE
+  mqtt_pub_disconnected(client);
+#endif /* MQTT_PUB_PIPELINE */
 
-    client->conn_state = TCP_DISCONNECTED;
+  /* Notify upper layer of disconnection if changed state */
+  if (prev_state != TCP_DISCONNECTED) {
     if (client->connect_cb != NULL) {
       client->connect_cb(client, client->connect_arg, reason);
     }
   }
+  return ret;
 }
 
 
@@ -607,7 +883,7 @@ pub_ack_rec_rel_response(mqtt_client_t *client, u8_t msg, u16_t pkt_id, u8_t qos
   if (mqtt_output_check_space(&client->output, 2)) {
     mqtt_output_append_fixed_header(&client->output, msg, 0, qos, 0, 2);
     mqtt_output_append_u16(&client->output, pkt_id);
-    mqtt_output_send(&client->output, client->conn);
+    mqtt_output_flush(client);
   } else {
     LWIP_DEBUGF(MQTT_DEBUG_TRACE,("pub_ack_rec_rel_response: OOM creating response: %s with pkt_id: %d\n",
                                   mqtt_msg_type_to_str(msg), pkt_id));
@@ -661,6 +937,10 @@ static mqtt_connection_status_t
         if (client->connect_cb != 0) {
           client->connect_cb(client, client->connect_arg, res);
         }
+#if MQTT_PUB_PIPELINE
+        /* Publishes left from the last connection and queued while connecting */
+        mqtt_output_flush(client);
+#endif /* MQTT_PUB_PIPELINE */
       }
     } else {
       LWIP_DEBUGF(MQTT_DEBUG_WARN,("mqtt_message_received: Received CONNACK in connected state\n"));
@@ -741,7 +1021,15 @@ static mqtt_connection_status_t
 
     } else if (pkt_type == MQTT_MSG_TYPE_SUBACK || pkt_type == MQTT_MSG_TYPE_UNSUBACK ||
               pkt_type == MQTT_MSG_TYPE_PUBCOMP || pkt_type == MQTT_MSG_TYPE_PUBACK) {
-      struct mqtt_request_t *r = mqtt_take_request(&client->pend_req_queue, pkt_id);
+      struct mqtt_request_t *r;
+#if MQTT_PUB_PIPELINE
+      if ((pkt_type == MQTT_MSG_TYPE_PUBACK) && mqtt_pub_puback(client, pkt_id)) {
+        /* More may fit into the window now */
+        mqtt_output_flush(client);
+        return res;
+      }
+#endif /* MQTT_PUB_PIPELINE */
+      r = mqtt_take_request(&client->pend_req_queue, pkt_id);
       if (r != NULL) {
         LWIP_DEBUGF(MQTT_DEBUG_TRACE,("mqtt_message_received: %s response with id %d\n", mqtt_msg_type_to_str(pkt_type), pkt_id));
         if (pkt_type == MQTT_MSG_TYPE_SUBACK) {
@@ -865,7 +1153,7 @@ mqtt_tcp_recv_cb(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 
   if (p == NULL) {
     LWIP_DEBUGF(MQTT_DEBUG_TRACE,("mqtt_tcp_recv_cb: Recv pbuf=NULL, remote has closed connection\n"));
-    mqtt_close(client, MQTT_CONNECT_DISCONNECTED);
+    return mqtt_close(client, MQTT_CONNECT_DISCONNECTED);
   } else {
     mqtt_connection_status_t res;
     if (err != ERR_OK) {
@@ -880,7 +1168,9 @@ mqtt_tcp_recv_cb(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
     pbuf_free(p);
 
     if (res != MQTT_CONNECT_ACCEPTED) {
-      mqtt_close(client, res);
+      if (mqtt_close(client, res) == ERR_ABRT) {
+        return ERR_ABRT;
+      }
     }
     /* If keep alive functionality is used */
     if (client->keep_alive != 0) {
@@ -908,6 +1198,11 @@ mqtt_tcp_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len)
   LWIP_UNUSED_ARG(tpcb);
   LWIP_UNUSED_ARG(len);
 
+#if MQTT_PUB_PIPELINE
+  client->pub.tx_acked += len;
+  mqtt_pub_complete(client);
+#endif /* MQTT_PUB_PIPELINE */
+
   if (client->conn_state == MQTT_CONNECTED) {
     struct mqtt_request_t *r;
 
@@ -923,7 +1218,7 @@ mqtt_tcp_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len)
       mqtt_delete_request(r);
     }
     /* Try send any remaining buffers from output queue */
-    mqtt_output_send(&client->output, client->conn);
+    mqtt_output_flush(client);
   }
   return ERR_OK;
 }
@@ -955,9 +1250,15 @@ static err_t
 mqtt_tcp_poll_cb(void *arg, struct tcp_pcb *tpcb)
 {
   mqtt_client_t *client = (mqtt_client_t *)arg;
+  LWIP_UNUSED_ARG(tpcb);
+#if MQTT_PUB_PIPELINE
+  if (client->pub.broken) {
+    return mqtt_close(client, MQTT_CONNECT_DISCONNECTED);
+  }
+#endif /* MQTT_PUB_PIPELINE */
   if (client->conn_state == MQTT_CONNECTED) {
     /* Try send any remaining buffers from output queue */
-    mqtt_output_send(&client->output, tpcb);
+    mqtt_output_flush(client);
   }
   return ERR_OK;
 }
@@ -995,7 +1296,7 @@ mqtt_tcp_connect_cb(void *arg, struct tcp_pcb *tpcb, err_t err)
   client->cyclic_tick = 0;
 
   /* Start transmission from output queue, connect message is the first one out*/
-  mqtt_output_send(&client->output, client->conn);
+  mqtt_output_flush(client);
 
   return ERR_OK;
 }
@@ -1080,11 +1381,202 @@ mqtt_publish(mqtt_client_t *client, const char *topic, const void *payload, u16_
   }
 
   mqtt_append_request(&client->pend_req_queue, r);
-  mqtt_output_send(&client->output, client->conn);
+  mqtt_output_flush(client);
   return ERR_OK;
 }
 
 
+#if MQTT_PUB_PIPELINE
+/**
+ * @ingroup mqtt
+ * MQTT publish function for the publish pipeline. The payload is not copied: the
+ * pbuf is referenced until the callback, and the data it points to must not change
+ * until then. Use PBUF_REF pbufs to publish application buffers without copying.
+ * Publishes go out in the order of the calls; QoS 1 publishes not acknowledged when
+ * the connection drops are sent again after the next mqtt_client_connect().
+ * @param client MQTT client
+ * @param topic Publish topic string, referenced until the callback
+ * @param p Payload
+ * @param qos Quality of service, 0 or 1
+ * @param retain MQTT retain flag
+ * @param cb Callback to call when publish is complete (ERR_OK), when the connection
+ *           dropped before a QoS 0 publish was acknowledged by TCP (ERR_CONN) or
+ *           when the publish was discarded (ERR_ABRT). A QoS 0 publish is complete
+ *           when TCP acknowledged it, or when it was copied into TCP if
+ *           mqtt_set_pub_qos0_copy() is on.
+ * @param arg User supplied argument to publish callback
+ * @return ERR_OK if successful
+ *         ERR_CONN if client is disconnected and qos is 0
+ *         ERR_MEM if the pipeline is full
+ */
+err_t
+mqtt_publish_pbuf(mqtt_client_t *client, const char *topic, struct pbuf *p, u8_t qos, u8_t retain,
+                  mqtt_request_cb_t cb, void *arg)
+{
+  struct mqtt_pub_queue_t *q;
+  struct mqtt_pub_t *m = NULL;
+  size_t topic_strlen;
+  size_t total_len;
+  u16_t n;
+
+  LWIP_ASSERT("mqtt_publish_pbuf: client != NULL", client);
+  LWIP_ASSERT("mqtt_publish_pbuf: topic != NULL", topic);
+  LWIP_ASSERT("mqtt_publish_pbuf: p != NULL", p);
+  LWIP_ERROR("mqtt_publish_pbuf: qos 0 or 1", (qos < 2), return ERR_ARG);
+  LWIP_ERROR("mqtt_publish_pbuf: TCP disconnected", (qos > 0) || (client->conn_state != TCP_DISCONNECTED), return ERR_CONN);
+
+  topic_strlen = strlen(topic);
+  LWIP_ERROR("mqtt_publish_pbuf: topic length overflow", (topic_strlen <= (0xFFFF - 2)), return ERR_ARG);
+  total_len = 2 + topic_strlen + (qos ? 2 : 0) + p->tot_len;
+  LWIP_ERROR("mqtt_publish_pbuf: total length overflow", (total_len <= 0xFFFF), return ERR_ARG);
+  /* Whole messages are handed to TCP, fixed header included */
+  LWIP_ERROR("mqtt_publish_pbuf: larger than TCP_SND_BUF", (total_len + 4 <= TCP_SND_BUF), return ERR_ARG);
+
+  q = &client->pub;
+  for (n = 0; n < MQTT_PUB_QUEUE_LEN; n++) {
+    if (q->slots[n].state == MQTT_PUB_FREE) {
+      m = &q->slots[n];
+      break;
+    }
+  }
+  if (m == NULL) {
+    return ERR_MEM;
+  }
+
+  LWIP_DEBUGF(MQTT_DEBUG_TRACE,("mqtt_publish_pbuf: Queue publish with payload length %d to topic \"%s\"\n", p->tot_len, topic));
+
+  m->next = NULL;
+  m->topic = topic;
+  m->topic_len = (u16_t)topic_strlen;
+  m->p = p;
+  pbuf_ref(p);
+  m->cb = cb;
+  m->arg = arg;
+  m->pkt_id = (qos > 0) ? msg_generate_packet_id(client) : 0;
+  m->qos = qos;
+  m->retain = retain;
+  m->dup = 0;
+  m->puback = 0;
+  m->copied = 0;
+  m->state = MQTT_PUB_QUEUED;
+  if (q->tail != NULL) {
+    q->tail->next = m;
+  } else {
+    q->head = m;
+  }
+  q->tail = m;
+
+  mqtt_output_flush(client);
+  return ERR_OK;
+}
+
+/**
+ * @ingroup mqtt
+ * MQTT publish function for the publish pipeline, taking the payload by reference.
+ * The data must stay valid and unchanged until the callback.
+ * @see mqtt_publish_pbuf
+ * @param client MQTT client
+ * @param topic Publish topic string, referenced until the callback
+ * @param payload Data to publish (NULL is allowed)
+ * @param payload_length: Length of payload (0 is allowed)
+ * @param qos Quality of service, 0 or 1
+ * @param retain MQTT retain flag
+ * @param cb Callback to call when publish is complete or failed
+ * @param arg User supplied argument to publish callback
+ * @return ERR_OK if successful, @see mqtt_publish_pbuf
+ */
+err_t
+mqtt_publish_ref(mqtt_client_t *client, const char *topic, const void *payload, u16_t payload_length, u8_t qos,
+                 u8_t retain, mqtt_request_cb_t cb, void *arg)
+{
+  struct pbuf *p;
+  err_t err;
+
+  p = pbuf_alloc(PBUF_RAW, (payload != NULL) ? payload_length : 0, PBUF_REF);
+  if (p == NULL) {
+    return ERR_MEM;
+  }
+  p->payload = LWIP_CONST_CAST(void *, payload);
+  err = mqtt_publish_pbuf(client, topic, p, qos, retain, cb, arg);
+  /* The pipeline holds its own reference */
+  pbuf_free(p);
+  return err;
+}
+
+/**
+ * @ingroup mqtt
+ * Set the number of QoS 1 publishes of the pipeline that may wait for PUBACK
+ * @param client MQTT client
+ * @param window 1 to MQTT_PUB_QUEUE_LEN, 0 for MQTT_PUB_INFLIGHT
+ */
+void
+mqtt_set_pub_window(mqtt_client_t *client, u16_t window)
+{
+  LWIP_ASSERT("mqtt_set_pub_window: client != NULL", client != NULL);
+  client->pub.window = LWIP_MIN(window, MQTT_PUB_QUEUE_LEN);
+  mqtt_output_flush(client);
+}
+
+/**
+ * @ingroup mqtt
+ * Copy the payload of QoS 0 publishes of the pipeline into TCP. Their slot is free
+ * and their callback called as soon as they are handed to TCP, instead of after the
+ * TCP ACK, so a burst of small QoS 0 publishes does not stall on a full pipeline
+ * while the ACK is delayed. QoS 1 publishes are not affected.
+ * @param client MQTT client
+ * @param copy 1 to copy, 0 to pass the payload by reference until the TCP ACK
+ */
+void
+mqtt_set_pub_qos0_copy(mqtt_client_t *client, u8_t copy)
+{
+  LWIP_ASSERT("mqtt_set_pub_qos0_copy: client != NULL", client != NULL);
+  client->pub.qos0_copy = (u8_t)(copy != 0);
+}
+
+/**
+ * @ingroup mqtt
+ * Number of publishes the pipeline can take
+ * @param client MQTT client
+ * @return Free publish slots
+ */
+u16_t
+mqtt_pub_free_slots(mqtt_client_t *client)
+{
+  u16_t n, free_slots = 0;
+  LWIP_ASSERT("mqtt_pub_free_slots: client != NULL", client != NULL);
+  for (n = 0; n < MQTT_PUB_QUEUE_LEN; n++) {
+    if (client->pub.slots[n].state == MQTT_PUB_FREE) {
+      free_slots++;
+    }
+  }
+  return free_slots;
+}
+
+/**
+ * @ingroup mqtt
+ * Drop the publishes of the pipeline that are not handed to TCP yet, including the
+ * QoS 1 publishes waiting for a new connection. Their callbacks get ERR_ABRT.
+ * @param client MQTT client
+ */
+void
+mqtt_pub_discard(mqtt_client_t *client)
+{
+  struct mqtt_pub_queue_t *q;
+  struct mqtt_pub_t *m, *prev;
+  LWIP_ASSERT("mqtt_pub_discard: client != NULL", client != NULL);
+
+  q = &client->pub;
+again:
+  prev = NULL;
+  for (m = q->head; m != NULL; prev = m, m = m->next) {
+    if (m->state == MQTT_PUB_QUEUED) {
+      mqtt_pub_finish(q, m, prev, ERR_ABRT);
+      goto again;
+    }
+  }
+}
+#endif /* MQTT_PUB_PIPELINE */
+
 /**
  * @ingroup mqtt
  * MQTT subscribe/unsubscribe function.
@@ -1147,7 +1639,7 @@ mqtt_sub_unsub(mqtt_client_t *client, const char *topic, u8_t qos, mqtt_request_
   }
 
   mqtt_append_request(&client->pend_req_queue, r);
-  mqtt_output_send(&client->output, client->conn);
+  mqtt_output_flush(client);
   return ERR_OK;
 }
 
@@ -1181,6 +1673,9 @@ mqtt_client_new(void)
   mqtt_client_t *client = (mqtt_client_t *)mem_malloc(sizeof(mqtt_client_t));
   if (client != NULL) {
     memset(client, 0, sizeof(mqtt_client_t));
+#if MQTT_PUB_PIPELINE
+    client->pub.qos0_copy = MQTT_PUB_QOS0_COPY;
+#endif /* MQTT_PUB_PIPELINE */
   }
   return client;
 }
@@ -1207,6 +1702,9 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
   /* Length is the sum of 2+"MQTT", protocol level, flags and keep alive */
   u16_t remaining_length = 2 + 4 + 1 + 1 + 2;
   u8_t flags = 0, will_topic_len = 0, will_msg_len = 0;
+#if MQTT_PUB_PIPELINE
+  u16_t pkt_id_seq;
+#endif /* MQTT_PUB_PIPELINE */
 
   LWIP_ASSERT("mqtt_client_connect: client != NULL", client != NULL);
   LWIP_ASSERT("mqtt_client_connect: ip_addr != NULL", ip_addr != NULL);
@@ -1218,8 +1716,20 @@ mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ip_addr, u16_t port,
     return ERR_ISCONN;
   }
 
+#if MQTT_PUB_PIPELINE
+  /* Wipe clean, except for the publish pipeline. Keep the packet identifiers unique
+     while QoS 1 publishes wait to be sent again. */
+  pkt_id_seq = client->pkt_id_seq;
+  memset(client, 0, offsetof(mqtt_client_t, pub));
+  client->pkt_id_seq = pkt_id_seq;
+  client->pub.tx_written = 0;
+  client->pub.tx_acked = 0;
+  client->pub.inflight = 0;
+  client->pub.broken = 0;
+#else /* MQTT_PUB_PIPELINE */
   /* Wipe clean */
   memset(client, 0, sizeof(mqtt_client_t));
+#endif /* MQTT_PUB_PIPELINE */
   client->connect_arg = arg;
   client->connect_cb = cb;
   client->keep_alive = client_info->keep_alive;
@@ -220,6 +220,135 @@ memp_overflow_check_all(void)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 #endif /* MEMP_OVERFLOW_CHECK */
 
+#if MEMP_LOCKFREE
+/* Layout of memp_lf::head: the low half holds the index + 1 of the first free
+ * element, the high half a tag that changes on every update. */
+#define MEMP_LF_INDEX_MASK  0x0000ffffUL
+#define MEMP_LF_TAG_INC     0x00010000UL
+#define MEMP_LF_NEXT_HEAD(old, index) ((((old) + MEMP_LF_TAG_INC) & ~MEMP_LF_INDEX_MASK) | (index))
+
+#if defined(__CC_ARM) || defined(__ICCARM__)
+#if defined(__ICCARM__)
+#include <intrinsics.h>
+#define memp_lf_ldrex(p)      __LDREX((unsigned long *)(p))
+#define memp_lf_strex(v, p)   __STREX((v), (unsigned long *)(p))
+#define memp_lf_clrex()       __CLREX()
+#else
+#define memp_lf_ldrex(p)      __ldrex(p)
+#define memp_lf_strex(v, p)   __strex((v), (p))
+#define memp_lf_clrex()       __clrex()
+#endif
+
+/**
+ * Atomically replace *p by desired if it still equals expected.
+ * Exception entry and return clear the exclusive monitor, so an interrupt
+ * touching the list between LDREX and STREX makes the store fail.
+ */
+static int
+memp_lf_cas(volatile u32_t *p, u32_t expected, u32_t desired)
+{
+  do {
+    if (memp_lf_ldrex(p) != expected) {
+      memp_lf_clrex();
+      return 0;
+    }
+  } while (memp_lf_strex(desired, p) != 0);
+  return 1;
+}
+#else /* __CC_ARM || __ICCARM__ */
+/**
+ * Atomically replace *p by desired if it still equals expected.
+ * GCC and clang emit an LDREX/STREX loop for this on Cortex-M.
+ */
+static int
+memp_lf_cas(volatile u32_t *p, u32_t expected, u32_t desired)
+{
+  return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+#endif /* __CC_ARM || __ICCARM__ */
+
+/** Atomically add delta to *p and return the new value */
+static u32_t
+memp_lf_add(volatile u32_t *p, u32_t delta)
+{
+  u32_t old;
+  do {
+    old = *p;
+  } while (!memp_lf_cas(p, old, old + delta));
+  return old + delta;
+}
+
+/** Account one allocation (delta 1) or free (delta -1) in the pool counters */
+static void
+memp_lf_account(const struct memp_desc *desc, u32_t delta)
+{
+  struct memp_lf *lf = desc->lf;
+  u32_t used, max;
+
+  used = memp_lf_add(&lf->used, delta);
+  if (delta == 1) {
+    do {
+      max = lf->max;
+    } while ((used > max) && !memp_lf_cas(&lf->max, max, used));
+  }
+#if MEMP_STATS
+  /* plain stores of atomically maintained values: a stale value written by a
+   * preempted context is corrected by the next allocation or free */
+  desc->stats->used = (mem_size_t)used;
+  desc->stats->max = (mem_size_t)lf->max;
+#endif /* MEMP_STATS */
+}
+
+/** Element index in the pool memory to element address */
+static struct memp *
+memp_lf_element(const struct memp_desc *desc, u32_t index)
+{
+  return (struct memp *)(void *)((u8_t *)LWIP_MEM_ALIGN(desc->base) + index * (MEMP_SIZE + MEMP_ALIGN_SIZE(desc->size)));
+}
+
+/** Pop the first free element, NULL if the pool is empty */
+static struct memp *
+memp_lf_pop(const struct memp_desc *desc)
+{
+  struct memp_lf *lf = desc->lf;
+  struct memp *memp;
+  u32_t old, next;
+
+  for (;;) {
+    old = lf->head;
+    if ((old & MEMP_LF_INDEX_MASK) == 0) {
+      return NULL;
+    }
+    memp = memp_lf_element(desc, (old & MEMP_LF_INDEX_MASK) - 1);
+    /* may read an element that was just taken by a preempting context; the
+     * tag in the head then changed as well and the CAS below fails */
+    next = *(volatile u32_t *)(void *)memp;
+    if (memp_lf_cas(&lf->head, old, MEMP_LF_NEXT_HEAD(old, next & MEMP_LF_INDEX_MASK))) {
+      return memp;
+    }
+    memp_lf_add(&lf->contention, 1);
+  }
+}
+
+/** Push an element back onto the free list */
+static void
+memp_lf_push(const struct memp_desc *desc, struct memp *memp)
+{
+  struct memp_lf *lf = desc->lf;
+  u32_t old, index;
+
+  index = (u32_t)(((u8_t *)memp - (u8_t *)LWIP_MEM_ALIGN(desc->base)) / (MEMP_SIZE + MEMP_ALIGN_SIZE(desc->size))) + 1;
+  for (;;) {
+    old = lf->head;
+    *(volatile u32_t *)(void *)memp = old & MEMP_LF_INDEX_MASK;
+    if (memp_lf_cas(&lf->head, old, MEMP_LF_NEXT_HEAD(old, index))) {
+      return;
+    }
+    memp_lf_add(&lf->contention, 1);
+  }
+}
+#endif /* MEMP_LOCKFREE */
+
 /**
  * Initialize custom memory pool.
  * Related functions: memp_malloc_pool, memp_free_pool
@@ -231,6 +360,24 @@ memp_init_pool(const struct memp_desc *desc)
 {
 #if MEMP_MEM_MALLOC
   LWIP_UNUSED_ARG(desc);
+#elif MEMP_LOCKFREE
+  u16_t i;
+
+  LWIP_ASSERT("memp_init_pool: too many elements for MEMP_LOCKFREE", desc->num < MEMP_LF_INDEX_MASK);
+  LWIP_ASSERT("memp_init_pool: element too small for MEMP_LOCKFREE", desc->size >= sizeof(u32_t));
+
+  /* chain the elements by index: element i links to element i + 1 */
+  for (i = 0; i < desc->num; ++i) {
+    *(u32_t *)(void *)memp_lf_element(desc, i) = (u32_t)(i + 1 < desc->num ? i + 2 : 0);
+  }
+  desc->lf->head = (desc->num > 0) ? 1 : 0;
+  desc->lf->contention = 0;
+  desc->lf->used = 0;
+  desc->lf->max = 0;
+  desc->lf->err = 0;
+#if MEMP_STATS
+  desc->stats->avail = desc->num;
+#endif /* MEMP_STATS */
 #else
   int i;
   struct memp *memp;
@@ -287,6 +434,27 @@ memp_init(void)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 }
 
+#if MEMP_LOCKFREE
+static void*
+do_memp_malloc_pool(const struct memp_desc *desc)
+{
+  struct memp *memp = memp_lf_pop(desc);
+
+  if (memp != NULL) {
+    memp_lf_account(desc, 1);
+    LWIP_ASSERT("memp_malloc: memp properly aligned",
+                ((mem_ptr_t)memp % MEM_ALIGNMENT) == 0);
+    return ((u8_t*)memp + MEMP_SIZE);
+  }
+
+  LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: out of memory in pool %s\n", desc->desc));
+  memp_lf_add(&desc->lf->err, 1);
+#if MEMP_STATS
+  desc->stats->err = (STAT_COUNTER)desc->lf->err;
+#endif
+  return NULL;
+}
+#else /* MEMP_LOCKFREE */
 static void*
 #if !MEMP_OVERFLOW_CHECK
 do_memp_malloc_pool(const struct memp_desc *desc)
@@ -346,6 +514,7 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char* file, const int
   SYS_ARCH_UNPROTECT(old_level);
   return NULL;
 }
+#endif /* MEMP_LOCKFREE */
 
 /**
  * Get an element from a custom pool.
@@ -403,6 +572,19 @@ memp_malloc_fn(memp_t type, const char* file, const int line)
   return memp;
 }
 
+#if MEMP_LOCKFREE
+static void
+do_memp_free_pool(const struct memp_desc* desc, void *mem)
+{
+  LWIP_ASSERT("memp_free: mem properly aligned",
+                ((mem_ptr_t)mem % MEM_ALIGNMENT) == 0);
+
+  /* account before the push: once the element is on the list another
+   * context may take it and count it again, and used would exceed num */
+  memp_lf_account(desc, (u32_t)-1);
+  memp_lf_push(desc, (struct memp *)(void *)((u8_t*)mem - MEMP_SIZE));
+}
+#else /* MEMP_LOCKFREE */
 static void
 do_memp_free_pool(const struct memp_desc* desc, void *mem)
 {
@@ -441,6 +623,7 @@ do_memp_free_pool(const struct memp_desc* desc, void *mem)
   SYS_ARCH_UNPROTECT(old_level);
 #endif /* !MEMP_MEM_MALLOC */
 }
+#endif /* MEMP_LOCKFREE */
 
 /**
  * Put a custom pool element back into its pool.
@@ -469,7 +652,11 @@ void
 memp_free(memp_t type, void *mem)
 {
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
+#if MEMP_LOCKFREE
+  u32_t old_first;
+#else
   struct memp *old_first;
+#endif
 #endif
 
   LWIP_ERROR("memp_free: type < MEMP_MAX", (type < MEMP_MAX), return;);
@@ -483,13 +670,17 @@ memp_free(memp_t type, void *mem)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
+#if MEMP_LOCKFREE
+  old_first = memp_pools[type]->lf->head & MEMP_LF_INDEX_MASK;
+#else
   old_first = *memp_pools[type]->tab;
+#endif
 #endif
 
   do_memp_free_pool(memp_pools[type], mem);
 
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
-  if (old_first == NULL) {
+  if (old_first == 0) {
     LWIP_HOOK_MEMP_AVAILABLE(type);
   }
 #endif
@@ -173,6 +173,59 @@ struct mqtt_ringbuf_t {
   u8_t buf[MQTT_OUTPUT_RINGBUF_SIZE];
 };
 
+#if MQTT_PUB_PIPELINE
+struct pbuf;
+
+/** Publish in the pipeline */
+struct mqtt_pub_t
+{
+  /** Next publish in order of mqtt_publish_pbuf() calls */
+  struct mqtt_pub_t *next;
+  /** Topic, referenced until the callback */
+  const char *topic;
+  /** Payload, referenced until the callback */
+  struct pbuf *p;
+  /** Callback to upper layer */
+  mqtt_request_cb_t cb;
+  void *arg;
+  /** Stream offset after the last byte of the message once handed to TCP */
+  u32_t end;
+  /** MQTT packet identifier, 0 for QoS 0 */
+  u16_t pkt_id;
+  u16_t topic_len;
+  /** Free, queued or sent */
+  u8_t state;
+  u8_t qos;
+  u8_t retain;
+  /** Sent before on an earlier connection */
+  u8_t dup;
+  /** PUBACK received */
+  u8_t puback;
+  /** QoS 0 payload copied into TCP, done once handed over */
+  u8_t copied;
+};
+
+/** Publish pipeline of a client, kept over reconnects */
+struct mqtt_pub_queue_t
+{
+  /** Publishes in use, oldest first */
+  struct mqtt_pub_t *head;
+  struct mqtt_pub_t *tail;
+  /** Bytes handed to TCP and acknowledged by TCP on this connection */
+  u32_t tx_written;
+  u32_t tx_acked;
+  /** QoS 1 publishes sent and waiting for PUBACK */
+  u16_t inflight;
+  /** Limit for inflight, 0 for MQTT_PUB_INFLIGHT */
+  u16_t window;
+  /** A message could only partly be handed to TCP, the connection must go */
+  u8_t broken;
+  /** Copy QoS 0 payloads into TCP, see mqtt_set_pub_qos0_copy() */
+  u8_t qos0_copy;
+  struct mqtt_pub_t slots[MQTT_PUB_QUEUE_LEN];
+};
+#endif /* MQTT_PUB_PIPELINE */
+
 /** MQTT client */
 struct mqtt_client_t
 {
@@ -202,6 +255,10 @@ struct mqtt_client_t
   u8_t rx_buffer[MQTT_VAR_HEADER_BUFFER_LEN];
   /** Output ring-buffer */
   struct mqtt_ringbuf_t output;
+#if MQTT_PUB_PIPELINE
+  /** Publish pipeline, must be the last member as mqtt_client_connect() keeps it */
+  struct mqtt_pub_queue_t pub;
+#endif /* MQTT_PUB_PIPELINE */
 };
 
 
@@ -237,6 +294,28 @@ err_t mqtt_sub_unsub(mqtt_client_t *client, const char *topic, u8_t qos, mqtt_re
 err_t mqtt_publish(mqtt_client_t *client, const char *topic, const void *payload, u16_t payload_length, u8_t qos, u8_t retain,
                                     mqtt_request_cb_t cb, void *arg);
 
+#if MQTT_PUB_PIPELINE
+/** Publish a pbuf chain without copying it, QoS 0 or 1 */
+err_t mqtt_publish_pbuf(mqtt_client_t *client, const char *topic, struct pbuf *p, u8_t qos, u8_t retain,
+                        mqtt_request_cb_t cb, void *arg);
+
+/** Publish data by reference, QoS 0 or 1 */
+err_t mqtt_publish_ref(mqtt_client_t *client, const char *topic, const void *payload, u16_t payload_length, u8_t qos,
+                       u8_t retain, mqtt_request_cb_t cb, void *arg);
+
+/** Set the number of QoS 1 publishes that may wait for PUBACK */
+void mqtt_set_pub_window(mqtt_client_t *client, u16_t window);
+
+/** Copy QoS 0 payloads into TCP and free their slot at once */
+void mqtt_set_pub_qos0_copy(mqtt_client_t *client, u8_t copy);
+
+/** Number of publishes the pipeline can take */
+u16_t mqtt_pub_free_slots(mqtt_client_t *client);
+
+/** Drop publishes not yet handed to TCP */
+void mqtt_pub_discard(mqtt_client_t *client);
+#endif /* MQTT_PUB_PIPELINE */
+
 #ifdef __cplusplus
 }
 #endif
@@ -92,6 +92,42 @@ extern "C" {
 #define MQTT_CONNECT_TIMOUT 100
 #endif
 
+/**
+ * Enable the publish pipeline: mqtt_publish_pbuf() and mqtt_publish_ref() queue
+ * the payload by reference and hand it to TCP without copying, several queued
+ * publishes go out in one segment, and QoS 1 publishes that are not acknowledged
+ * when the connection drops are sent again (DUP set) after the next connect.
+ */
+#ifndef MQTT_PUB_PIPELINE
+#define MQTT_PUB_PIPELINE 0
+#endif
+
+/**
+ * Number of publishes each client can hold in the pipeline, queued or waiting
+ * for their acknowledgement. QoS 0 publishes wait for the TCP ACK, which the
+ * server may delay, unless MQTT_PUB_QOS0_COPY is on.
+ */
+#ifndef MQTT_PUB_QUEUE_LEN
+#define MQTT_PUB_QUEUE_LEN 16
+#endif
+
+/**
+ * Default number of QoS 1 publishes sent and not yet acknowledged by PUBACK,
+ * change at runtime with mqtt_set_pub_window(). At most MQTT_PUB_QUEUE_LEN.
+ */
+#ifndef MQTT_PUB_INFLIGHT
+#define MQTT_PUB_INFLIGHT 8
+#endif
+
+/**
+ * Default of mqtt_set_pub_qos0_copy() for clients from mqtt_client_new(): 1 copies
+ * the payload of QoS 0 publishes into TCP and frees their slot when handed to TCP,
+ * 0 references the payload and holds the slot until the TCP ACK.
+ */
+#ifndef MQTT_PUB_QOS0_COPY
+#define MQTT_PUB_QOS0_COPY 0
+#endif
+
 /**
  * @}
  */
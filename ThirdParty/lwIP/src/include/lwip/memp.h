@@ -78,6 +78,12 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
 
 #else /* MEMP_MEM_MALLOC */
 
+#if MEMP_LOCKFREE
+#define LWIP_MEMPOOL_DECLARE_TAB(tab) static struct memp_lf tab;
+#else
+#define LWIP_MEMPOOL_DECLARE_TAB(tab) static struct memp *tab;
+#endif
+
 /**
  * @ingroup mempool
  * Declare a private memory pool
@@ -97,7 +103,7 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
     \
   LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(memp_stats_ ## name) \
     \
-  static struct memp *memp_tab_ ## name; \
+  LWIP_MEMPOOL_DECLARE_TAB(memp_tab_ ## name) \
     \
   const struct memp_desc memp_ ## name = { \
     DECLARE_LWIP_MEMPOOL_DESC(desc) \
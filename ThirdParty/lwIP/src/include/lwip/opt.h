@@ -277,6 +277,20 @@
 #define MEMP_SANITY_CHECK               0
 #endif
 
+/**
+ * MEMP_LOCKFREE==1: keep the free elements of every pool on a lock-free LIFO
+ * instead of a list protected by SYS_ARCH_PROTECT. memp_malloc() and memp_free()
+ * then never mask interrupts, so PBUF_POOL allocation and freeing from a netif
+ * RX/TX interrupt does not add to the interrupt latency of the system.
+ * Uses LDREX/STREX on ARM compilers without GCC-style atomic builtins and the
+ * __atomic builtins otherwise (including on hosts for testing).
+ * Requires MEMP_MEM_MALLOC==0, MEMP_OVERFLOW_CHECK==0 and MEMP_SANITY_CHECK==0.
+ * Per-pool contention and high-water counters are kept in memp_desc::lf.
+ */
+#if !defined MEMP_LOCKFREE || defined __DOXYGEN__
+#define MEMP_LOCKFREE                   0
+#endif
+
 /**
  * MEM_USE_POOLS==1: Use an alternative to malloc() by allocating from a set
  * of memory pools of various sizes. When mem_malloc is called, an element of
@@ -1770,6 +1784,33 @@
 #define LWIP_SOCKET_OFFSET              0
 #endif
 
+/**
+ * LWIP_SOCKET_EPOLL==1: Enable lwip_epoll_create(), lwip_epoll_ctl() and
+ * lwip_epoll_wait(). Interest is registered once per socket, event_callback()
+ * appends ready sockets to a per-instance list and wakes the waiting task, so
+ * the cost of a wait does not grow with the number of watched sockets.
+ * Epoll file descriptors follow the socket range and are closed with lwip_close().
+ */
+#if !defined LWIP_SOCKET_EPOLL || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL               0
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL_MAX: The number of epoll instances that can be open at
+ * the same time. Each one holds a semaphore.
+ */
+#if !defined LWIP_SOCKET_EPOLL_MAX || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL_MAX           2
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL_ITEMS: The number of socket registrations shared by all
+ * epoll instances. Default is one per socket.
+ */
+#if !defined LWIP_SOCKET_EPOLL_ITEMS || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL_ITEMS         MEMP_NUM_NETCONN
+#endif
+
 /**
  * LWIP_TCP_KEEPALIVE==1: Enable TCP_KEEPIDLE, TCP_KEEPINTVL and TCP_KEEPCNT
  * options processing. Note that TCP_KEEPIDLE and TCP_KEEPINTVL have to be set
@@ -87,6 +87,29 @@ extern "C" {
 
 #endif /* MEMP_OVERFLOW_CHECK */
 
+#if MEMP_LOCKFREE
+#if MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK || MEMP_SANITY_CHECK
+#error "MEMP_LOCKFREE requires MEMP_MEM_MALLOC, MEMP_OVERFLOW_CHECK and MEMP_SANITY_CHECK to be 0"
+#endif
+
+/** Free list head and counters of a pool when MEMP_LOCKFREE is enabled.
+ * Free elements are linked by index instead of by pointer so that the head
+ * fits into one 32 bit word together with a tag that is incremented on every
+ * change (to detect ABA when a CAS instead of LDREX/STREX is used). */
+struct memp_lf {
+  /** (tag << 16) | (index of the first free element + 1), index part 0 when empty */
+  volatile u32_t head;
+  /** Number of times an allocation or free had to retry because another context changed the list */
+  volatile u32_t contention;
+  /** Number of elements currently allocated */
+  volatile u32_t used;
+  /** High-water mark of used */
+  volatile u32_t max;
+  /** Number of allocations that failed because the pool was empty */
+  volatile u32_t err;
+};
+#endif /* MEMP_LOCKFREE */
+
 #if !MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK
 struct memp {
   struct memp *next;
@@ -147,8 +170,13 @@ struct memp_desc {
   /** Base address */
   u8_t *base;
 
+#if MEMP_LOCKFREE
+  /** Lock-free free list of the pool and its counters */
+  struct memp_lf *lf;
+#else /* MEMP_LOCKFREE */
   /** First free element of each pool. Elements form a linked list. */
   struct memp **tab;
+#endif /* MEMP_LOCKFREE */
 #endif /* MEMP_MEM_MALLOC */
 };
 
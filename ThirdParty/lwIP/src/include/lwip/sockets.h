@@ -443,6 +443,31 @@ struct timeval {
 };
 #endif /* LWIP_TIMEVAL_PRIVATE */
 
+#if LWIP_SOCKET_EPOLL
+/* Event flags for lwip_epoll_ctl/lwip_epoll_wait, same values as Linux */
+#define LWIP_EPOLLIN        0x001U
+#define LWIP_EPOLLOUT       0x004U
+#define LWIP_EPOLLERR       0x008U
+/* Report a socket once per event that makes it ready instead of while it is ready */
+#define LWIP_EPOLLET        0x80000000U
+
+/* Operations for lwip_epoll_ctl */
+#define LWIP_EPOLL_CTL_ADD  1
+#define LWIP_EPOLL_CTL_DEL  2
+#define LWIP_EPOLL_CTL_MOD  3
+
+typedef union lwip_epoll_data {
+  void *ptr;
+  int fd;
+  u32_t u32;
+} lwip_epoll_data_t;
+
+struct lwip_epoll_event {
+  u32_t events;
+  lwip_epoll_data_t data;
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
 #define lwip_socket_init() /* Compatibility define, no init needed. */
 void lwip_socket_thread_init(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: initialize thread-local semaphore */
 void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destroy thread-local semaphore */
@@ -467,6 +492,11 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #define lwip_socket       socket
 #define lwip_select       select
 #define lwip_ioctlsocket  ioctl
+#if LWIP_SOCKET_EPOLL
+#define lwip_epoll_create epoll_create
+#define lwip_epoll_ctl    epoll_ctl
+#define lwip_epoll_wait   epoll_wait
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_POSIX_SOCKETS_IO_NAMES
 #define lwip_read         read
@@ -505,6 +535,11 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
                 struct timeval *timeout);
 int lwip_ioctl(int s, long cmd, void *argp);
 int lwip_fcntl(int s, int cmd, int val);
+#if LWIP_SOCKET_EPOLL
+int lwip_epoll_create(int size);
+int lwip_epoll_ctl(int epfd, int op, int fd, struct lwip_epoll_event *event);
+int lwip_epoll_wait(int epfd, struct lwip_epoll_event *events, int maxevents, int timeout);
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_COMPAT_SOCKETS
 #if LWIP_COMPAT_SOCKETS != 2
@@ -544,6 +579,14 @@ int lwip_fcntl(int s, int cmd, int val);
 #define select(maxfdp1,readset,writeset,exceptset,timeout)     lwip_select(maxfdp1,readset,writeset,exceptset,timeout)
 /** @ingroup socket */
 #define ioctlsocket(s,cmd,argp)                   lwip_ioctl(s,cmd,argp)
+#if LWIP_SOCKET_EPOLL
+/** @ingroup socket */
+#define epoll_create(size)                        lwip_epoll_create(size)
+/** @ingroup socket */
+#define epoll_ctl(epfd,op,fd,event)               lwip_epoll_ctl(epfd,op,fd,event)
+/** @ingroup socket */
+#define epoll_wait(epfd,events,maxevents,timeout) lwip_epoll_wait(epfd,events,maxevents,timeout)
+#endif /* LWIP_SOCKET_EPOLL */
 
 #if LWIP_POSIX_SOCKETS_IO_NAMES
 /** @ingroup socket */
@@ -561,6 +604,18 @@ int lwip_fcntl(int s, int cmd, int val);
 #endif /* LWIP_POSIX_SOCKETS_IO_NAMES */
 #endif /* LWIP_COMPAT_SOCKETS != 2 */
 
+#if LWIP_SOCKET_EPOLL
+#define EPOLLIN         LWIP_EPOLLIN
+#define EPOLLOUT        LWIP_EPOLLOUT
+#define EPOLLERR        LWIP_EPOLLERR
+#define EPOLLET         LWIP_EPOLLET
+#define EPOLL_CTL_ADD   LWIP_EPOLL_CTL_ADD
+#define EPOLL_CTL_DEL   LWIP_EPOLL_CTL_DEL
+#define EPOLL_CTL_MOD   LWIP_EPOLL_CTL_MOD
+#define epoll_event     lwip_epoll_event
+#define epoll_data_t    lwip_epoll_data_t
+#endif /* LWIP_SOCKET_EPOLL */
+
 #if LWIP_IPV4 && LWIP_IPV6
 /** @ingroup socket */
 #define inet_ntop(af,src,dst,size) \
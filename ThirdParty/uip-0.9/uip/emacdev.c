@@ -0,0 +1,152 @@
+/**************************************************************************//**
+ * @file     emacdev.c
+ * @version  V1.00
+ * @brief    uIP network device layer for M480 EMAC
+ *
+ * uip_buf is a pointer (UIP_BUFPTR) to one EMAC frame buffer owned by uIP.
+ * emacdev_read() gives that buffer to the Rx descriptor of the next received
+ * frame and takes the frame's buffer in exchange, and emacdev_send() does the
+ * same with a free Tx descriptor, so frames are never copied between uip_buf
+ * and the EMAC buffers. The only copy left is application data that uIP sends
+ * from outside uip_buf (e.g. httpd file data in flash), which is moved behind
+ * the headers once.
+ *
+ * emacdev_poll() drains up to a given number of frames from the Rx ring per
+ * call, running uIP and sending its reply for each, instead of one frame per
+ * main loop pass.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "uip.h"
+#include "uip_arp.h"
+#include "emacdev.h"
+
+#define BUF ((struct uip_eth_hdr *)&uip_buf[0])
+
+/* The buffer uIP starts with; from then on uip_buf is always an EMAC frame buffer */
+static uint32_t s_au32Spare[EMAC_FRAME_SIZE / 4];
+
+struct emacdev_stats emacdev_stats;
+
+void emacdev_init(void)
+{
+    uip_buf = (u8_t *)s_au32Spare;
+    memset(&emacdev_stats, 0, sizeof(emacdev_stats));
+}
+
+/**
+ * Takes the next received frame into uip_buf.
+ *
+ * \return Frame length, or 0 if no frame is waiting
+ */
+u16_t emacdev_read(void)
+{
+    uint8_t *pu8Pkt;
+    uint32_t u32Len;
+
+    pu8Pkt = EMAC_RecvPktSwap(uip_buf, &u32Len);
+    if(pu8Pkt == NULL)
+        return 0;
+
+    uip_buf = pu8Pkt;
+    emacdev_stats.rx++;
+    return (u16_t)u32Len;
+}
+
+/**
+ * Sends uip_len bytes of uip_buf. The frame is dropped if all Tx descriptors
+ * are busy, as EMAC_SendPkt() does; uIP retransmits TCP data.
+ */
+void emacdev_send(void)
+{
+    uint8_t *pu8Free;
+    u8_t *pu8Hdr = &uip_buf[40 + UIP_LLH_LEN];
+
+    if((uip_len > 40 + UIP_LLH_LEN) && (uip_appdata != pu8Hdr))
+    {
+        /* memmove, the data may also sit elsewhere in uip_buf */
+        memmove(pu8Hdr, (const void *)uip_appdata, uip_len - 40 - UIP_LLH_LEN);
+        emacdev_stats.copied += uip_len - 40 - UIP_LLH_LEN;
+    }
+
+    pu8Free = EMAC_SendPktSwap(uip_buf, uip_len);
+    if(pu8Free == NULL)
+    {
+        emacdev_stats.tx_drop++;
+        return;
+    }
+
+    uip_buf = pu8Free;
+    emacdev_stats.tx++;
+}
+
+/**
+ * Runs uIP on up to u32Max received frames and sends what it replies.
+ *
+ * \return Number of frames taken from the Rx descriptors, 0 if none was waiting
+ */
+uint32_t emacdev_poll(uint32_t u32Max)
+{
+    uint32_t i;
+
+    for(i = 0; i < u32Max; i++)
+    {
+        uip_len = emacdev_read();
+        if(uip_len == 0)
+            break;
+
+        if(BUF->type == htons(UIP_ETHTYPE_IP))
+        {
+            uip_arp_ipin();
+            uip_input();
+            /* If the above function invocation resulted in data that
+               should be sent out on the network, the global variable
+               uip_len is set to a value > 0. */
+            if(uip_len > 0)
+            {
+                uip_arp_out();
+                emacdev_send();
+            }
+        }
+        else if(BUF->type == htons(UIP_ETHTYPE_ARP))
+        {
+            uip_arp_arpin();
+            if(uip_len > 0)
+                emacdev_send();
+        }
+    }
+    return i;
+}
+
+/**
+ * Runs the uIP periodic timer on every connection. Call it every 0.5 seconds;
+ * the ARP timer (uip_arp_timer()) is left to the application.
+ */
+void emacdev_periodic(void)
+{
+    u8_t i;
+
+    for(i = 0; i < UIP_CONNS; i++)
+    {
+        uip_periodic(i);
+        if(uip_len > 0)
+        {
+            uip_arp_out();
+            emacdev_send();
+        }
+    }
+
+#if UIP_UDP
+    for(i = 0; i < UIP_UDP_CONNS; i++)
+    {
+        uip_udp_periodic(i);
+        if(uip_len > 0)
+        {
+            uip_arp_out();
+            emacdev_send();
+        }
+    }
+#endif /* UIP_UDP */
+}
@@ -0,0 +1,41 @@
+/**************************************************************************//**
+ * @file     emacdev.h
+ * @version  V1.00
+ * @brief    uIP network device layer for M480 EMAC header file
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __EMACDEV_H__
+#define __EMACDEV_H__
+
+#include "NuMicro.h"
+#include "uip.h"
+
+#if !UIP_BUFPTR
+#error "emacdev needs UIP_BUFPTR set in uipopt.h"
+#endif
+
+/**
+ * Default number of frames emacdev_poll() handles before it returns,
+ * one Rx descriptor ring.
+ */
+#define EMACDEV_BATCH   EMAC_RX_DESC_SIZE
+
+/** Device layer counters */
+struct emacdev_stats
+{
+    uint32_t rx;        /*!< Frames taken from the Rx descriptors */
+    uint32_t tx;        /*!< Frames handed to the Tx descriptors */
+    uint32_t tx_drop;   /*!< Frames dropped because no Tx descriptor was free */
+    uint32_t copied;    /*!< Application data bytes copied into uip_buf before sending */
+};
+
+extern struct emacdev_stats emacdev_stats;
+
+void emacdev_init(void);
+u16_t emacdev_read(void);
+void emacdev_send(void);
+uint32_t emacdev_poll(uint32_t u32Max);
+void emacdev_periodic(void);
+
+#endif /* __EMACDEV_H__ */
@@ -320,8 +320,22 @@ void uip_init(void);
     hwsend(uip_appdata, uip_len - 40 - UIP_LLH_LEN);
  }
  \endcode
+ *
+ * When UIP_BUFPTR is set, uip_buf is a pointer instead of an array
+ * and the device driver may point it at its own frame buffers, so
+ * that packets are exchanged with the network interface instead of
+ * copied. The buffer must be at least UIP_BUFSIZE+2 bytes, 16-bit
+ * aligned, and set before any packet is processed.
  */
+#ifndef UIP_BUFPTR
+#define UIP_BUFPTR 0
+#endif /* UIP_BUFPTR */
+
+#if UIP_BUFPTR
+extern u8_t *uip_buf;
+#else /* UIP_BUFPTR */
 extern u8_t uip_buf[UIP_BUFSIZE+2];
+#endif /* UIP_BUFPTR */
 
 /** @} */
 
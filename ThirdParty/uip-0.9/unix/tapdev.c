@@ -169,3 +169,44 @@ tapdev_send(void)
   }
 }  
 /*-----------------------------------------------------------------------------------*/
+/*
+ * Buffer based access for device layers that keep their own frame
+ * buffers instead of using uip_buf, e.g. a model of a DMA descriptor
+ * ring. tapdev_recv() waits at most usec microseconds for a frame and
+ * returns its length, or 0 if none arrived.
+ */
+/*-----------------------------------------------------------------------------------*/
+unsigned int
+tapdev_recv(u8_t *buf, unsigned int len, unsigned long usec)
+{
+  fd_set fdset;
+  struct timeval tv;
+  int ret;
+
+  tv.tv_sec = usec / 1000000;
+  tv.tv_usec = usec % 1000000;
+
+  FD_ZERO(&fdset);
+  FD_SET(fd, &fdset);
+
+  ret = select(fd + 1, &fdset, NULL, NULL, &tv);
+  if(ret <= 0) {
+    return 0;
+  }
+  ret = read(fd, buf, len);
+  if(ret == -1) {
+    perror("tap_dev: tapdev_recv: read");
+    return 0;
+  }
+  return ret;
+}
+/*-----------------------------------------------------------------------------------*/
+void
+tapdev_xmit(const u8_t *buf, unsigned int len)
+{
+  if(write(fd, buf, len) == -1) {
+    perror("tap_dev: tapdev_xmit: write");
+    exit(1);
+  }
+}
+/*-----------------------------------------------------------------------------------*/
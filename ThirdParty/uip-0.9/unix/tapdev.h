@@ -38,5 +38,7 @@
 void tapdev_init(void);
 unsigned int tapdev_read(void);
 void tapdev_send(void);
+unsigned int tapdev_recv(u8_t *buf, unsigned int len, unsigned long usec);
+void tapdev_xmit(const u8_t *buf, unsigned int len);
 
 #endif /* __TAPDEV_H__ */
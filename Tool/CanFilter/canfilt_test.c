@@ -0,0 +1,271 @@
+/**************************************************************************//**
+ * @file     canfilt_test.c
+ * @version  V1.00
+ * @brief    Host test of the CAN acceptance filter compiler (canfilt.h).
+ *
+ * Compiles fixed and random rule sets and checks every plan against the rules:
+ *   - the FIFOs fill exactly the receive message objects and no filter is deeper than allowed,
+ *   - every identifier a rule wants reaches a filter, and CANFILT_Match() names a rule that wants it,
+ *   - no identifier that no rule wants survives CANFILT_Match(),
+ *   - a filter not marked lossy accepts only identifiers its rules want.
+ * Standard identifiers are checked exhaustively, extended ones by sampling.
+ *
+ * Build:  cc -O2 -I../../Library/StdDriver/inc -o canfilt_test canfilt_test.c ../../Library/StdDriver/src/canfilt.c
+ *
+ * Usage:  canfilt_test [iterations] [seed]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "canfilt.h"
+
+static uint32_t s_u32Fails;
+static uint64_t s_u64Extra, s_u64Wanted;
+
+#define CHECK(cond, ...)                                        \
+    do                                                          \
+    {                                                           \
+        if (!(cond))                                            \
+        {                                                       \
+            printf("FAIL line %d: ", __LINE__);                 \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+            s_u32Fails++;                                       \
+            return;                                             \
+        }                                                       \
+    } while (0)
+
+static uint32_t Rand32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static int RuleWants(const CANFILT_RULE_T *psRule, uint32_t u32IdType, uint32_t u32Id)
+{
+    uint32_t u32Width = (psRule->u8IdType == CANFILT_EXT_ID) ? CANFILT_EXT_MASK : CANFILT_STD_MASK;
+
+    return (psRule->u8IdType == u32IdType) && ((((u32Id ^ psRule->u32Id) & psRule->u32Mask & u32Width)) == 0);
+}
+
+static int AnyWants(const CANFILT_RULE_T *psRules, uint32_t u32Count, uint32_t u32IdType, uint32_t u32Id)
+{
+    uint32_t i;
+
+    for (i = 0; i < u32Count; i++)
+        if (RuleWants(&psRules[i], u32IdType, u32Id))
+            return 1;
+    return 0;
+}
+
+static void CheckId(const CANFILT_RULE_T *psRules, uint32_t u32Count, const CANFILT_PLAN_T *psPlan,
+                    uint32_t u32IdType, uint32_t u32Id)
+{
+    int32_t i32Filter, i32Rule;
+    int iWanted = AnyWants(psRules, u32Count, u32IdType, u32Id);
+
+    i32Filter = CANFILT_Accept(psPlan, u32IdType, u32Id);
+    i32Rule = (i32Filter < 0) ? -1 : CANFILT_Match(psPlan, (uint32_t)i32Filter, u32IdType, u32Id);
+
+    if (iWanted)
+    {
+        s_u64Wanted++;
+        CHECK(i32Filter >= 0, "type %u id 0x%X wanted but no filter accepts it", u32IdType, u32Id);
+        CHECK(i32Rule >= 0, "type %u id 0x%X wanted but filter %d matches no rule", u32IdType, u32Id, i32Filter);
+        CHECK(RuleWants(&psRules[i32Rule], u32IdType, u32Id), "id 0x%X matched rule %d that does not want it",
+              u32Id, i32Rule);
+    }
+    else
+    {
+        CHECK(i32Rule < 0, "type %u id 0x%X unwanted but matched rule %d", u32IdType, u32Id, i32Rule);
+        if (i32Filter >= 0)
+        {
+            s_u64Extra++;
+            CHECK(psPlan->asFilter[i32Filter].u8Lossy, "id 0x%X unwanted but accepted by exact filter %d",
+                  u32Id, i32Filter);
+        }
+    }
+}
+
+static void CheckPlan(const CANFILT_RULE_T *psRules, uint32_t u32Count, uint32_t u32TxObjs, uint32_t u32MinDepth,
+                      const CANFILT_PLAN_T *psPlan)
+{
+    uint32_t i, j, u32Obj, u32Id, u32Rules = 0;
+    const CANFILT_FILTER_T *psFilter;
+
+    CHECK(psPlan->u32TxObjs == u32TxObjs, "tx objects %u", psPlan->u32TxObjs);
+    CHECK(psPlan->u32Filters >= 1 && psPlan->u32Filters * u32MinDepth <= CANFILT_MSG_OBJS - u32TxObjs,
+          "%u filters of depth %u do not fit", psPlan->u32Filters, u32MinDepth);
+    for (u32Obj = 0; u32Obj < u32TxObjs; u32Obj++)
+        CHECK(psPlan->au8ObjFilter[u32Obj] == CANFILT_OBJ_TX, "object %u not tx", u32Obj);
+    for (i = 0; i < psPlan->u32Filters; i++)
+    {
+        psFilter = &psPlan->asFilter[i];
+        CHECK(psFilter->u8First == u32Obj, "filter %u starts at %u, expected %u", i, psFilter->u8First, u32Obj);
+        CHECK(psFilter->u8Depth >= u32MinDepth, "filter %u depth %u", i, psFilter->u8Depth);
+        for (j = 0; j < psFilter->u8Depth; j++, u32Obj++)
+            CHECK(psPlan->au8ObjFilter[u32Obj] == i, "object %u maps to %u", u32Obj, psPlan->au8ObjFilter[u32Obj]);
+        CHECK((u32Rules & psFilter->u32Rules) == 0, "rule in two filters");
+        u32Rules |= psFilter->u32Rules;
+    }
+    CHECK(u32Obj == CANFILT_MSG_OBJS, "%u objects used", u32Obj);
+    CHECK(u32Rules == ((u32Count < 32) ? (1u << u32Count) - 1 : 0xFFFFFFFFu), "rules 0x%X not all served", u32Rules);
+
+    for (u32Id = 0; u32Id <= CANFILT_STD_MASK; u32Id++)
+        CheckId(psRules, u32Count, psPlan, CANFILT_STD_ID, u32Id);
+
+    for (i = 0; i < u32Count; i++)
+    {
+        if (psRules[i].u8IdType != CANFILT_EXT_ID)
+            continue;
+        for (j = 0; j < 256; j++)
+        {
+            /* Identifiers the rule wants, and ones a bit away from it */
+            u32Id = (psRules[i].u32Id & psRules[i].u32Mask) | (Rand32() & ~psRules[i].u32Mask);
+            CheckId(psRules, u32Count, psPlan, CANFILT_EXT_ID, u32Id & CANFILT_EXT_MASK);
+            CheckId(psRules, u32Count, psPlan, CANFILT_EXT_ID, (u32Id ^ (1u << (Rand32() % 29))) & CANFILT_EXT_MASK);
+        }
+    }
+    for (j = 0; j < 4096; j++)
+        CheckId(psRules, u32Count, psPlan, CANFILT_EXT_ID, Rand32() & CANFILT_EXT_MASK);
+}
+
+static void RandomRule(CANFILT_RULE_T *psRule)
+{
+    uint32_t u32Width, u32Free;
+
+    memset(psRule, 0, sizeof(*psRule));
+    psRule->u8IdType = (rand() % 4 == 0) ? CANFILT_EXT_ID : CANFILT_STD_ID;
+    u32Width = (psRule->u8IdType == CANFILT_EXT_ID) ? CANFILT_EXT_MASK : CANFILT_STD_MASK;
+    psRule->u32Id = Rand32() & u32Width;
+
+    /* Mostly single identifiers, some aligned ranges, a few scattered masks */
+    switch (rand() % 4)
+    {
+        case 0:
+        case 1:
+            psRule->u32Mask = u32Width;
+            break;
+        case 2:
+            u32Free = (uint32_t)rand() % 6;
+            psRule->u32Mask = u32Width & ~((1u << u32Free) - 1);
+            break;
+        default:
+            psRule->u32Mask = u32Width & ~(Rand32() & Rand32() & Rand32());
+            break;
+    }
+    /* Clustered identifiers, as real message sets are */
+    if (rand() % 2)
+        psRule->u32Id = (psRule->u32Id & ~0xF0u) | 0x300u;
+    psRule->u8Weight = (uint8_t)(rand() % 8);
+}
+
+static void TestFixed(void)
+{
+    CANFILT_RULE_T asRule[CANFILT_MAX_RULES];
+    CANFILT_PLAN_T sPlan;
+    uint32_t i;
+    int32_t i32Ret;
+
+    /* 32 consecutive aligned identifiers merge into one exact filter */
+    memset(asRule, 0, sizeof(asRule));
+    for (i = 0; i < 32; i++)
+    {
+        asRule[i].u32Id = 0x200 + i;
+        asRule[i].u32Mask = CANFILT_STD_MASK;
+    }
+    i32Ret = CANFILT_Compile(asRule, 32, 4, 4, &sPlan);
+    CHECK(i32Ret == CANFILT_OK, "compile %d", i32Ret);
+    CHECK(sPlan.u32Filters <= 7, "%u filters", sPlan.u32Filters);
+    for (i = 0; i < sPlan.u32Filters; i++)
+        CHECK(!sPlan.asFilter[i].u8Lossy, "filter %u lossy", i);
+    CheckPlan(asRule, 32, 4, 4, &sPlan);
+
+    /* A covered rule shares the filter of the rule covering it */
+    memset(asRule, 0, sizeof(asRule));
+    asRule[0].u32Id = 0x123;
+    asRule[0].u32Mask = CANFILT_STD_MASK;
+    asRule[1].u32Id = 0x120;
+    asRule[1].u32Mask = 0x7F0;
+    i32Ret = CANFILT_Compile(asRule, 2, 0, 1, &sPlan);
+    CHECK(i32Ret == CANFILT_OK && sPlan.u32Filters == 1 && sPlan.asFilter[0].u32Rules == 3, "cover");
+    CheckPlan(asRule, 2, 0, 1, &sPlan);
+
+    /* Weight sizes the FIFOs */
+    asRule[0].u32Id = 0x100;
+    asRule[0].u8Weight = 3;
+    asRule[1].u32Id = 0x200;
+    asRule[1].u32Mask = CANFILT_STD_MASK;
+    asRule[1].u8Weight = 1;
+    i32Ret = CANFILT_Compile(asRule, 2, 0, 2, &sPlan);
+    CHECK(i32Ret == CANFILT_OK && sPlan.u32Filters == 2, "weight compile");
+    CHECK(sPlan.asFilter[0].u8Depth + sPlan.asFilter[1].u8Depth == 32, "weight total");
+    CHECK(sPlan.asFilter[sPlan.asFilter[0].u32Id == 0x100 ? 0 : 1].u8Depth == 23, "weight split %u/%u",
+          sPlan.asFilter[0].u8Depth, sPlan.asFilter[1].u8Depth);
+
+    /* Standard and extended rules never share a filter */
+    asRule[1].u8IdType = CANFILT_EXT_ID;
+    asRule[1].u32Mask = CANFILT_EXT_MASK;
+    i32Ret = CANFILT_Compile(asRule, 2, 0, 32, &sPlan);
+    CHECK(i32Ret == CANFILT_ERR_BUDGET, "mixed types in one filter: %d", i32Ret);
+
+    /* Arguments */
+    CHECK(CANFILT_Compile(asRule, 0, 0, 1, &sPlan) == CANFILT_ERR_PARAM, "no rules");
+    CHECK(CANFILT_Compile(asRule, 33, 0, 1, &sPlan) == CANFILT_ERR_PARAM, "too many rules");
+    CHECK(CANFILT_Compile(asRule, 2, 32, 1, &sPlan) == CANFILT_ERR_PARAM, "no receive objects");
+    CHECK(CANFILT_Compile(asRule, 2, 0, 0, &sPlan) == CANFILT_ERR_PARAM, "depth 0");
+}
+
+int main(int argc, char *argv[])
+{
+    CANFILT_RULE_T asRule[CANFILT_MAX_RULES];
+    CANFILT_PLAN_T sPlan;
+    uint32_t u32Iter = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000;
+    uint32_t i, j, u32Count, u32TxObjs, u32MinDepth, u32Plans = 0, u32Lossy = 0, u32Budget = 0;
+    int32_t i32Ret;
+
+    srand((argc > 2) ? (unsigned)strtoul(argv[2], NULL, 0) : 1u);
+
+    TestFixed();
+
+    for (i = 0; (i < u32Iter) && (s_u32Fails == 0); i++)
+    {
+        u32Count = 1 + (uint32_t)rand() % CANFILT_MAX_RULES;
+        u32TxObjs = (uint32_t)rand() % 9;
+        u32MinDepth = 1 + (uint32_t)rand() % 4;
+        for (j = 0; j < u32Count; j++)
+            RandomRule(&asRule[j]);
+
+        i32Ret = CANFILT_Compile(asRule, u32Count, u32TxObjs, u32MinDepth, &sPlan);
+        if (i32Ret == CANFILT_ERR_BUDGET)
+        {
+            /* Only possible with both identifier types and room for a single FIFO */
+            if ((CANFILT_MSG_OBJS - u32TxObjs) / u32MinDepth >= 2)
+            {
+                printf("FAIL: budget error with room for %u filters\n", (unsigned)((CANFILT_MSG_OBJS - u32TxObjs) / u32MinDepth));
+                s_u32Fails++;
+            }
+            u32Budget++;
+            continue;
+        }
+        if (i32Ret != CANFILT_OK)
+        {
+            printf("FAIL: compile returned %d\n", (int)i32Ret);
+            s_u32Fails++;
+            break;
+        }
+        CheckPlan(asRule, u32Count, u32TxObjs, u32MinDepth, &sPlan);
+        u32Plans++;
+        for (j = 0; j < sPlan.u32Filters; j++)
+            u32Lossy += sPlan.asFilter[j].u8Lossy;
+    }
+
+    printf("%u random plans, %u lossy filters, %u budget errors, %.2f%% of hardware accepted frames unwanted\n",
+           u32Plans, u32Lossy, u32Budget, 100.0 * (double)s_u64Extra / (double)(s_u64Extra + s_u64Wanted + 1));
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
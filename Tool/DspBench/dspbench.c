@@ -0,0 +1,978 @@
+/**************************************************************************//**
+ * @file     dspbench.c
+ * @version  V1.00
+ * @brief    Regression suite and benchmark of the CMSIS-DSP FIR, biquad, FFT, matrix and statistics
+ *           kernels in F32, Q31 and Q15.
+ *
+ * Every kernel runs on a fixed pseudo random test block in its own format. Its output is compared
+ * with a double precision reference computed from the same quantized input and coefficients, and
+ * the signal to noise ratio must reach the threshold of the kernel; transposes, maxima and minima
+ * must be exact. Each kernel is then timed without its setup: ns per sample on a host, core cycles
+ * per sample (DWT->CYCCNT) on the M480. Matrix kernels count output elements as samples.
+ *
+ * On a host, ARM_MATH_CM0 selects the generic C kernels of DSP_Lib/Source, with
+ * ../DspCommon/arm_bitreversal.c for the bit reversal the library only has in assembly. Defined
+ * DSPBENCH_M4, the same file runs on the M480 against the prebuilt arm_cortexM4lf_math library,
+ * called from the SampleCode/CortexM4/DSP_Bench sample. Run it before and after adopting an optimized kernel variant:
+ * the thresholds hold for both builds.
+ *
+ * Build:  D=../../Library/CMSIS/DSP_Lib/Source
+ *         cc -O2 -DARM_MATH_CM0 -fno-strict-aliasing -I../../Library/CMSIS/Include
+ *             -o dspbench dspbench.c ../DspCommon/arm_bitreversal.c $(find $D -name '*.c') -lm
+ *
+ * Usage:  dspbench [ms per kernel] [name filter]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#ifdef DSPBENCH_M4
+#include "NuMicro.h"
+#else
+#include <stdlib.h>
+#include <time.h>
+#endif
+#include "arm_math.h"
+#include "arm_const_structs.h"
+
+#define BLOCK_LEN       1024UL          /* Samples per run, FFT length */
+#define CALL_LEN        64UL            /* Samples per filter call, as a streaming application would */
+#define FIR_TAPS        32UL
+#define BIQ_STAGES      2UL
+#define MAT_DIM         32UL            /* MAT_DIM x MAT_DIM matrices, MAT_DIM^2 == BLOCK_LEN */
+
+#define SNR_EXACT       999.0           /* Output identical to the reference */
+
+/* Formats */
+#define FMT_F32         0UL
+#define FMT_Q31         1UL
+#define FMT_Q15         2UL
+#define FMT_F64         3UL             /* Converted scalar results */
+
+/* Kernel variants, TEST_T::u32Kernel */
+#define K_STD           0UL
+#define K_FAST          1UL             /* *_fast_*: 32-bit accumulator */
+#define K_DF2T          2UL             /* Biquad transposed direct form II */
+#define K_32X64         3UL             /* Biquad with 64-bit state */
+#define K_RADIX4        4UL             /* Legacy arm_cfft_radix4_f32() */
+#define K_RFFT          5UL
+#define K_TRANS         6UL
+#define K_INVERSE       7UL
+
+/* Statistics kernels, TEST_T::u32Kernel and index of the reference in s_adRef */
+#define STAT_MEAN       0UL
+#define STAT_RMS        1UL
+#define STAT_VAR        2UL
+#define STAT_STD        3UL
+#define STAT_POWER      4UL
+#define STAT_MAX        5UL             /* Value, index */
+#define STAT_MIN        7UL             /* Value, index */
+
+typedef struct TEST_S TEST_T;
+
+struct TEST_S
+{
+    const char *pcName;
+    uint32_t u32Fmt;
+    uint32_t u32Kernel;
+    uint32_t u32Samples;                /* Samples (matrix output elements) per run */
+    double   dMinSnr;                   /* dB, SNR_EXACT: must be exact */
+    void (*pfnSetup)(const TEST_T *psTest);     /* Input, reference and output description */
+    void (*pfnRun)(const TEST_T *psTest);       /* One run, the kernel between BENCH_START/BENCH_STOP */
+};
+
+typedef union
+{
+    float32_t af32[2 * BLOCK_LEN];
+    q31_t aq31[2 * BLOCK_LEN];
+    q15_t aq15[2 * BLOCK_LEN];
+} BUF_T;
+
+/* Inputs in kernel format, and as double exactly as quantized */
+static BUF_T s_uIn, s_uWork, s_uOut;
+static double s_adX[2 * BLOCK_LEN];
+static union
+{
+    float32_t af32[FIR_TAPS];
+    q31_t aq31[FIR_TAPS];
+    q15_t aq15[FIR_TAPS];
+} s_uCoef;
+static double s_adCoef[FIR_TAPS];
+static q63_t s_aq63State[4 * BIQ_STAGES];
+
+/* Reference and the output compared with it */
+static double s_adRef[2 * BLOCK_LEN];
+static double s_adResult[2];
+static const double *s_pdRef;
+static const void *s_pvOut;
+static uint32_t s_u32OutFmt, s_u32OutLen;
+static double s_dOutScale;              /* Output value to signal value */
+
+/* Kernel instances set up outside the timed part */
+static arm_rfft_fast_instance_f32 s_sRfftF32;
+static arm_rfft_instance_q31 s_sRfftQ31;
+static arm_rfft_instance_q15 s_sRfftQ15;
+static arm_cfft_radix4_instance_f32 s_sRadix4F32;
+
+static double s_dTicks;                 /* Time of the kernel in the last run */
+static uint32_t s_u32Fails;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Timing                                                                                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifdef DSPBENCH_M4
+
+#define BENCH_UNIT      "cycles"
+#define BENCH_RUNS      3UL
+
+static uint32_t s_u32Start;
+
+#define BENCH_START()   (s_u32Start = DWT->CYCCNT)
+#define BENCH_STOP()    (s_dTicks += (double)(DWT->CYCCNT - s_u32Start))
+
+static void BenchInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#else
+
+#define BENCH_UNIT      "ns"
+
+static uint64_t s_u64Start;
+
+static uint64_t WallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#define BENCH_START()   (s_u64Start = WallNs())
+#define BENCH_STOP()    (s_dTicks += (double)(WallNs() - s_u64Start))
+
+static void BenchInit(void)
+{
+}
+
+#endif
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Signals, formats and the SNR                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* Uniform -1 ~ 1, a hash of u32I so any sample can be regenerated */
+static double Noise(uint32_t u32I)
+{
+    uint32_t u32X = u32I * 2654435761UL + 0x9E3779B9UL;
+
+    u32X ^= u32X >> 16;
+    u32X *= 0x7FEB352DUL;
+    u32X ^= u32X >> 15;
+    u32X *= 0x846CA68BUL;
+    u32X ^= u32X >> 16;
+    return (double)(int32_t)u32X / 2147483648.0;
+}
+
+/* Test signal within +-0.55: noise and two sines */
+static double Signal(uint32_t u32I)
+{
+    return 0.25 * Noise(u32I) + 0.2 * sin(2.0 * PI * 0.0123 * u32I) + 0.1 * sin(2.0 * PI * 0.2 * u32I);
+}
+
+/* Stores pdSrc[] in format u32Fmt with rounding and saturation; pdQ[] receives the stored values */
+static void Quantize(uint32_t u32Fmt, const double *pdSrc, void *pvDst, double *pdQ, uint32_t u32Len)
+{
+    uint32_t i;
+    double d;
+
+    for(i = 0; i < u32Len; i++)
+    {
+        if(u32Fmt == FMT_F32)
+        {
+            ((float32_t *)pvDst)[i] = (float32_t)pdSrc[i];
+            pdQ[i] = ((float32_t *)pvDst)[i];
+        }
+        else if(u32Fmt == FMT_Q31)
+        {
+            d = floor(pdSrc[i] * 2147483648.0 + 0.5);
+            d = (d > 2147483647.0) ? 2147483647.0 : (d < -2147483648.0) ? -2147483648.0 : d;
+            ((q31_t *)pvDst)[i] = (q31_t)d;
+            pdQ[i] = d / 2147483648.0;
+        }
+        else
+        {
+            d = floor(pdSrc[i] * 32768.0 + 0.5);
+            d = (d > 32767.0) ? 32767.0 : (d < -32768.0) ? -32768.0 : d;
+            ((q15_t *)pvDst)[i] = (q15_t)d;
+            pdQ[i] = d / 32768.0;
+        }
+    }
+}
+
+static double ToDouble(uint32_t u32Fmt, const void *pv, uint32_t u32I)
+{
+    if(u32Fmt == FMT_F32)
+        return ((const float32_t *)pv)[u32I];
+    if(u32Fmt == FMT_Q31)
+        return ((const q31_t *)pv)[u32I] / 2147483648.0;
+    if(u32Fmt == FMT_Q15)
+        return ((const q15_t *)pv)[u32I] / 32768.0;
+    return ((const double *)pv)[u32I];
+}
+
+static void SetOutput(const void *pvOut, uint32_t u32Fmt, uint32_t u32Len, double dScale, const double *pdRef)
+{
+    s_pvOut = pvOut;
+    s_u32OutFmt = u32Fmt;
+    s_u32OutLen = u32Len;
+    s_dOutScale = dScale;
+    s_pdRef = pdRef;
+}
+
+/* dB of the reference over the difference of the output of the last run */
+static double Snr(void)
+{
+    double dSig = 0.0, dErr = 0.0, dDiff;
+    uint32_t i;
+
+    for(i = 0; i < s_u32OutLen; i++)
+    {
+        dDiff = s_pdRef[i] - ToDouble(s_u32OutFmt, s_pvOut, i) * s_dOutScale;
+        dSig += s_pdRef[i] * s_pdRef[i];
+        dErr += dDiff * dDiff;
+    }
+    if(dErr == 0.0)
+        return SNR_EXACT;
+    if(dSig == 0.0)
+        return 0.0;
+    return 10.0 * log10(dSig / dErr);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  FIR                                                                                                    */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void SetupFir(const TEST_T *psTest)
+{
+    double adH[FIR_TAPS], d;
+    uint32_t i, k;
+
+    /*
+     * Low pass, windowed sinc at 0.2 fs, tilted so a reversed coefficient order shows.
+     * CMSIS takes the coefficients time reversed.
+     */
+    for(k = 0; k < FIR_TAPS; k++)
+    {
+        d = (double)k - (FIR_TAPS - 1) / 2.0;
+        adH[FIR_TAPS - 1 - k] = 0.4 * ((d == 0.0) ? 1.0 : sin(0.4 * PI * d) / (0.4 * PI * d)) *
+                                (0.54 - 0.46 * cos(2.0 * PI * k / (FIR_TAPS - 1))) * (1.0 + 0.5 * k / FIR_TAPS);
+    }
+    Quantize(psTest->u32Fmt, adH, &s_uCoef, s_adCoef, FIR_TAPS);
+
+    for(i = 0; i < BLOCK_LEN; i++)
+        s_adRef[i] = Signal(i);
+    Quantize(psTest->u32Fmt, s_adRef, &s_uIn, s_adX, BLOCK_LEN);
+
+    for(i = 0; i < BLOCK_LEN; i++)
+    {
+        for(k = 0, d = 0.0; k < FIR_TAPS && k <= i; k++)
+            d += s_adCoef[FIR_TAPS - 1 - k] * s_adX[i - k];
+        s_adRef[i] = d;
+    }
+    SetOutput(&s_uOut, psTest->u32Fmt, BLOCK_LEN, 1.0, s_adRef);
+}
+
+static void RunFir(const TEST_T *psTest)
+{
+    arm_fir_instance_f32 sF32;
+    arm_fir_instance_q31 sQ31;
+    arm_fir_instance_q15 sQ15;
+    uint32_t i;
+
+    if(psTest->u32Fmt == FMT_F32)
+    {
+        arm_fir_init_f32(&sF32, FIR_TAPS, s_uCoef.af32, s_uWork.af32, CALL_LEN);
+        BENCH_START();
+        for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+            arm_fir_f32(&sF32, &s_uIn.af32[i], &s_uOut.af32[i], CALL_LEN);
+        BENCH_STOP();
+    }
+    else if(psTest->u32Fmt == FMT_Q31)
+    {
+        arm_fir_init_q31(&sQ31, FIR_TAPS, s_uCoef.aq31, s_uWork.aq31, CALL_LEN);
+        BENCH_START();
+        if(psTest->u32Kernel == K_FAST)
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_fir_fast_q31(&sQ31, &s_uIn.aq31[i], &s_uOut.aq31[i], CALL_LEN);
+        else
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_fir_q31(&sQ31, &s_uIn.aq31[i], &s_uOut.aq31[i], CALL_LEN);
+        BENCH_STOP();
+    }
+    else
+    {
+        arm_fir_init_q15(&sQ15, FIR_TAPS, s_uCoef.aq15, s_uWork.aq15, CALL_LEN);
+        BENCH_START();
+        if(psTest->u32Kernel == K_FAST)
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_fir_fast_q15(&sQ15, &s_uIn.aq15[i], &s_uOut.aq15[i], CALL_LEN);
+        else
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_fir_q15(&sQ15, &s_uIn.aq15[i], &s_uOut.aq15[i], CALL_LEN);
+        BENCH_STOP();
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Biquad cascade                                                                                         */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void SetupBiquad(const TEST_T *psTest)
+{
+    static const double adQ[BIQ_STAGES] = { 0.5412, 1.3066 };  /* 4th order Butterworth */
+    double adC[6 * BIQ_STAGES], adB[5 * BIQ_STAGES], adS[4 * BIQ_STAGES];
+    double dW = 2.0 * PI * 0.1, dAlpha, dA0, dX, dY, *pdB;
+    uint32_t i, s, u32Per = (psTest->u32Fmt == FMT_Q15) ? 6 : 5;
+    /* Fixed point coefficients are halved, the kernels run with postShift 1 */
+    double dGain = (psTest->u32Fmt == FMT_F32) ? 1.0 : 0.5;
+
+    /* Low pass at 0.1 fs. CMSIS order b0, b1, b2, a1, a2 with a1, a2 negated; Q15 pads b0 with a 0 */
+    for(s = 0; s < BIQ_STAGES; s++)
+    {
+        dAlpha = sin(dW) / (2.0 * adQ[s]);
+        dA0 = 1.0 + dAlpha;
+        pdB = &adB[5 * s];
+        pdB[0] = (1.0 - cos(dW)) / 2.0 / dA0;
+        pdB[1] = (1.0 - cos(dW)) / dA0;
+        pdB[2] = pdB[0];
+        pdB[3] = 2.0 * cos(dW) / dA0;
+        pdB[4] = -(1.0 - dAlpha) / dA0;
+        if(u32Per == 6)
+        {
+            adC[6 * s] = pdB[0] * dGain;
+            adC[6 * s + 1] = 0.0;
+            for(i = 1; i < 5; i++)
+                adC[6 * s + 1 + i] = pdB[i] * dGain;
+        }
+        else
+        {
+            for(i = 0; i < 5; i++)
+                adC[5 * s + i] = pdB[i] * dGain;
+        }
+    }
+    Quantize(psTest->u32Fmt, adC, &s_uCoef, s_adCoef, u32Per * BIQ_STAGES);
+
+    /* The reference runs the coefficients as quantized */
+    for(s = 0; s < BIQ_STAGES; s++)
+    {
+        for(i = 0; i < 5; i++)
+            adB[5 * s + i] = s_adCoef[u32Per * s + i + ((u32Per == 6 && i > 0) ? 1 : 0)] / dGain;
+    }
+
+    for(i = 0; i < BLOCK_LEN; i++)
+        s_adRef[i] = Signal(i);
+    Quantize(psTest->u32Fmt, s_adRef, &s_uIn, s_adX, BLOCK_LEN);
+
+    memset(adS, 0, sizeof(adS));
+    for(i = 0; i < BLOCK_LEN; i++)
+    {
+        dX = s_adX[i];
+        for(s = 0; s < BIQ_STAGES; s++)
+        {
+            pdB = &adB[5 * s];
+            dY = pdB[0] * dX + pdB[1] * adS[4 * s] + pdB[2] * adS[4 * s + 1] + pdB[3] * adS[4 * s + 2] +
+                 pdB[4] * adS[4 * s + 3];
+            adS[4 * s + 1] = adS[4 * s];
+            adS[4 * s] = dX;
+            adS[4 * s + 3] = adS[4 * s + 2];
+            adS[4 * s + 2] = dY;
+            dX = dY;
+        }
+        s_adRef[i] = dX;
+    }
+    SetOutput(&s_uOut, psTest->u32Fmt, BLOCK_LEN, 1.0, s_adRef);
+}
+
+static void RunBiquad(const TEST_T *psTest)
+{
+    arm_biquad_casd_df1_inst_f32 sF32;
+    arm_biquad_cascade_df2T_instance_f32 sDf2T;
+    arm_biquad_casd_df1_inst_q31 sQ31;
+    arm_biquad_cas_df1_32x64_ins_q31 s32x64;
+    arm_biquad_casd_df1_inst_q15 sQ15;
+    uint32_t i;
+
+    if(psTest->u32Kernel == K_DF2T)
+    {
+        arm_biquad_cascade_df2T_init_f32(&sDf2T, BIQ_STAGES, s_uCoef.af32, s_uWork.af32);
+        BENCH_START();
+        for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+            arm_biquad_cascade_df2T_f32(&sDf2T, &s_uIn.af32[i], &s_uOut.af32[i], CALL_LEN);
+        BENCH_STOP();
+    }
+    else if(psTest->u32Kernel == K_32X64)
+    {
+        arm_biquad_cas_df1_32x64_init_q31(&s32x64, BIQ_STAGES, s_uCoef.aq31, s_aq63State, 1);
+        BENCH_START();
+        for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+            arm_biquad_cas_df1_32x64_q31(&s32x64, &s_uIn.aq31[i], &s_uOut.aq31[i], CALL_LEN);
+        BENCH_STOP();
+    }
+    else if(psTest->u32Fmt == FMT_F32)
+    {
+        arm_biquad_cascade_df1_init_f32(&sF32, BIQ_STAGES, s_uCoef.af32, s_uWork.af32);
+        BENCH_START();
+        for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+            arm_biquad_cascade_df1_f32(&sF32, &s_uIn.af32[i], &s_uOut.af32[i], CALL_LEN);
+        BENCH_STOP();
+    }
+    else if(psTest->u32Fmt == FMT_Q31)
+    {
+        arm_biquad_cascade_df1_init_q31(&sQ31, BIQ_STAGES, s_uCoef.aq31, s_uWork.aq31, 1);
+        BENCH_START();
+        if(psTest->u32Kernel == K_FAST)
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_biquad_cascade_df1_fast_q31(&sQ31, &s_uIn.aq31[i], &s_uOut.aq31[i], CALL_LEN);
+        else
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_biquad_cascade_df1_q31(&sQ31, &s_uIn.aq31[i], &s_uOut.aq31[i], CALL_LEN);
+        BENCH_STOP();
+    }
+    else
+    {
+        arm_biquad_cascade_df1_init_q15(&sQ15, BIQ_STAGES, s_uCoef.aq15, s_uWork.aq15, 1);
+        BENCH_START();
+        if(psTest->u32Kernel == K_FAST)
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_biquad_cascade_df1_fast_q15(&sQ15, &s_uIn.aq15[i], &s_uOut.aq15[i], CALL_LEN);
+        else
+            for(i = 0; i < BLOCK_LEN; i += CALL_LEN)
+                arm_biquad_cascade_df1_q15(&sQ15, &s_uIn.aq15[i], &s_uOut.aq15[i], CALL_LEN);
+        BENCH_STOP();
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  FFT                                                                                                    */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* In place radix 2 DFT of u32N interleaved complex values */
+static void RefFft(double *pd, uint32_t u32N)
+{
+    uint32_t i, j, k, u32Len;
+    double dWr, dWi, dTr, dTi;
+
+    for(i = 1, j = 0; i < u32N; i++)
+    {
+        for(k = u32N >> 1; j & k; k >>= 1)
+            j ^= k;
+        j |= k;
+        if(i < j)
+        {
+            dTr = pd[2 * i], pd[2 * i] = pd[2 * j], pd[2 * j] = dTr;
+            dTi = pd[2 * i + 1], pd[2 * i + 1] = pd[2 * j + 1], pd[2 * j + 1] = dTi;
+        }
+    }
+
+    for(u32Len = 2; u32Len <= u32N; u32Len <<= 1)
+    {
+        for(k = 0; k < u32Len / 2; k++)
+        {
+            dWr = cos(2.0 * PI * k / u32Len);
+            dWi = -sin(2.0 * PI * k / u32Len);
+            for(i = k; i < u32N; i += u32Len)
+            {
+                j = i + u32Len / 2;
+                dTr = pd[2 * j] * dWr - pd[2 * j + 1] * dWi;
+                dTi = pd[2 * j] * dWi + pd[2 * j + 1] * dWr;
+                pd[2 * j] = pd[2 * i] - dTr;
+                pd[2 * j + 1] = pd[2 * i + 1] - dTi;
+                pd[2 * i] += dTr;
+                pd[2 * i + 1] += dTi;
+            }
+        }
+    }
+}
+
+static void SetupFft(const TEST_T *psTest)
+{
+    uint32_t i, u32Fmt = psTest->u32Fmt;
+
+    if(psTest->u32Kernel == K_RFFT)
+    {
+        for(i = 0; i < BLOCK_LEN; i++)
+            s_adRef[i] = Signal(i);
+        Quantize(u32Fmt, s_adRef, &s_uIn, s_adX, BLOCK_LEN);
+        for(i = 0; i < BLOCK_LEN; i++)
+        {
+            s_adRef[2 * i] = s_adX[i];
+            s_adRef[2 * i + 1] = 0.0;
+        }
+        RefFft(s_adRef, BLOCK_LEN);
+
+        if(u32Fmt == FMT_F32)
+        {
+            /* arm_rfft_fast_f32() packs the real Nyquist bin into the imaginary part of DC */
+            s_adRef[1] = s_adRef[BLOCK_LEN];
+            arm_rfft_fast_init_f32(&s_sRfftF32, BLOCK_LEN);
+            SetOutput(&s_uOut, u32Fmt, BLOCK_LEN, 1.0, s_adRef);
+        }
+        else
+        {
+            /* DC to Nyquist, scaled down by BLOCK_LEN */
+            if(u32Fmt == FMT_Q31)
+                arm_rfft_init_q31(&s_sRfftQ31, BLOCK_LEN, 0, 1);
+            else
+                arm_rfft_init_q15(&s_sRfftQ15, BLOCK_LEN, 0, 1);
+            SetOutput(&s_uOut, u32Fmt, BLOCK_LEN + 2, BLOCK_LEN, s_adRef);
+        }
+    }
+    else
+    {
+        for(i = 0; i < 2 * BLOCK_LEN; i++)
+            s_adRef[i] = Signal(i);
+        Quantize(u32Fmt, s_adRef, &s_uIn, s_adX, 2 * BLOCK_LEN);
+        memcpy(s_adRef, s_adX, sizeof(s_adRef));
+        RefFft(s_adRef, BLOCK_LEN);
+
+        if(psTest->u32Kernel == K_RADIX4)
+            arm_cfft_radix4_init_f32(&s_sRadix4F32, BLOCK_LEN, 0, 1);
+        /* The fixed point CFFTs scale down by 2 per radix 2 stage */
+        SetOutput(&s_uOut, u32Fmt, 2 * BLOCK_LEN, (u32Fmt == FMT_F32) ? 1.0 : BLOCK_LEN, s_adRef);
+    }
+}
+
+static void RunFft(const TEST_T *psTest)
+{
+    if(psTest->u32Kernel == K_RFFT)
+    {
+        /* The input is used as work area */
+        memcpy(&s_uWork, &s_uIn, sizeof(s_uWork));
+        BENCH_START();
+        if(psTest->u32Fmt == FMT_F32)
+            arm_rfft_fast_f32(&s_sRfftF32, s_uWork.af32, s_uOut.af32, 0);
+        else if(psTest->u32Fmt == FMT_Q31)
+            arm_rfft_q31(&s_sRfftQ31, s_uWork.aq31, s_uOut.aq31);
+        else
+            arm_rfft_q15(&s_sRfftQ15, s_uWork.aq15, s_uOut.aq15);
+        BENCH_STOP();
+    }
+    else
+    {
+        memcpy(&s_uOut, &s_uIn, sizeof(s_uOut));
+        BENCH_START();
+        if(psTest->u32Kernel == K_RADIX4)
+            arm_cfft_radix4_f32(&s_sRadix4F32, s_uOut.af32);
+        else if(psTest->u32Fmt == FMT_F32)
+            arm_cfft_f32(&arm_cfft_sR_f32_len1024, s_uOut.af32, 0, 1);
+        else if(psTest->u32Fmt == FMT_Q31)
+            arm_cfft_q31(&arm_cfft_sR_q31_len1024, s_uOut.aq31, 0, 1);
+        else
+            arm_cfft_q15(&arm_cfft_sR_q15_len1024, s_uOut.aq15, 0, 1);
+        BENCH_STOP();
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Matrix                                                                                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* Gauss-Jordan inverse of the MAT_DIM square pdA, destroyed, with partial pivoting */
+static void RefInverse(double *pdA, double *pdInv)
+{
+    uint32_t r, c, k, u32Piv;
+    double d;
+
+    for(r = 0; r < MAT_DIM; r++)
+        for(c = 0; c < MAT_DIM; c++)
+            pdInv[r * MAT_DIM + c] = (r == c) ? 1.0 : 0.0;
+
+    for(c = 0; c < MAT_DIM; c++)
+    {
+        for(r = c + 1, u32Piv = c; r < MAT_DIM; r++)
+            if(fabs(pdA[r * MAT_DIM + c]) > fabs(pdA[u32Piv * MAT_DIM + c]))
+                u32Piv = r;
+        for(k = 0; k < MAT_DIM; k++)
+        {
+            d = pdA[c * MAT_DIM + k], pdA[c * MAT_DIM + k] = pdA[u32Piv * MAT_DIM + k], pdA[u32Piv * MAT_DIM + k] = d;
+            d = pdInv[c * MAT_DIM + k], pdInv[c * MAT_DIM + k] = pdInv[u32Piv * MAT_DIM + k], pdInv[u32Piv * MAT_DIM + k] = d;
+        }
+        d = pdA[c * MAT_DIM + c];
+        for(k = 0; k < MAT_DIM; k++)
+        {
+            pdA[c * MAT_DIM + k] /= d;
+            pdInv[c * MAT_DIM + k] /= d;
+        }
+        for(r = 0; r < MAT_DIM; r++)
+        {
+            if(r == c)
+                continue;
+            d = pdA[r * MAT_DIM + c];
+            for(k = 0; k < MAT_DIM; k++)
+            {
+                pdA[r * MAT_DIM + k] -= d * pdA[c * MAT_DIM + k];
+                pdInv[r * MAT_DIM + k] -= d * pdInv[c * MAT_DIM + k];
+            }
+        }
+    }
+}
+
+static void SetupMatrix(const TEST_T *psTest)
+{
+    uint32_t i, r, c, k;
+    double d;
+
+    /*
+     * A then B. Entries within +-0.15 keep the MAT_DIM term products of the fixed point kernels
+     * below 1; the matrix to invert is made diagonally dominant.
+     */
+    for(i = 0; i < 2 * BLOCK_LEN; i++)
+        s_adRef[i] = 0.15 * Noise(i);
+    if(psTest->u32Kernel == K_INVERSE)
+    {
+        for(i = 0; i < MAT_DIM; i++)
+            s_adRef[i * MAT_DIM + i] += 5.0;
+    }
+    Quantize(psTest->u32Fmt, s_adRef, &s_uIn, s_adX, 2 * BLOCK_LEN);
+
+    for(r = 0; r < MAT_DIM; r++)
+    {
+        for(c = 0; c < MAT_DIM; c++)
+        {
+            if(psTest->u32Kernel == K_TRANS)
+            {
+                s_adRef[r * MAT_DIM + c] = s_adX[c * MAT_DIM + r];
+            }
+            else
+            {
+                for(k = 0, d = 0.0; k < MAT_DIM; k++)
+                    d += s_adX[r * MAT_DIM + k] * s_adX[BLOCK_LEN + k * MAT_DIM + c];
+                s_adRef[r * MAT_DIM + c] = d;
+            }
+        }
+    }
+    if(psTest->u32Kernel == K_INVERSE)
+    {
+        memcpy(&s_adRef[BLOCK_LEN], s_adX, BLOCK_LEN * sizeof(double));
+        RefInverse(&s_adRef[BLOCK_LEN], s_adRef);
+    }
+    SetOutput(&s_uOut, psTest->u32Fmt, BLOCK_LEN, 1.0, s_adRef);
+}
+
+static void RunMatrix(const TEST_T *psTest)
+{
+    arm_matrix_instance_f32 sAf, sBf, sCf;
+    arm_matrix_instance_q31 sAq31, sBq31, sCq31;
+    arm_matrix_instance_q15 sAq15, sBq15, sCq15;
+    uint32_t u32Kernel = psTest->u32Kernel;
+
+    if(psTest->u32Fmt == FMT_F32)
+    {
+        /* arm_mat_inverse_f32() destroys its source */
+        if(u32Kernel == K_INVERSE)
+            memcpy(&s_uWork, &s_uIn, BLOCK_LEN * sizeof(float32_t));
+        arm_mat_init_f32(&sAf, MAT_DIM, MAT_DIM, (u32Kernel == K_INVERSE) ? s_uWork.af32 : s_uIn.af32);
+        arm_mat_init_f32(&sBf, MAT_DIM, MAT_DIM, &s_uIn.af32[BLOCK_LEN]);
+        arm_mat_init_f32(&sCf, MAT_DIM, MAT_DIM, s_uOut.af32);
+        BENCH_START();
+        if(u32Kernel == K_TRANS)
+            arm_mat_trans_f32(&sAf, &sCf);
+        else if(u32Kernel == K_INVERSE)
+            arm_mat_inverse_f32(&sAf, &sCf);
+        else
+            arm_mat_mult_f32(&sAf, &sBf, &sCf);
+        BENCH_STOP();
+    }
+    else if(psTest->u32Fmt == FMT_Q31)
+    {
+        arm_mat_init_q31(&sAq31, MAT_DIM, MAT_DIM, s_uIn.aq31);
+        arm_mat_init_q31(&sBq31, MAT_DIM, MAT_DIM, &s_uIn.aq31[BLOCK_LEN]);
+        arm_mat_init_q31(&sCq31, MAT_DIM, MAT_DIM, s_uOut.aq31);
+        BENCH_START();
+        if(u32Kernel == K_TRANS)
+            arm_mat_trans_q31(&sAq31, &sCq31);
+        else if(u32Kernel == K_FAST)
+            arm_mat_mult_fast_q31(&sAq31, &sBq31, &sCq31);
+        else
+            arm_mat_mult_q31(&sAq31, &sBq31, &sCq31);
+        BENCH_STOP();
+    }
+    else
+    {
+        arm_mat_init_q15(&sAq15, MAT_DIM, MAT_DIM, s_uIn.aq15);
+        arm_mat_init_q15(&sBq15, MAT_DIM, MAT_DIM, &s_uIn.aq15[BLOCK_LEN]);
+        arm_mat_init_q15(&sCq15, MAT_DIM, MAT_DIM, s_uOut.aq15);
+        BENCH_START();
+        if(u32Kernel == K_TRANS)
+            arm_mat_trans_q15(&sAq15, &sCq15);
+        else if(u32Kernel == K_FAST)
+            arm_mat_mult_fast_q15(&sAq15, &sBq15, &sCq15, s_uWork.aq15);
+        else
+            arm_mat_mult_q15(&sAq15, &sBq15, &sCq15, s_uWork.aq15);
+        BENCH_STOP();
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Statistics                                                                                             */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void SetupStats(const TEST_T *psTest)
+{
+    double dSum = 0.0, dSq = 0.0, dVar = 0.0;
+    uint32_t i;
+
+    /* arm_rms_q31() sums the 2.62 squares without guard bits: headroom for BLOCK_LEN of them */
+    for(i = 0; i < BLOCK_LEN; i++)
+        s_adRef[i] = (Signal(i) + 0.1) * ((psTest->u32Fmt == FMT_Q31 && psTest->u32Kernel == STAT_RMS) ? 1.0 / 32 : 1.0);
+    Quantize(psTest->u32Fmt, s_adRef, &s_uIn, s_adX, BLOCK_LEN);
+
+    s_adRef[STAT_MAX] = s_adRef[STAT_MIN] = s_adX[0];
+    s_adRef[STAT_MAX + 1] = s_adRef[STAT_MIN + 1] = 0.0;
+    for(i = 0; i < BLOCK_LEN; i++)
+    {
+        dSum += s_adX[i];
+        dSq += s_adX[i] * s_adX[i];
+        if(s_adX[i] > s_adRef[STAT_MAX])
+        {
+            s_adRef[STAT_MAX] = s_adX[i];
+            s_adRef[STAT_MAX + 1] = i;
+        }
+        if(s_adX[i] < s_adRef[STAT_MIN])
+        {
+            s_adRef[STAT_MIN] = s_adX[i];
+            s_adRef[STAT_MIN + 1] = i;
+        }
+    }
+    for(i = 0; i < BLOCK_LEN; i++)
+        dVar += (s_adX[i] - dSum / BLOCK_LEN) * (s_adX[i] - dSum / BLOCK_LEN);
+
+    s_adRef[STAT_MEAN] = dSum / BLOCK_LEN;
+    s_adRef[STAT_RMS] = sqrt(dSq / BLOCK_LEN);
+    s_adRef[STAT_VAR] = dVar / (BLOCK_LEN - 1);     /* CMSIS returns the sample variance */
+    s_adRef[STAT_STD] = sqrt(s_adRef[STAT_VAR]);
+    s_adRef[STAT_POWER] = dSq;
+
+    /* Value, and index for maximum and minimum */
+    SetOutput(s_adResult, FMT_F64, (psTest->u32Kernel >= STAT_MAX) ? 2 : 1, 1.0, &s_adRef[psTest->u32Kernel]);
+}
+
+static void RunStats(const TEST_T *psTest)
+{
+    uint32_t u32Fmt = psTest->u32Fmt, u32Idx = 0;
+    float32_t f32R = 0.0f;
+    q31_t q31R = 0;
+    q15_t q15R = 0;
+    q63_t q63R = 0;
+
+    BENCH_START();
+    switch(psTest->u32Kernel)
+    {
+        case STAT_MEAN:
+            if(u32Fmt == FMT_F32)
+                arm_mean_f32(s_uIn.af32, BLOCK_LEN, &f32R);
+            else if(u32Fmt == FMT_Q31)
+                arm_mean_q31(s_uIn.aq31, BLOCK_LEN, &q31R);
+            else
+                arm_mean_q15(s_uIn.aq15, BLOCK_LEN, &q15R);
+            break;
+        case STAT_RMS:
+            if(u32Fmt == FMT_F32)
+                arm_rms_f32(s_uIn.af32, BLOCK_LEN, &f32R);
+            else if(u32Fmt == FMT_Q31)
+                arm_rms_q31(s_uIn.aq31, BLOCK_LEN, &q31R);
+            else
+                arm_rms_q15(s_uIn.aq15, BLOCK_LEN, &q15R);
+            break;
+        case STAT_VAR:
+            if(u32Fmt == FMT_F32)
+                arm_var_f32(s_uIn.af32, BLOCK_LEN, &f32R);
+            else if(u32Fmt == FMT_Q31)
+                arm_var_q31(s_uIn.aq31, BLOCK_LEN, &q31R);
+            else
+                arm_var_q15(s_uIn.aq15, BLOCK_LEN, &q15R);
+            break;
+        case STAT_STD:
+            if(u32Fmt == FMT_F32)
+                arm_std_f32(s_uIn.af32, BLOCK_LEN, &f32R);
+            else if(u32Fmt == FMT_Q31)
+                arm_std_q31(s_uIn.aq31, BLOCK_LEN, &q31R);
+            else
+                arm_std_q15(s_uIn.aq15, BLOCK_LEN, &q15R);
+            break;
+        case STAT_POWER:
+            if(u32Fmt == FMT_F32)
+                arm_power_f32(s_uIn.af32, BLOCK_LEN, &f32R);
+            else if(u32Fmt == FMT_Q31)
+                arm_power_q31(s_uIn.aq31, BLOCK_LEN, &q63R);
+            else
+                arm_power_q15(s_uIn.aq15, BLOCK_LEN, &q63R);
+            break;
+        case STAT_MAX:
+            if(u32Fmt == FMT_F32)
+                arm_max_f32(s_uIn.af32, BLOCK_LEN, &f32R, &u32Idx);
+            else if(u32Fmt == FMT_Q31)
+                arm_max_q31(s_uIn.aq31, BLOCK_LEN, &q31R, &u32Idx);
+            else
+                arm_max_q15(s_uIn.aq15, BLOCK_LEN, &q15R, &u32Idx);
+            break;
+        default:
+            if(u32Fmt == FMT_F32)
+                arm_min_f32(s_uIn.af32, BLOCK_LEN, &f32R, &u32Idx);
+            else if(u32Fmt == FMT_Q31)
+                arm_min_q31(s_uIn.aq31, BLOCK_LEN, &q31R, &u32Idx);
+            else
+                arm_min_q15(s_uIn.aq15, BLOCK_LEN, &q15R, &u32Idx);
+            break;
+    }
+    BENCH_STOP();
+
+    if(u32Fmt == FMT_F32)
+        s_adResult[0] = f32R;
+    else if(psTest->u32Kernel == STAT_POWER)
+        s_adResult[0] = (double)q63R / ((u32Fmt == FMT_Q31) ? 281474976710656.0 : 1073741824.0);    /* 16.48, 34.30 */
+    else
+        s_adResult[0] = (u32Fmt == FMT_Q31) ? q31R / 2147483648.0 : q15R / 32768.0;
+    s_adResult[1] = u32Idx;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Test list and runner                                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static const TEST_T s_asTests[] =
+{
+    { "fir",                  FMT_F32, K_STD,      BLOCK_LEN, 120.0,     SetupFir,     RunFir     },
+    { "fir",                  FMT_Q31, K_STD,      BLOCK_LEN, 150.0,     SetupFir,     RunFir     },
+    { "fir_fast",             FMT_Q31, K_FAST,     BLOCK_LEN, 130.0,     SetupFir,     RunFir     },
+    { "fir",                  FMT_Q15, K_STD,      BLOCK_LEN, 70.0,      SetupFir,     RunFir     },
+    { "fir_fast",             FMT_Q15, K_FAST,     BLOCK_LEN, 70.0,      SetupFir,     RunFir     },
+    { "biquad_df1",           FMT_F32, K_STD,      BLOCK_LEN, 115.0,     SetupBiquad,  RunBiquad  },
+    { "biquad_df2T",          FMT_F32, K_DF2T,     BLOCK_LEN, 115.0,     SetupBiquad,  RunBiquad  },
+    { "biquad_df1",           FMT_Q31, K_STD,      BLOCK_LEN, 130.0,     SetupBiquad,  RunBiquad  },
+    { "biquad_df1_fast",      FMT_Q31, K_FAST,     BLOCK_LEN, 120.0,     SetupBiquad,  RunBiquad  },
+    { "biquad_df1_32x64",     FMT_Q31, K_32X64,    BLOCK_LEN, 140.0,     SetupBiquad,  RunBiquad  },
+    { "biquad_df1",           FMT_Q15, K_STD,      BLOCK_LEN, 55.0,      SetupBiquad,  RunBiquad  },
+    { "biquad_df1_fast",      FMT_Q15, K_FAST,     BLOCK_LEN, 55.0,      SetupBiquad,  RunBiquad  },
+    { "cfft_1024",            FMT_F32, K_STD,      BLOCK_LEN, 115.0,     SetupFft,     RunFft     },
+    { "cfft_radix4_1024",     FMT_F32, K_RADIX4,   BLOCK_LEN, 115.0,     SetupFft,     RunFft     },
+    { "cfft_1024",            FMT_Q31, K_STD,      BLOCK_LEN, 110.0,     SetupFft,     RunFft     },
+    { "cfft_1024",            FMT_Q15, K_STD,      BLOCK_LEN, 38.0,      SetupFft,     RunFft     },
+    { "rfft_fast_1024",       FMT_F32, K_RFFT,     BLOCK_LEN, 115.0,     SetupFft,     RunFft     },
+    { "rfft_1024",            FMT_Q31, K_RFFT,     BLOCK_LEN, 110.0,     SetupFft,     RunFft     },
+    { "rfft_1024",            FMT_Q15, K_RFFT,     BLOCK_LEN, 35.0,      SetupFft,     RunFft     },
+    { "mat_mult_32x32",       FMT_F32, K_STD,      BLOCK_LEN, 115.0,     SetupMatrix,  RunMatrix  },
+    { "mat_mult_32x32",       FMT_Q31, K_STD,      BLOCK_LEN, 140.0,     SetupMatrix,  RunMatrix  },
+    { "mat_mult_fast_32x32",  FMT_Q31, K_FAST,     BLOCK_LEN, 110.0,     SetupMatrix,  RunMatrix  },
+    { "mat_mult_32x32",       FMT_Q15, K_STD,      BLOCK_LEN, 60.0,      SetupMatrix,  RunMatrix  },
+    { "mat_mult_fast_32x32",  FMT_Q15, K_FAST,     BLOCK_LEN, 60.0,      SetupMatrix,  RunMatrix  },
+    { "mat_trans_32x32",      FMT_F32, K_TRANS,    BLOCK_LEN, SNR_EXACT, SetupMatrix,  RunMatrix  },
+    { "mat_trans_32x32",      FMT_Q31, K_TRANS,    BLOCK_LEN, SNR_EXACT, SetupMatrix,  RunMatrix  },
+    { "mat_trans_32x32",      FMT_Q15, K_TRANS,    BLOCK_LEN, SNR_EXACT, SetupMatrix,  RunMatrix  },
+    { "mat_inverse_32x32",    FMT_F32, K_INVERSE,  BLOCK_LEN, 110.0,     SetupMatrix,  RunMatrix  },
+    { "mean",                 FMT_F32, STAT_MEAN,  BLOCK_LEN, 110.0,     SetupStats,   RunStats   },
+    { "mean",                 FMT_Q31, STAT_MEAN,  BLOCK_LEN, 140.0,     SetupStats,   RunStats   },
+    { "mean",                 FMT_Q15, STAT_MEAN,  BLOCK_LEN, 65.0,      SetupStats,   RunStats   },
+    { "rms",                  FMT_F32, STAT_RMS,   BLOCK_LEN, 115.0,     SetupStats,   RunStats   },
+    { "rms",                  FMT_Q31, STAT_RMS,   BLOCK_LEN, 95.0,      SetupStats,   RunStats   },
+    { "rms",                  FMT_Q15, STAT_RMS,   BLOCK_LEN, 75.0,      SetupStats,   RunStats   },
+    { "var",                  FMT_F32, STAT_VAR,   BLOCK_LEN, 100.0,     SetupStats,   RunStats   },
+    { "var",                  FMT_Q31, STAT_VAR,   BLOCK_LEN, 130.0,     SetupStats,   RunStats   },
+    { "var",                  FMT_Q15, STAT_VAR,   BLOCK_LEN, 62.0,      SetupStats,   RunStats   },
+    { "std",                  FMT_F32, STAT_STD,   BLOCK_LEN, 105.0,     SetupStats,   RunStats   },
+    { "std",                  FMT_Q31, STAT_STD,   BLOCK_LEN, 135.0,     SetupStats,   RunStats   },
+    { "std",                  FMT_Q15, STAT_STD,   BLOCK_LEN, 65.0,      SetupStats,   RunStats   },
+    { "power",                FMT_F32, STAT_POWER, BLOCK_LEN, 105.0,     SetupStats,   RunStats   },
+    { "power",                FMT_Q31, STAT_POWER, BLOCK_LEN, 200.0,     SetupStats,   RunStats   },
+    { "power",                FMT_Q15, STAT_POWER, BLOCK_LEN, 200.0,     SetupStats,   RunStats   },
+    { "max",                  FMT_F32, STAT_MAX,   BLOCK_LEN, SNR_EXACT, SetupStats,   RunStats   },
+    { "max",                  FMT_Q31, STAT_MAX,   BLOCK_LEN, SNR_EXACT, SetupStats,   RunStats   },
+    { "max",                  FMT_Q15, STAT_MAX,   BLOCK_LEN, SNR_EXACT, SetupStats,   RunStats   },
+    { "min",                  FMT_F32, STAT_MIN,   BLOCK_LEN, SNR_EXACT, SetupStats,   RunStats   },
+    { "min",                  FMT_Q31, STAT_MIN,   BLOCK_LEN, SNR_EXACT, SetupStats,   RunStats   },
+    { "min",                  FMT_Q15, STAT_MIN,   BLOCK_LEN, SNR_EXACT, SetupStats,   RunStats   },
+};
+
+/**
+  * @brief      Checks and times every kernel whose name contains pcFilter
+  * @param[in]  u32Ms       Host: time spent repeating each kernel for its best run. Unused on the M480,
+  *                         which takes the best of BENCH_RUNS runs.
+  * @param[in]  pcFilter    Substring of the kernel names to run, NULL for all
+  * @return     Failed kernels
+  */
+uint32_t DSPBENCH_Run(uint32_t u32Ms, const char *pcFilter)
+{
+    static const char *apcFmt[] = { "f32", "q31", "q15" };
+    const TEST_T *psTest;
+    double dSnr, dBest;
+    uint32_t i;
+#ifdef DSPBENCH_M4
+    uint32_t u32Run;
+#else
+    uint64_t u64End;
+#endif
+
+    BenchInit();
+    s_u32Fails = 0;
+    printf("kernel                   fmt   SNR dB   min dB  %s/sample\n", BENCH_UNIT);
+
+    for(i = 0; i < sizeof(s_asTests) / sizeof(s_asTests[0]); i++)
+    {
+        psTest = &s_asTests[i];
+        if(pcFilter != NULL && strstr(psTest->pcName, pcFilter) == NULL)
+            continue;
+
+        psTest->pfnSetup(psTest);
+        s_dTicks = 0.0;
+        psTest->pfnRun(psTest);
+        dSnr = Snr();
+        dBest = s_dTicks;
+
+#ifdef DSPBENCH_M4
+        (void)u32Ms;
+        for(u32Run = 1; u32Run < BENCH_RUNS; u32Run++)
+#else
+        for(u64End = WallNs() + (uint64_t)u32Ms * 1000000ULL; WallNs() < u64End;)
+#endif
+        {
+            s_dTicks = 0.0;
+            psTest->pfnRun(psTest);
+            if(s_dTicks < dBest)
+                dBest = s_dTicks;
+        }
+
+        if(dSnr >= SNR_EXACT)
+            printf("%-24s %s    exact", psTest->pcName, apcFmt[psTest->u32Fmt]);
+        else
+            printf("%-24s %s %8.1f", psTest->pcName, apcFmt[psTest->u32Fmt], dSnr);
+        if(psTest->dMinSnr >= SNR_EXACT)
+            printf("    exact");
+        else
+            printf(" %8.1f", psTest->dMinSnr);
+        printf(" %10.2f", dBest / psTest->u32Samples);
+
+        if(dSnr < psTest->dMinSnr)
+        {
+            printf("  FAIL");
+            s_u32Fails++;
+        }
+        printf("\n");
+    }
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails;
+}
+
+#ifndef DSPBENCH_M4
+int main(int argc, char **argv)
+{
+    uint32_t u32Ms = (argc > 1) ? (uint32_t)atoi(argv[1]) : 20;
+
+    return DSPBENCH_Run(u32Ms, (argc > 2) ? argv[2] : NULL) ? 1 : 0;
+}
+#endif
@@ -0,0 +1,48 @@
+/**************************************************************************//**
+ * @file     arm_bitreversal.c
+ * @version  V1.00
+ * @brief    Portable C stand-in for the CMSIS-DSP bit reversal, for the host DSP tools.
+ *
+ * The library's bit reversal is ARM assembly (DSP_Lib/Source/TransformFunctions/arm_bitreversal2.S),
+ * so a host build of the generic C kernels (ARM_MATH_CM0) needs these. The tables are the library's:
+ * offsets of the complex values to swap, in pairs, in bytes of 32-bit complex data. The q15 data
+ * has half the element size and 16-bit elements, so its offsets are a quarter of the table values.
+ *
+ * Used by Tool/DspBench, Tool/SpectrumBench and Tool/FilterBankBench: add
+ * ../DspCommon/arm_bitreversal.c to their cc line.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+
+void arm_bitreversal_32(uint32_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTable)
+{
+    uint32_t i, a, b, t;
+
+    for(i = 0; i < bitRevLen; i += 2)
+    {
+        a = pBitRevTable[i] >> 2;
+        b = pBitRevTable[i + 1] >> 2;
+        t = pSrc[a];
+        pSrc[a] = pSrc[b];
+        pSrc[b] = t;
+        t = pSrc[a + 1];
+        pSrc[a + 1] = pSrc[b + 1];
+        pSrc[b + 1] = t;
+    }
+}
+
+void arm_bitreversal_16(uint16_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTable)
+{
+    uint32_t i, a, b, t;
+
+    for(i = 0; i < bitRevLen; i += 2)
+    {
+        a = pBitRevTable[i] >> 2;
+        b = pBitRevTable[i + 1] >> 2;
+        memcpy(&t, &pSrc[a], 4);
+        memcpy(&pSrc[a], &pSrc[b], 4);
+        memcpy(&pSrc[b], &t, 4);
+    }
+}
@@ -0,0 +1,442 @@
+/**************************************************************************//**
+ * @file     filterbankbench.c
+ * @version  V1.00
+ * @brief    Regression check and benchmark of the interleaved multi-channel filter bank
+ *           (StdDriver/src/fbank.c) against the per channel CMSIS-DSP kernels.
+ *
+ * Interleaved 8 slot frames, as I2S_ConfigureTDM() delivers them, are filtered in blocks of 64 frames
+ * by the interleaved kernels and, channel by channel after a de-interleave copy, by
+ * arm_biquad_cascade_df1_q31/q15() and arm_fir_q31/q15() with the same coefficients. The input stays
+ * clear of saturation, so the outputs must be identical. The filter bank is then checked in use: a
+ * +6 dB peaking equalizer in place and a 3-way Linkwitz-Riley crossover, whose bands must sum to the
+ * input amplitude within 0.1 dB at any frequency.
+ *
+ * Last, both ways are timed for 4 and 8 channels: the interleaved kernel against de-interleave,
+ * one CMSIS call per channel and re-interleave. The interleaved kernel must not be the slower one.
+ * ARM_MATH_CM0 selects the generic C kernels of the library; on the M480 the SIMD (ARM_MATH_CM4)
+ * kernels run instead, so only the ratios carry over.
+ * The Q15 ratios less so: without the DSP extension arm_math.h saturates with a loop, which the CMSIS
+ * kernels run for every output and fbank.c replaces with clip_q31_to_q15().
+ * The library's bit reversal is ARM assembly; ../DspCommon/arm_bitreversal.c stands in for it.
+ *
+ * Build:  D=../../Library/CMSIS/DSP_Lib/Source
+ *         cc -O2 -DARM_MATH_CM0 -fno-strict-aliasing -I../../Library/CMSIS/Include
+ *             -I../../Library/StdDriver/inc -o filterbankbench filterbankbench.c
+ *             ../../Library/StdDriver/src/fbank.c ../DspCommon/arm_bitreversal.c $(find $D -name '*.c') -lm
+ *
+ * Usage:  filterbankbench [ms per measurement]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "fbank.h"
+
+#define FS              48000.0f
+#define SLOTS           8UL             /* TDM slots per frame */
+#define BLOCK           64UL            /* Frames per call */
+#define BLOCKS          64UL            /* Blocks per regression run */
+#define FRAMES          (BLOCK * BLOCKS)
+#define STAGES          2UL
+#define TAPS            32UL
+
+static uint32_t s_u32Fails;
+static uint32_t s_u32Seed = 12345;
+
+static q31_t s_aq31In[FRAMES * SLOTS], s_aq31Out[FRAMES * SLOTS], s_aq31Ref[FRAMES * SLOTS];
+static q15_t s_aq15In[FRAMES * SLOTS], s_aq15Out[FRAMES * SLOTS], s_aq15Ref[FRAMES * SLOTS];
+
+/* Per channel CMSIS instances and buffers */
+static arm_biquad_casd_df1_inst_q31 s_asBiqQ31[SLOTS];
+static arm_biquad_casd_df1_inst_q15 s_asBiqQ15[SLOTS];
+static arm_fir_instance_q31 s_asFirQ31[SLOTS];
+static arm_fir_instance_q15 s_asFirQ15[SLOTS];
+static q31_t s_aq31BiqState[SLOTS][4 * STAGES], s_aq31FirState[SLOTS][TAPS + BLOCK - 1];
+static q15_t s_aq15BiqState[SLOTS][4 * STAGES], s_aq15FirState[SLOTS][TAPS + BLOCK - 1];
+static q31_t s_aq31ChIn[BLOCK], s_aq31ChOut[BLOCK];
+static q15_t s_aq15ChIn[BLOCK], s_aq15ChOut[BLOCK];
+
+/* Interleaved instances */
+static FBANK_BIQUAD_Q31_T s_sBiqQ31;
+static FBANK_BIQUAD_Q15_T s_sBiqQ15;
+static FBANK_FIR_Q31_T s_sFirQ31;
+static FBANK_FIR_Q15_T s_sFirQ15;
+static q31_t s_aq31IBiqState[FBANK_BIQUAD_STATE_LEN(SLOTS, STAGES)];
+static q15_t s_aq15IBiqState[FBANK_BIQUAD_STATE_LEN(SLOTS, STAGES)];
+static q31_t s_aq31IFirState[FBANK_FIR_STATE_LEN(SLOTS, TAPS, BLOCK)];
+static q15_t s_aq15IFirState[FBANK_FIR_STATE_LEN(SLOTS, TAPS, BLOCK)];
+
+/* Coefficients */
+static q31_t s_aq31Biq[5 * STAGES], s_aq31Fir[TAPS];
+static q15_t s_aq15Biq[6 * STAGES], s_aq15Fir[TAPS];
+#define POST_SHIFT      1
+
+static FBANK_T s_sBank;
+
+static uint64_t WallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+/* Uniform in [-1, 1) */
+static double Random(void)
+{
+    s_u32Seed = s_u32Seed * 1103515245UL + 12345UL;
+    return (double)(s_u32Seed >> 8) / 8388608.0 - 1.0;
+}
+
+static void MakeInput(double dAmp)
+{
+    uint32_t i;
+
+    for(i = 0; i < FRAMES * SLOTS; i++)
+    {
+        s_aq31In[i] = (q31_t)(Random() * dAmp * 2147483648.0);
+        s_aq15In[i] = (q15_t)(Random() * dAmp * 32768.0);
+    }
+}
+
+/* A low shelf and a peak, both with gain, so a1 / a2 and the post shift are exercised */
+static void MakeCoeffs(void)
+{
+    static const FBANK_SECTION_T asSec[STAGES] =
+    {
+        { FBANK_LOWSHELF, 200.0f, 0.7071f, 6.0f },
+        { FBANK_PEAK, 3000.0f, 2.0f, -4.0f },
+    };
+    float32_t af32C[5];
+    uint32_t i, j;
+
+    for(i = 0; i < STAGES; i++)
+    {
+        Check(FBANK_Design(&asSec[i], FS, af32C) == FBANK_OK, "design");
+        for(j = 0; j < 5; j++)
+        {
+            s_aq31Biq[5 * i + j] = (q31_t)lrint(af32C[j] * (2147483648.0 / (1 << POST_SHIFT)));
+            s_aq15Biq[6 * i + j + (j > 0)] = (q15_t)lrint(af32C[j] * (32768.0 / (1 << POST_SHIFT)));
+        }
+        s_aq15Biq[6 * i + 1] = 0;
+    }
+
+    /* Random taps, sum of magnitudes below one */
+    for(i = 0; i < TAPS; i++)
+    {
+        s_aq31Fir[i] = (q31_t)(Random() * (2147483648.0 / TAPS));
+        s_aq15Fir[i] = (q15_t)(Random() * (32768.0 / TAPS));
+    }
+}
+
+static void InitAll(uint32_t u32Ch)
+{
+    uint32_t c;
+
+    for(c = 0; c < u32Ch; c++)
+    {
+        arm_biquad_cascade_df1_init_q31(&s_asBiqQ31[c], STAGES, s_aq31Biq, s_aq31BiqState[c], POST_SHIFT);
+        arm_biquad_cascade_df1_init_q15(&s_asBiqQ15[c], STAGES, s_aq15Biq, s_aq15BiqState[c], POST_SHIFT);
+        arm_fir_init_q31(&s_asFirQ31[c], TAPS, s_aq31Fir, s_aq31FirState[c], BLOCK);
+        arm_fir_init_q15(&s_asFirQ15[c], TAPS, s_aq15Fir, s_aq15FirState[c], BLOCK);
+    }
+    FBANK_BiquadInitQ31(&s_sBiqQ31, (uint8_t)u32Ch, STAGES, s_aq31Biq, s_aq31IBiqState, POST_SHIFT);
+    FBANK_BiquadInitQ15(&s_sBiqQ15, (uint8_t)u32Ch, STAGES, s_aq15Biq, s_aq15IBiqState, POST_SHIFT);
+    FBANK_FirInitQ31(&s_sFirQ31, (uint8_t)u32Ch, TAPS, s_aq31Fir, s_aq31IFirState, BLOCK);
+    FBANK_FirInitQ15(&s_sFirQ15, (uint8_t)u32Ch, TAPS, s_aq15Fir, s_aq15IFirState, BLOCK);
+}
+
+/* ---------------------------------------------------------------------------
+ * One block of u32Ch channels of SLOTS slot frames, both ways. u32Kernel:
+ * 0 biquad Q31, 1 biquad Q15, 2 FIR Q31, 3 FIR Q15.
+ * ------------------------------------------------------------------------ */
+static void RunInterleaved(uint32_t u32Kernel, uint32_t u32Frame, uint32_t u32Ch)
+{
+    uint32_t o = u32Frame * SLOTS;
+
+    (void)u32Ch;
+    switch(u32Kernel)
+    {
+    case 0:
+        FBANK_BiquadQ31(&s_sBiqQ31, &s_aq31In[o], SLOTS, &s_aq31Out[o], SLOTS, BLOCK);
+        break;
+    case 1:
+        FBANK_BiquadQ15(&s_sBiqQ15, &s_aq15In[o], SLOTS, &s_aq15Out[o], SLOTS, BLOCK);
+        break;
+    case 2:
+        FBANK_FirQ31(&s_sFirQ31, &s_aq31In[o], SLOTS, &s_aq31Out[o], SLOTS, BLOCK);
+        break;
+    default:
+        FBANK_FirQ15(&s_sFirQ15, &s_aq15In[o], SLOTS, &s_aq15Out[o], SLOTS, BLOCK);
+        break;
+    }
+}
+
+static void RunPerChannel(uint32_t u32Kernel, uint32_t u32Frame, uint32_t u32Ch)
+{
+    uint32_t o = u32Frame * SLOTS, c, n;
+
+    for(c = 0; c < u32Ch; c++)
+    {
+        if(u32Kernel == 0 || u32Kernel == 2)
+        {
+            for(n = 0; n < BLOCK; n++)
+                s_aq31ChIn[n] = s_aq31In[o + n * SLOTS + c];
+            if(u32Kernel == 0)
+                arm_biquad_cascade_df1_q31(&s_asBiqQ31[c], s_aq31ChIn, s_aq31ChOut, BLOCK);
+            else
+                arm_fir_q31(&s_asFirQ31[c], s_aq31ChIn, s_aq31ChOut, BLOCK);
+            for(n = 0; n < BLOCK; n++)
+                s_aq31Ref[o + n * SLOTS + c] = s_aq31ChOut[n];
+        }
+        else
+        {
+            for(n = 0; n < BLOCK; n++)
+                s_aq15ChIn[n] = s_aq15In[o + n * SLOTS + c];
+            if(u32Kernel == 1)
+                arm_biquad_cascade_df1_q15(&s_asBiqQ15[c], s_aq15ChIn, s_aq15ChOut, BLOCK);
+            else
+                arm_fir_q15(&s_asFirQ15[c], s_aq15ChIn, s_aq15ChOut, BLOCK);
+            for(n = 0; n < BLOCK; n++)
+                s_aq15Ref[o + n * SLOTS + c] = s_aq15ChOut[n];
+        }
+    }
+}
+
+static const char *s_apcKernel[] = { "biquad Q31", "biquad Q15", "FIR Q31", "FIR Q15" };
+
+/* The filtered channels must match, the other slots must be untouched */
+static void CheckExact(uint32_t u32Kernel, uint32_t u32Ch)
+{
+    uint32_t b, i, u32Diff = 0, u32Touched = 0;
+    char acWhat[64];
+
+    InitAll(u32Ch);
+    memset(s_aq31Out, 0x55, sizeof(s_aq31Out));
+    memset(s_aq15Out, 0x55, sizeof(s_aq15Out));
+    memset(s_aq31Ref, 0x55, sizeof(s_aq31Ref));
+    memset(s_aq15Ref, 0x55, sizeof(s_aq15Ref));
+    for(b = 0; b < BLOCKS; b++)
+    {
+        RunInterleaved(u32Kernel, b * BLOCK, u32Ch);
+        RunPerChannel(u32Kernel, b * BLOCK, u32Ch);
+    }
+    for(i = 0; i < FRAMES * SLOTS; i++)
+    {
+        if(u32Kernel == 0 || u32Kernel == 2)
+            u32Diff += (s_aq31Out[i] != s_aq31Ref[i]);
+        else
+            u32Diff += (s_aq15Out[i] != s_aq15Ref[i]);
+        if((i % SLOTS) >= u32Ch)
+            u32Touched += (u32Kernel == 0 || u32Kernel == 2) ? (s_aq31Out[i] != 0x55555555) : (s_aq15Out[i] != 0x5555);
+    }
+    snprintf(acWhat, sizeof(acWhat), "%s %u ch: %u samples differ", s_apcKernel[u32Kernel], u32Ch, u32Diff);
+    Check(u32Diff == 0, acWhat);
+    snprintf(acWhat, sizeof(acWhat), "%s %u ch: %u unused slots written", s_apcKernel[u32Kernel], u32Ch, u32Touched);
+    Check(u32Touched == 0, acWhat);
+}
+
+/* ---------------------------------------------------------------------------
+ * Filter bank in use
+ * ------------------------------------------------------------------------ */
+
+/* Amplitude of a sine of f32Freq from its samples at pq31X, u32Stride apart, after settling */
+static double Amplitude(const q31_t *pq31X, uint32_t u32Stride, float32_t f32Freq)
+{
+    double dI = 0.0, dQ = 0.0, dW = 2.0 * M_PI * f32Freq / FS;
+    uint32_t n, u32Start = FRAMES / 2, u32Len;
+
+    /* Whole periods */
+    u32Len = (uint32_t)(floor((FRAMES - u32Start) * f32Freq / FS) * FS / f32Freq);
+    for(n = u32Start; n < u32Start + u32Len; n++)
+    {
+        dI += pq31X[n * u32Stride] * cos(dW * n);
+        dQ += pq31X[n * u32Stride] * sin(dW * n);
+    }
+    return 2.0 * sqrt(dI * dI + dQ * dQ) / u32Len / 2147483648.0;
+}
+
+static void MakeSine(float32_t f32Freq, double dAmp, uint32_t u32Ch)
+{
+    uint32_t n, c;
+
+    for(n = 0; n < FRAMES; n++)
+    {
+        for(c = 0; c < SLOTS; c++)
+        {
+            s_aq31In[n * SLOTS + c] = (c < u32Ch) ? (q31_t)lrint(dAmp * sin(2.0 * M_PI * f32Freq * n / FS) * 2147483648.0) : 0;
+            s_aq15In[n * SLOTS + c] = (q15_t)(s_aq31In[n * SLOTS + c] >> 16);
+        }
+    }
+}
+
+static void CheckEQ(void)
+{
+    static const FBANK_SECTION_T sPeak = { FBANK_PEAK, 1000.0f, 1.0f, 6.0f };
+    static const float32_t af32Freq[] = { 100.0f, 1000.0f, 10000.0f };
+    uint32_t i, n;
+    double dGain;
+    char acWhat[64];
+
+    Check(FBANK_Open(&s_sBank, FBANK_Q15, 4, FS) == FBANK_OK, "open");
+    Check(FBANK_SetEQ(&s_sBank, &sPeak, 1) == FBANK_OK, "set EQ");
+
+    for(i = 0; i < 3; i++)
+    {
+        FBANK_Reset(&s_sBank);
+        MakeSine(af32Freq[i], 0.25, 4);
+        for(n = 0; n < FRAMES; n += BLOCK)
+            FBANK_Process(&s_sBank, &s_aq15In[n * SLOTS], SLOTS, &s_aq15In[n * SLOTS], SLOTS, BLOCK);
+        for(n = 0; n < FRAMES * SLOTS; n++)
+            s_aq31Out[n] = (q31_t)s_aq15In[n] * 65536;
+        dGain = 20.0 * log10(Amplitude(&s_aq31Out[3], SLOTS, af32Freq[i]) / 0.25);
+        snprintf(acWhat, sizeof(acWhat), "EQ gain %.0f Hz %.2f dB", af32Freq[i], dGain);
+        Check(fabs(dGain - ((i == 1) ? 6.0 : 0.0)) < ((i == 1) ? 0.1 : 0.5), acWhat);
+        Check(s_aq15In[4] == 0 && s_aq15In[FRAMES * SLOTS - 1] == 0, "EQ unused slots");
+    }
+}
+
+static void CheckCrossover(void)
+{
+    static const float32_t af32Split[] = { 300.0f, 3000.0f };
+    static const float32_t af32Freq[] = { 50.0f, 300.0f, 1000.0f, 3000.0f, 12000.0f };
+    uint32_t i, n, b;
+    double dSum, adBand[3];
+    char acWhat[96];
+
+    Check(FBANK_Open(&s_sBank, FBANK_Q31, 2, FS) == FBANK_OK, "open");
+    Check(FBANK_SetCrossover(&s_sBank, af32Split, 3) == FBANK_OK, "set crossover");
+
+    for(i = 0; i < sizeof(af32Freq) / sizeof(af32Freq[0]); i++)
+    {
+        FBANK_Reset(&s_sBank);
+        MakeSine(af32Freq[i], 0.25, 2);
+        for(n = 0; n < FRAMES; n += BLOCK)
+            FBANK_Process(&s_sBank, &s_aq31In[n * SLOTS], SLOTS, &s_aq31Out[n * SLOTS], SLOTS, BLOCK);
+
+        /* Channel 1 of band b is slot 2b + 1; the sum goes to slot 7 */
+        for(n = 0; n < FRAMES; n++)
+            s_aq31Out[n * SLOTS + 7] = s_aq31Out[n * SLOTS + 1] + s_aq31Out[n * SLOTS + 3] + s_aq31Out[n * SLOTS + 5];
+        for(b = 0; b < 3; b++)
+            adBand[b] = 20.0 * log10(Amplitude(&s_aq31Out[2 * b + 1], SLOTS, af32Freq[i]) / 0.25 + 1e-9);
+        dSum = 20.0 * log10(Amplitude(&s_aq31Out[7], SLOTS, af32Freq[i]) / 0.25);
+        snprintf(acWhat, sizeof(acWhat), "crossover %.0f Hz: sum %.3f dB, bands %.1f %.1f %.1f dB",
+                 af32Freq[i], dSum, adBand[0], adBand[1], adBand[2]);
+        Check(fabs(dSum) < 0.1, acWhat);
+        /* -6 dB at a split, the band of a tone between splits well above the others */
+        if(af32Freq[i] == af32Split[0])
+            Check(fabs(adBand[0] + 6.02) < 0.2 && fabs(adBand[1] + 6.02) < 0.2, acWhat);
+        else if(af32Freq[i] == af32Split[1])
+            Check(fabs(adBand[1] + 6.02) < 0.2 && fabs(adBand[2] + 6.02) < 0.2, acWhat);
+        else
+        {
+            b = (af32Freq[i] < af32Split[0]) ? 0 : (af32Freq[i] < af32Split[1]) ? 1 : 2;
+            Check(adBand[b] > -1.0 && adBand[(b + 1) % 3] < -12.0 && adBand[(b + 2) % 3] < -12.0, acWhat);
+        }
+    }
+}
+
+static void CheckParams(void)
+{
+    static const FBANK_SECTION_T sBad = { FBANK_PEAK, 30000.0f, 1.0f, 0.0f };
+    static const float32_t af32Down[] = { 3000.0f, 300.0f };
+    FBANK_SECTION_T asMany[FBANK_MAX_STAGES + 1];
+
+    memset(asMany, 0, sizeof(asMany));
+    Check(FBANK_Open(&s_sBank, 2, 2, FS) == FBANK_ERR_PARAM, "open bad format");
+    Check(FBANK_Open(&s_sBank, FBANK_Q31, FBANK_MAX_CH + 1, FS) == FBANK_ERR_PARAM, "open too many channels");
+    Check(FBANK_Open(&s_sBank, FBANK_Q31, 2, FS) == FBANK_OK, "open");
+    Check(FBANK_SetEQ(&s_sBank, &sBad, 1) == FBANK_ERR_PARAM, "EQ above Nyquist");
+    Check(FBANK_SetEQ(&s_sBank, asMany, FBANK_MAX_STAGES + 1) == FBANK_ERR_PARAM, "EQ too many sections");
+    Check(FBANK_SetCrossover(&s_sBank, af32Down, 3) == FBANK_ERR_PARAM, "crossover descending");
+    Check(FBANK_SetCrossover(&s_sBank, af32Down, FBANK_MAX_BANDS + 1) == FBANK_ERR_PARAM, "crossover too many bands");
+
+    /* Without sections, the bank copies */
+    MakeInput(0.5);
+    FBANK_Process(&s_sBank, s_aq31In, SLOTS, s_aq31Out, SLOTS, BLOCK);
+    Check(s_aq31Out[0] == s_aq31In[0] && s_aq31Out[(BLOCK - 1) * SLOTS + 1] == s_aq31In[(BLOCK - 1) * SLOTS + 1],
+          "open bank copies");
+}
+
+/* ---------------------------------------------------------------------------
+ * Timing: ns per frame, the best of many passes over FRAMES. The two ways take
+ * turns, so whatever else runs on the host slows both alike.
+ * ------------------------------------------------------------------------ */
+static void Time(uint32_t u32Kernel, uint32_t u32Ch, uint32_t u32Ms, double *pdInter, double *pdPer)
+{
+    uint64_t u64End, u64Ns, u64Inter = UINT64_MAX, u64Per = UINT64_MAX;
+    uint32_t b;
+
+    InitAll(u32Ch);
+    u64End = WallNs() + (uint64_t)u32Ms * 1000000ULL;
+    do
+    {
+        u64Ns = WallNs();
+        for(b = 0; b < BLOCKS; b++)
+            RunInterleaved(u32Kernel, b * BLOCK, u32Ch);
+        u64Ns = WallNs() - u64Ns;
+        if(u64Ns < u64Inter)
+            u64Inter = u64Ns;
+
+        u64Ns = WallNs();
+        for(b = 0; b < BLOCKS; b++)
+            RunPerChannel(u32Kernel, b * BLOCK, u32Ch);
+        u64Ns = WallNs() - u64Ns;
+        if(u64Ns < u64Per)
+            u64Per = u64Ns;
+    }
+    while(WallNs() < u64End);
+
+    *pdInter = (double)u64Inter / (double)FRAMES;
+    *pdPer = (double)u64Per / (double)FRAMES;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t u32Ms = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200;
+    uint32_t u32Kernel, u32Ch;
+    double dInter, dPer;
+    char acWhat[64];
+
+    MakeCoeffs();
+    MakeInput(0.25);
+    for(u32Kernel = 0; u32Kernel < 4; u32Kernel++)
+    {
+        CheckExact(u32Kernel, SLOTS);
+        CheckExact(u32Kernel, 6);
+        CheckExact(u32Kernel, 1);
+    }
+    CheckEQ();
+    CheckCrossover();
+    CheckParams();
+
+    MakeInput(0.25);
+    Time(0, SLOTS, u32Ms, &dInter, &dPer);      /* warm up, the first measurement would pay for the clock ramp */
+    printf("kernel      ch  interleaved ns/frame  per channel ns/frame  speedup\n");
+    for(u32Kernel = 0; u32Kernel < 4; u32Kernel++)
+    {
+        for(u32Ch = 4; u32Ch <= SLOTS; u32Ch += 4)
+        {
+            Time(u32Kernel, u32Ch, u32Ms, &dInter, &dPer);
+            printf("%-10s %3u %21.1f %21.1f %8.2f\n", s_apcKernel[u32Kernel], u32Ch, dInter, dPer, dPer / dInter);
+            snprintf(acWhat, sizeof(acWhat), "%s %u ch: interleaved slower than per channel", s_apcKernel[u32Kernel], u32Ch);
+            Check(dInter <= dPer, acWhat);
+        }
+    }
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
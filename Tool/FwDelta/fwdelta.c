@@ -0,0 +1,691 @@
+/**************************************************************************//**
+ * @file     fwdelta.c
+ * @version  V1.00
+ * @brief    Host generator and checker for delta firmware update patches (fwdelta.h).
+ *
+ * Creates a patch that turns an old APROM image into a new one. Matching is the
+ * bsdiff approach: a suffix array of the old image finds long matches, which are
+ * extended into approximate matches whose byte differences are mostly zero. The
+ * differences are run length coded in the patch instead of compressed, so the
+ * device needs no decompressor and only one page of RAM.
+ *
+ * "apply" and "test" run the device decoder (Library/StdDriver/src/fwdelta.c)
+ * itself. "test" round-trips a pair of real images: it feeds the patch in random
+ * chunk sizes, restarts the decoder from every page checkpoint as if power had
+ * failed there, and compares the result and the header CRCs.
+ *
+ * Build:  cc -O2 -I../../Library/StdDriver/inc -o fwdelta fwdelta.c ../../Library/StdDriver/src/fwdelta.c
+ *
+ * Usage:  fwdelta diff old.bin new.bin patch.fwd
+ *         fwdelta apply old.bin patch.fwd out.bin
+ *         fwdelta test old.bin new.bin [seed]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "fwdelta.h"
+
+#define PAGE_SIZE       4096    /* FMC_FLASH_PAGE_SIZE, the device output window */
+#define ZERO_RUN_MIN    3       /* Shorter zero runs inside differences are sent as literals */
+
+typedef struct
+{
+    uint8_t  *pu8Data;
+    uint32_t u32Len;
+    uint32_t u32Cap;
+} BUF_T;
+
+static void BufPut(BUF_T *psBuf, const void *pvData, uint32_t u32Len)
+{
+    if (psBuf->u32Len + u32Len > psBuf->u32Cap)
+    {
+        psBuf->u32Cap = (psBuf->u32Len + u32Len) * 2 + 256;
+        psBuf->pu8Data = realloc(psBuf->pu8Data, psBuf->u32Cap);
+        if (psBuf->pu8Data == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    memcpy(psBuf->pu8Data + psBuf->u32Len, pvData, u32Len);
+    psBuf->u32Len += u32Len;
+}
+
+static void BufByte(BUF_T *psBuf, uint8_t u8Val)
+{
+    BufPut(psBuf, &u8Val, 1);
+}
+
+static void BufVarint(BUF_T *psBuf, uint32_t u32Val)
+{
+    while (u32Val >= 0x80)
+    {
+        BufByte(psBuf, (uint8_t)(u32Val | 0x80));
+        u32Val >>= 7;
+    }
+    BufByte(psBuf, (uint8_t)u32Val);
+}
+
+static uint8_t *ReadFile(const char *pcName, uint32_t *pu32Len)
+{
+    FILE *fp = fopen(pcName, "rb");
+    uint8_t *pu8Data;
+    long lLen;
+
+    if (fp == NULL)
+    {
+        perror(pcName);
+        exit(2);
+    }
+    fseek(fp, 0, SEEK_END);
+    lLen = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    pu8Data = malloc(lLen + 1);
+    if ((pu8Data == NULL) || (fread(pu8Data, 1, lLen, fp) != (size_t)lLen))
+    {
+        fprintf(stderr, "%s: read failed\n", pcName);
+        exit(2);
+    }
+    fclose(fp);
+    *pu32Len = (uint32_t)lLen;
+    return pu8Data;
+}
+
+static void WriteFile(const char *pcName, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    FILE *fp = fopen(pcName, "wb");
+
+    if ((fp == NULL) || (fwrite(pu8Data, 1, u32Len, fp) != u32Len) || fclose(fp))
+    {
+        perror(pcName);
+        exit(2);
+    }
+}
+
+/* CRC of the image padded with 0xFF to FWDELTA_CRC_ALIGN, as FMC_GetChkSum() sees it in flash */
+static uint32_t ImageCrc(const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint8_t au8Ff[FWDELTA_CRC_ALIGN];
+    uint32_t u32Crc = FWDELTA_Crc32(0, pu8Data, u32Len);
+    uint32_t u32Pad = (FWDELTA_CRC_ALIGN - u32Len % FWDELTA_CRC_ALIGN) % FWDELTA_CRC_ALIGN;
+
+    memset(au8Ff, 0xFF, sizeof(au8Ff));
+    return FWDELTA_Crc32(u32Crc, au8Ff, u32Pad);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Suffix array, Larsson-Sadakane qsufsort                                                                */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Split(int32_t *I, int32_t *V, int32_t start, int32_t len, int32_t h)
+{
+    int32_t i, j, k, x, tmp, jj, kk;
+
+    if (len < 16)
+    {
+        for (k = start; k < start + len; k += j)
+        {
+            j = 1;
+            x = V[I[k] + h];
+            for (i = 1; k + i < start + len; i++)
+            {
+                if (V[I[k + i] + h] < x)
+                {
+                    x = V[I[k + i] + h];
+                    j = 0;
+                }
+                if (V[I[k + i] + h] == x)
+                {
+                    tmp = I[k + j];
+                    I[k + j] = I[k + i];
+                    I[k + i] = tmp;
+                    j++;
+                }
+            }
+            for (i = 0; i < j; i++)
+                V[I[k + i]] = k + j - 1;
+            if (j == 1)
+                I[k] = -1;
+        }
+        return;
+    }
+
+    x = V[I[start + len / 2] + h];
+    jj = 0;
+    kk = 0;
+    for (i = start; i < start + len; i++)
+    {
+        if (V[I[i] + h] < x)
+            jj++;
+        if (V[I[i] + h] == x)
+            kk++;
+    }
+    jj += start;
+    kk += jj;
+
+    i = start;
+    j = 0;
+    k = 0;
+    while (i < jj)
+    {
+        if (V[I[i] + h] < x)
+        {
+            i++;
+        }
+        else if (V[I[i] + h] == x)
+        {
+            tmp = I[i];
+            I[i] = I[jj + j];
+            I[jj + j] = tmp;
+            j++;
+        }
+        else
+        {
+            tmp = I[i];
+            I[i] = I[kk + k];
+            I[kk + k] = tmp;
+            k++;
+        }
+    }
+    while (jj + j < kk)
+    {
+        if (V[I[jj + j] + h] == x)
+        {
+            j++;
+        }
+        else
+        {
+            tmp = I[jj + j];
+            I[jj + j] = I[kk + k];
+            I[kk + k] = tmp;
+            k++;
+        }
+    }
+
+    if (jj > start)
+        Split(I, V, start, jj - start, h);
+
+    for (i = 0; i < kk - jj; i++)
+        V[I[jj + i]] = kk - 1;
+    if (jj == kk - 1)
+        I[jj] = -1;
+
+    if (start + len > kk)
+        Split(I, V, kk, start + len - kk, h);
+}
+
+static void SuffixSort(int32_t *I, int32_t *V, const uint8_t *old, int32_t oldsize)
+{
+    int32_t buckets[256];
+    int32_t i, h, len;
+
+    memset(buckets, 0, sizeof(buckets));
+    for (i = 0; i < oldsize; i++)
+        buckets[old[i]]++;
+    for (i = 1; i < 256; i++)
+        buckets[i] += buckets[i - 1];
+    for (i = 255; i > 0; i--)
+        buckets[i] = buckets[i - 1];
+    buckets[0] = 0;
+
+    for (i = 0; i < oldsize; i++)
+        I[++buckets[old[i]]] = i;
+    I[0] = oldsize;
+    for (i = 0; i < oldsize; i++)
+        V[i] = buckets[old[i]];
+    V[oldsize] = 0;
+    for (i = 1; i < 256; i++)
+        if (buckets[i] == buckets[i - 1] + 1)
+            I[buckets[i]] = -1;
+    I[0] = -1;
+
+    for (h = 1; I[0] != -(oldsize + 1); h += h)
+    {
+        len = 0;
+        for (i = 0; i < oldsize + 1;)
+        {
+            if (I[i] < 0)
+            {
+                len -= I[i];
+                i -= I[i];
+            }
+            else
+            {
+                if (len)
+                    I[i - len] = -len;
+                len = V[I[i]] + 1 - i;
+                Split(I, V, i, len, h);
+                i += len;
+                len = 0;
+            }
+        }
+        if (len)
+            I[i - len] = -len;
+    }
+
+    for (i = 0; i < oldsize + 1; i++)
+        I[V[i]] = i;
+}
+
+static int32_t MatchLen(const uint8_t *a, int32_t alen, const uint8_t *b, int32_t blen)
+{
+    int32_t i;
+
+    for (i = 0; (i < alen) && (i < blen); i++)
+        if (a[i] != b[i])
+            break;
+    return i;
+}
+
+static int32_t Search(const int32_t *I, const uint8_t *old, int32_t oldsize,
+                      const uint8_t *new, int32_t newsize, int32_t st, int32_t en, int32_t *pos)
+{
+    int32_t x, y, n;
+
+    while (en - st >= 2)
+    {
+        x = st + (en - st) / 2;
+        n = (oldsize - I[x] < newsize) ? oldsize - I[x] : newsize;
+        if (memcmp(old + I[x], new, n) < 0)
+            st = x;
+        else
+            en = x;
+    }
+    x = MatchLen(old + I[st], oldsize - I[st], new, newsize);
+    y = MatchLen(old + I[en], oldsize - I[en], new, newsize);
+    if (x > y)
+    {
+        *pos = I[st];
+        return x;
+    }
+    *pos = I[en];
+    return y;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Patch generator                                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+static void EmitDiff(BUF_T *psBody, const uint8_t *old, int32_t oldpos, const uint8_t *new, int32_t newpos,
+                     int32_t len, int32_t seek)
+{
+    uint8_t u8Diff;
+    int32_t i = 0, z, l, zr;
+
+    BufByte(psBody, FWDELTA_OP_DIFF);
+    BufVarint(psBody, (uint32_t)len);
+    BufVarint(psBody, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31));
+
+    while (i < len)
+    {
+        for (z = 0; (i + z < len) && (new[newpos + i + z] == old[oldpos + i + z]); z++)
+            ;
+        BufVarint(psBody, (uint32_t)z);
+        i += z;
+        if (i == len)
+            break;
+
+        /* Literal run up to a zero run worth its two varints, or the end */
+        for (l = 0; i + l < len; l++)
+        {
+            for (zr = 0; (zr < ZERO_RUN_MIN) && (i + l + zr < len) &&
+                    (new[newpos + i + l + zr] == old[oldpos + i + l + zr]); zr++)
+                ;
+            if ((zr == ZERO_RUN_MIN) || ((zr > 0) && (i + l + zr == len)))
+                break;
+        }
+        BufVarint(psBody, (uint32_t)l);
+        for (z = 0; z < l; z++)
+        {
+            u8Diff = (uint8_t)(new[newpos + i + z] - old[oldpos + i + z]);
+            BufByte(psBody, u8Diff);
+        }
+        i += l;
+    }
+}
+
+static void MakePatch(const uint8_t *old, int32_t oldsize, const uint8_t *new, int32_t newsize, BUF_T *psPatch)
+{
+    int32_t *I, *V;
+    int32_t scan, pos = 0, len, lastscan, lastpos, lastoffset, oldscore, scsc;
+    int32_t s, Sf, lenf, Sb, lenb, overlap, Ss, lens, i;
+    int32_t seek = 0, extra;
+    BUF_T sBody = { 0 };
+    FWDELTA_HDR_T sHdr;
+    uint8_t au8Hdr[FWDELTA_HDR_SIZE];
+
+    I = malloc((oldsize + 1) * sizeof(int32_t));
+    V = malloc((oldsize + 1) * sizeof(int32_t));
+    if ((I == NULL) || (V == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    SuffixSort(I, V, old, oldsize);
+    free(V);
+
+    scan = 0;
+    len = 0;
+    lastscan = 0;
+    lastpos = 0;
+    lastoffset = 0;
+    while (scan < newsize)
+    {
+        oldscore = 0;
+        for (scsc = scan += len; scan < newsize; scan++)
+        {
+            len = Search(I, old, oldsize, new + scan, newsize - scan, 0, oldsize, &pos);
+
+            for (; scsc < scan + len; scsc++)
+                if ((scsc + lastoffset < oldsize) && (old[scsc + lastoffset] == new[scsc]))
+                    oldscore++;
+
+            if (((len == oldscore) && (len != 0)) || (len > oldscore + 8))
+                break;
+
+            if ((scan + lastoffset < oldsize) && (old[scan + lastoffset] == new[scan]))
+                oldscore--;
+        }
+
+        if ((len != oldscore) || (scan == newsize))
+        {
+            /* Extend the previous match forwards and this one backwards while at least half matches */
+            s = 0;
+            Sf = 0;
+            lenf = 0;
+            for (i = 0; (lastscan + i < scan) && (lastpos + i < oldsize);)
+            {
+                if (old[lastpos + i] == new[lastscan + i])
+                    s++;
+                i++;
+                if (s * 2 - i > Sf * 2 - lenf)
+                {
+                    Sf = s;
+                    lenf = i;
+                }
+            }
+
+            lenb = 0;
+            if (scan < newsize)
+            {
+                s = 0;
+                Sb = 0;
+                for (i = 1; (scan >= lastscan + i) && (pos >= i); i++)
+                {
+                    if (old[pos - i] == new[scan - i])
+                        s++;
+                    if (s * 2 - i > Sb * 2 - lenb)
+                    {
+                        Sb = s;
+                        lenb = i;
+                    }
+                }
+            }
+
+            if (lastscan + lenf > scan - lenb)
+            {
+                overlap = (lastscan + lenf) - (scan - lenb);
+                s = 0;
+                Ss = 0;
+                lens = 0;
+                for (i = 0; i < overlap; i++)
+                {
+                    if (new[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i])
+                        s++;
+                    if (new[scan - lenb + i] == old[pos - lenb + i])
+                        s--;
+                    if (s > Ss)
+                    {
+                        Ss = s;
+                        lens = i + 1;
+                    }
+                }
+                lenf += lens - overlap;
+                lenb -= lens;
+            }
+
+            /* DIFF seeks before it reads; a skipped DIFF carries its seek to the next one */
+            if (lenf > 0)
+            {
+                EmitDiff(&sBody, old, lastpos, new, lastscan, lenf, seek);
+                seek = 0;
+            }
+            extra = (scan - lenb) - (lastscan + lenf);
+            if (extra > 0)
+            {
+                BufByte(&sBody, FWDELTA_OP_INSERT);
+                BufVarint(&sBody, (uint32_t)extra);
+                BufPut(&sBody, new + lastscan + lenf, (uint32_t)extra);
+            }
+            seek += (pos - lenb) - (lastpos + lenf);
+
+            lastscan = scan - lenb;
+            lastpos = pos - lenb;
+            lastoffset = pos - scan;
+        }
+    }
+    BufByte(&sBody, FWDELTA_OP_END);
+    free(I);
+
+    memset(&sHdr, 0, sizeof(sHdr));
+    sHdr.u32OldSize = (uint32_t)oldsize;
+    sHdr.u32OldCrc = ImageCrc(old, (uint32_t)oldsize);
+    sHdr.u32NewSize = (uint32_t)newsize;
+    sHdr.u32NewCrc = ImageCrc(new, (uint32_t)newsize);
+    sHdr.u32BodySize = sBody.u32Len;
+    FWDELTA_PackHeader(&sHdr, au8Hdr);
+
+    psPatch->u32Len = 0;
+    BufPut(psPatch, au8Hdr, FWDELTA_HDR_SIZE);
+    BufPut(psPatch, sBody.pu8Data, sBody.u32Len);
+    free(sBody.pu8Data);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Patch application with the device decoder                                                              */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    const uint8_t *pu8Old;
+    uint8_t  *pu8Out;           /* New image, stands in for the flash slot */
+    FWDELTA_DEC_T *psDec;
+    FWDELTA_POS_T *psCkpt;      /* Checkpoints taken at full pages, NULL if not recorded */
+    uint32_t u32Ckpts;
+} APPLY_T;
+
+static int32_t HostOld(void *pvArg, uint32_t u32Off, uint8_t *pu8Dst, uint32_t u32Len)
+{
+    APPLY_T *psApply = pvArg;
+
+    memcpy(pu8Dst, psApply->pu8Old + u32Off, u32Len);
+    return FWDELTA_OK;
+}
+
+static int32_t HostFlush(void *pvArg, uint32_t u32Off, const uint8_t *pu8Win, uint32_t u32Len)
+{
+    APPLY_T *psApply = pvArg;
+
+    memcpy(psApply->pu8Out + u32Off, pu8Win, u32Len);
+    if ((psApply->psCkpt != NULL) && (u32Len == PAGE_SIZE))
+        psApply->psCkpt[psApply->u32Ckpts++] = psApply->psDec->sPos;
+    return FWDELTA_OK;
+}
+
+/* Feeds the commands from u32InPos in chunks of 1 ~ u32MaxChunk bytes, random if u32MaxChunk > 1 */
+static int32_t Apply(FWDELTA_DEC_T *psDec, const uint8_t *pu8Body, uint32_t u32BodyLen,
+                     uint32_t u32InPos, uint32_t u32MaxChunk)
+{
+    int32_t i32Ret = FWDELTA_OK;
+    uint32_t u32Chunk;
+
+    while ((u32InPos < u32BodyLen) && (i32Ret == FWDELTA_OK))
+    {
+        u32Chunk = (u32MaxChunk > 1) ? 1 + (uint32_t)rand() % u32MaxChunk : u32BodyLen;
+        if (u32Chunk > u32BodyLen - u32InPos)
+            u32Chunk = u32BodyLen - u32InPos;
+        i32Ret = FWDELTA_Decode(psDec, pu8Body + u32InPos, u32Chunk);
+        u32InPos += u32Chunk;
+    }
+    return i32Ret;
+}
+
+static int32_t ApplyPatch(const uint8_t *pu8Old, uint32_t u32OldLen, const uint8_t *pu8Patch, uint32_t u32PatchLen,
+                          uint8_t **ppu8Out, FWDELTA_HDR_T *psHdr)
+{
+    static uint8_t au8Win[PAGE_SIZE];
+    FWDELTA_DEC_T sDec;
+    APPLY_T sApply;
+    int32_t i32Ret;
+
+    if ((u32PatchLen < FWDELTA_HDR_SIZE) || (FWDELTA_ParseHeader(pu8Patch, psHdr) != FWDELTA_OK))
+        return FWDELTA_ERR_FORMAT;
+    if ((psHdr->u32OldSize != u32OldLen) || (ImageCrc(pu8Old, u32OldLen) != psHdr->u32OldCrc))
+        return FWDELTA_ERR_OLD;
+
+    memset(&sApply, 0, sizeof(sApply));
+    sApply.pu8Old = pu8Old;
+    sApply.pu8Out = malloc(psHdr->u32NewSize + 1);
+    sApply.psDec = &sDec;
+    sDec.pu8Win = au8Win;
+    sDec.u32WinSize = PAGE_SIZE;
+    sDec.pvArg = &sApply;
+    sDec.pfnOld = HostOld;
+    sDec.pfnFlush = HostFlush;
+    FWDELTA_DecInit(&sDec, psHdr);
+
+    i32Ret = Apply(&sDec, pu8Patch + FWDELTA_HDR_SIZE, u32PatchLen - FWDELTA_HDR_SIZE, 0, 0);
+    if (i32Ret != FWDELTA_DONE)
+    {
+        free(sApply.pu8Out);
+        return (i32Ret < 0) ? i32Ret : FWDELTA_ERR_FORMAT;
+    }
+    if (ImageCrc(sApply.pu8Out, psHdr->u32NewSize) != psHdr->u32NewCrc)
+    {
+        free(sApply.pu8Out);
+        return FWDELTA_ERR_VERIFY;
+    }
+    *ppu8Out = sApply.pu8Out;
+    return FWDELTA_OK;
+}
+
+static int CmdTest(const uint8_t *pu8Old, uint32_t u32OldLen, const uint8_t *pu8New, uint32_t u32NewLen)
+{
+    static uint8_t au8Win[PAGE_SIZE];
+    BUF_T sPatch = { 0 };
+    FWDELTA_HDR_T sHdr;
+    FWDELTA_DEC_T sDec;
+    APPLY_T sApply;
+    FWDELTA_POS_T *psCkpt;
+    const uint8_t *pu8Body;
+    uint32_t u32BodyLen, u32Pages, i;
+    uint8_t *pu8Out;
+    int32_t i32Ret;
+
+    MakePatch(pu8Old, (int32_t)u32OldLen, pu8New, (int32_t)u32NewLen, &sPatch);
+    printf("old %u bytes, new %u bytes, patch %u bytes", u32OldLen, u32NewLen, sPatch.u32Len);
+    if (u32NewLen)
+        printf(" (%.1f%% of new)", 100.0 * sPatch.u32Len / u32NewLen);
+    printf("\n");
+
+    /* Whole patch in one call */
+    i32Ret = ApplyPatch(pu8Old, u32OldLen, sPatch.pu8Data, sPatch.u32Len, &pu8Out, &sHdr);
+    if ((i32Ret != FWDELTA_OK) || memcmp(pu8Out, pu8New, u32NewLen))
+    {
+        printf("FAIL: apply returned %d\n", (int)i32Ret);
+        return 1;
+    }
+    free(pu8Out);
+
+    /* Random chunks, recording the checkpoints */
+    pu8Body = sPatch.pu8Data + FWDELTA_HDR_SIZE;
+    u32BodyLen = sPatch.u32Len - FWDELTA_HDR_SIZE;
+    u32Pages = u32NewLen / PAGE_SIZE;
+    memset(&sApply, 0, sizeof(sApply));
+    sApply.pu8Old = pu8Old;
+    sApply.pu8Out = calloc(1, u32NewLen + 1);
+    sApply.psDec = &sDec;
+    psCkpt = malloc((u32Pages + 1) * sizeof(FWDELTA_POS_T));
+    sApply.psCkpt = psCkpt;
+    sDec.pu8Win = au8Win;
+    sDec.u32WinSize = PAGE_SIZE;
+    sDec.pvArg = &sApply;
+    sDec.pfnOld = HostOld;
+    sDec.pfnFlush = HostFlush;
+    FWDELTA_DecInit(&sDec, &sHdr);
+    i32Ret = Apply(&sDec, pu8Body, u32BodyLen, 0, 97);
+    if ((i32Ret != FWDELTA_DONE) || memcmp(sApply.pu8Out, pu8New, u32NewLen) || (sApply.u32Ckpts != u32Pages))
+    {
+        printf("FAIL: chunked apply returned %d, %u checkpoints\n", (int)i32Ret, sApply.u32Ckpts);
+        return 1;
+    }
+
+    /* Power failure after every page: restart from the checkpoint with the pages after it lost */
+    sApply.psCkpt = NULL;
+    for (i = 0; i < sApply.u32Ckpts; i++)
+    {
+        FWDELTA_POS_T sPos = psCkpt[i];
+
+        memset(sApply.pu8Out + sPos.u32OutPos, 0xA5, u32NewLen - sPos.u32OutPos);
+        FWDELTA_DecInit(&sDec, &sHdr);
+        sDec.sPos = sPos;
+        i32Ret = Apply(&sDec, pu8Body, u32BodyLen, sPos.u32InPos, 61);
+        if ((i32Ret != FWDELTA_DONE) || memcmp(sApply.pu8Out, pu8New, u32NewLen))
+        {
+            printf("FAIL: resume at page %u returned %d\n", i + 1, (int)i32Ret);
+            return 1;
+        }
+    }
+
+    printf("PASS: whole, chunked and %u resumed applies match\n", sApply.u32Ckpts);
+    free(psCkpt);
+    free(sApply.pu8Out);
+    free(sPatch.pu8Data);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t *pu8Old, *pu8New, *pu8Patch, *pu8Out;
+    uint32_t u32OldLen, u32NewLen, u32PatchLen;
+    FWDELTA_HDR_T sHdr;
+    BUF_T sPatch = { 0 };
+    int32_t i32Ret;
+
+    if ((argc >= 5) && !strcmp(argv[1], "diff"))
+    {
+        pu8Old = ReadFile(argv[2], &u32OldLen);
+        pu8New = ReadFile(argv[3], &u32NewLen);
+        MakePatch(pu8Old, (int32_t)u32OldLen, pu8New, (int32_t)u32NewLen, &sPatch);
+        WriteFile(argv[4], sPatch.pu8Data, sPatch.u32Len);
+        printf("%s: %u bytes for a %u byte image\n", argv[4], sPatch.u32Len, u32NewLen);
+        return 0;
+    }
+    if ((argc >= 5) && !strcmp(argv[1], "apply"))
+    {
+        pu8Old = ReadFile(argv[2], &u32OldLen);
+        pu8Patch = ReadFile(argv[3], &u32PatchLen);
+        i32Ret = ApplyPatch(pu8Old, u32OldLen, pu8Patch, u32PatchLen, &pu8Out, &sHdr);
+        if (i32Ret != FWDELTA_OK)
+        {
+            fprintf(stderr, "%s: apply failed (%d)\n", argv[3], (int)i32Ret);
+            return 1;
+        }
+        WriteFile(argv[4], pu8Out, sHdr.u32NewSize);
+        return 0;
+    }
+    if ((argc >= 4) && !strcmp(argv[1], "test"))
+    {
+        srand((argc >= 5) ? (unsigned)strtoul(argv[4], NULL, 0) : 1u);
+        pu8Old = ReadFile(argv[2], &u32OldLen);
+        pu8New = ReadFile(argv[3], &u32NewLen);
+        return CmdTest(pu8Old, u32OldLen, pu8New, u32NewLen);
+    }
+
+    fprintf(stderr, "usage: fwdelta diff old.bin new.bin patch.fwd\n"
+            "       fwdelta apply old.bin patch.fwd out.bin\n"
+            "       fwdelta test old.bin new.bin [seed]\n");
+    return 2;
+}
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   FreeRTOS configuration for the HeapBench host build
+ *
+ * Only what FreeRTOS.h and the heap sources need; no scheduler runs on the host.
+ */
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#define configUSE_PREEMPTION                1
+#define configUSE_IDLE_HOOK                 0
+#define configUSE_TICK_HOOK                 0
+#define configCPU_CLOCK_HZ                  ( 192000000UL )
+#define configTICK_RATE_HZ                  ( ( TickType_t ) 1000 )
+#define configMAX_PRIORITIES                ( 5 )
+#define configMINIMAL_STACK_SIZE            ( ( unsigned short ) 128 )
+#define configTOTAL_HEAP_SIZE               ( ( size_t ) ( 256 * 1024 ) )
+#define configMAX_TASK_NAME_LEN             ( 16 )
+#define configUSE_16_BIT_TICKS              0
+#define configUSE_MUTEXES                   1
+#define configUSE_MALLOC_FAILED_HOOK        0
+#define configSUPPORT_DYNAMIC_ALLOCATION    1
+#define INCLUDE_xTaskGetCurrentTaskHandle   1
+
+#define configHEAP_TLSF_MAX_REGIONS         3
+
+/* A failed assertion is reported by heapbench.c, which then exits with FAIL */
+void vAssertCalled( const char *pcFile, int iLine );
+#define configASSERT( x )                   if( ( x ) == 0 ) vAssertCalled( __FILE__, __LINE__ )
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   heap_4 for the HeapBench host build, renamed so it links next to heap_tlsf
+ *
+ * The allocator source is included unchanged; the functions below read its statics to check the
+ * free list and to find the largest free block.
+ */
+#define pvPortMalloc                        pvHeap4Malloc
+#define vPortFree                           vHeap4Free
+#define xPortGetFreeHeapSize                xHeap4GetFreeHeapSize
+#define xPortGetMinimumEverFreeHeapSize     xHeap4GetMinimumEverFreeHeapSize
+#define vPortInitialiseBlocks               vHeap4InitialiseBlocks
+
+#include "../../ThirdParty/FreeRTOS/Source/portable/MemMang/heap_4.c"
+
+/* Free list in address order, no two free blocks adjacent, sizes add up to the free byte count */
+int Heap4Check(void)
+{
+    BlockLink_t *pxBlock;
+    size_t xSum = 0;
+
+    if(pxEnd == NULL)
+        return 1;
+
+    for(pxBlock = xStart.pxNextFreeBlock; pxBlock != pxEnd; pxBlock = pxBlock->pxNextFreeBlock)
+    {
+        if(pxBlock == NULL || (pxBlock->xBlockSize & xBlockAllocatedBit) != 0)
+            return 0;
+        if(pxBlock->xBlockSize == 0 || (pxBlock->xBlockSize & portBYTE_ALIGNMENT_MASK) != 0)
+            return 0;
+        /* The last block may end at the end marker, any other must leave a gap to the next */
+        if((uint8_t *)pxBlock + pxBlock->xBlockSize > (uint8_t *)pxBlock->pxNextFreeBlock)
+            return 0;
+        if(pxBlock->pxNextFreeBlock != pxEnd &&
+           (uint8_t *)pxBlock + pxBlock->xBlockSize == (uint8_t *)pxBlock->pxNextFreeBlock)
+            return 0;
+        xSum += pxBlock->xBlockSize;
+    }
+    return xSum == xFreeBytesRemaining;
+}
+
+size_t Heap4LargestFree(void)
+{
+    BlockLink_t *pxBlock;
+    size_t xLargest = 0;
+
+    if(pxEnd == NULL)
+        return 0;
+    for(pxBlock = xStart.pxNextFreeBlock; pxBlock != pxEnd; pxBlock = pxBlock->pxNextFreeBlock)
+    {
+        if(pxBlock->xBlockSize > xLargest)
+            xLargest = pxBlock->xBlockSize;
+    }
+    return xLargest ? xLargest - xHeapStructSize : 0;
+}
+
+/* Back to the state before the first pvPortMalloc(), which initialises the heap again */
+void Heap4Reset(void)
+{
+    pxEnd = NULL;
+    xFreeBytesRemaining = 0;
+    xMinimumEverFreeBytesRemaining = 0;
+    xBlockAllocatedBit = 0;
+}
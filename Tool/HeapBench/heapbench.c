@@ -0,0 +1,523 @@
+/**************************************************************************//**
+ * @file     heapbench.c
+ * @version  V1.00
+ * @brief    Host test and benchmark of the FreeRTOS heap_tlsf allocator against heap_4.
+ *
+ * heap_4.c (renamed in heap4_host.c) and heap_tlsf.c run unchanged on the host, with stubs for the
+ * scheduler calls they make. Each heap gets the same random sequence of pvPortMalloc() and
+ * vPortFree() calls over 512 slots: a random slot is freed if it is in use, otherwise a block is
+ * allocated into it. 70% of the requests are 8-128 bytes, 25% 128-2K and 5% 2K-16K, so the heap
+ * runs full and fragments. Three configurations are run: heap_4 with one 256 KB array, heap_tlsf
+ * with one 256 KB region, and heap_tlsf with 96 KB + 32 KB + 128 KB regions, where half of the
+ * large requests go to the last region through pvPortMallocFromRegion(), like buffers placed in
+ * EBI SRAM.
+ *
+ * Every block is filled with a pattern that is verified before it is freed, and every 64 calls
+ * the allocator's own structures are checked: for heap_4 the address-ordered free list, for
+ * heap_tlsf the physical block chain, the segregated lists and the bitmaps of every region.
+ * Reported per configuration: average and worst fragmentation (1 - largest free block / free
+ * bytes, sampled while more than 16 KB is free), requests that failed although enough bytes
+ * were free, and the average, 99.9th percentile and worst cost of a malloc and a free in TSC
+ * cycles (nanoseconds on hosts without a TSC). The worst case includes host interrupts; the
+ * percentile is the figure to compare. Block overheads are those of the 64-bit host build.
+ *
+ * Last, the per-task accounting of heap_tlsf is run with six tasks that allocate and free each
+ * other's blocks and are deleted and recreated through vPortHeapTaskDeleted(), half of them with
+ * the handle of the deleted task. The current bytes of all entries must add up to the allocated
+ * bytes, a recreated task must start with an entry of its own, and the table must never spill
+ * into the overflow entry.
+ *
+ * Build:  cc -O2 -I. -I../../ThirdParty/FreeRTOS/Source/include
+ *             -I../../ThirdParty/FreeRTOS/Source/portable/MemMang
+ *             -o heapbench heapbench.c heap4_host.c tlsf_host.c
+ *
+ * Usage:  heapbench [calls per configuration] [seed]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "FreeRTOS.h"
+#include "task.h"
+#include "heap_tlsf.h"
+
+#define NUM_SLOTS           512
+#define CHECK_INTERVAL      64
+#define FRAG_MIN_FREE       (16 * 1024)
+#define LARGE_SIZE          2048
+#define HEAP_SIZE           (256 * 1024)
+
+#define NUM_TASKS           6
+#define NUM_TCBS            64
+#define TASK_SLOTS          128
+#define DELETE_INTERVAL     400
+
+typedef struct
+{
+    const char *pcName;
+    void (*pfnInit)(void);
+    void *(*pfnMalloc)(size_t xSize, int iLarge);
+    void (*pfnFree)(void *pv);
+    size_t (*pfnFreeBytes)(void);
+    size_t (*pfnLargest)(void);
+    int (*pfnCheck)(void);
+} HEAP_T;
+
+typedef struct
+{
+    uint8_t *pu8Data;
+    size_t xSize;
+    uint8_t u8Fill;
+} SLOT_T;
+
+/* heap4_host.c */
+void *pvHeap4Malloc(size_t xWantedSize);
+void vHeap4Free(void *pv);
+size_t xHeap4GetFreeHeapSize(void);
+int Heap4Check(void);
+size_t Heap4LargestFree(void);
+void Heap4Reset(void);
+
+/* tlsf_host.c */
+int TlsfCheck(void);
+size_t TlsfLargestFree(void);
+void TlsfReset(void);
+
+static uint32_t s_u32Fails;
+static uint32_t s_u32Rand;
+static TaskHandle_t s_xCurrentTask;
+static SLOT_T s_asSlot[NUM_SLOTS];
+static uint32_t s_au32MallocCost[1 << 20];
+static uint32_t s_au32FreeCost[1 << 20];
+static uint64_t s_au64Region0[96 * 1024 / 8];
+static uint64_t s_au64Region1[32 * 1024 / 8];
+static uint64_t s_au64Region2[128 * 1024 / 8];
+static uint64_t s_au64Single[HEAP_SIZE / 8];
+static uint8_t s_au8Tcb[NUM_TCBS][16];
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+void vAssertCalled(const char *pcFile, int iLine)
+{
+    printf("FAIL configASSERT at %s:%d\n", pcFile, iLine);
+    printf("FAIL\n");
+    exit(1);
+}
+
+/* Scheduler calls made by the heaps; the host is single threaded */
+void vTaskSuspendAll(void)
+{
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    return pdFALSE;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_xCurrentTask;
+}
+
+static uint32_t Rand(void)
+{
+    /* xorshift32 */
+    s_u32Rand ^= s_u32Rand << 13;
+    s_u32Rand ^= s_u32Rand >> 17;
+    s_u32Rand ^= s_u32Rand << 5;
+    return s_u32Rand;
+}
+
+static size_t RandSize(void)
+{
+    uint32_t u32Class = Rand() % 100;
+
+    if(u32Class < 70)
+        return 8 + Rand() % 121;
+    if(u32Class < 95)
+        return 128 + Rand() % 1921;
+    return 2048 + Rand() % 14337;
+}
+
+static inline uint64_t Now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec sTs;
+
+    clock_gettime(CLOCK_MONOTONIC, &sTs);
+    return (uint64_t)sTs.tv_sec * 1000000000u + sTs.tv_nsec;
+#endif
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* The three configurations                                                                                */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Heap4Init(void)
+{
+    Heap4Reset();
+}
+
+static void *Heap4Malloc(size_t xSize, int iLarge)
+{
+    (void)iLarge;
+    return pvHeap4Malloc(xSize);
+}
+
+static void TlsfSingleInit(void)
+{
+    HeapRegion_t asRegions[] =
+    {
+        { (uint8_t *)s_au64Single, sizeof(s_au64Single) },
+        { NULL, 0 }
+    };
+
+    TlsfReset();
+    vPortDefineHeapRegions(asRegions);
+}
+
+static void TlsfRegionsInit(void)
+{
+    HeapRegion_t asRegions[] =
+    {
+        { (uint8_t *)s_au64Region0, sizeof(s_au64Region0) },
+        { (uint8_t *)s_au64Region1, sizeof(s_au64Region1) },
+        { (uint8_t *)s_au64Region2, sizeof(s_au64Region2) },
+        { NULL, 0 }
+    };
+
+    TlsfReset();
+    vPortDefineHeapRegions(asRegions);
+}
+
+static void *TlsfMalloc(size_t xSize, int iLarge)
+{
+    (void)iLarge;
+    return pvPortMalloc(xSize);
+}
+
+static void *TlsfRegionsMalloc(size_t xSize, int iLarge)
+{
+    if(iLarge)
+        return pvPortMallocFromRegion(2, xSize);
+    return pvPortMalloc(xSize);
+}
+
+static const HEAP_T s_asHeap[] =
+{
+    { "heap_4    1 x 256K", Heap4Init, Heap4Malloc, vHeap4Free, xHeap4GetFreeHeapSize, Heap4LargestFree, Heap4Check },
+    { "heap_tlsf 1 x 256K", TlsfSingleInit, TlsfMalloc, vPortFree, xPortGetFreeHeapSize, TlsfLargestFree, TlsfCheck },
+    { "heap_tlsf 96+32+128K", TlsfRegionsInit, TlsfRegionsMalloc, vPortFree, xPortGetFreeHeapSize, TlsfLargestFree, TlsfCheck },
+};
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Random alloc/free run                                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+static int CompareCost(const void *pv1, const void *pv2)
+{
+    uint32_t u32A = *(const uint32_t *)pv1, u32B = *(const uint32_t *)pv2;
+
+    return (u32A > u32B) - (u32A < u32B);
+}
+
+static void ReportCost(const char *pcWhat, uint32_t *pu32Cost, uint32_t u32Num)
+{
+    uint64_t u64Sum = 0;
+    uint32_t i;
+
+    if(u32Num == 0)
+        return;
+    for(i = 0; i < u32Num; i++)
+        u64Sum += pu32Cost[i];
+    qsort(pu32Cost, u32Num, sizeof(pu32Cost[0]), CompareCost);
+    printf("  %-6s avg %6.0f  p99.9 %6u  max %7u\n", pcWhat, (double)u64Sum / u32Num,
+           pu32Cost[(uint64_t)u32Num * 999 / 1000], pu32Cost[u32Num - 1]);
+}
+
+static int VerifySlot(const SLOT_T *psSlot)
+{
+    size_t i;
+
+    for(i = 0; i < psSlot->xSize; i++)
+    {
+        if(psSlot->pu8Data[i] != (uint8_t)(psSlot->u8Fill + i))
+            return 0;
+    }
+    return 1;
+}
+
+static void RunHeap(const HEAP_T *psHeap, uint32_t u32Calls, uint32_t u32Seed)
+{
+    uint32_t u32Call, u32Mallocs = 0, u32Frees = 0, u32Failed = 0, u32FragFailed = 0, u32Bad = 0;
+    size_t xInitial, xFree, xLargest;
+    double dFrag, dWorstFrag = 0.0, dFragSum = 0.0;
+    uint32_t u32FragSamples = 0;
+    uint64_t u64T0;
+    SLOT_T *psSlot;
+    void *pv;
+    int iBroken = 0;
+    unsigned int i;
+
+    s_u32Rand = u32Seed;
+    memset(s_asSlot, 0, sizeof(s_asSlot));
+    psHeap->pfnInit();
+
+    /* heap_4 sets itself up on the first call */
+    pv = psHeap->pfnMalloc(8, 0);
+    psHeap->pfnFree(pv);
+    xInitial = psHeap->pfnFreeBytes();
+
+    for(u32Call = 0; u32Call < u32Calls; u32Call++)
+    {
+        psSlot = &s_asSlot[Rand() % NUM_SLOTS];
+        if(psSlot->pu8Data != NULL)
+        {
+            if(!VerifySlot(psSlot))
+                u32Bad++;
+            u64T0 = Now();
+            psHeap->pfnFree(psSlot->pu8Data);
+            s_au32FreeCost[u32Frees++] = (uint32_t)(Now() - u64T0);
+            psSlot->pu8Data = NULL;
+        }
+        else
+        {
+            size_t xSize = RandSize();
+            int iLarge = xSize >= LARGE_SIZE && (Rand() & 1);
+
+            xFree = psHeap->pfnFreeBytes();
+            u64T0 = Now();
+            pv = psHeap->pfnMalloc(xSize, iLarge);
+            s_au32MallocCost[u32Mallocs++] = (uint32_t)(Now() - u64T0);
+            if(pv == NULL)
+            {
+                u32Failed++;
+                /* Enough bytes for the block and its header were free, just not in one piece */
+                if(xFree >= xSize + 64)
+                    u32FragFailed++;
+            }
+            else
+            {
+                psSlot->pu8Data = pv;
+                psSlot->xSize = xSize;
+                psSlot->u8Fill = (uint8_t)Rand();
+                for(i = 0; i < xSize; i++)
+                    psSlot->pu8Data[i] = (uint8_t)(psSlot->u8Fill + i);
+            }
+        }
+
+        if(u32Call % CHECK_INTERVAL == 0)
+        {
+            if(!iBroken && !psHeap->pfnCheck())
+            {
+                printf("  free list check failed after %u calls\n", u32Call);
+                iBroken = 1;
+            }
+            xFree = psHeap->pfnFreeBytes();
+            if(xFree > FRAG_MIN_FREE)
+            {
+                xLargest = psHeap->pfnLargest();
+                dFrag = 1.0 - (double)xLargest / xFree;
+                dFragSum += dFrag;
+                u32FragSamples++;
+                if(dFrag > dWorstFrag)
+                    dWorstFrag = dFrag;
+            }
+        }
+    }
+
+    for(i = 0; i < NUM_SLOTS; i++)
+    {
+        if(s_asSlot[i].pu8Data != NULL)
+        {
+            if(!VerifySlot(&s_asSlot[i]))
+                u32Bad++;
+            psHeap->pfnFree(s_asSlot[i].pu8Data);
+        }
+    }
+
+    printf("%s: %u mallocs, %u failed (%u with enough bytes free), fragmentation avg %.1f%% worst %.1f%%\n",
+           psHeap->pcName, u32Mallocs, u32Failed, u32FragFailed,
+           u32FragSamples ? dFragSum * 100.0 / u32FragSamples : 0.0, dWorstFrag * 100.0);
+#if defined(__x86_64__) || defined(__i386__)
+    printf("  cost in TSC cycles\n");
+#else
+    printf("  cost in ns\n");
+#endif
+    ReportCost("malloc", s_au32MallocCost, u32Mallocs);
+    ReportCost("free", s_au32FreeCost, u32Frees);
+
+    Check(!iBroken, "allocator structures corrupted");
+    Check(psHeap->pfnCheck(), "allocator structures corrupted after freeing everything");
+    Check(u32Bad == 0, "block contents overwritten");
+    Check(psHeap->pfnFreeBytes() == xInitial, "free bytes not back to the initial value");
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Per-task accounting of heap_tlsf                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+static UBaseType_t CheckStats(size_t xAllocated, int *piOk)
+{
+    TaskHeapStats_t asStats[configHEAP_TLSF_TASK_STATS_ENTRIES + 1];
+    UBaseType_t uxNum, ux;
+    size_t xSum = 0;
+
+    uxNum = uxPortGetAllTaskHeapStats(asStats, configHEAP_TLSF_TASK_STATS_ENTRIES + 1);
+    for(ux = 0; ux < uxNum; ux++)
+    {
+        xSum += asStats[ux].xCurrentBytes;
+        if(asStats[ux].xTask == heapTLSF_OVERFLOW_TASK)
+            *piOk = 0;
+    }
+    if(xSum != xAllocated)
+        *piOk = 0;
+    return uxNum;
+}
+
+static void TestTaskStats(uint32_t u32Calls, uint32_t u32Seed)
+{
+    TaskHandle_t axTask[NUM_TASKS];
+    uint32_t au32Allocs[NUM_TASKS];
+    TaskHeapStats_t sStats;
+    size_t xInitial;
+    UBaseType_t uxEntries, uxMaxEntries = 0;
+    uint32_t u32Call, u32Deleted = 0, u32Reused = 0, u32NextTcb = NUM_TASKS;
+    int iSumOk = 1, iCountOk = 1, iGoneOk = 1, iEndOk = 1;
+    unsigned int i, k;
+
+    s_u32Rand = u32Seed;
+    memset(s_asSlot, 0, sizeof(s_asSlot));
+    TlsfSingleInit();
+    xInitial = xPortGetFreeHeapSize();
+    for(k = 0; k < NUM_TASKS; k++)
+    {
+        axTask[k] = s_au8Tcb[k];
+        au32Allocs[k] = 0;
+    }
+
+    for(u32Call = 1; u32Call <= u32Calls; u32Call++)
+    {
+        SLOT_T *psSlot = &s_asSlot[Rand() % TASK_SLOTS];
+
+        /* Any task may free any block, as when buffers are passed between tasks */
+        k = Rand() % NUM_TASKS;
+        s_xCurrentTask = axTask[k];
+        if(psSlot->pu8Data != NULL)
+        {
+            vPortFree(psSlot->pu8Data);
+            psSlot->pu8Data = NULL;
+        }
+        else if((psSlot->pu8Data = pvPortMalloc(8 + Rand() % 505)) != NULL)
+        {
+            au32Allocs[k]++;
+        }
+
+        if(u32Call % DELETE_INTERVAL == 0)
+        {
+            k = Rand() % NUM_TASKS;
+            if(xPortGetTaskHeapStats(axTask[k], &sStats) && sStats.xAllocations != au32Allocs[k])
+                iCountOk = 0;
+            vPortHeapTaskDeleted(axTask[k]);
+            if(xPortGetTaskHeapStats(axTask[k], &sStats))
+                iGoneOk = 0;
+            u32Deleted++;
+
+            /* The new task gets the deleted one's TCB back half of the time */
+            if(Rand() & 1)
+            {
+                u32Reused++;
+            }
+            else
+            {
+                for(;;)
+                {
+                    uint8_t *pu8Tcb = s_au8Tcb[u32NextTcb++ % NUM_TCBS];
+
+                    for(i = 0; i < NUM_TASKS && axTask[i] != pu8Tcb; i++);
+                    if(i == NUM_TASKS)
+                    {
+                        axTask[k] = pu8Tcb;
+                        break;
+                    }
+                }
+            }
+            au32Allocs[k] = 0;
+        }
+
+        if(u32Call % CHECK_INTERVAL == 0)
+        {
+            uxEntries = CheckStats(xInitial - xPortGetFreeHeapSize(), &iSumOk);
+            if(uxEntries > uxMaxEntries)
+                uxMaxEntries = uxEntries;
+        }
+    }
+
+    for(k = 0; k < NUM_TASKS; k++)
+    {
+        if(xPortGetTaskHeapStats(axTask[k], &sStats) && sStats.xAllocations != au32Allocs[k])
+            iCountOk = 0;
+    }
+
+    /* Once every block is freed only the live tasks may still have entries */
+    for(i = 0; i < TASK_SLOTS; i++)
+    {
+        if(s_asSlot[i].pu8Data != NULL)
+            vPortFree(s_asSlot[i].pu8Data);
+    }
+    {
+        TaskHeapStats_t asStats[configHEAP_TLSF_TASK_STATS_ENTRIES + 1];
+        UBaseType_t uxNum = uxPortGetAllTaskHeapStats(asStats, configHEAP_TLSF_TASK_STATS_ENTRIES + 1);
+
+        for(i = 0; i < uxNum; i++)
+        {
+            for(k = 0; k < NUM_TASKS && axTask[k] != asStats[i].xTask; k++);
+            if(k == NUM_TASKS || asStats[i].xCurrentBytes != 0)
+                iEndOk = 0;
+        }
+    }
+
+    printf("task accounting: %u tasks deleted (%u handles reused), at most %u of %u entries in use\n",
+           u32Deleted, u32Reused, (unsigned)uxMaxEntries, (unsigned)configHEAP_TLSF_TASK_STATS_ENTRIES);
+
+    Check(iSumOk, "task current bytes do not add up to the allocated bytes, or overflow entry used");
+    Check(iCountOk, "task allocation count includes a deleted task's");
+    Check(iGoneOk, "deleted task still has statistics");
+    Check(iEndOk, "entry of a deleted task left after its blocks were freed");
+    Check(TlsfCheck(), "allocator structures corrupted by task accounting");
+    Check(xPortGetFreeHeapSize() == xInitial, "free bytes not back to the initial value");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t u32Calls = 200000, u32Seed = 1;
+    unsigned int i;
+
+    if(argc > 1)
+        u32Calls = (uint32_t)strtoul(argv[1], NULL, 0);
+    if(argc > 2)
+        u32Seed = (uint32_t)strtoul(argv[2], NULL, 0);
+    if(u32Calls == 0 || u32Calls > sizeof(s_au32MallocCost) / sizeof(s_au32MallocCost[0]))
+        u32Calls = sizeof(s_au32MallocCost) / sizeof(s_au32MallocCost[0]);
+    if(u32Seed == 0)
+        u32Seed = 1;
+
+    for(i = 0; i < sizeof(s_asHeap) / sizeof(s_asHeap[0]); i++)
+        RunHeap(&s_asHeap[i], u32Calls, u32Seed);
+    TestTaskStats(u32Calls / 10, u32Seed);
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
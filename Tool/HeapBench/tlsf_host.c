@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   heap_tlsf for the HeapBench host build
+ *
+ * The allocator source is included unchanged; the functions below read its statics to check the
+ * physical block chain, the segregated lists and the bitmaps of every region.
+ */
+#include <string.h>
+#include "../../ThirdParty/FreeRTOS/Source/portable/MemMang/heap_tlsf.c"
+
+static int TlsfCheckRegion(TlsfControl_t *pxControl)
+{
+    TlsfBlock_t *pxBlock, *pxPrev = NULL;
+    UBaseType_t uxFL, uxSL, uxPhysFree = 0, uxListFree = 0;
+    size_t xPhysSum = 0, xListSum = 0;
+    int iPrevFree = 0;
+
+    /* Physical chain: aligned sizes inside the region, correct previous-free flags and links,
+       no two free blocks next to each other */
+    for(pxBlock = (TlsfBlock_t *)pxControl->pucStart; (uint8_t *)pxBlock != pxControl->pucEnd;
+        pxBlock = heapNEXT_PHYS_BLOCK(pxBlock))
+    {
+        if(heapBLOCK_SIZE(pxBlock) < xMinimumBlockSize && (pxBlock->xSize & heapBLOCK_FREE_BIT) != 0)
+            return 0;
+        if(heapBLOCK_SIZE(pxBlock) == 0 || (heapBLOCK_SIZE(pxBlock) & portBYTE_ALIGNMENT_MASK) != 0)
+            return 0;
+        if((uint8_t *)heapNEXT_PHYS_BLOCK(pxBlock) > pxControl->pucEnd)
+            return 0;
+        if(((pxBlock->xSize & heapPREV_FREE_BIT) != 0) != iPrevFree)
+            return 0;
+        if(iPrevFree && pxBlock->pxPrevPhysBlock != pxPrev)
+            return 0;
+        if((pxBlock->xSize & heapBLOCK_FREE_BIT) != 0)
+        {
+            if(iPrevFree)
+                return 0;
+            if(pxBlock->pxOwner != NULL)
+                return 0;
+            uxPhysFree++;
+            xPhysSum += heapBLOCK_SIZE(pxBlock);
+            iPrevFree = 1;
+        }
+        else
+        {
+            if(pxBlock->pxOwner == NULL)
+                return 0;
+            iPrevFree = 0;
+        }
+        pxPrev = pxBlock;
+    }
+    if(((pxBlock->xSize & heapPREV_FREE_BIT) != 0) != iPrevFree || (iPrevFree && pxBlock->pxPrevPhysBlock != pxPrev))
+        return 0;
+
+    /* Segregated lists: every block free and of the list's size class, links consistent, bitmap
+       bits set exactly for the non-empty lists */
+    for(uxFL = 0; uxFL < heapTLSF_FL_COUNT; uxFL++)
+    {
+        if(((pxControl->ulFLBitmap >> uxFL) & 1UL) != (pxControl->ulSLBitmap[uxFL] != 0))
+            return 0;
+        for(uxSL = 0; uxSL < heapTLSF_SL_COUNT; uxSL++)
+        {
+            UBaseType_t uxBlockFL, uxBlockSL;
+
+            pxBlock = pxControl->pxFreeLists[uxFL][uxSL];
+            if(((pxControl->ulSLBitmap[uxFL] >> uxSL) & 1UL) != (pxBlock != NULL))
+                return 0;
+            if(pxBlock != NULL && pxBlock->pxPrevFree != NULL)
+                return 0;
+            for(; pxBlock != NULL; pxBlock = pxBlock->pxNextFree)
+            {
+                if((pxBlock->xSize & heapBLOCK_FREE_BIT) == 0)
+                    return 0;
+                if((uint8_t *)pxBlock < pxControl->pucStart || (uint8_t *)pxBlock >= pxControl->pucEnd)
+                    return 0;
+                prvMappingInsert(heapBLOCK_SIZE(pxBlock), &uxBlockFL, &uxBlockSL);
+                if(uxBlockFL != uxFL || uxBlockSL != uxSL)
+                    return 0;
+                if(pxBlock->pxNextFree != NULL && pxBlock->pxNextFree->pxPrevFree != pxBlock)
+                    return 0;
+                if(++uxListFree > uxPhysFree)
+                    return 0;
+                xListSum += heapBLOCK_SIZE(pxBlock);
+            }
+        }
+    }
+
+    return uxListFree == uxPhysFree && xListSum == xPhysSum && xPhysSum == pxControl->xFreeBytesRemaining;
+}
+
+int TlsfCheck(void)
+{
+    UBaseType_t ux;
+    size_t xSum = 0;
+
+    for(ux = 0; ux < uxDefinedRegions; ux++)
+    {
+        if(!TlsfCheckRegion(&xControls[ux]))
+            return 0;
+        xSum += xControls[ux].xFreeBytesRemaining;
+    }
+    return xSum == xFreeBytesRemaining;
+}
+
+size_t TlsfLargestFree(void)
+{
+    UBaseType_t ux;
+    size_t xLargest = 0;
+
+    for(ux = 0; ux < uxDefinedRegions; ux++)
+    {
+        if(xPortGetRegionLargestFreeBlock(ux) > xLargest)
+            xLargest = xPortGetRegionLargestFreeBlock(ux);
+    }
+    return xLargest;
+}
+
+/* Back to the state before vPortDefineHeapRegions(), so it can be called again */
+void TlsfReset(void)
+{
+    memset(xControls, 0, sizeof(xControls));
+    uxDefinedRegions = 0;
+    xFreeBytesRemaining = 0;
+    xMinimumEverFreeBytesRemaining = 0;
+}
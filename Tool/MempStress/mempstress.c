@@ -0,0 +1,258 @@
+/**************************************************************************//**
+ * @file     mempstress.c
+ * @version  V1.00
+ * @brief    Host stress test of the MEMP_LOCKFREE pools of lwIP (memp.c) with several threads.
+ *
+ * memp.c is included unchanged with MEMP_LOCKFREE set, so on the host its free list runs on the
+ * __atomic compare-and-swap fallback. Its static helpers are called directly for the
+ * deterministic part of the test.
+ *
+ * First the ABA case is built by hand: a context reads the head and the link of the first free
+ * element, then is "preempted" while that element and the next one are taken and the first one
+ * is freed again. The index in the head is the same as before, and only the tag tells the CAS to
+ * fail. Then the tag is run through its 16-bit wrap, which must leave the list intact.
+ *
+ * Then several threads allocate and free elements of one small pool with
+ * memp_malloc_pool()/memp_free_pool(), holding 1 to 8 elements at a time, so the pool often runs
+ * empty. A claim flag per element catches an element handed out twice, and every thread writes
+ * its id over the whole element while it holds it (including the word that links free
+ * elements, so a stale link read by another thread is overwritten) and checks it before the free.
+ * At the end the free list must hold every element exactly once, and the used and error counters
+ * of the pool must match what the threads saw. On a single core host the threads only interleave
+ * when one is preempted, as with interrupts on the target, so there are few CAS retries; the
+ * hand-built ABA case above does not depend on that.
+ *
+ * Build:  L=../../ThirdParty/lwIP/src
+ *         cc -O2 -pthread -I. -I../SockBench -I$L/include -o mempstress mempstress.c
+ *
+ * Usage:  mempstress [iterations per thread] [threads]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "../../ThirdParty/lwIP/src/core/memp.c"
+
+#define POOL_NUM            16
+#define POOL_SIZE           32
+#define MAX_HELD            8
+#define MAX_THREADS         16
+#define TAG_WRAP_STEPS      0x7fff      /* Pop and push pairs, the tag ends just below where it started */
+
+LWIP_MEMPOOL_DECLARE(STRESS, POOL_NUM, POOL_SIZE, "stress")
+
+typedef struct
+{
+    pthread_t sThread;
+    uint32_t u32Id;
+    uint32_t u32Iterations;
+    uint32_t u32Allocs;
+    uint32_t u32Empty;          /* memp_malloc_pool() returned NULL */
+    uint32_t u32Twice;          /* Element already claimed by another thread */
+    uint32_t u32Overwritten;    /* Contents changed while held */
+} WORKER_T;
+
+static uint32_t s_u32Fails;
+static uint32_t s_au32Claimed[POOL_NUM];
+static pthread_barrier_t s_sStart;
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+static uint32_t ElementIndex(void *pv)
+{
+    return (uint32_t)(((u8_t *)pv - MEMP_SIZE - (u8_t *)LWIP_MEM_ALIGN(memp_STRESS.base)) /
+                      (MEMP_SIZE + MEMP_ALIGN_SIZE(memp_STRESS.size)));
+}
+
+/* Take every free element; each must be a valid one and come up once only */
+static uint32_t DrainPool(void **ppvOut, int *piDistinct)
+{
+    uint8_t au8Seen[POOL_NUM] = { 0 };
+    uint32_t u32Num = 0, u32Index;
+    void *pv;
+
+    *piDistinct = 1;
+    while(u32Num < POOL_NUM && (pv = memp_malloc_pool(&memp_STRESS)) != NULL)
+    {
+        u32Index = ElementIndex(pv);
+        if(u32Index >= POOL_NUM || au8Seen[u32Index]++)
+            *piDistinct = 0;
+        ppvOut[u32Num++] = pv;
+    }
+    if(u32Num == POOL_NUM && memp_malloc_pool(&memp_STRESS) != NULL)
+        *piDistinct = 0;
+    return u32Num;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Single threaded: ABA and tag wrap                                                                       */
+/*---------------------------------------------------------------------------------------------------------*/
+static void TestAba(void)
+{
+    struct memp_lf *psLf = memp_STRESS.lf;
+    struct memp *psFirst, *psSecond, *psA, *psB;
+    u32_t u32Old, u32Next, u32Tag;
+    void *apv[POOL_NUM];
+    uint32_t i;
+    int iDistinct;
+
+    memp_init_pool(&memp_STRESS);
+
+    /* The preempted pop has read the head and the link of element A */
+    u32Old = psLf->head;
+    psFirst = memp_lf_element(&memp_STRESS, (u32Old & MEMP_LF_INDEX_MASK) - 1);
+    u32Next = *(volatile u32_t *)(void *)psFirst;
+
+    /* Meanwhile A and B are taken and A is freed again */
+    psA = memp_lf_pop(&memp_STRESS);
+    psB = memp_lf_pop(&memp_STRESS);
+    memp_lf_push(&memp_STRESS, psA);
+    Check(psA == psFirst, "first pop did not return the head element");
+    Check((psLf->head & MEMP_LF_INDEX_MASK) == (u32Old & MEMP_LF_INDEX_MASK), "ABA case not built");
+    Check(psLf->head != u32Old, "tag did not change");
+
+    /* Without the tag this CAS would succeed and put B, which is in use, back on the list */
+    Check(!memp_lf_cas(&psLf->head, u32Old, MEMP_LF_NEXT_HEAD(u32Old, u32Next & MEMP_LF_INDEX_MASK)),
+          "stale CAS succeeded, ABA not detected");
+
+    psSecond = memp_lf_pop(&memp_STRESS);
+    Check(psSecond == psA, "A not at the head after the failed CAS");
+    memp_lf_push(&memp_STRESS, psSecond);
+    memp_lf_push(&memp_STRESS, psB);
+
+    /* Run the tag past its wrap with one element held */
+    psA = memp_lf_pop(&memp_STRESS);
+    u32Tag = psLf->head >> 16;
+    for(i = 0; i < TAG_WRAP_STEPS; i++)
+        memp_lf_push(&memp_STRESS, memp_lf_pop(&memp_STRESS));
+    Check((psLf->head >> 16) == ((u32Tag + 2 * TAG_WRAP_STEPS) & 0xffff) && (psLf->head >> 16) < u32Tag,
+          "tag did not wrap");
+    memp_lf_push(&memp_STRESS, psA);
+
+    Check(DrainPool(apv, &iDistinct) == POOL_NUM && iDistinct, "free list broken after the tag wrap");
+    for(i = 0; i < POOL_NUM; i++)
+        memp_free_pool(&memp_STRESS, apv[i]);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Multithreaded                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+static void *Worker(void *pvArg)
+{
+    WORKER_T *psW = pvArg;
+    uint32_t *apu32Held[MAX_HELD];
+    uint32_t u32Rand = psW->u32Id * 2654435761u + 1, u32It, u32Want, u32Held, i, j;
+
+    pthread_barrier_wait(&s_sStart);
+    for(u32It = 0; u32It < psW->u32Iterations; u32It++)
+    {
+        u32Rand ^= u32Rand << 13;
+        u32Rand ^= u32Rand >> 17;
+        u32Rand ^= u32Rand << 5;
+        u32Want = 1 + u32Rand % MAX_HELD;
+
+        for(u32Held = 0; u32Held < u32Want; u32Held++)
+        {
+            uint32_t *pu32 = memp_malloc_pool(&memp_STRESS);
+
+            if(pu32 == NULL)
+            {
+                psW->u32Empty++;
+                break;
+            }
+            psW->u32Allocs++;
+            if(__atomic_exchange_n(&s_au32Claimed[ElementIndex(pu32)], psW->u32Id, __ATOMIC_SEQ_CST) != 0)
+                psW->u32Twice++;
+            for(j = 0; j < POOL_SIZE / 4; j++)
+                pu32[j] = psW->u32Id;
+            apu32Held[u32Held] = pu32;
+        }
+
+        for(i = 0; i < u32Held; i++)
+        {
+            uint32_t *pu32 = apu32Held[i];
+
+            for(j = 0; j < POOL_SIZE / 4; j++)
+            {
+                if(pu32[j] != psW->u32Id)
+                {
+                    psW->u32Overwritten++;
+                    break;
+                }
+            }
+            if(__atomic_exchange_n(&s_au32Claimed[ElementIndex(pu32)], 0, __ATOMIC_SEQ_CST) != psW->u32Id)
+                psW->u32Twice++;
+            memp_free_pool(&memp_STRESS, pu32);
+        }
+    }
+    return NULL;
+}
+
+static void TestThreads(uint32_t u32Threads, uint32_t u32Iterations)
+{
+    static WORKER_T asW[MAX_THREADS];
+    struct memp_lf *psLf = memp_STRESS.lf;
+    uint32_t u32Allocs = 0, u32Empty = 0, u32Twice = 0, u32Overwritten = 0, u32ErrBefore, i;
+    void *apv[POOL_NUM];
+    int iDistinct;
+
+    u32ErrBefore = psLf->err;
+    pthread_barrier_init(&s_sStart, NULL, u32Threads);
+    for(i = 0; i < u32Threads; i++)
+    {
+        memset(&asW[i], 0, sizeof(asW[i]));
+        asW[i].u32Id = i + 1;
+        asW[i].u32Iterations = u32Iterations;
+        pthread_create(&asW[i].sThread, NULL, Worker, &asW[i]);
+    }
+    for(i = 0; i < u32Threads; i++)
+    {
+        pthread_join(asW[i].sThread, NULL);
+        u32Allocs += asW[i].u32Allocs;
+        u32Empty += asW[i].u32Empty;
+        u32Twice += asW[i].u32Twice;
+        u32Overwritten += asW[i].u32Overwritten;
+    }
+    pthread_barrier_destroy(&s_sStart);
+
+    printf("%u threads x %u iterations: %u allocations, %u found the pool empty, %u CAS retries, max used %u of %u\n",
+           u32Threads, u32Iterations, u32Allocs, u32Empty, (unsigned)psLf->contention, (unsigned)psLf->max, POOL_NUM);
+
+    Check(u32Twice == 0, "element handed out twice");
+    Check(u32Overwritten == 0, "element written by another thread while held");
+    Check(psLf->used == 0, "used counter not back to 0");
+    Check(psLf->max <= POOL_NUM, "high-water mark above the pool size");
+    Check(psLf->err - u32ErrBefore == u32Empty, "error counter does not match the failed allocations");
+    Check(DrainPool(apv, &iDistinct) == POOL_NUM, "element lost");
+    Check(iDistinct, "element on the free list twice");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t u32Iterations = 200000, u32Threads = 4;
+
+    if(argc > 1)
+        u32Iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+    if(argc > 2)
+        u32Threads = (uint32_t)strtoul(argv[2], NULL, 0);
+    if(u32Threads < 2)
+        u32Threads = 2;
+    if(u32Threads > MAX_THREADS)
+        u32Threads = MAX_THREADS;
+
+    TestAba();
+    TestThreads(u32Threads, u32Iterations);
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   lwIP options for the MqttBench host build
+ *
+ * MQTT client and broker stand-in over the loopback interface, send buffer as on the target.
+ */
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+#define NO_SYS                          0
+#define SYS_LIGHTWEIGHT_PROT            1
+#define LWIP_TCPIP_CORE_LOCKING         1
+
+#define MEM_ALIGNMENT                   8
+#define MEM_SIZE                        (256 * 1024)
+#define MEMP_NUM_PBUF                   128
+#define MEMP_NUM_TCP_PCB                8
+#define MEMP_NUM_TCP_PCB_LISTEN         2
+#define MEMP_NUM_TCP_SEG                128
+#define MEMP_NUM_NETBUF                 16
+#define MEMP_NUM_NETCONN                8
+#define MEMP_NUM_SYS_TIMEOUT            16
+#define MEMP_NUM_TCPIP_MSG_INPKT        256
+#define PBUF_POOL_SIZE                  128
+
+#define LWIP_IPV4                       1
+#define LWIP_IPV6                       0
+#define LWIP_ARP                        0
+#define LWIP_ETHERNET                   0
+#define LWIP_ICMP                       1
+#define LWIP_UDP                        1
+#define LWIP_TCP                        1
+#define LWIP_DHCP                       0
+#define LWIP_DNS                        0
+#define LWIP_IGMP                       0
+#define LWIP_NETIF_LOOPBACK             1
+#define LWIP_HAVE_LOOPIF                1
+#define LWIP_LOOPBACK_MAX_PBUFS         0
+
+#define TCP_MSS                         1460
+#define TCP_WND                         (4 * TCP_MSS)
+#define TCP_SND_BUF                     (4 * TCP_MSS)
+#define TCP_SND_QUEUELEN                (4 * TCP_SND_BUF / TCP_MSS)
+/* Delayed ACKs go out within 5 ms, like a host broker in quick ACK mode. With the default
+   250 ms, Nagle on the client side holds every run to a few bursts per second. */
+#define TCP_TMR_INTERVAL                5
+
+#define TCPIP_THREAD_STACKSIZE          0
+#define TCPIP_THREAD_PRIO               1
+#define TCPIP_MBOX_SIZE                 512
+#define DEFAULT_THREAD_STACKSIZE        0
+#define DEFAULT_RAW_RECVMBOX_SIZE       16
+#define DEFAULT_UDP_RECVMBOX_SIZE       16
+#define DEFAULT_TCP_RECVMBOX_SIZE       64
+#define DEFAULT_ACCEPTMBOX_SIZE         4
+
+#define LWIP_NETCONN                    1
+#define LWIP_SOCKET                     1
+#define LWIP_COMPAT_SOCKETS             0
+#define LWIP_POSIX_SOCKETS_IO_NAMES     0
+#define LWIP_SO_RCVTIMEO                1
+
+#define MQTT_PUB_PIPELINE               1
+#define MQTT_OUTPUT_RINGBUF_SIZE        256
+#define MQTT_REQ_MAX_IN_FLIGHT          4
+
+#define LWIP_STATS                      0
+
+/* mqttbench counts the data segments from client to broker here */
+struct pbuf;
+struct netif;
+int IpInputHook(struct pbuf *p, struct netif *psNetif);
+#define LWIP_HOOK_IP4_INPUT(p, inp)     IpInputHook(p, inp)
+
+#endif /* __LWIPOPTS_H__ */
@@ -0,0 +1,479 @@
+/**************************************************************************//**
+ * @file     mqttbench.c
+ * @version  V1.00
+ * @brief    Host test and throughput benchmark of the lwIP MQTT client publish paths: the
+ *           copying mqtt_publish() against the zero-copy pipeline (mqtt_publish_ref()).
+ *
+ * The lwIP core, socket layer and MQTT client from ThirdParty/lwIP run on the host over the
+ * loopback interface, on the POSIX threads port of Tool/SockBench. A broker stand-in thread
+ * accepts the client on 127.0.0.1:1883 with lwIP sockets, answers CONNECT, PINGREQ and QoS 1
+ * PUBLISH (one PUBACK burst per receive), and checks every publish: topic, payload pattern,
+ * and that sequence numbers show up for the first time in publish order.
+ *
+ * Each run publishes a telemetry burst of 32 byte messages as fast as the client takes them.
+ * The application retries on ERR_MEM after the next completion callback, like firmware would,
+ * and the time spent waiting there is reported as stalled. QoS 0 publishes of the pipeline hold
+ * their slot until the TCP ACK, unless mqtt_set_pub_qos0_copy() is on; the copy run must beat
+ * both QoS 0 runs that wait for the ACK, and must not be slower than the QoS 1 pipeline.
+ * An IPv4 input hook counts the TCP data segments from client to broker.
+ *
+ * The last run publishes QoS 1 through the pipeline while the broker drops the connection every
+ * 1000 publishes without acknowledging the last ones; the client reconnects from the
+ * application. Every message must still arrive, the lost acknowledgements must be made up by
+ * retransmissions with DUP set, and every callback must report success.
+ *
+ * Build:  L=../../ThirdParty/lwIP/src
+ *         cc -O2 -pthread -I. -I../SockBench -I$L/include -o mqttbench mqttbench.c
+ *             ../SockBench/sys_arch.c $L/core/[a-z]*.c $L/core/ipv4/[a-z]*.c $L/api/[a-z]*.c
+ *             $L/apps/mqtt/mqtt.c
+ *
+ * Usage:  mqttbench [messages per run]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "lwip/tcpip.h"
+#include "lwip/sockets.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/apps/mqtt.h"
+
+#define BROKER_PORT         1883
+#define PAYLOAD_LEN         32
+#define TOPIC               "dev/42/telemetry"
+#define MAX_MSGS            100000
+#define RX_BUF_LEN          8192
+
+typedef struct
+{
+    const char *pcName;
+    int iPipeline;
+    int iQos0Copy;          /* mqtt_set_pub_qos0_copy() */
+    uint8_t u8Qos;
+    uint32_t u32DropEvery;  /* Broker drops the connection after this many publishes, 0: never */
+} RUN_T;
+
+typedef struct
+{
+    double dMsgPerSec;
+    double dMsgPerSeg;
+    double dStallPct;       /* Share of the run spent waiting for a free pipeline slot */
+} RESULT_T;
+
+static const RUN_T s_asRun[] =
+{
+    { "mqtt_publish      QoS 0", 0, 0, 0, 0 },
+    { "mqtt_publish_ref  QoS 0", 1, 0, 0, 0 },
+    { "mqtt_publish_ref  QoS 0, copy", 1, 1, 0, 0 },
+    { "mqtt_publish      QoS 1", 0, 0, 1, 0 },
+    { "mqtt_publish_ref  QoS 1", 1, 0, 1, 0 },
+    { "mqtt_publish_ref  QoS 1, broker drops", 1, 0, 1, 1000 },
+};
+
+static uint8_t s_au8Payload[MAX_MSGS][PAYLOAD_LEN];
+static uint8_t s_au8Seen[MAX_MSGS];
+static uint32_t s_u32Fails;
+
+/* Broker stand-in state, written by the broker thread */
+static volatile uint32_t s_u32DropEvery;
+static volatile uint32_t s_u32RxPub;
+static volatile uint32_t s_u32RxDup;        /* Publishes with DUP set */
+static volatile uint32_t s_u32RxUnique;
+static volatile uint32_t s_u32NextFirst;    /* Next sequence number expected for the first time */
+static volatile uint32_t s_u32OrderErr;
+static volatile uint32_t s_u32BadMsg;
+static volatile uint32_t s_u32Drops;
+
+/* Client side, written in the tcpip thread */
+static volatile uint32_t s_u32DoneOk;
+static volatile uint32_t s_u32DoneErr;
+static volatile uint32_t s_u32DataSegs;
+static volatile int s_iConnected;
+static volatile int s_iConnLost;
+static sys_sem_t s_sDone;
+static sys_sem_t s_sConn;
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+static uint64_t WallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void FillPayload(uint32_t u32Seq, uint8_t *pu8)
+{
+    uint32_t i;
+
+    pu8[0] = (uint8_t)u32Seq;
+    pu8[1] = (uint8_t)(u32Seq >> 8);
+    pu8[2] = (uint8_t)(u32Seq >> 16);
+    pu8[3] = (uint8_t)(u32Seq >> 24);
+    for(i = 4; i < PAYLOAD_LEN; i++)
+        pu8[i] = (uint8_t)(u32Seq * 7 + i);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Broker stand-in                                                                                         */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void BrokerPublish(const uint8_t *pu8, uint32_t u32Len, uint8_t u8Flags)
+{
+    uint8_t au8Ref[PAYLOAD_LEN];
+    uint32_t u32TopicLen, u32Seq, u32Off;
+
+    s_u32RxPub++;
+    if(u8Flags & 0x08)
+        s_u32RxDup++;
+
+    u32TopicLen = ((uint32_t)pu8[0] << 8) | pu8[1];
+    u32Off = 2 + u32TopicLen + ((u8Flags & 0x06) ? 2 : 0);
+    if(u32TopicLen != strlen(TOPIC) || memcmp(pu8 + 2, TOPIC, u32TopicLen) != 0 ||
+            u32Len != u32Off + PAYLOAD_LEN)
+    {
+        s_u32BadMsg++;
+        return;
+    }
+    pu8 += u32Off;
+    u32Seq = pu8[0] | ((uint32_t)pu8[1] << 8) | ((uint32_t)pu8[2] << 16) | ((uint32_t)pu8[3] << 24);
+    FillPayload(u32Seq, au8Ref);
+    if(u32Seq >= MAX_MSGS || memcmp(pu8, au8Ref, PAYLOAD_LEN) != 0)
+    {
+        s_u32BadMsg++;
+        return;
+    }
+    if(!s_au8Seen[u32Seq])
+    {
+        s_au8Seen[u32Seq] = 1;
+        s_u32RxUnique++;
+        if(u32Seq != s_u32NextFirst)
+            s_u32OrderErr++;
+        s_u32NextFirst = u32Seq + 1;
+    }
+}
+
+/* Serves one client connection; returns when it is closed or dropped. */
+static void BrokerSession(int iSock)
+{
+    static uint8_t au8Rx[RX_BUF_LEN];
+    uint8_t au8Tx[RX_BUF_LEN];
+    uint32_t u32Fill = 0, u32Pos, u32Len, u32Hdr, u32Tx, u32Session = 0;
+    uint8_t u8Type;
+    int n, iShift;
+
+    for(;;)
+    {
+        n = lwip_recv(iSock, au8Rx + u32Fill, RX_BUF_LEN - u32Fill, 0);
+        if(n <= 0)
+            return;
+        u32Fill += (uint32_t)n;
+
+        u32Pos = 0;
+        u32Tx = 0;
+        for(;;)
+        {
+            /* Fixed header: type byte and up to 4 remaining length bytes */
+            u32Len = 0;
+            iShift = 0;
+            for(u32Hdr = 1; u32Pos + u32Hdr < u32Fill && u32Hdr <= 4; u32Hdr++)
+            {
+                u32Len |= (uint32_t)(au8Rx[u32Pos + u32Hdr] & 0x7F) << iShift;
+                iShift += 7;
+                if(!(au8Rx[u32Pos + u32Hdr] & 0x80))
+                    break;
+            }
+            if(u32Pos + u32Hdr >= u32Fill || u32Pos + u32Hdr + 1 + u32Len > u32Fill)
+                break;
+            u32Hdr++;
+
+            u8Type = au8Rx[u32Pos] >> 4;
+            if(u8Type == 1)
+            {
+                /* CONNECT */
+                au8Tx[u32Tx++] = 0x20;
+                au8Tx[u32Tx++] = 0x02;
+                au8Tx[u32Tx++] = 0x00;
+                au8Tx[u32Tx++] = 0x00;
+            }
+            else if(u8Type == 3)
+            {
+                BrokerPublish(au8Rx + u32Pos + u32Hdr, u32Len, au8Rx[u32Pos] & 0x0F);
+                if(s_u32DropEvery && ++u32Session >= s_u32DropEvery)
+                {
+                    /* Gone without acknowledging this burst */
+                    s_u32Drops++;
+                    return;
+                }
+                if(au8Rx[u32Pos] & 0x06)
+                {
+                    au8Tx[u32Tx++] = 0x40;
+                    au8Tx[u32Tx++] = 0x02;
+                    au8Tx[u32Tx++] = au8Rx[u32Pos + u32Hdr + 2 + strlen(TOPIC)];
+                    au8Tx[u32Tx++] = au8Rx[u32Pos + u32Hdr + 3 + strlen(TOPIC)];
+                }
+            }
+            else if(u8Type == 12)
+            {
+                /* PINGREQ */
+                au8Tx[u32Tx++] = 0xD0;
+                au8Tx[u32Tx++] = 0x00;
+            }
+            else if(u8Type == 14)
+            {
+                return;
+            }
+            u32Pos += u32Hdr + u32Len;
+            if(u32Tx > RX_BUF_LEN - 8)
+            {
+                lwip_send(iSock, au8Tx, u32Tx, 0);
+                u32Tx = 0;
+            }
+        }
+        if(u32Tx)
+            lwip_send(iSock, au8Tx, u32Tx, 0);
+        memmove(au8Rx, au8Rx + u32Pos, u32Fill - u32Pos);
+        u32Fill -= u32Pos;
+    }
+}
+
+static void *Broker(void *pvArg)
+{
+    struct sockaddr_in sAddr;
+    int iListen, iSock, iOn = 1;
+
+    (void)pvArg;
+    memset(&sAddr, 0, sizeof(sAddr));
+    sAddr.sin_len = sizeof(sAddr);
+    sAddr.sin_family = AF_INET;
+    sAddr.sin_port = PP_HTONS(BROKER_PORT);
+    sAddr.sin_addr.s_addr = PP_HTONL(0x7F000001UL);
+    iListen = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    lwip_bind(iListen, (struct sockaddr *)&sAddr, sizeof(sAddr));
+    lwip_listen(iListen, 2);
+
+    for(;;)
+    {
+        iSock = lwip_accept(iListen, NULL, NULL);
+        if(iSock < 0)
+            continue;
+        lwip_setsockopt(iSock, IPPROTO_TCP, TCP_NODELAY, &iOn, sizeof(iOn));
+        BrokerSession(iSock);
+        lwip_close(iSock);
+    }
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Client                                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* LWIP_HOOK_IP4_INPUT, counts TCP segments with data from the client to the broker */
+int IpInputHook(struct pbuf *p, struct netif *psNetif)
+{
+    uint8_t au8Hdr[60];
+    uint32_t u32Ihl, u32TotLen, u32Doff;
+
+    if(pbuf_copy_partial(p, au8Hdr, sizeof(au8Hdr), 0) >= 40 && au8Hdr[9] == IPPROTO_TCP)
+    {
+        u32Ihl = (au8Hdr[0] & 0x0F) * 4;
+        u32TotLen = ((uint32_t)au8Hdr[2] << 8) | au8Hdr[3];
+        u32Doff = (au8Hdr[u32Ihl + 12] >> 4) * 4;
+        if((((uint32_t)au8Hdr[u32Ihl + 2] << 8) | au8Hdr[u32Ihl + 3]) == BROKER_PORT &&
+                u32TotLen > u32Ihl + u32Doff)
+            s_u32DataSegs++;
+    }
+    (void)psNetif;
+    return 0;
+}
+
+static void ConnectionCb(mqtt_client_t *psClient, void *pvArg, mqtt_connection_status_t eStatus)
+{
+    (void)psClient;
+    (void)pvArg;
+    s_iConnected = (eStatus == MQTT_CONNECT_ACCEPTED);
+    if(!s_iConnected)
+    {
+        s_iConnLost = 1;
+        /* Wake a publisher waiting for a completion that won't come */
+        sys_sem_signal(&s_sDone);
+    }
+    sys_sem_signal(&s_sConn);
+}
+
+static void PublishCb(void *pvArg, err_t err)
+{
+    (void)pvArg;
+    if(err == ERR_OK)
+        s_u32DoneOk++;
+    else
+        s_u32DoneErr++;
+    sys_sem_signal(&s_sDone);
+}
+
+static void Connect(mqtt_client_t *psClient)
+{
+    static const struct mqtt_connect_client_info_t sInfo = { "m487-bench", NULL, NULL, 60, NULL, NULL, 0, 0 };
+    ip_addr_t sIp;
+    uint32_t u32Tries;
+
+    IP_ADDR4(&sIp, 127, 0, 0, 1);
+    for(u32Tries = 0; !s_iConnected && u32Tries < 50; u32Tries++)
+    {
+        s_iConnLost = 0;
+        LOCK_TCPIP_CORE();
+        mqtt_client_connect(psClient, &sIp, BROKER_PORT, ConnectionCb, NULL, &sInfo);
+        UNLOCK_TCPIP_CORE();
+        sys_arch_sem_wait(&s_sConn, 1000);
+        if(!s_iConnected)
+            sys_msleep(20);
+    }
+}
+
+static void Run(mqtt_client_t *psClient, const RUN_T *psRun, uint32_t u32Msgs, RESULT_T *psRes)
+{
+    uint64_t u64T0, u64Ns, u64Wait, u64Stall = 0;
+    uint32_t k, u32Segs, u32Reconnects = 0, u32Idle = 0;
+    err_t err;
+
+    memset(s_au8Seen, 0, sizeof(s_au8Seen));
+    s_u32RxPub = s_u32RxDup = s_u32RxUnique = s_u32NextFirst = s_u32OrderErr = s_u32BadMsg = s_u32Drops = 0;
+    s_u32DoneOk = s_u32DoneErr = 0;
+    s_u32DropEvery = psRun->u32DropEvery;
+    u32Segs = s_u32DataSegs;
+    LOCK_TCPIP_CORE();
+    mqtt_set_pub_qos0_copy(psClient, (u8_t)psRun->iQos0Copy);
+    UNLOCK_TCPIP_CORE();
+
+    u64T0 = WallNs();
+    for(k = 0; k < u32Msgs;)
+    {
+        if(s_iConnLost)
+        {
+            u32Reconnects++;
+            Connect(psClient);
+        }
+        LOCK_TCPIP_CORE();
+        if(psRun->iPipeline)
+            err = mqtt_publish_ref(psClient, TOPIC, s_au8Payload[k], PAYLOAD_LEN, psRun->u8Qos, 0, PublishCb, NULL);
+        else
+            err = mqtt_publish(psClient, TOPIC, s_au8Payload[k], PAYLOAD_LEN, psRun->u8Qos, 0, PublishCb, NULL);
+        UNLOCK_TCPIP_CORE();
+        if(err == ERR_OK)
+        {
+            k++;
+        }
+        else if(err == ERR_MEM)
+        {
+            /* Full: the next completion frees a slot. Time spent here is a stall. */
+            u64Wait = WallNs();
+            sys_arch_sem_wait(&s_sDone, 1000);
+            u64Stall += WallNs() - u64Wait;
+        }
+        else if(err == ERR_CONN)
+        {
+            sys_arch_sem_wait(&s_sDone, 10);
+        }
+        else
+        {
+            break;
+        }
+    }
+    /* Wait for the last completions and for the broker to read everything */
+    while((s_u32DoneOk + s_u32DoneErr < u32Msgs || s_u32RxUnique < u32Msgs) && u32Idle < 300)
+    {
+        if(s_iConnLost)
+        {
+            u32Reconnects++;
+            Connect(psClient);
+        }
+        if(sys_arch_sem_wait(&s_sDone, 10) == SYS_ARCH_TIMEOUT)
+            u32Idle++;
+    }
+    u64Ns = WallNs() - u64T0;
+    u32Segs = s_u32DataSegs - u32Segs;
+
+    psRes->dMsgPerSec = u32Msgs * 1e9 / (double)u64Ns;
+    psRes->dMsgPerSeg = u32Segs ? (double)u32Msgs / u32Segs : 0.0;
+    psRes->dStallPct = 100.0 * (double)u64Stall / (double)u64Ns;
+    printf("%-38s %8.0f msg/s, %6u data segments, %5.1f msg/segment, %4.1f%% stalled", psRun->pcName,
+           psRes->dMsgPerSec, u32Segs, psRes->dMsgPerSeg, psRes->dStallPct);
+    if(psRun->u32DropEvery)
+        printf(", %u drops, %u DUP", s_u32Drops, s_u32RxDup);
+    printf("\n");
+
+    Check(s_u32DoneOk == u32Msgs && s_u32DoneErr == 0, "not every publish completed");
+    Check(s_u32RxUnique == u32Msgs, "broker is missing publishes");
+    Check(s_u32OrderErr == 0, "publishes out of order");
+    Check(s_u32BadMsg == 0, "malformed publish");
+    if(psRun->u32DropEvery)
+    {
+        Check(s_u32Drops > 0 && u32Reconnects > 0, "no reconnect happened");
+        Check(s_u32RxDup > 0, "no retransmission with DUP after reconnect");
+    }
+    else
+    {
+        Check(s_u32RxPub == u32Msgs && s_u32RxDup == 0, "duplicate publishes");
+    }
+}
+
+static void TcpipInitDone(void *pvArg)
+{
+    sys_sem_signal((sys_sem_t *)pvArg);
+}
+
+int main(int argc, char **argv)
+{
+    RESULT_T asRes[sizeof(s_asRun) / sizeof(s_asRun[0])];
+    mqtt_client_t *psClient;
+    pthread_t sThread;
+    sys_sem_t sInit;
+    uint32_t u32Msgs = 20000, i;
+
+    memset(asRes, 0, sizeof(asRes));
+    if(argc > 1)
+        u32Msgs = (uint32_t)strtoul(argv[1], NULL, 0);
+    if(u32Msgs == 0 || u32Msgs > MAX_MSGS)
+        u32Msgs = MAX_MSGS;
+    for(i = 0; i < u32Msgs; i++)
+        FillPayload(i, s_au8Payload[i]);
+
+    sys_sem_new(&sInit, 0);
+    sys_sem_new(&s_sDone, 0);
+    sys_sem_new(&s_sConn, 0);
+    tcpip_init(TcpipInitDone, &sInit);
+    sys_arch_sem_wait(&sInit, 0);
+
+    LOCK_TCPIP_CORE();
+    psClient = mqtt_client_new();
+    UNLOCK_TCPIP_CORE();
+
+    pthread_create(&sThread, NULL, Broker, NULL);
+    Connect(psClient);
+    Check(s_iConnected, "connect to broker stand-in");
+
+    for(i = 0; i < sizeof(s_asRun) / sizeof(s_asRun[0]) && s_iConnected; i++)
+        Run(psClient, &s_asRun[i], u32Msgs, &asRes[i]);
+
+    Check(asRes[4].dMsgPerSec > asRes[3].dMsgPerSec, "QoS 1 pipeline not faster than mqtt_publish");
+    Check(asRes[1].dMsgPerSeg > asRes[0].dMsgPerSeg, "QoS 0 pipeline does not batch more per segment");
+    Check(asRes[2].dMsgPerSec > asRes[0].dMsgPerSec && asRes[2].dMsgPerSec > asRes[1].dMsgPerSec,
+          "QoS 0 copy not faster than waiting for the TCP ACK");
+    Check(asRes[2].dMsgPerSec >= asRes[4].dMsgPerSec, "QoS 0 pipeline slower than QoS 1");
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+/**************************************************************************//**
+ * @file     ptpsim.c
+ * @version  V1.00
+ * @brief    Host simulation of the PTP slave servo (lwIP/ptp_servo.c) against an EMAC time stamp
+ *           counter model.
+ *
+ * The master is an ideal clock. The slave clock is a model of the M480 EMAC counter: an 84 MHz
+ * source with a frequency error and random wander drives the addend accumulator, which adds
+ * TSINC 0xD7 to the sub-second register, so time stamps have a resolution of about 100 ns and
+ * ts_adjtimex() works in addend steps of about 2 ppb. Both directions of the link add a fixed
+ * delay plus exponentially distributed queueing jitter.
+ *
+ * Every sync interval the master sends Sync (t1, received at t2) and the slave sends Delay_Req
+ * (t3, received at t4) half an interval later. The slave does what lwIP/ptp.c does: the mean path
+ * delay goes through the median filter, offset = t2 - t1 - delay goes to the servo, and the servo
+ * output goes to the clock model. Each scenario starts with the slave clock at 0 and the master
+ * at 1.5e9 s, so the first lock must step the clock. Halfway through, the oscillator frequency
+ * ramps by 2 ppm over 10 s, like a drive heating up.
+ *
+ * The true error (slave time minus master time when a Sync leaves the master) must stay below
+ * 1 us at a sync interval of 1/8 s, below 1.5 us at longer intervals, and its RMS below 250 ns
+ * once the servo has settled; the clock must be stepped exactly
+ * once and the frequency adjustment over the last 30 s must cancel the oscillator error to
+ * within 50 ppb.
+ *
+ * Build:  cc -O2 -I../../SampleCode/NuMaker-PFM-M487/lwIP/include -o ptpsim ptpsim.c
+ *             ../../SampleCode/NuMaker-PFM-M487/lwIP/ptp_servo.c -lm
+ *
+ * Usage:  ptpsim [seconds] [seed]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "lwip/ptp_servo.h"
+
+#define NS_PER_SEC          1000000000LL
+#define DEFAULT_ADDEND      0x1E70C600LL                    /* m480_eth.c DEFAULT_ADDNED */
+#define TICK_NS             (215.0 * 1e9 / 2147483648.0)    /* TSINC / 2^31 s */
+#define MASTER_EPOCH        (1500000000LL * NS_PER_SEC)
+
+typedef struct
+{
+    const char *pcName;
+    int32_t i32LogSync;         /* log2 of the sync interval */
+    double dOscPpb;             /* Initial oscillator error */
+    double dWanderPpb;          /* Random walk of the oscillator per sqrt(s) */
+    double dDelayNs;            /* Fixed one-way delay */
+    double dJitterNs;           /* Mean of the exponential queueing delay */
+    int32_t i32MaxErrNs;        /* Bound of the true error after settling */
+} SCENARIO_T;
+
+static const SCENARIO_T s_asScenario[] =
+{
+    { "direct link, 1/8 s",   -3,  42700.0, 2.0,   620.0,  20.0, 1000 },
+    { "one switch, 1/8 s",    -3, -31300.0, 2.0,  5600.0, 150.0, 1000 },
+    { "two switches, 1/4 s",  -2,  18900.0, 2.0, 11200.0, 300.0, 1500 },
+    { "one switch, 1 s",       0,  49800.0, 1.0,  5600.0, 150.0, 1500 },
+};
+
+/* Slave clock model */
+static int64_t s_i64True;       /* Master (true) time, ns */
+static int64_t s_i64Local;      /* Slave counter, whole ns */
+static double s_dLocalFrac;     /* and the fraction */
+static double s_dOscPpb;
+static int64_t s_i64Addend;
+
+static uint64_t s_u64Rng;
+static uint32_t s_u32Fails;
+
+static double Uniform(void)
+{
+    s_u64Rng ^= s_u64Rng << 13;
+    s_u64Rng ^= s_u64Rng >> 7;
+    s_u64Rng ^= s_u64Rng << 17;
+    return ((double)(s_u64Rng >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double Gauss(void)
+{
+    return sqrt(-2.0 * log(Uniform())) * cos(6.283185307179586 * Uniform());
+}
+
+static double Exponential(double dMean)
+{
+    return -dMean * log(Uniform());
+}
+
+/* Advances both clocks to true time i64To */
+static void Advance(int64_t i64To)
+{
+    double dRate, dDelta;
+    int64_t i64Whole;
+
+    dRate = (1.0 + s_dOscPpb * 1e-9) * (double)s_i64Addend / (double)DEFAULT_ADDEND;
+    dDelta = (double)(i64To - s_i64True) * (dRate - 1.0) + s_dLocalFrac;
+    i64Whole = (int64_t)floor(dDelta);
+    s_i64Local += (i64To - s_i64True) + i64Whole;
+    s_dLocalFrac = dDelta - (double)i64Whole;
+    s_i64True = i64To;
+}
+
+/* A time stamp has the resolution of the sub-second register */
+static int64_t Stamp(int64_t i64Ns)
+{
+    int64_t i64Sec = i64Ns / NS_PER_SEC;
+    double dSub = (double)(i64Ns - i64Sec * NS_PER_SEC);
+
+    return i64Sec * NS_PER_SEC + (int64_t)(floor(dSub / TICK_NS) * TICK_NS);
+}
+
+/* ETH_adjtimex() */
+static void AdjTimex(int32_t i32Ppb)
+{
+    int64_t i64Addend = ((int64_t)i32Ppb * DEFAULT_ADDEND) / 1000000000LL + DEFAULT_ADDEND;
+
+    if (i64Addend > 0xFFFFFFFFLL)
+        i64Addend = 0xFFFFFFFFLL;
+    s_i64Addend = i64Addend;
+}
+
+static int64_t LinkDelay(const SCENARIO_T *psSc)
+{
+    return (int64_t)(psSc->dDelayNs + Exponential(psSc->dJitterNs));
+}
+
+static void RunScenario(const SCENARIO_T *psSc, uint32_t u32Seconds)
+{
+    struct ptp_servo sServo;
+    struct ptp_delay_filter sFilter;
+    struct ptp_stats sTrue, sOffset, sDelay, sAdj;
+    struct ptp_stats_result sRes, sOff, sDly, sFreq;
+    int64_t i64Interval, i64Start, i64Settle, i64RampStart, i64T, i64Ev;
+    int64_t t1, t2, t3, t4, i64MeanDelay = 0, i64Ms, i64Offset, i64Err;
+    uint32_t u32State, u32Steps = 0, u32Fails = s_u32Fails;
+    int32_t i32Adj = 0;
+    int iMsValid;
+    double dRampPpb = 0.0, dOscBase;
+
+    i64Interval = (psSc->i32LogSync >= 0) ? (NS_PER_SEC << psSc->i32LogSync) : (NS_PER_SEC >> -psSc->i32LogSync);
+
+    s_i64True = MASTER_EPOCH;
+    s_i64Local = 0;
+    s_dLocalFrac = 0.0;
+    s_dOscPpb = dOscBase = psSc->dOscPpb;
+    s_i64Addend = DEFAULT_ADDEND;
+
+    ptp_servo_init(&sServo, PTP_SERVO_MAX_PPB, 0, 20000);
+    ptp_servo_interval(&sServo, (float)i64Interval / 1e9f);
+    ptp_delay_filter_init(&sFilter, PTP_DELAY_FILTER_LEN);
+    ptp_stats_reset(&sTrue);
+    ptp_stats_reset(&sOffset);
+    ptp_stats_reset(&sDelay);
+    ptp_stats_reset(&sAdj);
+
+    i64Start = MASTER_EPOCH;
+    i64Settle = i64Start + 60 * NS_PER_SEC;
+    i64RampStart = i64Start + (int64_t)u32Seconds * NS_PER_SEC / 2;
+
+    for (i64T = i64Start; i64T < i64Start + (int64_t)u32Seconds * NS_PER_SEC; i64T += i64Interval)
+    {
+        /* Oscillator wander and the temperature ramp */
+        dOscBase += psSc->dWanderPpb * sqrt((double)i64Interval / 1e9) * Gauss();
+        if ((i64T >= i64RampStart) && (i64T < i64RampStart + 10 * NS_PER_SEC))
+            dRampPpb = 2000.0 * (double)(i64T - i64RampStart) / (10.0 * NS_PER_SEC);
+        else if (i64T >= i64RampStart)
+            dRampPpb = 2000.0;
+
+        /* Sync leaves the master */
+        Advance(i64T);
+        s_dOscPpb = dOscBase + dRampPpb;
+        i64Err = s_i64Local - s_i64True;
+        if (i64T >= i64Settle)
+            ptp_stats_add(&sTrue, i64Err);
+        t1 = Stamp(s_i64True);
+
+        /* and arrives at the slave, which runs the servo on Follow_Up */
+        i64Ev = i64T + LinkDelay(psSc);
+        Advance(i64Ev);
+        t2 = Stamp(s_i64Local);
+
+        /* ptp_sync_done() */
+        i64Ms = t2 - t1;
+        iMsValid = 1;
+        i64Offset = i64Ms - i64MeanDelay;
+        i32Adj = ptp_servo_sample(&sServo, i64Offset, t2, &u32State);
+        if (u32State == PTP_SERVO_JUMP)
+        {
+            s_i64Local -= i64Offset;
+            u32Steps++;
+            /* A delay measurement across the step is meaningless */
+            iMsValid = 0;
+        }
+        if (u32State != PTP_SERVO_UNLOCKED)
+            AdjTimex(i32Adj);
+        if ((u32State == PTP_SERVO_LOCKED) && (i64T >= i64Settle))
+            ptp_stats_add(&sOffset, i64Offset);
+        if ((u32State == PTP_SERVO_LOCKED) && (i64T >= i64Start + ((int64_t)u32Seconds - 30) * NS_PER_SEC))
+            ptp_stats_add(&sAdj, i32Adj);
+
+        /* Delay_Req leaves the slave half an interval later, ptp_rx_delay_resp() */
+        i64Ev = i64T + i64Interval / 2 + (int64_t)(Uniform() * (double)(i64Interval / 4));
+        Advance(i64Ev);
+        t3 = Stamp(s_i64Local);
+        i64Ev += LinkDelay(psSc);
+        Advance(i64Ev);
+        t4 = Stamp(s_i64True);
+
+        if (iMsValid && ((i64Ms + (t4 - t3)) / 2 >= 0))
+        {
+            i64MeanDelay = ptp_delay_filter_add(&sFilter, (i64Ms + (t4 - t3)) / 2);
+            if (i64T >= i64Settle)
+                ptp_stats_add(&sDelay, i64MeanDelay);
+        }
+    }
+
+    ptp_stats_get(&sTrue, &sRes);
+    ptp_stats_get(&sOffset, &sOff);
+    ptp_stats_get(&sDelay, &sDly);
+    ptp_stats_get(&sAdj, &sFreq);
+
+    printf("%-22s true error rms %4u ns, jitter %4u ns, range %5d..%4d ns\n", psSc->pcName,
+           sRes.rms, sRes.stddev, sRes.min, sRes.max);
+    printf("%-22s servo offset rms %4u ns, jitter %4u ns; path delay %6d ns (actual %6.0f), steps %u, "
+           "adj %+7d ppb for %+9.1f ppb\n", "", sOff.rms, sOff.stddev, sDly.mean,
+           psSc->dDelayNs + psSc->dJitterNs, u32Steps, sFreq.mean, s_dOscPpb);
+
+    if (u32Steps != 1)
+    {
+        printf("FAIL %s: clock stepped %u times\n", psSc->pcName, u32Steps);
+        s_u32Fails++;
+    }
+    if ((sRes.count == 0) || (sRes.min <= -psSc->i32MaxErrNs) || (sRes.max >= psSc->i32MaxErrNs) || (sRes.rms >= 250))
+    {
+        printf("FAIL %s: true error out of bounds\n", psSc->pcName);
+        s_u32Fails++;
+    }
+    if ((sFreq.count == 0) || (fabs((double)sFreq.mean + s_dOscPpb) > 50.0))
+    {
+        printf("FAIL %s: frequency adjustment %d ppb does not cancel %.1f ppb\n", psSc->pcName, sFreq.mean, s_dOscPpb);
+        s_u32Fails++;
+    }
+    if (u32Fails == s_u32Fails)
+        printf("%-22s ok\n", "");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t u32Seconds = 600, i;
+
+    s_u64Rng = 0x2545F4914F6CDD1DULL;
+    if (argc > 1)
+        u32Seconds = (uint32_t)strtoul(argv[1], NULL, 0);
+    if (argc > 2)
+        s_u64Rng ^= strtoull(argv[2], NULL, 0) * 0x9E3779B97F4A7C15ULL;
+    if (u32Seconds < 180)
+        u32Seconds = 180;
+
+    for (i = 0; i < sizeof(s_asScenario) / sizeof(s_asScenario[0]); i++)
+        RunScenario(&s_asScenario[i], u32Seconds);
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
@@ -0,0 +1,1105 @@
+/**************************************************************************//**
+ * @file     scapdusim.c
+ * @version  V1.00
+ * @brief    Host simulation of the asynchronous smartcard APDU engine (StdDriver/src/scapdu.c)
+ *           against simulated T=0 and T=1 cards.
+ *
+ * The port is a discrete event model of the interfaces in ETU: a block sent with pfnSend reaches
+ * the card 12 ETU per character later and SCAPDU_OnTxDone() follows; the card answers after its
+ * turnaround (and its processing time for a whole APDU), one character every 12 ETU through
+ * SCAPDU_OnRx(); pfnTimer deadlines call SCAPDU_OnTimeout(). Up to three interfaces run at once,
+ * each with its own card.
+ *
+ * The T=1 card chains both ways within the IFSC and IFSD in force and answers S(IFS) and S(RESYNCH).
+ * It can be told to corrupt or lose its blocks, to receive corrupted blocks, to ask for WTX, to
+ * change its IFSC or abort in the middle of a chain, to make parity errors and to go mute. The T=0
+ * card answers with ACK, INS complement (byte by byte) and NULL procedure bytes, 61xx and 6Cxx.
+ * Both run a small application: ECHO (INS 10) returns the command data, READ (INS 20) returns P1
+ * bytes of a pattern, NOP (INS 30) only 90 00.
+ *
+ * Checked: ATR parsing; every APDU case on both protocols, including 255 byte commands and 256 byte
+ * responses chained at IFSC/IFSD 32 and 254; recovery from each fault with the following APDU
+ * unaffected; RESYNCH and the dead card; removal, overflow and resubmission from the callback. Last,
+ * the same APDU load runs on three interfaces at once and one after the other, as blocking
+ * SCLIB_StartTransmission() calls would; the virtual times are compared.
+ *
+ * Build:  cc -O2 -I../../Library/StdDriver/inc -o scapdusim scapdusim.c ../../Library/StdDriver/src/scapdu.c
+ *
+ * Usage:  scapdusim
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "scapdu.h"
+
+#define SLOTS           SCAPDU_MAX_SLOTS
+#define CHAR_ETU        12ULL
+#define NEVER           UINT64_MAX
+#define OUT_SIZE        4096UL
+
+/* Card applications */
+#define INS_ECHO        0x10U
+#define INS_READ        0x20U
+#define INS_NOP         0x30U
+
+typedef struct
+{
+    uint32_t u32Proto;
+    uint32_t u32Edc;
+    uint32_t u32Ifsc;           /* INF the card takes */
+    uint32_t u32Ifsd;           /* INF the card may send */
+    uint32_t u32IfscAtr;        /* u32Ifsc of the ATR */
+    uint32_t u32Turn;           /* ETU from the reader's last character to the card's first */
+    uint32_t u32Work;           /* ETU more before the response of an APDU */
+
+    /* Faults, each counts down */
+    uint32_t u32CorruptOut;     /* blocks sent with a bad EDC */
+    uint32_t u32DropOut;        /* blocks not sent */
+    uint32_t u32CorruptIn;      /* reader blocks taken as corrupted */
+    uint32_t u32Wtx;            /* APDUs answered after S(WTX) */
+    uint8_t  u8WtxMult;
+    uint32_t u32WtxWork;        /* u32Work of those */
+    uint32_t u32IfsReq;         /* chained blocks acknowledged after S(IFS) */
+    uint8_t  u8IfsNew;
+    uint32_t u32Abort;          /* chained blocks answered with S(ABORT) */
+    uint32_t u32Parity;         /* characters with a parity error */
+    uint32_t u32Mute;
+
+    /* T=1 */
+    uint8_t  u8Nr, u8Ns;
+    uint8_t  au8Cmd[SCAPDU_MAX_CMD + 256];
+    uint32_t u32CmdLen;
+    uint8_t  au8Rsp[SCAPDU_MAX_RSP];
+    uint32_t u32RspLen, u32RspOff, u32RspChunk, u32Sending;
+    uint8_t  au8Last[260];
+    uint32_t u32LastLen;
+    uint8_t  au8Pend[260];      /* sent once the reader answers our S request */
+    uint32_t u32PendLen, u32PendWork;
+    uint32_t u32Blocks;
+
+    /* T=0 */
+    uint32_t u32ByteMode;       /* INS complement for every byte */
+    uint32_t u32Nulls;          /* NULL bytes before each procedure byte */
+    uint8_t  au8Hdr[5];
+    uint32_t u32HdrLen, u32Need, u32Got;
+    uint8_t  au8Avail[SCAPDU_MAX_RSP];
+    uint32_t u32Avail;
+
+    uint32_t u32Apdus;
+} CARD_T;
+
+typedef struct
+{
+    uint32_t u32Present;
+    uint8_t  au8Tx[300];
+    uint32_t u32TxLen;
+    uint64_t u64TxEnd;
+    uint8_t  au8Out[OUT_SIZE];
+    uint32_t u32OutHead, u32OutTail;
+    uint64_t u64OutNext;
+    uint64_t u64Timer;
+    CARD_T   sCard;
+} SIM_T;
+
+static SIM_T s_asSim[SLOTS];
+static uint64_t s_u64Now;
+static uint32_t s_u32Locks;
+static uint32_t s_u32Fails;
+static uint16_t s_au16CrcTab[256];
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Port                                                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+static void PortSend(uint32_t u32Slot, const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    SIM_T *psSim = &s_asSim[u32Slot];
+
+    if(psSim->u64TxEnd != NEVER)
+        Check(0, "pfnSend while sending");
+    if((u32Len == 0UL) || (u32Len > sizeof(psSim->au8Tx)))
+        Check(0, "pfnSend length");
+    memcpy(psSim->au8Tx, pu8Buf, u32Len);
+    psSim->u32TxLen = u32Len;
+    psSim->u64TxEnd = s_u64Now + u32Len * CHAR_ETU;
+}
+
+static void PortTimer(uint32_t u32Slot, uint32_t u32Etu)
+{
+    s_asSim[u32Slot].u64Timer = u32Etu ? s_u64Now + u32Etu : NEVER;
+}
+
+static uint32_t PortLock(uint32_t u32Slot)
+{
+    (void)u32Slot;
+    return s_u32Locks++;
+}
+
+static void PortUnlock(uint32_t u32Slot, uint32_t u32Key)
+{
+    (void)u32Slot;
+    s_u32Locks--;
+    Check(s_u32Locks == u32Key, "lock nesting");
+}
+
+static const SCAPDU_PORT_T s_sPort = { PortSend, PortTimer, PortLock, PortUnlock };
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Cards                                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+static void CrcInit(void)
+{
+    uint32_t i, j;
+    uint16_t u16;
+
+    for(i = 0; i < 256; i++)
+    {
+        u16 = (uint16_t)i;
+        for(j = 0; j < 8; j++)
+            u16 = (u16 & 1) ? (uint16_t)((u16 >> 1) ^ 0x8408) : (uint16_t)(u16 >> 1);
+        s_au16CrcTab[i] = u16;
+    }
+}
+
+/* EDC of pu8[0 .. u32Len - 1] written after it; returns the epilogue length */
+static uint32_t CardEdc(const CARD_T *psC, uint8_t *pu8, uint32_t u32Len)
+{
+    uint32_t i;
+
+    if(psC->u32Edc == SCAPDU_EDC_CRC)
+    {
+        uint16_t u16 = 0xFFFF;
+
+        for(i = 0; i < u32Len; i++)
+            u16 = (uint16_t)((u16 >> 8) ^ s_au16CrcTab[(u16 ^ pu8[i]) & 0xFF]);
+        pu8[u32Len] = (uint8_t)(u16 >> 8);
+        pu8[u32Len + 1] = (uint8_t)u16;
+        return 2;
+    }
+    pu8[u32Len] = 0;
+    for(i = 0; i < u32Len; i++)
+        pu8[u32Len] ^= pu8[i];
+    return 1;
+}
+
+/* Queue card characters, the first u32Gap ETU after now (or after those already queued) */
+static void CardOut(uint32_t u32Slot, const uint8_t *pu8, uint32_t u32Len, uint32_t u32Gap)
+{
+    SIM_T *psSim = &s_asSim[u32Slot];
+    uint32_t i;
+
+    if(psSim->u32OutHead == psSim->u32OutTail)
+        psSim->u64OutNext = s_u64Now + u32Gap;
+    for(i = 0; i < u32Len; i++)
+        psSim->au8Out[psSim->u32OutTail++ % OUT_SIZE] = pu8[i];
+}
+
+static uint32_t CardApdu(const uint8_t *pu8Cmd, uint32_t u32Len, uint8_t *pu8Rsp)
+{
+    uint32_t u32N = 0, i, u32Lc = (u32Len > 5) ? pu8Cmd[4] : 0;
+
+    switch(pu8Cmd[1])
+    {
+        case INS_ECHO:
+            memcpy(pu8Rsp, &pu8Cmd[5], u32Lc);
+            u32N = u32Lc;
+            break;
+        case INS_READ:
+            u32N = pu8Cmd[2] ? pu8Cmd[2] : 256;
+            for(i = 0; i < u32N; i++)
+                pu8Rsp[i] = (uint8_t)(i * 7 + pu8Cmd[3]);
+            break;
+        case INS_NOP:
+            break;
+        default:
+            pu8Rsp[0] = 0x6D;
+            pu8Rsp[1] = 0x00;
+            return 2;
+    }
+    pu8Rsp[u32N++] = 0x90;
+    pu8Rsp[u32N++] = 0x00;
+    return u32N;
+}
+
+/* T=1: send a block, kept for retransmission */
+static void CardBlock(uint32_t u32Slot, uint8_t u8Pcb, const uint8_t *pu8Inf, uint32_t u32Len, uint32_t u32Gap)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint8_t *pu8 = psC->au8Last;
+
+    pu8[0] = 0;
+    pu8[1] = u8Pcb;
+    pu8[2] = (uint8_t)u32Len;
+    memcpy(&pu8[3], pu8Inf, u32Len);
+    psC->u32LastLen = 3 + u32Len + CardEdc(psC, pu8, 3 + u32Len);
+    psC->u32Blocks++;
+    if(psC->u32DropOut)
+    {
+        psC->u32DropOut--;
+        return;
+    }
+    if(psC->u32CorruptOut)
+    {
+        psC->u32CorruptOut--;
+        pu8[psC->u32LastLen - 1] ^= 0x5A;
+        CardOut(u32Slot, pu8, psC->u32LastLen, u32Gap);
+        pu8[psC->u32LastLen - 1] ^= 0x5A;
+        return;
+    }
+    CardOut(u32Slot, pu8, psC->u32LastLen, u32Gap);
+}
+
+static void CardResend(uint32_t u32Slot)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint8_t au8[260];
+
+    memcpy(au8, psC->au8Last, psC->u32LastLen);
+    CardBlock(u32Slot, au8[1], &au8[3], au8[2], psC->u32Turn);
+}
+
+static void CardRspChunk(uint32_t u32Slot, uint32_t u32Gap)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint32_t u32Left = psC->u32RspLen - psC->u32RspOff;
+    uint32_t u32N = (u32Left < psC->u32Ifsd) ? u32Left : psC->u32Ifsd;
+    uint8_t u8Pcb = (uint8_t)((psC->u8Ns << 6) | ((u32N < u32Left) ? 0x20 : 0));
+
+    psC->u32RspChunk = u32N;
+    psC->u32Sending = (u32N < u32Left);
+    psC->u8Ns ^= 1;
+    CardBlock(u32Slot, u8Pcb, &psC->au8Rsp[psC->u32RspOff], u32N, u32Gap);
+}
+
+static void CardT1(uint32_t u32Slot, const uint8_t *pu8, uint32_t u32Len)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint8_t au8Edc[2], u8Pcb, au8R[1];
+    uint32_t u32Inf, u32Epi = (psC->u32Edc == SCAPDU_EDC_CRC) ? 2 : 1;
+    int iOk;
+
+    if(psC->u32Mute)
+        return;
+
+    /* Check the block as a whole */
+    iOk = (u32Len >= 3 + u32Epi) && (pu8[0] == 0) && (u32Len == 3 + pu8[2] + u32Epi);
+    if(iOk)
+    {
+        uint8_t au8Blk[300];
+
+        memcpy(au8Blk, pu8, u32Len - u32Epi);
+        CardEdc(psC, au8Blk, u32Len - u32Epi);
+        memcpy(au8Edc, &au8Blk[u32Len - u32Epi], u32Epi);
+        iOk = (memcmp(au8Edc, &pu8[u32Len - u32Epi], u32Epi) == 0);
+    }
+    if(psC->u32CorruptIn)
+    {
+        psC->u32CorruptIn--;
+        iOk = 0;
+    }
+    if(!iOk)
+    {
+        CardBlock(u32Slot, (uint8_t)(0x80 | (psC->u8Nr << 4) | 0x01), NULL, 0, psC->u32Turn);
+        return;
+    }
+
+    u8Pcb = pu8[1];
+    u32Inf = pu8[2];
+
+    if((u8Pcb & 0x80) == 0)
+    {
+        /* I-block */
+        if(((u8Pcb >> 6) & 1) != psC->u8Nr)
+        {
+            CardResend(u32Slot);
+            return;
+        }
+        if(u32Inf > psC->u32Ifsc)
+        {
+            CardBlock(u32Slot, (uint8_t)(0x80 | (psC->u8Nr << 4) | 0x02), NULL, 0, psC->u32Turn);
+            return;
+        }
+        memcpy(&psC->au8Cmd[psC->u32CmdLen], &pu8[3], u32Inf);
+        psC->u32CmdLen += u32Inf;
+        psC->u8Nr ^= 1;
+        psC->u32Sending = 0;
+        if(u8Pcb & 0x20)
+        {
+            if(psC->u32Abort)
+            {
+                psC->u32Abort--;
+                psC->u32CmdLen = 0;
+                CardBlock(u32Slot, 0xC2, NULL, 0, psC->u32Turn);
+                return;
+            }
+            if(psC->u32IfsReq)
+            {
+                uint8_t u8Ifs = psC->u8IfsNew;
+
+                psC->u32IfsReq--;
+                psC->u32Ifsc = u8Ifs;
+                psC->au8Pend[0] = (uint8_t)(0x80 | (psC->u8Nr << 4));
+                psC->u32PendLen = 1;
+                psC->u32PendWork = 0;
+                CardBlock(u32Slot, 0xC1, &u8Ifs, 1, psC->u32Turn);
+                return;
+            }
+            CardBlock(u32Slot, (uint8_t)(0x80 | (psC->u8Nr << 4)), NULL, 0, psC->u32Turn);
+            return;
+        }
+
+        psC->u32RspLen = CardApdu(psC->au8Cmd, psC->u32CmdLen, psC->au8Rsp);
+        psC->u32RspOff = 0;
+        psC->u32CmdLen = 0;
+        psC->u32Apdus++;
+        if(psC->u32Wtx)
+        {
+            psC->u32Wtx--;
+            psC->au8Pend[0] = 0;        /* 0: the response */
+            psC->u32PendLen = 1;
+            psC->u32PendWork = psC->u32WtxWork;
+            CardBlock(u32Slot, 0xC3, &psC->u8WtxMult, 1, psC->u32Turn);
+            return;
+        }
+        CardRspChunk(u32Slot, psC->u32Turn + psC->u32Work);
+        return;
+    }
+
+    if((u8Pcb & 0xC0) == 0x80)
+    {
+        /* R-block: the next response block, or the last one again */
+        if(psC->u32Sending && (((u8Pcb >> 4) & 1) == psC->u8Ns))
+        {
+            psC->u32RspOff += psC->u32RspChunk;
+            CardRspChunk(u32Slot, psC->u32Turn);
+        }
+        else
+        {
+            CardResend(u32Slot);
+        }
+        return;
+    }
+
+    /* S-block */
+    if((u8Pcb & 0x20) == 0)
+    {
+        switch(u8Pcb & 0x1F)
+        {
+            case 0x01:
+                psC->u32Ifsd = pu8[3];
+                au8R[0] = pu8[3];
+                CardBlock(u32Slot, 0xE1, au8R, 1, psC->u32Turn);
+                break;
+            case 0x00:
+                psC->u8Nr = psC->u8Ns = 0;
+                psC->u32Ifsc = psC->u32IfscAtr;
+                psC->u32Ifsd = SCAPDU_T1_IFS_DEFAULT;
+                psC->u32CmdLen = 0;
+                psC->u32Sending = 0;
+                psC->u32PendLen = 0;
+                CardBlock(u32Slot, 0xE0, NULL, 0, psC->u32Turn);
+                break;
+            default:
+                CardBlock(u32Slot, (uint8_t)(0x80 | (psC->u8Nr << 4) | 0x02), NULL, 0, psC->u32Turn);
+                break;
+        }
+        return;
+    }
+    if(psC->u32PendLen && (((u8Pcb & 0x1F) == 0x03) || ((u8Pcb & 0x1F) == 0x01)))
+    {
+        psC->u32PendLen = 0;
+        if(psC->au8Pend[0] == 0)
+            CardRspChunk(u32Slot, psC->u32Turn + psC->u32PendWork);
+        else
+            CardBlock(u32Slot, psC->au8Pend[0], NULL, 0, psC->u32Turn);
+    }
+}
+
+/* T=0: procedure byte, NULL bytes first */
+static void CardProc(uint32_t u32Slot, uint8_t u8Proc, uint32_t u32Gap)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint8_t u8Null = 0x60;
+    uint32_t i;
+
+    for(i = 0; i < psC->u32Nulls; i++)
+    {
+        CardOut(u32Slot, &u8Null, 1, u32Gap);
+        u32Gap = 0;
+    }
+    CardOut(u32Slot, &u8Proc, 1, u32Gap);
+}
+
+/* T=0: data then status, ACK first or INS complement before each byte */
+static void CardT0Data(uint32_t u32Slot, const uint8_t *pu8, uint32_t u32Len, uint8_t u8Sw1, uint8_t u8Sw2, uint32_t u32Gap)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint8_t u8Ins = psC->au8Hdr[1], au8Sw[2];
+    uint32_t i;
+
+    if(u32Len)
+    {
+        if(psC->u32ByteMode)
+        {
+            for(i = 0; i < u32Len; i++)
+            {
+                CardProc(u32Slot, (uint8_t)~u8Ins, u32Gap);
+                CardOut(u32Slot, &pu8[i], 1, 0);
+                u32Gap = 0;
+            }
+        }
+        else
+        {
+            CardProc(u32Slot, u8Ins, u32Gap);
+            CardOut(u32Slot, pu8, u32Len, 0);
+        }
+        u32Gap = 0;
+    }
+    au8Sw[0] = u8Sw1;
+    au8Sw[1] = u8Sw2;
+    CardOut(u32Slot, au8Sw, 2, u32Gap);
+}
+
+static void CardT0Header(uint32_t u32Slot)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint8_t *pu8Hdr = psC->au8Hdr, au8Rsp[SCAPDU_MAX_RSP];
+    uint32_t u32P3 = pu8Hdr[4] ? pu8Hdr[4] : 256, u32N;
+
+    psC->u32HdrLen = 0;
+    switch(pu8Hdr[1])
+    {
+        case 0xC0:
+            u32N = (u32P3 < psC->u32Avail) ? u32P3 : psC->u32Avail;
+            if(u32N == psC->u32Avail)
+                CardT0Data(u32Slot, psC->au8Avail, u32N, 0x90, 0x00, psC->u32Turn);
+            else
+                CardT0Data(u32Slot, psC->au8Avail, u32N, 0x61, (uint8_t)(psC->u32Avail - u32N), psC->u32Turn);
+            memmove(psC->au8Avail, &psC->au8Avail[u32N], psC->u32Avail - u32N);
+            psC->u32Avail -= u32N;
+            break;
+        case INS_ECHO:
+            if(pu8Hdr[4] == 0)
+            {
+                CardT0Data(u32Slot, NULL, 0, 0x67, 0x00, psC->u32Turn);
+                break;
+            }
+            memcpy(psC->au8Cmd, pu8Hdr, 5);
+            psC->u32Need = pu8Hdr[4];
+            psC->u32Got = 0;
+            CardProc(u32Slot, psC->u32ByteMode ? (uint8_t)~pu8Hdr[1] : pu8Hdr[1], psC->u32Turn);
+            break;
+        case INS_READ:
+            memcpy(psC->au8Cmd, pu8Hdr, 5);
+            u32N = CardApdu(psC->au8Cmd, 5, au8Rsp) - 2;
+            psC->u32Apdus++;
+            if(u32P3 != u32N)
+                CardT0Data(u32Slot, NULL, 0, 0x6C, (uint8_t)u32N, psC->u32Turn + psC->u32Work);
+            else
+                CardT0Data(u32Slot, au8Rsp, u32N, 0x90, 0x00, psC->u32Turn + psC->u32Work);
+            break;
+        case INS_NOP:
+            psC->u32Apdus++;
+            CardT0Data(u32Slot, NULL, 0, 0x90, 0x00, psC->u32Turn + psC->u32Work);
+            break;
+        default:
+            CardT0Data(u32Slot, NULL, 0, 0x6D, 0x00, psC->u32Turn);
+            break;
+    }
+}
+
+static void CardT0(uint32_t u32Slot, const uint8_t *pu8, uint32_t u32Len)
+{
+    CARD_T *psC = &s_asSim[u32Slot].sCard;
+    uint32_t i;
+
+    if(psC->u32Mute)
+        return;
+
+    for(i = 0; i < u32Len; i++)
+    {
+        if(psC->u32Need)
+        {
+            psC->au8Cmd[5 + psC->u32Got++] = pu8[i];
+            if(psC->u32Got < psC->u32Need)
+            {
+                if(psC->u32ByteMode)
+                    CardProc(u32Slot, (uint8_t)~psC->au8Cmd[1], psC->u32Turn);
+                continue;
+            }
+            /* Command complete: the response waits for GET RESPONSE */
+            psC->u32Avail = CardApdu(psC->au8Cmd, 5 + psC->u32Need, psC->au8Avail) - 2;
+            psC->u32Need = 0;
+            psC->u32Apdus++;
+            CardT0Data(u32Slot, NULL, 0, psC->u32Avail ? 0x61 : 0x90, (uint8_t)psC->u32Avail, psC->u32Turn + psC->u32Work);
+            continue;
+        }
+        psC->au8Hdr[psC->u32HdrLen++] = pu8[i];
+        if(psC->u32HdrLen == 5)
+            CardT0Header(u32Slot);
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Event loop                                                                                             */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* Run the earliest event; 0 when nothing is pending */
+static int Step(void)
+{
+    uint64_t u64Min = NEVER;
+    uint32_t i, u32Slot = 0, u32Kind = 0;
+    SIM_T *psSim;
+
+    for(i = 0; i < SLOTS; i++)
+    {
+        psSim = &s_asSim[i];
+        if(psSim->u64TxEnd < u64Min)
+            u64Min = psSim->u64TxEnd, u32Slot = i, u32Kind = 1;
+        if((psSim->u32OutHead != psSim->u32OutTail) && (psSim->u64OutNext < u64Min))
+            u64Min = psSim->u64OutNext, u32Slot = i, u32Kind = 2;
+        if(psSim->u64Timer < u64Min)
+            u64Min = psSim->u64Timer, u32Slot = i, u32Kind = 3;
+    }
+    if(u64Min == NEVER)
+        return 0;
+
+    s_u64Now = u64Min;
+    psSim = &s_asSim[u32Slot];
+    if(u32Kind == 1)
+    {
+        psSim->u64TxEnd = NEVER;
+        if(psSim->u32Present)
+        {
+            if(psSim->sCard.u32Proto == SCAPDU_T1)
+                CardT1(u32Slot, psSim->au8Tx, psSim->u32TxLen);
+            else
+                CardT0(u32Slot, psSim->au8Tx, psSim->u32TxLen);
+        }
+        SCAPDU_OnTxDone(u32Slot);
+    }
+    else if(u32Kind == 2)
+    {
+        uint8_t u8 = psSim->au8Out[psSim->u32OutHead++ % OUT_SIZE];
+
+        psSim->u64OutNext += CHAR_ETU;
+        if(psSim->sCard.u32Parity)
+        {
+            psSim->sCard.u32Parity--;
+            SCAPDU_OnError(u32Slot);
+        }
+        SCAPDU_OnRx(u32Slot, &u8, 1);
+    }
+    else
+    {
+        psSim->u64Timer = NEVER;
+        SCAPDU_OnTimeout(u32Slot);
+    }
+    Check(s_u32Locks == 0, "port unlocked after each event");
+    return 1;
+}
+
+static void RunAll(void)
+{
+    while(Step())
+        ;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Tests                                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+static uint32_t s_u32Done;
+
+static void Done(void *pvArg, SCAPDU_REQ_T *psReq)
+{
+    (void)psReq;
+    if(pvArg)
+        (*(uint32_t *)pvArg)++;
+    s_u32Done++;
+}
+
+/* Insert a card and attach it, running IFS negotiation */
+static void Insert(uint32_t u32Slot, uint32_t u32Proto, uint32_t u32Edc, uint32_t u32Ifsc, uint32_t u32Ifsd)
+{
+    SIM_T *psSim = &s_asSim[u32Slot];
+    SCAPDU_PARAM_T sParam;
+    SCAPDU_STATS_T sStats;
+
+    memset(psSim, 0, sizeof(*psSim));
+    psSim->u64TxEnd = NEVER;
+    psSim->u64Timer = NEVER;
+    psSim->u32Present = 1;
+    psSim->sCard.u32Proto = u32Proto;
+    psSim->sCard.u32Edc = u32Edc;
+    psSim->sCard.u32Ifsc = u32Ifsc;
+    psSim->sCard.u32IfscAtr = u32Ifsc;
+    psSim->sCard.u32Ifsd = SCAPDU_T1_IFS_DEFAULT;
+    psSim->sCard.u32Turn = 20;
+    psSim->sCard.u32Work = 400;
+
+    /* BWI 4, CWI 5 at Fi 372 Di 1; WI 10 */
+    sParam.u8Protocol = (uint8_t)u32Proto;
+    sParam.u8Edc = (uint8_t)u32Edc;
+    sParam.u8Ifsc = (uint8_t)u32Ifsc;
+    sParam.u8Ifsd = (uint8_t)u32Ifsd;
+    sParam.u32WaitEtu = (u32Proto == SCAPDU_T1) ? 11 + (960 << 4) : 9600;
+    sParam.u32CharEtu = 11 + (1 << 5);
+    Check(SCAPDU_Attach(u32Slot, &sParam) == SCAPDU_OK, "attach");
+    RunAll();
+    Check(SCAPDU_IsIdle(u32Slot), "idle after attach");
+    if(u32Proto == SCAPDU_T1)
+        Check(psSim->sCard.u32Ifsd == u32Ifsd, "IFSD negotiated");
+    SCAPDU_GetStats(u32Slot, &sStats);
+    Check(sStats.u32Apdus == 0, "no APDU on attach");
+}
+
+static void Remove(uint32_t u32Slot)
+{
+    SCAPDU_Detach(u32Slot);
+    s_asSim[u32Slot].u32Present = 0;
+    RunAll();
+}
+
+/* Build an APDU: header, optional data and Le; returns its length */
+static uint32_t Apdu(uint8_t *pu8, uint8_t u8Ins, uint8_t u8P1, uint8_t u8P2, uint32_t u32Lc, int iLe)
+{
+    uint32_t u32Len = 4, i;
+
+    pu8[0] = 0x80;
+    pu8[1] = u8Ins;
+    pu8[2] = u8P1;
+    pu8[3] = u8P2;
+    if(u32Lc)
+    {
+        pu8[u32Len++] = (uint8_t)u32Lc;
+        for(i = 0; i < u32Lc; i++)
+            pu8[u32Len++] = (uint8_t)(i * 13 + u8P2);
+    }
+    if(iLe >= 0)
+        pu8[u32Len++] = (uint8_t)iLe;
+    return u32Len;
+}
+
+/* Run one APDU to the end and check its response */
+static void Exchange(uint32_t u32Slot, const char *pcWhat, const uint8_t *pu8Cmd, uint32_t u32CmdLen,
+                     uint32_t u32Status, const uint8_t *pu8Expect, uint32_t u32ExpectLen)
+{
+    static uint8_t au8Rsp[SCAPDU_MAX_RSP];
+    SCAPDU_REQ_T sReq;
+    char acMsg[128];
+    uint32_t u32Done = 0;
+
+    memset(&sReq, 0, sizeof(sReq));
+    memset(au8Rsp, 0xEE, sizeof(au8Rsp));
+    sReq.pu8Cmd = pu8Cmd;
+    sReq.u32CmdLen = u32CmdLen;
+    sReq.pu8Rsp = au8Rsp;
+    sReq.u32RspSize = sizeof(au8Rsp);
+    sReq.pfnDone = Done;
+    sReq.pvArg = &u32Done;
+
+    snprintf(acMsg, sizeof(acMsg), "%s: submit", pcWhat);
+    Check(SCAPDU_Submit(u32Slot, &sReq) == SCAPDU_OK, acMsg);
+    RunAll();
+    snprintf(acMsg, sizeof(acMsg), "%s: one callback", pcWhat);
+    Check((u32Done == 1) && !SCAPDU_IsQueued(&sReq), acMsg);
+    snprintf(acMsg, sizeof(acMsg), "%s: status %u", pcWhat, (unsigned)sReq.u32Status);
+    Check(sReq.u32Status == u32Status, acMsg);
+    if(pu8Expect != NULL)
+    {
+        snprintf(acMsg, sizeof(acMsg), "%s: response (%u bytes)", pcWhat, (unsigned)sReq.u32RspLen);
+        Check((sReq.u32RspLen == u32ExpectLen) && (memcmp(au8Rsp, pu8Expect, u32ExpectLen) == 0), acMsg);
+    }
+    Check(SCAPDU_IsIdle(u32Slot), "idle after the APDU");
+}
+
+/* Expected response of an APDU from the card application */
+static uint32_t Expect(const uint8_t *pu8Cmd, uint32_t u32Len, uint8_t *pu8Rsp)
+{
+    return CardApdu(pu8Cmd, u32Len, pu8Rsp);
+}
+
+static void TestAtr(void)
+{
+    /* T=1: TA1 96 (Fi 512, Di 32), TD1 81, TD2 31, TA3 FE (IFSC 254), TB3 45 (BWI 4, CWI 5), 5 historical bytes */
+    uint8_t au8T1[] = { 0x3B, 0xF5, 0x96, 0x00, 0x00, 0x81, 0x31, 0xFE, 0x45, 'N', 'u', 'v', 'o', 't', 0x00 };
+    /* T=0 only, no TCK; TC2 WI 20 */
+    static const uint8_t au8T0[] = { 0x3B, 0x82, 0x40, 0x14, 0x50, 0x51 };
+    /* TA2 specific mode T=1, TC2, TD2 71: TA3 IFSC 128, TB3 BWI 3 CWI 4, TC3 CRC */
+    uint8_t au8Spec[] = { 0x3B, 0x80, 0xD0, 0x81, 0x0A, 0x71, 0x80, 0x34, 0x01, 0x00 };
+    SCAPDU_PARAM_T sParam;
+    uint32_t i;
+
+    for(i = 1; i < sizeof(au8T1) - 1; i++)
+        au8T1[sizeof(au8T1) - 1] ^= au8T1[i];
+    Check(SCAPDU_ParseAtr(au8T1, sizeof(au8T1), &sParam) == SCAPDU_OK, "ATR T=1");
+    Check((sParam.u8Protocol == SCAPDU_T1) && (sParam.u8Ifsc == 254) && (sParam.u8Ifsd == SCAPDU_T1_IFSD) &&
+          (sParam.u8Edc == SCAPDU_EDC_LRC), "ATR T=1 parameters");
+    Check(sParam.u32WaitEtu == 11 + ((960UL * 372 * 32 / 512) << 4), "ATR T=1 BWT");
+    Check(sParam.u32CharEtu == 11 + 32, "ATR T=1 CWT");
+    au8T1[sizeof(au8T1) - 1] ^= 1;
+    Check(SCAPDU_ParseAtr(au8T1, sizeof(au8T1), &sParam) == SCAPDU_ERR_PARAM, "ATR wrong TCK");
+    Check(SCAPDU_ParseAtr(au8T1, 8, &sParam) == SCAPDU_ERR_PARAM, "ATR truncated");
+
+    Check(SCAPDU_ParseAtr(au8T0, sizeof(au8T0), &sParam) == SCAPDU_OK, "ATR T=0");
+    Check((sParam.u8Protocol == SCAPDU_T0) && (sParam.u32WaitEtu == 960 * 20), "ATR T=0 WWT");
+
+    for(i = 1; i < sizeof(au8Spec) - 1; i++)
+        au8Spec[sizeof(au8Spec) - 1] ^= au8Spec[i];
+    Check(SCAPDU_ParseAtr(au8Spec, sizeof(au8Spec), &sParam) == SCAPDU_OK, "ATR specific T=1");
+    Check((sParam.u8Protocol == SCAPDU_T1) && (sParam.u8Ifsc == 128) && (sParam.u8Edc == SCAPDU_EDC_CRC) &&
+          (sParam.u32WaitEtu == 11 + (960UL << 3)) && (sParam.u32CharEtu == 11 + 16), "ATR specific T=1 parameters");
+}
+
+static void TestT1(uint32_t u32Edc, uint32_t u32Ifsc, uint32_t u32Ifsd)
+{
+    uint8_t au8Cmd[SCAPDU_MAX_CMD], au8Exp[SCAPDU_MAX_RSP];
+    uint32_t u32Len, u32ExpLen;
+    SCAPDU_STATS_T sStats;
+    char acName[64];
+
+    snprintf(acName, sizeof(acName), "T=1 %s IFSC %u IFSD %u", u32Edc ? "CRC" : "LRC", (unsigned)u32Ifsc, (unsigned)u32Ifsd);
+    Insert(0, SCAPDU_T1, u32Edc, u32Ifsc, u32Ifsd);
+
+    u32Len = Apdu(au8Cmd, INS_NOP, 0, 0, 0, -1);
+    u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+    Exchange(0, "case 1", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+    u32Len = Apdu(au8Cmd, INS_READ, 0, 3, 0, 0);
+    u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+    Exchange(0, "case 2, 256 bytes", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+    u32Len = Apdu(au8Cmd, INS_NOP, 0, 0, 200, -1);
+    u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+    Exchange(0, "case 3, 200 bytes", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+    u32Len = Apdu(au8Cmd, INS_ECHO, 0, 9, 255, 0);
+    u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+    Exchange(0, "case 4, 255 bytes", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+    SCAPDU_GetStats(0, &sStats);
+    Check((sStats.u32Apdus == 4) && (sStats.u32Failed == 0) && (sStats.u32Retransmits == 0), acName);
+    /* Chained I-blocks: 255 + 6 byte command and 256 + 2 byte responses cut at IFSC and IFSD */
+    Check(sStats.u32Chained == (205 + u32Ifsc - 1) / u32Ifsc - 1 + (261 + u32Ifsc - 1) / u32Ifsc - 1 +
+          (258 + u32Ifsd - 1) / u32Ifsd - 1 + (257 + u32Ifsd - 1) / u32Ifsd - 1, "T=1 chained blocks");
+    printf("%-32s %4u blocks out, %4u in, %3u chained\n", acName,
+           (unsigned)sStats.u32TxBlocks, (unsigned)sStats.u32RxBlocks, (unsigned)sStats.u32Chained);
+    Remove(0);
+}
+
+/* A fault on the card, then the APDU it hits and one more */
+static void Fault(const char *pcWhat, uint32_t u32Status, uint32_t *pu32Fault, uint32_t u32Count)
+{
+    uint8_t au8Cmd[SCAPDU_MAX_CMD], au8Exp[SCAPDU_MAX_RSP];
+    uint32_t u32Len, u32ExpLen;
+    SCAPDU_STATS_T sStats;
+    char acMsg[96];
+
+    *pu32Fault = u32Count;
+    u32Len = Apdu(au8Cmd, INS_ECHO, 0, 5, 100, 0);
+    u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+    Exchange(0, pcWhat, au8Cmd, u32Len, u32Status, (u32Status == SCAPDU_STS_OK) ? au8Exp : NULL, u32ExpLen);
+    snprintf(acMsg, sizeof(acMsg), "%s: fault used", pcWhat);
+    Check(*pu32Fault == 0, acMsg);
+
+    snprintf(acMsg, sizeof(acMsg), "%s, then", pcWhat);
+    u32Len = Apdu(au8Cmd, INS_READ, 200, 1, 0, 200);
+    u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+    Exchange(0, acMsg, au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+    SCAPDU_GetStats(0, &sStats);
+    printf("%-32s %4u retransmits, %u WTX, %u RESYNCH\n", pcWhat,
+           (unsigned)sStats.u32Retransmits, (unsigned)sStats.u32Wtx, (unsigned)sStats.u32Resynch);
+}
+
+static void TestT1Faults(void)
+{
+    CARD_T *psC = &s_asSim[0].sCard;
+    SCAPDU_STATS_T sStats;
+    SCAPDU_REQ_T asReq[3];
+    uint8_t au8Cmd[8], aau8Rsp[3][SCAPDU_MAX_RSP];
+    uint32_t u32Len, i, u32Done = 0;
+
+    Insert(0, SCAPDU_T1, SCAPDU_EDC_LRC, 32, 64);
+    Fault("card block corrupted", SCAPDU_STS_OK, &psC->u32CorruptOut, 1);
+    Fault("card blocks corrupted x3", SCAPDU_STS_OK, &psC->u32CorruptOut, 3);
+    Fault("card block lost", SCAPDU_STS_OK, &psC->u32DropOut, 1);
+    Fault("reader block corrupted", SCAPDU_STS_OK, &psC->u32CorruptIn, 1);
+    Fault("parity error", SCAPDU_STS_OK, &psC->u32Parity, 1);
+    psC->u8WtxMult = 3;
+    psC->u32WtxWork = 20000;    /* longer than BWT */
+    Fault("WTX", SCAPDU_STS_OK, &psC->u32Wtx, 1);
+    psC->u8IfsNew = 20;
+    Fault("card IFS request in the chain", SCAPDU_STS_OK, &psC->u32IfsReq, 1);
+    Fault("card aborts the chain", SCAPDU_STS_T1_ABORT, &psC->u32Abort, 1);
+    Fault("reader blocks corrupted x4", SCAPDU_STS_T1_ERROR, &psC->u32CorruptIn, 4);
+    SCAPDU_GetStats(0, &sStats);
+    Check(sStats.u32Resynch == 1, "one RESYNCH");
+    Check(psC->u32Ifsd == SCAPDU_T1_IFS_DEFAULT, "RESYNCH restores IFSD");
+    Check(sStats.u32Wtx == 1, "one WTX");
+
+    /* A mute card: RESYNCH fails, the running and queued APDUs fail, the interface refuses more */
+    psC->u32Mute = 1;
+    u32Len = Apdu(au8Cmd, INS_NOP, 0, 0, 0, -1);
+    memset(asReq, 0, sizeof(asReq));
+    for(i = 0; i < 3; i++)
+    {
+        asReq[i].pu8Cmd = au8Cmd;
+        asReq[i].u32CmdLen = u32Len;
+        asReq[i].pu8Rsp = aau8Rsp[i];
+        asReq[i].u32RspSize = SCAPDU_MAX_RSP;
+        asReq[i].pfnDone = Done;
+        asReq[i].pvArg = &u32Done;
+        Check(SCAPDU_Submit(0, &asReq[i]) == SCAPDU_OK, "submit to the mute card");
+    }
+    Check(SCAPDU_Submit(0, &asReq[1]) == SCAPDU_ERR_BUSY, "submit twice");
+    RunAll();
+    Check(u32Done == 3, "mute card: all complete");
+    for(i = 0; i < 3; i++)
+        Check(asReq[i].u32Status == SCAPDU_STS_DEAD, "mute card: dead");
+    Check(SCAPDU_Submit(0, &asReq[0]) == SCAPDU_ERR_STATE, "dead card refuses");
+    Remove(0);
+}
+
+static void TestT0(void)
+{
+    CARD_T *psC = &s_asSim[0].sCard;
+    uint8_t au8Cmd[SCAPDU_MAX_CMD], au8Exp[SCAPDU_MAX_RSP];
+    uint32_t u32Len, u32ExpLen, u32Mode;
+    SCAPDU_STATS_T sStats;
+
+    for(u32Mode = 0; u32Mode < 2; u32Mode++)
+    {
+        Insert(0, SCAPDU_T0, 0, 0, 0);
+        psC->u32ByteMode = u32Mode;
+        psC->u32Nulls = u32Mode;
+
+        u32Len = Apdu(au8Cmd, INS_NOP, 0, 0, 0, -1);
+        u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+        Exchange(0, "T=0 case 1", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+        u32Len = Apdu(au8Cmd, INS_READ, 0, 7, 0, 0);
+        u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+        Exchange(0, "T=0 case 2, 256 bytes", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+        /* Le 0 where the card has 17 bytes: 6C11, then the command again */
+        u32Len = Apdu(au8Cmd, INS_READ, 17, 7, 0, 0);
+        u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+        Exchange(0, "T=0 case 2, wrong Le", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+        u32Len = Apdu(au8Cmd, INS_ECHO, 0, 0, 40, -1);
+        Exchange(0, "T=0 case 3, 61xx", au8Cmd, u32Len, SCAPDU_STS_OK, NULL, 0);
+
+        u32Len = Apdu(au8Cmd, INS_ECHO, 0, 2, 255, 0);
+        u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+        Exchange(0, "T=0 case 4, 255 bytes", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+        u32Len = Apdu(au8Cmd, 0x44, 0, 0, 0, -1);
+        u32ExpLen = Expect(au8Cmd, u32Len, au8Exp);
+        Exchange(0, "T=0 unknown INS", au8Cmd, u32Len, SCAPDU_STS_OK, au8Exp, u32ExpLen);
+
+        psC->u32Mute = 1;
+        u32Len = Apdu(au8Cmd, INS_NOP, 0, 0, 0, -1);
+        Exchange(0, "T=0 mute card", au8Cmd, u32Len, SCAPDU_STS_TIMEOUT, NULL, 0);
+        psC->u32Mute = 0;
+        psC->u32Parity = 1;
+        Exchange(0, "T=0 parity error", au8Cmd, u32Len, SCAPDU_STS_PARITY, NULL, 0);
+        RunAll();
+        psC->u32HdrLen = 0;
+
+        SCAPDU_GetStats(0, &sStats);
+        Check(u32Mode ? (sStats.u32Wtx != 0) : (sStats.u32Wtx == 0), "T=0 NULL bytes counted");
+        printf("T=0 %-28s %4u APDUs, %u NULL bytes\n", u32Mode ? "INS complement, NULLs" : "ACK",
+               (unsigned)sStats.u32Apdus, (unsigned)sStats.u32Wtx);
+        Remove(0);
+    }
+}
+
+static void Resubmit(void *pvArg, SCAPDU_REQ_T *psReq)
+{
+    uint32_t *pu32Left = (uint32_t *)pvArg;
+
+    s_u32Done++;
+    Check(psReq->u32Status == SCAPDU_STS_OK, "resubmitted APDU");
+    if(*pu32Left)
+    {
+        (*pu32Left)--;
+        Check(SCAPDU_Submit(0, psReq) == SCAPDU_OK, "resubmit from the callback");
+    }
+}
+
+static void TestQueue(void)
+{
+    uint8_t au8Cmd[8], aau8Rsp[4][SCAPDU_MAX_RSP], au8Small[10];
+    SCAPDU_REQ_T asReq[4];
+    uint32_t u32Len, i, u32Done = 0, u32Left = 9;
+
+    Insert(0, SCAPDU_T1, SCAPDU_EDC_LRC, 32, 254);
+    memset(asReq, 0, sizeof(asReq));
+
+    /* Invalid APDUs */
+    asReq[0].pu8Cmd = au8Cmd;
+    asReq[0].pu8Rsp = aau8Rsp[0];
+    asReq[0].u32RspSize = SCAPDU_MAX_RSP;
+    au8Cmd[4] = 10;
+    asReq[0].u32CmdLen = 3;
+    Check(SCAPDU_Submit(0, &asReq[0]) == SCAPDU_ERR_PARAM, "3 byte APDU");
+    asReq[0].u32CmdLen = 8;
+    Check(SCAPDU_Submit(0, &asReq[0]) == SCAPDU_ERR_PARAM, "Lc and length differ");
+    asReq[0].u32CmdLen = 4;
+    Check(SCAPDU_Submit(1, &asReq[0]) == SCAPDU_ERR_STATE, "detached interface");
+
+    /* Overflow: a 200 byte response into 10 bytes */
+    u32Len = Apdu(au8Cmd, INS_READ, 200, 0, 0, 200);
+    asReq[0].u32CmdLen = u32Len;
+    asReq[0].pu8Rsp = au8Small;
+    asReq[0].u32RspSize = sizeof(au8Small);
+    asReq[0].pfnDone = Done;
+    asReq[0].pvArg = &u32Done;
+    Check(SCAPDU_Submit(0, &asReq[0]) == SCAPDU_OK, "submit overflow");
+    RunAll();
+    Check((asReq[0].u32Status == SCAPDU_STS_OVERFLOW) && (asReq[0].u32RspLen == sizeof(au8Small)) &&
+          (au8Small[9] == 9 * 7), "overflow");
+
+    /* Resubmission from the callback: 10 APDUs back to back */
+    asReq[1].pu8Cmd = au8Cmd;
+    asReq[1].u32CmdLen = u32Len;
+    asReq[1].pu8Rsp = aau8Rsp[1];
+    asReq[1].u32RspSize = SCAPDU_MAX_RSP;
+    asReq[1].pfnDone = Resubmit;
+    asReq[1].pvArg = &u32Left;
+    s_u32Done = 0;
+    Check(SCAPDU_Submit(0, &asReq[1]) == SCAPDU_OK, "submit resubmitting");
+    RunAll();
+    Check((s_u32Done == 10) && (u32Left == 0), "10 APDUs by resubmission");
+
+    /* Removal: the running and the queued APDUs fail, each once */
+    u32Done = 0;
+    for(i = 0; i < 4; i++)
+    {
+        asReq[i].pu8Cmd = au8Cmd;
+        asReq[i].u32CmdLen = u32Len;
+        asReq[i].pu8Rsp = aau8Rsp[i];
+        asReq[i].u32RspSize = SCAPDU_MAX_RSP;
+        asReq[i].pfnDone = Done;
+        asReq[i].pvArg = &u32Done;
+        Check(SCAPDU_Submit(0, &asReq[i]) == SCAPDU_OK, "submit before removal");
+    }
+    for(i = 0; i < 20; i++)
+        Step();
+    Remove(0);
+    Check(u32Done == 4, "removal: all complete");
+    for(i = 0; i < 4; i++)
+        Check(asReq[i].u32Status == SCAPDU_STS_REMOVED, "removal: removed");
+    Check(SCAPDU_Submit(0, &asReq[0]) == SCAPDU_ERR_STATE, "removed card refuses");
+}
+
+/* u32Apdus of the mixed load on each of the u32Slots interfaces at once; returns the virtual ETU */
+static uint64_t Load(uint32_t u32Slots, uint32_t u32First, uint32_t u32Apdus)
+{
+    static uint8_t aau8Cmd[SLOTS][4][SCAPDU_MAX_CMD], aau8Rsp[SLOTS][4][SCAPDU_MAX_RSP];
+    static SCAPDU_REQ_T aasReq[SLOTS][4];
+    static uint32_t au32Left[SLOTS];
+    uint32_t s, i, au32Len[4];
+    uint64_t u64Start = s_u64Now;
+
+    s_u32Done = 0;
+    for(s = u32First; s < u32First + u32Slots; s++)
+    {
+        au32Len[0] = Apdu(aau8Cmd[s][0], INS_ECHO, 0, (uint8_t)s, 120, 0);
+        au32Len[1] = Apdu(aau8Cmd[s][1], INS_READ, 240, (uint8_t)s, 0, 240);
+        au32Len[2] = Apdu(aau8Cmd[s][2], INS_NOP, 0, 0, 16, -1);
+        au32Len[3] = Apdu(aau8Cmd[s][3], INS_READ, 8, (uint8_t)s, 0, 8);
+        au32Left[s] = u32Apdus;
+        for(i = 0; i < 4; i++)
+        {
+            memset(&aasReq[s][i], 0, sizeof(aasReq[s][i]));
+            aasReq[s][i].pu8Cmd = aau8Cmd[s][i];
+            aasReq[s][i].u32CmdLen = au32Len[i];
+            aasReq[s][i].pu8Rsp = aau8Rsp[s][i];
+            aasReq[s][i].u32RspSize = SCAPDU_MAX_RSP;
+            aasReq[s][i].pfnDone = Done;
+        }
+    }
+
+    /* Keep every interface's queue at 4 APDUs, as a terminal with several readers would */
+    for(;;)
+    {
+        uint32_t u32Busy = 0;
+
+        for(s = u32First; s < u32First + u32Slots; s++)
+        {
+            for(i = 0; i < 4; i++)
+            {
+                if(SCAPDU_IsQueued(&aasReq[s][i]))
+                {
+                    u32Busy = 1;
+                    continue;
+                }
+                if(aasReq[s][i].u32Status != SCAPDU_STS_OK)
+                    Check(0, "load APDU");
+                if(au32Left[s])
+                {
+                    au32Left[s]--;
+                    Check(SCAPDU_Submit(s, &aasReq[s][i]) == SCAPDU_OK, "load submit");
+                    u32Busy = 1;
+                }
+            }
+        }
+        if(!u32Busy)
+            break;
+        Check(Step(), "load progresses");
+    }
+    return s_u64Now - u64Start;
+}
+
+static void TestConcurrent(void)
+{
+    uint64_t u64Parallel, u64Serial = 0;
+    uint32_t s;
+
+    for(s = 0; s < SLOTS; s++)
+        Insert(s, (s == 1) ? SCAPDU_T0 : SCAPDU_T1, (s == 2) ? SCAPDU_EDC_CRC : SCAPDU_EDC_LRC, 254, 254);
+
+    for(s = 0; s < SLOTS; s++)
+        u64Serial += Load(1, s, 40);
+    u64Parallel = Load(SLOTS, 0, 40);
+    Check(s_u32Done == SLOTS * 40, "all load APDUs done");
+
+    printf("%u interfaces x 40 APDUs: one at a time %llu ETU, concurrently %llu ETU, %.2fx\n", (unsigned)SLOTS,
+           (unsigned long long)u64Serial, (unsigned long long)u64Parallel, (double)u64Serial / (double)u64Parallel);
+    Check((double)u64Serial / (double)u64Parallel > 0.9 * SLOTS, "interfaces run concurrently");
+
+    for(s = 0; s < SLOTS; s++)
+        Remove(s);
+}
+
+int main(void)
+{
+    CrcInit();
+    SCAPDU_Init(&s_sPort);
+
+    TestAtr();
+    TestT1(SCAPDU_EDC_LRC, 32, 32);
+    TestT1(SCAPDU_EDC_LRC, 32, 254);
+    TestT1(SCAPDU_EDC_CRC, 254, 254);
+    TestT1(SCAPDU_EDC_CRC, 16, 100);
+    TestT1Faults();
+    TestT0();
+    TestQueue();
+    TestConcurrent();
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   lwIP compiler/platform definitions for the SockBench host build
+ */
+#ifndef __ARCH_CC_H__
+#define __ARCH_CC_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+// Host struct timeval, errno and fd_set; lwIP must not define its own
+#define LWIP_TIMEVAL_PRIVATE        0
+#define LWIP_ERRNO_INCLUDE          <errno.h>
+
+#define LWIP_RAND()                 ((u32_t)rand())
+
+#define LWIP_PLATFORM_DIAG(x)       do { printf x; } while(0)
+#define LWIP_PLATFORM_ASSERT(x)     do { printf("Assertion \"%s\" failed at line %d in %s\n", \
+                                         x, __LINE__, __FILE__); fflush(NULL); abort(); } while(0)
+
+#endif /* __ARCH_CC_H__ */
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   lwIP OS abstraction types for the SockBench host build (POSIX threads)
+ */
+#ifndef __ARCH_SYS_ARCH_H__
+#define __ARCH_SYS_ARCH_H__
+
+#define SYS_MBOX_NULL               NULL
+#define SYS_SEM_NULL                NULL
+
+struct sys_sem;
+struct sys_mbox;
+struct sys_thread;
+
+typedef struct sys_sem *sys_sem_t;
+typedef struct sys_sem *sys_mutex_t;
+typedef struct sys_mbox *sys_mbox_t;
+typedef struct sys_thread *sys_thread_t;
+typedef int sys_prot_t;
+
+#define sys_sem_valid(s)            (((s) != NULL) && (*(s) != NULL))
+#define sys_sem_set_invalid(s)      do { if((s) != NULL) { *(s) = NULL; } } while(0)
+#define sys_mutex_valid(m)          sys_sem_valid(m)
+#define sys_mutex_set_invalid(m)    sys_sem_set_invalid(m)
+#define sys_mbox_valid(m)           (((m) != NULL) && (*(m) != NULL))
+#define sys_mbox_set_invalid(m)     do { if((m) != NULL) { *(m) = NULL; } } while(0)
+
+#endif /* __ARCH_SYS_ARCH_H__ */
@@ -0,0 +1,389 @@
+/**************************************************************************//**
+ * @file     sockbench.c
+ * @version  V1.00
+ * @brief    Host test and benchmark of lwip_select() against lwip_epoll_wait() with many
+ *           connected TCP sockets.
+ *
+ * The lwIP core and socket layer from ThirdParty/lwIP run on the host over the loopback
+ * interface, on a POSIX threads port (sys_arch.c) that behaves like the FreeRTOS one: binary
+ * semaphores, one critical section for SYS_ARCH_PROTECT.
+ *
+ * First the epoll semantics are checked: level- and edge-triggered input, output readiness,
+ * timeouts, wakeup from another thread, error codes, and that closing a socket or deleting it
+ * frees its registration.
+ *
+ * Then a gateway-like server task multiplexes 32 and 64 connected sockets. The client sends one
+ * byte on one connection at a time, scattered over all of them, and waits for the echo, so the
+ * server always finds one ready socket among many idle ones. With select the server rebuilds
+ * the fd_set, lwip_select() scans every socket twice and the server tests every bit afterwards;
+ * with epoll the registration is done once and the wait only sees the ready socket. The server
+ * thread CPU time spent in the wait call and in the whole loop is reported per message.
+ *
+ * Every echo must come back unchanged, all semantic checks must hold, and at 64 sockets the
+ * epoll wait must cost less CPU time than select.
+ *
+ * Build:  L=../../ThirdParty/lwIP/src
+ *         cc -O2 -pthread -I. -I$L/include -o sockbench sockbench.c sys_arch.c
+ *             $L/core/[a-z]*.c $L/core/ipv4/[a-z]*.c $L/api/[a-z]*.c
+ *
+ * Usage:  sockbench [messages per run]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "lwip/tcpip.h"
+#include "lwip/sockets.h"
+
+#define MAX_CONN            64
+#define BASE_PORT           7000
+#define MODE_SELECT         0
+#define MODE_EPOLL          1
+
+typedef struct
+{
+    int iMode;
+    int iNum;
+    uint32_t u32Msgs;
+    uint64_t u64WaitNs;     /* Server thread CPU time in select/epoll_wait */
+    uint64_t u64LoopNs;     /* Server thread CPU time of the whole loop */
+    uint32_t u32Waits;
+} SERVER_T;
+
+static int s_aiClient[MAX_CONN];
+static int s_aiServer[MAX_CONN];
+static int s_iPort = BASE_PORT;
+static uint32_t s_u32Fails;
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s (errno %d)\n", pcWhat, errno);
+        s_u32Fails++;
+    }
+}
+
+static uint64_t ThreadNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t WallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void TcpipInitDone(void *pvArg)
+{
+    sys_sem_signal((sys_sem_t *)pvArg);
+}
+
+/* Connects iNum client sockets to iNum accepted server sockets over 127.0.0.1. */
+static int Connect(int iNum)
+{
+    struct sockaddr_in sAddr;
+    struct timeval sTv = { 2, 0 };
+    int iListen, i, iOn = 1;
+
+    memset(&sAddr, 0, sizeof(sAddr));
+    sAddr.sin_len = sizeof(sAddr);
+    sAddr.sin_family = AF_INET;
+    sAddr.sin_port = PP_HTONS(s_iPort);
+    sAddr.sin_addr.s_addr = PP_HTONL(0x7F000001UL);
+    s_iPort++;
+
+    iListen = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    if(iListen < 0 || lwip_bind(iListen, (struct sockaddr *)&sAddr, sizeof(sAddr)) < 0 ||
+            lwip_listen(iListen, iNum) < 0)
+        return -1;
+
+    for(i = 0; i < iNum; i++)
+    {
+        s_aiClient[i] = lwip_socket(AF_INET, SOCK_STREAM, 0);
+        if(s_aiClient[i] < 0 || lwip_connect(s_aiClient[i], (struct sockaddr *)&sAddr, sizeof(sAddr)) < 0)
+            return -1;
+        s_aiServer[i] = lwip_accept(iListen, NULL, NULL);
+        if(s_aiServer[i] < 0)
+            return -1;
+        lwip_setsockopt(s_aiClient[i], IPPROTO_TCP, TCP_NODELAY, &iOn, sizeof(iOn));
+        lwip_setsockopt(s_aiServer[i], IPPROTO_TCP, TCP_NODELAY, &iOn, sizeof(iOn));
+        lwip_setsockopt(s_aiClient[i], SOL_SOCKET, SO_RCVTIMEO, &sTv, sizeof(sTv));
+    }
+    lwip_close(iListen);
+    return 0;
+}
+
+static void Disconnect(int iNum)
+{
+    int i;
+
+    for(i = 0; i < iNum; i++)
+    {
+        lwip_close(s_aiClient[i]);
+        lwip_close(s_aiServer[i]);
+    }
+}
+
+static void *DelayedSend(void *pvArg)
+{
+    usleep(20000);
+    lwip_send(*(int *)pvArg, "w", 1, 0);
+    return NULL;
+}
+
+static void TestSemantics(void)
+{
+    struct lwip_epoll_event sEv, asEv[4];
+    pthread_t sThread;
+    uint32_t u32Start;
+    char acBuf[8];
+    int iEp, iC, iS, i, n, iUdp;
+
+    Check(lwip_epoll_create(0) == -1 && errno == EINVAL, "epoll_create(0) accepted");
+    iEp = lwip_epoll_create(1);
+    Check(iEp >= 0, "epoll_create");
+    Check(Connect(1) == 0, "connect");
+    iC = s_aiClient[0];
+    iS = s_aiServer[0];
+
+    sEv.events = LWIP_EPOLLIN;
+    sEv.data.fd = iS;
+    Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_ADD, iS, &sEv) == 0, "add");
+    Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_ADD, iS, &sEv) == -1 && errno == EEXIST, "second add");
+    Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_MOD, iC, &sEv) == -1 && errno == ENOENT, "mod unregistered");
+    Check(lwip_epoll_ctl(iEp, 9, iS, &sEv) == -1 && errno == EINVAL, "bad op");
+    Check(lwip_epoll_ctl(iEp + 1, LWIP_EPOLL_CTL_ADD, iS, &sEv) == -1 && errno == EBADF, "bad epfd");
+    Check(lwip_epoll_wait(iEp, asEv, 0, 0) == -1 && errno == EINVAL, "maxevents 0");
+
+    /* Timeouts */
+    Check(lwip_epoll_wait(iEp, asEv, 4, 0) == 0, "poll of idle socket");
+    u32Start = sys_now();
+    Check(lwip_epoll_wait(iEp, asEv, 4, 50) == 0, "timed wait of idle socket");
+    Check(sys_now() - u32Start >= 45, "timed wait returned early");
+
+    /* Level-triggered: reported until read */
+    lwip_send(iC, "ab", 2, 0);
+    n = lwip_epoll_wait(iEp, asEv, 4, 1000);
+    Check(n == 1 && asEv[0].events == LWIP_EPOLLIN && asEv[0].data.fd == iS, "level-triggered input");
+    Check(lwip_epoll_wait(iEp, asEv, 4, 0) == 1, "level-triggered input repeated");
+    Check(lwip_recv(iS, acBuf, sizeof(acBuf), 0) == 2, "recv");
+    Check(lwip_epoll_wait(iEp, asEv, 4, 0) == 0, "input reported after read");
+
+    /* Edge-triggered: reported once per arrival */
+    sEv.events = LWIP_EPOLLIN | LWIP_EPOLLET;
+    Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_MOD, iS, &sEv) == 0, "mod");
+    lwip_send(iC, "c", 1, 0);
+    Check(lwip_epoll_wait(iEp, asEv, 4, 1000) == 1, "edge-triggered input");
+    Check(lwip_epoll_wait(iEp, asEv, 4, 0) == 0, "edge-triggered input repeated");
+    lwip_send(iC, "d", 1, 0);
+    Check(lwip_epoll_wait(iEp, asEv, 4, 1000) == 1, "edge-triggered second input");
+    n = 0;
+    while(n < 2 && (i = lwip_recv(iS, acBuf, sizeof(acBuf), 0)) > 0)
+        n += i;
+    Check(n == 2, "edge-triggered data");
+
+    /* Output readiness */
+    sEv.events = LWIP_EPOLLOUT;
+    sEv.data.fd = iC;
+    Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_ADD, iC, &sEv) == 0, "add output");
+    n = lwip_epoll_wait(iEp, asEv, 4, 0);
+    Check(n == 1 && asEv[0].events == LWIP_EPOLLOUT && asEv[0].data.fd == iC, "output ready");
+    Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_DEL, iC, NULL) == 0, "del");
+    Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_DEL, iC, NULL) == -1 && errno == ENOENT, "second del");
+
+    /* Wakeup from another thread */
+    pthread_create(&sThread, NULL, DelayedSend, &iC);
+    u32Start = sys_now();
+    n = lwip_epoll_wait(iEp, asEv, 4, -1);
+    Check(n == 1 && asEv[0].data.fd == iS, "wakeup by another thread");
+    Check(sys_now() - u32Start >= 15, "woken up before the send");
+    pthread_join(sThread, NULL);
+    lwip_recv(iS, acBuf, sizeof(acBuf), 0);
+
+    /* Registrations are freed by delete and by closing the socket */
+    for(i = 0; i < 2 * LWIP_SOCKET_EPOLL_ITEMS; i++)
+    {
+        Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_ADD, iC, &sEv) == 0, "add after del");
+        Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_DEL, iC, NULL) == 0, "del after add");
+    }
+    for(i = 0; i < 2 * LWIP_SOCKET_EPOLL_ITEMS; i++)
+    {
+        iUdp = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+        sEv.data.fd = iUdp;
+        Check(lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_ADD, iUdp, &sEv) == 0, "add after close");
+        lwip_close(iUdp);
+    }
+    n = lwip_epoll_wait(iEp, asEv, 4, 0);
+    Check(n == 0, "closed socket reported");
+
+    Disconnect(1);
+    Check(lwip_close(iEp) == 0, "close epoll");
+    Check(lwip_epoll_wait(iEp, asEv, 4, 0) == -1 && errno == EBADF, "wait on closed epoll");
+}
+
+/* Echoes whatever arrives until u32Msgs bytes went through. */
+static void *Server(void *pvArg)
+{
+    SERVER_T *psSrv = (SERVER_T *)pvArg;
+    struct lwip_epoll_event asEv[MAX_CONN], sEv;
+    struct timeval sTv;
+    fd_set sRd;
+    uint32_t u32Done = 0;
+    uint64_t u64T0, u64Loop0;
+    char acBuf[64];
+    int iEp = -1, iMax = 0, i, n, iFd, iLen;
+
+    if(psSrv->iMode == MODE_EPOLL)
+    {
+        iEp = lwip_epoll_create(MAX_CONN);
+        for(i = 0; i < psSrv->iNum; i++)
+        {
+            sEv.events = LWIP_EPOLLIN;
+            sEv.data.fd = s_aiServer[i];
+            lwip_epoll_ctl(iEp, LWIP_EPOLL_CTL_ADD, s_aiServer[i], &sEv);
+        }
+    }
+    else
+    {
+        for(i = 0; i < psSrv->iNum; i++)
+            if(s_aiServer[i] > iMax)
+                iMax = s_aiServer[i];
+    }
+
+    u64Loop0 = ThreadNs();
+    while(u32Done < psSrv->u32Msgs)
+    {
+        if(psSrv->iMode == MODE_EPOLL)
+        {
+            u64T0 = ThreadNs();
+            n = lwip_epoll_wait(iEp, asEv, MAX_CONN, 1000);
+            psSrv->u64WaitNs += ThreadNs() - u64T0;
+            psSrv->u32Waits++;
+            for(i = 0; i < n; i++)
+            {
+                iFd = asEv[i].data.fd;
+                iLen = lwip_recv(iFd, acBuf, sizeof(acBuf), MSG_DONTWAIT);
+                if(iLen > 0)
+                {
+                    lwip_send(iFd, acBuf, (size_t)iLen, 0);
+                    u32Done += (uint32_t)iLen;
+                }
+            }
+        }
+        else
+        {
+            u64T0 = ThreadNs();
+            FD_ZERO(&sRd);
+            for(i = 0; i < psSrv->iNum; i++)
+                FD_SET(s_aiServer[i], &sRd);
+            sTv.tv_sec = 1;
+            sTv.tv_usec = 0;
+            n = lwip_select(iMax + 1, &sRd, NULL, NULL, &sTv);
+            psSrv->u64WaitNs += ThreadNs() - u64T0;
+            psSrv->u32Waits++;
+            for(i = 0; n > 0 && i < psSrv->iNum; i++)
+            {
+                if(!FD_ISSET(s_aiServer[i], &sRd))
+                    continue;
+                n--;
+                iLen = lwip_recv(s_aiServer[i], acBuf, sizeof(acBuf), MSG_DONTWAIT);
+                if(iLen > 0)
+                {
+                    lwip_send(s_aiServer[i], acBuf, (size_t)iLen, 0);
+                    u32Done += (uint32_t)iLen;
+                }
+            }
+        }
+    }
+    psSrv->u64LoopNs = ThreadNs() - u64Loop0;
+
+    if(iEp >= 0)
+        lwip_close(iEp);
+    return NULL;
+}
+
+static void RunBench(int iMode, int iNum, uint32_t u32Msgs, SERVER_T *psSrv)
+{
+    pthread_t sThread;
+    uint64_t u64T0, u64Wall;
+    uint32_t k, u32Bad = 0;
+    unsigned char u8Tx, u8Rx;
+    int i;
+
+    memset(psSrv, 0, sizeof(*psSrv));
+    psSrv->iMode = iMode;
+    psSrv->iNum = iNum;
+    psSrv->u32Msgs = u32Msgs;
+
+    if(Connect(iNum) != 0)
+    {
+        Check(0, "connect for benchmark");
+        return;
+    }
+    pthread_create(&sThread, NULL, Server, psSrv);
+
+    u64T0 = WallNs();
+    for(k = 0; k < u32Msgs; k++)
+    {
+        /* 7 is prime to the connection count, so consecutive messages use far apart sockets */
+        i = (int)((k * 7) % (uint32_t)iNum);
+        u8Tx = (unsigned char)k;
+        lwip_send(s_aiClient[i], &u8Tx, 1, 0);
+        if(lwip_recv(s_aiClient[i], &u8Rx, 1, 0) != 1 || u8Rx != u8Tx)
+        {
+            u32Bad++;
+            break;
+        }
+    }
+    u64Wall = WallNs() - u64T0;
+    pthread_join(sThread, NULL);
+    Disconnect(iNum);
+
+    Check(u32Bad == 0, "echo lost or corrupted");
+    printf("%-6s %3d sockets: %7.1f us/round trip, wait %6.0f ns/msg, server loop %6.0f ns/msg, %u waits\n",
+           iMode == MODE_EPOLL ? "epoll" : "select", iNum, u64Wall / 1000.0 / u32Msgs,
+           (double)psSrv->u64WaitNs / u32Msgs, (double)psSrv->u64LoopNs / u32Msgs, psSrv->u32Waits);
+}
+
+int main(int argc, char **argv)
+{
+    static const int aiNum[] = { 32, 64 };
+    SERVER_T asRes[2][2];
+    sys_sem_t sDone;
+    uint32_t u32Msgs = 20000;
+    unsigned int i;
+
+    if(argc > 1)
+        u32Msgs = (uint32_t)strtoul(argv[1], NULL, 0);
+    if(u32Msgs == 0)
+        u32Msgs = 1;
+
+    sys_sem_new(&sDone, 0);
+    tcpip_init(TcpipInitDone, &sDone);
+    sys_arch_sem_wait(&sDone, 0);
+
+    TestSemantics();
+
+    for(i = 0; i < sizeof(aiNum) / sizeof(aiNum[0]); i++)
+    {
+        RunBench(MODE_SELECT, aiNum[i], u32Msgs, &asRes[i][MODE_SELECT]);
+        RunBench(MODE_EPOLL, aiNum[i], u32Msgs, &asRes[i][MODE_EPOLL]);
+    }
+    Check(asRes[1][MODE_EPOLL].u64WaitNs < asRes[1][MODE_SELECT].u64WaitNs,
+          "epoll wait not cheaper than select at 64 sockets");
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   lwIP OS abstraction for the SockBench host build (POSIX threads)
+ *
+ * Semaphores and mailboxes are built on a mutex and condition variables, the lightweight
+ * protection is one recursive mutex, like a critical section on the target.
+ */
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include "lwip/err.h"
+
+struct sys_sem
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned int count;
+};
+
+struct sys_mbox
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    void **msgs;
+    int size;
+    int first;
+    int count;
+};
+
+struct sys_thread
+{
+    pthread_t thread;
+    lwip_thread_fn function;
+    void *arg;
+};
+
+static pthread_mutex_t s_protect_mutex;
+static struct timespec s_start;
+
+static void deadline(struct timespec *ts, u32_t ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if(ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void sys_init(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_protect_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &s_start);
+}
+
+u32_t sys_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32_t)((ts.tv_sec - s_start.tv_sec) * 1000 + (ts.tv_nsec - s_start.tv_nsec) / 1000000);
+}
+
+sys_prot_t sys_arch_protect(void)
+{
+    pthread_mutex_lock(&s_protect_mutex);
+    return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t pval)
+{
+    LWIP_UNUSED_ARG(pval);
+    pthread_mutex_unlock(&s_protect_mutex);
+}
+
+err_t sys_sem_new(sys_sem_t *sem, u8_t count)
+{
+    struct sys_sem *s = (struct sys_sem *)calloc(1, sizeof(struct sys_sem));
+
+    if(s == NULL)
+        return ERR_MEM;
+    pthread_mutex_init(&s->mutex, NULL);
+    cond_init(&s->cond);
+    s->count = count;
+    *sem = s;
+    return ERR_OK;
+}
+
+void sys_sem_free(sys_sem_t *sem)
+{
+    struct sys_sem *s = *sem;
+
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->mutex);
+    free(s);
+    *sem = NULL;
+}
+
+void sys_sem_signal(sys_sem_t *sem)
+{
+    struct sys_sem *s = *sem;
+
+    pthread_mutex_lock(&s->mutex);
+    // Binary, like the FreeRTOS port
+    s->count = 1;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout)
+{
+    struct sys_sem *s = *sem;
+    struct timespec ts;
+    u32_t start = sys_now();
+
+    pthread_mutex_lock(&s->mutex);
+    if(timeout)
+    {
+        deadline(&ts, timeout);
+        while(s->count == 0)
+        {
+            if(pthread_cond_timedwait(&s->cond, &s->mutex, &ts) == ETIMEDOUT && s->count == 0)
+            {
+                pthread_mutex_unlock(&s->mutex);
+                return SYS_ARCH_TIMEOUT;
+            }
+        }
+    }
+    else
+    {
+        while(s->count == 0)
+            pthread_cond_wait(&s->cond, &s->mutex);
+    }
+    s->count--;
+    pthread_mutex_unlock(&s->mutex);
+    return sys_now() - start;
+}
+
+err_t sys_mutex_new(sys_mutex_t *mutex)
+{
+    return sys_sem_new(mutex, 1);
+}
+
+void sys_mutex_lock(sys_mutex_t *mutex)
+{
+    sys_arch_sem_wait(mutex, 0);
+}
+
+void sys_mutex_unlock(sys_mutex_t *mutex)
+{
+    sys_sem_signal(mutex);
+}
+
+void sys_mutex_free(sys_mutex_t *mutex)
+{
+    sys_sem_free(mutex);
+}
+
+err_t sys_mbox_new(sys_mbox_t *mbox, int size)
+{
+    struct sys_mbox *m = (struct sys_mbox *)calloc(1, sizeof(struct sys_mbox));
+
+    if(m == NULL)
+        return ERR_MEM;
+    if(size <= 0)
+        size = 128;
+    m->msgs = (void **)calloc((size_t)size, sizeof(void *));
+    if(m->msgs == NULL)
+    {
+        free(m);
+        return ERR_MEM;
+    }
+    m->size = size;
+    pthread_mutex_init(&m->mutex, NULL);
+    cond_init(&m->not_empty);
+    cond_init(&m->not_full);
+    *mbox = m;
+    return ERR_OK;
+}
+
+void sys_mbox_free(sys_mbox_t *mbox)
+{
+    struct sys_mbox *m = *mbox;
+
+    pthread_cond_destroy(&m->not_full);
+    pthread_cond_destroy(&m->not_empty);
+    pthread_mutex_destroy(&m->mutex);
+    free(m->msgs);
+    free(m);
+    *mbox = NULL;
+}
+
+static void mbox_put(struct sys_mbox *m, void *msg)
+{
+    m->msgs[(m->first + m->count) % m->size] = msg;
+    m->count++;
+    pthread_cond_signal(&m->not_empty);
+}
+
+void sys_mbox_post(sys_mbox_t *mbox, void *msg)
+{
+    struct sys_mbox *m = *mbox;
+
+    pthread_mutex_lock(&m->mutex);
+    while(m->count == m->size)
+        pthread_cond_wait(&m->not_full, &m->mutex);
+    mbox_put(m, msg);
+    pthread_mutex_unlock(&m->mutex);
+}
+
+err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
+{
+    struct sys_mbox *m = *mbox;
+    err_t err = ERR_MEM;
+
+    pthread_mutex_lock(&m->mutex);
+    if(m->count < m->size)
+    {
+        mbox_put(m, msg);
+        err = ERR_OK;
+    }
+    pthread_mutex_unlock(&m->mutex);
+    return err;
+}
+
+static void *mbox_get(struct sys_mbox *m)
+{
+    void *msg = m->msgs[m->first];
+
+    m->first = (m->first + 1) % m->size;
+    m->count--;
+    pthread_cond_signal(&m->not_full);
+    return msg;
+}
+
+u32_t sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout)
+{
+    struct sys_mbox *m = *mbox;
+    struct timespec ts;
+    u32_t start = sys_now();
+    void *v;
+
+    pthread_mutex_lock(&m->mutex);
+    if(timeout)
+    {
+        deadline(&ts, timeout);
+        while(m->count == 0)
+        {
+            if(pthread_cond_timedwait(&m->not_empty, &m->mutex, &ts) == ETIMEDOUT && m->count == 0)
+            {
+                pthread_mutex_unlock(&m->mutex);
+                return SYS_ARCH_TIMEOUT;
+            }
+        }
+    }
+    else
+    {
+        while(m->count == 0)
+            pthread_cond_wait(&m->not_empty, &m->mutex);
+    }
+    v = mbox_get(m);
+    pthread_mutex_unlock(&m->mutex);
+    if(msg != NULL)
+        *msg = v;
+    return sys_now() - start;
+}
+
+u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
+{
+    struct sys_mbox *m = *mbox;
+    void *v;
+
+    pthread_mutex_lock(&m->mutex);
+    if(m->count == 0)
+    {
+        pthread_mutex_unlock(&m->mutex);
+        return SYS_MBOX_EMPTY;
+    }
+    v = mbox_get(m);
+    pthread_mutex_unlock(&m->mutex);
+    if(msg != NULL)
+        *msg = v;
+    return 0;
+}
+
+static void *thread_entry(void *arg)
+{
+    struct sys_thread *t = (struct sys_thread *)arg;
+
+    t->function(t->arg);
+    return NULL;
+}
+
+sys_thread_t sys_thread_new(const char *name, lwip_thread_fn function, void *arg, int stacksize, int prio)
+{
+    struct sys_thread *t = (struct sys_thread *)calloc(1, sizeof(struct sys_thread));
+
+    LWIP_UNUSED_ARG(name);
+    LWIP_UNUSED_ARG(stacksize);
+    LWIP_UNUSED_ARG(prio);
+    LWIP_ASSERT("sys_thread_new: out of memory", t != NULL);
+    t->function = function;
+    t->arg = arg;
+    if(pthread_create(&t->thread, NULL, thread_entry, t) != 0)
+        LWIP_ASSERT("sys_thread_new: pthread_create failed", 0);
+    return t;
+}
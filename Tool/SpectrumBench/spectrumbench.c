@@ -0,0 +1,202 @@
+/**************************************************************************//**
+ * @file     spectrumbench.c
+ * @version  V1.00
+ * @brief    Accuracy check and frame rate benchmark of the streaming spectrum analyzer
+ *           (StdDriver/src/spectrum.c) on the portable C sources of the CMSIS-DSP library.
+ *
+ * For every FFT length from 32 to 4096 and both processing formats, a 48 kHz Q15 stream is fed
+ * in blocks of 64 samples, as EADCACQ_Process() would deliver them: a 0.5 sine centred on bin
+ * N / 8, a 0.1 sine a quarter bin off bin 3N / 8 and uniform noise of 0.01. Hann window, 50 % overlap,
+ * 4 frames per result. The two strongest peaks of every result must be the sines, at their
+ * frequency and amplitude. Both sines repeat seamlessly over the looped signal buffer.
+ *
+ * The rate pass then streams the same signal for a fixed time and reports frames (FFTs) per
+ * second and the sample rate one analyzer keeps up with. ARM_MATH_CM0 selects the generic C
+ * kernels of the library; on the M480 the SIMD (ARM_MATH_CM4) kernels run instead, so only
+ * the ratios between lengths and formats carry over. The library's bit reversal is ARM assembly;
+ * ../DspCommon/arm_bitreversal.c stands in for it.
+ *
+ * Build:  D=../../Library/CMSIS/DSP_Lib/Source
+ *         cc -O2 -DARM_MATH_CM0 -fno-strict-aliasing -I../../Library/CMSIS/Include
+ *             -I../../Library/StdDriver/inc -o spectrumbench spectrumbench.c
+ *             ../../Library/StdDriver/src/spectrum.c ../DspCommon/arm_bitreversal.c $(find $D -name '*.c') -lm
+ *
+ * Usage:  spectrumbench [ms per rate measurement]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "spectrum.h"
+
+#define FS              48000.0f
+#define BLOCK           64UL            /* Samples per EADC block */
+#define SIGNAL_LEN      65536UL         /* Signal buffer, streamed in a loop */
+#define AVERAGE         4UL
+#define PEAKS           4UL
+
+static uint32_t s_u32Fails;
+static int16_t s_ai16Signal[SIGNAL_LEN];
+static uint32_t s_au32Arena[SPECTRUM_ARENA_SIZE(SPECTRUM_MAX_FFT, SPECTRUM_Q31, PEAKS) / 4UL];
+
+/* Expected peaks of the current run */
+static float s_fF1, s_fF2;
+static uint32_t s_u32Results, s_u32BadResults;
+
+static uint64_t WallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+static void MakeSignal(uint32_t u32N)
+{
+    uint32_t i, u32Seed = 12345;
+    double dNoise, dS;
+
+    s_fF1 = FS * (float)(u32N / 8) / (float)u32N;
+    s_fF2 = FS * ((float)(3 * u32N / 8) + 0.25f) / (float)u32N;
+
+    for(i = 0; i < SIGNAL_LEN; i++)
+    {
+        u32Seed = u32Seed * 1103515245UL + 12345UL;
+        dNoise = ((double)(u32Seed >> 8) / 8388608.0 - 1.0) * 0.01;
+        dS = 0.5 * sin(2.0 * M_PI * s_fF1 * i / FS) + 0.1 * sin(2.0 * M_PI * s_fF2 * i / FS) + dNoise;
+        s_ai16Signal[i] = (int16_t)lrint(dS * 32768.0);
+    }
+}
+
+static void OnResult(void *pvArg, const SPECTRUM_RESULT_T *psResult)
+{
+    uint32_t u32N = *(uint32_t *)pvArg;
+    float fBin = FS / (float)u32N;
+    const SPECTRUM_PEAK_T *psP = psResult->psPeaks;
+    int iOk;
+
+    s_u32Results++;
+    iOk = (psResult->u32Peaks >= 2) && (psResult->u32Bins == u32N / 2 + 1) &&
+          (psP[0].u32Bin == u32N / 8) && (fabsf(psP[0].f32Freq - s_fF1) < 0.05f * fBin) &&
+          (fabsf(psP[0].f32Mag - 0.5f) < 0.01f) &&
+          (fabsf(psP[1].f32Freq - s_fF2) < 0.1f * fBin) && (fabsf(psP[1].f32Mag - 0.1f) < 0.01f);
+    if(!iOk)
+    {
+        if(s_u32BadResults == 0)
+            printf("  peaks %u: %.1f Hz %.4f, %.1f Hz %.4f (want %.1f Hz 0.5, %.1f Hz 0.1)\n",
+                   psResult->u32Peaks, psP[0].f32Freq, psP[0].f32Mag, psP[1].f32Freq, psP[1].f32Mag,
+                   s_fF1, s_fF2);
+        s_u32BadResults++;
+    }
+}
+
+static int32_t Open(SPECTRUM_T *psSpec, uint32_t u32N, uint32_t u32Fmt, uint32_t *pu32Arg)
+{
+    SPECTRUM_CFG_T sCfg =
+    {
+        .u32Fmt = u32Fmt,
+        .u32FftLen = u32N,
+        .u32Hop = u32N / 2,
+        .u32Window = SPECTRUM_WIN_HANN,
+        .u32Average = AVERAGE,
+        .u32MaxPeaks = PEAKS,
+        .f32Threshold = 0.02f,
+        .f32SampleRate = FS,
+        .pfnResult = OnResult,
+        .pvArg = pu32Arg,
+    };
+
+    return SPECTRUM_Open(psSpec, &sCfg, s_au32Arena, SPECTRUM_ARENA_SIZE(u32N, u32Fmt, PEAKS));
+}
+
+/* Frames per second over about u32Ms of streaming, from the start of the signal */
+static double Rate(SPECTRUM_T *psSpec, uint32_t u32Ms)
+{
+    uint64_t u64Start, u64Ns;
+    uint32_t u32Pos = 0, u32Frames = 0, i;
+
+    SPECTRUM_Reset(psSpec);
+    u64Start = WallNs();
+
+    do
+    {
+        for(i = 0; i < 64; i++)
+        {
+            u32Frames += SPECTRUM_Write(psSpec, &s_ai16Signal[u32Pos], BLOCK, SPECTRUM_Q15);
+            u32Pos = (u32Pos + BLOCK) % SIGNAL_LEN;
+        }
+        u64Ns = WallNs() - u64Start;
+    }
+    while(u64Ns < (uint64_t)u32Ms * 1000000ULL);
+
+    return (double)u32Frames * 1e9 / (double)u64Ns;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *apcFmt[] = { "F32", "Q31" };
+    SPECTRUM_T sSpec;
+    SPECTRUM_CFG_T sBad;
+    uint32_t u32Ms = (argc > 1) ? (uint32_t)atoi(argv[1]) : 300;
+    uint32_t u32N, u32Fmt, u32Pos;
+    double dRate;
+    char acWhat[64];
+
+    /* Parameter and arena checks */
+    u32N = 1024;
+    Check(Open(&sSpec, u32N, SPECTRUM_F32, &u32N) == SPECTRUM_OK, "open");
+    Check(SPECTRUM_Open(&sSpec, &sSpec.sCfg, s_au32Arena, SPECTRUM_ARENA_SIZE(1024, SPECTRUM_F32, PEAKS) - 1) ==
+          SPECTRUM_ERR_MEM, "arena one byte short");
+    Check(SPECTRUM_Open(&sSpec, &sSpec.sCfg, (uint8_t *)s_au32Arena + 2, sizeof(s_au32Arena) - 2) ==
+          SPECTRUM_ERR_MEM, "unaligned arena");
+    sBad = sSpec.sCfg;
+    sBad.u32FftLen = 1000;
+    Check(SPECTRUM_Open(&sSpec, &sBad, s_au32Arena, sizeof(s_au32Arena)) == SPECTRUM_ERR_PARAM, "FFT length 1000");
+    sBad = sSpec.sCfg;
+    sBad.u32Hop = 2048;
+    Check(SPECTRUM_Open(&sSpec, &sBad, s_au32Arena, sizeof(s_au32Arena)) == SPECTRUM_ERR_PARAM, "hop above FFT length");
+
+    printf("  FFT  fmt  arena B   frames/s   us/frame  realtime kS/s\n");
+    for(u32N = SPECTRUM_MIN_FFT; u32N <= SPECTRUM_MAX_FFT; u32N *= 2)
+    {
+        MakeSignal(u32N);
+        for(u32Fmt = SPECTRUM_F32; u32Fmt <= SPECTRUM_Q31; u32Fmt++)
+        {
+            snprintf(acWhat, sizeof(acWhat), "%u point %s open", u32N, apcFmt[u32Fmt]);
+            Check(Open(&sSpec, u32N, u32Fmt, &u32N) == SPECTRUM_OK, acWhat);
+
+            /* Accuracy: 12 results */
+            s_u32Results = s_u32BadResults = 0;
+            for(u32Pos = 0; s_u32Results < 12; u32Pos = (u32Pos + BLOCK) % SIGNAL_LEN)
+                SPECTRUM_Write(&sSpec, &s_ai16Signal[u32Pos], BLOCK, SPECTRUM_Q15);
+            snprintf(acWhat, sizeof(acWhat), "%u point %s peaks (%u of %u results)", u32N, apcFmt[u32Fmt],
+                     s_u32BadResults, s_u32Results);
+            Check(s_u32BadResults == 0, acWhat);
+
+            /* The results of the rate pass are checked too */
+            s_u32Results = s_u32BadResults = 0;
+            dRate = Rate(&sSpec, u32Ms);
+            snprintf(acWhat, sizeof(acWhat), "%u point %s rate pass (%u of %u results)", u32N, apcFmt[u32Fmt],
+                     s_u32BadResults, s_u32Results);
+            Check(s_u32BadResults == 0, acWhat);
+            printf("%5u  %s %8u %10.0f %10.2f %14.0f\n", u32N, apcFmt[u32Fmt],
+                   (uint32_t)SPECTRUM_ARENA_SIZE(u32N, u32Fmt, PEAKS), dRate, 1e6 / dRate, dRate * (u32N / 2) / 1000.0);
+        }
+    }
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
@@ -0,0 +1,487 @@
+/**************************************************************************//**
+ * @file     trace_decode.c
+ * @version  V1.00
+ * @brief    Host decoder for the StdDriver trace points (trace.h).
+ *
+ * Reads either a RAM dump of g_sTraceBuf or a raw SWO/ITM byte stream, pairs
+ * TRACE_BEGIN/TRACE_END records into spans and prints per trace point latency
+ * statistics with a log2 microsecond histogram. Optionally writes the spans in
+ * Chrome trace event JSON (chrome://tracing, Perfetto).
+ *
+ * Build:  cc -O2 -I../../Library/StdDriver/inc -o trace_decode trace_decode.c
+ *
+ * Usage:  trace_decode [-i] [-c hz] [-p port] [-n names.txt] [-j out.json] capture.bin
+ *   -i            input is a raw ITM stream (default: auto-detect g_sTraceBuf dump)
+ *   -c hz         CPU clock, default taken from the dump or 192000000
+ *   -p port       ITM stimulus port, default TRACE_ITM_PORT
+ *   -n names.txt  extra "id name" lines for application trace points
+ *   -j out.json   write Chrome trace JSON
+ *
+ * Capture examples:
+ *   gdb:     dump binary value capture.bin g_sTraceBuf
+ *   J-Link:  savebin capture.bin, <&g_sTraceBuf>, <sizeof(g_sTraceBuf)>
+ *   SWO:     any tool that saves the raw SWO byte stream (e.g. JLinkSWOViewerCL -outputfile)
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include "trace.h"
+
+#define MAX_ID          256
+#define MAX_DEPTH       16
+#define HIST_BINS       20
+
+typedef struct
+{
+    uint64_t u64Time;       /* unwrapped cycle count */
+    uint32_t u32Desc;
+} REC_T;
+
+typedef struct
+{
+    char     szName[48];
+    uint64_t au64Stack[MAX_DEPTH];
+    uint16_t au16StackArg[MAX_DEPTH];
+    int      i32Depth;
+    uint64_t *pu64Dur;      /* span durations in cycles */
+    size_t   szDurNum;
+    size_t   szDurCap;
+    uint32_t u32Events;
+    uint32_t u32Unmatched;  /* END without BEGIN, or BEGIN still open at the end */
+    uint32_t au32Hist[HIST_BINS];
+} ID_T;
+
+static ID_T s_asId[MAX_ID];
+static REC_T *s_psRec;
+static size_t s_szRecNum, s_szRecCap;
+static double s_dCyclesPerUs = 192.0;
+
+static const struct
+{
+    uint32_t u32Id;
+    const char *pcName;
+} s_asBuiltin[] =
+{
+    { TRACE_ID_EMAC_RX,   "EMAC RX ISR" },
+    { TRACE_ID_EMAC_TX,   "EMAC TX ISR" },
+    { TRACE_ID_SDH_READ,  "SDH_Read" },
+    { TRACE_ID_SDH_WRITE, "SDH_Write" },
+    { TRACE_ID_USBH_UTR,  "USBH UTR callback" },
+    { TRACE_ID_CRPT_AES,  "CRPT AES" },
+    { TRACE_ID_CRPT_TDES, "CRPT TDES" },
+    { TRACE_ID_CRPT_SHA,  "CRPT SHA" },
+    { TRACE_ID_CRPT_ECC,  "CRPT ECC" },
+    { TRACE_ID_DISK_READ, "FatFs disk_read" },
+    { TRACE_ID_MAD_FRAME, "mad_frame_decode" },
+};
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: trace_decode [-i] [-c hz] [-p port] [-n names.txt] [-j out.json] capture.bin\n");
+    exit(2);
+}
+
+static void add_rec(uint32_t u32Stamp, uint32_t u32Desc)
+{
+    static uint64_t u64Last;
+
+    if (s_szRecNum == s_szRecCap)
+    {
+        s_szRecCap = s_szRecCap ? s_szRecCap * 2 : 4096;
+        s_psRec = realloc(s_psRec, s_szRecCap * sizeof(REC_T));
+        if (s_psRec == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+
+    /* CYCCNT wraps every 2^32 cycles (about 22 s at 192 MHz); records are in time order */
+    if (s_szRecNum == 0)
+        u64Last = u32Stamp;
+    else
+    {
+        uint64_t u64Time = (u64Last & ~0xFFFFFFFFULL) | u32Stamp;
+        if (u64Time < u64Last)
+            u64Time += 0x100000000ULL;
+        u64Last = u64Time;
+    }
+
+    s_psRec[s_szRecNum].u64Time = u64Last;
+    s_psRec[s_szRecNum].u32Desc = u32Desc;
+    s_szRecNum++;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* g_sTraceBuf dump: magic, entries, core clock, head, records */
+static int parse_ram(const uint8_t *pu8Buf, size_t szLen, uint32_t *pu32Clock)
+{
+    uint32_t u32Entries, u32Head, u32First, u32Num, i, u32Idx;
+
+    if ((szLen < 16) || (get_le32(pu8Buf) != TRACE_MAGIC))
+        return -1;
+
+    u32Entries = get_le32(pu8Buf + 4);
+    *pu32Clock = get_le32(pu8Buf + 8);
+    u32Head = get_le32(pu8Buf + 12);
+
+    if ((u32Entries == 0) || (u32Entries & (u32Entries - 1)) || (16 + (size_t)u32Entries * 8 > szLen))
+    {
+        fprintf(stderr, "dump truncated or corrupted (%u entries, %zu bytes)\n", u32Entries, szLen);
+        return -1;
+    }
+
+    if (u32Head > u32Entries)
+    {
+        u32First = u32Head - u32Entries;
+        u32Num = u32Entries;
+        fprintf(stderr, "ring wrapped, %u oldest records lost\n", u32First);
+    }
+    else
+    {
+        u32First = 0;
+        u32Num = u32Head;
+    }
+
+    for (i = 0; i < u32Num; i++)
+    {
+        u32Idx = (u32First + i) & (u32Entries - 1);
+        add_rec(get_le32(pu8Buf + 16 + u32Idx * 8), get_le32(pu8Buf + 16 + u32Idx * 8 + 4));
+    }
+
+    return 0;
+}
+
+/* Raw ITM stream (ARMv7-M ARM, appendix D4). Only 32-bit stimulus writes to the trace port are used. */
+static void parse_itm(const uint8_t *pu8Buf, size_t szLen, uint32_t u32Port)
+{
+    size_t i = 0, szSize;
+    uint32_t u32Word, au32Pair[2], u32Have = 0, u32Skipped = 0;
+    uint8_t u8Hdr;
+
+    while (i < szLen)
+    {
+        u8Hdr = pu8Buf[i++];
+
+        if (u8Hdr == 0x00 || u8Hdr == 0x80)         /* synchronization */
+            continue;
+        if (u8Hdr == 0x70)                          /* overflow, records were lost */
+        {
+            u32Have = 0;
+            u32Skipped++;
+            continue;
+        }
+        if ((u8Hdr & 0x03) == 0)
+        {
+            /* timestamp, extension and reserved packets: skip continuation bytes */
+            if ((u8Hdr & 0x80) || ((u8Hdr & 0x0F) == 0x04) || (u8Hdr == 0x94) || (u8Hdr == 0xB4))
+            {
+                while ((i < szLen) && (pu8Buf[i++] & 0x80))
+                {
+                }
+            }
+            continue;
+        }
+
+        szSize = ((u8Hdr & 0x03) == 3) ? 4 : (u8Hdr & 0x03);
+        if (i + szSize > szLen)
+            break;
+
+        if (!(u8Hdr & 0x04) && ((uint32_t)(u8Hdr >> 3) == u32Port))
+        {
+            if (szSize != 4)
+            {
+                u32Have = 0;        /* not ours, resync on the next pair */
+                u32Skipped++;
+            }
+            else
+            {
+                u32Word = get_le32(pu8Buf + i);
+                au32Pair[u32Have++] = u32Word;
+                if (u32Have == 2)
+                {
+                    add_rec(au32Pair[0], au32Pair[1]);
+                    u32Have = 0;
+                }
+            }
+        }
+        i += szSize;
+    }
+
+    if (u32Skipped)
+        fprintf(stderr, "%u overflow/unexpected packets, some records may be missing\n", u32Skipped);
+}
+
+static void load_names(const char *pcFile)
+{
+    FILE *fp = fopen(pcFile, "r");
+    char szLine[128], szName[48];
+    unsigned int u32Id;
+
+    if (fp == NULL)
+    {
+        perror(pcFile);
+        exit(1);
+    }
+    while (fgets(szLine, sizeof(szLine), fp))
+    {
+        if ((sscanf(szLine, "%u %47[^\r\n]", &u32Id, szName) == 2) && (u32Id < MAX_ID))
+            snprintf(s_asId[u32Id].szName, sizeof(s_asId[u32Id].szName), "%s", szName);
+    }
+    fclose(fp);
+}
+
+static void add_dur(ID_T *psId, uint64_t u64Cycles)
+{
+    double dUs = (double)u64Cycles / s_dCyclesPerUs;
+    int i32Bin = 0;
+
+    if (psId->szDurNum == psId->szDurCap)
+    {
+        psId->szDurCap = psId->szDurCap ? psId->szDurCap * 2 : 256;
+        psId->pu64Dur = realloc(psId->pu64Dur, psId->szDurCap * sizeof(uint64_t));
+        if (psId->pu64Dur == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    psId->pu64Dur[psId->szDurNum++] = u64Cycles;
+
+    /* bin 0: < 1 us, bin n: [2^(n-1), 2^n) us */
+    while ((dUs >= 1.0) && (i32Bin < HIST_BINS - 1))
+    {
+        dUs /= 2.0;
+        i32Bin++;
+    }
+    psId->au32Hist[i32Bin]++;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void json_event(FILE *fp, int *pi32First, const char *pcFmt, ...)
+{
+    va_list ap;
+
+    if (fp == NULL)
+        return;
+    fputs(*pi32First ? "\n  " : ",\n  ", fp);
+    *pi32First = 0;
+    va_start(ap, pcFmt);
+    vfprintf(fp, pcFmt, ap);
+    va_end(ap);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *pcIn = NULL, *pcJson = NULL, *pcNames = NULL;
+    uint32_t u32Port = TRACE_ITM_PORT, u32Clock = 0, u32DumpClock = 0;
+    int i32Itm = 0, i32First = 1, i;
+    uint8_t *pu8Buf;
+    size_t szLen, n;
+    FILE *fp, *fpJson = NULL;
+    uint64_t u64T0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-i"))
+            i32Itm = 1;
+        else if (!strcmp(argv[i], "-c") && (i + 1 < argc))
+            u32Clock = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-p") && (i + 1 < argc))
+            u32Port = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-n") && (i + 1 < argc))
+            pcNames = argv[++i];
+        else if (!strcmp(argv[i], "-j") && (i + 1 < argc))
+            pcJson = argv[++i];
+        else if ((argv[i][0] != '-') && (pcIn == NULL))
+            pcIn = argv[i];
+        else
+            usage();
+    }
+    if ((pcIn == NULL) || (u32Port > 31))
+        usage();
+
+    for (i = 0; i < MAX_ID; i++)
+        snprintf(s_asId[i].szName, sizeof(s_asId[i].szName), "id %d", i);
+    for (n = 0; n < sizeof(s_asBuiltin) / sizeof(s_asBuiltin[0]); n++)
+        snprintf(s_asId[s_asBuiltin[n].u32Id].szName, sizeof(s_asId[0].szName), "%s", s_asBuiltin[n].pcName);
+    if (pcNames)
+        load_names(pcNames);
+
+    fp = fopen(pcIn, "rb");
+    if (fp == NULL)
+    {
+        perror(pcIn);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    szLen = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    pu8Buf = malloc(szLen ? szLen : 1);
+    if ((pu8Buf == NULL) || (fread(pu8Buf, 1, szLen, fp) != szLen))
+    {
+        fprintf(stderr, "cannot read %s\n", pcIn);
+        return 1;
+    }
+    fclose(fp);
+
+    if (i32Itm)
+        parse_itm(pu8Buf, szLen, u32Port);
+    else if (parse_ram(pu8Buf, szLen, &u32DumpClock) != 0)
+    {
+        fprintf(stderr, "%s: no g_sTraceBuf header found, use -i for ITM streams\n", pcIn);
+        return 1;
+    }
+    free(pu8Buf);
+
+    if (u32Clock == 0)
+        u32Clock = u32DumpClock ? u32DumpClock : 192000000UL;
+    s_dCyclesPerUs = u32Clock / 1e6;
+
+    if (pcJson)
+    {
+        fpJson = fopen(pcJson, "w");
+        if (fpJson == NULL)
+        {
+            perror(pcJson);
+            return 1;
+        }
+        fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", fpJson);
+        for (i = 0; i < MAX_ID; i++)
+            s_asId[i].i32Depth = -1;    /* marks ids seen, for thread names */
+    }
+
+    u64T0 = s_szRecNum ? s_psRec[0].u64Time : 0;
+
+    for (n = 0; n < s_szRecNum; n++)
+    {
+        uint32_t u32Id = s_psRec[n].u32Desc & 0xFF;
+        uint32_t u32Type = (s_psRec[n].u32Desc >> 8) & 0x3;
+        uint16_t u16Arg = (uint16_t)(s_psRec[n].u32Desc >> 16);
+        uint64_t u64Time = s_psRec[n].u64Time;
+        ID_T *psId = &s_asId[u32Id];
+
+        if (psId->i32Depth < 0)
+        {
+            psId->i32Depth = 0;
+            json_event(fpJson, &i32First,
+                       "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                       u32Id, psId->szName);
+        }
+
+        if (u32Type == TRACE_TYPE_BEGIN)
+        {
+            if (psId->i32Depth == MAX_DEPTH)
+            {
+                psId->u32Unmatched++;
+                continue;
+            }
+            psId->au16StackArg[psId->i32Depth] = u16Arg;
+            psId->au64Stack[psId->i32Depth++] = u64Time;
+        }
+        else if (u32Type == TRACE_TYPE_END)
+        {
+            uint64_t u64Begin;
+
+            if (psId->i32Depth == 0)
+            {
+                psId->u32Unmatched++;
+                continue;
+            }
+            psId->i32Depth--;
+            u64Begin = psId->au64Stack[psId->i32Depth];
+            add_dur(psId, u64Time - u64Begin);
+            json_event(fpJson, &i32First,
+                       "{\"ph\":\"X\",\"name\":\"%s\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                       "\"args\":{\"begin\":%u,\"end\":%u}}",
+                       psId->szName, u32Id, (u64Begin - u64T0) / s_dCyclesPerUs,
+                       (u64Time - u64Begin) / s_dCyclesPerUs, psId->au16StackArg[psId->i32Depth], u16Arg);
+        }
+        else
+        {
+            psId->u32Events++;
+            json_event(fpJson, &i32First,
+                       "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"%s\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"arg\":%u}}",
+                       psId->szName, u32Id, (u64Time - u64T0) / s_dCyclesPerUs, u16Arg);
+        }
+    }
+
+    if (fpJson)
+    {
+        fputs("\n]}\n", fpJson);
+        fclose(fpJson);
+    }
+
+    printf("%zu records, %.3f ms, CPU clock %u Hz\n\n", s_szRecNum,
+           s_szRecNum ? (s_psRec[s_szRecNum - 1].u64Time - u64T0) / s_dCyclesPerUs / 1000.0 : 0.0, u32Clock);
+    printf("%-4s %-20s %8s %8s %10s %10s %10s %10s %10s %6s\n",
+           "id", "name", "spans", "events", "min us", "avg us", "p50 us", "p99 us", "max us", "unm");
+
+    for (i = 0; i < MAX_ID; i++)
+    {
+        ID_T *psId = &s_asId[i];
+        uint64_t u64Sum = 0;
+        size_t k;
+        int b, i32Last;
+
+        if (psId->i32Depth > 0)
+            psId->u32Unmatched += (uint32_t)psId->i32Depth;
+        if ((psId->szDurNum == 0) && (psId->u32Events == 0) && (psId->u32Unmatched == 0))
+            continue;
+
+        if (psId->szDurNum == 0)
+        {
+            printf("%-4d %-20.20s %8u %8u %10s %10s %10s %10s %10s %6u\n", i, psId->szName, 0, psId->u32Events,
+                   "-", "-", "-", "-", "-", psId->u32Unmatched);
+            continue;
+        }
+
+        qsort(psId->pu64Dur, psId->szDurNum, sizeof(uint64_t), cmp_u64);
+        for (k = 0; k < psId->szDurNum; k++)
+            u64Sum += psId->pu64Dur[k];
+
+        printf("%-4d %-20.20s %8zu %8u %10.2f %10.2f %10.2f %10.2f %10.2f %6u\n", i, psId->szName,
+               psId->szDurNum, psId->u32Events,
+               psId->pu64Dur[0] / s_dCyclesPerUs,
+               (double)u64Sum / psId->szDurNum / s_dCyclesPerUs,
+               psId->pu64Dur[psId->szDurNum / 2] / s_dCyclesPerUs,
+               psId->pu64Dur[(psId->szDurNum * 99) / 100] / s_dCyclesPerUs,
+               psId->pu64Dur[psId->szDurNum - 1] / s_dCyclesPerUs,
+               psId->u32Unmatched);
+
+        for (i32Last = HIST_BINS - 1; (i32Last > 0) && (psId->au32Hist[i32Last] == 0); i32Last--)
+        {
+        }
+        for (b = 0; b <= i32Last; b++)
+        {
+            uint32_t u32Bar = (uint32_t)((uint64_t)psId->au32Hist[b] * 50 / psId->szDurNum);
+
+            if (b == 0)
+                printf("     %10s < %-8u", "", 1u);
+            else
+                printf("     %10u - %-8u", 1u << (b - 1), 1u << b);
+            printf("%8u ", psId->au32Hist[b]);
+            while (u32Bar--)
+                putchar('#');
+            putchar('\n');
+        }
+        putchar('\n');
+    }
+
+    return 0;
+}
+
+/*** (C) COPYRIGHT 2018 Nuvoton Technology Corp. ***/
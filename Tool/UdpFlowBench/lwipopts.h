@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2018 Nuvoton Technology Corp.
+ * Description:   lwIP options for the UdpFlowBench host build
+ *
+ * Raw API only (NO_SYS), one Ethernet interface on a model of the M480 EMAC TX ring.
+ */
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+#define NO_SYS                          1
+#define SYS_LIGHTWEIGHT_PROT            0
+
+#define MEM_ALIGNMENT                   8
+#define MEM_SIZE                        (64 * 1024)
+#define MEMP_NUM_PBUF                   32
+#define MEMP_NUM_UDP_PCB                4
+#define PBUF_POOL_SIZE                  16
+
+#define LWIP_IPV4                       1
+#define LWIP_IPV6                       0
+#define LWIP_ARP                        1
+#define LWIP_ETHERNET                   1
+#define ETHARP_SUPPORT_STATIC_ENTRIES   1
+#define LWIP_ICMP                       1
+#define LWIP_UDP                        1
+#define LWIP_TCP                        0
+#define LWIP_DHCP                       0
+#define LWIP_DNS                        0
+#define LWIP_IGMP                       0
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
+
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+
+#define LWIP_STATS                      0
+
+#endif /* __LWIPOPTS_H__ */
@@ -0,0 +1,461 @@
+/**************************************************************************//**
+ * @file     udpflowbench.c
+ * @version  V1.00
+ * @brief    Host test and packet rate benchmark of the UDP flow transmit path (lwIP/udp_flow.c)
+ *           against udp_send().
+ *
+ * lwIP runs on the host with the raw API, one Ethernet interface and the M480 port's
+ * udp_flow.c. The interface's linkoutput is a model of the M480 EMAC TX path in
+ * lwIP/netif/ethernetif.c and m480_eth.c. It has a ring of 4 descriptors. A flow frame
+ * (PBUF_FLAG_UDP_FLOW) of at least 60 bytes is sent in place, and the ring holds a reference to it
+ * until the descriptor comes round again. Any other frame is copied into the descriptor buffer and
+ * padded to 60 bytes.
+ *
+ * The current path sends ADC frames with udp_send() and a PBUF_REF payload, so the driver copies
+ * every byte. The flow path finds the payload already in its frame buffer, as if PDMA had filled
+ * it. Both paths write a sequence number into the first 4 payload bytes of each packet.
+ *
+ * Before each timed run, every frame of a shorter run is checked: MAC addresses, IP header and
+ * checksum, UDP ports, length and checksum (or 0 with UDP_FLAGS_NOCHKSUM), sequence and payload.
+ * The flow must also resolve its next hop (ARP request, then the cache), use the gateway for an
+ * off-link peer and the mapped MAC for a multicast group. It must refuse to reconnect while the
+ * driver holds frame buffers, and get every buffer back.
+ *
+ * Build:  L=../../ThirdParty/lwIP/src; P=../../SampleCode/NuMaker-PFM-M487/lwIP
+ *         cc -O2 -I. -I../SockBench -I$P/include -I$L/include -o udpflowbench udpflowbench.c
+ *             $P/udp_flow.c $L/core/[a-z]*.c $L/core/ipv4/[a-z]*.c $L/netif/ethernet.c
+ *
+ * Usage:  udpflowbench [packets per run]
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/udp.h"
+#include "lwip/etharp.h"
+#include "lwip/timeouts.h"
+#include "netif/ethernet.h"
+#include "lwip/udp_flow.h"
+
+#define EMAC_DESC_NUM       4       /* TX_DESCRIPTOR_NUM in m480_eth.h */
+#define EMAC_BUF_SIZE       1520
+#define FLOW_SLOTS          8
+#define FLOW_BUF_SIZE       1516
+#define LOCAL_PORT          5000
+#define PEER_PORT           6000
+#define VERIFY_PKTS         2000
+
+typedef struct
+{
+    const char *pcName;
+    int iFlow;
+    int iNoChksum;
+    uint16_t u16Len;
+} RUN_T;
+
+static const RUN_T s_asRun[] =
+{
+    { "udp_send       1024 B",              0, 0, 1024 },
+    { "udp_flow_send  1024 B",              1, 0, 1024 },
+    { "udp_send       1024 B, no checksum", 0, 1, 1024 },
+    { "udp_flow_send  1024 B, no checksum", 1, 1, 1024 },
+    { "udp_send        128 B",              0, 0, 128 },
+    { "udp_flow_send   128 B",              1, 0, 128 },
+};
+
+static const uint8_t s_au8OwnMac[6] = { 0x00, 0x00, 0x00, 0x59, 0x16, 0x88 };
+static const uint8_t s_au8PeerMac[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+static const uint8_t s_au8GwMac[6] = { 0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE };
+
+static struct netif s_sNetif;
+static uint32_t s_u32Fails;
+
+/* EMAC TX ring model */
+static uint8_t s_au8TxBuf[EMAC_DESC_NUM][EMAC_BUF_SIZE];
+static struct pbuf *s_apsTxPbuf[EMAC_DESC_NUM];
+static uint16_t s_au16TxLen[EMAC_DESC_NUM];
+static uint8_t s_au8TxBusy[EMAC_DESC_NUM];
+static uint32_t s_u32TxCur;
+static uint64_t s_u64CopyBytes;
+
+/* Frame checks */
+static int s_iVerify;
+static uint8_t s_au8ExpMac[6];
+static ip4_addr_t s_sExpDst;
+static uint16_t s_u16ExpLen;
+static int s_iExpChksum;
+static uint32_t s_u32ExpSeq;
+static uint32_t s_u32Frames;
+static uint32_t s_u32ArpFrames;
+static uint32_t s_u32BadFrames;
+
+static uint8_t s_au8Adc[1500] __attribute__((aligned(4)));
+static uint8_t s_au8FlowBuf[FLOW_SLOTS * FLOW_BUF_SIZE] __attribute__((aligned(4)));
+static struct udp_flow_slot s_asFlowSlot[FLOW_SLOTS];
+static struct udp_flow s_sFlow;
+
+u32_t sys_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static uint64_t WallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+static uint8_t PayloadByte(uint32_t i)
+{
+    return (uint8_t)(i * 13 + 5);
+}
+
+/* Reference one's complement sum over big endian words */
+static uint32_t Sum16(const uint8_t *pu8, uint32_t u32Len, uint32_t u32Sum)
+{
+    uint32_t i;
+
+    for(i = 0; i + 1 < u32Len; i += 2)
+        u32Sum += ((uint32_t)pu8[i] << 8) | pu8[i + 1];
+    if(u32Len & 1)
+        u32Sum += (uint32_t)pu8[u32Len - 1] << 8;
+    return u32Sum;
+}
+
+static uint16_t Fold(uint32_t u32Sum)
+{
+    while(u32Sum >> 16)
+        u32Sum = (u32Sum & 0xFFFF) + (u32Sum >> 16);
+    return (uint16_t)u32Sum;
+}
+
+static void VerifyFrame(const uint8_t *pu8, uint32_t u32Len)
+{
+    const uint8_t *pu8Ip = pu8 + 14, *pu8Udp = pu8 + 34, *pu8Data = pu8 + 42;
+    uint32_t u32Sum, u32Seq, i;
+    int iBad = 0;
+
+    if(pu8[12] == 0x08 && pu8[13] == 0x06)
+    {
+        s_u32ArpFrames++;
+        return;
+    }
+    s_u32Frames++;
+
+    iBad |= memcmp(pu8, s_au8ExpMac, 6) != 0 || memcmp(pu8 + 6, s_au8OwnMac, 6) != 0;
+    iBad |= pu8[12] != 0x08 || pu8[13] != 0x00;
+    iBad |= u32Len != (42u + s_u16ExpLen < 60 ? 60 : 42u + s_u16ExpLen);
+    for(i = 42u + s_u16ExpLen; i < u32Len; i++)
+        iBad |= pu8[i] != 0;
+    u32Len = 42u + s_u16ExpLen;
+    iBad |= pu8Ip[0] != 0x45 || pu8Ip[9] != 17 || Fold(Sum16(pu8Ip, 20, 0)) != 0xFFFF;
+    iBad |= (((uint32_t)pu8Ip[2] << 8) | pu8Ip[3]) != u32Len - 14;
+    iBad |= memcmp(pu8Ip + 12, netif_ip4_addr(&s_sNetif), 4) != 0 || memcmp(pu8Ip + 16, &s_sExpDst, 4) != 0;
+    iBad |= (((uint32_t)pu8Udp[0] << 8) | pu8Udp[1]) != LOCAL_PORT || (((uint32_t)pu8Udp[2] << 8) | pu8Udp[3]) != PEER_PORT;
+    iBad |= (((uint32_t)pu8Udp[4] << 8) | pu8Udp[5]) != u32Len - 34;
+    if(s_iExpChksum)
+    {
+        u32Sum = Sum16(pu8Ip + 12, 8, 17 + (u32Len - 34));
+        iBad |= pu8Udp[6] == 0 && pu8Udp[7] == 0;
+        iBad |= Fold(Sum16(pu8Udp, u32Len - 34, u32Sum)) != 0xFFFF;
+    }
+    else
+    {
+        iBad |= pu8Udp[6] != 0 || pu8Udp[7] != 0;
+    }
+    u32Seq = pu8Data[0] | ((uint32_t)pu8Data[1] << 8) | ((uint32_t)pu8Data[2] << 16) | ((uint32_t)pu8Data[3] << 24);
+    iBad |= u32Seq != s_u32ExpSeq++;
+    for(i = 4; i < s_u16ExpLen; i++)
+        iBad |= pu8Data[i] != PayloadByte(i);
+    if(iBad)
+        s_u32BadFrames++;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* EMAC TX model, as low_level_output() in ethernetif.c and ETH_trigger_tx() in m480_eth.c                 */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* The frame in descriptor i has gone out; the TX interrupt releases a pbuf sent in place */
+static void EmacComplete(uint32_t i)
+{
+    if(s_iVerify)
+        VerifyFrame(s_apsTxPbuf[i] ? (const uint8_t *)s_apsTxPbuf[i]->payload : s_au8TxBuf[i], s_au16TxLen[i]);
+    else
+        s_u32Frames++;
+    if(s_apsTxPbuf[i] != NULL)
+    {
+        pbuf_free(s_apsTxPbuf[i]);
+        s_apsTxPbuf[i] = NULL;
+    }
+    s_au8TxBusy[i] = 0;
+}
+
+static void EmacDrain(void)
+{
+    uint32_t i, j;
+
+    for(i = 0; i < EMAC_DESC_NUM; i++)
+    {
+        j = (s_u32TxCur + i) % EMAC_DESC_NUM;
+        if(s_au8TxBusy[j])
+            EmacComplete(j);
+    }
+}
+
+static err_t EmacOutput(struct netif *psNetif, struct pbuf *p)
+{
+    uint32_t i = s_u32TxCur;
+    struct pbuf *q;
+    uint16_t u16Len = 0;
+
+    (void)psNetif;
+    /* The EMAC has sent what this descriptor held by the time the ring comes round */
+    if(s_au8TxBusy[i])
+        EmacComplete(i);
+
+    if((p->flags & PBUF_FLAG_UDP_FLOW) && (p->next == NULL) && (p->len >= 60) && (((mem_ptr_t)p->payload & 3) == 0))
+    {
+        pbuf_ref(p);
+        s_apsTxPbuf[i] = p;
+        u16Len = p->len;
+    }
+    else
+    {
+        for(q = p; q != NULL; q = q->next)
+        {
+            memcpy(&s_au8TxBuf[i][u16Len], q->payload, q->len);
+            u16Len += q->len;
+        }
+        s_u64CopyBytes += u16Len;
+        if(u16Len < 60)
+        {
+            memset(&s_au8TxBuf[i][u16Len], 0, 60 - u16Len);
+            u16Len = 60;
+        }
+    }
+    s_au16TxLen[i] = u16Len;
+    s_au8TxBusy[i] = 1;
+    s_u32TxCur = (i + 1) % EMAC_DESC_NUM;
+    return ERR_OK;
+}
+
+static err_t EmacInit(struct netif *psNetif)
+{
+    psNetif->name[0] = 'e';
+    psNetif->name[1] = 'n';
+    psNetif->hwaddr_len = ETH_HWADDR_LEN;
+    memcpy(psNetif->hwaddr, s_au8OwnMac, 6);
+    psNetif->mtu = 1500;
+    psNetif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+    psNetif->output = etharp_output;
+    psNetif->linkoutput = EmacOutput;
+    return ERR_OK;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Runs                                                                                                    */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void PutSeq(uint8_t *pu8, uint32_t u32Seq)
+{
+    pu8[0] = (uint8_t)u32Seq;
+    pu8[1] = (uint8_t)(u32Seq >> 8);
+    pu8[2] = (uint8_t)(u32Seq >> 16);
+    pu8[3] = (uint8_t)(u32Seq >> 24);
+}
+
+static void Expect(const uint8_t *pu8Mac, const ip4_addr_t *psDst, uint16_t u16Len, int iChksum)
+{
+    memcpy(s_au8ExpMac, pu8Mac, 6);
+    s_sExpDst = *psDst;
+    s_u16ExpLen = u16Len;
+    s_iExpChksum = iChksum;
+    s_u32ExpSeq = 0;
+    s_u32Frames = s_u32BadFrames = s_u32ArpFrames = 0;
+}
+
+/* Sends u32Pkts packets; returns the wall time in ns */
+static uint64_t Send(struct udp_pcb *psPcb, int iFlow, uint16_t u16Len, uint32_t u32Pkts)
+{
+    struct pbuf *p;
+    uint64_t u64T0;
+    uint32_t k;
+    uint8_t *pu8;
+
+    u64T0 = WallNs();
+    for(k = 0; k < u32Pkts; k++)
+    {
+        if(iFlow)
+        {
+            pu8 = udp_flow_get_buf(&s_sFlow);
+            if(pu8 == NULL)
+            {
+                Check(0, "no free flow buffer");
+                break;
+            }
+            PutSeq(pu8, k);
+            if(udp_flow_send(&s_sFlow, u16Len) != ERR_OK)
+            {
+                Check(0, "udp_flow_send");
+                break;
+            }
+        }
+        else
+        {
+            PutSeq(s_au8Adc, k);
+            p = pbuf_alloc(PBUF_TRANSPORT, u16Len, PBUF_REF);
+            if(p == NULL)
+            {
+                Check(0, "pbuf_alloc");
+                break;
+            }
+            p->payload = s_au8Adc;
+            if(udp_send(psPcb, p) != ERR_OK)
+                Check(0, "udp_send");
+            pbuf_free(p);
+        }
+    }
+    EmacDrain();
+    return WallNs() - u64T0;
+}
+
+static void Run(struct udp_pcb *psPcb, const ip4_addr_t *psPeer, const RUN_T *psRun, uint32_t u32Pkts)
+{
+    uint64_t u64Ns, u64Copy;
+    uint32_t i;
+
+    udp_setflags(psPcb, psRun->iNoChksum ? UDP_FLAGS_NOCHKSUM : 0);
+    udp_connect(psPcb, (const ip_addr_t *)psPeer, PEER_PORT);
+    Check(udp_flow_connect(&s_sFlow, psPcb) == ERR_OK, "udp_flow_connect");
+    for(i = 0; i < FLOW_SLOTS; i++)
+        memcpy(UDP_FLOW_PAYLOAD(&s_sFlow, i), s_au8Adc, psRun->u16Len);
+
+    s_iVerify = 1;
+    Expect(s_au8PeerMac, psPeer, psRun->u16Len, !psRun->iNoChksum);
+    Send(psPcb, psRun->iFlow, psRun->u16Len, VERIFY_PKTS);
+    Check(s_u32Frames == VERIFY_PKTS && s_u32BadFrames == 0, psRun->pcName);
+
+    s_iVerify = 0;
+    s_u32Frames = 0;
+    u64Copy = s_u64CopyBytes;
+    u64Ns = Send(psPcb, psRun->iFlow, psRun->u16Len, u32Pkts);
+    Check(s_u32Frames == u32Pkts, "frames lost");
+    printf("%-36s %9.0f pkt/s, %6.1f bytes copied/pkt\n", psRun->pcName, u32Pkts * 1e9 / (double)u64Ns,
+           (double)(s_u64CopyBytes - u64Copy) / u32Pkts);
+}
+
+/* Next hop resolution, gateway, multicast, reconnect and buffer ownership */
+static void FunctionTest(struct udp_pcb *psPcb)
+{
+    static const uint8_t au8McMac[6] = { 0x01, 0x00, 0x5E, 0x01, 0x02, 0x03 };
+    ip4_addr_t sPeer, sGw, sFar, sGroup;
+    uint8_t *pu8;
+
+    IP4_ADDR(&sPeer, 192, 168, 1, 100);
+    IP4_ADDR(&sGw, 192, 168, 1, 1);
+    IP4_ADDR(&sFar, 10, 0, 0, 5);
+    IP4_ADDR(&sGroup, 239, 1, 2, 3);
+    s_iVerify = 1;
+    EmacDrain();    /* Gratuitous ARP of netif_set_up() */
+
+    Check(udp_flow_connect(&s_sFlow, psPcb) == ERR_ARG, "connect needs a connected pcb");
+    udp_connect(psPcb, (const ip_addr_t *)&sPeer, PEER_PORT);
+    Check(udp_flow_send(&s_sFlow, 16) == ERR_CONN, "send before connect");
+
+    /* Not in the ARP cache yet: a request goes out */
+    Expect(s_au8PeerMac, &sPeer, 16, 1);
+    Check(udp_flow_connect(&s_sFlow, psPcb) == ERR_INPROGRESS, "connect while resolving");
+    EmacDrain();
+    Check(s_u32ArpFrames == 1, "ARP request for the peer");
+    etharp_add_static_entry(&sPeer, (struct eth_addr *)s_au8PeerMac);
+    etharp_add_static_entry(&sGw, (struct eth_addr *)s_au8GwMac);
+    Check(udp_flow_connect(&s_sFlow, psPcb) == ERR_OK, "connect after resolution");
+    Check(udp_flow_send(&s_sFlow, 1473) == ERR_VAL, "payload above the MTU");
+
+    /* The EMAC model keeps the buffer until the ring comes round */
+    pu8 = udp_flow_get_buf(&s_sFlow);
+    PutSeq(pu8, 0);
+    memcpy(pu8 + 4, s_au8Adc + 4, 12);
+    udp_flow_send(&s_sFlow, 16);
+    Check(udp_flow_free_bufs(&s_sFlow) == FLOW_SLOTS - 1, "driver holds the frame buffer");
+    Check(udp_flow_connect(&s_sFlow, psPcb) == ERR_USE, "reconnect while frames are out");
+    EmacDrain();
+    Check(udp_flow_free_bufs(&s_sFlow) == FLOW_SLOTS, "frame buffer back after TX");
+    Check(s_u32Frames == 1 && s_u32BadFrames == 0, "first flow frame");
+
+    /* Off-link peer through the gateway */
+    udp_connect(psPcb, (const ip_addr_t *)&sFar, PEER_PORT);
+    Check(udp_flow_connect(&s_sFlow, psPcb) == ERR_OK, "connect off-link");
+    Expect(s_au8GwMac, &sFar, 16, 1);
+    pu8 = udp_flow_get_buf(&s_sFlow);
+    PutSeq(pu8, 0);
+    memcpy(pu8 + 4, s_au8Adc + 4, 12);
+    udp_flow_send(&s_sFlow, 16);
+    EmacDrain();
+    Check(s_u32Frames == 1 && s_u32BadFrames == 0, "off-link frame to the gateway");
+
+    /* Multicast group */
+    udp_connect(psPcb, (const ip_addr_t *)&sGroup, PEER_PORT);
+    Check(udp_flow_connect(&s_sFlow, psPcb) == ERR_OK, "connect multicast");
+    Expect(au8McMac, &sGroup, 16, 1);
+    pu8 = udp_flow_get_buf(&s_sFlow);
+    PutSeq(pu8, 0);
+    memcpy(pu8 + 4, s_au8Adc + 4, 12);
+    udp_flow_send(&s_sFlow, 16);
+    EmacDrain();
+    Check(s_u32Frames == 1 && s_u32BadFrames == 0, "multicast frame");
+}
+
+int main(int argc, char **argv)
+{
+    ip4_addr_t sIp, sMask, sGw, sPeer;
+    struct udp_pcb *psPcb;
+    uint32_t u32Pkts = 500000, i;
+
+    if(argc > 1)
+        u32Pkts = (uint32_t)strtoul(argv[1], NULL, 0);
+    if(u32Pkts == 0)
+        u32Pkts = 1;
+    for(i = 0; i < sizeof(s_au8Adc); i++)
+        s_au8Adc[i] = PayloadByte(i);
+
+    lwip_init();
+    IP4_ADDR(&sIp, 192, 168, 1, 2);
+    IP4_ADDR(&sMask, 255, 255, 255, 0);
+    IP4_ADDR(&sGw, 192, 168, 1, 1);
+    IP4_ADDR(&sPeer, 192, 168, 1, 100);
+    netif_add(&s_sNetif, &sIp, &sMask, &sGw, NULL, EmacInit, ethernet_input);
+    netif_set_default(&s_sNetif);
+    netif_set_up(&s_sNetif);
+
+    udp_flow_init(&s_sFlow, s_asFlowSlot, s_au8FlowBuf, FLOW_BUF_SIZE, FLOW_SLOTS);
+    psPcb = udp_new();
+    udp_bind(psPcb, IP4_ADDR_ANY, LOCAL_PORT);
+
+    FunctionTest(psPcb);
+    for(i = 0; i < sizeof(s_asRun) / sizeof(s_asRun[0]); i++)
+        Run(psPcb, &sPeer, &s_asRun[i], u32Pkts);
+    Check(udp_flow_free_bufs(&s_sFlow) == FLOW_SLOTS, "flow buffers back");
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ * @version  V1.00
+ * @brief    Host stand-in for the M480 device header, used by UipBench
+ *
+ * Only the EMAC driver functions uip-0.9/uip/emacdev.c and the uIP samples
+ * call. uipbench.c implements them on a model of the EMAC descriptor rings.
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EMAC_RX_DESC_SIZE 4UL    /* As Library/StdDriver/inc/emac.h */
+#define EMAC_TX_DESC_SIZE 4UL
+#define EMAC_FRAME_SIZE   1520UL
+
+uint32_t EMAC_RecvPkt(uint8_t *pu8Data, uint32_t *pu32Size);
+void EMAC_RecvPktDone(void);
+uint8_t *EMAC_RecvPktSwap(uint8_t *pu8Buf, uint32_t *pu32Size);
+uint32_t EMAC_SendPkt(uint8_t *pu8Data, uint32_t u32Size);
+uint8_t *EMAC_SendPktSwap(uint8_t *pu8Data, uint32_t u32Size);
+
+#endif /* __NUMICRO_H__ */
@@ -0,0 +1,536 @@
+/**************************************************************************//**
+ * @file     uipbench.c
+ * @version  V1.00
+ * @brief    HTTP request rate benchmark of the uIP EMAC device layer (uip-0.9/uip/emacdev.c)
+ *           against the copying driver loop of the EMAC_uIP_httpd sample, on a Linux TAP device.
+ *
+ * uIP and the EMAC_uIP_httpd sample's web server run on tap0 (uip-0.9/unix/tapdev.c) behind a
+ * model of the M480 EMAC descriptor rings, 4 Rx and 4 Tx descriptors of EMAC_FRAME_SIZE bytes.
+ * The model's "DMA" moves frames between tap0 and the descriptor buffers; the copies the CPU
+ * makes are counted. A Tx descriptor completes as soon as its frame is written to tap0.
+ *
+ * copy: the sample's previous loop. The Rx interrupt handler copies each frame out of its
+ *       descriptor (EMAC_RecvPkt) into a static buffer, uip_read() copies that into uip_buf and
+ *       processes one frame per pass. uip_write() gathers headers and application data into a
+ *       static buffer and EMAC_SendPkt copies it into the descriptor. The handler would overwrite
+ *       a frame not read yet; on the board the busy waiting uip_read() takes it first, so the
+ *       model delivers one frame per pass.
+ * swap: emacdev_poll() exchanges uip_buf with the Rx descriptor buffers (EMAC_RecvPktSwap) for up
+ *       to EMACDEV_BATCH frames per pass, and replies go out by exchange with a Tx descriptor
+ *       (EMAC_SendPktSwap). Only file data httpd sends from its ROM file system is copied.
+ *
+ * Linux client threads request /index.html and /img/bg.png over HTTP/1.0, one connection per
+ * request, and compare every response with the file in the sample's fsdata.c.
+ *
+ * Build:  U=../../ThirdParty/uip-0.9; S=../../SampleCode/StdDriver/EMAC_uIP_httpd
+ *         cc -O2 -I. -I$S -I$U/uip -I$U/unix -o uipbench uipbench.c $U/unix/tapdev.c
+ *             $U/uip/uip.c $U/uip/uip_arp.c $U/uip/emacdev.c $S/httpd.c $S/fs.c $S/cgi.c
+ *             $S/memb.c $S/uip_arch.c -lpthread
+ *
+ * Usage:  uipbench [requests per client] [clients]    (root, needs /dev/net/tun and ifconfig)
+ *
+ * @copyright (C) 2018 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "NuMicro.h"
+#include "uip.h"
+#include "uip_arp.h"
+#include "emacdev.h"
+#include "tapdev.h"
+#include "fs.h"
+
+#define BUF ((struct uip_eth_hdr *)&uip_buf[0])
+
+#define HTTP_PORT           80
+#define PERIODIC_NS         500000000ULL
+#define MAX_CLIENTS         16
+#define MAX_RESP            4096
+
+static const char *s_apcPath[] = { "/index.html", "/img/bg.png" };
+
+static struct uip_eth_addr s_sEthAddr = {{0x00, 0x00, 0x00, 0x59, 0x16, 0x88}};
+
+static uint32_t s_u32Fails;
+
+/* EMAC descriptor ring model */
+typedef struct
+{
+    uint8_t *pu8Buf;
+    uint32_t u32Len;
+    int iOwnEmac;
+} DESC_T;
+
+static uint32_t s_au32RxFrame[EMAC_RX_DESC_SIZE][EMAC_FRAME_SIZE / 4];
+static uint32_t s_au32TxFrame[EMAC_TX_DESC_SIZE][EMAC_FRAME_SIZE / 4];
+static DESC_T s_asRxDesc[EMAC_RX_DESC_SIZE];
+static DESC_T s_asTxDesc[EMAC_TX_DESC_SIZE];
+static uint32_t s_u32RxCur, s_u32RxDma, s_u32TxNext;
+static uint64_t s_u64CpuCopy;       /* Bytes copied by the CPU in the driver and the main loop */
+static uint32_t s_u32RxFrames;
+
+/* Previous EMAC_uIP_httpd driver loop */
+static int s_iCopyMode;
+static uint8_t s_au8RxBuf[1514];
+static uint8_t s_au8TxBuf[1514];
+static uint32_t s_u32PktLen;
+static uint32_t s_au32UipBuf[EMAC_FRAME_SIZE / 4];
+
+/* Device loop */
+static volatile int s_iStop;
+static uint64_t s_u64NextPeriodic;
+static uint8_t s_u8ArpTimer;
+static uint32_t s_u32Passes, s_u32BusyPasses;
+
+/* Clients */
+typedef struct
+{
+    pthread_t sThread;
+    const char *pcPath;
+    uint32_t u32Reqs;
+    uint32_t u32Ok;
+    uint32_t u32Bad;
+} CLIENT_T;
+
+static CLIENT_T s_asClient[MAX_CLIENTS];
+static struct fs_file s_asExp[2];
+
+static uint64_t WallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Check(int iOk, const char *pcWhat)
+{
+    if(!iOk)
+    {
+        printf("FAIL %s\n", pcWhat);
+        s_u32Fails++;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * EMAC model
+ * ------------------------------------------------------------------------- */
+static void EmacReset(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < EMAC_RX_DESC_SIZE; i++)
+    {
+        s_asRxDesc[i].pu8Buf = (uint8_t *)s_au32RxFrame[i];
+        s_asRxDesc[i].iOwnEmac = 1;
+    }
+    for(i = 0; i < EMAC_TX_DESC_SIZE; i++)
+    {
+        s_asTxDesc[i].pu8Buf = (uint8_t *)s_au32TxFrame[i];
+        s_asTxDesc[i].iOwnEmac = 0;
+    }
+    s_u32RxCur = s_u32RxDma = s_u32TxNext = 0;
+}
+
+static void LegacyRxIrq(void);
+
+/* Receive DMA: fills the Rx descriptors EMAC owns with the frames waiting on tap0, waiting at
+   most u32Usec for the first one. In copy mode it delivers one frame and runs the Rx interrupt. */
+static void EmacRxDma(uint32_t u32Usec)
+{
+    DESC_T *psDesc;
+    unsigned int uLen;
+
+    for(;;)
+    {
+        psDesc = &s_asRxDesc[s_u32RxDma];
+        if(!psDesc->iOwnEmac)
+            break;
+        uLen = tapdev_recv(psDesc->pu8Buf, EMAC_FRAME_SIZE, u32Usec);
+        if(uLen == 0)
+            break;
+        u32Usec = 0;
+        psDesc->u32Len = uLen;
+        psDesc->iOwnEmac = 0;
+        s_u32RxDma = (s_u32RxDma + 1) % EMAC_RX_DESC_SIZE;
+        s_u32RxFrames++;
+        if(s_iCopyMode)
+        {
+            LegacyRxIrq();
+            break;
+        }
+    }
+}
+
+uint32_t EMAC_RecvPkt(uint8_t *pu8Data, uint32_t *pu32Size)
+{
+    DESC_T *psDesc = &s_asRxDesc[s_u32RxCur];
+
+    if(psDesc->iOwnEmac)
+        return 0;
+    *pu32Size = psDesc->u32Len;
+    memcpy(pu8Data, psDesc->pu8Buf, psDesc->u32Len);
+    s_u64CpuCopy += psDesc->u32Len;
+    return 1;
+}
+
+void EMAC_RecvPktDone(void)
+{
+    s_asRxDesc[s_u32RxCur].iOwnEmac = 1;
+    s_u32RxCur = (s_u32RxCur + 1) % EMAC_RX_DESC_SIZE;
+}
+
+uint8_t *EMAC_RecvPktSwap(uint8_t *pu8Buf, uint32_t *pu32Size)
+{
+    DESC_T *psDesc = &s_asRxDesc[s_u32RxCur];
+    uint8_t *pu8Pkt;
+
+    if(psDesc->iOwnEmac)
+        return NULL;
+
+    pu8Pkt = psDesc->pu8Buf;
+    *pu32Size = psDesc->u32Len;
+    psDesc->pu8Buf = pu8Buf;
+    psDesc->iOwnEmac = 1;
+    s_u32RxCur = (s_u32RxCur + 1) % EMAC_RX_DESC_SIZE;
+    return pu8Pkt;
+}
+
+uint32_t EMAC_SendPkt(uint8_t *pu8Data, uint32_t u32Size)
+{
+    DESC_T *psDesc = &s_asTxDesc[s_u32TxNext];
+
+    if(psDesc->iOwnEmac)
+        return 0;
+    memcpy(psDesc->pu8Buf, pu8Data, u32Size);
+    s_u64CpuCopy += u32Size;
+    tapdev_xmit(psDesc->pu8Buf, u32Size);
+    s_u32TxNext = (s_u32TxNext + 1) % EMAC_TX_DESC_SIZE;
+    return 1;
+}
+
+uint8_t *EMAC_SendPktSwap(uint8_t *pu8Data, uint32_t u32Size)
+{
+    DESC_T *psDesc = &s_asTxDesc[s_u32TxNext];
+    uint8_t *pu8Free;
+
+    if(psDesc->iOwnEmac)
+        return NULL;
+    pu8Free = psDesc->pu8Buf;
+    psDesc->pu8Buf = pu8Data;
+    tapdev_xmit(pu8Data, u32Size);
+    s_u32TxNext = (s_u32TxNext + 1) % EMAC_TX_DESC_SIZE;
+    return pu8Free;
+}
+
+/* ---------------------------------------------------------------------------
+ * Previous EMAC_uIP_httpd main loop (copy mode)
+ * ------------------------------------------------------------------------- */
+static void LegacyRxIrq(void)
+{
+    uint32_t u32Len;
+
+    while(1)
+    {
+        if(EMAC_RecvPkt(s_au8RxBuf, &u32Len) == 0)
+            break;
+        s_u32PktLen = u32Len;
+        EMAC_RecvPktDone();
+    }
+}
+
+static uint32_t PeriodicWaitUs(void)
+{
+    uint64_t u64Now = WallNs();
+
+    if(u64Now >= s_u64NextPeriodic)
+        return 0;
+    return (uint32_t)((s_u64NextPeriodic - u64Now) / 1000) + 1;
+}
+
+static uint32_t LegacyRead(void)
+{
+    uint32_t u32Len = 0, u32Us;
+
+    while((s_u32PktLen == 0) && ((u32Us = PeriodicWaitUs()) != 0) && !s_iStop)
+        EmacRxDma(u32Us);
+    if(s_u32PktLen != 0)
+    {
+        memcpy(uip_buf, s_au8RxBuf, s_u32PktLen);
+        s_u64CpuCopy += s_u32PktLen;
+        u32Len = s_u32PktLen;
+        s_u32PktLen = 0;
+    }
+    return u32Len;
+}
+
+static void LegacyWrite(void)
+{
+    memcpy(s_au8TxBuf, uip_buf, 40 + UIP_LLH_LEN);
+    s_u64CpuCopy += 40 + UIP_LLH_LEN;
+    if(uip_len > (40 + UIP_LLH_LEN))
+    {
+        memcpy(&s_au8TxBuf[40 + UIP_LLH_LEN], (const void *)uip_appdata, uip_len - 40 - UIP_LLH_LEN);
+        s_u64CpuCopy += uip_len - 40 - UIP_LLH_LEN;
+    }
+    EMAC_SendPkt(s_au8TxBuf, uip_len);
+}
+
+static void Periodic(void (*pfnSend)(void))
+{
+    u8_t i;
+
+    s_u64NextPeriodic = WallNs() + PERIODIC_NS;
+    if(pfnSend == NULL)
+    {
+        emacdev_periodic();
+    }
+    else
+    {
+        for(i = 0; i < UIP_CONNS; i++)
+        {
+            uip_periodic(i);
+            if(uip_len > 0)
+            {
+                uip_arp_out();
+                pfnSend();
+            }
+        }
+    }
+    if(++s_u8ArpTimer == 20)
+    {
+        uip_arp_timer();
+        s_u8ArpTimer = 0;
+    }
+}
+
+static void *CopyLoop(void *pvArg)
+{
+    (void)pvArg;
+    while(!s_iStop)
+    {
+        uip_len = LegacyRead();
+        if(uip_len == 0)
+        {
+            if(!s_iStop)
+                Periodic(LegacyWrite);
+            continue;
+        }
+        s_u32Passes++;
+        if(BUF->type == htons(UIP_ETHTYPE_IP))
+        {
+            uip_arp_ipin();
+            uip_input();
+            if(uip_len > 0)
+            {
+                uip_arp_out();
+                LegacyWrite();
+            }
+        }
+        else if(BUF->type == htons(UIP_ETHTYPE_ARP))
+        {
+            uip_arp_arpin();
+            if(uip_len > 0)
+                LegacyWrite();
+        }
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * New EMAC_uIP_httpd main loop (swap mode)
+ * ------------------------------------------------------------------------- */
+static void *SwapLoop(void *pvArg)
+{
+    uint32_t u32Us;
+
+    (void)pvArg;
+    while(!s_iStop)
+    {
+        if(emacdev_poll(EMACDEV_BATCH) != 0)
+        {
+            s_u32BusyPasses++;
+        }
+        else if((u32Us = PeriodicWaitUs()) != 0)
+        {
+            /* Sleep until frames arrive, as __WFI() would with the Rx interrupt; they are in the
+               Rx descriptors on return */
+            EmacRxDma(u32Us);
+        }
+        s_u32Passes++;
+        if(PeriodicWaitUs() == 0)
+            Periodic(NULL);
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * HTTP clients
+ * ------------------------------------------------------------------------- */
+static int Get(const char *pcPath, const struct fs_file *psExp)
+{
+    static __thread char acResp[MAX_RESP];
+    struct sockaddr_in sAddr;
+    struct timeval tv = { 5, 0 };
+    char acReq[64];
+    int iSock, iLen = 0, n, iOk;
+
+    iSock = socket(AF_INET, SOCK_STREAM, 0);
+    if(iSock < 0)
+        return 0;
+    setsockopt(iSock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(iSock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    memset(&sAddr, 0, sizeof(sAddr));
+    sAddr.sin_family = AF_INET;
+    sAddr.sin_port = htons(HTTP_PORT);
+    sAddr.sin_addr.s_addr = htonl((192UL << 24) | (168UL << 16) | (0UL << 8) | 5UL);
+    if(connect(iSock, (struct sockaddr *)&sAddr, sizeof(sAddr)) < 0)
+    {
+        close(iSock);
+        return 0;
+    }
+    n = snprintf(acReq, sizeof(acReq), "GET %s HTTP/1.0\r\n\r\n", pcPath);
+    if(send(iSock, acReq, n, 0) != n)
+    {
+        close(iSock);
+        return 0;
+    }
+    while((iLen < MAX_RESP) && ((n = recv(iSock, acResp + iLen, MAX_RESP - iLen, 0)) > 0))
+        iLen += n;
+    iOk = (n == 0) && (iLen == psExp->len) && (memcmp(acResp, psExp->data, iLen) == 0);
+    close(iSock);
+    return iOk;
+}
+
+static void *Client(void *pvArg)
+{
+    CLIENT_T *psClient = (CLIENT_T *)pvArg;
+    const struct fs_file *psExp = &s_asExp[psClient->pcPath == s_apcPath[0] ? 0 : 1];
+    uint32_t i;
+
+    for(i = 0; i < psClient->u32Reqs; i++)
+    {
+        if(Get(psClient->pcPath, psExp))
+            psClient->u32Ok++;
+        else
+            psClient->u32Bad++;
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Runs
+ * ------------------------------------------------------------------------- */
+static void UipReset(int iCopyMode)
+{
+    uip_ipaddr_t ipaddr;
+
+    EmacReset();
+    s_iCopyMode = iCopyMode;
+    s_u32PktLen = 0;
+    if(iCopyMode)
+        uip_buf = (u8_t *)s_au32UipBuf;
+    else
+        emacdev_init();
+
+    uip_init();
+    uip_ipaddr(ipaddr, 192, 168, 0, 5);
+    uip_sethostaddr(ipaddr);
+    uip_ipaddr(ipaddr, 192, 168, 0, 1);
+    uip_setdraddr(ipaddr);
+    uip_ipaddr(ipaddr, 255, 255, 255, 0);
+    uip_setnetmask(ipaddr);
+    uip_setethaddr(s_sEthAddr);
+    httpd_init();
+}
+
+static void Run(int iCopyMode, const char *pcPath, uint32_t u32Reqs, uint32_t u32Clients)
+{
+    pthread_t sDev;
+    uint64_t u64Start, u64Ns;
+    uint32_t i, u32Ok = 0, u32Bad = 0;
+    char acWhat[96];
+
+    UipReset(iCopyMode);
+    s_iStop = 0;
+    s_u64CpuCopy = 0;
+    s_u32RxFrames = s_u32Passes = s_u32BusyPasses = 0;
+    s_u64NextPeriodic = WallNs() + PERIODIC_NS;
+    pthread_create(&sDev, NULL, iCopyMode ? CopyLoop : SwapLoop, NULL);
+
+    /* One request first, so the ARP exchange is not timed */
+    Check(Get(pcPath, &s_asExp[pcPath == s_apcPath[0] ? 0 : 1]), "first request");
+    s_u64CpuCopy = 0;
+    s_u32RxFrames = s_u32Passes = s_u32BusyPasses = 0;
+    emacdev_stats.copied = 0;
+
+    u64Start = WallNs();
+    for(i = 0; i < u32Clients; i++)
+    {
+        memset(&s_asClient[i], 0, sizeof(s_asClient[i]));
+        s_asClient[i].pcPath = pcPath;
+        s_asClient[i].u32Reqs = u32Reqs;
+        pthread_create(&s_asClient[i].sThread, NULL, Client, &s_asClient[i]);
+    }
+    for(i = 0; i < u32Clients; i++)
+    {
+        pthread_join(s_asClient[i].sThread, NULL);
+        u32Ok += s_asClient[i].u32Ok;
+        u32Bad += s_asClient[i].u32Bad;
+    }
+    u64Ns = WallNs() - u64Start;
+    s_iStop = 1;
+    pthread_join(sDev, NULL);
+
+    if(!iCopyMode)
+        s_u64CpuCopy += emacdev_stats.copied;
+
+    printf("%-5s %-12s %7.0f req/s  %6.0f B copied/req  %5.2f frames/pass  %u/%u ok\n",
+           iCopyMode ? "copy" : "swap", pcPath, u32Ok * 1e9 / (double)u64Ns,
+           u32Ok ? (double)s_u64CpuCopy / u32Ok : 0.0,
+           iCopyMode ? 1.0 : (s_u32BusyPasses ? (double)s_u32RxFrames / s_u32BusyPasses : 0.0),
+           u32Ok, u32Ok + u32Bad);
+    snprintf(acWhat, sizeof(acWhat), "%s %s: %u of %u responses wrong or missing",
+             iCopyMode ? "copy" : "swap", pcPath, u32Bad, u32Ok + u32Bad);
+    Check(u32Bad == 0, acWhat);
+    if(!iCopyMode)
+        Check(emacdev_stats.tx_drop == 0, "no Tx descriptor free");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t u32Reqs = 500, u32Clients = 4, i;
+
+    if(argc > 1)
+        u32Reqs = (uint32_t)strtoul(argv[1], NULL, 0);
+    if(argc > 2)
+        u32Clients = (uint32_t)strtoul(argv[2], NULL, 0);
+    if(u32Reqs == 0)
+        u32Reqs = 1;
+    if((u32Clients == 0) || (u32Clients > MAX_CLIENTS))
+        u32Clients = 4;
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    for(i = 0; i < 2; i++)
+        Check(fs_open(s_apcPath[i], &s_asExp[i]) && (s_asExp[i].len <= MAX_RESP), "file in fsdata.c");
+
+    tapdev_init();
+    printf("%u clients x %u requests\n", u32Clients, u32Reqs);
+    for(i = 0; i < 2; i++)
+    {
+        Run(1, s_apcPath[i], u32Reqs, u32Clients);
+        Run(0, s_apcPath[i], u32Reqs, u32Clients);
+    }
+
+    printf("%s\n", s_u32Fails ? "FAIL" : "PASS");
+    return s_u32Fails ? 1 : 0;
+}